@@ -0,0 +1,125 @@
+#include "AlgoBuild.h"
+
+#include <QDebug>
+#include <QStringList>
+
+#include "AssertMacros.h"
+#include "ProcessUtilities.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+AlgoBuild::AlgoBuild(const QString& name, QObject* parent) :
+    QObject(parent),
+    m_name(name),
+    m_directory(SettingsMouseAlgos::getDirectory(name)),
+    m_isOtherDirectory(false),
+    m_process(nullptr),
+    m_isFinished(false),
+    m_isSuccessful(false) {
+}
+
+void AlgoBuild::setDirectory(const QString& directory) {
+    ASSERT_TR(m_process == nullptr);
+    m_directory = directory;
+    m_isOtherDirectory = true;
+}
+
+QString AlgoBuild::getDirectory() const {
+    return m_directory;
+}
+
+void AlgoBuild::start() {
+
+    ASSERT_TR(m_process == nullptr);
+    QString command = SettingsMouseAlgos::getBuildCommand(m_name);
+    QStringList arguments = SettingsMouseAlgos::getBuildArguments(m_name);
+    if (m_directory.isEmpty()) {
+        finish(false, "Its directory is empty");
+        return;
+    }
+    if (arguments.isEmpty()) {
+        finish(true, "Nothing to build");
+        return;
+    }
+    QString fingerprint =
+        ProcessUtilities::getBuildFingerprint(command, m_directory);
+    if (
+        !m_isOtherDirectory &&
+        fingerprint == SettingsMouseAlgos::getBuildFingerprint(m_name)
+    ) {
+        finish(true, "Nothing changed since the last successful build");
+        return;
+    }
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::MergedChannels);
+    connect(
+        m_process,
+        static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(
+            &QProcess::finished
+        ),
+        this,
+        &AlgoBuild::onExit
+    );
+
+    // A process that fails to start never exits
+    connect(
+        m_process,
+        &QProcess::errorOccurred,
+        this,
+        [=](QProcess::ProcessError error){
+            if (error == QProcess::FailedToStart) {
+                finish(false, m_process->errorString());
+            }
+        }
+    );
+    ProcessUtilities::start(arguments, m_directory, m_process);
+}
+
+bool AlgoBuild::isFinished() const {
+    return m_isFinished;
+}
+
+bool AlgoBuild::isSuccessful() const {
+    return m_isSuccessful;
+}
+
+QString AlgoBuild::getOutput() const {
+    return m_output;
+}
+
+QString AlgoBuild::getFingerprint() const {
+    ASSERT_TR(m_isSuccessful);
+    return ProcessUtilities::getBuildFingerprint(
+        SettingsMouseAlgos::getBuildCommand(m_name),
+        m_directory
+    );
+}
+
+void AlgoBuild::onExit(int exitCode, QProcess::ExitStatus exitStatus) {
+    bool isSuccessful = exitStatus == QProcess::NormalExit && exitCode == 0;
+    if (isSuccessful && !m_isOtherDirectory) {
+        // The build's own outputs are part of the fingerprint, so it's only
+        // taken once the build has succeeded
+        SettingsMouseAlgos::setBuildFingerprint(
+            m_name,
+            ProcessUtilities::getBuildFingerprint(
+                SettingsMouseAlgos::getBuildCommand(m_name),
+                m_directory
+            )
+        );
+    }
+    finish(isSuccessful, QString(m_process->readAll()).trimmed());
+}
+
+void AlgoBuild::finish(bool isSuccessful, const QString& output) {
+    m_isFinished = true;
+    m_isSuccessful = isSuccessful;
+    m_output = output;
+    // Queued, so that callers of start() never see the signal before it
+    // returns
+    QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+} 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+namespace mms {
+
+class AlgoBuild : public QObject {
+
+    // Builds a single mouse algorithm in the background, with the directory
+    // and build command from its settings, and without any window. Just like
+    // a build from the UI, the build is skipped if nothing changed since the
+    // last successful one, and the fingerprint is only taken once the build
+    // has succeeded; algorithms without a build command are run as they are,
+    // so there's nothing to build. The build never finishes before start()
+    // returns, even if it's skipped or fails to start.
+
+    Q_OBJECT
+
+public:
+
+    AlgoBuild(const QString& name, QObject* parent = 0);
+
+    // Builds in another directory instead, e.g. another checkout of the
+    // algorithm; such builds are never skipped, and never change the
+    // algorithm's fingerprint. To be called before start().
+    void setDirectory(const QString& directory);
+    QString getDirectory() const;
+
+    void start();
+    bool isFinished() const;
+    bool isSuccessful() const;
+
+    // The output of the build (stdout and stderr together), or why it wasn't
+    // run, once it has finished
+    QString getOutput() const;
+
+    // The fingerprint of what was built, once the build has succeeded
+    QString getFingerprint() const;
+
+signals:
+
+    void finished();
+
+private:
+
+    QString m_name;
+    QString m_directory;
+    bool m_isOtherDirectory;
+    QProcess* m_process;
+    bool m_isFinished;
+    bool m_isSuccessful;
+    QString m_output;
+
+    void onExit(int exitCode, QProcess::ExitStatus exitStatus);
+    void finish(bool isSuccessful, const QString& output);
+};
+
+} 
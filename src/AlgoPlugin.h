@@ -0,0 +1,95 @@
+#pragma once
+
+// The interface between the simulator and algorithms that are built as shared
+// libraries, so that batch evaluations can call them directly, without a
+// process, a pipe or any parsing. This header is plain C, and only depends on
+// the compiler, so that it can be copied into an algorithm's source as it is.
+//
+// A plugin exports a single function, named by MMS_PLUGIN_RUN_SYMBOL, which is
+// the algorithm's main function: it's called once per run, on a thread of its
+// own, with the API, and does whatever the algorithm does by calling the API's
+// functions, each with the API's context. Each function does exactly what the
+// command of the same name does (see the README), except that answers are
+// returned rather than written. Once the run is over (because the mouse
+// reached the center, or ran past a limit), every function that returns
+// something returns MMS_OVER, and nothing that's asked of the simulator
+// happens anymore; the plugin should then return as soon as it can. A plugin
+// that doesn't return within a second of its time limit is abandoned, and its
+// library is never unloaded.
+//
+// A plugin may be resumable instead, by exporting the three functions named by
+// MMS_PLUGIN_START_SYMBOL, MMS_PLUGIN_STEP_SYMBOL and MMS_PLUGIN_STOP_SYMBOL:
+// the algorithm is then a state machine (or a coroutine, resumed by its step)
+// rather than a main function. Start creates an instance's state, step resumes
+// it until it next waits on the simulator (e.g., after each movement) and
+// returns nonzero while it has more to do, and stop frees the state, whether
+// or not the algorithm was done. Resumable plugins get no thread of their own;
+// every run's steps are taken in turn on the thread that runs the batch, so
+// that any number of them can run at once. A step must return promptly, since
+// nothing else on the thread runs until it does, and it's never abandoned.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MMS_PLUGIN_ABI_VERSION 1
+#define MMS_PLUGIN_RUN_SYMBOL "mmsRun"
+#define MMS_PLUGIN_START_SYMBOL "mmsStart"
+#define MMS_PLUGIN_STEP_SYMBOL "mmsStep"
+#define MMS_PLUGIN_STOP_SYMBOL "mmsStop"
+
+// Returned instead of an answer once the run is over
+#define MMS_OVER (-1)
+
+#if defined(_WIN32)
+#define MMS_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define MMS_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef struct MmsApi {
+
+    // MMS_PLUGIN_ABI_VERSION, as of the simulator; functions are only ever
+    // added at the end, so that plugins work with any later version
+    int abiVersion;
+    void* context;
+
+    int (*mazeWidth)(void* context);
+    int (*mazeHeight)(void* context);
+
+    // One if there's a wall, zero if there isn't
+    int (*wallFront)(void* context);
+    int (*wallRight)(void* context);
+    int (*wallLeft)(void* context);
+
+    // One if the mouse moved, zero if it crashed into a wall
+    int (*moveForward)(void* context, int distance);
+    int (*turnRight)(void* context);
+    int (*turnLeft)(void* context);
+
+    // Directions and colors are the characters of the commands
+    void (*setWall)(void* context, int x, int y, char direction);
+    void (*clearWall)(void* context, int x, int y, char direction);
+    void (*setColor)(void* context, int x, int y, char color);
+    void (*clearColor)(void* context, int x, int y);
+    void (*clearAllColor)(void* context);
+    void (*setText)(void* context, int x, int y, const char* text);
+    void (*clearText)(void* context, int x, int y);
+    void (*clearAllText)(void* context);
+
+    int (*wasReset)(void* context);
+    void (*ackReset)(void* context);
+
+    // One once the run is over, zero before then
+    int (*isOver)(void* context);
+
+} MmsApi;
+
+typedef void (*MmsRunFunction)(const MmsApi* api);
+typedef void* (*MmsStartFunction)(const MmsApi* api);
+typedef int (*MmsStepFunction)(void* state, const MmsApi* api);
+typedef void (*MmsStopFunction)(void* state);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,150 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace mms {
+
+namespace {
+
+// Trivial, so that it never needs constructing, even for allocations made
+// before main or as threads start
+thread_local AllocationCounts THREAD_COUNTS = {0, 0, 0};
+
+}
+
+std::atomic<bool> AllocationCounter::IS_ENABLED(false);
+
+void AllocationCounter::setEnabled(bool enabled) {
+    IS_ENABLED.store(enabled, std::memory_order_relaxed);
+}
+
+bool AllocationCounter::isEnabled() {
+    return IS_ENABLED.load(std::memory_order_relaxed);
+}
+
+bool AllocationCounter::isCompiledIn() {
+#if defined(MMS_COUNT_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool AllocationCounter::isCountingMalloc() {
+#if defined(MMS_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationCounts AllocationCounter::getThreadCounts() {
+    return THREAD_COUNTS;
+}
+
+AllocationCounts AllocationCounter::getThreadCountsSince(
+        const AllocationCounts& before) {
+    AllocationCounts counts = THREAD_COUNTS;
+    counts.allocations -= before.allocations;
+    counts.bytes -= before.bytes;
+    counts.samples = 1;
+    return counts;
+}
+
+void AllocationCounter::record(std::size_t bytes) {
+    if (!IS_ENABLED.load(std::memory_order_relaxed)) {
+        return;
+    }
+    THREAD_COUNTS.allocations += 1;
+    THREAD_COUNTS.bytes += static_cast<qint64>(bytes);
+}
+
+AllocationScope::AllocationScope(AllocationCounts* counts) :
+    m_counts(AllocationCounter::isEnabled() ? counts : nullptr),
+    m_before(AllocationCounter::getThreadCounts()) {
+}
+
+AllocationScope::~AllocationScope() {
+    if (m_counts == nullptr) {
+        return;
+    }
+    AllocationCounts counts = AllocationCounter::getThreadCountsSince(m_before);
+    m_counts->allocations += counts.allocations;
+    m_counts->bytes += counts.bytes;
+    m_counts->samples += 1;
+}
+
+} 
+
+#if defined(MMS_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+// glibc's own allocator, which every other allocation function (free,
+// posix_memalign, and so on) keeps using as is
+extern "C" {
+
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+
+void* malloc(std::size_t size) {
+    mms::AllocationCounter::record(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+    mms::AllocationCounter::record(count * size);
+    return __libc_calloc(count, size);
+}
+
+// Counted as an allocation of the new size, since it may move the block
+void* realloc(void* pointer, std::size_t size) {
+    mms::AllocationCounter::record(size);
+    return __libc_realloc(pointer, size);
+}
+
+}
+
+#elif defined(MMS_COUNT_ALLOCATIONS)
+
+// The default operator delete frees the memory that these allocate, but is
+// replaced anyway, so that the two are always paired
+void* operator new(std::size_t size) {
+    mms::AllocationCounter::record(size);
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    mms::AllocationCounter::record(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+#endif
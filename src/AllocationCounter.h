@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include <QtGlobal>
+
+namespace mms {
+
+// Heap allocations, and the bytes that they asked for
+struct AllocationCounts {
+    qint64 allocations;
+    qint64 bytes;
+    qint64 samples; // the number of scopes counted, for averages
+};
+
+class AllocationCounter {
+
+    // Counts the heap allocations of each thread. The allocation functions
+    // are only replaced in builds with MMS_COUNT_ALLOCATIONS (qmake
+    // CONFIG+=count_allocations), which are for benchmarks and allocation
+    // tests, so that other builds keep the allocator as it is; even then,
+    // nothing is counted until it's enabled, so that an allocation costs a
+    // single atomic load when it's off. With glibc, malloc,
+    // calloc and realloc are replaced by ones that count and then forward to
+    // glibc's, so that Qt's containers and strings, which allocate with malloc
+    // directly, are counted too; elsewhere, only operator new is replaced, and
+    // only the allocations of C++ objects are counted. Each thread only counts
+    // its own allocations, so that a scope (see AllocationScope) doesn't pick
+    // up those of other threads.
+
+public:
+
+    AllocationCounter() = delete;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Whether allocations are counted at all in this build; if not, every
+    // count stays zero even while enabled
+    static bool isCompiledIn();
+
+    // Whether Qt's containers are counted too, i.e., whether malloc is
+    static bool isCountingMalloc();
+
+    // Everything that the calling thread has allocated while enabled
+    static AllocationCounts getThreadCounts();
+
+    // The allocations of the calling thread since it had the given counts
+    static AllocationCounts getThreadCountsSince(
+        const AllocationCounts& before);
+
+    // Called by the replaced allocation functions
+    static void record(std::size_t bytes);
+
+private:
+
+    static std::atomic<bool> IS_ENABLED;
+
+};
+
+class AllocationScope {
+
+    // Adds the allocations of the calling thread from its construction to
+    // its destruction, as one sample, to the given counts, if the counter
+    // was enabled when it was constructed; no ownership
+
+public:
+
+    explicit AllocationScope(AllocationCounts* counts);
+    ~AllocationScope();
+
+private:
+
+    AllocationCounts* m_counts;
+    AllocationCounts m_before;
+
+};
+
+} 
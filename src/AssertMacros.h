@@ -33,8 +33,8 @@ if (!((lhs) == (rhs))) {\
               << "FILE: " << __FILE__ << std::endl\
               << "LINE: " << __LINE__ << std::endl\
               << "COND: " << #lhs << " == " << #rhs << std::endl\
-              << "LHS: " << lhs << std::endl\
-              << "RHS: " << rhs << std::endl\
+              << "LHS: " << (lhs) << std::endl\
+              << "RHS: " << (rhs) << std::endl\
               << CLOSING << std::endl;\
     throw std::runtime_error(ERR_MSG);\
 }
@@ -45,8 +45,8 @@ if (!((lhs) != (rhs))) {\
               << "FILE: " << __FILE__ << std::endl\
               << "LINE: " << __LINE__ << std::endl\
               << "COND: " << #lhs << " != " << #rhs << std::endl\
-              << "LHS: " << lhs << std::endl\
-              << "RHS: " << rhs << std::endl\
+              << "LHS: " << (lhs) << std::endl\
+              << "RHS: " << (rhs) << std::endl\
               << CLOSING << std::endl;\
     throw std::runtime_error(ERR_MSG);\
 }
@@ -57,8 +57,8 @@ if (!((lhs) < (rhs))) {\
               << "FILE: " << __FILE__ << std::endl\
               << "LINE: " << __LINE__ << std::endl\
               << "COND: " << #lhs << " < " << #rhs << std::endl\
-              << "LHS: " << lhs << std::endl\
-              << "RHS: " << rhs << std::endl\
+              << "LHS: " << (lhs) << std::endl\
+              << "RHS: " << (rhs) << std::endl\
               << CLOSING << std::endl;\
     throw std::runtime_error(ERR_MSG);\
 }
@@ -69,8 +69,8 @@ if (!((lhs) <= (rhs))) {\
               << "FILE: " << __FILE__ << std::endl\
               << "LINE: " << __LINE__ << std::endl\
               << "COND: " << #lhs << " <= " << #rhs << std::endl\
-              << "LHS: " << lhs << std::endl\
-              << "RHS: " << rhs << std::endl\
+              << "LHS: " << (lhs) << std::endl\
+              << "RHS: " << (rhs) << std::endl\
               << CLOSING << std::endl;\
     throw std::runtime_error(ERR_MSG);\
 }
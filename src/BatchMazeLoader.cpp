@@ -0,0 +1,173 @@
+#include "BatchMazeLoader.h"
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+#include "MazeIndex.h"
+
+namespace mms {
+
+const int BatchMazeLoader::CAPACITY = 64;
+
+BatchMazeLoader::BatchMazeLoader(
+        const QStringList& sources,
+        int numThreads,
+        bool withSymmetries) :
+    m_sources(sources),
+    m_withSymmetries(withSymmetries),
+    m_threads(QVector<std::thread*>()),
+    m_slots(QVector<QVector<LoadedMaze>>(CAPACITY)),
+    m_isReady(QVector<bool>(CAPACITY, false)),
+    m_nextToLoad(0),
+    m_nextToTake(0),
+    m_isStopping(false),
+    m_taken(QVector<LoadedMaze>()),
+    m_takenIndex(-1) {
+    ASSERT_LT(0, numThreads);
+    numThreads = qMin(numThreads, qMin(CAPACITY, m_sources.size()));
+    for (int i = 0; i < numThreads; i += 1) {
+        m_threads.append(new std::thread(&BatchMazeLoader::work, this));
+    }
+}
+
+BatchMazeLoader::~BatchMazeLoader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_wasTaken.notify_all();
+    for (std::thread* thread : m_threads) {
+        thread->join();
+        delete thread;
+    }
+    // The mazes that were loaded but never taken
+    for (int i = 0; i < CAPACITY; i += 1) {
+        if (m_isReady.at(i)) {
+            for (const LoadedMaze& loaded : m_slots.at(i)) {
+                delete loaded.maze;
+            }
+        }
+    }
+    for (const LoadedMaze& loaded : m_taken) {
+        delete loaded.maze;
+    }
+}
+
+bool BatchMazeLoader::takeNext(int* index, LoadedMaze* loaded) {
+    if (!m_taken.isEmpty()) {
+        *index = m_takenIndex;
+        *loaded = m_taken.takeFirst();
+        return true;
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_sources.size() <= m_nextToTake) {
+            return false;
+        }
+        int slot = m_nextToTake % CAPACITY;
+        m_wasLoaded.wait(lock, [&]() {
+            return m_isReady.at(slot);
+        });
+        *index = m_nextToTake;
+        m_taken = m_slots.at(slot);
+        m_takenIndex = m_nextToTake;
+        m_slots[slot] = QVector<LoadedMaze>();
+        m_isReady[slot] = false;
+        m_nextToTake += 1;
+    }
+    m_wasTaken.notify_all();
+    *loaded = m_taken.takeFirst();
+    return true;
+}
+
+void BatchMazeLoader::work() {
+    while (true) {
+        int index = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wasTaken.wait(lock, [&]() {
+                return (
+                    m_isStopping ||
+                    m_sources.size() <= m_nextToLoad ||
+                    m_nextToLoad < m_nextToTake + CAPACITY
+                );
+            });
+            if (m_isStopping || m_sources.size() <= m_nextToLoad) {
+                return;
+            }
+            index = m_nextToLoad;
+            m_nextToLoad += 1;
+        }
+
+        // Without the lock, which is the point
+        QVector<LoadedMaze> loaded = load(m_sources.at(index));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_slots[index % CAPACITY] = loaded;
+            m_isReady[index % CAPACITY] = true;
+        }
+        m_wasLoaded.notify_all();
+    }
+}
+
+QVector<LoadedMaze> BatchMazeLoader::load(const QString& source) const {
+    MazeError error;
+    Maze* maze = MazeGenerator::load(source, &error);
+    if (maze == nullptr) {
+        LoadedMaze loaded = solve(nullptr, Symmetry::IDENTITY);
+        loaded.error = error;
+        return {loaded};
+    }
+    QVector<LoadedMaze> loaded = {solve(maze, Symmetry::IDENTITY)};
+    if (!m_withSymmetries) {
+        return loaded;
+    }
+
+    // Every variant is built from the walls of the source, in memory
+    const WallGrid& walls = maze->getWalls();
+    quint64 orbitHash = MazeSymmetry::getOrbitHash(walls);
+    loaded[0].orbitHash = orbitHash;
+    for (Symmetry symmetry : MazeSymmetry::SYMMETRIES()) {
+        if (symmetry == Symmetry::IDENTITY) {
+            continue;
+        }
+        WallGrid variantWalls = MazeSymmetry::apply(walls, symmetry);
+        quint64 hash = Maze::getHash(variantWalls);
+        bool isRepeated = false;
+        for (const LoadedMaze& other : loaded) {
+            isRepeated = isRepeated || other.hash == hash;
+        }
+        if (isRepeated) {
+            continue;
+        }
+        Maze* variant = Maze::fromWalls(variantWalls);
+        ASSERT_FA(variant == nullptr);
+        if (variant->getDistance(0, 0) == -1) {
+            delete variant;
+            continue;
+        }
+        loaded.append(solve(variant, symmetry));
+        loaded.last().orbitHash = orbitHash;
+    }
+    return loaded;
+}
+
+LoadedMaze BatchMazeLoader::solve(Maze* maze, Symmetry symmetry) {
+    // The solvers run in-process, and take next to no time
+    LoadedMaze loaded = {
+        maze,
+        MazeError(),
+        0,
+        0,
+        QVector<ReferenceResult>(),
+        symmetry,
+        0
+    };
+    if (maze != nullptr) {
+        loaded.hash = maze->getHash();
+        loaded.canonicalHash = MazeIndex::getCanonicalHash(maze->getWalls());
+        loaded.references = ReferenceSolvers::solveAll(maze);
+    }
+    return loaded;
+}
+
+} 
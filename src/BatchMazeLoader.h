@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Maze.h"
+#include "MazeSymmetry.h"
+#include "ReferenceSolvers.h"
+
+namespace mms {
+
+// A maze as the batch needs it, with everything that's computed from it
+struct LoadedMaze {
+    Maze* maze; // nullptr if the source isn't a valid maze
+    MazeError error; // why it isn't, if it isn't
+    quint64 hash;
+    quint64 canonicalHash; // see MazeIndex::getCanonicalHash
+    QVector<ReferenceResult> references;
+    Symmetry symmetry; // of the source, if the maze is one of its variants
+    quint64 orbitHash; // see MazeSymmetry::getOrbitHash, or 0 without them
+};
+
+class BatchMazeLoader {
+
+    // Loads a list of mazes ahead of whoever's running them, on a pool of
+    // threads. Loading a maze (reading and parsing it, validating it, finding
+    // its distances, and solving it with the reference solvers) touches no
+    // shared state, so each thread loads the next source into a Maze of its
+    // own. At most CAPACITY mazes are loaded but not yet taken, so that the
+    // threads never get too far ahead, and a corpus of thousands of mazes is
+    // never held in memory all at once. Mazes are taken in the order of
+    // their sources, by a single thread.
+    //
+    // With symmetries, each valid source is followed by its variants (see
+    // MazeSymmetry), built on the same thread, from its walls, and solved
+    // like any other maze. Only variants from whose start the center can be
+    // reached, and that differ from the source and every variant before
+    // them, are kept; a symmetric maze has fewer of them.
+
+public:
+
+    BatchMazeLoader(
+        const QStringList& sources,
+        int numThreads,
+        bool withSymmetries = false);
+    ~BatchMazeLoader();
+
+    // Blocks until the next maze is loaded, and returns false if there are
+    // no mazes left; the index is that of its source, and the caller takes
+    // ownership of the maze
+    bool takeNext(int* index, LoadedMaze* loaded);
+
+private:
+
+    static const int CAPACITY;
+
+    QStringList m_sources;
+    bool m_withSymmetries;
+    QVector<std::thread*> m_threads;
+
+    // Under the mutex; the slot of index i is i % CAPACITY, and holds the
+    // source's maze followed by its variants
+    std::mutex m_mutex;
+    std::condition_variable m_wasLoaded;
+    std::condition_variable m_wasTaken;
+    QVector<QVector<LoadedMaze>> m_slots;
+    QVector<bool> m_isReady;
+    int m_nextToLoad;
+    int m_nextToTake;
+    bool m_isStopping;
+
+    // Only touched by the taking thread: the mazes of the last source that
+    // was taken which haven't been taken yet, and its index
+    QVector<LoadedMaze> m_taken;
+    int m_takenIndex;
+
+    // The body of each thread
+    void work();
+    QVector<LoadedMaze> load(const QString& source) const;
+    static LoadedMaze solve(Maze* maze, Symmetry symmetry);
+
+};
+
+} 
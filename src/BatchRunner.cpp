@@ -0,0 +1,782 @@
+#include "BatchRunner.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QTextStream>
+#include <QThread>
+
+#include "AssertMacros.h"
+#include "Maze.h"
+#include "MazeLibrary.h"
+#include "MazePack.h"
+#include "MazeSymmetry.h"
+#include "PluginRun.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+BatchRunner::BatchRunner(
+        const QString& algoName,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool useSharedMemory,
+        bool reuseProcesses,
+        bool continuous,
+        const ProcessLimits& processLimits,
+        const QString& storePath,
+        const QVector<MazeIndex::Condition>& filter,
+        bool skipDuplicates,
+        QObject* parent) :
+    QObject(parent),
+    m_algoName(algoName),
+    m_mazeDirectory(mazeDirectory),
+    m_generatedMazes(generatedMazes),
+    m_numJobs(numJobs),
+    m_timeLimitSeconds(timeLimitSeconds),
+    m_tickLimit(tickLimit),
+    m_commandLimit(commandLimit),
+    m_moveLimit(moveLimit),
+    m_useSharedMemory(useSharedMemory),
+    m_reuseProcesses(reuseProcesses),
+    m_continuous(continuous),
+    m_processLimits(processLimits),
+    m_storePath(storePath),
+    m_filter(filter),
+    m_skipDuplicates(skipDuplicates),
+    m_isContest(false),
+    m_contestRules(ContestScorer::DEFAULT_RULES()),
+    m_mouseDefinition(MouseDefinition::getDefault()),
+    m_withSymmetries(false),
+    m_isMemoized(false),
+    m_isPlugin(false),
+    m_loader(nullptr),
+    m_numRunning(0),
+    m_metrics(nullptr),
+    m_store(nullptr) {
+    ASSERT_LT(0, m_numJobs);
+    for (int i = 0; i < m_numJobs; i += 1) {
+        m_freeCpus.append(i);
+    }
+}
+
+BatchRunner::~BatchRunner() {
+    delete m_loader;
+    delete m_store;
+}
+
+void BatchRunner::setMetrics(MetricsEndpoint* metrics) {
+    m_metrics = metrics;
+}
+
+void BatchRunner::setContestRules(const ContestRules& rules) {
+    ASSERT_FA(m_reuseProcesses);
+    m_isContest = true;
+    m_contestRules = rules;
+}
+
+void BatchRunner::setMouseDefinition(
+        std::shared_ptr<const MouseDefinition> definition) {
+    m_mouseDefinition = definition;
+}
+
+void BatchRunner::setSymmetries(bool withSymmetries) {
+    m_withSymmetries = withSymmetries;
+}
+
+void BatchRunner::setMemoized(bool isMemoized) {
+    ASSERT_TR(!isMemoized || !m_storePath.isEmpty());
+    ASSERT_TR(!isMemoized || !m_reuseProcesses);
+    m_isMemoized = isMemoized;
+}
+
+bool BatchRunner::start() {
+
+    if (!SettingsMouseAlgos::names().contains(m_algoName)) {
+        qWarning().noquote().nospace()
+            << "No mouse algorithm named \"" << m_algoName << "\"";
+        return false;
+    }
+    m_runArguments = SettingsMouseAlgos::getRunArguments(m_algoName);
+    m_directory = SettingsMouseAlgos::getDirectory(m_algoName);
+
+    // Remote algorithms are driven by hand, one run at a time
+    if (SettingsMouseAlgos::getListenPort(m_algoName) != 0) {
+        qWarning().noquote().nospace()
+            << "The mouse algorithm \"" << m_algoName
+            << "\" connects over TCP, so it only runs in the window";
+        return false;
+    }
+
+    // A plugin's run command is the path of its library, spaces and all
+    m_isPlugin = SettingsMouseAlgos::isPlugin(m_algoName);
+    if (m_isPlugin) {
+        if (m_continuous) {
+            qWarning().noquote().nospace()
+                << "The plugin \"" << m_algoName
+                << "\" can't be run with continuous movements";
+            return false;
+        }
+        m_libraryPath = QDir(m_directory).absoluteFilePath(
+            SettingsMouseAlgos::getRunCommand(m_algoName).trimmed()
+        );
+    }
+    if (m_isMemoized && !ResultStore::readJobs(m_storePath, &m_memoized)) {
+        qWarning().noquote().nospace()
+            << "Unable to read result store \"" << m_storePath << "\"";
+        return false;
+    }
+    if (!m_storePath.isEmpty()) {
+        m_store = ResultStore::open(m_storePath);
+        if (m_store == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open result store \"" << m_storePath << "\"";
+            return false;
+        }
+        m_version = ResultStore::getVersion(m_algoName);
+        m_rules = getRules();
+    }
+
+    // The directory is optional when there are generated mazes, and can be a
+    // pack instead
+    if (MazePack::isPack(m_mazeDirectory)) {
+        QString error;
+        std::shared_ptr<const MazePack> pack = MazePack::open(
+            m_mazeDirectory,
+            &error
+        );
+        if (pack == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open maze pack \"" << m_mazeDirectory << "\": "
+                << error;
+            return false;
+        }
+        m_mazePaths.append(pack->getSources());
+    }
+    else if (!m_mazeDirectory.isEmpty()) {
+        QDir dir(m_mazeDirectory);
+        if (!dir.exists()) {
+            qWarning().noquote().nospace()
+                << "No maze directory at \"" << m_mazeDirectory << "\"";
+            return false;
+        }
+        m_mazePaths.append(MazeLibrary::getMazeFiles(m_mazeDirectory));
+    }
+    m_mazePaths.append(m_generatedMazes);
+
+    // Invalid mazes match no filter, so they aren't reported either
+    if (!m_filter.isEmpty()) {
+        QVector<MazeFeatures> features = MazeIndex::build(
+            m_mazePaths,
+            MazeIndex::getSidecarPath(m_mazeDirectory)
+        );
+        QStringList matching;
+        for (const MazeFeatures& mazeFeatures : features) {
+            if (MazeIndex::matches(mazeFeatures, m_filter)) {
+                matching.append(mazeFeatures.source);
+            }
+        }
+        qInfo().noquote().nospace()
+            << matching.size() << " of " << m_mazePaths.size()
+            << " mazes match the filter";
+        m_mazePaths = matching;
+    }
+    m_loader = new BatchMazeLoader(
+        m_mazePaths,
+        QThread::idealThreadCount(),
+        m_withSymmetries
+    );
+
+    // Fill every slot; each finished run starts the next one
+    for (int i = 0; i < m_numJobs; i += 1) {
+        startNextRun();
+    }
+    if (m_numRunning == 0) {
+        printResults();
+        emit done();
+    }
+    return true;
+}
+
+bool BatchRunner::takeNextMaze(int* index, Maze** maze) {
+
+    // Files that aren't valid mazes are reported, not run; generated mazes
+    // are built, like the others, a little before they're needed
+    int source = 0;
+    LoadedMaze loaded;
+    while (m_loader->takeNext(&source, &loaded)) {
+        *index = m_results.size();
+        m_rowPaths.append(MazeSymmetry::getVariantName(
+            m_mazePaths.at(source),
+            loaded.symmetry
+        ));
+        m_results.append(RunResult());
+        m_isRecorded.append(false);
+        m_references.append(loaded.references);
+        m_mazeHashes.append(loaded.hash);
+        m_orbitHashes.append(loaded.orbitHash);
+        m_jobKeys.append(
+            m_store == nullptr
+            ? 0
+            : ResultStore::getJobKey(m_version, loaded.hash, m_rules)
+        );
+        if (loaded.maze == nullptr) {
+            m_results[*index] = HeadlessRun::getUnrunResult(
+                m_rowPaths.at(*index),
+                RunStatus::INVALID_MAZE,
+                Maze::errorToString(loaded.error)
+            );
+            if (m_metrics != nullptr) {
+                m_metrics->recordResult(m_results.at(*index));
+            }
+            continue;
+        }
+
+        // A duplicate waits for its original, unless that's already done
+        if (m_skipDuplicates) {
+            quint64 key = m_withSymmetries ? loaded.hash : loaded.canonicalHash;
+            auto it = m_firstMazes.constFind(key);
+            if (it != m_firstMazes.constEnd()) {
+                delete loaded.maze;
+                if (m_isRecorded.at(it.value())) {
+                    shareResult(it.value(), *index);
+                }
+                else {
+                    m_duplicates[it.value()].append(*index);
+                }
+                continue;
+            }
+            m_firstMazes.insert(key, *index);
+        }
+
+        // Keys are never zero, so only jobs that have one are ever found
+        auto memoized = m_memoized.constFind(m_jobKeys.at(*index));
+        if (memoized != m_memoized.constEnd()) {
+            delete loaded.maze;
+            reuseResult(*index, memoized.value());
+            continue;
+        }
+        *maze = loaded.maze;
+        return true;
+    }
+    return false;
+}
+
+void BatchRunner::startNextRun() {
+
+    int index = 0;
+    Maze* maze = nullptr;
+    if (!takeNextMaze(&index, &maze)) {
+        return;
+    }
+    if (m_isPlugin) {
+        startPluginRun(index, maze);
+        return;
+    }
+    HeadlessRun* run = new HeadlessRun(
+        m_rowPaths.at(index),
+        maze,
+        m_runArguments,
+        m_directory,
+        m_timeLimitSeconds,
+        m_tickLimit,
+        m_useSharedMemory,
+        m_reuseProcesses,
+        m_continuous,
+        this
+    );
+    run->setStepLimits(m_commandLimit, m_moveLimit);
+    if (m_metrics != nullptr) {
+        run->setLatency(m_metrics->getLatency());
+    }
+    if (m_isContest) {
+        run->setContestRules(m_contestRules);
+    }
+    run->setMouseDefinition(m_mouseDefinition);
+    int cpu = m_freeCpus.takeFirst();
+    run->setProcessLimits(m_processLimits, cpu);
+    run->setProperty("index", index);
+    connect(run, &HeadlessRun::mazeFinished, this, [=](){
+        recordResult(run->property("index").toInt(), run->getResult());
+    });
+    connect(run, &HeadlessRun::nextMazeRequested, this, [=](){
+        onNextMazeRequested(run);
+    });
+    connect(run, &HeadlessRun::finished, this, [=](){
+        m_freeCpus.append(cpu);
+        onRunFinished(run);
+    });
+    m_numRunning += 1;
+    if (m_metrics != nullptr) {
+        m_metrics->setNumInFlight(m_numRunning);
+    }
+    run->start();
+}
+
+void BatchRunner::startPluginRun(int index, Maze* maze) {
+    PluginRun* run = new PluginRun(
+        m_rowPaths.at(index),
+        maze,
+        m_libraryPath,
+        m_timeLimitSeconds,
+        m_tickLimit,
+        this
+    );
+    run->setStepLimits(m_commandLimit, m_moveLimit);
+    if (m_isContest) {
+        run->setContestRules(m_contestRules);
+    }
+    run->setMouseDefinition(m_mouseDefinition);
+    connect(run, &PluginRun::mazeFinished, this, [=](){
+        recordResult(index, run->getResult());
+    });
+    connect(run, &PluginRun::finished, this, [=](){
+        onRunFinished(run);
+    });
+    m_numRunning += 1;
+    if (m_metrics != nullptr) {
+        m_metrics->setNumInFlight(m_numRunning);
+    }
+    run->start();
+}
+
+void BatchRunner::onNextMazeRequested(HeadlessRun* run) {
+    int index = 0;
+    Maze* maze = nullptr;
+    if (!takeNextMaze(&index, &maze)) {
+        return;
+    }
+    run->setProperty("index", index);
+    run->setNextMaze(m_rowPaths.at(index), maze);
+}
+
+void BatchRunner::onRunFinished(QObject* run) {
+
+    run->deleteLater();
+    m_numRunning -= 1;
+    if (m_metrics != nullptr) {
+        m_metrics->setNumInFlight(m_numRunning);
+    }
+
+    startNextRun();
+    if (m_numRunning == 0) {
+        printResults();
+        emit done();
+    }
+}
+
+void BatchRunner::recordResult(int index, const RunResult& result) {
+    m_results[index] = result;
+    m_isRecorded[index] = true;
+    if (m_metrics != nullptr) {
+        m_metrics->recordResult(result);
+    }
+    if (m_store != nullptr) {
+        m_store->append(ResultStore::toRow(
+            result,
+            m_mazeHashes.at(index),
+            m_algoName,
+            ResultStore::getVersion(m_algoName),
+            m_jobKeys.at(index)
+        ));
+    }
+    for (int duplicate : m_duplicates.take(index)) {
+        shareResult(index, duplicate);
+    }
+}
+
+void BatchRunner::shareResult(int original, int duplicate) {
+    // Nothing was run, so neither the metrics nor the store hear of it
+    RunResult result = m_results.at(original);
+    result.mazePath = m_rowPaths.at(duplicate);
+    result.duplicateOf = m_rowPaths.at(original);
+    m_results[duplicate] = result;
+    m_isRecorded[duplicate] = true;
+}
+
+void BatchRunner::reuseResult(int index, const RunResult& result) {
+    // Likewise; the maze was only just taken, so nothing is waiting for it
+    m_results[index] = result;
+    m_results[index].mazePath = m_rowPaths.at(index);
+    m_isRecorded[index] = true;
+}
+
+QString BatchRunner::getRules() const {
+    // The same as a tournament's (see TournamentRunner::getRules), and then
+    // only what a tournament can't set, when it's set
+    QString rules = QString("timeout=%1;ticks=%2;continuous=%3;memory=%4")
+        .arg(m_timeLimitSeconds)
+        .arg(m_tickLimit)
+        .arg(m_continuous ? 1 : 0)
+        .arg(m_processLimits.memoryBytes);
+    if (0 <= m_commandLimit) {
+        rules += QString(";commands=%1").arg(m_commandLimit);
+    }
+    if (0 <= m_moveLimit) {
+        rules += QString(";moves=%1").arg(m_moveLimit);
+    }
+    if (m_isContest) {
+        rules += ";contest=" + ContestScorer::rulesToString(m_contestRules);
+    }
+    QByteArray mouseHash = m_mouseDefinition->getHash();
+    if (mouseHash != MouseDefinition::getDefault()->getHash()) {
+        rules += ";mouse=" + QString::fromLatin1(mouseHash.toHex());
+    }
+    if (m_isPlugin) {
+        rules += ";plugin";
+    }
+    return rules + ";run=" + m_runArguments.join(' ');
+}
+
+double BatchRunner::getExploredPercent(const RunResult& result) {
+    const CoverageStats& coverage = result.coverage;
+    return 100.0 * coverage.numVisitedBeforeCenter / coverage.numCells;
+}
+
+void BatchRunner::printResults() const {
+
+    QTextStream out(stdout);
+
+    int pathWidth = QString("maze").size();
+    for (const RunResult& result : m_results) {
+        pathWidth = qMax(pathWidth, result.mazePath.size());
+    }
+
+    out << QString("maze").leftJustified(pathWidth) << "  "
+        << QString("status").leftJustified(12)
+        << QString("moves").rightJustified(8)
+        << QString("turns").rightJustified(8)
+        << QString("seconds").rightJustified(10);
+    // Only continuous movements take any simulated time
+    if (m_continuous) {
+        out << QString("mouse s").rightJustified(10);
+    }
+    out << QString("est s").rightJustified(10);
+    // Only contests are scored by anything but the first run
+    if (m_isContest) {
+        out << QString("runs").rightJustified(6)
+            << QString("score").rightJustified(10);
+    }
+    out << QString("ticks").rightJustified(10)
+        << QString("visited").rightJustified(9)
+        << QString("revisits").rightJustified(9)
+        << QString("explored").rightJustified(9)
+        << QString("walls").rightJustified(8)
+        << QString("wrong").rightJustified(7)
+        << QString("cpu").rightJustified(10)
+        << QString("peak MB").rightJustified(9)
+        << QString("cmd/s").rightJustified(10)
+        << QString("bytes in").rightJustified(10)
+        << QString("bytes out").rightJustified(10)
+        << QString("sim s").rightJustified(10)
+        << QString("algo s").rightJustified(10) << endl;
+
+    int numSolved = 0;
+    int totalMoves = 0;
+    int totalTurns = 0;
+    double totalSimulatedSeconds = 0.0;
+    double totalEstimatedSeconds = 0.0;
+    qint64 totalTicks = 0;
+    double totalExploredPercent = 0.0;
+    int totalWrongWalls = 0;
+    int numRunsWithWrongWalls = 0;
+    double totalSimulatorSeconds = 0.0;
+    double totalAlgorithmSeconds = 0.0;
+    int numScored = 0;
+    double totalScore = 0.0;
+    for (const RunResult& result : m_results) {
+        out << result.mazePath.leftJustified(pathWidth) << "  "
+            << HeadlessRun::statusToString(result.status).leftJustified(12)
+            << QString::number(result.moves).rightJustified(8)
+            << QString::number(result.turns).rightJustified(8)
+            << QString::number(result.seconds, 'f', 3).rightJustified(10);
+        if (m_continuous) {
+            out << QString::number(result.simulatedSeconds, 'f', 3)
+                .rightJustified(10);
+        }
+        out << QString::number(result.estimatedSeconds, 'f', 3)
+            .rightJustified(10);
+        if (m_isContest) {
+            QString score = "n/a";
+            if (0 <= result.contest.bestRun) {
+                score = QString::number(result.contest.score, 'f', 3);
+                numScored += 1;
+                totalScore += result.contest.score;
+            }
+            out << QString::number(result.contest.numRuns).rightJustified(6)
+                << score.rightJustified(10);
+        }
+        out << QString::number(result.ticks).rightJustified(10)
+            << QString::number(result.coverage.numVisited).rightJustified(9)
+            << QString::number(result.coverage.numRevisits).rightJustified(9);
+
+        // The share of the maze explored before first reaching the center
+        QString explored = "n/a";
+        if (0 <= result.coverage.numVisitedBeforeCenter) {
+            explored = QString::number(getExploredPercent(result), 'f', 1)
+                + "%";
+        }
+        out << explored.rightJustified(9);
+
+        // The share of the walls that the algorithm declared, and how many
+        // of them it got wrong, which points to misread sensors
+        const KnownWallStats& knownWalls = result.knownWalls;
+        QString walls = "n/a";
+        if (0 < knownWalls.numWalls) {
+            walls = QString::number(
+                100.0 * knownWalls.numKnown / knownWalls.numWalls, 'f', 1
+            ) + "%";
+        }
+        out << walls.rightJustified(8)
+            << QString::number(knownWalls.numWrong).rightJustified(7);
+        totalWrongWalls += knownWalls.numWrong;
+        numRunsWithWrongWalls += 0 < knownWalls.numWrong ? 1 : 0;
+
+        // Rejected mazes were never run, so there's nothing to account for
+        if (result.status != RunStatus::INVALID_MAZE) {
+            const RunStats& stats = result.stats;
+            QString cpu = "n/a";
+            if (0.0 <= stats.cpuSeconds) {
+                cpu = QString::number(stats.cpuSeconds, 'f', 3);
+            }
+            QString peak = "n/a";
+            if (0 <= stats.peakResidentBytes) {
+                peak = QString::number(
+                    stats.peakResidentBytes / 1048576.0, 'f', 1);
+            }
+            out << cpu.rightJustified(10)
+                << peak.rightJustified(9)
+                << QString::number(stats.commandsPerSecond, 'f', 0)
+                    .rightJustified(10)
+                << QString::number(stats.bytesIn).rightJustified(10)
+                << QString::number(stats.bytesOut).rightJustified(10)
+                << QString::number(stats.simulatorSeconds, 'f', 3)
+                    .rightJustified(10)
+                << QString::number(stats.algorithmSeconds, 'f', 3)
+                    .rightJustified(10);
+            totalSimulatorSeconds += stats.simulatorSeconds;
+            totalAlgorithmSeconds += stats.algorithmSeconds;
+        }
+        if (!result.duplicateOf.isEmpty()) {
+            out << "  duplicate of " << result.duplicateOf;
+        }
+        if (!result.error.isEmpty()) {
+            out << "  " << result.error;
+        }
+        out << endl;
+        if (result.status == RunStatus::SOLVED) {
+            numSolved += 1;
+            totalMoves += result.moves;
+            totalTurns += result.turns;
+            totalSimulatedSeconds += result.simulatedSeconds;
+            totalEstimatedSeconds += result.estimatedSeconds;
+            totalTicks += result.ticks;
+            totalExploredPercent += getExploredPercent(result);
+        }
+    }
+
+    // Averages only make sense over the mazes that were actually solved
+    out << endl << "solved: " << numSolved << "/" << m_results.size();
+    if (0 < numSolved) {
+        out << ", average moves: "
+            << QString::number(static_cast<double>(totalMoves) / numSolved,
+                'f', 1)
+            << ", average turns: "
+            << QString::number(static_cast<double>(totalTurns) / numSolved,
+                'f', 1);
+        if (m_continuous) {
+            out << ", average mouse seconds: "
+                << QString::number(totalSimulatedSeconds / numSolved, 'f', 3);
+        }
+        out << ", average estimated seconds: "
+            << QString::number(totalEstimatedSeconds / numSolved, 'f', 3)
+            << ", average ticks: "
+            << QString::number(static_cast<double>(totalTicks) / numSolved,
+                'f', 1)
+            << ", average explored: "
+            << QString::number(totalExploredPercent / numSolved, 'f', 1)
+            << "%";
+    }
+    out << endl;
+
+    // Mazes without a score have no time to average, however close they came
+    if (m_isContest) {
+        out << "scored: " << numScored << "/" << m_results.size();
+        if (0 < numScored) {
+            out << ", average score: "
+                << QString::number(totalScore / numScored, 'f', 3) << " s";
+        }
+        out << ", by " << ContestScorer::rulesToString(m_contestRules)
+            << endl;
+    }
+
+    // Any wrong wall at all is a bug in the algorithm, however it did
+    out << "walls declared wrong: " << totalWrongWalls << ", in "
+        << numRunsWithWrongWalls << "/" << m_results.size() << " runs"
+        << endl;
+
+    // Whether a slow batch is the algorithm's fault or the simulator's
+    out << "waited on the simulator: "
+        << QString::number(totalSimulatorSeconds, 'f', 3) << " s"
+        << ", on the algorithm: "
+        << QString::number(totalAlgorithmSeconds, 'f', 3) << " s" << endl;
+
+    // Whether the CPU times can be compared at all
+    int numIsolated = 0;
+    QString example;
+    for (const RunResult& result : m_results) {
+        if (!result.limits.isEmpty()) {
+            numIsolated += 1;
+            example = result.limits;
+        }
+    }
+    if (0 < numIsolated) {
+        out << "isolated: " << numIsolated << "/" << m_results.size()
+            << " runs, e.g. " << example << endl;
+    }
+
+    if (m_withSymmetries) {
+        printSymmetries(&out, pathWidth);
+    }
+    printReferences(&out, pathWidth);
+}
+
+void BatchRunner::printSymmetries(QTextStream* out, int pathWidth) const {
+
+    // The rows of each orbit, in the order of their first row, which names
+    // the orbit; mazes that were never run have no variants
+    QVector<quint64> orbits;
+    QMap<quint64, QVector<int>> rows;
+    for (int i = 0; i < m_results.size(); i += 1) {
+        if (m_results.at(i).status == RunStatus::INVALID_MAZE) {
+            continue;
+        }
+        quint64 orbit = m_orbitHashes.at(i);
+        if (!rows.contains(orbit)) {
+            orbits.append(orbit);
+        }
+        rows[orbit].append(i);
+    }
+
+    *out << endl << QString("symmetries").leftJustified(pathWidth) << "  "
+        << QString("variants").rightJustified(8)
+        << QString("solved").rightJustified(8)
+        << QString("moves").rightJustified(14)
+        << QString("est s").rightJustified(18) << endl;
+    int numInconsistent = 0;
+    for (quint64 orbit : orbits) {
+        const QVector<int>& orbitRows = rows[orbit];
+        int numSolved = 0;
+        int minMoves = 0;
+        int maxMoves = 0;
+        double minSeconds = 0.0;
+        double maxSeconds = 0.0;
+        for (int row : orbitRows) {
+            const RunResult& result = m_results.at(row);
+            if (result.status != RunStatus::SOLVED) {
+                continue;
+            }
+            bool isFirst = numSolved == 0;
+            minMoves = isFirst ? result.moves : qMin(minMoves, result.moves);
+            maxMoves = isFirst ? result.moves : qMax(maxMoves, result.moves);
+            minSeconds = isFirst
+                ? result.estimatedSeconds
+                : qMin(minSeconds, result.estimatedSeconds);
+            maxSeconds = isFirst
+                ? result.estimatedSeconds
+                : qMax(maxSeconds, result.estimatedSeconds);
+            numSolved += 1;
+        }
+        QString moves = "-";
+        QString seconds = "-";
+        if (0 < numSolved) {
+            moves = QString("%1-%2").arg(minMoves).arg(maxMoves);
+            seconds = QString("%1-%2").arg(
+                QString::number(minSeconds, 'f', 3),
+                QString::number(maxSeconds, 'f', 3)
+            );
+        }
+        *out << m_rowPaths.at(orbitRows.first()).leftJustified(pathWidth)
+            << "  "
+            << QString::number(orbitRows.size()).rightJustified(8)
+            << QString::number(numSolved).rightJustified(8)
+            << moves.rightJustified(14)
+            << seconds.rightJustified(18);
+
+        // Solving some variants of a maze, but not all of them, is the
+        // clearest sign of an orientation bug
+        if (0 < numSolved && numSolved < orbitRows.size()) {
+            *out << "  inconsistent";
+            numInconsistent += 1;
+        }
+        *out << endl;
+    }
+    *out << "inconsistent: " << numInconsistent << "/" << orbits.size()
+        << " mazes" << endl;
+}
+
+void BatchRunner::printReferences(QTextStream* out, int pathWidth) const {
+
+    // The moves and estimated seconds of every solver, for each valid maze
+    QStringList names = ReferenceSolvers::names();
+    *out << endl << QString("reference").leftJustified(pathWidth);
+    for (const QString& name : names) {
+        *out << "  " << name.rightJustified(20);
+    }
+    *out << endl;
+    for (int i = 0; i < m_results.size(); i += 1) {
+        if (m_references.at(i).isEmpty()) {
+            continue;
+        }
+        *out << m_results.at(i).mazePath.leftJustified(pathWidth);
+        for (const ReferenceResult& reference : m_references.at(i)) {
+            QString cell = "-";
+            if (reference.isSolved) {
+                cell = QString("%1 / %2 s").arg(
+                    QString::number(reference.moves),
+                    QString::number(reference.estimatedSeconds, 'f', 3)
+                );
+            }
+            *out << "  " << cell.rightJustified(20);
+        }
+        *out << endl;
+    }
+
+    // How the algorithm compares with each solver, on average, over the
+    // mazes that both of them solved
+    for (int j = 0; j < names.size(); j += 1) {
+        int numBoth = 0;
+        double totalMovesRatio = 0.0;
+        double totalSecondsRatio = 0.0;
+        for (int i = 0; i < m_results.size(); i += 1) {
+            const RunResult& result = m_results.at(i);
+            if (result.status != RunStatus::SOLVED) {
+                continue;
+            }
+            const ReferenceResult& reference = m_references.at(i).at(j);
+            if (!reference.isSolved || reference.moves == 0) {
+                continue;
+            }
+            numBoth += 1;
+            totalMovesRatio +=
+                static_cast<double>(result.moves) / reference.moves;
+            totalSecondsRatio +=
+                result.estimatedSeconds / reference.estimatedSeconds;
+        }
+        *out << "relative to " << names.at(j) << ": ";
+        if (numBoth == 0) {
+            *out << "no mazes solved by both" << endl;
+            continue;
+        }
+        *out << QString::number(totalMovesRatio / numBoth, 'f', 2)
+            << "x moves, "
+            << QString::number(totalSecondsRatio / numBoth, 'f', 2)
+            << "x estimated seconds, over " << numBoth << " mazes" << endl;
+    }
+}
+
+} 
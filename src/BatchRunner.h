@@ -0,0 +1,193 @@
+#pragma once
+
+#include <memory>
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "BatchMazeLoader.h"
+#include "HeadlessRun.h"
+#include "MazeIndex.h"
+#include "MetricsEndpoint.h"
+#include "MouseDefinition.h"
+#include "ProcessLimits.h"
+#include "ReferenceSolvers.h"
+#include "ResultStore.h"
+
+namespace mms {
+
+class BatchRunner : public QObject {
+
+    // Evaluates a single algorithm against every maze file in a directory,
+    // and against any generated mazes, keeping a fixed number of headless
+    // runs in flight at once. A table of results is printed to stdout once
+    // every run has finished, and each run is appended to a result store as
+    // it finishes, if there is one. If processes are reused, an algorithm
+    // that asks for another maze gets the next one that hasn't been started
+    // yet. A filter, if there is one, narrows the mazes down to those whose
+    // features match it, as found in the corpus's index. Duplicates may be
+    // skipped, i.e., mazes with the same canonical hash as an earlier maze
+    // (see MazeIndex::getCanonicalHash), which are given the result of that
+    // maze instead of being run. Runs may be isolated
+    // from each other by process limits, with pinned runs each on the CPU of
+    // their slot. Plugins (see AlgoPlugin.h) are run in-process, one thread
+    // per slot, and are never isolated, reused or continuous. Mazes are
+    // loaded and solved by the reference solvers ahead of their runs, on
+    // every core (see BatchMazeLoader). A batch may be a contest, in which
+    // case every run is one (see HeadlessRun), and is scored by its rules.
+    // With symmetries, every maze is followed by its mirror and rotation
+    // variants (see MazeSymmetry), each of which is a row of its own, and
+    // the rows of the variants of each maze are also summarized together,
+    // by their orbit hash, so that orientation bugs stand out; duplicates
+    // are then only those with the very same walls, since a transposed
+    // variant is the whole point. A batch may be memoized, like a tournament
+    // (see TournamentRunner), in which case the mazes whose jobs are already
+    // in the store are given the stored result instead of being run.
+
+    Q_OBJECT
+
+public:
+
+    BatchRunner(
+        const QString& algoName,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool useSharedMemory,
+        bool reuseProcesses,
+        bool continuous,
+        const ProcessLimits& processLimits,
+        const QString& storePath,
+        const QVector<MazeIndex::Condition>& filter,
+        bool skipDuplicates,
+        QObject* parent = 0);
+    ~BatchRunner();
+
+    // To be called before the batch starts; every run is reported to the
+    // endpoint as it starts and finishes
+    void setMetrics(MetricsEndpoint* metrics);
+
+    // Likewise; makes every run a contest, with the given rules, which can't
+    // be combined with reused processes
+    void setContestRules(const ContestRules& rules);
+
+    // Likewise; every run's mouse has the definition, a single copy of which
+    // is shared by all of them
+    void setMouseDefinition(std::shared_ptr<const MouseDefinition> definition);
+
+    // Likewise; also runs the variants of every maze
+    void setSymmetries(bool withSymmetries);
+
+    // Likewise, with a store, and without reused processes, whose results
+    // depend on the mazes that came before; reuses the results that the
+    // store already has for any of the jobs
+    void setMemoized(bool isMemoized);
+
+    // Returns false if the batch can't be started at all
+    bool start();
+
+signals:
+
+    void done();
+
+private:
+
+    QString m_algoName;
+    QString m_mazeDirectory;
+    QStringList m_generatedMazes;
+    int m_numJobs;
+    double m_timeLimitSeconds;
+    qint64 m_tickLimit;
+    qint64 m_commandLimit;
+    int m_moveLimit;
+    bool m_useSharedMemory;
+    bool m_reuseProcesses;
+    bool m_continuous;
+    ProcessLimits m_processLimits;
+    QString m_storePath;
+    QVector<MazeIndex::Condition> m_filter;
+    bool m_skipDuplicates;
+    bool m_isContest;
+    ContestRules m_contestRules;
+    std::shared_ptr<const MouseDefinition> m_mouseDefinition;
+    bool m_withSymmetries;
+    bool m_isMemoized;
+
+    QStringList m_runArguments;
+    QString m_directory;
+    bool m_isPlugin;
+    QString m_libraryPath;
+
+    // The mazes are loaded ahead of the runs, on every core; each maze that
+    // is taken is a row of results, whose path is its source's, or that of
+    // the variant of its source
+    QStringList m_mazePaths;
+    BatchMazeLoader* m_loader;
+    int m_numRunning;
+    QStringList m_rowPaths;
+    QVector<RunResult> m_results;
+    QVector<bool> m_isRecorded;
+
+    // The first maze with each canonical hash, and the later mazes that are
+    // waiting for that maze's result, if duplicates are skipped
+    QMap<quint64, int> m_firstMazes;
+    QMap<int, QVector<int>> m_duplicates;
+
+    // One CPU for each slot, for pinned runs, of those not in use
+    QList<int> m_freeCpus;
+
+    MetricsEndpoint* m_metrics;
+
+    // Every run is also appended to the store, if there is one
+    ResultStore* m_store;
+    QVector<quint64> m_mazeHashes;
+
+    // The key of each row's job, zero if there's no store, and the result
+    // of every job in the store, by its key, if memoized
+    QString m_version;
+    QString m_rules;
+    QVector<quint64> m_jobKeys;
+    QHash<quint64, RunResult> m_memoized;
+
+    // Of each row, if there are symmetries (see MazeSymmetry::getOrbitHash)
+    QVector<quint64> m_orbitHashes;
+
+    // The results of every reference solver for each valid maze, against
+    // which the algorithm's results are compared
+    QVector<QVector<ReferenceResult>> m_references;
+
+    // Loads the next valid maze, reporting the invalid ones along the way;
+    // returns false if there are no mazes left
+    bool takeNextMaze(int* index, Maze** maze);
+
+    void startNextRun();
+    void startPluginRun(int index, Maze* maze);
+    void onNextMazeRequested(HeadlessRun* run);
+    void onRunFinished(QObject* run);
+    void recordResult(int index, const RunResult& result);
+    void shareResult(int original, int duplicate);
+    void reuseResult(int index, const RunResult& result);
+
+    // Everything about the batch that could change the result of a run, as
+    // part of the key of every job
+    QString getRules() const;
+
+    // The share of the maze visited before first reaching the center, for
+    // runs that reached it
+    static double getExploredPercent(const RunResult& result);
+    void printResults() const;
+    void printSymmetries(QTextStream* out, int pathWidth) const;
+    void printReferences(QTextStream* out, int pathWidth) const;
+};
+
+} 
@@ -0,0 +1,420 @@
+#include "Benchmark.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtMath>
+
+#include "units/Angle.h"
+#include "units/Coordinate.h"
+#include "units/Distance.h"
+
+#include "AllocationCounter.h"
+#include "Color.h"
+#include "Command.h"
+#include "CommandParser.h"
+#include "Dimensions.h"
+#include "Direction.h"
+#include "DistanceSensors.h"
+#include "LineFramer.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "MazeGraphic.h"
+#include "MazeView.h"
+#include "PathPlanner.h"
+#include "Polygon.h"
+#include "ReferenceSolvers.h"
+#include "SimulationEngine.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+volatile double Benchmark::SINK = 0.0;
+
+bool Benchmark::run(const QString& filter, double minSeconds) {
+    AllocationCounter::setEnabled(true);
+    runUnits(filter, minSeconds);
+    runPolygons(filter, minSeconds);
+    return runMazes(filter, minSeconds);
+}
+
+const QVector<int>& Benchmark::MAZE_SIZES() {
+    static const QVector<int> sizes = {16, 64, 256};
+    return sizes;
+}
+
+void Benchmark::measure(
+        const QString& name,
+        int mazeSize,
+        double minSeconds,
+        const std::function<void(int)>& function) {
+
+    // Warm up, and then double the iterations until the batch is long enough
+    function(1);
+    int iterations = 1;
+    qint64 nanoseconds = 0;
+    AllocationCounts allocations = {0, 0, 0};
+    while (true) {
+        AllocationCounts before = AllocationCounter::getThreadCounts();
+        QElapsedTimer timer;
+        timer.start();
+        function(iterations);
+        nanoseconds = timer.nsecsElapsed();
+        allocations = AllocationCounter::getThreadCountsSince(before);
+        if (minSeconds * 1e9 <= nanoseconds || (1 << 30) <= iterations) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    QJsonObject object;
+    object["name"] = name;
+    object["mazeSize"] = mazeSize == 0 ? QJsonValue() : QJsonValue(mazeSize);
+    object["iterations"] = iterations;
+    object["nanosecondsPerIteration"] =
+        static_cast<double>(nanoseconds) / iterations;
+    if (AllocationCounter::isCompiledIn()) {
+        object["allocationsPerIteration"] =
+            static_cast<double>(allocations.allocations) / iterations;
+        object["bytesPerIteration"] =
+            static_cast<double>(allocations.bytes) / iterations;
+    }
+    else {
+        object["allocationsPerIteration"] = QJsonValue();
+        object["bytesPerIteration"] = QJsonValue();
+    }
+    QTextStream out(stdout);
+    out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+    out.flush();
+}
+
+void Benchmark::runUnits(const QString& filter, double minSeconds) {
+
+    if (QString("units-coordinate").contains(filter)) {
+        measure("units-coordinate", 0, minSeconds, [](int iterations) {
+            Coordinate position;
+            Coordinate step = Coordinate::Cartesian(
+                Distance::Meters(0.001),
+                Distance::Meters(0.002)
+            );
+            for (int i = 0; i < iterations; i += 1) {
+                position = position * 0.5 + step - position / 4.0;
+            }
+            SINK = position.getX().getMeters();
+        });
+    }
+
+    if (QString("units-angle").contains(filter)) {
+        measure("units-angle", 0, minSeconds, [](int iterations) {
+            Angle angle;
+            Angle step = Angle::Degrees(1.0);
+            double sum = 0.0;
+            for (int i = 0; i < iterations; i += 1) {
+                angle += step;
+                double sin;
+                double cos;
+                angle.getSinCos(&sin, &cos);
+                sum += sin + cos;
+            }
+            SINK = sum;
+        });
+    }
+}
+
+void Benchmark::runPolygons(const QString& filter, double minSeconds) {
+
+    // The mouse's body, which is convex, and an arrow, which isn't
+    QVector<Coordinate> convex = {
+        Coordinate::Cartesian(Distance::Meters(0.00), Distance::Meters(0.00)),
+        Coordinate::Cartesian(Distance::Meters(0.00), Distance::Meters(0.06)),
+        Coordinate::Cartesian(Distance::Meters(0.03), Distance::Meters(0.09)),
+        Coordinate::Cartesian(Distance::Meters(0.06), Distance::Meters(0.06)),
+        Coordinate::Cartesian(Distance::Meters(0.06), Distance::Meters(0.00)),
+    };
+    QVector<Coordinate> concave = {
+        Coordinate::Cartesian(Distance::Meters(0.00), Distance::Meters(0.00)),
+        Coordinate::Cartesian(Distance::Meters(0.03), Distance::Meters(0.03)),
+        Coordinate::Cartesian(Distance::Meters(0.06), Distance::Meters(0.00)),
+        Coordinate::Cartesian(Distance::Meters(0.03), Distance::Meters(0.09)),
+    };
+
+    if (QString("polygon-triangulate-convex").contains(filter)) {
+        measure(
+            "polygon-triangulate-convex", 0, minSeconds,
+            [&convex](int iterations) {
+                int count = 0;
+                for (int i = 0; i < iterations; i += 1) {
+                    count += Polygon(convex).getTriangles().size();
+                }
+                SINK = count;
+            }
+        );
+    }
+
+    if (QString("polygon-triangulate-concave").contains(filter)) {
+        measure(
+            "polygon-triangulate-concave", 0, minSeconds,
+            [&concave](int iterations) {
+                int count = 0;
+                for (int i = 0; i < iterations; i += 1) {
+                    count += Polygon(concave).getTriangles().size();
+                }
+                SINK = count;
+            }
+        );
+    }
+
+    if (QString("polygon-transform").contains(filter)) {
+        Polygon polygon(convex);
+        polygon.getTriangles();
+        Coordinate translation = Coordinate::Cartesian(
+            Distance::Meters(0.01),
+            Distance::Meters(0.02)
+        );
+        measure(
+            "polygon-transform", 0, minSeconds,
+            [&polygon, &translation](int iterations) {
+                double sum = 0.0;
+                for (int i = 0; i < iterations; i += 1) {
+                    Polygon moved = polygon.transform(
+                        translation,
+                        Angle::Degrees(i % 360),
+                        translation
+                    );
+                    sum += moved.getVertices().at(0).getX().getMeters();
+                }
+                SINK = sum;
+            }
+        );
+    }
+}
+
+bool Benchmark::runMazes(const QString& filter, double minSeconds) {
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        return false;
+    }
+
+    for (int size : MAZE_SIZES()) {
+
+        WallGrid walls = MazeGenerator::generate(
+            MazeAlgorithm::DFS,
+            size,
+            size,
+            static_cast<quint32>(size)
+        );
+        Maze* maze = Maze::fromWalls(walls);
+        if (maze == nullptr) {
+            return false;
+        }
+
+        // Write the maze in the num and binary formats, to be read back
+        QString numPath = directory.filePath(QString("%1.num").arg(size));
+        QString binaryPath = directory.filePath(QString("%1.mmsb").arg(size));
+        QFile numFile(numPath);
+        if (!numFile.open(QIODevice::WriteOnly)) {
+            delete maze;
+            return false;
+        }
+        QTextStream numStream(&numFile);
+        for (int x = 0; x < size; x += 1) {
+            for (int y = 0; y < size; y += 1) {
+                numStream << x << " " << y;
+                for (Direction direction : DIRECTIONS) {
+                    numStream << " " << (maze->isWall(x, y, direction) ? 1 : 0);
+                }
+                numStream << "\n";
+            }
+        }
+        numStream.flush();
+        numFile.close();
+        if (!maze->toBinaryFile(binaryPath, true)) {
+            delete maze;
+            return false;
+        }
+
+        // Every maze read back must be valid
+        bool ok = true;
+        auto load = [&ok](const QString& path) {
+            Maze* loaded = Maze::fromFile(path);
+            if (loaded == nullptr) {
+                ok = false;
+                return;
+            }
+            SINK = loaded->getDistance(0, 0);
+            delete loaded;
+        };
+
+        if (QString("maze-parse-num").contains(filter)) {
+            measure("maze-parse-num", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    load(numPath);
+                }
+            });
+        }
+
+        if (QString("maze-parse-binary").contains(filter)) {
+            measure("maze-parse-binary", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    load(binaryPath);
+                }
+            });
+        }
+
+        // Validates the walls, and computes all of the distances
+        if (QString("maze-from-walls").contains(filter)) {
+            measure("maze-from-walls", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    Maze* built = Maze::fromWalls(walls);
+                    SINK = built->getDistance(0, 0);
+                    delete built;
+                }
+            });
+        }
+
+        // Fills the tile instance buffer, and the text of every tile
+        if (QString("maze-view").contains(filter)) {
+            measure("maze-view", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    MazeView view(maze);
+                    SINK = view.getGlyphInstanceCpuBuffer()->size();
+                }
+            });
+        }
+
+        // Every kind of tile update, through the buffer interface
+        if (QString("maze-view-update").contains(filter)) {
+            MazeView view(maze);
+            MazeGraphic* graphic = view.getMazeGraphic();
+            measure("maze-view-update", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    for (int x = 0; x < size; x += 1) {
+                        for (int y = 0; y < size; y += 1) {
+                            graphic->setColor(x, y, Color::BLUE);
+                            graphic->setWall(x, y, Direction::NORTH);
+                            graphic->setFog(x, y, false);
+                            graphic->setText(x, y, QString::number(i % 100));
+                        }
+                    }
+                    // As the map would, once per frame
+                    view.publishSnapshot();
+                    bool isNew = false;
+                    SINK = view.takeSnapshot(&isNew).tileDirtyRanges.size();
+                }
+            });
+        }
+
+        // Reads every sensor from the center of each tile, in each direction
+        if (QString("maze-sensors").contains(filter)) {
+            DistanceSensors sensors(&maze->getWalls());
+            QVector<double> readings(sensors.getCount(), 0.0);
+            double tileLength = Dimensions::tileLength().getMeters();
+            measure("maze-sensors", size, minSeconds, [&](int iterations) {
+                double sum = 0.0;
+                for (int i = 0; i < iterations; i += 1) {
+                    int tile = i % (size * size);
+                    sensors.read(
+                        tileLength * (tile / size + 0.5),
+                        tileLength * (tile % size + 0.5),
+                        M_PI / 2.0 * (i % 4),
+                        readings.data()
+                    );
+                    sum += readings.at(0);
+                }
+                SINK = sum;
+            });
+        }
+
+        // Solves the maze with the in-process flood fill solver
+        if (QString("maze-flood-fill").contains(filter)) {
+            measure("maze-flood-fill", size, minSeconds, [&](int iterations) {
+                int moves = 0;
+                for (int i = 0; i < iterations; i += 1) {
+                    moves += ReferenceSolvers::solve("floodFill", maze).moves;
+                }
+                SINK = moves;
+            });
+        }
+
+        // Builds the path planner of the maze's walls
+        if (QString("maze-path-planner").contains(filter)) {
+            measure("maze-path-planner", size, minSeconds, [&](int iterations) {
+                for (int i = 0; i < iterations; i += 1) {
+                    SINK = PathPlanner(maze->getWalls()).getNumNodes();
+                }
+            });
+        }
+
+        // The distance from each cell in turn to the cell across the maze
+        // from it, by the planner
+        if (QString("maze-path-query").contains(filter)) {
+            PathPlanner planner(maze->getWalls());
+            int numCells = size * size;
+            measure("maze-path-query", size, minSeconds, [&](int iterations) {
+                int distance = 0;
+                for (int i = 0; i < iterations; i += 1) {
+                    int cell = i % numCells;
+                    distance += planner.getDistance(
+                        cell, {numCells - 1 - cell});
+                }
+                SINK = distance;
+            });
+        }
+
+        // The round trip of single commands through an instant engine, as
+        // for each line of a headless algorithm's output: framing the line,
+        // parsing it, executing it, with a view to update, and encoding the
+        // response (only setText's text should ever allocate)
+        for (const QString& line : {
+            QString("wallFront"),
+            QString("turnRight"),
+            QString("setColor 1 1 r"),
+            QString("setText 1 1 abc"),
+        }) {
+            QString name = "command-" + line.section(' ', 0, 0);
+            if (!name.contains(filter)) {
+                continue;
+            }
+            MazeView view(maze);
+            SimulationEngine engine(maze, &view);
+            engine.setInstant(true);
+            QByteArray input = (line + "\n").toUtf8();
+            LineFramer framer;
+            QString decoded;
+            QByteArray output;
+            output.reserve(LineFramer::RESERVED_BYTES);
+            measure(name, size, minSeconds, [&](int iterations) {
+                int length = 0;
+                for (int i = 0; i < iterations; i += 1) {
+                    framer.append(input);
+                    framer.nextLine(&decoded);
+                    Command command;
+                    const CommandSpec* spec = CommandParser::parse(
+                        decoded,
+                        &command
+                    );
+                    QString response = engine.executeNow(command, spec);
+                    if (!response.isEmpty()) {
+                        LineFramer::encode(response, &output);
+                        length += output.size();
+                    }
+                }
+                SINK = length;
+            });
+        }
+
+        delete maze;
+        if (!ok) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} 
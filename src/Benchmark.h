@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+
+#include <QString>
+#include <QVector>
+
+namespace mms {
+
+class Benchmark {
+
+    // Times the simulator's hot primitives without a display, and prints one
+    // JSON object per benchmark (and per maze size, for those that depend on
+    // it) to stdout, so that results can be compared across builds; each one
+    // also counts the heap allocations of each iteration (see
+    // AllocationCounter), which should stay at zero wherever they are now
+
+public:
+
+    Benchmark() = delete;
+
+    // Runs every benchmark whose name contains filter, or all of them if
+    // filter is empty, each for at least minSeconds; returns false if a maze
+    // couldn't be written or read back
+    static bool run(const QString& filter, double minSeconds);
+
+    // The widths (and heights) of the mazes used by the maze benchmarks
+    static const QVector<int>& MAZE_SIZES();
+
+private:
+
+    // Calls function with doubling iteration counts, until a batch takes at
+    // least minSeconds, and then reports the mean time (and allocations) per
+    // iteration; a mazeSize of zero means that the benchmark doesn't depend
+    // on one
+    static void measure(
+        const QString& name,
+        int mazeSize,
+        double minSeconds,
+        const std::function<void(int)>& function);
+
+    static void runUnits(const QString& filter, double minSeconds);
+    static void runPolygons(const QString& filter, double minSeconds);
+    static bool runMazes(const QString& filter, double minSeconds);
+
+    // Keeps results alive, so that the work that produces them isn't
+    // optimized away
+    static volatile double SINK;
+
+};
+
+} 
@@ -1,17 +1,38 @@
 #include "BufferInterface.h"
 
-#include "RGB.h"
-#include "SimUtilities.h"
+#include "AssertMacros.h"
 
 namespace mms {
 
+const int BufferInterface::TILE_CHUNK_SIZE = 16;
+const int BufferInterface::GLYPH_COMPACTION_SLACK = 1024;
+
 BufferInterface::BufferInterface(
         QPair<int, int> mazeSize,
-        QVector<TriangleGraphic>* graphicCpuBuffer,
-        QVector<TriangleTexture>* textureCpuBuffer) :
+        QVector<TileInstance>* tileInstanceCpuBuffer,
+        QVector<GlyphInstance>* glyphInstanceCpuBuffer,
+        QVector<DirtyRange>* tileDirtyRanges,
+        QVector<DirtyRange>* tileHeatDirtyRanges,
+        QVector<DirtyRange>* glyphDirtyRanges) :
         m_mazeSize(mazeSize),
-        m_graphicCpuBuffer(graphicCpuBuffer),
-        m_textureCpuBuffer(textureCpuBuffer) {
+        m_tileInstanceCpuBuffer(tileInstanceCpuBuffer),
+        m_glyphInstanceCpuBuffer(glyphInstanceCpuBuffer),
+        m_tileDirtyRanges(tileDirtyRanges),
+        m_tileHeatDirtyRanges(tileHeatDirtyRanges),
+        m_glyphDirtyRanges(glyphDirtyRanges),
+        m_numGlyphs(0) {
+    for (int x = 0; x < m_mazeSize.first; x += TILE_CHUNK_SIZE) {
+        for (int y = 0; y < m_mazeSize.second; y += TILE_CHUNK_SIZE) {
+            int width = qMin(TILE_CHUNK_SIZE, m_mazeSize.first - x);
+            int height = qMin(TILE_CHUNK_SIZE, m_mazeSize.second - y);
+            int begin = getTileGraphicInstanceIndex(x, y);
+            m_tileChunks.append(
+                {x, y, width, height, begin, begin + width * height}
+            );
+        }
+    }
+    m_isTileChunkDirty.fill(false, m_tileChunks.size());
+    m_isTileChunkHeatDirty.fill(false, m_tileChunks.size());
 }
 
 void BufferInterface::initTileGraphicText(
@@ -24,131 +45,312 @@ void BufferInterface::initTileGraphicText(
         wallWidth,
         tileGraphicTextMaxSize
     );
+    m_glyphInstanceCpuBuffer->clear();
+    m_glyphDirtyRanges->clear();
+    m_glyphBlocks.fill(
+        {0, 0, 0, QStringList()},
+        m_mazeSize.first * m_mazeSize.second
+    );
+    m_numGlyphs = 0;
 }
 
 QPair<int, int> BufferInterface::getTileGraphicTextMaxSize() {
     return m_tileGraphicTextCache.getTileGraphicTextMaxSize();
 }
 
-void BufferInterface::insertIntoGraphicCpuBuffer(const Polygon& polygon, Color color, unsigned char alpha) {
-    QVector<TriangleGraphic> tgs = SimUtilities::polygonToTriangleGraphics(polygon, color, alpha);
-    for (int i = 0; i < tgs.size(); i += 1) {
-        m_graphicCpuBuffer->append(tgs.at(i));
+void BufferInterface::allocateTileInstanceCpuBuffer() {
+    m_tileInstanceCpuBuffer->resize(m_mazeSize.first * m_mazeSize.second);
+}
+
+void BufferInterface::writeTileInstance(const TileInstance& instance) {
+    // The buffer was detached when it was resized, so this only ever reads
+    // its reference count, which other threads may do at the same time
+    int index = getTileGraphicInstanceIndex(instance.x, instance.y);
+    m_tileInstanceCpuBuffer->data()[index] = instance;
+}
+
+void BufferInterface::markAllTilesDirty() {
+    for (const TileChunk& chunk : m_tileChunks) {
+        markTileChunkDirty(chunk.x, chunk.y);
     }
 }
 
-void BufferInterface::insertIntoTextureCpuBuffer() {
-    // Here we just insert dummy TriangleTexture objects. All of the actual
-    // values of the objects will be set on calls to the update method.
-    // However, we do intentionally insert the appropriate 'v' values, since
-    // these will never change.
-    TriangleTexture t1 {
-        // x    y    u    v
-        {0.0, 0.0, 0.0, 0.0},
-        {0.0, 0.0, 0.0, 1.0},
-        {0.0, 0.0, 0.0, 1.0},
-    };
-    TriangleTexture t2 {
-        {0.0, 0.0, 0.0, 0.0},
-        {0.0, 0.0, 0.0, 1.0},
-        {0.0, 0.0, 0.0, 0.0},
-    };
-    m_textureCpuBuffer->append(t1);
-    m_textureCpuBuffer->append(t2);
+QVector<TileChunk> BufferInterface::getTileChunks() {
+    return m_tileChunks;
+}
+
+void BufferInterface::clearTileChunksDirty() {
+    for (int i : m_dirtyTileChunks) {
+        m_isTileChunkDirty[i] = false;
+        m_isTileChunkHeatDirty[i] = false;
+    }
+    m_dirtyTileChunks.resize(0);
 }
 
 void BufferInterface::updateTileGraphicBaseColor(int x, int y, Color color) {
-    int index = getTileGraphicBaseStartingIndex(x, y);
-    RGB rgb = COLOR_TO_RGB().value(color);
-    for (int i = 0; i < 2; i += 1) {
-        TriangleGraphic* triangleGraphic = &(*m_graphicCpuBuffer)[index + i];
-        triangleGraphic->p1.rgb = rgb;
-        triangleGraphic->p2.rgb = rgb;
-        triangleGraphic->p3.rgb = rgb;
+    int index = getTileGraphicInstanceIndex(x, y);
+    (*m_tileInstanceCpuBuffer)[index].color = static_cast<unsigned char>(color);
+    markTileChunkDirty(x, y);
+}
+
+void BufferInterface::updateTileGraphicWall(int x, int y, Direction direction, unsigned char level) {
+    ASSERT_LE(level, TileInstance::WALL_LEVEL_DECLARED);
+    int index = getTileGraphicInstanceIndex(x, y);
+    int shift = 2 * DIRECTION_INDEX(direction);
+    unsigned char& walls = (*m_tileInstanceCpuBuffer)[index].walls;
+    walls = static_cast<unsigned char>((walls & ~(3 << shift)) | (level << shift));
+    markTileChunkDirty(x, y);
+}
+
+void BufferInterface::updateTileGraphicFog(int x, int y, bool fog) {
+    int index = getTileGraphicInstanceIndex(x, y);
+    unsigned char& flags = (*m_tileInstanceCpuBuffer)[index].flags;
+    if (fog) {
+        flags |= TileInstance::FLAG_FOG;
     }
+    else {
+        flags &= ~TileInstance::FLAG_FOG;
+    }
+    markTileChunkDirty(x, y);
 }
 
-void BufferInterface::updateTileGraphicWallColor(int x, int y, Direction direction, Color color, unsigned char alpha) {
-    int index = getTileGraphicWallStartingIndex(x, y, direction);
-    RGB rgb = COLOR_TO_RGB().value(color);
-    for (int i = 0; i < 2; i += 1) {
-        TriangleGraphic* triangleGraphic = &(*m_graphicCpuBuffer)[index + i];
-        triangleGraphic->p1.rgb = rgb;
-        triangleGraphic->p2.rgb = rgb;
-        triangleGraphic->p3.rgb = rgb;
-        triangleGraphic->p1.a = alpha;
-        triangleGraphic->p2.a = alpha;
-        triangleGraphic->p3.a = alpha;
+void BufferInterface::updateTileGraphicHeat(int x, int y, int heat) {
+    ASSERT_LE(-1, heat);
+    ASSERT_LE(heat, 255);
+    int index = getTileGraphicInstanceIndex(x, y);
+    TileInstance& instance = (*m_tileInstanceCpuBuffer)[index];
+    if (heat < 0) {
+        instance.flags &= ~TileInstance::FLAG_HEAT;
+        instance.heat = 0;
+    }
+    else {
+        instance.flags |= TileInstance::FLAG_HEAT;
+        instance.heat = static_cast<unsigned char>(heat);
     }
+    markTileChunkHeatDirty(x, y);
 }
 
-void BufferInterface::updateTileGraphicText(int x, int y, int numRows, int numCols, int row, int col, QChar c) {
+void BufferInterface::updateTileGraphicText(int x, int y, const QStringList& rowsOfText) {
+
+    // Most updates change a few characters of text that keeps its shape
+    // (e.g., a distance going from 12 to 13), and the glyphs of the rest of
+    // the text stay where they are
+    GlyphBlock* shaped = &m_glyphBlocks[getTileGraphicInstanceIndex(x, y)];
+    if (isSameShape(shaped->rows, rowsOfText)) {
+        updateGlyphCharacters(shaped, rowsOfText);
+        return;
+    }
+
+    // Spaces are blank, so only the other characters need glyphs; each row
+    // is centered on its own
+    QVector<GlyphInstance> glyphs;
+    int numRows = rowsOfText.size();
+    for (int row = 0; row < numRows; row += 1) {
+        const QString& rowOfText = rowsOfText.at(row);
+        int numCols = rowOfText.size();
+        for (int col = 0; col < numCols; col += 1) {
+            QChar c = rowOfText.at(col);
+            if (c == ' ') {
+                continue;
+            }
+            FontImage::Glyph fontImageCharacterPosition =
+                m_tileGraphicTextCache.getFontImageCharacterPosition(c);
+            const TileGraphicTextCache::TextBox& box =
+                m_tileGraphicTextCache.getTileGraphicTextBox(
+                    numRows, numCols, row, col);
+            glyphs.append({
+                static_cast<unsigned short>(x),
+                static_cast<unsigned short>(y),
+                normalize(box.left),
+                normalize(box.bottom),
+                normalize(box.right),
+                normalize(box.top),
+                normalize(fontImageCharacterPosition.start),
+                normalize(fontImageCharacterPosition.end),
+            });
+        }
+    }
+
+    // Move to a new block at the end if the text doesn't fit
+    GlyphBlock& block = m_glyphBlocks[getTileGraphicInstanceIndex(x, y)];
+    if (block.capacity < glyphs.size()) {
+        clearGlyphs(block.offset, block.offset + block.count);
+        m_numGlyphs -= block.count;
+        block.offset = m_glyphInstanceCpuBuffer->size();
+        block.count = 0;
+        block.capacity = glyphs.size();
+        m_glyphInstanceCpuBuffer->resize(block.offset + block.capacity);
+    }
+
+    // Overwrite the old glyphs, and clear whatever's left of them
+    for (int i = 0; i < glyphs.size(); i += 1) {
+        (*m_glyphInstanceCpuBuffer)[block.offset + i] = glyphs.at(i);
+    }
+    clearGlyphs(block.offset + glyphs.size(), block.offset + block.count);
+    markDirty(
+        m_glyphDirtyRanges,
+        block.offset,
+        block.offset + qMax(glyphs.size(), block.count)
+    );
+    m_numGlyphs += glyphs.size() - block.count;
+    block.count = glyphs.size();
+    block.rows = rowsOfText;
 
-    //    +---------[UR]  [p2]-------[p3]    [p2]
-    //    |         / |    |         /       / |
-    //    |  t1   /   |    |  t1   /       /   |
-    //    |     /     |    |     /       /     |
-    //    |   /   t2  |    |   /       /   t2  |
-    //    | /         |    | /       /         |
-    //   [LL]---------+   [p1]     [p1]------[p3]
+    // Don't let abandoned blocks pile up
+    int numUnused = m_glyphInstanceCpuBuffer->size() - m_numGlyphs;
+    if (m_numGlyphs + GLYPH_COMPACTION_SLACK < numUnused) {
+        compactGlyphs();
+    }
+}
 
-    QPair<double, double> fontImageCharacterPosition =
-        m_tileGraphicTextCache.getFontImageCharacterPosition(c);
+bool BufferInterface::isSameShape(
+        const QStringList& lhs,
+        const QStringList& rhs) {
+    // The same glyphs in the same places, but maybe for other characters
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (int row = 0; row < lhs.size(); row += 1) {
+        const QString& left = lhs.at(row);
+        const QString& right = rhs.at(row);
+        if (left.size() != right.size()) {
+            return false;
+        }
+        for (int col = 0; col < left.size(); col += 1) {
+            if ((left.at(col) == ' ') != (right.at(col) == ' ')) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
-    QPair<Coordinate, Coordinate> LL_UR =
-        m_tileGraphicTextCache.getTileGraphicTextPosition(x, y, numRows, numCols, row, col);
+void BufferInterface::updateGlyphCharacters(
+        GlyphBlock* block,
+        const QStringList& rows) {
+    // Only the texture coordinates of a glyph depend on its character
+    int index = block->offset;
+    for (int row = 0; row < rows.size(); row += 1) {
+        const QString& oldRow = block->rows.at(row);
+        const QString& newRow = rows.at(row);
+        for (int col = 0; col < newRow.size(); col += 1) {
+            QChar c = newRow.at(col);
+            if (c == ' ') {
+                continue;
+            }
+            if (c != oldRow.at(col)) {
+                FontImage::Glyph position =
+                    m_tileGraphicTextCache.getFontImageCharacterPosition(c);
+                GlyphInstance& glyph = (*m_glyphInstanceCpuBuffer)[index];
+                glyph.uLeft = normalize(position.start);
+                glyph.uRight = normalize(position.end);
+                markDirty(m_glyphDirtyRanges, index, index + 1);
+            }
+            index += 1;
+        }
+    }
+    block->rows = rows;
+}
 
-    int triangleTextureIndex = getTileGraphicTextStartingIndex(x, y, row, col);
-    TriangleTexture* t1 = &(*m_textureCpuBuffer)[triangleTextureIndex];
-    TriangleTexture* t2 = &(*m_textureCpuBuffer)[triangleTextureIndex + 1];
+void BufferInterface::markDirty(
+        QVector<DirtyRange>* ranges,
+        int begin,
+        int end) {
+    if (end <= begin) {
+        return;
+    }
+    // Updates tend to come in runs (e.g., every character of a tile's text),
+    // so extending the most recent range catches most of the merging early
+    if (!ranges->isEmpty()) {
+        DirtyRange& last = ranges->last();
+        if (begin <= last.end && last.begin <= end) {
+            last.begin = qMin(last.begin, begin);
+            last.end = qMax(last.end, end);
+            return;
+        }
+    }
+    ranges->append({begin, end});
+}
 
-    t1->p1.x = LL_UR.first.getX().getMeters();
-    t1->p1.y = LL_UR.first.getY().getMeters();
-    t1->p1.u = fontImageCharacterPosition.first;
-    t1->p2.x = LL_UR.first.getX().getMeters();
-    t1->p2.y = LL_UR.second.getY().getMeters();
-    t1->p2.u = fontImageCharacterPosition.first;
-    t1->p3.x = LL_UR.second.getX().getMeters();
-    t1->p3.y = LL_UR.second.getY().getMeters();
-    t1->p3.u = fontImageCharacterPosition.second;
+void BufferInterface::markTileChunkDirty(int x, int y) {
+    int i = getTileChunkIndex(x, y);
+    if (m_isTileChunkDirty.at(i)) {
+        return;
+    }
+    m_isTileChunkDirty[i] = true;
+    m_dirtyTileChunks.append(i);
+    const TileChunk& chunk = m_tileChunks.at(i);
+    m_tileDirtyRanges->append({chunk.begin, chunk.end});
+}
 
-    t2->p1.x = LL_UR.first.getX().getMeters();
-    t2->p1.y = LL_UR.first.getY().getMeters();
-    t2->p1.u = fontImageCharacterPosition.first;
-    t2->p2.x = LL_UR.second.getX().getMeters();
-    t2->p2.y = LL_UR.second.getY().getMeters();
-    t2->p2.u = fontImageCharacterPosition.second;
-    t2->p3.x = LL_UR.second.getX().getMeters();
-    t2->p3.y = LL_UR.first.getY().getMeters();
-    t2->p3.u = fontImageCharacterPosition.second;
+void BufferInterface::markTileChunkHeatDirty(int x, int y) {
+    // A chunk that's already dirty goes out with its heat anyway
+    int i = getTileChunkIndex(x, y);
+    if (m_isTileChunkDirty.at(i) || m_isTileChunkHeatDirty.at(i)) {
+        return;
+    }
+    m_isTileChunkHeatDirty[i] = true;
+    m_dirtyTileChunks.append(i);
+    const TileChunk& chunk = m_tileChunks.at(i);
+    m_tileHeatDirtyRanges->append({chunk.begin, chunk.end});
 }
 
-int BufferInterface::trianglesPerTile() {
-    // This value must be predetermined, and was done so as follows:
-    // Base polygon:      2 (2 triangles x 1 polygon  per tile)
-    // Wall polygon:      8 (2 triangles x 4 polygons per tile)
-    // Corner polygon:    8 (2 triangles x 4 polygons per tile)
-    // --------------------
-    // Total             18
-    return 18;
+int BufferInterface::getTileChunkIndex(int x, int y) {
+    // Chunks are stored column by column, just like their tiles
+    int numChunkRows =
+        (m_mazeSize.second + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    return (x / TILE_CHUNK_SIZE) * numChunkRows + (y / TILE_CHUNK_SIZE);
 }
 
-int BufferInterface::getTileGraphicBaseStartingIndex(int x, int y) {
-    return  0 + trianglesPerTile() * (m_mazeSize.second * x + y);
+int BufferInterface::getTileGraphicInstanceIndex(int x, int y) {
+    // Every column of chunks to the left is TILE_CHUNK_SIZE tiles wide, and
+    // every chunk below in this column is TILE_CHUNK_SIZE tiles high
+    int chunkX = x / TILE_CHUNK_SIZE;
+    int chunkY = y / TILE_CHUNK_SIZE;
+    int width = qMin(
+        TILE_CHUNK_SIZE,
+        m_mazeSize.first - chunkX * TILE_CHUNK_SIZE
+    );
+    int height = qMin(
+        TILE_CHUNK_SIZE,
+        m_mazeSize.second - chunkY * TILE_CHUNK_SIZE
+    );
+    return (
+        chunkX * TILE_CHUNK_SIZE * m_mazeSize.second +
+        chunkY * TILE_CHUNK_SIZE * width +
+        (x % TILE_CHUNK_SIZE) * height +
+        (y % TILE_CHUNK_SIZE)
+    );
 }
 
-int BufferInterface::getTileGraphicWallStartingIndex(int x, int y, Direction direction) {
-    return  2 + trianglesPerTile() * (m_mazeSize.second * x + y) + (2 * DIRECTIONS().indexOf(direction));
+void BufferInterface::clearGlyphs(int begin, int end) {
+    for (int i = begin; i < end; i += 1) {
+        (*m_glyphInstanceCpuBuffer)[i] = {0, 0, 0, 0, 0, 0, 0, 0};
+    }
+    markDirty(m_glyphDirtyRanges, begin, end);
 }
 
-int BufferInterface::getTileGraphicCornerStartingIndex(int x, int y, int cornerNumber) {
-    return 10 + trianglesPerTile() * (m_mazeSize.second * x + y) + (2 * cornerNumber);
+void BufferInterface::compactGlyphs() {
+    // The buffer shrinks, so it'll be uploaded in full anyways
+    QVector<GlyphInstance> compacted;
+    compacted.reserve(m_numGlyphs);
+    for (int i = 0; i < m_glyphBlocks.size(); i += 1) {
+        GlyphBlock& block = m_glyphBlocks[i];
+        int offset = compacted.size();
+        for (int j = 0; j < block.count; j += 1) {
+            compacted.append(m_glyphInstanceCpuBuffer->at(block.offset + j));
+        }
+        block.offset = offset;
+        block.capacity = block.count;
+    }
+    *m_glyphInstanceCpuBuffer = compacted;
+    m_glyphDirtyRanges->clear();
 }
 
-int BufferInterface::getTileGraphicTextStartingIndex(int x, int y, int row, int col) {
-    QPair<int, int> maxRowsAndCols = getTileGraphicTextMaxSize();
-    int triangleTexturesPerTile = 2 * maxRowsAndCols.first * maxRowsAndCols.second;
-    return triangleTexturesPerTile * (m_mazeSize.second * x + y) + 2 * (row * maxRowsAndCols.second + col);
+unsigned short BufferInterface::normalize(double fraction) {
+    return static_cast<unsigned short>(
+        qRound(qBound(0.0, fraction, 1.0) * GlyphInstance::MAX_NORMALIZED)
+    );
 }
 
 } 
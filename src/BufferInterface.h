@@ -1,15 +1,16 @@
 #pragma once
 
-#include <QChar>
 #include <QPair>
+#include <QStringList>
 #include <QVector>
 
 #include "Color.h"
 #include "Direction.h"
-#include "Polygon.h"
+#include "DirtyRange.h"
+#include "GlyphInstance.h"
+#include "TileChunk.h"
 #include "TileGraphicTextCache.h"
-#include "TriangleGraphic.h"
-#include "TriangleTexture.h"
+#include "TileInstance.h"
 
 namespace mms {
 
@@ -17,13 +18,25 @@ class BufferInterface {
 
 public:
 
+    // Tiles are drawn as one instanced mesh: the TileTemplate, shared by
+    // every tile of every maze, plus one small instance record per tile. Tile
+    // text is drawn the same way, as instances of a single quad, but with
+    // records for only the glyphs that are actually shown. Updates only touch
+    // the instance buffers, and record which of their elements changed.
     BufferInterface(
         QPair<int, int> mazeSize,
-        QVector<TriangleGraphic>* graphicCpuBuffer,
-        QVector<TriangleTexture>* textureCpuBuffer);
-
-    // Initializes and caches all possible tile text positions. We need this
-    // extra initialization function since the max size is from the algorithm.
+        QVector<TileInstance>* tileInstanceCpuBuffer,
+        QVector<GlyphInstance>* glyphInstanceCpuBuffer,
+        QVector<DirtyRange>* tileDirtyRanges,
+        QVector<DirtyRange>* tileHeatDirtyRanges,
+        QVector<DirtyRange>* glyphDirtyRanges);
+
+    // Tiles are grouped into square chunks of this many tiles on a side
+    static const int TILE_CHUNK_SIZE;
+
+    // Initializes and caches all possible tile text positions, and forgets
+    // about all glyphs. We need this extra initialization function since the
+    // max size is from the algorithm.
     void initTileGraphicText(
         const Distance& wallLength,
         const Distance& wallWidth,
@@ -32,14 +45,28 @@ public:
     // Returns the maximum number of rows and columns of text in a tile graphic
     QPair<int, int> getTileGraphicTextMaxSize();
 
-    // Fills the graphic cpu buffer and texture cpu buffer
-    void insertIntoGraphicCpuBuffer(const Polygon& polygon, Color color, unsigned char alpha);
-    void insertIntoTextureCpuBuffer();
+    // Makes room for the record of every tile, which can then be written in
+    // any order, e.g., by several threads at once, each writing other tiles;
+    // writing a record doesn't mark it dirty, which is left to the caller
+    void allocateTileInstanceCpuBuffer();
+    void writeTileInstance(const TileInstance& instance);
+    void markAllTilesDirty();
+
+    // Returns the chunks, in the order of their records
+    QVector<TileChunk> getTileChunks();
+
+    // Tile records are marked dirty a whole chunk at a time, and each chunk's
+    // range is recorded only once until the ranges are taken, at which point
+    // this has to be called
+    void clearTileChunksDirty();
 
     // These methods are inexpensive, and may be called many times
     void updateTileGraphicBaseColor(int x, int y, Color color);
-    void updateTileGraphicWallColor(int x, int y, Direction direction, Color color, unsigned char alpha);
-    void updateTileGraphicText(int x, int y, int numRows, int numCols, int row, int col, QChar c);
+    void updateTileGraphicWall(int x, int y, Direction direction, unsigned char level);
+    void updateTileGraphicFog(int x, int y, bool fog);
+    // A heat of -1 hides the tile's heat
+    void updateTileGraphicHeat(int x, int y, int heat);
+    void updateTileGraphicText(int x, int y, const QStringList& rowsOfText);
 
 private:
 
@@ -47,21 +74,56 @@ private:
     QPair<int, int> m_mazeSize;
 
     // CPU-side buffers
-    QVector<TriangleGraphic>* m_graphicCpuBuffer;
-    QVector<TriangleTexture>* m_textureCpuBuffer;
+    QVector<TileInstance>* m_tileInstanceCpuBuffer;
+    QVector<GlyphInstance>* m_glyphInstanceCpuBuffer;
+
+    // Elements of the instance buffers that need re-uploading; tiles whose
+    // heat changed are kept apart from those whose walls, color or fog did,
+    // since the map may put off uploading the heat
+    QVector<DirtyRange>* m_tileDirtyRanges;
+    QVector<DirtyRange>* m_tileHeatDirtyRanges;
+    QVector<DirtyRange>* m_glyphDirtyRanges;
+    void markDirty(QVector<DirtyRange>* ranges, int begin, int end);
+
+    // The chunks, in the order of their records, and which of them have had
+    // their ranges recorded as dirty; updating any number of tiles costs at
+    // most one range per chunk, however scattered the updates are
+    QVector<TileChunk> m_tileChunks;
+    QVector<bool> m_isTileChunkDirty;
+    QVector<bool> m_isTileChunkHeatDirty;
+    QVector<int> m_dirtyTileChunks;
+    void markTileChunkDirty(int x, int y);
+    void markTileChunkHeatDirty(int x, int y);
+    int getTileChunkIndex(int x, int y);
 
     // A cache for tile graphic text information
     TileGraphicTextCache m_tileGraphicTextCache;
 
-    // Retrieve the indices into the graphic cpu buffer,
-    // for each specific type of Tile triangle
-    int trianglesPerTile();
-    int getTileGraphicBaseStartingIndex(int x, int y);
-    int getTileGraphicWallStartingIndex(int x, int y, Direction direction);
-    int getTileGraphicCornerStartingIndex(int x, int y, int cornerNumber);
-
-    // Retrieve the indices into the texture cpu buffer
-    int getTileGraphicTextStartingIndex(int x, int y, int row, int col);
+    // Retrieve the index of a tile's record in the tile instance cpu buffer;
+    // chunks are stored column by column, and so are the tiles within them
+    int getTileGraphicInstanceIndex(int x, int y);
+
+    // Each tile's glyphs are kept together, in a block of the glyph instance
+    // cpu buffer. A tile whose text outgrows its block moves to a new block
+    // at the end, and the buffer is compacted once most of it is unused.
+    // The rows of text that the glyphs show are kept with them, so that
+    // changes that keep the text's shape only rewrite the glyphs that changed.
+    struct GlyphBlock {
+        int offset;
+        int count;
+        int capacity;
+        QStringList rows;
+    };
+    QVector<GlyphBlock> m_glyphBlocks;
+    int m_numGlyphs;
+    static const int GLYPH_COMPACTION_SLACK;
+    void clearGlyphs(int begin, int end);
+    static bool isSameShape(const QStringList& lhs, const QStringList& rhs);
+    void updateGlyphCharacters(GlyphBlock* block, const QStringList& rows);
+    void compactGlyphs();
+
+    // Converts a fraction in [0, 1] to a normalized 16-bit glyph field
+    static unsigned short normalize(double fraction);
 
 };
 
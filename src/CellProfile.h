@@ -0,0 +1,27 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mms {
+
+// Where a run spent its time and its commands, for a single cell. Time and
+// commands go to the cell that the mouse was last in, i.e., to the cell that
+// it's leaving while it moves, and the simulation clock's ticks go to the
+// cell in which each movement began.
+struct CellProfile {
+    double wallSeconds; // of real time, while the mouse was in the cell
+    qint64 ticks; // of the simulation clock, of movements out of the cell
+    qint64 commands; // received while the mouse was in the cell
+    int visits; // entries into the cell, the start counting as one
+};
+
+// Which part of the profile to show as heat (see SimulationEngine)
+enum class ProfileMetric {
+    NONE,
+    WALL_TIME,
+    SIMULATED_TIME,
+    COMMANDS,
+    REVISITS,
+};
+
+} 
@@ -0,0 +1,139 @@
+#include "CollisionDetector.h"
+
+#include "units/Distance.h"
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+
+namespace mms {
+
+CollisionDetector::CollisionDetector(const WallGrid* walls) :
+    m_walls(walls),
+    m_tileLength(Dimensions::tileLength().getMeters()),
+    m_halfWallWidth(Dimensions::halfWallWidth().getMeters()) {
+    ASSERT_FA(m_walls == nullptr);
+}
+
+QVector<Contact> CollisionDetector::check(
+        const Polygon& polygon,
+        QPair<int, int> tile) const {
+
+    QVector<Contact> contacts;
+    const Polygon::Vertices& vertices = polygon.getVertices();
+    int minX = qMax(tile.first - 1, 0);
+    int maxX = qMin(tile.first + 1, m_walls->getWidth() - 1);
+    int minY = qMax(tile.second - 1, 0);
+    int maxY = qMin(tile.second + 1, m_walls->getHeight() - 1);
+
+    for (int x = minX; x <= maxX; x += 1) {
+        for (int y = minY; y <= maxY; y += 1) {
+            int bits = m_walls->getWallBits(x * m_walls->getHeight() + y);
+            for (Direction direction : DIRECTIONS) {
+
+                // Walls shared by two of the tiles are only tested once, as
+                // the east or north wall of the western or southern tile
+                if (
+                    (direction == Direction::WEST && minX < x) ||
+                    (direction == Direction::SOUTH && minY < y) ||
+                    !(bits & (1 << DIRECTION_INDEX(direction)))
+                ) {
+                    continue;
+                }
+
+                // The wall's rectangle, which covers the posts at its ends
+                double left = x * m_tileLength - m_halfWallWidth;
+                double bottom = y * m_tileLength - m_halfWallWidth;
+                double right = (x + 1) * m_tileLength + m_halfWallWidth;
+                double top = (y + 1) * m_tileLength + m_halfWallWidth;
+                switch (direction) {
+                    case Direction::NORTH:
+                        bottom = top - 2 * m_halfWallWidth;
+                        break;
+                    case Direction::EAST:
+                        left = right - 2 * m_halfWallWidth;
+                        break;
+                    case Direction::SOUTH:
+                        top = bottom + 2 * m_halfWallWidth;
+                        break;
+                    case Direction::WEST:
+                        right = left + 2 * m_halfWallWidth;
+                        break;
+                }
+
+                int count = vertices.size();
+                for (int i = 0; i < count; i += 1) {
+                    const Coordinate& a = vertices.at(i);
+                    const Coordinate& b = vertices.at((i + 1) % count);
+                    double middleX = 0.0;
+                    double middleY = 0.0;
+                    if (clip(
+                        a.getX().getMeters(),
+                        a.getY().getMeters(),
+                        b.getX().getMeters(),
+                        b.getY().getMeters(),
+                        left,
+                        bottom,
+                        right,
+                        top,
+                        &middleX,
+                        &middleY
+                    )) {
+                        Coordinate point = Coordinate::Cartesian(
+                            Distance::Meters(middleX),
+                            Distance::Meters(middleY)
+                        );
+                        contacts.append({x, y, direction, point});
+                    }
+                }
+            }
+        }
+    }
+
+    return contacts;
+}
+
+bool CollisionDetector::clip(
+        double x0,
+        double y0,
+        double x1,
+        double y1,
+        double minX,
+        double minY,
+        double maxX,
+        double maxY,
+        double* middleX,
+        double* middleY) {
+
+    // The part of the segment within the rectangle is [enter, exit], as
+    // fractions of the way from one end to the other
+    double dx = x1 - x0;
+    double dy = y1 - y0;
+    double p[4] = {-dx, dx, -dy, dy};
+    double q[4] = {x0 - minX, maxX - x0, y0 - minY, maxY - y0};
+    double enter = 0.0;
+    double exit = 1.0;
+    for (int i = 0; i < 4; i += 1) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) {
+                return false;
+            }
+            continue;
+        }
+        double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            enter = qMax(enter, t);
+        }
+        else {
+            exit = qMin(exit, t);
+        }
+    }
+    if (exit < enter) {
+        return false;
+    }
+    double middle = (enter + exit) / 2.0;
+    *middleX = x0 + middle * dx;
+    *middleY = y0 + middle * dy;
+    return true;
+}
+
+} 
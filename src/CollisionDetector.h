@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+#include "units/Coordinate.h"
+
+#include "Direction.h"
+#include "Polygon.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+// A point at which a polygon overlaps a wall, and which wall that is (by a
+// cell that it borders, and its direction from that cell)
+struct Contact {
+    int x;
+    int y;
+    Direction direction;
+    Coordinate point;
+};
+
+class CollisionDetector {
+
+    // Tests polygons against the walls, treated as rectangles of the wall
+    // width that extend over the posts at either end. Only the walls of the
+    // 3x3 tiles around a given tile are tested, so the cost of a test never
+    // depends on the size of the maze; the polygon must fit within them
+    // (which the mouse always does, around the tile that it's in).
+
+public:
+
+    // No ownership of the walls - only a pointer
+    CollisionDetector(const WallGrid* walls);
+
+    // Every place where an edge of the polygon enters a wall around the given
+    // tile, at the middle of the part of the edge that's within the wall; an
+    // edge that crosses several walls has a contact with each of them
+    QVector<Contact> check(
+        const Polygon& polygon,
+        QPair<int, int> tile) const;
+
+private:
+
+    const WallGrid* m_walls;
+    double m_tileLength;
+    double m_halfWallWidth;
+
+    // Clips the segment from (x0, y0) to (x1, y1) to the rectangle, and sets
+    // the middle of what's left; false if nothing is left (Liang-Barsky)
+    static bool clip(
+        double x0,
+        double y0,
+        double x1,
+        double y1,
+        double minX,
+        double minY,
+        double maxX,
+        double maxY,
+        double* middleX,
+        double* middleY);
+};
+
+} 
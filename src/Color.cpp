@@ -1,51 +1,68 @@
 #include "Color.h"
 
+#include "AssertMacros.h"
+
 namespace mms {
 
-const QMap<QChar, Color>& CHAR_TO_COLOR() {
-    static const QMap<QChar, Color> map = {
-        {'k', Color::BLACK},
-        {'b', Color::BLUE},
-        {'a', Color::GRAY},
-        {'c', Color::CYAN},
-        {'g', Color::GREEN},
-        {'o', Color::ORANGE},
-        {'r', Color::RED},
-        {'w', Color::WHITE},
-        {'y', Color::YELLOW},
-        {'B', Color::DARK_BLUE},
-        {'C', Color::DARK_CYAN},
-        {'A', Color::DARK_GRAY},
-        {'G', Color::DARK_GREEN},
-        {'O', Color::DARK_ORANGE},
-        {'R', Color::DARK_RED},
-        {'V', Color::DARK_VIOLET},
-        {'Y', Color::DARK_YELLOW},
-    };
-    return map;
+namespace {
+
+// The character of each color, indexed by color
+constexpr char COLOR_CHARS[NUM_COLORS + 1] = "kbcagorwyBCAGORVY";
+
+// The components of each color, indexed by color
+constexpr RGB COLOR_RGBS[NUM_COLORS] = {
+    /* BLACK       */ {  0,   0,   0},
+    /* BLUE        */ {  0,   0, 179},
+    /* CYAN        */ {  0, 102, 102},
+    /* GRAY        */ {179, 179, 179},
+    /* GREEN       */ {  0, 179,   0},
+    /* ORANGE      */ {179, 102,   0},
+    /* RED         */ {204,   0,   0},
+    /* WHITE       */ {255, 255, 255},
+    /* YELLOW      */ {179, 179,   0},
+    /* DARK_BLUE   */ {  0,   0,  51},
+    /* DARK_CYAN   */ {  0,  51,  51},
+    /* DARK_GRAY   */ { 26,  26,  26},
+    /* DARK_GREEN  */ {  0,  77,   0},
+    /* DARK_ORANGE */ { 51,  26,   0},
+    /* DARK_RED    */ { 77,   0,   0},
+    /* DARK_VIOLET */ { 51,   0,  51},
+    /* DARK_YELLOW */ { 51,  51,   0},
+};
+
+// The color of each ASCII character, or -1 if it doesn't name a color
+const int NUM_CHARS = 128;
+struct CharTable {
+    signed char colors[NUM_CHARS];
+    CharTable() {
+        for (int i = 0; i < NUM_CHARS; i += 1) {
+            colors[i] = -1;
+        }
+        for (int i = 0; i < NUM_COLORS; i += 1) {
+            colors[static_cast<int>(COLOR_CHARS[i])] = i;
+        }
+    }
+};
+
+const CharTable& charTable() {
+    static const CharTable table;
+    return table;
+}
+
+} 
+
+bool IS_COLOR_CHAR(QChar c) {
+    ushort code = c.unicode();
+    return code < NUM_CHARS && charTable().colors[code] != -1;
+}
+
+Color CHAR_TO_COLOR(QChar c) {
+    ASSERT_TR(IS_COLOR_CHAR(c));
+    return static_cast<Color>(charTable().colors[c.unicode()]);
 }
 
-const QMap<Color, RGB>& COLOR_TO_RGB() {
-    static const QMap<Color, RGB> map = {
-        {Color::BLACK      , {  0,   0,   0}},
-        {Color::BLUE       , {  0,   0, 179}},
-        {Color::CYAN       , {  0, 102, 102}},
-        {Color::GRAY       , {179, 179, 179}},
-        {Color::GREEN      , {  0, 179,   0}},
-        {Color::ORANGE     , {179, 102,   0}},
-        {Color::RED        , {204,   0,   0}},
-        {Color::WHITE      , {255, 255, 255}},
-        {Color::YELLOW     , {179, 179,   0}},
-        {Color::DARK_BLUE  , {  0,   0,  51}},
-        {Color::DARK_CYAN  , {  0,  51,  51}},
-        {Color::DARK_GRAY  , { 26,  26,  26}},
-        {Color::DARK_GREEN , {  0,  77,   0}},
-        {Color::DARK_ORANGE, { 51,  26,   0}},
-        {Color::DARK_RED   , { 77,   0,   0}},
-        {Color::DARK_VIOLET, { 51,   0,  51}},
-        {Color::DARK_YELLOW, { 51,  51,   0}},
-    };
-    return map;
+RGB COLOR_TO_RGB(Color color) {
+    return COLOR_RGBS[static_cast<int>(color)];
 }
 
 } 
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <QChar>
-#include <QMap>
 
 #include "RGB.h"
 
 namespace mms {
 
+// The value of each color is its index in the color tables (and in the tile
+// program's palette), so they must stay numbered from zero
 enum class Color {
     BLACK,
     BLUE,
@@ -27,7 +28,12 @@ enum class Color {
     DARK_YELLOW,
 };
 
-const QMap<QChar, Color>& CHAR_TO_COLOR();
-const QMap<Color, RGB>& COLOR_TO_RGB();
+const int NUM_COLORS = static_cast<int>(Color::DARK_YELLOW) + 1;
+
+// Colors are looked up in arrays, indexed by color or by (ASCII) character,
+// since this is done for every color command and every tile color update
+bool IS_COLOR_CHAR(QChar c);
+Color CHAR_TO_COLOR(QChar c);
+RGB COLOR_TO_RGB(Color color);
 
 } 
@@ -0,0 +1,74 @@
+#include "Command.h"
+
+namespace mms {
+
+const QVector<CommandSpec>& COMMAND_SPECS() {
+    static const QVector<CommandSpec> vector = {
+        {"hello", Opcode::HELLO, {}, true},
+        {"mazeWidth", Opcode::MAZE_WIDTH, {}, true},
+        {"mazeHeight", Opcode::MAZE_HEIGHT, {}, true},
+        {"wallFront", Opcode::WALL_FRONT, {}, true},
+        {"wallRight", Opcode::WALL_RIGHT, {}, true},
+        {"wallLeft", Opcode::WALL_LEFT, {}, true},
+        {"walls", Opcode::WALLS, {}, true},
+        {"moveForward", Opcode::MOVE_FORWARD, {ArgType::OPTIONAL_INT}, true},
+        {"turnRight", Opcode::TURN_RIGHT, {}, true},
+        {"turnLeft", Opcode::TURN_LEFT, {}, true},
+        {"curveRight", Opcode::CURVE_RIGHT, {}, true},
+        {"curveLeft", Opcode::CURVE_LEFT, {}, true},
+        {"curveRight180", Opcode::CURVE_RIGHT_180, {}, true},
+        {"curveLeft180", Opcode::CURVE_LEFT_180, {}, true},
+        {"diagonalRight", Opcode::DIAGONAL_RIGHT, {ArgType::INT}, true},
+        {"diagonalLeft", Opcode::DIAGONAL_LEFT, {ArgType::INT}, true},
+        {"runPath", Opcode::RUN_PATH, {ArgType::TEXT}, true},
+        {"setWall", Opcode::SET_WALL,
+            {ArgType::INT, ArgType::INT, ArgType::DIRECTION}, false},
+        {"clearWall", Opcode::CLEAR_WALL,
+            {ArgType::INT, ArgType::INT, ArgType::DIRECTION}, false},
+        {"setWalls", Opcode::SET_WALLS,
+            {ArgType::INT, ArgType::INT, ArgType::INT}, false},
+        {"setWallRow", Opcode::SET_WALL_ROW,
+            {ArgType::INT, ArgType::TEXT}, false},
+        {"setColor", Opcode::SET_COLOR,
+            {ArgType::INT, ArgType::INT, ArgType::COLOR}, false},
+        {"clearColor", Opcode::CLEAR_COLOR,
+            {ArgType::INT, ArgType::INT}, false},
+        {"clearAllColor", Opcode::CLEAR_ALL_COLOR, {}, false},
+        {"setColorRect", Opcode::SET_COLOR_RECT,
+            {ArgType::INT, ArgType::INT, ArgType::INT, ArgType::INT,
+             ArgType::COLOR}, false},
+        {"setColorGrid", Opcode::SET_COLOR_GRID, {ArgType::TEXT}, false},
+        {"setText", Opcode::SET_TEXT,
+            {ArgType::INT, ArgType::INT, ArgType::TEXT}, false},
+        {"clearText", Opcode::CLEAR_TEXT,
+            {ArgType::INT, ArgType::INT}, false},
+        {"clearAllText", Opcode::CLEAR_ALL_TEXT, {}, false},
+        {"setTextRow", Opcode::SET_TEXT_ROW,
+            {ArgType::INT, ArgType::TEXT}, false},
+        {"setHeat", Opcode::SET_HEAT,
+            {ArgType::INT, ArgType::INT, ArgType::INT}, false},
+        {"setHeatRow", Opcode::SET_HEAT_ROW,
+            {ArgType::INT, ArgType::TEXT}, false},
+        {"clearAllHeat", Opcode::CLEAR_ALL_HEAT, {}, false},
+        {"wasReset", Opcode::WAS_RESET, {}, true},
+        {"ackReset", Opcode::ACK_RESET, {}, true},
+        {"nextMaze", Opcode::NEXT_MAZE, {}, true},
+        {"asyncMoves", Opcode::ASYNC_MOVES, {}, true},
+        {"pushSensors", Opcode::PUSH_SENSORS, {}, true},
+    };
+    return vector;
+}
+
+const QHash<QStringRef, const CommandSpec*>& COMMAND_TABLE() {
+    // The keys refer to the names in COMMAND_SPECS(), which is never modified
+    static const QHash<QStringRef, const CommandSpec*> table = [](){
+        QHash<QStringRef, const CommandSpec*> hash;
+        for (const CommandSpec& spec : COMMAND_SPECS()) {
+            hash.insert(QStringRef(&spec.name), &spec);
+        }
+        return hash;
+    }();
+    return table;
+}
+
+} 
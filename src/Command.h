@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QChar>
+#include <QHash>
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+
+namespace mms {
+
+// Traces store opcodes by value, so new opcodes go at the end
+enum class Opcode {
+    MAZE_WIDTH,
+    MAZE_HEIGHT,
+    WALL_FRONT,
+    WALL_RIGHT,
+    WALL_LEFT,
+    WALLS,
+    MOVE_FORWARD,
+    TURN_RIGHT,
+    TURN_LEFT,
+    SET_WALL,
+    CLEAR_WALL,
+    SET_COLOR,
+    CLEAR_COLOR,
+    CLEAR_ALL_COLOR,
+    SET_TEXT,
+    CLEAR_TEXT,
+    CLEAR_ALL_TEXT,
+    WAS_RESET,
+    ACK_RESET,
+    NEXT_MAZE,
+    CURVE_RIGHT,
+    CURVE_LEFT,
+    CURVE_RIGHT_180,
+    CURVE_LEFT_180,
+    DIAGONAL_RIGHT,
+    DIAGONAL_LEFT,
+    SET_COLOR_RECT,
+    SET_TEXT_ROW,
+    SET_COLOR_GRID,
+    SET_HEAT,
+    SET_HEAT_ROW,
+    CLEAR_ALL_HEAT,
+    ASYNC_MOVES,
+    RUN_PATH,
+    PUSH_SENSORS,
+    SET_WALLS,
+    SET_WALL_ROW,
+    HELLO,
+};
+
+const int NUM_OPCODES = static_cast<int>(Opcode::HELLO) + 1;
+
+enum class ArgType {
+    INT,
+    // May be omitted; only other optional arguments may follow it
+    OPTIONAL_INT,
+    DIRECTION,
+    COLOR,
+    // Everything after the separator that follows the previous argument,
+    // spaces included; must be the last argument
+    TEXT,
+};
+
+struct CommandSpec {
+    QString name;
+    Opcode opcode;
+    QVector<ArgType> argTypes;
+    // Commands without a response are performed as soon as they're received,
+    // commands with a response are queued behind any movement in progress
+    bool hasResponse;
+};
+
+// A fully parsed command; arguments are stored in the order they appear,
+// grouped by type, so e.g. "setWall 1 2 n" has ints {1, 2} and character 'n'
+struct Command {
+    static const int MAX_INTS = 4;
+    Opcode opcode;
+    int ints[MAX_INTS];
+    int numInts;
+    QChar character;
+    QString text;
+};
+
+// Every command in the mouse API, in the order they're documented
+const QVector<CommandSpec>& COMMAND_SPECS();
+
+// Looks up a command specification by name without copying the name
+const QHash<QStringRef, const CommandSpec*>& COMMAND_TABLE();
+
+} 
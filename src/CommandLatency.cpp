@@ -0,0 +1,104 @@
+#include "CommandLatency.h"
+
+namespace mms {
+
+const QVector<QString> CommandLatency::LEG_NAMES = {
+    "intake",
+    "queued",
+    "execution",
+    "total",
+};
+
+CommandLatency::CommandLatency() :
+    m_histograms(
+        NUM_OPCODES,
+        QVector<LatencyHistogram>(NUM_LEGS)) {
+}
+
+void CommandLatency::record(
+        Opcode opcode,
+        double receivedTimestamp,
+        double dispatchedTimestamp,
+        double startedTimestamp,
+        double respondedTimestamp) {
+    QVector<LatencyHistogram>& legs =
+        m_histograms[static_cast<int>(opcode)];
+    legs[INTAKE].record(dispatchedTimestamp - receivedTimestamp);
+    legs[QUEUED].record(startedTimestamp - dispatchedTimestamp);
+    legs[EXECUTION].record(respondedTimestamp - startedTimestamp);
+    legs[TOTAL].record(respondedTimestamp - receivedTimestamp);
+}
+
+void CommandLatency::clear() {
+    for (QVector<LatencyHistogram>& legs : m_histograms) {
+        for (LatencyHistogram& histogram : legs) {
+            histogram.clear();
+        }
+    }
+}
+
+QString CommandLatency::toTable() const {
+    QString table = QString("command").leftJustified(14) +
+        QString("count").rightJustified(9);
+    for (const QString& name : LEG_NAMES) {
+        table += "  " + name.leftJustified(26);
+    }
+    table += "\n" + QString().leftJustified(23);
+    for (int i = 0; i < NUM_LEGS; i += 1) {
+        table += "  " + QString("p50").rightJustified(8) +
+            QString("p99").rightJustified(9) +
+            QString("max").rightJustified(9);
+    }
+    table += "\n";
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        const QVector<LatencyHistogram>& legs =
+            m_histograms.at(static_cast<int>(spec.opcode));
+        if (legs.at(TOTAL).getCount() == 0) {
+            continue;
+        }
+        table += spec.name.leftJustified(14) +
+            QString::number(legs.at(TOTAL).getCount()).rightJustified(9);
+        for (const LatencyHistogram& histogram : legs) {
+            table += "  " +
+                QString::number(
+                    histogram.getPercentileSeconds(0.5) * 1000, 'f', 2
+                ).rightJustified(8) +
+                QString::number(
+                    histogram.getPercentileSeconds(0.99) * 1000, 'f', 2
+                ).rightJustified(9) +
+                QString::number(
+                    histogram.getMaxSeconds() * 1000, 'f', 2
+                ).rightJustified(9);
+        }
+        table += "\n";
+    }
+    return table;
+}
+
+const LatencyHistogram& CommandLatency::getTotal(Opcode opcode) const {
+    return m_histograms.at(static_cast<int>(opcode)).at(TOTAL);
+}
+
+QJsonObject CommandLatency::toJson() const {
+    QJsonObject object;
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        const QVector<LatencyHistogram>& legs =
+            m_histograms.at(static_cast<int>(spec.opcode));
+        if (legs.at(TOTAL).getCount() == 0) {
+            continue;
+        }
+        QJsonObject command;
+        command["count"] = legs.at(TOTAL).getCount();
+        for (int i = 0; i < NUM_LEGS; i += 1) {
+            QJsonObject leg;
+            leg["p50"] = legs.at(i).getPercentileSeconds(0.5);
+            leg["p99"] = legs.at(i).getPercentileSeconds(0.99);
+            leg["max"] = legs.at(i).getMaxSeconds();
+            command[LEG_NAMES.at(i)] = leg;
+        }
+        object[spec.name] = command;
+    }
+    return object;
+}
+
+} 
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include "Command.h"
+#include "LatencyHistogram.h"
+
+namespace mms {
+
+class CommandLatency {
+
+    // Histograms of how long each kind of command spends on each leg of its
+    // round trip, from the moment its line is read from the algorithm:
+    //
+    // - intake: until it's handed to the engine
+    // - queued: until the engine starts to execute it, i.e., while it waits
+    //   behind earlier commands and their movements (or a pause)
+    // - execution: until its response is sent, including its own movement
+    // - total: the whole round trip
+    //
+    // Commands without a response are performed as soon as they're handed
+    // to the engine, so only their intake counts.
+
+public:
+
+    CommandLatency();
+
+    void record(
+        Opcode opcode,
+        double receivedTimestamp,
+        double dispatchedTimestamp,
+        double startedTimestamp,
+        double respondedTimestamp);
+    void clear();
+
+    // A fixed-width table with the count, and the p50, p99 and max of every
+    // leg in milliseconds, for every kind of command that was recorded
+    QString toTable() const;
+
+    // The same, as an object keyed by command name and then by leg
+    QJsonObject toJson() const;
+
+    // The whole round trip of the given kind of command
+    const LatencyHistogram& getTotal(Opcode opcode) const;
+
+private:
+
+    enum Leg {
+        INTAKE,
+        QUEUED,
+        EXECUTION,
+        TOTAL,
+        NUM_LEGS,
+    };
+    static const QVector<QString> LEG_NAMES;
+
+    // Indexed by opcode, then by leg
+    QVector<QVector<LatencyHistogram>> m_histograms;
+};
+
+} 
@@ -0,0 +1,95 @@
+#include "CommandParser.h"
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "Direction.h"
+
+namespace mms {
+
+const CommandSpec* CommandParser::parse(const QString& line, Command* command) {
+
+    ASSERT_FA(command == nullptr);
+
+    int position = 0;
+    QStringRef name = nextToken(line, &position);
+    const CommandSpec* spec = COMMAND_TABLE().value(name, nullptr);
+    if (spec == nullptr) {
+        return nullptr;
+    }
+    command->opcode = spec->opcode;
+
+    command->numInts = 0;
+    for (ArgType type : spec->argTypes) {
+
+        // The text argument is the rest of the line after a single separator
+        if (type == ArgType::TEXT) {
+            if (position >= line.size()) {
+                return nullptr;
+            }
+            command->text = line.mid(position + 1);
+            return spec;
+        }
+
+        QStringRef token = nextToken(line, &position);
+        if (token.isEmpty()) {
+            if (type == ArgType::OPTIONAL_INT) {
+                break;
+            }
+            return nullptr;
+        }
+        switch (type) {
+            case ArgType::INT:
+            case ArgType::OPTIONAL_INT: {
+                ASSERT_LT(command->numInts, Command::MAX_INTS);
+                bool ok = false;
+                command->ints[command->numInts] = token.toInt(&ok);
+                if (!ok) {
+                    return nullptr;
+                }
+                command->numInts += 1;
+                break;
+            }
+            case ArgType::DIRECTION:
+                if (token.size() != 1) {
+                    return nullptr;
+                }
+                if (!IS_DIRECTION_CHAR(token.at(0).toLatin1())) {
+                    return nullptr;
+                }
+                command->character = token.at(0);
+                break;
+            case ArgType::COLOR:
+                if (token.size() != 1) {
+                    return nullptr;
+                }
+                if (!IS_COLOR_CHAR(token.at(0))) {
+                    return nullptr;
+                }
+                command->character = token.at(0);
+                break;
+            default:
+                ASSERT_NEVER_RUNS();
+        }
+    }
+
+    // Trailing tokens mean the arity is wrong
+    if (!nextToken(line, &position).isEmpty()) {
+        return nullptr;
+    }
+    return spec;
+}
+
+QStringRef CommandParser::nextToken(const QString& line, int* position) {
+    int start = *position;
+    while (start < line.size() && line.at(start) == ' ') {
+        start += 1;
+    }
+    int end = start;
+    while (end < line.size() && line.at(end) != ' ') {
+        end += 1;
+    }
+    *position = end;
+    return line.midRef(start, end - start);
+}
+
+} 
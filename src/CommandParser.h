@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QStringRef>
+
+#include "Command.h"
+
+namespace mms {
+
+class CommandParser {
+
+public:
+
+    // The CommandParser class is not constructible
+    CommandParser() = delete;
+
+    // Parses a single line of algorithm output in one pass, without splitting
+    // it into a list of strings; returns nullptr if the line isn't a valid
+    // command, otherwise the spec of the command that was parsed
+    static const CommandSpec* parse(const QString& line, Command* command);
+
+private:
+
+    // Returns the next space-separated token at or after *position, and
+    // advances *position to the character just after it
+    static QStringRef nextToken(const QString& line, int* position);
+
+};
+
+} 
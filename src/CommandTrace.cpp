@@ -0,0 +1,620 @@
+#include "CommandTrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const QByteArray CommandTrace::MAGIC = "MMST";
+const quint16 CommandTrace::VERSION = 3;
+const QByteArray CommandTrace::BLOCK_MAGIC = "MMTB";
+const int CommandTrace::BLOCK_SIZE = 256 * 1024;
+const int CommandTrace::HEADER_SIZE = 8;
+const int CommandTrace::BLOCK_HEADER_SIZE = 4 + 4 + 4 + 8 + 4 + 4;
+const int CommandTrace::FLUSH_MS = 1000;
+const int CommandTrace::TAG_RUN = 0;
+const int CommandTrace::TAG_RESPONSE = 1;
+const int CommandTrace::TAG_COMMAND = 2;
+
+CommandTraceWriter::CommandTraceWriter(QFile* file) : m_file(file) {
+}
+
+CommandTraceWriter::~CommandTraceWriter() {
+    delete m_file;
+}
+
+void CommandTraceWriter::writeBlock(
+        const QByteArray& records,
+        qint64 firstCommand,
+        int numCommands,
+        int numRuns) {
+    if (records.isEmpty()) {
+        return;
+    }
+    QByteArray compressed = qCompress(records);
+    QByteArray header = CommandTrace::BLOCK_MAGIC;
+    CommandTrace::appendNumber(&header, compressed.size(), 4);
+    CommandTrace::appendNumber(&header, records.size(), 4);
+    CommandTrace::appendNumber(&header, firstCommand, 8);
+    CommandTrace::appendNumber(&header, numCommands, 4);
+    CommandTrace::appendNumber(&header, numRuns, 4);
+    m_file->write(header);
+    m_file->write(compressed);
+    m_file->flush();
+}
+
+TraceFile::TraceFile() :
+    m_memory(nullptr),
+    m_data(nullptr),
+    m_size(0),
+    m_numCommands(0),
+    m_end(0),
+    m_decodedBlock(-1) {
+}
+
+TraceFile::~TraceFile() {
+    if (m_memory != nullptr) {
+        m_file.unmap(m_memory);
+    }
+}
+
+qint64 TraceFile::getNumCommands() const {
+    return m_numCommands;
+}
+
+Command TraceFile::getCommand(qint64 index) const {
+    ASSERT_LE(0, index);
+    ASSERT_LT(index, m_numCommands);
+
+    // The last block that starts at or before the command holds it, since
+    // a block without commands starts where the next one does
+    if (
+        m_decodedBlock == -1 ||
+        index < m_blocks.at(m_decodedBlock).firstCommand ||
+        m_blocks.at(m_decodedBlock).firstCommand +
+            m_blocks.at(m_decodedBlock).numCommands <= index
+    ) {
+        auto it = std::upper_bound(
+            m_blocks.constBegin(),
+            m_blocks.constEnd(),
+            index,
+            [](qint64 index, const Block& block) {
+                return index < block.firstCommand;
+            }
+        );
+        int decoded = static_cast<int>(it - m_blocks.constBegin()) - 1;
+        const Block& block = m_blocks.at(decoded);
+        m_decodedCommands.clear();
+        m_decodedCommands.reserve(block.numCommands);
+        int numCommands = 0;
+        int numRuns = 0;
+        readBlock(block, &m_decodedCommands, nullptr, &numCommands, &numRuns);
+        ASSERT_EQ(numCommands, block.numCommands);
+        m_decodedBlock = decoded;
+    }
+    const Block& block = m_blocks.at(m_decodedBlock);
+    return m_decodedCommands.at(static_cast<int>(index - block.firstCommand));
+}
+
+bool TraceFile::load(const QString& path, QVector<TraceRun>* runs) {
+
+    // Files that can't be mapped are read in one go, as they used to be
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    if (!m_file.isSequential() && 0 < m_size) {
+        m_memory = m_file.map(0, m_size);
+    }
+    if (m_memory != nullptr) {
+        m_data = reinterpret_cast<const char*>(m_memory);
+    }
+    else {
+        m_bytes = m_file.readAll();
+        m_data = m_bytes.constData();
+        m_size = m_bytes.size();
+    }
+    const QByteArray& magic = CommandTrace::MAGIC;
+    if (
+        m_size < CommandTrace::HEADER_SIZE ||
+        std::memcmp(m_data, magic.constData(), magic.size()) != 0
+    ) {
+        return false;
+    }
+    quint64 version = CommandTrace::readNumber(m_data + magic.size(), 2);
+    if (version != CommandTrace::VERSION || !loadBlocks()) {
+        return false;
+    }
+
+    // Only the blocks in which runs start are read
+    runs->clear();
+    for (const Block& block : m_blocks) {
+        if (block.numRuns == 0) {
+            continue;
+        }
+        int numCommands = 0;
+        int numRuns = 0;
+        readBlock(block, nullptr, runs, &numCommands, &numRuns);
+    }
+
+    // Commands without a run belong to a maze that's unknown
+    if (runs->isEmpty() ? 0 < m_numCommands : 0 < runs->first().firstCommand) {
+        runs->prepend({QString(), nullptr, 0, 0});
+    }
+    for (int i = 0; i < runs->size(); i += 1) {
+        qint64 end = i + 1 < runs->size()
+            ? runs->at(i + 1).firstCommand
+            : m_numCommands;
+        qint64 numCommands = end - runs->at(i).firstCommand;
+        if (
+            numCommands < 0 ||
+            std::numeric_limits<int>::max() < numCommands
+        ) {
+            return false;
+        }
+        (*runs)[i].numCommands = static_cast<int>(numCommands);
+    }
+    return true;
+}
+
+bool TraceFile::loadBlocks() {
+
+    // Each block's header says where the next one starts; a block that's
+    // cut off, which can only be the last one, is ignored
+    qint64 offset = CommandTrace::HEADER_SIZE;
+    const QByteArray& blockMagic = CommandTrace::BLOCK_MAGIC;
+    quint64 maxNumber = std::numeric_limits<int>::max();
+    while (CommandTrace::BLOCK_HEADER_SIZE <= m_size - offset) {
+        const char* header = m_data + offset;
+        if (
+            std::memcmp(header, blockMagic.constData(), blockMagic.size()) != 0
+        ) {
+            return false;
+        }
+        quint64 compressedSize = CommandTrace::readNumber(header + 4, 4);
+        quint64 size = CommandTrace::readNumber(header + 8, 4);
+        quint64 firstCommand = CommandTrace::readNumber(header + 12, 8);
+        quint64 numCommands = CommandTrace::readNumber(header + 20, 4);
+        quint64 numRuns = CommandTrace::readNumber(header + 24, 4);
+        if (
+            compressedSize == 0 ||
+            maxNumber < compressedSize ||
+            maxNumber < size ||
+            maxNumber < numCommands ||
+            maxNumber < numRuns ||
+            firstCommand != static_cast<quint64>(m_numCommands)
+        ) {
+            return false;
+        }
+        offset += CommandTrace::BLOCK_HEADER_SIZE;
+        if (m_size - offset < static_cast<qint64>(compressedSize)) {
+            break;
+        }
+        m_blocks.append({
+            offset,
+            static_cast<int>(size),
+            static_cast<int>(compressedSize),
+            m_numCommands,
+            static_cast<int>(numCommands),
+            static_cast<int>(numRuns)
+        });
+        m_numCommands += numCommands;
+        offset += compressedSize;
+        m_end = offset;
+    }
+    if (m_end == 0) {
+        m_end = CommandTrace::HEADER_SIZE;
+    }
+    return true;
+}
+
+void TraceFile::readBlock(
+        const Block& block,
+        QVector<Command>* commands,
+        QVector<TraceRun>* runs,
+        int* numCommands,
+        int* numRuns) const {
+    bool isMalformed = false;
+    QByteArray records = qUncompress(
+        reinterpret_cast<const uchar*>(m_data + block.offset),
+        block.compressedSize
+    );
+    if (records.size() != block.size) {
+        records.clear();
+        isMalformed = true;
+    }
+    readRecords(
+        records.constData(),
+        records.size(),
+        block.firstCommand,
+        commands,
+        runs,
+        numCommands,
+        numRuns,
+        &isMalformed
+    );
+
+    // The header of a block is trusted over its records, so that the
+    // commands of the blocks after it are where the headers say
+    if (*numCommands != block.numCommands) {
+        if (commands != nullptr) {
+            int first = commands->size() - *numCommands;
+            commands->resize(first + qMin(*numCommands, block.numCommands));
+            while (commands->size() < first + block.numCommands) {
+                commands->append(getPlaceholder());
+            }
+        }
+        *numCommands = block.numCommands;
+        isMalformed = true;
+    }
+    if (isMalformed) {
+        qWarning().noquote().nospace()
+            << "Malformed commands in the trace \"" << m_file.fileName()
+            << "\" were replaced with mazeWidth queries";
+    }
+}
+
+void TraceFile::readRecords(
+        const char* data,
+        int size,
+        qint64 firstCommand,
+        QVector<Command>* commands,
+        QVector<TraceRun>* runs,
+        int* numCommands,
+        int* numRuns,
+        bool* isMalformed) const {
+
+    // The differences of the arguments are from zero at the start of every
+    // block, so that blocks can be decoded on their own; timestamps aren't
+    // needed by anything that reads traces back, so they're skipped
+    qint64 previousInts[Command::MAX_INTS] = {0};
+    int position = 0;
+    int end = 0;
+    *numCommands = 0;
+    *numRuns = 0;
+    while (position < size) {
+        int tag = static_cast<uchar>(data[position]);
+        position += 1;
+        quint64 timestamp = 0;
+        quint64 length = 0;
+        if (!CommandTrace::readVarint(data, size, &position, &timestamp)) {
+            break;
+        }
+        if (tag == CommandTrace::TAG_RUN) {
+            if (
+                !CommandTrace::readVarint(data, size, &position, &length) ||
+                static_cast<quint64>(size - position) < length
+            ) {
+                break;
+            }
+            if (runs != nullptr) {
+                runs->append({
+                    QString::fromUtf8(
+                        data + position,
+                        static_cast<int>(length)
+                    ),
+                    nullptr,
+                    firstCommand + *numCommands,
+                    0
+                });
+            }
+            *numRuns += 1;
+        }
+        else if (tag == CommandTrace::TAG_RESPONSE) {
+            position += 1;
+            if (
+                size < position ||
+                !CommandTrace::readVarint(data, size, &position, &length) ||
+                static_cast<quint64>(size - position) < length
+            ) {
+                break;
+            }
+        }
+        else {
+            if (size <= position) {
+                break;
+            }
+            int numInts = static_cast<uchar>(data[position]);
+            position += 1;
+            if (Command::MAX_INTS < numInts) {
+                break;
+            }
+            bool isComplete = true;
+            bool isValid = tag - CommandTrace::TAG_COMMAND < NUM_OPCODES;
+            Command command;
+            for (int i = 0; i < Command::MAX_INTS; i += 1) {
+                if (i < numInts) {
+                    quint64 difference = 0;
+                    isComplete = CommandTrace::readVarint(
+                        data,
+                        size,
+                        &position,
+                        &difference
+                    );
+                    if (!isComplete) {
+                        break;
+                    }
+                    previousInts[i] += CommandTrace::fromZigzag(difference);
+                }
+                qint64 value = i < numInts ? previousInts[i] : 0;
+                if (
+                    value < std::numeric_limits<qint32>::min() ||
+                    std::numeric_limits<qint32>::max() < value
+                ) {
+                    isValid = false;
+                }
+                command.ints[i] = static_cast<int>(value);
+            }
+            quint64 character = 0;
+            if (
+                !isComplete ||
+                !CommandTrace::readVarint(data, size, &position, &character) ||
+                !CommandTrace::readVarint(data, size, &position, &length) ||
+                static_cast<quint64>(size - position) < length
+            ) {
+                break;
+            }
+            if (commands != nullptr) {
+                if (isValid && character <= 0xffff) {
+                    command.opcode = static_cast<Opcode>(
+                        tag - CommandTrace::TAG_COMMAND
+                    );
+                    command.numInts = numInts;
+                    command.character = QChar(static_cast<ushort>(character));
+                    command.text = QString::fromUtf8(
+                        data + position,
+                        static_cast<int>(length)
+                    );
+                }
+                else {
+                    command = getPlaceholder();
+                    *isMalformed = true;
+                }
+                commands->append(command);
+            }
+            *numCommands += 1;
+        }
+        position += length;
+        end = position;
+    }
+    if (end < size) {
+        *isMalformed = true;
+    }
+}
+
+Command TraceFile::getPlaceholder() {
+    return {Opcode::MAZE_WIDTH, {0}, 0, QChar(), QString()};
+}
+
+CommandTrace* CommandTrace::open(const QString& path) {
+
+    // Appending to an existing trace continues it, from a new block, once
+    // anything after its last complete block (e.g., a block that was cut
+    // off by a crash) has been dropped
+    qint64 firstCommand = 0;
+    QByteArray start;
+    if (QFileInfo(path).exists() && 0 < QFileInfo(path).size()) {
+        qint64 end = 0;
+        qint64 size = 0;
+        {
+            TraceFile existing;
+            QVector<TraceRun> runs;
+            if (!existing.load(path, &runs)) {
+                return nullptr;
+            }
+            firstCommand = existing.m_numCommands;
+            end = existing.m_end;
+            size = existing.m_size;
+        }
+        if (end < size) {
+            if (!QFile::resize(path, end)) {
+                return nullptr;
+            }
+            qWarning().noquote().nospace()
+                << "Dropped the last " << size - end << " bytes of the trace \""
+                << path << "\", which weren't a complete block";
+        }
+    }
+    else {
+        start = MAGIC;
+        appendNumber(&start, VERSION, 2);
+        appendNumber(&start, 0, 2);
+    }
+    QFile* file = new QFile(path);
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        delete file;
+        return nullptr;
+    }
+    file->write(start);
+    file->flush();
+    return new CommandTrace(file, firstCommand);
+}
+
+bool CommandTrace::read(const QString& path, QVector<TraceRun>* runs) {
+    ASSERT_FA(runs == nullptr);
+    std::shared_ptr<TraceFile> file(new TraceFile());
+    if (!file->load(path, runs)) {
+        runs->clear();
+        return false;
+    }
+    for (TraceRun& run : *runs) {
+        run.file = file;
+    }
+    return true;
+}
+
+CommandTrace::~CommandTrace() {
+    // A finished trace only has complete blocks, so that it can be appended
+    // to; blocking behind any earlier writes means that they've all finished
+    m_flushTimer.stop();
+    QMetaObject::invokeMethod(
+        m_writer,
+        "writeBlock",
+        Qt::BlockingQueuedConnection,
+        Q_ARG(QByteArray, m_block),
+        Q_ARG(qint64, m_blockFirstCommand),
+        Q_ARG(int, m_blockNumCommands),
+        Q_ARG(int, m_blockNumRuns)
+    );
+    m_thread.quit();
+    m_thread.wait();
+    delete m_writer;
+}
+
+void CommandTrace::recordRun(const QString& mazeSource) {
+    beginRecord(TAG_RUN);
+    endRecord(mazeSource);
+}
+
+void CommandTrace::recordCommand(const Command& command) {
+    ASSERT_LE(command.numInts, Command::MAX_INTS);
+    beginRecord(TAG_COMMAND + static_cast<int>(command.opcode));
+    m_block.append(static_cast<char>(command.numInts));
+    for (int i = 0; i < command.numInts; i += 1) {
+        appendVarint(&m_block, toZigzag(
+            static_cast<qint64>(command.ints[i]) - m_previousInts[i]
+        ));
+        m_previousInts[i] = command.ints[i];
+    }
+    appendVarint(&m_block, command.character.unicode());
+    endRecord(command.text);
+}
+
+void CommandTrace::recordResponse(Opcode opcode, const QString& response) {
+    beginRecord(TAG_RESPONSE);
+    m_block.append(static_cast<char>(opcode));
+    endRecord(response);
+}
+
+void CommandTrace::flush() {
+    m_flushTimer.stop();
+    if (m_block.isEmpty()) {
+        return;
+    }
+    QMetaObject::invokeMethod(
+        m_writer,
+        "writeBlock",
+        Qt::QueuedConnection,
+        Q_ARG(QByteArray, m_block),
+        Q_ARG(qint64, m_blockFirstCommand),
+        Q_ARG(int, m_blockNumCommands),
+        Q_ARG(int, m_blockNumRuns)
+    );
+    m_block.clear();
+    m_blockFirstCommand += m_blockNumCommands;
+    m_blockNumCommands = 0;
+    m_blockNumRuns = 0;
+    m_previousTimestamp = 0;
+    std::fill(m_previousInts, m_previousInts + Command::MAX_INTS, 0);
+}
+
+CommandTrace::CommandTrace(QFile* file, qint64 firstCommand) :
+    m_writer(new CommandTraceWriter(file)),
+    m_blockFirstCommand(firstCommand),
+    m_blockNumCommands(0),
+    m_blockNumRuns(0),
+    m_previousTimestamp(0),
+    m_previousInts{0} {
+
+    // The file is only touched by the writer from now on
+    file->moveToThread(&m_thread);
+    m_writer->moveToThread(&m_thread);
+    m_thread.start();
+    m_clock.start();
+
+    // The current block is handed off once it's a little old
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_MS);
+    QObject::connect(
+        &m_flushTimer,
+        &QTimer::timeout,
+        [this]() {
+            flush();
+        }
+    );
+}
+
+void CommandTrace::beginRecord(int tag) {
+    qint64 timestamp = m_clock.nsecsElapsed();
+    m_block.append(static_cast<char>(tag));
+    appendVarint(&m_block, timestamp - m_previousTimestamp);
+    m_previousTimestamp = timestamp;
+    if (tag == TAG_RUN) {
+        m_blockNumRuns += 1;
+    }
+    else if (TAG_COMMAND <= tag) {
+        m_blockNumCommands += 1;
+    }
+}
+
+void CommandTrace::endRecord(const QString& text) {
+    QByteArray utf8 = text.toUtf8();
+    appendVarint(&m_block, utf8.size());
+    m_block.append(utf8);
+    if (BLOCK_SIZE <= m_block.size()) {
+        flush();
+    }
+    else if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+quint64 CommandTrace::readNumber(const char* data, int size) {
+    uchar encoded[8] = {0};
+    memcpy(encoded, data, size);
+    return qFromLittleEndian<quint64>(encoded);
+}
+
+void CommandTrace::appendNumber(QByteArray* bytes, quint64 value, int size) {
+    uchar encoded[8];
+    qToLittleEndian<quint64>(value, encoded);
+    bytes->append(reinterpret_cast<const char*>(encoded), size);
+}
+
+void CommandTrace::appendVarint(QByteArray* bytes, quint64 value) {
+    while (0x80 <= value) {
+        bytes->append(static_cast<char>(0x80 | (value & 0x7f)));
+        value >>= 7;
+    }
+    bytes->append(static_cast<char>(value));
+}
+
+quint64 CommandTrace::toZigzag(qint64 value) {
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(
+        value < 0 ? -1 : 0
+    );
+}
+
+qint64 CommandTrace::fromZigzag(quint64 value) {
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+bool CommandTrace::readVarint(
+        const char* data,
+        int size,
+        int* position,
+        quint64* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (size <= *position) {
+            return false;
+        }
+        quint64 byte = static_cast<uchar>(data[*position]);
+        *position += 1;
+        *value |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} 
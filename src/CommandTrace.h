@@ -0,0 +1,243 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include "Command.h"
+
+namespace mms {
+
+class TraceFile;
+
+// A run, as read back from a trace: its commands are those from the given
+// one on, in the file, which decodes them as they're asked for. Responses
+// aren't kept, since replaying the commands against the same maze
+// reproduces them.
+struct TraceRun {
+    QString mazeSource;
+    std::shared_ptr<TraceFile> file;
+    qint64 firstCommand;
+    int numCommands;
+};
+
+class TraceFile {
+
+    // A trace file that's being read back, which is memory-mapped rather
+    // than read, so that only the pages that are actually used are ever
+    // touched: opening a trace only reads the header of every block, and
+    // the blocks in which runs start, and commands are decoded (and
+    // decompressed) a block at a time, as they're asked for. The block that
+    // was decoded last is kept, so reading the commands in order decodes
+    // each block just once; this also means that it's not safe to read from
+    // more than one thread.
+
+public:
+
+    ~TraceFile();
+
+    // The number of commands in the whole trace, and the command at the
+    // given index among them
+    qint64 getNumCommands() const;
+    Command getCommand(qint64 index) const;
+
+private:
+
+    friend class CommandTrace;
+    TraceFile();
+    Q_DISABLE_COPY(TraceFile)
+
+    // The compressed records of a block, from its header: where they are,
+    // their sizes, and the index of their first command
+    struct Block {
+        qint64 offset;
+        int size;
+        int compressedSize;
+        qint64 firstCommand;
+        int numCommands;
+        int numRuns;
+    };
+
+    QFile m_file;
+    uchar* m_memory;
+    QByteArray m_bytes;
+    const char* m_data;
+    qint64 m_size;
+    QVector<Block> m_blocks;
+    qint64 m_numCommands;
+
+    // Where the last complete block ends, which is where appending to the
+    // trace resumes
+    qint64 m_end;
+
+    mutable int m_decodedBlock;
+    mutable QVector<Command> m_decodedCommands;
+
+    // Finds the blocks, and the runs that start in them, or returns false if
+    // the file isn't a trace
+    bool load(const QString& path, QVector<TraceRun>* runs);
+    bool loadBlocks();
+
+    // Reads the complete records of a block, appending its commands and the
+    // runs that start in it (if either isn't nullptr), and counting its
+    // commands and runs. Commands
+    // are only validated as they're decoded, so any that are malformed (or
+    // missing, for a block that doesn't decompress) are decoded as mazeWidth
+    // queries, which change nothing, and are warned of.
+    void readBlock(
+        const Block& block,
+        QVector<Command>* commands,
+        QVector<TraceRun>* runs,
+        int* numCommands,
+        int* numRuns) const;
+    void readRecords(
+        const char* data,
+        int size,
+        qint64 firstCommand,
+        QVector<Command>* commands,
+        QVector<TraceRun>* runs,
+        int* numCommands,
+        int* numRuns,
+        bool* isMalformed) const;
+    static Command getPlaceholder();
+
+};
+
+class CommandTraceWriter : public QObject {
+
+    // Compresses blocks, and appends them to a trace file, on the thread
+    // that it lives on
+
+    Q_OBJECT
+
+public:
+
+    // Takes ownership of the (open) file
+    CommandTraceWriter(QFile* file);
+    ~CommandTraceWriter();
+
+    // Does nothing for a block without records
+    Q_INVOKABLE void writeBlock(
+        const QByteArray& records,
+        qint64 firstCommand,
+        int numCommands,
+        int numRuns);
+
+private:
+
+    QFile* m_file;
+
+};
+
+class CommandTrace {
+
+    // An append-only binary record of everything that algorithms did. Each
+    // record is encoded into a block as it happens, which is handed to a
+    // writer on a background thread, to be compressed and written, once
+    // it's large enough, or once it's a little old, so recording never waits
+    // on the disk (or on the compression).
+    //
+    // The file starts with the magic bytes "MMST", then a 16-bit version
+    // and 16 reserved bits, followed by blocks. Each block is a header, and
+    // then its records, compressed with qCompress: the header is the magic
+    // bytes "MMTB", the 32-bit compressed and uncompressed sizes of the
+    // records, the 64-bit index of the block's first command (in the whole
+    // trace), and its 32-bit numbers of commands and of runs, so that a
+    // reader can find any command, or any run, from the headers alone.
+    //
+    // Records are compact, since most are small, repetitive commands: each
+    // is a tag byte (TAG_RUN, TAG_RESPONSE, or TAG_COMMAND plus the opcode),
+    // then the nanoseconds since the previous record of the block (or since
+    // the trace was opened, for the first one), then the payload. A run's
+    // payload is the maze that it's against, a command's is its number of
+    // integer arguments (a byte), each argument's difference from the same
+    // argument of the previous command of the block, its character argument
+    // (zero if none) and its text argument, and a response's is the opcode
+    // byte of the command that it answers, and the response. Numbers are
+    // varints, seven bits to a byte, lowest first, with differences
+    // zigzag-encoded; text is a varint length and UTF-8, and the sizes and
+    // numbers of the headers are little-endian.
+
+public:
+
+    // Returns nullptr if the file can't be opened for appending, or if it
+    // isn't a trace of this version; appending to a trace whose last block is
+    // incomplete (e.g., its writer crashed) drops that block first
+    static CommandTrace* open(const QString& path);
+
+    // Reads back every run in the trace at the given path, ignoring a final
+    // block that's incomplete (e.g., still being written); returns false if
+    // the file can't be read, or isn't a trace of this version
+    static bool read(const QString& path, QVector<TraceRun>* runs);
+
+    // Hands off anything still buffered, and waits for it to be written
+    ~CommandTrace();
+
+    static const QByteArray MAGIC;
+    static const quint16 VERSION;
+    static const QByteArray BLOCK_MAGIC;
+    static const int BLOCK_SIZE;
+
+    void recordRun(const QString& mazeSource);
+    void recordCommand(const Command& command);
+    void recordResponse(Opcode opcode, const QString& response);
+
+    // Hands off the current block to the writer, if it has any records
+    void flush();
+
+private:
+
+    friend class CommandTraceWriter;
+    friend class TraceFile;
+
+    CommandTrace(QFile* file, qint64 firstCommand);
+
+    static const int HEADER_SIZE;
+    static const int BLOCK_HEADER_SIZE;
+    static const int FLUSH_MS;
+    static const int TAG_RUN;
+    static const int TAG_RESPONSE;
+    static const int TAG_COMMAND;
+
+    QThread m_thread;
+    CommandTraceWriter* m_writer;
+    QElapsedTimer m_clock;
+    QTimer m_flushTimer;
+
+    // The current block, and what its next record's differences are from
+    QByteArray m_block;
+    qint64 m_blockFirstCommand;
+    int m_blockNumCommands;
+    int m_blockNumRuns;
+    qint64 m_previousTimestamp;
+    int m_previousInts[Command::MAX_INTS];
+
+    // Appends the tag and timestamp of a record to the block, and then its
+    // text, once the rest of the payload has been appended
+    void beginRecord(int tag);
+    void endRecord(const QString& text);
+
+    static void appendNumber(QByteArray* bytes, quint64 value, int size);
+    static void appendVarint(QByteArray* bytes, quint64 value);
+    static quint64 toZigzag(qint64 value);
+    static qint64 fromZigzag(quint64 value);
+
+    static quint64 readNumber(const char* data, int size);
+
+    // Reads a varint, or returns false if it runs past the end of the data
+    static bool readVarint(
+        const char* data,
+        int size,
+        int* position,
+        quint64* value);
+
+};
+
+} 
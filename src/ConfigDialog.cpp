@@ -2,6 +2,7 @@
 
 #include <QFileDialog>
 #include <QGroupBox>
+#include <QIntValidator>
 #include <QLabel>
 #include <QMessageBox>
 #include <QPushButton>
@@ -13,11 +14,17 @@ ConfigDialog::ConfigDialog(
     QString name,
     QString directory,
     QString buildCommand,
-    QString runCommand) :
+    QString runCommand,
+    bool isPlugin,
+    int listenPort) :
     m_name(new QLineEdit(name)),
     m_directory(new QLineEdit(directory)),
     m_buildCommand(new QLineEdit(buildCommand)),
     m_runCommand(new QLineEdit(runCommand)),
+    m_isPlugin(new QCheckBox("Shared library (batch evaluations only)")),
+    m_listenPort(new QLineEdit(
+        listenPort == 0 ? QString() : QString::number(listenPort)
+    )),
     m_removeButtonPressed(false) {
 
     // Set the layout for the dialog
@@ -35,6 +42,19 @@ ConfigDialog::ConfigDialog(
     appendRow(gridLayout, "Build Command", m_buildCommand);
     appendRow(gridLayout, "Run Command", m_runCommand);
 
+    // For plugins, the run command is the path of the library
+    m_isPlugin->setChecked(isPlugin);
+    QLabel* pluginLabel = new QLabel("Plugin");
+    pluginLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    int pluginRow = gridLayout->rowCount();
+    gridLayout->addWidget(pluginLabel, pluginRow, 0);
+    gridLayout->addWidget(m_isPlugin, pluginRow, 1);
+
+    // For remote algorithms, which connect over TCP instead of being run
+    m_listenPort->setValidator(new QIntValidator(1, 65535, m_listenPort));
+    m_listenPort->setPlaceholderText("None (run the command)");
+    appendRow(gridLayout, "Listen Port", m_listenPort);
+
     // Enforce nonempty name field
     connect(m_name, &QLineEdit::textChanged, this, &ConfigDialog::validate);
 
@@ -88,6 +108,15 @@ QString ConfigDialog::getRunCommand() {
     return m_runCommand->text();
 }
 
+bool ConfigDialog::isPlugin() {
+    return m_isPlugin->isChecked();
+}
+
+int ConfigDialog::getListenPort() {
+    // Empty means zero, i.e., no port
+    return m_listenPort->text().toInt();
+}
+
 bool ConfigDialog::removeButtonPressed() {
     return m_removeButtonPressed;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QCheckBox>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QLineEdit>
@@ -17,12 +18,16 @@ public:
         QString name,
         QString directory,
         QString buildCommand,
-        QString runCommand);
+        QString runCommand,
+        bool isPlugin,
+        int listenPort);
 
     QString getName();
     QString getDirectory();
     QString getBuildCommand();
     QString getRunCommand();
+    bool isPlugin();
+    int getListenPort();
     bool removeButtonPressed();
 
 private:
@@ -31,6 +36,8 @@ private:
     QLineEdit* m_directory;
     QLineEdit* m_buildCommand;
     QLineEdit* m_runCommand;
+    QCheckBox* m_isPlugin;
+    QLineEdit* m_listenPort;
     bool m_removeButtonPressed;
     QDialogButtonBox* m_buttons;
 
@@ -0,0 +1,159 @@
+#include "ContestScorer.h"
+
+#include <QStringList>
+
+namespace mms {
+
+ContestScorer::ContestScorer(const ContestRules& rules) :
+    m_rules(rules),
+    m_trialsSeconds(0.0),
+    m_runStartSeconds(0.0),
+    m_isTouched(false),
+    m_numRuns(0),
+    m_numTouches(0),
+    m_bestRun(-1),
+    m_bestRunSeconds(-1.0),
+    m_bestScore(-1.0) {
+}
+
+const ContestRules& ContestScorer::DEFAULT_RULES() {
+    static const ContestRules rules = {600.0, 5, 0.0, 0.0};
+    return rules;
+}
+
+ContestRules ContestScorer::getRules() const {
+    return m_rules;
+}
+
+void ContestScorer::enterStart(double trialSeconds) {
+    m_runStartSeconds = m_trialsSeconds + trialSeconds;
+    m_isTouched = false;
+}
+
+void ContestScorer::enterCenter(double trialSeconds) {
+    if (m_runStartSeconds < 0.0) {
+        return;
+    }
+    double mazeSeconds = m_trialsSeconds + trialSeconds;
+    double runSeconds = mazeSeconds - m_runStartSeconds;
+    if (m_isTouched) {
+        runSeconds += m_rules.touchPenaltySeconds;
+    }
+    m_numRuns += 1;
+    bool isInTime =
+        m_rules.timeLimitSeconds < 0.0 ||
+        mazeSeconds <= m_rules.timeLimitSeconds;
+    bool isInRuns = m_rules.maxRuns == 0 || m_numRuns <= m_rules.maxRuns;
+    if (isInTime && isInRuns) {
+        double score =
+            runSeconds + m_rules.searchFraction * m_runStartSeconds;
+        if (m_bestRun < 0 || score < m_bestScore) {
+            m_bestRun = m_numRuns - 1;
+            m_bestRunSeconds = runSeconds;
+            m_bestScore = score;
+        }
+    }
+    m_runStartSeconds = -1.0;
+}
+
+void ContestScorer::endTrial(double trialSeconds) {
+    m_trialsSeconds += trialSeconds;
+    m_numTouches += 1;
+    m_runStartSeconds = m_trialsSeconds;
+    m_isTouched = true;
+}
+
+ContestScore ContestScorer::getScore(double trialSeconds) const {
+    ContestScore score;
+    score.numRuns = m_numRuns;
+    score.numTouches = m_numTouches;
+    score.bestRun = m_bestRun;
+    score.bestRunSeconds = m_bestRunSeconds;
+    score.score = m_bestScore;
+    score.mazeSeconds = m_trialsSeconds + trialSeconds;
+    score.isOver =
+        (0.0 <= m_rules.timeLimitSeconds &&
+            m_rules.timeLimitSeconds <= score.mazeSeconds) ||
+        (0 < m_rules.maxRuns && m_rules.maxRuns <= m_numRuns);
+    return score;
+}
+
+bool ContestScorer::parseRules(
+        const QString& text,
+        ContestRules* rules,
+        QString* error) {
+    *rules = DEFAULT_RULES();
+    for (const QString& part : text.split(',', QString::SkipEmptyParts)) {
+        QString term = part.trimmed();
+        if (term.isEmpty()) {
+            continue;
+        }
+        int position = term.indexOf('=');
+        if (position == -1) {
+            *error = "no value in \"" + term + "\"";
+            return false;
+        }
+        QString name = term.left(position).trimmed().toLower();
+        QString value = term.mid(position + 1).trimmed();
+        bool valueOk = false;
+        if (name == "time") {
+            rules->timeLimitSeconds = value.toDouble(&valueOk);
+        }
+        else if (name == "runs") {
+            rules->maxRuns = value.toInt(&valueOk);
+            valueOk = valueOk && 0 <= rules->maxRuns;
+        }
+        else if (name == "search") {
+            rules->searchFraction = value.toDouble(&valueOk);
+            valueOk = valueOk && 0.0 <= rules->searchFraction;
+        }
+        else if (name == "touch") {
+            rules->touchPenaltySeconds = value.toDouble(&valueOk);
+            valueOk = valueOk && 0.0 <= rules->touchPenaltySeconds;
+        }
+        else {
+            *error = "no rule named \"" + name + "\"";
+            return false;
+        }
+        if (!valueOk) {
+            *error = "\"" + value + "\" isn't a valid value for " + name;
+            return false;
+        }
+    }
+    return true;
+}
+
+QString ContestScorer::rulesToString(const ContestRules& rules) {
+    return QString("time=%1,runs=%2,search=%3,touch=%4").arg(
+        QString::number(rules.timeLimitSeconds),
+        QString::number(rules.maxRuns),
+        QString::number(rules.searchFraction),
+        QString::number(rules.touchPenaltySeconds)
+    );
+}
+
+QString ContestScorer::scoreToString(const ContestScore& score) {
+    QString string = QString(
+        "%1 runs, %2 touches, %3 s of maze time"
+    ).arg(
+        QString::number(score.numRuns),
+        QString::number(score.numTouches),
+        QString::number(score.mazeSeconds, 'f', 3)
+    );
+    if (score.bestRun < 0) {
+        string = "no score, " + string;
+    }
+    else {
+        string = QString("score %1 s, by run %2 (%3 s), ").arg(
+            QString::number(score.score, 'f', 3),
+            QString::number(score.bestRun + 1),
+            QString::number(score.bestRunSeconds, 'f', 3)
+        ) + string;
+    }
+    if (score.isOver) {
+        string += ", over";
+    }
+    return string;
+}
+
+} 
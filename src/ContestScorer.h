@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QString>
+
+namespace mms {
+
+// The rules of a contest; times are estimated times, by the run time model
+struct ContestRules {
+    double timeLimitSeconds; // of maze time, or negative for no limit
+    int maxRuns; // that count, or zero for no limit
+    double searchFraction; // of the maze time before a run, added to it
+    double touchPenaltySeconds; // added to a run that starts with a touch
+};
+
+// A contest as of some point in it; the score is -1 until a run counts
+struct ContestScore {
+    int numRuns; // that reached the center, whether or not they count
+    int numTouches; // i.e., resets
+    int bestRun; // the index of the run with the best score, or -1
+    double bestRunSeconds; // its time, with its penalty
+    double score;
+    double mazeSeconds; // since the start, across resets
+    bool isOver; // no more runs can count
+};
+
+class ContestScorer {
+
+    // Scores a contest by the common micromouse rules, from the estimated
+    // time of every movement (see RunTimeModel) rather than a stopwatch. The
+    // maze time runs from the start, across resets. A run starts whenever
+    // the mouse is in the start cell, i.e., at the start of every trial and
+    // whenever it drives back there, and ends the next time that it reaches
+    // the center; its time is the maze time in between, plus the touch
+    // penalty if the mouse had to be touched (i.e., reset) to start it. A
+    // run counts if it reaches the center within the time limit, and is one
+    // of the first runs to, and its score is its time plus a fraction of the
+    // maze time before it started; the contest's score is the best score of
+    // any run that counts. Updates take constant time, so that the score can
+    // be kept up to date after every movement.
+
+public:
+
+    ContestScorer(const ContestRules& rules = DEFAULT_RULES());
+
+    // Ten minutes of maze time and five runs, without search or touch
+    // penalties, as in most contests
+    static const ContestRules& DEFAULT_RULES();
+    ContestRules getRules() const;
+
+    // Each takes the estimated time of the current trial so far; ending a
+    // trial touches the mouse, and puts it back in the start cell
+    void enterStart(double trialSeconds);
+    void enterCenter(double trialSeconds);
+    void endTrial(double trialSeconds);
+    ContestScore getScore(double trialSeconds) const;
+
+    // Rules are written as "time=600,runs=5,search=0.033,touch=3", where
+    // every rule is optional and defaults to its default
+    static bool parseRules(
+        const QString& text,
+        ContestRules* rules,
+        QString* error);
+    static QString rulesToString(const ContestRules& rules);
+    static QString scoreToString(const ContestScore& score);
+
+private:
+
+    ContestRules m_rules;
+
+    // The maze time of every trial before the current one, and when the
+    // current run started, or -1 if the mouse isn't on a run
+    double m_trialsSeconds;
+    double m_runStartSeconds;
+    bool m_isTouched;
+    int m_numRuns;
+    int m_numTouches;
+    int m_bestRun;
+    double m_bestRunSeconds;
+    double m_bestScore;
+};
+
+} 
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace mms {
+
+// How much of the maze a mouse has explored. A cell is visited once the mouse
+// has entered it, and the starting cell is visited from the start; entering
+// a cell that was already visited counts as a revisit.
+struct CoverageStats {
+    int numCells; // in the whole maze
+    int numVisited; // distinct cells visited
+    int numRevisits; // entries into cells that were already visited
+    int numVisitedBeforeCenter; // as of first reaching the center, or -1
+};
+
+} 
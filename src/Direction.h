@@ -9,6 +9,9 @@
 
 namespace mms {
 
+// The directions are in clockwise order, so that rotating is modular
+// arithmetic on their values; everything below is constexpr, and compiles
+// down to a few instructions (or a constant) wherever it's used
 enum class Direction {
     NORTH,
     EAST,
@@ -16,15 +19,70 @@ enum class Direction {
     WEST,
 };
 
-// This vector serves two functions:
+constexpr int NUM_DIRECTIONS = 4;
+
+// This array serves two functions:
 // 1) A convenient way to enumerate through all of the directions
 // 2) Determines the location of wall information in the vertex buffer
-const QVector<Direction>& DIRECTIONS();
+constexpr Direction DIRECTIONS[NUM_DIRECTIONS] = {
+    Direction::NORTH,
+    Direction::EAST,
+    Direction::SOUTH,
+    Direction::WEST,
+};
+
+// The position of a direction in DIRECTIONS
+constexpr int DIRECTION_INDEX(Direction direction) {
+    return static_cast<int>(direction);
+}
+
+constexpr Direction DIRECTION_ROTATE_LEFT(Direction direction) {
+    return DIRECTIONS[(DIRECTION_INDEX(direction) + 3) % NUM_DIRECTIONS];
+}
+
+constexpr Direction DIRECTION_ROTATE_RIGHT(Direction direction) {
+    return DIRECTIONS[(DIRECTION_INDEX(direction) + 1) % NUM_DIRECTIONS];
+}
+
+constexpr Direction DIRECTION_OPPOSITE(Direction direction) {
+    return DIRECTIONS[(DIRECTION_INDEX(direction) + 2) % NUM_DIRECTIONS];
+}
+
+// The offsets to the neighboring cell in each direction, and the angle
+// that each direction faces, in the order of DIRECTIONS
+constexpr int DIRECTION_DX_TABLE[NUM_DIRECTIONS] = {0, 1, 0, -1};
+constexpr int DIRECTION_DY_TABLE[NUM_DIRECTIONS] = {1, 0, -1, 0};
+constexpr double DIRECTION_DEGREES_TABLE[NUM_DIRECTIONS] = {90, 0, 270, 180};
+
+constexpr int DIRECTION_DX(Direction direction) {
+    return DIRECTION_DX_TABLE[DIRECTION_INDEX(direction)];
+}
+
+constexpr int DIRECTION_DY(Direction direction) {
+    return DIRECTION_DY_TABLE[DIRECTION_INDEX(direction)];
+}
+
+constexpr Angle DIRECTION_TO_ANGLE(Direction direction) {
+    return Angle::Degrees(DIRECTION_DEGREES_TABLE[DIRECTION_INDEX(direction)]);
+}
+
+// The characters of the directions, as in the commands
+constexpr char DIRECTION_TO_CHAR(Direction direction) {
+    return "nesw"[DIRECTION_INDEX(direction)];
+}
 
-const QMap<Direction, Direction>& DIRECTION_ROTATE_LEFT();
-const QMap<Direction, Direction>& DIRECTION_ROTATE_RIGHT();
+constexpr bool IS_DIRECTION_CHAR(char c) {
+    return c == 'n' || c == 'e' || c == 's' || c == 'w';
+}
 
-const QMap<QChar, Direction>& CHAR_TO_DIRECTION();
-const QMap<Direction, Angle>& DIRECTION_TO_ANGLE();
+// Only defined for characters of directions
+constexpr Direction CHAR_TO_DIRECTION(char c) {
+    return (
+        c == 'n' ? Direction::NORTH :
+        c == 'e' ? Direction::EAST :
+        c == 's' ? Direction::SOUTH :
+        Direction::WEST
+    );
+}
 
 } 
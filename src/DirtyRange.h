@@ -0,0 +1,12 @@
+#pragma once
+
+namespace mms {
+
+// A half-open range [begin, end) of element indices that have changed since
+// they were last uploaded; empty if begin >= end
+struct DirtyRange {
+    int begin;
+    int end;
+};
+
+} 
@@ -0,0 +1,134 @@
+#include "DistanceSensors.h"
+
+#include <limits>
+
+#include <QtMath>
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+
+namespace mms {
+
+DistanceSensors::DistanceSensors(
+        const WallGrid* walls,
+        const QVector<SensorMount>& mounts) :
+    m_walls(walls),
+    m_mounts(mounts),
+    m_tileLength(Dimensions::tileLength().getMeters()),
+    m_halfWallWidth(Dimensions::halfWallWidth().getMeters()) {
+    ASSERT_FA(m_walls == nullptr);
+}
+
+const QVector<SensorMount>& DistanceSensors::DEFAULT_MOUNTS() {
+    static const QVector<SensorMount> mounts = {
+        {0.040, 0.015, 0.0, 0.5},
+        {0.040, -0.015, 0.0, 0.5},
+        {0.035, 0.025, M_PI / 4.0, 0.3},
+        {0.035, -0.025, -M_PI / 4.0, 0.3},
+        {0.020, 0.030, M_PI / 2.0, 0.2},
+        {0.020, -0.030, -M_PI / 2.0, 0.2},
+    };
+    return mounts;
+}
+
+int DistanceSensors::getCount() const {
+    return m_mounts.size();
+}
+
+void DistanceSensors::read(
+        double x,
+        double y,
+        double heading,
+        double* readings) const {
+
+    // The heading is only turned into a rotation once for all of the sensors
+    double c = qCos(heading);
+    double s = qSin(heading);
+    for (int i = 0; i < m_mounts.size(); i += 1) {
+        const SensorMount& mount = m_mounts.at(i);
+        double mountX = x + mount.x * c - mount.y * s;
+        double mountY = y + mount.x * s + mount.y * c;
+        double angle = heading + mount.angle;
+        readings[i] = cast(
+            mountX,
+            mountY,
+            qCos(angle),
+            qSin(angle),
+            mount.range
+        );
+    }
+}
+
+double DistanceSensors::cast(
+        double x,
+        double y,
+        double dx,
+        double dy,
+        double range) const {
+
+    int cellX = static_cast<int>(qFloor(x / m_tileLength));
+    int cellY = static_cast<int>(qFloor(y / m_tileLength));
+    if (
+        cellX < 0 || m_walls->getWidth() <= cellX ||
+        cellY < 0 || m_walls->getHeight() <= cellY
+    ) {
+        return 0.0;
+    }
+
+    // The distance along the ray to the next vertical and horizontal cell
+    // boundaries, and between consecutive ones
+    const double infinity = std::numeric_limits<double>::infinity();
+    int stepX = 0 < dx ? 1 : -1;
+    int stepY = 0 < dy ? 1 : -1;
+    double nextX = infinity;
+    double nextY = infinity;
+    double deltaX = infinity;
+    double deltaY = infinity;
+    if (dx != 0.0) {
+        double boundary = (cellX + (0 < dx ? 1 : 0)) * m_tileLength;
+        nextX = (boundary - x) / dx;
+        deltaX = m_tileLength / qAbs(dx);
+    }
+    if (dy != 0.0) {
+        double boundary = (cellY + (0 < dy ? 1 : 0)) * m_tileLength;
+        nextY = (boundary - y) / dy;
+        deltaY = m_tileLength / qAbs(dy);
+    }
+    Direction sideX = 0 < dx ? Direction::EAST : Direction::WEST;
+    Direction sideY = 0 < dy ? Direction::NORTH : Direction::SOUTH;
+
+    // Walk from boundary to boundary until one of them has a wall; the
+    // surface of the wall is half of its width before the boundary
+    while (true) {
+        bool isAlongX = nextX < nextY;
+        double distance = isAlongX ? nextX : nextY;
+        double surface = distance -
+            m_halfWallWidth / qAbs(isAlongX ? dx : dy);
+        if (range <= surface) {
+            return range;
+        }
+        int bits = m_walls->getWallBits(cellX * m_walls->getHeight() + cellY);
+        Direction side = isAlongX ? sideX : sideY;
+        if (bits & (1 << static_cast<int>(side))) {
+            return qMax(surface, 0.0);
+        }
+        if (isAlongX) {
+            cellX += stepX;
+            nextX += deltaX;
+        }
+        else {
+            cellY += stepY;
+            nextY += deltaY;
+        }
+
+        // Mazes are enclosed, but walls that are being edited might not be
+        if (
+            cellX < 0 || m_walls->getWidth() <= cellX ||
+            cellY < 0 || m_walls->getHeight() <= cellY
+        ) {
+            return qMax(surface, 0.0);
+        }
+    }
+}
+
+} 
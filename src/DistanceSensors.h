@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QVector>
+
+#include "WallGrid.h"
+
+namespace mms {
+
+// Where a sensor is mounted, relative to the center and heading of the mouse
+// (x forward, y to the left), in meters and radians, and how far it can see
+struct SensorMount {
+    double x;
+    double y;
+    double angle;
+    double range;
+};
+
+class DistanceSensors {
+
+    // Distance sensors, modelled as rays cast through the wall grid. Each ray
+    // walks the grid one cell boundary at a time (a DDA traversal), so its
+    // cost depends only on how many cells it crosses, and never on the size
+    // of the maze. Walls are treated as slabs of the wall width, centered on
+    // the cell boundaries; the posts between them aren't modelled, so a ray
+    // that slips through a corner with no walls keeps going.
+
+public:
+
+    // No ownership of the walls - only a pointer
+    DistanceSensors(
+        const WallGrid* walls,
+        const QVector<SensorMount>& mounts = DEFAULT_MOUNTS());
+
+    // Six sensors: two straight ahead, two at 45 degrees, and two to the
+    // sides, like those of most micromice
+    static const QVector<SensorMount>& DEFAULT_MOUNTS();
+
+    int getCount() const;
+
+    // Reads every sensor at once, for the mouse at the given position (in
+    // meters) and heading (in radians, counterclockwise from east); readings
+    // must have room for getCount() values
+    void read(double x, double y, double heading, double* readings) const;
+
+    // The distance from the point to the first wall in the given direction
+    // (a unit vector), or the range if there's none within it; zero if the
+    // point isn't within the maze
+    double cast(double x, double y, double dx, double dy, double range) const;
+
+private:
+
+    const WallGrid* m_walls;
+    QVector<SensorMount> m_mounts;
+    double m_tileLength;
+    double m_halfWallWidth;
+};
+
+} 
@@ -1,11 +1,62 @@
 #include "Driver.h"
 
+#include <memory>
+#include <random>
+
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include <QString>
+#include <QSurfaceFormat>
+#include <QTextStream>
+#include <QThread>
 
+#include "AllocationCounter.h"
 #include "AssertMacros.h"
+#include "BatchRunner.h"
+#include "Benchmark.h"
+#include "CommandLatency.h"
+#include "ContestScorer.h"
+#include "FontImage.h"
+#include "GoldenRuns.h"
+#include "HeadlessRun.h"
 #include "Logging.h"
+#include "Map.h"
+#include "MapRenderer.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "MazeIndex.h"
+#include "MazeLibrary.h"
+#include "MazePack.h"
+#include "MazePreview.h"
+#include "MetricsEndpoint.h"
+#include "MonteCarloRunner.h"
+#include "MouseDefinition.h"
+#include "ProcessUtilities.h"
+#include "PathPlanner.h"
+#include "Profiler.h"
+#include "RegressionRunner.h"
+#include "RenderBenchmark.h"
+#include "ReplayComparison.h"
+#include "ResultQuery.h"
+#include "SensorNoise.h"
 #include "Settings.h"
+#include "SpectatorClient.h"
+#include "SyntheticAlgo.h"
+#include "TournamentGrid.h"
+#include "TournamentRunner.h"
+#include "VideoExport.h"
 #include "Window.h"
+#include "WorkerServer.h"
+#include "WorstCaseSearch.h"
 
 namespace mms {
 
@@ -14,6 +65,100 @@ int Driver::drive(int argc, char* argv[]) {
     // Make sure that this function is called just once
     ASSERT_RUNS_JUST_ONCE();
 
+    // Startup is timed from here, and logged under mms.startup
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+
+    // Headless modes don't need (or want) a display, nor OpenGL
+    for (int i = 1; i < argc; i += 1) {
+        if (QString(argv[i]) == "--batch") {
+            return batch(argc, argv);
+        }
+        if (QString(argv[i]) == "--tournament") {
+            return tournament(argc, argv);
+        }
+        if (QString(argv[i]) == "--compare") {
+            return compare(argc, argv);
+        }
+        if (QString(argv[i]) == "--search-worst") {
+            return searchWorst(argc, argv);
+        }
+        if (QString(argv[i]) == "--monte-carlo") {
+            return monteCarlo(argc, argv);
+        }
+        if (QString(argv[i]) == "--compare-replays") {
+            return compareReplays(argc, argv);
+        }
+        if (QString(argv[i]) == "--worker") {
+            return worker(argc, argv);
+        }
+        if (QString(argv[i]) == "--index") {
+            return index(argc, argv);
+        }
+        if (QString(argv[i]) == "--summarize") {
+            return summarize(argc, argv);
+        }
+        if (QString(argv[i]) == "--convert-maze") {
+            return convertMaze(argc, argv);
+        }
+        if (QString(argv[i]) == "--pack") {
+            return pack(argc, argv);
+        }
+        if (QString(argv[i]) == "--unpack") {
+            return unpack(argc, argv);
+        }
+        if (QString(argv[i]) == "--benchmark") {
+            return benchmark(argc, argv);
+        }
+        if (QString(argv[i]) == "--benchmark-protocol") {
+            return benchmarkProtocol(argc, argv);
+        }
+        if (QString(argv[i]) == "--synthetic-algo") {
+            return syntheticAlgo(argc, argv);
+        }
+        if (QString(argv[i]) == "--golden-runs") {
+            return goldenRuns(argc, argv);
+        }
+        if (QString(argv[i]) == "--path-query") {
+            return pathQuery(argc, argv);
+        }
+    }
+
+    // Every OpenGL context shares its objects with every other, so that any
+    // number of maps draw with one set of programs, meshes and textures
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
+    // Swaps wait for the display to refresh, so that the map doesn't tear,
+    // and so that it's never drawn more often than it can be shown
+    QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+    format.setSwapInterval(1);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    // Offscreen modes draw, but don't show a window
+    for (int i = 1; i < argc; i += 1) {
+        if (QString(argv[i]) == "--benchmark-render") {
+            return benchmarkRender(argc, argv);
+        }
+        if (QString(argv[i]) == "--export-video") {
+            return exportVideo(argc, argv);
+        }
+        if (QString(argv[i]) == "--render") {
+            return renderPreview(argc, argv);
+        }
+    }
+
+    // The font's distance field takes a while to build, and isn't needed
+    // until the first map is drawn, so it's built while everything else is
+    FontImage::prepare();
+
+    // Spectating shows a run that's streamed from elsewhere, on a map of its
+    // own, instead of the main window
+    for (int i = 1; i < argc; i += 1) {
+        if (QString(argv[i]) == "--spectate") {
+            return spectate(argc, argv);
+        }
+    }
+
     // Initialize Qt
     QApplication app(argc, argv);
 
@@ -21,12 +166,2478 @@ int Driver::drive(int argc, char* argv[]) {
     Logging::init();
     Settings::init();
 
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micromouse simulator");
+    parser.addHelpOption();
+    QCommandLineOption frameLogOption(
+        "frame-log", "Write the statistics of every frame to a file.", "path");
+    QCommandLineOption uploadBudgetOption(
+        "upload-budget",
+        "Bytes per frame to upload before heat and text wait (0 for no limit).",
+        "bytes");
+    QCommandLineOption runLogOption(
+        "run-log", "Write everything that algorithms log to a file.", "path");
+    QCommandLineOption runOutputLinesOption(
+        "run-output-lines",
+        "Number of lines to keep in the run output (0 for no limit).",
+        "n");
+    QCommandLineOption queueLimitOption(
+        "queue-limit",
+        "Number of commands to queue before the algorithm is made to wait "
+        "(0 for no limit).",
+        "n");
+    QCommandLineOption contestRulesOption(
+        "contest-rules",
+        "Score every run as a contest by these rules, e.g. "
+        "\"time=600,runs=5,search=0.033,touch=3\".",
+        "rules");
+    QCommandLineOption commandTraceOption(
+        "command-trace",
+        "Append every command and response to a binary trace file.",
+        "path");
+    QCommandLineOption ghostsOption(
+        "ghosts",
+        "Replay these previous runs of the maze as ghosts alongside every "
+        "run, e.g. \"best,last,floodFill\".",
+        "kinds");
+    QCommandLineOption ghostTraceOption(
+        "ghost-trace",
+        "Read the best and last runs from this command trace file "
+        "(default: the command trace).",
+        "path");
+    QCommandLineOption spectatorPortOption(
+        "spectator-port",
+        "Stream every run to spectators (see --spectate) on this port.",
+        "port");
+    QCommandLineOption latencyLogOption(
+        "latency-log",
+        "Append the command latency of every run to a file.",
+        "path");
+    QCommandLineOption runSummaryLogOption(
+        "run-summary-log",
+        "Append the summary of every run to a file.",
+        "path");
+    QCommandLineOption cellProfileLogOption(
+        "cell-profile-log",
+        "Append where every run spent its time and commands, cell by cell, "
+        "to a file.",
+        "path");
+    QCommandLineOption replayOption(
+        "replay",
+        "Replay a run from a command trace file, without running anything.",
+        "path");
+    QCommandLineOption replayRunOption(
+        "replay-run",
+        "Number of the run to replay, counting from one (default: the last).",
+        "n");
+    QCommandLineOption replayAgainstOption(
+        "replay-against",
+        "Replay a run of the same maze from another command trace file, "
+        "next to the replayed run.",
+        "path");
+    QCommandLineOption replayAgainstRunOption(
+        "replay-against-run",
+        "Number of the run to replay next to it (default: the last).",
+        "n");
+    QCommandLineOption profileOption(
+        "profile",
+        "Profile the hot paths, and write a Chrome trace to a file on exit "
+        "and whenever F4 is pressed.",
+        "path");
+    QCommandLineOption countAllocationsOption(
+        "count-allocations",
+        "Count the heap allocations of every frame and command.");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(frameLogOption);
+    parser.addOption(uploadBudgetOption);
+    parser.addOption(commandTraceOption);
+    parser.addOption(ghostsOption);
+    parser.addOption(ghostTraceOption);
+    parser.addOption(spectatorPortOption);
+    parser.addOption(latencyLogOption);
+    parser.addOption(runSummaryLogOption);
+    parser.addOption(cellProfileLogOption);
+    parser.addOption(runLogOption);
+    parser.addOption(replayOption);
+    parser.addOption(replayRunOption);
+    parser.addOption(replayAgainstOption);
+    parser.addOption(replayAgainstRunOption);
+    parser.addOption(runOutputLinesOption);
+    parser.addOption(queueLimitOption);
+    parser.addOption(contestRulesOption);
+    parser.addOption(profileOption);
+    parser.addOption(countAllocationsOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+    if (parser.isSet(countAllocationsOption)) {
+        if (!AllocationCounter::isCompiledIn()) {
+            qWarning().noquote()
+                << "Allocations are only counted by builds configured with"
+                << "CONFIG+=count_allocations";
+            return 1;
+        }
+        AllocationCounter::setEnabled(true);
+    }
+
     // Create the main window
     Window window;
+    window.setStartupTimer(startupTimer);
+    if (
+        parser.isSet(frameLogOption) &&
+        !window.setFrameLogPath(parser.value(frameLogOption))
+    ) {
+        return 1;
+    }
+    if (
+        parser.isSet(runLogOption) &&
+        !window.setRunLogPath(parser.value(runLogOption))
+    ) {
+        return 1;
+    }
+    if (
+        parser.isSet(commandTraceOption) &&
+        !window.setCommandTracePath(parser.value(commandTraceOption))
+    ) {
+        return 1;
+    }
+    if (parser.isSet(ghostTraceOption)) {
+        window.setGhostTracePath(parser.value(ghostTraceOption));
+    }
+    if (
+        parser.isSet(ghostsOption) &&
+        !window.setGhosts(parser.value(ghostsOption).split(
+            ',', QString::SkipEmptyParts))
+    ) {
+        return 1;
+    }
+    if (parser.isSet(spectatorPortOption)) {
+        bool portOk = false;
+        quint16 port = parser.value(spectatorPortOption).toUShort(&portOk);
+        if (!portOk) {
+            parser.showHelp(1);
+        }
+        if (!window.setSpectatorPort(port)) {
+            return 1;
+        }
+    }
+    if (
+        parser.isSet(latencyLogOption) &&
+        !window.setLatencyLogPath(parser.value(latencyLogOption))
+    ) {
+        return 1;
+    }
+    if (
+        parser.isSet(runSummaryLogOption) &&
+        !window.setRunSummaryLogPath(parser.value(runSummaryLogOption))
+    ) {
+        return 1;
+    }
+    if (
+        parser.isSet(cellProfileLogOption) &&
+        !window.setCellProfileLogPath(parser.value(cellProfileLogOption))
+    ) {
+        return 1;
+    }
+    if (parser.isSet(uploadBudgetOption)) {
+        bool bytesOk = false;
+        qint64 bytes = parser.value(uploadBudgetOption).toLongLong(&bytesOk);
+        if (!bytesOk || bytes < 0) {
+            parser.showHelp(1);
+        }
+        window.setUploadBudget(bytes);
+    }
+    if (parser.isSet(runOutputLinesOption)) {
+        bool linesOk = false;
+        int lines = parser.value(runOutputLinesOption).toInt(&linesOk);
+        if (!linesOk || lines < 0) {
+            parser.showHelp(1);
+        }
+        window.setRunOutputMaxLines(lines);
+    }
+    if (parser.isSet(queueLimitOption)) {
+        bool limitOk = false;
+        int limit = parser.value(queueLimitOption).toInt(&limitOk);
+        if (!limitOk || limit < 0) {
+            parser.showHelp(1);
+        }
+        window.setQueueLimit(limit);
+    }
+    if (parser.isSet(contestRulesOption)) {
+        QString text = parser.value(contestRulesOption);
+        ContestRules rules;
+        QString error;
+        if (!ContestScorer::parseRules(text, &rules, &error)) {
+            qWarning().noquote() << "Invalid contest rules:" << error;
+            return 1;
+        }
+        window.setContestRules(rules);
+    }
+    if (parser.isSet(replayOption)) {
+        int run = 0;
+        if (parser.isSet(replayRunOption)) {
+            bool runOk = false;
+            run = parser.value(replayRunOption).toInt(&runOk);
+            if (!runOk || run < 1) {
+                parser.showHelp(1);
+            }
+        }
+        if (!window.startReplay(parser.value(replayOption), run)) {
+            return 1;
+        }
+        if (parser.isSet(replayAgainstOption)) {
+            int againstRun = 0;
+            if (parser.isSet(replayAgainstRunOption)) {
+                bool againstRunOk = false;
+                againstRun = parser.value(replayAgainstRunOption).toInt(
+                    &againstRunOk);
+                if (!againstRunOk || againstRun < 1) {
+                    parser.showHelp(1);
+                }
+            }
+            if (!window.startComparedReplay(
+                parser.value(replayAgainstOption),
+                againstRun
+            )) {
+                return 1;
+            }
+        }
+    }
+    if (parser.isSet(profileOption)) {
+        Profiler::setEnabled(true);
+        window.setProfilePath(parser.value(profileOption));
+    }
     window.show();
 
+    // Start the event loop
+    int status = app.exec();
+    if (parser.isSet(profileOption)) {
+        writeProfile(parser.value(profileOption));
+    }
+    return status;
+}
+
+int Driver::batch(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Run a mouse algorithm against every maze in a directory");
+    parser.addHelpOption();
+    QCommandLineOption batchOption(
+        "batch", "Name of the mouse algorithm to evaluate.", "algo");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of runs to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for each run, in seconds.", "seconds", "60");
+    QCommandLineOption tickLimitOption(
+        "tick-limit",
+        "Limit on the simulated time of each run, in ticks of the simulation "
+        "clock; unlike the time limit, the same on every machine.",
+        "ticks");
+    QCommandLineOption commandLimitOption(
+        "command-limit",
+        "Limit on the number of commands that each run may send.", "n");
+    QCommandLineOption moveLimitOption(
+        "move-limit", "Limit on the number of moves of each run.", "n");
+    QCommandLineOption shmOption(
+        "shm", "Also offer each algorithm a shared-memory transport.");
+    QCommandLineOption pinOption(
+        "pin", "Pin each run to a CPU of its own, one for each job.");
+    QCommandLineOption memoryLimitOption(
+        "memory-limit",
+        "Limit on the address space of each algorithm process, in MiB.",
+        "MiB");
+    QCommandLineOption niceOption(
+        "nice", "Nice value of each algorithm process.", "n");
+    QCommandLineOption reuseOption(
+        "reuse-processes",
+        "Let algorithms that ask for another maze play more than one.");
+    QCommandLineOption contestOption(
+        "contest-rules",
+        "Run each maze as a contest, scored by these rules, e.g. "
+        "\"time=600,runs=5,search=0.033,touch=3\".",
+        "rules");
+    QCommandLineOption continuousOption(
+        "continuous",
+        "Simulate the dynamics of the mouse, and report its simulated time.");
+    QCommandLineOption mouseOption(
+        "mouse",
+        "Give every run the mouse defined in this file.",
+        "path");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also run against generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    QCommandLineOption storeOption(
+        "store", "Append every run to a result store.", "path");
+    QCommandLineOption memoizeOption(
+        "memoize",
+        "Don't run the mazes whose runs are already in the store, with the "
+        "same build of the algorithm and the same limits; give them the "
+        "stored result instead.");
+    QCommandLineOption whereOption(
+        "where",
+        "Only run the mazes whose features match this query, e.g. "
+        "\"size=16x16,loops>0,path>80\".",
+        "query");
+    QCommandLineOption skipDuplicatesOption(
+        "skip-duplicates",
+        "Don't run mazes that are the same as, or a reflection of, an "
+        "earlier maze; give them its result instead.");
+    QCommandLineOption symmetriesOption(
+        "symmetries",
+        "Also run every maze's mirror and rotation variants, and summarize "
+        "the runs of each maze's variants together.");
+    QCommandLineOption profileOption(
+        "profile",
+        "Profile the hot paths, and write a Chrome trace to a file once the "
+        "batch is done.",
+        "path");
+    QCommandLineOption metricsPortOption(
+        "metrics-port",
+        "Serve Prometheus metrics over HTTP on this port, at /metrics.",
+        "port");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(batchOption);
+    parser.addOption(jobsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(tickLimitOption);
+    parser.addOption(commandLimitOption);
+    parser.addOption(moveLimitOption);
+    parser.addOption(shmOption);
+    parser.addOption(reuseOption);
+    parser.addOption(contestOption);
+    parser.addOption(pinOption);
+    parser.addOption(memoryLimitOption);
+    parser.addOption(niceOption);
+    parser.addOption(continuousOption);
+    parser.addOption(mouseOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addOption(storeOption);
+    parser.addOption(memoizeOption);
+    parser.addOption(whereOption);
+    parser.addOption(skipDuplicatesOption);
+    parser.addOption(symmetriesOption);
+    parser.addOption(profileOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "maze-dir", "Directory containing the maze files (optional with "
+        "--generate).", "[maze-dir]");
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+    if (parser.isSet(profileOption)) {
+        Profiler::setEnabled(true);
+    }
+
+    QStringList positional = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (1 < positional.size() || (positional.isEmpty() && !isGenerating)) {
+        parser.showHelp(1);
+    }
+    bool jobsOk = false;
+    bool timeoutOk = false;
+    bool countOk = false;
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    double timeLimit = parser.value(timeoutOption).toDouble(&timeoutOk);
+    int count = parser.value(countOption).toInt(&countOk);
+    if (!jobsOk || numJobs < 1 || !timeoutOk || timeLimit <= 0.0) {
+        parser.showHelp(1);
+    }
+    QVector<MazeIndex::Condition> filter;
+    if (parser.isSet(whereOption)) {
+        QString query = parser.value(whereOption);
+        QString error;
+        if (!MazeIndex::parseQuery(query, &filter, &error)) {
+            qWarning().noquote() << "Invalid query:" << error;
+            return 1;
+        }
+    }
+    qint64 tickLimit = -1;
+    if (parser.isSet(tickLimitOption)) {
+        bool tickLimitOk = false;
+        tickLimit = parser.value(tickLimitOption).toLongLong(&tickLimitOk);
+        if (!tickLimitOk || tickLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    qint64 commandLimit = -1;
+    if (parser.isSet(commandLimitOption)) {
+        bool commandLimitOk = false;
+        commandLimit =
+            parser.value(commandLimitOption).toLongLong(&commandLimitOk);
+        if (!commandLimitOk || commandLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    int moveLimit = -1;
+    if (parser.isSet(moveLimitOption)) {
+        bool moveLimitOk = false;
+        moveLimit = parser.value(moveLimitOption).toInt(&moveLimitOk);
+        if (!moveLimitOk || moveLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+
+    ProcessLimits processLimits = ProcessUtilities::getNoLimits();
+    processLimits.isPinned = parser.isSet(pinOption);
+    if (processLimits.isPinned && QThread::idealThreadCount() < numJobs) {
+        qWarning().noquote().nospace()
+            << "Unable to pin " << numJobs << " jobs to "
+            << QThread::idealThreadCount() << " CPUs";
+        return 1;
+    }
+    if (parser.isSet(memoryLimitOption)) {
+        bool memoryLimitOk = false;
+        qint64 mebibytes =
+            parser.value(memoryLimitOption).toLongLong(&memoryLimitOk);
+        if (!memoryLimitOk || mebibytes < 1) {
+            parser.showHelp(1);
+        }
+        processLimits.memoryBytes = mebibytes * 1048576;
+    }
+    if (parser.isSet(niceOption)) {
+        bool niceOk = false;
+        processLimits.niceness = parser.value(niceOption).toInt(&niceOk);
+        int niceness = processLimits.niceness;
+        if (!niceOk || niceness < -20 || 19 < niceness) {
+            parser.showHelp(1);
+        }
+    }
+    QStringList generatedMazes;
+    if (isGenerating) {
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        generatedMazes = getGeneratedMazes(spec, count);
+    }
+
+    BatchRunner runner(
+        parser.value(batchOption),
+        positional.value(0),
+        generatedMazes,
+        numJobs,
+        timeLimit,
+        tickLimit,
+        commandLimit,
+        moveLimit,
+        parser.isSet(shmOption),
+        parser.isSet(reuseOption),
+        parser.isSet(continuousOption),
+        processLimits,
+        parser.value(storeOption),
+        filter,
+        parser.isSet(skipDuplicatesOption)
+    );
+    MetricsEndpoint metrics(numJobs);
+    if (parser.isSet(metricsPortOption)) {
+        bool metricsPortOk = false;
+        quint16 metricsPort =
+            parser.value(metricsPortOption).toUShort(&metricsPortOk);
+        if (!metricsPortOk) {
+            parser.showHelp(1);
+        }
+        if (!metrics.listen(metricsPort)) {
+            return 1;
+        }
+        runner.setMetrics(&metrics);
+    }
+    if (parser.isSet(contestOption)) {
+        QString text = parser.value(contestOption);
+        ContestRules rules;
+        QString error;
+        if (!ContestScorer::parseRules(text, &rules, &error)) {
+            qWarning().noquote() << "Invalid contest rules:" << error;
+            return 1;
+        }
+        if (parser.isSet(reuseOption)) {
+            qWarning().noquote()
+                << "Contests can't be combined with reused processes";
+            return 1;
+        }
+        runner.setContestRules(rules);
+    }
+    if (parser.isSet(memoizeOption)) {
+        if (!parser.isSet(storeOption)) {
+            qWarning().noquote() << "Memoized runs need a result store";
+            return 1;
+        }
+        if (parser.isSet(reuseOption)) {
+            qWarning().noquote()
+                << "Memoized runs can't be combined with reused processes";
+            return 1;
+        }
+        runner.setMemoized(true);
+    }
+    if (parser.isSet(mouseOption)) {
+        QString path = parser.value(mouseOption);
+        QString error;
+        std::shared_ptr<const MouseDefinition> definition =
+            MouseDefinition::load(path, &error);
+        if (definition == nullptr) {
+            qWarning().noquote().nospace()
+                << "Invalid mouse " << path << ": " << error;
+            return 1;
+        }
+        runner.setMouseDefinition(definition);
+    }
+    runner.setSymmetries(parser.isSet(symmetriesOption));
+    QObject::connect(
+        &runner,
+        &BatchRunner::done,
+        &app,
+        &QCoreApplication::quit,
+        Qt::QueuedConnection
+    );
+    if (!runner.start()) {
+        return 1;
+    }
+
+    // Start the event loop
+    int status = app.exec();
+    if (parser.isSet(profileOption)) {
+        writeProfile(parser.value(profileOption));
+    }
+    return status;
+}
+
+int Driver::tournament(int argc, char* argv[]) {
+
+    // Initialize Qt; only the grid needs a display
+    bool hasGrid = false;
+    for (int i = 1; i < argc; i += 1) {
+        if (QString(argv[i]) == "--grid") {
+            hasGrid = true;
+        }
+    }
+    QScopedPointer<QCoreApplication> app(
+        hasGrid
+        ? new QApplication(argc, argv)
+        : new QCoreApplication(argc, argv)
+    );
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Run every mouse algorithm against every maze, and rank them");
+    parser.addHelpOption();
+    QCommandLineOption tournamentOption(
+        "tournament", "Run a tournament between mouse algorithms.");
+    QCommandLineOption algosOption(
+        "algos",
+        "Comma-separated names of the algorithms to enter (default: all).",
+        "names");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of runs to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for each run, in seconds.", "seconds", "60");
+    QCommandLineOption tickLimitOption(
+        "tick-limit",
+        "Limit on the simulated time of each run, in ticks of the simulation "
+        "clock; unlike the time limit, the same on every machine.",
+        "ticks");
+    QCommandLineOption shmOption(
+        "shm", "Also offer each algorithm a shared-memory transport.");
+    QCommandLineOption pinOption(
+        "pin", "Pin each run to a CPU of its own, one for each job.");
+    QCommandLineOption memoryLimitOption(
+        "memory-limit",
+        "Limit on the address space of each algorithm process, in MiB.",
+        "MiB");
+    QCommandLineOption niceOption(
+        "nice", "Nice value of each algorithm process.", "n");
+    QCommandLineOption continuousOption(
+        "continuous",
+        "Simulate the dynamics of the mouse, and report its simulated time.");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also run against generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    QCommandLineOption resultsOption(
+        "results", "Write the result of every run to a file.", "path");
+    QCommandLineOption storeOption(
+        "store", "Append every run to a result store.", "path");
+    QCommandLineOption memoizeOption(
+        "memoize",
+        "Don't run the runs that are already in the store, with the same "
+        "build of the algorithm and the same limits; use the stored results "
+        "instead.");
+    QCommandLineOption workersOption(
+        "workers",
+        "Comma-separated addresses of workers to also send runs to.",
+        "host:port");
+    QCommandLineOption gridOption(
+        "grid", "Show a live grid of thumbnails of the local runs.");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(tournamentOption);
+    parser.addOption(algosOption);
+    parser.addOption(jobsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(tickLimitOption);
+    parser.addOption(shmOption);
+    parser.addOption(continuousOption);
+    parser.addOption(pinOption);
+    parser.addOption(memoryLimitOption);
+    parser.addOption(niceOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addOption(resultsOption);
+    parser.addOption(storeOption);
+    parser.addOption(memoizeOption);
+    parser.addOption(workersOption);
+    parser.addOption(gridOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "maze-dir", "Directory containing the maze files (optional with "
+        "--generate).", "[maze-dir]");
+    parser.process(*app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList positional = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (1 < positional.size() || (positional.isEmpty() && !isGenerating)) {
+        parser.showHelp(1);
+    }
+    // Every run may go to the workers, if there are any
+    QStringList workerAddresses;
+    if (parser.isSet(workersOption)) {
+        workerAddresses =
+            parser.value(workersOption).split(',', QString::SkipEmptyParts);
+    }
+    bool jobsOk = false;
+    bool timeoutOk = false;
+    bool countOk = false;
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    double timeLimit = parser.value(timeoutOption).toDouble(&timeoutOk);
+    int count = parser.value(countOption).toInt(&countOk);
+    int minJobs = workerAddresses.isEmpty() ? 1 : 0;
+    if (!jobsOk || numJobs < minJobs || !timeoutOk || timeLimit <= 0.0) {
+        parser.showHelp(1);
+    }
+    qint64 tickLimit = -1;
+    if (parser.isSet(tickLimitOption)) {
+        bool tickLimitOk = false;
+        tickLimit = parser.value(tickLimitOption).toLongLong(&tickLimitOk);
+        if (!tickLimitOk || tickLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    ProcessLimits processLimits = ProcessUtilities::getNoLimits();
+    processLimits.isPinned = parser.isSet(pinOption);
+    if (processLimits.isPinned && QThread::idealThreadCount() < numJobs) {
+        qWarning().noquote().nospace()
+            << "Unable to pin " << numJobs << " jobs to "
+            << QThread::idealThreadCount() << " CPUs";
+        return 1;
+    }
+    if (parser.isSet(memoryLimitOption)) {
+        bool memoryLimitOk = false;
+        qint64 mebibytes =
+            parser.value(memoryLimitOption).toLongLong(&memoryLimitOk);
+        if (!memoryLimitOk || mebibytes < 1) {
+            parser.showHelp(1);
+        }
+        processLimits.memoryBytes = mebibytes * 1048576;
+    }
+    if (parser.isSet(niceOption)) {
+        bool niceOk = false;
+        processLimits.niceness = parser.value(niceOption).toInt(&niceOk);
+        int niceness = processLimits.niceness;
+        if (!niceOk || niceness < -20 || 19 < niceness) {
+            parser.showHelp(1);
+        }
+    }
+    QStringList generatedMazes;
+    if (isGenerating) {
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        generatedMazes = getGeneratedMazes(spec, count);
+    }
+    QStringList algoNames;
+    if (parser.isSet(algosOption)) {
+        algoNames =
+            parser.value(algosOption).split(',', QString::SkipEmptyParts);
+        if (algoNames.isEmpty()) {
+            parser.showHelp(1);
+        }
+    }
+
+    TournamentRunner runner(
+        algoNames,
+        positional.value(0),
+        generatedMazes,
+        numJobs,
+        workerAddresses,
+        timeLimit,
+        tickLimit,
+        parser.isSet(shmOption),
+        parser.isSet(continuousOption),
+        processLimits,
+        parser.value(resultsOption),
+        parser.value(storeOption)
+    );
+    if (parser.isSet(memoizeOption)) {
+        if (!parser.isSet(storeOption)) {
+            qWarning().noquote() << "Memoized runs need a result store";
+            return 1;
+        }
+        runner.setMemoized(true);
+    }
+    QObject::connect(
+        &runner,
+        &TournamentRunner::done,
+        app.data(),
+        &QCoreApplication::quit,
+        Qt::QueuedConnection
+    );
+    if (!runner.start()) {
+        return 1;
+    }
+    QScopedPointer<TournamentGrid> grid;
+    if (hasGrid) {
+        grid.reset(new TournamentGrid(&runner));
+        grid->show();
+    }
+
+    // Start the event loop
+    return app->exec();
+}
+
+int Driver::compare(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Compare two builds of a mouse algorithm on the same mazes");
+    parser.addHelpOption();
+    QCommandLineOption compareOption(
+        "compare", "Name of the algorithm to compare.", "name");
+    QCommandLineOption baselineOption(
+        "baseline",
+        "Directory of the build to compare against, e.g. a checkout of an "
+        "earlier revision.",
+        "dir");
+    QCommandLineOption candidateOption(
+        "candidate",
+        "Directory of the build to compare (default: the configured one).",
+        "dir");
+    QCommandLineOption thresholdOption(
+        "threshold",
+        "How much slower a maze may be before it regressed, in percent.",
+        "percent", "5");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of runs to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for each run, in seconds.", "seconds", "60");
+    QCommandLineOption tickLimitOption(
+        "tick-limit",
+        "Limit on the simulated time of each run, in ticks of the simulation "
+        "clock; unlike the time limit, the same on every machine.",
+        "ticks");
+    QCommandLineOption continuousOption(
+        "continuous",
+        "Simulate the dynamics of the mouse, and report its simulated time.");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also run against generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    QCommandLineOption storeOption(
+        "store", "Append every run to a result store.", "path");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(compareOption);
+    parser.addOption(baselineOption);
+    parser.addOption(candidateOption);
+    parser.addOption(thresholdOption);
+    parser.addOption(jobsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(tickLimitOption);
+    parser.addOption(continuousOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addOption(storeOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "maze-dir", "Directory containing the maze files (optional with "
+        "--generate).", "[maze-dir]");
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList positional = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (1 < positional.size() || (positional.isEmpty() && !isGenerating)) {
+        parser.showHelp(1);
+    }
+    if (!parser.isSet(baselineOption)) {
+        parser.showHelp(1);
+    }
+    bool thresholdOk = false;
+    bool jobsOk = false;
+    bool timeoutOk = false;
+    bool countOk = false;
+    double threshold = parser.value(thresholdOption).toDouble(&thresholdOk);
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    double timeLimit = parser.value(timeoutOption).toDouble(&timeoutOk);
+    int count = parser.value(countOption).toInt(&countOk);
+    if (
+        !thresholdOk || threshold < 0.0 ||
+        !jobsOk || numJobs < 1 ||
+        !timeoutOk || timeLimit <= 0.0
+    ) {
+        parser.showHelp(1);
+    }
+    qint64 tickLimit = -1;
+    if (parser.isSet(tickLimitOption)) {
+        bool tickLimitOk = false;
+        tickLimit = parser.value(tickLimitOption).toLongLong(&tickLimitOk);
+        if (!tickLimitOk || tickLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    QStringList generatedMazes;
+    if (isGenerating) {
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        generatedMazes = getGeneratedMazes(spec, count);
+    }
+
+    RegressionRunner runner(
+        parser.value(compareOption),
+        parser.value(baselineOption),
+        parser.value(candidateOption),
+        positional.value(0),
+        generatedMazes,
+        numJobs,
+        timeLimit,
+        tickLimit,
+        parser.isSet(continuousOption),
+        threshold / 100.0,
+        parser.value(storeOption)
+    );
+    QObject::connect(
+        &runner,
+        &RegressionRunner::done,
+        &app,
+        &QCoreApplication::quit,
+        Qt::QueuedConnection
+    );
+    if (!runner.start()) {
+        return 1;
+    }
+
+    // Start the event loop; a regression fails like a broken build would
+    int code = app.exec();
+    if (code == 0 && runner.hasRegressed()) {
+        return 2;
+    }
+    return code;
+}
+
+int Driver::searchWorst(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Search for the mazes on which a mouse algorithm does worst");
+    parser.addHelpOption();
+    QCommandLineOption searchWorstOption(
+        "search-worst", "Name of the mouse algorithm to search against.",
+        "algo");
+    QCommandLineOption objectiveOption(
+        "objective",
+        "What makes a maze worse, either \"moves\" or \"time\" (the "
+        "estimated time of the run).",
+        "objective", "moves");
+    QCommandLineOption generationsOption(
+        "generations", "Number of generations of mutations.", "n", "10");
+    QCommandLineOption childrenOption(
+        "children", "Number of children of each maze, each generation.", "n",
+        "4");
+    QCommandLineOption flipsOption(
+        "flips", "Number of walls that each mutation flips.", "n", "2");
+    QCommandLineOption seedOption(
+        "seed", "Seed of the mutations.", "n", "0");
+    QCommandLineOption outputOption(
+        "output",
+        "Directory to write the worst mazes to, as binary maze files.",
+        "dir");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of runs to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for each run, in seconds.", "seconds", "60");
+    QCommandLineOption tickLimitOption(
+        "tick-limit",
+        "Limit on the simulated time of each run, in ticks of the simulation "
+        "clock; unlike the time limit, the same on every machine.",
+        "ticks");
+    QCommandLineOption commandLimitOption(
+        "command-limit",
+        "Limit on the number of commands that each run may send.", "n");
+    QCommandLineOption moveLimitOption(
+        "move-limit", "Limit on the number of moves of each run.", "n");
+    QCommandLineOption continuousOption(
+        "continuous",
+        "Simulate the dynamics of the mouse, and report its simulated time.");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also start from generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(searchWorstOption);
+    parser.addOption(objectiveOption);
+    parser.addOption(generationsOption);
+    parser.addOption(childrenOption);
+    parser.addOption(flipsOption);
+    parser.addOption(seedOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(tickLimitOption);
+    parser.addOption(commandLimitOption);
+    parser.addOption(moveLimitOption);
+    parser.addOption(continuousOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "maze", "Maze files (or generated maze specs) to start from "
+        "(optional with --generate).", "[maze...]");
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList seedMazes = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (seedMazes.isEmpty() && !isGenerating) {
+        parser.showHelp(1);
+    }
+    QString objective = parser.value(objectiveOption);
+    if (!WorstCaseSearch::STRING_TO_OBJECTIVE().contains(objective)) {
+        parser.showHelp(1);
+    }
+    bool generationsOk = false;
+    bool childrenOk = false;
+    bool flipsOk = false;
+    bool seedOk = false;
+    bool jobsOk = false;
+    bool timeoutOk = false;
+    bool countOk = false;
+    int numGenerations =
+        parser.value(generationsOption).toInt(&generationsOk);
+    int numChildren = parser.value(childrenOption).toInt(&childrenOk);
+    int numFlips = parser.value(flipsOption).toInt(&flipsOk);
+    quint32 seed = parser.value(seedOption).toUInt(&seedOk);
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    double timeLimit = parser.value(timeoutOption).toDouble(&timeoutOk);
+    int count = parser.value(countOption).toInt(&countOk);
+    if (
+        !generationsOk || numGenerations < 0 ||
+        !childrenOk || numChildren < 1 ||
+        !flipsOk || numFlips < 1 ||
+        !seedOk ||
+        !jobsOk || numJobs < 1 ||
+        !timeoutOk || timeLimit <= 0.0
+    ) {
+        parser.showHelp(1);
+    }
+    qint64 tickLimit = -1;
+    if (parser.isSet(tickLimitOption)) {
+        bool tickLimitOk = false;
+        tickLimit = parser.value(tickLimitOption).toLongLong(&tickLimitOk);
+        if (!tickLimitOk || tickLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    qint64 commandLimit = -1;
+    if (parser.isSet(commandLimitOption)) {
+        bool commandLimitOk = false;
+        commandLimit =
+            parser.value(commandLimitOption).toLongLong(&commandLimitOk);
+        if (!commandLimitOk || commandLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    int moveLimit = -1;
+    if (parser.isSet(moveLimitOption)) {
+        bool moveLimitOk = false;
+        moveLimit = parser.value(moveLimitOption).toInt(&moveLimitOk);
+        if (!moveLimitOk || moveLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    if (isGenerating) {
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        seedMazes.append(getGeneratedMazes(spec, count));
+    }
+
+    WorstCaseSearch search(
+        parser.value(searchWorstOption),
+        seedMazes,
+        numJobs,
+        timeLimit,
+        tickLimit,
+        commandLimit,
+        moveLimit,
+        parser.isSet(continuousOption),
+        WorstCaseSearch::STRING_TO_OBJECTIVE().value(objective),
+        numGenerations,
+        numChildren,
+        numFlips,
+        seed,
+        parser.value(outputOption)
+    );
+    QObject::connect(
+        &search,
+        &WorstCaseSearch::done,
+        &app,
+        &QCoreApplication::quit,
+        Qt::QueuedConnection
+    );
+    if (!search.start()) {
+        return 1;
+    }
+
     // Start the event loop
     return app.exec();
 }
 
+int Driver::monteCarlo(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Measure how often a mouse algorithm solves mazes with noisy sensors");
+    parser.addHelpOption();
+    QCommandLineOption monteCarloOption(
+        "monte-carlo", "Name of the mouse algorithm to run.", "algo");
+    QCommandLineOption trialsOption(
+        "trials", "Number of noisy trials of each maze.", "n", "100");
+    QCommandLineOption falsePositiveOption(
+        "false-positive",
+        "Probability that an open side is read as a wall.", "rate", "0");
+    QCommandLineOption falseNegativeOption(
+        "false-negative",
+        "Probability that a wall is read as an open side.", "rate", "0");
+    QCommandLineOption seedOption(
+        "seed", "Seed of the sensor noise.", "n", "0");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of trials to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for each trial, in seconds.", "seconds", "60");
+    QCommandLineOption tickLimitOption(
+        "tick-limit",
+        "Limit on the simulated time of each trial, in ticks of the "
+        "simulation clock; unlike the time limit, the same on every machine.",
+        "ticks");
+    QCommandLineOption commandLimitOption(
+        "command-limit",
+        "Limit on the number of commands that each trial may send.", "n");
+    QCommandLineOption moveLimitOption(
+        "move-limit", "Limit on the number of moves of each trial.", "n");
+    QCommandLineOption continuousOption(
+        "continuous",
+        "Simulate the dynamics of the mouse, and report its simulated time.");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also run generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(monteCarloOption);
+    parser.addOption(trialsOption);
+    parser.addOption(falsePositiveOption);
+    parser.addOption(falseNegativeOption);
+    parser.addOption(seedOption);
+    parser.addOption(jobsOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(tickLimitOption);
+    parser.addOption(commandLimitOption);
+    parser.addOption(moveLimitOption);
+    parser.addOption(continuousOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "maze", "Maze files (or generated maze specs) to run (optional with "
+        "--generate).", "[maze...]");
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList mazes = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (mazes.isEmpty() && !isGenerating) {
+        parser.showHelp(1);
+    }
+    bool trialsOk = false;
+    bool falsePositiveOk = false;
+    bool falseNegativeOk = false;
+    bool seedOk = false;
+    bool jobsOk = false;
+    bool timeoutOk = false;
+    bool countOk = false;
+    int numTrials = parser.value(trialsOption).toInt(&trialsOk);
+    double falsePositiveRate =
+        parser.value(falsePositiveOption).toDouble(&falsePositiveOk);
+    double falseNegativeRate =
+        parser.value(falseNegativeOption).toDouble(&falseNegativeOk);
+    quint64 seed = parser.value(seedOption).toULongLong(&seedOk);
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    double timeLimit = parser.value(timeoutOption).toDouble(&timeoutOk);
+    int count = parser.value(countOption).toInt(&countOk);
+    if (
+        !trialsOk || numTrials < 1 ||
+        !falsePositiveOk || !SensorNoise::isValidRate(falsePositiveRate) ||
+        !falseNegativeOk || !SensorNoise::isValidRate(falseNegativeRate) ||
+        !seedOk ||
+        !jobsOk || numJobs < 1 ||
+        !timeoutOk || timeLimit <= 0.0
+    ) {
+        parser.showHelp(1);
+    }
+    qint64 tickLimit = -1;
+    if (parser.isSet(tickLimitOption)) {
+        bool tickLimitOk = false;
+        tickLimit = parser.value(tickLimitOption).toLongLong(&tickLimitOk);
+        if (!tickLimitOk || tickLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    qint64 commandLimit = -1;
+    if (parser.isSet(commandLimitOption)) {
+        bool commandLimitOk = false;
+        commandLimit =
+            parser.value(commandLimitOption).toLongLong(&commandLimitOk);
+        if (!commandLimitOk || commandLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    int moveLimit = -1;
+    if (parser.isSet(moveLimitOption)) {
+        bool moveLimitOk = false;
+        moveLimit = parser.value(moveLimitOption).toInt(&moveLimitOk);
+        if (!moveLimitOk || moveLimit < 0) {
+            parser.showHelp(1);
+        }
+    }
+    if (isGenerating) {
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        mazes.append(getGeneratedMazes(spec, count));
+    }
+
+    MonteCarloRunner runner(
+        parser.value(monteCarloOption),
+        mazes,
+        numJobs,
+        timeLimit,
+        tickLimit,
+        commandLimit,
+        moveLimit,
+        parser.isSet(continuousOption),
+        numTrials,
+        falsePositiveRate,
+        falseNegativeRate,
+        seed
+    );
+    QObject::connect(
+        &runner,
+        &MonteCarloRunner::done,
+        &app,
+        &QCoreApplication::quit,
+        Qt::QueuedConnection
+    );
+    if (!runner.start()) {
+        return 1;
+    }
+
+    // Start the event loop
+    return app.exec();
+}
+
+int Driver::compareReplays(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Compare what two recorded runs show, command by command");
+    parser.addHelpOption();
+    QCommandLineOption compareReplaysOption(
+        "compare-replays", "Compare the runs of two command trace files.");
+    QCommandLineOption runAOption(
+        "run-a",
+        "Number of the run in the first trace, counting from one (default: "
+        "the last).",
+        "n", "0");
+    QCommandLineOption runBOption(
+        "run-b",
+        "Number of the run in the second trace, counting from one (default: "
+        "the last).",
+        "n", "0");
+    QCommandLineOption everyOption(
+        "every", "Number of commands between comparisons.", "n", "100");
+    parser.addOption(compareReplaysOption);
+    parser.addOption(runAOption);
+    parser.addOption(runBOption);
+    parser.addOption(everyOption);
+    parser.addPositionalArgument("trace-a", "The first command trace file.");
+    parser.addPositionalArgument("trace-b", "The second command trace file.");
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    bool runAOk = false;
+    bool runBOk = false;
+    bool everyOk = false;
+    int runA = parser.value(runAOption).toInt(&runAOk);
+    int runB = parser.value(runBOption).toInt(&runBOk);
+    int every = parser.value(everyOption).toInt(&everyOk);
+    if (
+        positional.size() != 2 ||
+        !runAOk || runA < 0 ||
+        !runBOk || runB < 0 ||
+        !everyOk || every < 1
+    ) {
+        parser.showHelp(1);
+    }
+    return ReplayComparison::run(
+        positional.at(0),
+        runA,
+        positional.at(1),
+        runB,
+        every
+    );
+}
+
+int Driver::worker(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Run the runs that tournament coordinators send");
+    parser.addHelpOption();
+    QCommandLineOption workerOption(
+        "worker", "Port to listen on for coordinators.", "port");
+    QCommandLineOption addressOption(
+        "address",
+        "Address to listen on, e.g. 0.0.0.0 for every interface.",
+        "address",
+        "127.0.0.1");
+    QCommandLineOption jobsOption(
+        "jobs", "Number of runs to keep in flight at once.", "n",
+        QString::number(QThread::idealThreadCount()));
+    QCommandLineOption metricsPortOption(
+        "metrics-port",
+        "Serve Prometheus metrics over HTTP on this port, at /metrics.",
+        "port");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(workerOption);
+    parser.addOption(addressOption);
+    parser.addOption(jobsOption);
+    parser.addOption(metricsPortOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    bool portOk = false;
+    bool jobsOk = false;
+    quint16 port = parser.value(workerOption).toUShort(&portOk);
+    int numJobs = parser.value(jobsOption).toInt(&jobsOk);
+    QHostAddress address;
+    bool addressOk = address.setAddress(parser.value(addressOption));
+    if (!portOk || !jobsOk || numJobs < 1 || !addressOk) {
+        parser.showHelp(1);
+    }
+    WorkerServer server(numJobs);
+    if (!server.listen(address, port)) {
+        return 1;
+    }
+    MetricsEndpoint metrics(numJobs);
+    if (parser.isSet(metricsPortOption)) {
+        bool metricsPortOk = false;
+        quint16 metricsPort =
+            parser.value(metricsPortOption).toUShort(&metricsPortOk);
+        if (!metricsPortOk) {
+            parser.showHelp(1);
+        }
+        if (!metrics.listen(metricsPort)) {
+            return 1;
+        }
+        server.setMetrics(&metrics);
+    }
+
+    // Serve until killed
+    return app.exec();
+}
+
+int Driver::index(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Index the features of the mazes in a directory, and query them");
+    parser.addHelpOption();
+    QCommandLineOption indexOption(
+        "index",
+        "Directory containing the maze files to index, or a maze pack.",
+        "maze-dir");
+    QCommandLineOption whereOption(
+        "where",
+        "Only list the mazes whose features match this query, e.g. "
+        "\"size=16x16,loops>0,path>80\".",
+        "query");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(indexOption);
+    parser.addOption(whereOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QVector<MazeIndex::Condition> filter;
+    if (parser.isSet(whereOption)) {
+        QString query = parser.value(whereOption);
+        QString error;
+        if (!MazeIndex::parseQuery(query, &filter, &error)) {
+            qWarning().noquote() << "Invalid query:" << error;
+            return 1;
+        }
+    }
+    QDir dir(parser.value(indexOption));
+    QStringList paths;
+    if (MazePack::isPack(dir.path())) {
+        QString error;
+        std::shared_ptr<const MazePack> pack =
+            MazePack::open(dir.path(), &error);
+        if (pack == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open maze pack \"" << dir.path() << "\": "
+                << error;
+            return 1;
+        }
+        paths = pack->getSources();
+    }
+    else if (!dir.exists()) {
+        qWarning().noquote().nospace()
+            << "No maze directory at \"" << dir.path() << "\"";
+        return 1;
+    }
+    else {
+        paths = MazeLibrary::getMazeFiles(dir.path());
+    }
+
+    // Lists every valid maze that matches, with its features
+    QVector<MazeFeatures> features =
+        MazeIndex::build(paths, MazeIndex::getSidecarPath(dir.path()));
+    int pathWidth = QString("maze").size();
+    for (const QString& path : paths) {
+        pathWidth = qMax(pathWidth, path.size());
+    }
+    QTextStream out(stdout);
+    out << QString("maze").leftJustified(pathWidth) << "  "
+        << QString("size").leftJustified(9)
+        << QString("path").rightJustified(6)
+        << QString("dead ends").rightJustified(10)
+        << QString("loops").rightJustified(7)
+        << QString("branching").rightJustified(10)
+        << "  canonical hash" << endl;
+    int numMatching = 0;
+    for (const MazeFeatures& mazeFeatures : features) {
+        if (!MazeIndex::matches(mazeFeatures, filter)) {
+            continue;
+        }
+        numMatching += 1;
+        out << mazeFeatures.source.leftJustified(pathWidth) << "  "
+            << QString("%1x%2").arg(mazeFeatures.width)
+                .arg(mazeFeatures.height).leftJustified(9)
+            << QString::number(mazeFeatures.pathLength).rightJustified(6)
+            << QString::number(mazeFeatures.deadEnds).rightJustified(10)
+            << QString::number(mazeFeatures.loops).rightJustified(7)
+            << QString::number(mazeFeatures.branching, 'f', 2)
+                .rightJustified(10)
+            << "  "
+            << QString::number(mazeFeatures.canonicalHash, 16)
+                .rightJustified(16, '0')
+            << endl;
+    }
+    out << endl << numMatching << " of " << paths.size()
+        << " mazes match" << endl;
+    return 0;
+}
+
+int Driver::summarize(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Summarize the runs in a result store, without running anything");
+    parser.addHelpOption();
+    QCommandLineOption summarizeOption(
+        "summarize", "Path of the result store to summarize.", "path");
+    QCommandLineOption groupByOption(
+        "group-by",
+        "What to group runs by: " +
+            ResultQuery::groupings().join(", ") + ".",
+        "grouping",
+        ResultQuery::groupings().first());
+    QCommandLineOption algoOption(
+        "algo", "Only summarize the runs of this algorithm.", "name");
+    QCommandLineOption mazeOption(
+        "maze",
+        "Only summarize the runs on this maze, by hash or by path.",
+        "maze");
+    parser.addOption(summarizeOption);
+    parser.addOption(groupByOption);
+    parser.addOption(algoOption);
+    parser.addOption(mazeOption);
+    parser.process(app);
+
+    if (!parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+    bool ok = ResultQuery::summarize(
+        parser.value(summarizeOption),
+        parser.value(groupByOption),
+        parser.value(algoOption),
+        parser.value(mazeOption)
+    );
+    return ok ? 0 : 1;
+}
+
+int Driver::convertMaze(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Convert a maze file to the binary maze format");
+    parser.addHelpOption();
+    QCommandLineOption convertOption(
+        "convert-maze", "Path of the binary maze file to write.", "path");
+    QCommandLineOption noDistancesOption(
+        "no-distances", "Don't store the distances to the center.");
+    parser.addOption(convertOption);
+    parser.addOption(noDistancesOption);
+    parser.addPositionalArgument(
+        "maze-file", "Maze file (or generated maze spec) to convert.");
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        parser.showHelp(1);
+    }
+    MazeError error;
+    Maze* maze = MazeGenerator::load(positional.at(0), &error);
+    if (maze == nullptr) {
+        qWarning().noquote().nospace()
+            << "Invalid maze file \"" << positional.at(0) << "\": "
+            << Maze::errorToString(error);
+        return 1;
+    }
+    bool ok = maze->toBinaryFile(
+        parser.value(convertOption),
+        !parser.isSet(noDistancesOption)
+    );
+    delete maze;
+    if (!ok) {
+        qWarning().noquote().nospace()
+            << "Couldn't write \"" << parser.value(convertOption) << "\"";
+        return 1;
+    }
+    return 0;
+}
+
+int Driver::pack(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Pack the mazes in a directory, or generated mazes, into one file");
+    parser.addHelpOption();
+    QCommandLineOption packOption(
+        "pack", "Path of the maze pack to write.", "path");
+    QCommandLineOption noDistancesOption(
+        "no-distances", "Don't store the distances to the center.");
+    QCommandLineOption generateOption(
+        "generate",
+        "Also pack generated mazes, starting from this spec.",
+        "algo:WxH:seed");
+    QCommandLineOption countOption(
+        "count", "Number of mazes to generate, with consecutive seeds.", "n",
+        "1");
+    parser.addOption(packOption);
+    parser.addOption(noDistancesOption);
+    parser.addOption(generateOption);
+    parser.addOption(countOption);
+    parser.addPositionalArgument(
+        "maze-dir",
+        "Directory containing the maze files to pack (optional with "
+        "--generate), or another maze pack.", "[maze-dir]");
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    bool isGenerating = parser.isSet(generateOption);
+    if (1 < positional.size() || (positional.isEmpty() && !isGenerating)) {
+        parser.showHelp(1);
+    }
+    QStringList sources;
+    if (!positional.isEmpty() && MazePack::isPack(positional.at(0))) {
+        QString error;
+        std::shared_ptr<const MazePack> pack =
+            MazePack::open(positional.at(0), &error);
+        if (pack == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open maze pack \"" << positional.at(0)
+                << "\": " << error;
+            return 1;
+        }
+        sources = pack->getSources();
+    }
+    else if (!positional.isEmpty()) {
+        QDir dir(positional.at(0));
+        if (!dir.exists()) {
+            qWarning().noquote().nospace()
+                << "No maze directory at \"" << dir.path() << "\"";
+            return 1;
+        }
+        sources = MazeLibrary::getMazeFiles(dir.path());
+    }
+    if (isGenerating) {
+        bool countOk = false;
+        int count = parser.value(countOption).toInt(&countOk);
+        QString spec = parser.value(generateOption);
+        if (!MazeGenerator::isSpec(spec) || !countOk || count < 1) {
+            parser.showHelp(1);
+        }
+        sources.append(getGeneratedMazes(spec, count));
+    }
+
+    QString error;
+    if (!MazePack::write(
+        parser.value(packOption),
+        sources,
+        !parser.isSet(noDistancesOption),
+        &error
+    )) {
+        qWarning().noquote().nospace()
+            << "Couldn't write \"" << parser.value(packOption) << "\": "
+            << error;
+        return 1;
+    }
+    return 0;
+}
+
+int Driver::unpack(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Write the mazes in a maze pack to a directory, as binary maze files");
+    parser.addHelpOption();
+    QCommandLineOption unpackOption(
+        "unpack", "Directory to write the maze files to.", "maze-dir");
+    parser.addOption(unpackOption);
+    parser.addPositionalArgument("pack", "Maze pack to unpack.");
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1) {
+        parser.showHelp(1);
+    }
+    QString error;
+    std::shared_ptr<const MazePack> pack =
+        MazePack::open(positional.at(0), &error);
+    if (pack == nullptr) {
+        qWarning().noquote().nospace()
+            << "Unable to open maze pack \"" << positional.at(0) << "\": "
+            << error;
+        return 1;
+    }
+    if (!pack->unpack(parser.value(unpackOption), &error)) {
+        qWarning().noquote().nospace()
+            << "Couldn't unpack \"" << positional.at(0) << "\": " << error;
+        return 1;
+    }
+    return 0;
+}
+
+int Driver::benchmark(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Time the simulator's primitives, printing one JSON object per line");
+    parser.addHelpOption();
+    QCommandLineOption benchmarkOption(
+        "benchmark", "Run the benchmarks.");
+    QCommandLineOption filterOption(
+        "filter", "Only run benchmarks whose names contain this text.",
+        "text");
+    QCommandLineOption minSecondsOption(
+        "min-seconds", "Minimum time to spend on each benchmark.", "seconds",
+        "0.5");
+    parser.addOption(benchmarkOption);
+    parser.addOption(filterOption);
+    parser.addOption(minSecondsOption);
+    parser.process(app);
+
+    bool minSecondsOk = false;
+    double minSeconds = parser.value(minSecondsOption).toDouble(&minSecondsOk);
+    if (!parser.positionalArguments().isEmpty() || !minSecondsOk) {
+        parser.showHelp(1);
+    }
+    if (!Benchmark::run(parser.value(filterOption), minSeconds)) {
+        qWarning() << "Couldn't write or read back the benchmark mazes";
+        return 1;
+    }
+    return 0;
+}
+
+int Driver::benchmarkProtocol(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Time the protocol end to end, with the synthetic algorithm");
+    parser.addHelpOption();
+    QCommandLineOption benchmarkProtocolOption(
+        "benchmark-protocol", "Run the protocol benchmark.");
+    QCommandLineOption mixOption(
+        "mix", "How often the algorithm takes each kind of step.", "mix",
+        SyntheticAlgo::DEFAULT_MIX);
+    QCommandLineOption commandsOption(
+        "commands", "Number of commands for the algorithm to send.", "n",
+        "100000");
+    QCommandLineOption seedOption(
+        "seed", "Seed of the algorithm's steps.", "seed", "1");
+    QCommandLineOption mazeOption(
+        "maze", "Maze file or spec to run on.", "maze", "dfs:16x16:1");
+    QCommandLineOption timeoutOption(
+        "timeout", "Time limit for the run, in seconds.", "seconds", "600");
+    parser.addOption(benchmarkProtocolOption);
+    parser.addOption(mixOption);
+    parser.addOption(commandsOption);
+    parser.addOption(seedOption);
+    parser.addOption(mazeOption);
+    parser.addOption(timeoutOption);
+    parser.process(app);
+
+    SyntheticMix mix;
+    QString mixError;
+    bool commandsOk = false;
+    qint64 commands = parser.value(commandsOption).toLongLong(&commandsOk);
+    bool seedOk = false;
+    parser.value(seedOption).toUInt(&seedOk);
+    bool timeoutOk = false;
+    double timeout = parser.value(timeoutOption).toDouble(&timeoutOk);
+    if (
+        !parser.positionalArguments().isEmpty() ||
+        !SyntheticAlgo::parseMix(parser.value(mixOption), &mix, &mixError) ||
+        !commandsOk || commands < 1 ||
+        !seedOk ||
+        !timeoutOk || timeout <= 0.0
+    ) {
+        if (!mixError.isEmpty()) {
+            qWarning().noquote() << mixError;
+        }
+        parser.showHelp(1);
+    }
+    MazeError mazeError;
+    Maze* maze = MazeGenerator::load(parser.value(mazeOption), &mazeError);
+    if (maze == nullptr) {
+        qWarning().noquote().nospace()
+            << "Invalid maze \"" << parser.value(mazeOption) << "\": "
+            << Maze::errorToString(mazeError);
+        return 1;
+    }
+
+    // The algorithm is this very executable, in its synthetic mode
+    CommandLatency latency;
+    HeadlessRun run(
+        parser.value(mazeOption),
+        maze,
+        {
+            QCoreApplication::applicationFilePath(),
+            "--synthetic-algo",
+            "--mix", parser.value(mixOption),
+            "--commands", QString::number(commands),
+            "--seed", parser.value(seedOption),
+        },
+        QDir::currentPath(),
+        timeout,
+        -1,
+        false,
+        false,
+        false
+    );
+    run.setLatency(&latency);
+    QObject::connect(
+        &run,
+        &HeadlessRun::finished,
+        &app,
+        &QCoreApplication::quit
+    );
+    run.start();
+    app.exec();
+
+    RunResult result = run.getResult();
+    QJsonObject object;
+    object["name"] = "protocol";
+    object["mix"] = parser.value(mixOption);
+    object["maze"] = parser.value(mazeOption);
+    object["status"] = HeadlessRun::statusToString(result.status);
+    object["commands"] = result.stats.commands;
+    object["seconds"] = result.stats.wallSeconds;
+    object["commandsPerSecond"] = result.stats.commandsPerSecond;
+    object["simulatorSeconds"] = result.stats.simulatorSeconds;
+    object["algorithmSeconds"] = result.stats.algorithmSeconds;
+    object["latency"] = latency.toJson();
+    QTextStream out(stdout);
+    out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+    out.flush();
+
+    // Reaching the center, or running out of commands, are both fine
+    bool ok = (
+        result.status == RunStatus::SOLVED ||
+        result.status == RunStatus::EXITED
+    );
+    if (!ok) {
+        qWarning().noquote() << "The run failed:" << result.error;
+    }
+    return ok ? 0 : 1;
+}
+
+int Driver::goldenRuns(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Check the runs of the bundled mazes against their golden results");
+    parser.addHelpOption();
+    QCommandLineOption goldenRunsOption(
+        "golden-runs", "Path of the golden results.", "path");
+    QCommandLineOption updateOption(
+        "update", "Write the results to the path instead of checking them.");
+    parser.addOption(goldenRunsOption);
+    parser.addOption(updateOption);
+    parser.process(app);
+
+    if (!parser.positionalArguments().isEmpty()) {
+        parser.showHelp(1);
+    }
+    bool ok = GoldenRuns::run(
+        parser.value(goldenRunsOption),
+        parser.isSet(updateOption)
+    );
+    return ok ? 0 : 1;
+}
+
+int Driver::pathQuery(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QCoreApplication app(argc, argv);
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Find a shortest path through a maze with the path planner");
+    parser.addHelpOption();
+    QCommandLineOption pathQueryOption(
+        "path-query", "Plan the maze, and answer the query.");
+    QCommandLineOption fromOption(
+        "from", "Cell to start from.", "x,y", "0,0");
+    QCommandLineOption toOption(
+        "to", "Cell to go to (default: the closest cell of the center).",
+        "x,y");
+    QCommandLineOption pathOption(
+        "path", "Also print every cell of the path.");
+    QCommandLineOption randomOption(
+        "random", "Also time this many queries between random cells.", "n",
+        "0");
+    QCommandLineOption seedOption(
+        "seed", "Seed of the random cells.", "seed", "1");
+    parser.addOption(pathQueryOption);
+    parser.addOption(fromOption);
+    parser.addOption(toOption);
+    parser.addOption(pathOption);
+    parser.addOption(randomOption);
+    parser.addOption(seedOption);
+    parser.addPositionalArgument(
+        "maze", "Maze file (or generated maze spec) to plan.");
+    parser.process(app);
+
+    QStringList positional = parser.positionalArguments();
+    bool randomOk = false;
+    bool seedOk = false;
+    int numRandom = parser.value(randomOption).toInt(&randomOk);
+    quint32 seed = parser.value(seedOption).toUInt(&seedOk);
+    if (positional.size() != 1 || !randomOk || numRandom < 0 || !seedOk) {
+        parser.showHelp(1);
+    }
+    MazeError error;
+    QScopedPointer<Maze> maze(MazeGenerator::load(positional.at(0), &error));
+    if (maze.isNull()) {
+        qWarning().noquote().nospace()
+            << "Invalid maze file \"" << positional.at(0) << "\": "
+            << Maze::errorToString(error);
+        return 1;
+    }
+
+    // Cells are written as x,y, and must be within the maze
+    int width = maze->getWidth();
+    int height = maze->getHeight();
+    auto parseCell = [&](const QCommandLineOption& option, int* cell) {
+        QVector<int> numbers;
+        bool ok =
+            parseNumbers(parser.value(option), 0, &numbers) &&
+            numbers.size() == 2 &&
+            numbers.at(0) < width &&
+            numbers.at(1) < height;
+        if (!ok) {
+            qWarning().noquote().nospace()
+                << "\"" << parser.value(option) << "\" isn't a cell of the "
+                << width << "x" << height << " maze";
+            return false;
+        }
+        *cell = numbers.at(0) * height + numbers.at(1);
+        return true;
+    };
+    int from = 0;
+    QVector<int> goals;
+    if (!parseCell(fromOption, &from)) {
+        return 1;
+    }
+    if (parser.isSet(toOption)) {
+        int to = 0;
+        if (!parseCell(toOption, &to)) {
+            return 1;
+        }
+        goals.append(to);
+    }
+    else {
+        for (const QPair<int, int>& center :
+                Maze::getCenterPositions(width, height)) {
+            goals.append(center.first * height + center.second);
+        }
+    }
+
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+    PathPlanner planner(maze->getWalls());
+    out << "planned in " << QString::number(timer.nsecsElapsed() / 1e6, 'f', 3)
+        << " ms: " << planner.getNumClusters() << " clusters ("
+        << planner.getNumTables() << " unique), " << planner.getNumNodes()
+        << " nodes, " << planner.getMemoryBytes() / 1024 << " KiB" << endl;
+
+    timer.restart();
+    int distance = planner.getDistance(from, goals);
+    qint64 nanoseconds = timer.nsecsElapsed();
+    out << "(" << from / height << ", " << from % height << ") to "
+        << (parser.isSet(toOption) ? parser.value(toOption) :
+            QString("the center"))
+        << ": ";
+    if (distance < 0) {
+        out << "unreachable";
+    }
+    else {
+        out << distance << " moves";
+    }
+    out << ", in " << QString::number(nanoseconds / 1e3, 'f', 1) << " us"
+        << endl;
+    if (parser.isSet(pathOption)) {
+        for (int cell : planner.getPath(from, goals)) {
+            out << cell / height << "," << cell % height << endl;
+        }
+    }
+
+    // Random queries are generated up front, so that only the queries are
+    // timed
+    if (0 < numRandom) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> cells(0, width * height - 1);
+        QVector<int> queries;
+        for (int i = 0; i < 2 * numRandom; i += 1) {
+            queries.append(cells(rng));
+        }
+        int numReachable = 0;
+        timer.restart();
+        for (int i = 0; i < numRandom; i += 1) {
+            if (0 <= planner.getDistance(
+                    queries.at(2 * i), {queries.at(2 * i + 1)})) {
+                numReachable += 1;
+            }
+        }
+        nanoseconds = timer.nsecsElapsed();
+        out << numRandom << " random queries (" << numReachable
+            << " reachable): "
+            << QString::number(nanoseconds / 1e3 / numRandom, 'f', 1)
+            << " us each" << endl;
+    }
+    return 0;
+}
+
+int Driver::benchmarkRender(int argc, char* argv[]) {
+
+    // Initialize Qt; as for video export, the platform (e.g., -platform
+    // offscreen) decides whether a display is needed at all
+    QApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Time the map on generated mazes, without a window");
+    parser.addHelpOption();
+    QCommandLineOption benchmarkRenderOption(
+        "benchmark-render", "Run the rendering benchmark.");
+    QString defaultSizes;
+    for (int size : RenderBenchmark::DEFAULT_SIZES()) {
+        defaultSizes += (defaultSizes.isEmpty() ? "" : ",");
+        defaultSizes += QString::number(size);
+    }
+    QString defaultChurns;
+    for (int churn : RenderBenchmark::DEFAULT_CHURNS()) {
+        defaultChurns += (defaultChurns.isEmpty() ? "" : ",");
+        defaultChurns += QString::number(churn);
+    }
+    QCommandLineOption mazeSizesOption(
+        "maze-sizes", "Widths (and heights) of the mazes.", "list",
+        defaultSizes);
+    QCommandLineOption churnOption(
+        "churn", "Numbers of tiles to change in each frame.", "list",
+        defaultChurns);
+    QCommandLineOption secondsOption(
+        "seconds", "Time to render for, for each size and churn.", "seconds",
+        "2");
+    QCommandLineOption sizeOption(
+        "size", "Width and height of the map, in pixels.", "WxH", "1280x720");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(benchmarkRenderOption);
+    parser.addOption(mazeSizesOption);
+    parser.addOption(churnOption);
+    parser.addOption(secondsOption);
+    parser.addOption(sizeOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QVector<int> mazeSizes;
+    QVector<int> churns;
+    QStringList size = parser.value(sizeOption).split('x');
+    bool widthOk = false;
+    bool heightOk = false;
+    bool secondsOk = false;
+    int width = size.value(0).toInt(&widthOk);
+    int height = size.value(1).toInt(&heightOk);
+    double seconds = parser.value(secondsOption).toDouble(&secondsOk);
+    bool mazeSizesOk =
+        parseNumbers(parser.value(mazeSizesOption), 1, &mazeSizes);
+    for (int mazeSize : mazeSizes) {
+        mazeSizesOk = mazeSizesOk && MazeGenerator::isSupported(
+            MazeAlgorithm::DFS,
+            mazeSize,
+            mazeSize
+        );
+    }
+    if (
+        !parser.positionalArguments().isEmpty() ||
+        !mazeSizesOk ||
+        !parseNumbers(parser.value(churnOption), 0, &churns) ||
+        size.size() != 2 ||
+        !widthOk || width < 1 ||
+        !heightOk || height < 1 ||
+        !secondsOk || seconds <= 0.0
+    ) {
+        parser.showHelp(1);
+    }
+    bool ok = RenderBenchmark::run(mazeSizes, churns, seconds, width, height);
+    return ok ? 0 : 1;
+}
+
+int Driver::syntheticAlgo(int argc, char* argv[]) {
+
+    // Initialize Qt, for its command line parser
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Send commands to the simulator over stdin and stdout, for timing");
+    parser.addHelpOption();
+    QCommandLineOption syntheticAlgoOption(
+        "synthetic-algo", "Run the synthetic algorithm.");
+    QCommandLineOption mixOption(
+        "mix", "How often to take each kind of step.", "mix",
+        SyntheticAlgo::DEFAULT_MIX);
+    QCommandLineOption commandsOption(
+        "commands", "Number of commands to send.", "n", "100000");
+    QCommandLineOption seedOption(
+        "seed", "Seed of the steps.", "seed", "1");
+    parser.addOption(syntheticAlgoOption);
+    parser.addOption(mixOption);
+    parser.addOption(commandsOption);
+    parser.addOption(seedOption);
+    parser.process(app);
+
+    SyntheticMix mix;
+    QString mixError;
+    bool commandsOk = false;
+    qint64 commands = parser.value(commandsOption).toLongLong(&commandsOk);
+    bool seedOk = false;
+    quint32 seed = parser.value(seedOption).toUInt(&seedOk);
+    if (
+        !parser.positionalArguments().isEmpty() ||
+        !SyntheticAlgo::parseMix(parser.value(mixOption), &mix, &mixError) ||
+        !commandsOk || commands < 1 ||
+        !seedOk
+    ) {
+        if (!mixError.isEmpty()) {
+            qWarning().noquote() << mixError;
+        }
+        parser.showHelp(1);
+    }
+    return SyntheticAlgo::run(mix, commands, seed);
+}
+
+int Driver::spectate(int argc, char* argv[]) {
+
+    // Initialize Qt
+    QApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Watch the runs of another simulator, read-only");
+    parser.addHelpOption();
+    QCommandLineOption spectateOption(
+        "spectate",
+        "Address of the simulator to watch (see --spectator-port).",
+        "host:port");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(spectateOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    // The client is destroyed first, since it shows its maze on the map
+    QString address = parser.value(spectateOption);
+    Map map;
+    QScopedPointer<SpectatorClient> client(
+        SpectatorClient::create(address, &map));
+    if (client.isNull()) {
+        parser.showHelp(1);
+    }
+    map.setWindowTitle("Spectating " + address);
+    map.resize(800, 800);
+    map.show();
+    client->connectToServer();
+    return app.exec();
+}
+
+int Driver::exportVideo(int argc, char* argv[]) {
+
+    // Initialize Qt; the map is a widget, even though it's never shown, and
+    // the platform (e.g., -platform offscreen) decides whether a display is
+    // needed at all
+    QApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Render a run from a command trace to a video, without a window");
+    parser.addHelpOption();
+    QCommandLineOption exportOption(
+        "export-video", "Path of the video to write.", "path");
+    QCommandLineOption replayOption(
+        "replay", "Command trace file to read the run from.", "path");
+    QCommandLineOption replayRunOption(
+        "replay-run",
+        "Number of the run to export, counting from one (default: the last).",
+        "n");
+    QCommandLineOption sizeOption(
+        "size", "Width and height of the video, in pixels.", "WxH",
+        "1280x720");
+    QCommandLineOption fpsOption(
+        "fps", "Frames per second of the video.", "n", "30");
+    QCommandLineOption speedOption(
+        "speed", "Simulated seconds per second of video.", "factor", "1");
+    QCommandLineOption encoderOption(
+        "encoder", "Program that encodes the frames, with ffmpeg's arguments.",
+        "program", "ffmpeg");
+    QCommandLineOption rawOption(
+        "raw", "Write the raw rgb24 frames to the path, without encoding.");
+    QCommandLineOption rendererOption(
+        "renderer",
+        "How frames are drawn: \"opengl\", \"software\" (with no GPU or "
+        "display), or \"auto\" (OpenGL if a context can be made).",
+        "backend", "auto");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(exportOption);
+    parser.addOption(replayOption);
+    parser.addOption(replayRunOption);
+    parser.addOption(sizeOption);
+    parser.addOption(fpsOption);
+    parser.addOption(speedOption);
+    parser.addOption(encoderOption);
+    parser.addOption(rawOption);
+    parser.addOption(rendererOption);
+    parser.addOption(logRulesOption);
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList size = parser.value(sizeOption).split('x');
+    bool widthOk = false;
+    bool heightOk = false;
+    bool fpsOk = false;
+    bool speedOk = false;
+    int run = 0;
+    int width = size.value(0).toInt(&widthOk);
+    int height = size.value(1).toInt(&heightOk);
+    int fps = parser.value(fpsOption).toInt(&fpsOk);
+    double speed = parser.value(speedOption).toDouble(&speedOk);
+    if (
+        !parser.positionalArguments().isEmpty() ||
+        !parser.isSet(replayOption) ||
+        size.size() != 2 ||
+        !widthOk || width < 1 ||
+        !heightOk || height < 1 ||
+        !fpsOk || fps < 1 ||
+        !speedOk || speed <= 0.0
+    ) {
+        parser.showHelp(1);
+    }
+    if (parser.isSet(replayRunOption)) {
+        bool runOk = false;
+        run = parser.value(replayRunOption).toInt(&runOk);
+        if (!runOk || run < 1) {
+            parser.showHelp(1);
+        }
+    }
+    QString renderer = parser.value(rendererOption);
+    if (!MapRenderer::STRING_TO_RENDER_BACKEND().contains(renderer)) {
+        parser.showHelp(1);
+    }
+    bool ok = VideoExport::run(
+        parser.value(replayOption),
+        run,
+        parser.value(exportOption),
+        parser.isSet(rawOption) ? QString() : parser.value(encoderOption),
+        width,
+        height,
+        fps,
+        speed,
+        MapRenderer::STRING_TO_RENDER_BACKEND().value(renderer)
+    );
+    return ok ? 0 : 1;
+}
+
+int Driver::renderPreview(int argc, char* argv[]) {
+
+    // Initialize Qt; nothing is drawn with OpenGL, but text needs fonts, and
+    // so a platform (e.g., -platform offscreen, which needs no display)
+    QApplication app(argc, argv);
+
+    // Initialize singletons
+    Logging::init();
+    Settings::init();
+
+    // Parse the command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Render pictures of mazes on the CPU, without a window");
+    parser.addHelpOption();
+    QCommandLineOption renderOption("render", "Render the mazes.");
+    QCommandLineOption traceOption(
+        "trace", "Command trace file of a run to draw the path of.", "path");
+    QCommandLineOption traceRunOption(
+        "trace-run",
+        "Number of the run to draw, counting from one (default: the last).",
+        "n");
+    QCommandLineOption sizeOption(
+        "size", "Width and height of each picture, in pixels.", "WxH",
+        "512x512");
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Which messages to log, e.g. \"mms.opengl.debug=false\".",
+        "rules");
+    parser.addOption(renderOption);
+    parser.addOption(traceOption);
+    parser.addOption(traceRunOption);
+    parser.addOption(sizeOption);
+    parser.addOption(logRulesOption);
+    parser.addPositionalArgument(
+        "mazes", "Maze files, directories of them, or generated maze specs.",
+        "<maze>...");
+    parser.addPositionalArgument(
+        "output",
+        "Picture to write, for a single maze file, or else a directory to "
+        "write a PNG of each maze to.");
+    parser.process(app);
+    if (parser.isSet(logRulesOption)) {
+        Logging::setFilterRules(parser.value(logRulesOption));
+    }
+
+    QStringList size = parser.value(sizeOption).split('x');
+    bool widthOk = false;
+    bool heightOk = false;
+    int run = 0;
+    int width = size.value(0).toInt(&widthOk);
+    int height = size.value(1).toInt(&heightOk);
+    QStringList positional = parser.positionalArguments();
+    if (
+        positional.size() < 2 ||
+        size.size() != 2 ||
+        !widthOk || width < 1 ||
+        !heightOk || height < 1
+    ) {
+        parser.showHelp(1);
+    }
+    if (parser.isSet(traceRunOption)) {
+        bool runOk = false;
+        run = parser.value(traceRunOption).toInt(&runOk);
+        if (!runOk || run < 1) {
+            parser.showHelp(1);
+        }
+    }
+
+    // A single maze file goes to the output path itself unless it's a
+    // directory, and every other maze goes into the output directory, named
+    // after its file
+    QString output = positional.takeLast();
+    QStringList mazePaths;
+    for (const QString& maze : positional) {
+        if (QFileInfo(maze).isDir()) {
+            mazePaths.append(MazeLibrary::getMazeFiles(maze));
+        }
+        else {
+            mazePaths.append(maze);
+        }
+    }
+    QStringList outputPaths;
+    bool isSingle =
+        positional.size() == 1 &&
+        mazePaths == positional &&
+        !QFileInfo(output).isDir();
+    if (isSingle) {
+        outputPaths.append(output);
+    }
+    else if (!QDir().mkpath(output)) {
+        qWarning().noquote().nospace()
+            << "Unable to create the directory \"" << output << "\"";
+        return 1;
+    }
+    else {
+        for (const QString& maze : mazePaths) {
+            outputPaths.append(QDir(output).filePath(
+                QFileInfo(maze).completeBaseName() + ".png"
+            ));
+        }
+    }
+    bool ok = MazePreview::run(
+        mazePaths,
+        outputPaths,
+        parser.value(traceOption),
+        run,
+        width,
+        height
+    );
+    return ok ? 0 : 1;
+}
+
+QStringList Driver::getGeneratedMazes(const QString& spec, int count) {
+    QStringList parts = spec.split(':');
+    quint32 seed = parts.at(2).toUInt();
+    QStringList generatedMazes;
+    for (int i = 0; i < count; i += 1) {
+        generatedMazes.append(
+            parts.at(0) + ":" + parts.at(1) + ":" +
+            QString::number(seed + static_cast<quint32>(i)));
+    }
+    return generatedMazes;
+}
+
+bool Driver::parseNumbers(
+        const QString& text,
+        int minimum,
+        QVector<int>* numbers) {
+    for (const QString& part : text.split(',', QString::SkipEmptyParts)) {
+        bool ok = false;
+        int number = part.trimmed().toInt(&ok);
+        if (!ok || number < minimum) {
+            return false;
+        }
+        numbers->append(number);
+    }
+    return !numbers->isEmpty();
+}
+
+void Driver::writeProfile(const QString& path) {
+    if (!Profiler::write(path)) {
+        qWarning().noquote().nospace()
+            << "Unable to write the profile to \"" << path << "\"";
+    }
+}
+
 } 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
 namespace mms {
 
 class Driver {
@@ -8,6 +12,43 @@ public:
     Driver() = delete;
     static int drive(int argc, char* argv[]);
 
+private:
+    static int batch(int argc, char* argv[]);
+    static int tournament(int argc, char* argv[]);
+    static int compare(int argc, char* argv[]);
+    static int searchWorst(int argc, char* argv[]);
+    static int monteCarlo(int argc, char* argv[]);
+    static int compareReplays(int argc, char* argv[]);
+    static int worker(int argc, char* argv[]);
+    static int index(int argc, char* argv[]);
+    static int summarize(int argc, char* argv[]);
+    static int convertMaze(int argc, char* argv[]);
+    static int pack(int argc, char* argv[]);
+    static int unpack(int argc, char* argv[]);
+    static int benchmark(int argc, char* argv[]);
+    static int benchmarkProtocol(int argc, char* argv[]);
+    static int goldenRuns(int argc, char* argv[]);
+    static int pathQuery(int argc, char* argv[]);
+    static int benchmarkRender(int argc, char* argv[]);
+    static int syntheticAlgo(int argc, char* argv[]);
+    static int exportVideo(int argc, char* argv[]);
+    static int renderPreview(int argc, char* argv[]);
+    static int spectate(int argc, char* argv[]);
+
+    // The specs of count generated mazes, with consecutive seeds starting
+    // from the one in the (valid) spec
+    static QStringList getGeneratedMazes(const QString& spec, int count);
+
+    // Parses a comma-separated list of numbers that are at least minimum;
+    // returns false if any isn't
+    static bool parseNumbers(
+        const QString& text,
+        int minimum,
+        QVector<int>* numbers);
+
+    // Writes the profile, warning if it can't
+    static void writeProfile(const QString& path);
+
 };
 
 } 
@@ -0,0 +1,274 @@
+#include "DynamicDistances.h"
+
+#include <algorithm>
+
+#include <QSet>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+DynamicDistances::DynamicDistances() {
+}
+
+DynamicDistances::DynamicDistances(
+        const WallGrid& walls,
+        const QVector<QPair<int, int>>& sources) :
+    m_walls(walls),
+    m_distances(walls.getWidth() * walls.getHeight(), -1) {
+
+    // The edges are walled in, so that every open side of a cell leads to
+    // another cell
+    int width = getWidth();
+    int height = getHeight();
+    for (int x = 0; x < width; x += 1) {
+        m_walls.setWall(x, 0, Direction::SOUTH, true);
+        m_walls.setWall(x, height - 1, Direction::NORTH, true);
+    }
+    for (int y = 0; y < height; y += 1) {
+        m_walls.setWall(0, y, Direction::WEST, true);
+        m_walls.setWall(width - 1, y, Direction::EAST, true);
+    }
+
+    // A breadth first search, in which every cell is enqueued at most once
+    const int offsets[] = {1, height, -1, -height};
+    QVector<int> queue;
+    queue.reserve(m_distances.size());
+    for (const QPair<int, int>& source : sources) {
+        int cell = height * source.first + source.second;
+        if (m_distances.at(cell) == -1) {
+            m_distances[cell] = 0;
+            queue.append(cell);
+        }
+    }
+    for (int head = 0; head < queue.size(); head += 1) {
+        int cell = queue.at(head);
+        int open = ~m_walls.getWallBits(cell) & 0xf;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int neighbor = cell + offsets[direction];
+            if ((open & (1 << direction)) && m_distances.at(neighbor) == -1) {
+                m_distances[neighbor] = m_distances.at(cell) + 1;
+                queue.append(neighbor);
+            }
+        }
+    }
+}
+
+int DynamicDistances::getWidth() const {
+    return m_walls.getWidth();
+}
+
+int DynamicDistances::getHeight() const {
+    return m_walls.getHeight();
+}
+
+int DynamicDistances::getDistance(int x, int y) const {
+    ASSERT_LE(0, x);
+    ASSERT_LE(0, y);
+    ASSERT_LT(x, getWidth());
+    ASSERT_LT(y, getHeight());
+    return m_distances.at(getHeight() * x + y);
+}
+
+const QVector<int>& DynamicDistances::getDistances() const {
+    return m_distances;
+}
+
+bool DynamicDistances::isWall(int x, int y, Direction direction) const {
+    return m_walls.isWall(x, y, direction);
+}
+
+const WallGrid& DynamicDistances::getWalls() const {
+    return m_walls;
+}
+
+bool DynamicDistances::setWall(
+        int x,
+        int y,
+        Direction direction,
+        bool isWall,
+        QVector<int>* changed) {
+    int nx = x + DIRECTION_DX(direction);
+    int ny = y + DIRECTION_DY(direction);
+    if (
+        x < 0 || getWidth() <= x || y < 0 || getHeight() <= y ||
+        nx < 0 || getWidth() <= nx || ny < 0 || getHeight() <= ny
+    ) {
+        return false;
+    }
+    if (m_walls.isWall(x, y, direction) == isWall) {
+        return true;
+    }
+    m_walls.setWall(x, y, direction, isWall);
+    m_walls.setWall(nx, ny, DIRECTION_OPPOSITE(direction), isWall);
+    QVector<int> cells;
+    update(
+        m_walls,
+        getHeight() * x + y,
+        getHeight() * nx + ny,
+        &m_distances,
+        changed != nullptr ? changed : &cells
+    );
+    return true;
+}
+
+void DynamicDistances::update(
+        const WallGrid& walls,
+        int first,
+        int second,
+        QVector<int>* distances,
+        QVector<int>* changed) {
+
+    ASSERT_FA(changed == nullptr);
+    const int height = walls.getHeight();
+    const int offsets[] = {1, height, -1, -height};
+    QVector<int>& d = *distances;
+    auto isOpen = [&](int cell, int direction) {
+        return !(walls.getWallBits(cell) & (1 << direction));
+    };
+
+    // The near cell is whichever is reachable, and closer; if neither is
+    // reachable, the wall makes no difference
+    if (
+        d.at(first) == -1 ||
+        (d.at(second) != -1 && d.at(second) < d.at(first))
+    ) {
+        std::swap(first, second);
+    }
+    int near = first;
+    int far = second;
+    if (d.at(near) == -1) {
+        return;
+    }
+    bool isWallOpen = false;
+    for (int direction = 0; direction < 4; direction += 1) {
+        if (near + offsets[direction] == far) {
+            isWallOpen = isOpen(near, direction);
+        }
+    }
+
+    if (isWallOpen) {
+        if (d.at(far) != -1 && d.at(far) <= d.at(near) + 1) {
+            return;
+        }
+        QVector<int> queue = {far};
+        d[far] = d.at(near) + 1;
+        for (int head = 0; head < queue.size(); head += 1) {
+            int cell = queue.at(head);
+            changed->append(cell);
+            for (int direction = 0; direction < 4; direction += 1) {
+                int neighbor = cell + offsets[direction];
+                if (
+                    isOpen(cell, direction) &&
+                    (d.at(neighbor) == -1 || d.at(cell) + 1 < d.at(neighbor))
+                ) {
+                    d[neighbor] = d.at(cell) + 1;
+                    queue.append(neighbor);
+                }
+            }
+        }
+        return;
+    }
+
+    // The far cell only loses its distance if the near cell was its way to
+    // the source; the cells that lose theirs are those with no neighbor one
+    // closer that doesn't, and since the queue is in order of distance, all
+    // of the cells one closer are settled before a cell is checked
+    if (d.at(far) != d.at(near) + 1) {
+        return;
+    }
+    QSet<int> affected;
+    QSet<int> queued = {far};
+    QVector<int> queue = {far};
+    for (int head = 0; head < queue.size(); head += 1) {
+        int cell = queue.at(head);
+        bool isSupported = false;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int neighbor = cell + offsets[direction];
+            isSupported = isSupported || (
+                isOpen(cell, direction) &&
+                d.at(neighbor) == d.at(cell) - 1 &&
+                !affected.contains(neighbor)
+            );
+        }
+        if (isSupported) {
+            continue;
+        }
+        affected.insert(cell);
+        for (int direction = 0; direction < 4; direction += 1) {
+            int neighbor = cell + offsets[direction];
+            if (
+                isOpen(cell, direction) &&
+                d.at(neighbor) == d.at(cell) + 1 &&
+                !queued.contains(neighbor)
+            ) {
+                queued.insert(neighbor);
+                queue.append(neighbor);
+            }
+        }
+    }
+
+    // Each affected cell starts out one past its best neighbor that isn't
+    // affected, if it has one, and the cells are then settled in order of
+    // distance, from a bucket for each distance past the lowest start; a
+    // cell is in a bucket for every distance it was given, and only counts
+    // in the bucket of its smallest
+    QVector<QPair<int, int>> starts;
+    for (int cell : affected) {
+        int best = -1;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int neighbor = cell + offsets[direction];
+            if (
+                isOpen(cell, direction) &&
+                !affected.contains(neighbor) &&
+                d.at(neighbor) != -1 &&
+                (best == -1 || d.at(neighbor) + 1 < best)
+            ) {
+                best = d.at(neighbor) + 1;
+            }
+        }
+        if (best != -1) {
+            starts.append({best, cell});
+        }
+    }
+    for (int cell : affected) {
+        d[cell] = -1;
+        changed->append(cell);
+    }
+    if (starts.isEmpty()) {
+        return;
+    }
+    int lowest = std::min_element(starts.begin(), starts.end())->first;
+    QVector<QVector<int>> buckets;
+    auto give = [&](int cell, int distance) {
+        int bucket = distance - lowest;
+        if (buckets.size() <= bucket) {
+            buckets.resize(bucket + 1);
+        }
+        d[cell] = distance;
+        buckets[bucket].append(cell);
+    };
+    for (const QPair<int, int>& start : starts) {
+        give(start.second, start.first);
+    }
+    for (int bucket = 0; bucket < buckets.size(); bucket += 1) {
+        for (int i = 0; i < buckets.at(bucket).size(); i += 1) {
+            int cell = buckets.at(bucket).at(i);
+            if (d.at(cell) != lowest + bucket) {
+                continue;
+            }
+            for (int direction = 0; direction < 4; direction += 1) {
+                int neighbor = cell + offsets[direction];
+                if (
+                    isOpen(cell, direction) &&
+                    affected.contains(neighbor) &&
+                    (d.at(neighbor) == -1 || d.at(cell) + 1 < d.at(neighbor))
+                ) {
+                    give(neighbor, d.at(cell) + 1);
+                }
+            }
+        }
+    }
+}
+
+} 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+#include "Direction.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+class DynamicDistances {
+
+    // The number of moves from every cell to the nearest of a set of source
+    // cells, through a grid of walls, kept up to date as walls are added and
+    // removed. The distances are the same as a breadth first search from the
+    // sources would find (see Maze), -1 for cells that can't be reached, and
+    // cells are indexed by x * height + y. Rather than searching again, each
+    // change to a wall only visits the cells whose distances it changes, and
+    // their neighbors: opening a wall can only shorten the distances beyond
+    // it, which are relaxed outward from the nearer cell, and closing one can
+    // only lengthen the distances of the cells whose every shortest path went
+    // through it, which are found breadth first from the farther cell, and
+    // then settled again from the cells around them, with a bucket for each
+    // distance. The walls on the edges of the grid are always there.
+
+public:
+
+    DynamicDistances();
+    DynamicDistances(
+        const WallGrid& walls,
+        const QVector<QPair<int, int>>& sources);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getDistance(int x, int y) const;
+    const QVector<int>& getDistances() const;
+    bool isWall(int x, int y, Direction direction) const;
+    const WallGrid& getWalls() const;
+
+    // Adds or removes the wall on one side of a cell, and the same wall of
+    // the neighbor on that side; returns false, and changes nothing, for the
+    // walls on the edges. The cells whose distances changed are appended to
+    // changed, if it isn't nullptr.
+    bool setWall(
+        int x,
+        int y,
+        Direction direction,
+        bool isWall,
+        QVector<int>* changed = nullptr);
+
+    // Repairs distances that are kept elsewhere, e.g., by a maze, after the
+    // wall between two neighboring cells (by index) was added or removed in
+    // the walls, which must be enclosed and consistent; the cells whose
+    // distances changed are appended to changed
+    static void update(
+        const WallGrid& walls,
+        int first,
+        int second,
+        QVector<int>* distances,
+        QVector<int>* changed);
+
+private:
+
+    WallGrid m_walls;
+    QVector<int> m_distances;
+};
+
+} 
@@ -0,0 +1,292 @@
+#include "FloodFill.h"
+
+#include <utility>
+
+#include <QtAlgorithms>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int FloodFill::CROSSOVER = 400;
+
+bool FloodFill::isFaster(const WallGrid& walls) {
+
+    // Without loops, every cell but one is reached through a single open
+    // wall, so the number of loops is that of the open walls beyond those;
+    // the crossover, as measured on mazes with loops added at random, is
+    // about one loop per CROSSOVER cells for each cell along the longer
+    // side, i.e., 0.04 loops per cell at 16x16 and 0.08 at 32x32; chunks
+    // that share their walls share their count of open sides too
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    int numCells = width * height;
+    int numOpenSides = 0;
+    QVector<int> counts(walls.getNumChunkIds(), -1);
+    for (int chunk = 0; chunk < walls.getNumChunks(); chunk += 1) {
+        int begin = chunk * WallGrid::CHUNK_CELLS;
+        int end = qMin(numCells, begin + WallGrid::CHUNK_CELLS);
+        int id = walls.getChunkId(chunk);
+        if (0 <= counts.at(id) && isWhole(walls, chunk)) {
+            numOpenSides += counts.at(id);
+            continue;
+        }
+        int count = 0;
+        for (int cell = begin; cell < end; cell += 1) {
+            int open = ~walls.getWallBits(cell) & 0xf;
+            count += (open & 1) + (open >> 1 & 1) + (open >> 2 & 1) +
+                (open >> 3 & 1);
+        }
+        if (isWhole(walls, chunk)) {
+            counts[id] = count;
+        }
+        numOpenSides += count;
+    }
+    qint64 numLoops = numOpenSides / 2 - (numCells - 1);
+    return static_cast<qint64>(numCells) * qMax(width, height) <=
+        CROSSOVER * numLoops;
+}
+
+QVector<int> FloodFill::getMoveDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources) {
+
+    // The open masks, the cells reached so far, the frontier and the next
+    // frontier, in one allocation
+    Layout layout = getLayout(walls);
+    QVector<quint64> words(7 * layout.stride, 0);
+    quint64* open[4];
+    for (int direction = 0; direction < 4; direction += 1) {
+        open[direction] = getBitset(&words, layout, direction);
+    }
+    quint64* reached = getBitset(&words, layout, 4);
+    quint64* frontier = getBitset(&words, layout, 5);
+    quint64* next = getBitset(&words, layout, 6);
+    getOpenMasks(walls, layout, open);
+
+    QVector<int> distances(walls.getWidth() * walls.getHeight(), -1);
+    Range range = {layout.numWords, 0};
+    for (int cell : sources) {
+        frontier[cell / 64] |= quint64(1) << (cell % 64);
+        range = {qMin(range.begin, cell / 64), qMax(range.end, cell / 64 + 1)};
+    }
+    int distance = 0;
+    while (range.begin < range.end) {
+        assign(frontier, range, distance, &distances);
+        for (int i = range.begin; i < range.end; i += 1) {
+            reached[i] |= frontier[i];
+        }
+
+        // Each direction's neighbor is one bit (north and south) or one
+        // column (east and west) away
+        Range spread = getSpread(range, layout);
+        Range nextRange = {layout.numWords, 0};
+        for (int i = spread.begin; i < spread.end; i += 1) {
+            quint64 cells =
+                getShiftedUp(frontier, open[0], i, 0, 1) |
+                getShiftedUp(frontier, open[1], i, layout.columnWords,
+                    layout.columnBits) |
+                getShiftedDown(frontier, open[2], i, 0, 1) |
+                getShiftedDown(frontier, open[3], i, layout.columnWords,
+                    layout.columnBits);
+            next[i] = cells & ~reached[i];
+            if (next[i] != 0) {
+                nextRange = {qMin(nextRange.begin, i), i + 1};
+            }
+        }
+
+        // The old frontier is cleared, so that it can be the next one
+        for (int i = range.begin; i < range.end; i += 1) {
+            frontier[i] = 0;
+        }
+        std::swap(frontier, next);
+        range = nextRange;
+        distance += 1;
+    }
+    return distances;
+}
+
+QVector<int> FloodFill::getTurnDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources) {
+
+    // The open masks, then the states reached so far, the frontier and the
+    // next frontier for each heading, and the cells reached so far, in one
+    // allocation
+    Layout layout = getLayout(walls);
+    QVector<quint64> words(17 * layout.stride, 0);
+    quint64* open[4];
+    quint64* reached[4];
+    quint64* frontier[4];
+    quint64* next[4];
+    for (int heading = 0; heading < 4; heading += 1) {
+        open[heading] = getBitset(&words, layout, heading);
+        reached[heading] = getBitset(&words, layout, 4 + heading);
+        frontier[heading] = getBitset(&words, layout, 8 + heading);
+        next[heading] = getBitset(&words, layout, 12 + heading);
+    }
+    quint64* cells = getBitset(&words, layout, 16);
+    getOpenMasks(walls, layout, open);
+
+    // Every heading's frontier lies within the same range of words
+    QVector<int> distances(walls.getWidth() * walls.getHeight(), -1);
+    Range range = {layout.numWords, 0};
+    for (int cell : sources) {
+        for (int heading = 0; heading < 4; heading += 1) {
+            frontier[heading][cell / 64] |= quint64(1) << (cell % 64);
+        }
+        range = {qMin(range.begin, cell / 64), qMax(range.end, cell / 64 + 1)};
+    }
+    int distance = 0;
+    while (range.begin < range.end) {
+
+        // The cells that are first reached now, by any of their headings
+        for (int i = range.begin; i < range.end; i += 1) {
+            quint64 any = 0;
+            for (int heading = 0; heading < 4; heading += 1) {
+                any |= frontier[heading][i];
+                reached[heading][i] |= frontier[heading][i];
+            }
+            next[0][i] = any & ~cells[i];
+            cells[i] |= any;
+        }
+        assign(next[0], range, distance, &distances);
+
+        // The states are (cell, heading) pairs, and the search runs
+        // backwards from the sources, as in Maze: a state is reached by
+        // turning in place from either neighboring heading, or by moving
+        // forward from the cell behind it (its neighbor on the opposite
+        // side), if that cell is open on the side that's being headed to
+        Range spread = getSpread(range, layout);
+        Range nextRange = {layout.numWords, 0};
+        for (int heading = 0; heading < 4; heading += 1) {
+            const quint64* left = frontier[(heading + 1) % 4];
+            const quint64* right = frontier[(heading + 3) % 4];
+            const quint64* current = frontier[heading];
+            const quint64* behind = open[(heading + 2) % 4];
+            bool isColumn = heading % 2 == 1;
+            int words = isColumn ? layout.columnWords : 0;
+            int bits = isColumn ? layout.columnBits : 1;
+            for (int i = spread.begin; i < spread.end; i += 1) {
+                quint64 states = left[i] | right[i] | (
+                    heading < 2
+                        ? getShiftedDown(current, behind, i, words, bits)
+                        : getShiftedUp(current, behind, i, words, bits)
+                );
+                next[heading][i] = states & ~reached[heading][i];
+                if (next[heading][i] != 0) {
+                    nextRange.begin = qMin(nextRange.begin, i);
+                    nextRange.end = qMax(nextRange.end, i + 1);
+                }
+            }
+        }
+        for (int heading = 0; heading < 4; heading += 1) {
+            for (int i = range.begin; i < range.end; i += 1) {
+                frontier[heading][i] = 0;
+            }
+            std::swap(frontier[heading], next[heading]);
+        }
+        range = nextRange;
+        distance += 1;
+    }
+    return distances;
+}
+
+FloodFill::Layout FloodFill::getLayout(const WallGrid& walls) {
+    // Every bitset is padded on both sides by more words than a frontier
+    // ever spreads, and then shifts, so that nothing is read out of bounds
+    int height = walls.getHeight();
+    int numWords = (walls.getWidth() * height + 63) / 64;
+    int padding = 2 * ((height + 63) / 64) + 1;
+    return {
+        numWords,
+        numWords + 2 * padding,
+        padding,
+        height / 64,
+        height % 64,
+    };
+}
+
+quint64* FloodFill::getBitset(
+        QVector<quint64>* words,
+        const Layout& layout,
+        int index) {
+    return words->data() + index * layout.stride + layout.padding;
+}
+
+void FloodFill::getOpenMasks(
+        const WallGrid& walls,
+        const Layout& layout,
+        quint64* const* masks) {
+    int numCells = walls.getWidth() * walls.getHeight();
+    ASSERT_LE(numCells, 64 * layout.numWords);
+    static_assert(
+        WallGrid::CHUNK_CELLS % 64 == 0,
+        "Chunks must be whole words");
+
+    // Every chunk of the grid is a whole number of words, so the masks of a
+    // chunk are those of the first chunk with the same walls, which are only
+    // read cell by cell once
+    int numChunkWords = WallGrid::CHUNK_CELLS / 64;
+    QVector<int> firstChunks(walls.getNumChunkIds(), -1);
+    for (int chunk = 0; chunk < walls.getNumChunks(); chunk += 1) {
+        int id = walls.getChunkId(chunk);
+        int first = firstChunks.at(id);
+        if (0 <= first && isWhole(walls, chunk)) {
+            for (int direction = 0; direction < 4; direction += 1) {
+                for (int i = 0; i < numChunkWords; i += 1) {
+                    masks[direction][chunk * numChunkWords + i] =
+                        masks[direction][first * numChunkWords + i];
+                }
+            }
+            continue;
+        }
+        int begin = chunk * WallGrid::CHUNK_CELLS;
+        int end = qMin(numCells, begin + WallGrid::CHUNK_CELLS);
+        for (int cell = begin; cell < end; cell += 1) {
+            int open = ~walls.getWallBits(cell) & 0xf;
+            quint64 bit = quint64(1) << (cell % 64);
+            for (int direction = 0; direction < 4; direction += 1) {
+                if (open & (1 << direction)) {
+                    masks[direction][cell / 64] |= bit;
+                }
+            }
+        }
+        if (isWhole(walls, chunk)) {
+            firstChunks[id] = chunk;
+        }
+    }
+}
+
+bool FloodFill::isWhole(const WallGrid& walls, int chunk) {
+    int numCells = walls.getWidth() * walls.getHeight();
+    return (chunk + 1) * WallGrid::CHUNK_CELLS <= numCells;
+}
+
+FloodFill::Range FloodFill::getSpread(
+        const Range& range,
+        const Layout& layout) {
+    int words = layout.columnWords + 1;
+    return {
+        qMax(0, range.begin - words),
+        qMin(layout.numWords, range.end + words),
+    };
+}
+
+void FloodFill::assign(
+        const quint64* bits,
+        const Range& range,
+        int distance,
+        QVector<int>* distances) {
+    for (int i = range.begin; i < range.end; i += 1) {
+        quint64 word = bits[i];
+        while (word != 0) {
+            int cell = 64 * i + qCountTrailingZeroBits(word);
+            ASSERT_LT(cell, distances->size());
+            (*distances)[cell] = distance;
+            word &= word - 1;
+        }
+    }
+}
+
+} 
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <QVector>
+
+#include "WallGrid.h"
+
+namespace mms {
+
+class FloodFill {
+
+    // Breadth first searches through a grid of walls, a whole frontier at a
+    // time. Cells are bits of a bitset, by their index (x * height + y), 64
+    // to a word, and each direction has a mask of the cells that are open
+    // on that side; since the neighbor on each side is a fixed offset away,
+    // the next frontier is the current one, masked by each direction's mask
+    // and shifted by that direction's offset, less every cell that was
+    // already reached. Each step is a handful of shifts, ands and ors per
+    // word, only over the words that the frontier spans (and those that it
+    // can spread to), so that the long corridors of most mazes, whose
+    // frontiers are narrow, cost a few words per step, and open mazes,
+    // whose frontiers are wide, cost a few operations per 64 cells; each
+    // cell is only touched again to write its distance down, on the step
+    // that reaches it. The grid must be enclosed.
+    //
+    // The distances are exactly those of a queue-based search (see Maze),
+    // -1 for cells that can't be reached.
+
+public:
+
+    FloodFill() = delete;
+
+    // Whether these searches are faster than a queue's for the grid; each
+    // step costs about the same however many cells the frontier holds, so
+    // they only pay off when frontiers are wide, i.e., when the maze has
+    // enough loops
+    static bool isFaster(const WallGrid& walls);
+
+    // The number of moves from every cell to the nearest source
+    static QVector<int> getMoveDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources);
+
+    // The number of moves plus turns (by 90 degrees) from every cell to the
+    // nearest source, facing whichever way is best; the search is over a
+    // bitset of the cells for each heading, and a cell's distance is that of
+    // the first of its headings that's reached
+    static QVector<int> getTurnDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources);
+
+private:
+
+    static const int CROSSOVER;
+
+    // Where the bitsets are within their allocation: each is numWords long,
+    // padded on both sides, and a column of cells is columnWords words plus
+    // columnBits bits
+    struct Layout {
+        int numWords;
+        int stride;
+        int padding;
+        int columnWords;
+        int columnBits;
+    };
+    static Layout getLayout(const WallGrid& walls);
+    static quint64* getBitset(
+        QVector<quint64>* words,
+        const Layout& layout,
+        int index);
+
+    // A span of words, from begin up to (but not including) end
+    struct Range {
+        int begin;
+        int end;
+    };
+
+    // The cells that are open on each side, one bitset for each direction,
+    // in the order of DIRECTIONS
+    static void getOpenMasks(
+        const WallGrid& walls,
+        const Layout& layout,
+        quint64* const* masks);
+
+    // Whether the chunk of the grid (see WallGrid) is all cells, i.e., isn't
+    // a last chunk that's cut short; only whole chunks with the same id are
+    // counted, or masked, the same
+    static bool isWhole(const WallGrid& walls, int chunk);
+
+    // The words that a frontier in the range can spread to in one step
+    static Range getSpread(const Range& range, const Layout& layout);
+
+    // Word i of the cells that are in both bits and mask, moved up (or
+    // down) by 64 * words + low bits
+    static quint64 getShiftedUp(
+        const quint64* bits,
+        const quint64* mask,
+        int i,
+        int words,
+        int low);
+    static quint64 getShiftedDown(
+        const quint64* bits,
+        const quint64* mask,
+        int i,
+        int words,
+        int low);
+
+    // Sets the distance of every cell in the words of the range
+    static void assign(
+        const quint64* bits,
+        const Range& range,
+        int distance,
+        QVector<int>* distances);
+
+};
+
+inline quint64 FloodFill::getShiftedUp(
+        const quint64* bits,
+        const quint64* mask,
+        int i,
+        int words,
+        int low) {
+    int j = i - words;
+    quint64 value = (bits[j] & mask[j]) << low;
+    if (low != 0) {
+        value |= (bits[j - 1] & mask[j - 1]) >> (64 - low);
+    }
+    return value;
+}
+
+inline quint64 FloodFill::getShiftedDown(
+        const quint64* bits,
+        const quint64* mask,
+        int i,
+        int words,
+        int low) {
+    int j = i + words;
+    quint64 value = (bits[j] & mask[j]) >> low;
+    if (low != 0) {
+        value |= (bits[j + 1] & mask[j + 1]) << (64 - low);
+    }
+    return value;
+}
+
+} 
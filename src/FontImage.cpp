@@ -1,11 +1,43 @@
 #include "FontImage.h"
 
+#include <thread>
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFont>
+#include <QFontDatabase>
+#include <QFontMetricsF>
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPointF>
+#include <QRectF>
+#include <QtEndian>
+#include <QtMath>
+
 namespace mms {
 
+const int FontImage::NUM_CELLS = 256;
+const int FontImage::CELL_WIDTH = 16;
+const int FontImage::CELL_HEIGHT = 32;
+const int FontImage::DISTANCE_FIELD_RADIUS = 4;
+const QByteArray FontImage::FIELD_MAGIC = "MMSF";
+const quint16 FontImage::FIELD_VERSION = 1;
+const int FontImage::GLYPH_GRAY = 191;
+
+QMutex FontImage::RASTERIZED_MUTEX;
+QHash<ushort, FontImage::Glyph> FontImage::RASTERIZED_GLYPHS;
+QVector<QImage> FontImage::RASTERIZED_FIELDS;
+
 QString FontImage::path() {
     return ":/resources/fonts/Unispace-Bold.png";
 }
 
+QString FontImage::fieldPath() {
+    return ":/resources/fonts/Unispace-Bold.field";
+}
+
 QString FontImage::characters() {
     // Must match the font image, else the wrong
     // characters will be displayed on the tiles
@@ -16,20 +48,200 @@ QString FontImage::characters() {
     );
 }
 
+FontImage::Glyph FontImage::glyph(QChar c) {
+    static const Glyph* glyphs = buildGlyphs();
+    ushort code = c.unicode();
+    if (code < NUM_GLYPHS) {
+        return glyphs[code];
+    }
+
+    // Whether a character can be rasterized is only ever decided once
+    QMutexLocker locker(&RASTERIZED_MUTEX);
+    auto it = RASTERIZED_GLYPHS.constFind(code);
+    if (it != RASTERIZED_GLYPHS.constEnd()) {
+        return it.value();
+    }
+    Glyph glyph = {0.0, 0.0, false};
+    int cell = characters().size() + RASTERIZED_FIELDS.size();
+    if (cell < NUM_CELLS) {
+        QImage image = rasterize(c);
+        if (!image.isNull()) {
+            RASTERIZED_FIELDS.append(toDistanceField(image, CELL_WIDTH));
+            glyph = getCellGlyph(cell);
+        }
+    }
+    RASTERIZED_GLYPHS.insert(code, glyph);
+    return glyph;
+}
+
+bool FontImage::isValid(QChar c) {
+    return glyph(c).isValid;
+}
+
+QVector<QImage> FontImage::rasterizedFields(int first) {
+    QMutexLocker locker(&RASTERIZED_MUTEX);
+    return RASTERIZED_FIELDS.mid(first);
+}
+
+const FontImage::Glyph* FontImage::buildGlyphs() {
+    static Glyph glyphs[NUM_GLYPHS] = {};
+    // Map from char to fractional position in the atlas (from 0.0 to 1.0)
+    QString chars = characters();
+    for (int i = 0; i < chars.size(); i += 1) {
+        glyphs[chars.at(i).unicode()] = getCellGlyph(i);
+    }
+    return glyphs;
+}
+
+FontImage::Glyph FontImage::getCellGlyph(int cell) {
+    double start = static_cast<double>(cell) / static_cast<double>(NUM_CELLS);
+    double end =
+        static_cast<double>(cell + 1) / static_cast<double>(NUM_CELLS);
+    return {static_cast<float>(start), static_cast<float>(end), true};
+}
+
+QImage FontImage::rasterize(QChar c) {
+    // Fonts can only be used once the GUI is up, which the headless modes
+    // never bring up
+    if (
+        qobject_cast<QGuiApplication*>(QCoreApplication::instance()) ==
+            nullptr ||
+        c.isSurrogate() || c.isSpace() || !c.isPrint()
+    ) {
+        return QImage();
+    }
+
+    // The glyph is centered in its cell, and shrunk to fit if it's wide
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setBold(true);
+    font.setPixelSize(CELL_HEIGHT * 3 / 4);
+    QRectF bounds = QFontMetricsF(font).boundingRect(c);
+    if (bounds.isEmpty()) {
+        return QImage();
+    }
+    double scale = qMin(
+        1.0,
+        qMin(
+            (CELL_WIDTH - 2.0) / bounds.width(),
+            (CELL_HEIGHT - 2.0) / bounds.height()
+        )
+    );
+    QImage image(CELL_WIDTH, CELL_HEIGHT, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setFont(font);
+    painter.setPen(QColor(GLYPH_GRAY, GLYPH_GRAY, GLYPH_GRAY));
+    painter.translate(0.5 * CELL_WIDTH, 0.5 * CELL_HEIGHT);
+    painter.scale(scale, scale);
+    painter.translate(-bounds.center());
+    painter.drawText(QPointF(0.0, 0.0), QString(c));
+    painter.end();
+
+    // A character that the font (and its fallbacks) can't draw is blank
+    for (int y = 0; y < image.height(); y += 1) {
+        for (int x = 0; x < image.width(); x += 1) {
+            if (128 <= qAlpha(image.pixel(x, y))) {
+                return image;
+            }
+        }
+    }
+    return QImage();
+}
+
+QImage FontImage::distanceField() {
+    static const QImage field = buildDistanceField();
+    return field;
+}
+
+bool FontImage::readPrecomputedField(
+        QByteArray* pixels,
+        int* width,
+        int* height) {
+    QFile file(fieldPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray contents = file.readAll();
+    int headerSize = FIELD_MAGIC.size() + 6;
+    if (contents.size() < headerSize || !contents.startsWith(FIELD_MAGIC)) {
+        return false;
+    }
+    const uchar* header =
+        reinterpret_cast<const uchar*>(contents.constData()) +
+        FIELD_MAGIC.size();
+    if (qFromLittleEndian<quint16>(header) != FIELD_VERSION) {
+        return false;
+    }
+    *width = qFromLittleEndian<quint16>(header + 2);
+    *height = qFromLittleEndian<quint16>(header + 4);
+    if (contents.size() - headerSize != 4 * *width * *height) {
+        return false;
+    }
+    *pixels = contents.mid(headerSize);
+    return true;
+}
+
+void FontImage::prepare() {
+    if (QFile::exists(fieldPath())) {
+        return;
+    }
+    std::thread([]() {
+        distanceField();
+    }).detach();
+}
+
+QImage FontImage::buildDistanceField() {
+    QImage image = QImage(path()).convertToFormat(QImage::Format_ARGB32);
+    return toDistanceField(image, image.width() / characters().size());
+}
+
+QImage FontImage::toDistanceField(const QImage& image, int cellWidth) {
+    int width = image.width();
+    int height = image.height();
+    int radius = DISTANCE_FIELD_RADIUS;
+
+    // Classify each pixel, and find the color of the glyphs
+    QVector<bool> inside(width * height);
+    QRgb color = qRgb(255, 255, 255);
+    int maxAlpha = 0;
+    for (int y = 0; y < height; y += 1) {
+        for (int x = 0; x < width; x += 1) {
+            QRgb pixel = image.pixel(x, y);
+            inside[y * width + x] = 128 <= qAlpha(pixel);
+            if (maxAlpha < qAlpha(pixel)) {
+                maxAlpha = qAlpha(pixel);
+                color = pixel;
+            }
+        }
+    }
 
-QMap<QChar, QPair<double, double>> FontImage::positions() {
-    static QMap<QChar, QPair<double, double>> map;
-    if (map.isEmpty()) {
-        // Map from char to fractional position in the image (from 0.0 to 1.0)
-        QString chars = characters();
-        int size = chars.size();
-        for (int i = 0; i < size; i += 1) {
-            double start = static_cast<double>(i) / static_cast<double>(size);
-            double end = static_cast<double>(i + 1) / static_cast<double>(size);
-            map.insert(chars.at(i), {start, end});
+    // For each pixel, search for the nearest pixel on the other side of an
+    // edge, without looking past the cell of the pixel's character
+    QImage field(width, height, QImage::Format_ARGB32);
+    for (int y = 0; y < height; y += 1) {
+        for (int x = 0; x < width; x += 1) {
+            int cellStart = (x / cellWidth) * cellWidth;
+            bool isInside = inside.at(y * width + x);
+            double nearest = radius;
+            for (int j = qMax(0, y - radius); j <= qMin(height - 1, y + radius); j += 1) {
+                for (
+                    int i = qMax(cellStart, x - radius);
+                    i <= qMin(cellStart + cellWidth - 1, x + radius);
+                    i += 1
+                ) {
+                    if (inside.at(j * width + i) != isInside) {
+                        nearest = qMin(nearest, qSqrt((i - x) * (i - x) + (j - y) * (j - y)));
+                    }
+                }
+            }
+            // The edge lies halfway between the two pixels
+            double distance = (isInside ? 1 : -1) * (nearest - 0.5);
+            int alpha = qBound(0, qRound(255 * (0.5 + distance / (2 * radius))), 255);
+            field.setPixel(x, y, qRgba(qRed(color), qGreen(color), qBlue(color), alpha));
         }
     }
-    return map;
+    return field;
 }
 
 } 
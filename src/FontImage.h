@@ -1,8 +1,11 @@
 #pragma once
 
+#include <QByteArray>
 #include <QChar>
-#include <QMap>
-#include <QPair>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QVector>
 
 namespace mms {
 
@@ -12,7 +15,92 @@ public:
     FontImage() = delete;
     static QString path();
     static QString characters();
-    static QMap<QChar, QPair<double, double>> positions();
+
+    // The atlas that glyphs are drawn from is a row of NUM_CELLS cells, each
+    // CELL_WIDTH by CELL_HEIGHT pixels, as util/ttf2png.py makes them: first
+    // the characters of the font image, and then, in the order that they're
+    // first used, any other characters, rasterized on demand from the
+    // system's fixed-width font, until the atlas is full
+    static const int NUM_CELLS;
+    static const int CELL_WIDTH;
+    static const int CELL_HEIGHT;
+
+    // The horizontal range of a character in the atlas, as fractions of the
+    // atlas width (from 0.0 to 1.0)
+    struct Glyph {
+        float start;
+        float end;
+        bool isValid;
+    };
+
+    // Looks an ASCII character up in a table, built once; any other
+    // character is rasterized the first time that it's looked up (which only
+    // the GUI can do, with fonts), and looked up in a hash, under a lock,
+    // from then on. Characters that aren't in the font image and can't be
+    // rasterized, or don't fit in the atlas, map to an invalid glyph.
+    static Glyph glyph(QChar c);
+    static bool isValid(QChar c);
+
+    // The distance fields (see below) of the cells rasterized on demand, in
+    // order, starting from the given one of them (counting from zero)
+    static QVector<QImage> rasterizedFields(int first);
+
+    // The font image, with its alpha channel replaced by the signed distance
+    // to the nearest edge of a glyph: 0.5 at the edge, increasing inside.
+    // Unlike the alpha channel, this can be interpolated, so that glyphs
+    // have sharp edges at any scale. Built once, on first use, by whichever
+    // thread gets there first; the others wait for it.
+    static QImage distanceField();
+
+    // The distance field, precomputed by util/ttf2png.py, and shipped next
+    // to the font image: already flipped for OpenGL (bottom row first), and
+    // already RGBA bytes, so that it can be uploaded as it is. Returns false
+    // if it isn't shipped, or is malformed, in which case the distance field
+    // has to be built instead.
+    static QString fieldPath();
+    static bool readPrecomputedField(
+        QByteArray* pixels,
+        int* width,
+        int* height);
+
+    // Unless it's shipped precomputed, starts building the distance field on
+    // a thread of its own, so that it's (more likely to be) ready by the time
+    // the first map is drawn
+    static void prepare();
+
+private:
+
+    // The distance, in pixels, at which the field saturates
+    static const int DISTANCE_FIELD_RADIUS;
+
+    // The header of a precomputed distance field, which is followed by its
+    // 16-bit version, width and height, little-endian, and then its pixels
+    static const QByteArray FIELD_MAGIC;
+    static const quint16 FIELD_VERSION;
+
+    // The color of the glyphs, as util/ttf2png.py fills them
+    static const int GLYPH_GRAY;
+
+    // The number of entries in the glyph table
+    static const int NUM_GLYPHS = 128;
+    static const Glyph* buildGlyphs();
+    static Glyph getCellGlyph(int cell);
+    static QImage buildDistanceField();
+
+    // The signed distance field of an image of glyphs, each in a cell of its
+    // own, with the color of the most opaque pixel
+    static QImage toDistanceField(const QImage& image, int cellWidth);
+
+    // The characters rasterized so far (or that couldn't be), and their
+    // distance fields, guarded by the mutex
+    static QMutex RASTERIZED_MUTEX;
+    static QHash<ushort, Glyph> RASTERIZED_GLYPHS;
+    static QVector<QImage> RASTERIZED_FIELDS;
+
+    // A glyph of the fixed-width font in a cell, or a null image if the
+    // character can't be drawn (e.g., it's a space, or without an
+    // application that has fonts) or is blank
+    static QImage rasterize(QChar c);
 
 };
 
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace mms {
+
+// Measurements of a single paint of the map. The GPU times are read back
+// asynchronously, so they belong to the most recent frame whose timer
+// queries had completed (gpuFrame), and are negative if no frame has been
+// timed yet or if timer queries aren't supported. Swaps happen after the
+// paint, so the swap interval and missed refreshes belong to the frame before.
+// Allocations are only counted while the allocation counter is enabled, and
+// are negative otherwise.
+struct FrameStats {
+    int frame; // number of the frame, counting from one
+    double paintSeconds; // CPU time spent in paintGL
+    double uploadSeconds; // CPU time spent populating and uploading buffers
+    long long uploadBytes; // bytes written to buffer objects and textures
+    int tilesUploaded; // tile records written to the tile buffer
+    int glyphsUploaded; // glyph records written to the glyph buffer
+    int trianglesUploaded; // triangles of the mouse mesh, if it was rebuilt
+    int drawCalls; // number of draw calls issued
+    int trianglesDrawn; // triangles that those draw calls submitted
+    int gpuFrame; // number of the frame that the GPU times belong to
+    double gpuTilesSeconds; // GPU time spent drawing the tiles
+    double gpuTextSeconds; // GPU time spent drawing the tile text
+    double gpuMouseSeconds; // GPU time spent drawing the mouse
+    double swapSeconds; // time between the last two swaps, or negative
+    int missedRefreshes; // refreshes of the display missed so far
+    int textUploadInterval; // frames between uploads of the tile text
+    long long allocations; // heap allocations made in paintGL
+    long long allocatedBytes; // bytes that those allocations asked for
+};
+
+} 
@@ -14,19 +14,39 @@ Coordinate GeometryUtilities::rotateVertexAroundPoint(
     const Coordinate& point,
     const Angle& angle
 ) {
-    Coordinate relativeVertex = Coordinate::Cartesian(
-        vertex.getX() - point.getX(),
-        vertex.getY() - point.getY()
-    );
-    Coordinate rotatedRelativeVertex = Coordinate::Polar(
-        relativeVertex.getRho(),
-        relativeVertex.getTheta() + angle
-    );
-    Coordinate rotatedVertex = Coordinate::Cartesian(
-        rotatedRelativeVertex.getX() + point.getX(),
-        rotatedRelativeVertex.getY() + point.getY()
-    );
-    return rotatedVertex;
+    return rotateVertexAroundPoint(vertex, point, Rotation(angle));
+}
+
+Coordinate GeometryUtilities::rotateVertexAroundPoint(
+    const Coordinate& vertex,
+    const Coordinate& point,
+    const Rotation& rotation
+) {
+    return rotation.rotateAroundPoint(vertex, point);
+}
+
+void GeometryUtilities::transformVertices(
+    const Coordinate* vertices,
+    int count,
+    const Coordinate& translation,
+    const Rotation& rotation,
+    const Coordinate& point,
+    Coordinate* output
+) {
+    // Translating by t and then rotating around p is the same as rotating
+    // around the origin and then adding p + R(t - p)
+    double sin = rotation.getSin();
+    double cos = rotation.getCos();
+    Coordinate offset = point + rotation.rotate(translation - point);
+    double offsetX = offset.getX().getMeters();
+    double offsetY = offset.getY().getMeters();
+    for (int i = 0; i < count; i += 1) {
+        double x = vertices[i].getX().getMeters();
+        double y = vertices[i].getY().getMeters();
+        output[i] = Coordinate::Cartesian(
+            Distance::Meters(x * cos - y * sin + offsetX),
+            Distance::Meters(x * sin + y * cos + offsetY));
+    }
 }
 
 } 
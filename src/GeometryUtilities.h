@@ -2,6 +2,7 @@
 
 #include "units/Angle.h"
 #include "units/Coordinate.h"
+#include "units/Rotation.h"
 
 namespace mms {
 
@@ -19,6 +20,25 @@ public:
         const Coordinate& vertex,
         const Coordinate& point,
         const Angle& angle);
+
+    // Prefer this when rotating many vertices by the same angle, since the
+    // rotation's sine and cosine are only computed once
+    static Coordinate rotateVertexAroundPoint(
+        const Coordinate& vertex,
+        const Coordinate& point,
+        const Rotation& rotation);
+
+    // Translates count vertices, and then rotates them around point, writing
+    // the results to output (which may be the same array as vertices). The
+    // loop is branch-free over contiguous doubles, so that the compiler can
+    // vectorize it.
+    static void transformVertices(
+        const Coordinate* vertices,
+        int count,
+        const Coordinate& translation,
+        const Rotation& rotation,
+        const Coordinate& point,
+        Coordinate* output);
 };
 
 } 
@@ -0,0 +1,84 @@
+#include "GhostRun.h"
+
+#include <algorithm>
+
+namespace mms {
+
+GhostRun::GhostRun(const QString& name, const Maze* maze, const TraceRun& run) :
+    m_name(name),
+    m_maze(maze),
+    m_view(new MazeView(maze)),
+    m_replay(new TraceReplay(maze, m_view, run)),
+    m_mouseGraphic(new MouseGraphic(m_replay->getMouse())),
+    m_ticks(QVector<qint64>()),
+    m_solveTicks(-1) {
+    init();
+}
+
+GhostRun::GhostRun(
+        const QString& name,
+        const Maze* maze,
+        const QVector<Command>& commands) :
+    m_name(name),
+    m_maze(maze),
+    m_view(new MazeView(maze)),
+    m_replay(new TraceReplay(maze, m_view, commands)),
+    m_mouseGraphic(new MouseGraphic(m_replay->getMouse())),
+    m_ticks(QVector<qint64>()),
+    m_solveTicks(-1) {
+    init();
+}
+
+GhostRun::~GhostRun() {
+    delete m_mouseGraphic;
+    delete m_replay;
+    delete m_view;
+}
+
+QString GhostRun::getName() const {
+    return m_name;
+}
+
+const MouseGraphic* GhostRun::getMouseGraphic() const {
+    return m_mouseGraphic;
+}
+
+qint64 GhostRun::getSolveTicks() const {
+    return m_solveTicks;
+}
+
+bool GhostRun::syncTo(qint64 ticks) {
+
+    // The last position at which the time hadn't passed yet, i.e., the one
+    // just before the movement that was in progress
+    int position = static_cast<int>(
+        std::upper_bound(m_ticks.constBegin(), m_ticks.constEnd(), ticks) -
+        m_ticks.constBegin()
+    ) - 1;
+    position = qMax(0, position);
+    if (position == m_replay->getPosition()) {
+        return false;
+    }
+    m_replay->seek(position);
+    return true;
+}
+
+void GhostRun::init() {
+
+    // Movements are instant, so the clock only moves on movements
+    const Mouse* mouse = m_replay->getMouse();
+    m_ticks.reserve(m_replay->getLength() + 1);
+    m_ticks.append(m_replay->getClock().getTicks());
+    for (int i = 0; i < m_replay->getLength(); i += 1) {
+        m_replay->seek(i + 1);
+        m_ticks.append(m_replay->getClock().getTicks());
+        QPair<int, int> cell = mouse->getCurrentDiscretizedTranslation();
+        bool isInCenter = m_maze->getDistance(cell.first, cell.second) == 0;
+        if (m_solveTicks == -1 && isInCenter) {
+            m_solveTicks = m_ticks.last();
+        }
+    }
+    m_replay->seek(0);
+}
+
+} 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "Command.h"
+#include "CommandTrace.h"
+#include "Maze.h"
+#include "MazeView.h"
+#include "MouseGraphic.h"
+#include "TraceReplay.h"
+
+namespace mms {
+
+class GhostRun {
+
+    // A previous run of the same maze (or a reference solver's run), replayed
+    // alongside a live run so that the two can be watched side by side. The
+    // run is replayed once up front, to find the simulated time after each
+    // of its commands, and then kept at the command that it was on at the
+    // live run's time, so a ghost moves a cell at a time rather than
+    // smoothly. Only its mouse is ever shown; its view is its own, and isn't.
+
+public:
+
+    // No ownership of the maze
+    GhostRun(const QString& name, const Maze* maze, const TraceRun& run);
+    GhostRun(
+        const QString& name,
+        const Maze* maze,
+        const QVector<Command>& commands);
+    ~GhostRun();
+
+    QString getName() const;
+    const MouseGraphic* getMouseGraphic() const;
+
+    // The simulated time at which the run first reached the center, or -1
+    // if it never did
+    qint64 getSolveTicks() const;
+
+    // Moves the ghost to where its run was after the given simulated time
+    // since it started; returns whether the ghost moved
+    bool syncTo(qint64 ticks);
+
+private:
+
+    QString m_name;
+    const Maze* m_maze;
+    MazeView* m_view;
+    TraceReplay* m_replay;
+    MouseGraphic* m_mouseGraphic;
+
+    // The simulated time after each number of commands
+    QVector<qint64> m_ticks;
+    qint64 m_solveTicks;
+
+    void init();
+};
+
+} 
@@ -0,0 +1,24 @@
+#pragma once
+
+namespace mms {
+
+// A single glyph of tile text, drawn as an instance of a unit quad; unused
+// glyphs have no area, and so aren't drawn. Edges are positioned relative to
+// the glyph's tile, and texture coordinates relative to the width of the
+// texture, both as normalized 16-bit values (0 is 0.0, MAX_NORMALIZED is 1.0),
+// which keeps every field two byte aligned and the record at 16 bytes.
+struct GlyphInstance {
+
+    static const unsigned short MAX_NORMALIZED = 65535;
+
+    unsigned short x; // x position of the tile
+    unsigned short y; // y position of the tile
+    unsigned short left; // fraction of the tile left of the left edge
+    unsigned short bottom; // fraction of the tile below the bottom edge
+    unsigned short right; // fraction of the tile left of the right edge
+    unsigned short top; // fraction of the tile below the top edge
+    unsigned short uLeft; // u position of the left edge (fraction of width)
+    unsigned short uRight; // u position of the right edge (fraction of width)
+};
+
+} 
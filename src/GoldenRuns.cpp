@@ -0,0 +1,309 @@
+#include "GoldenRuns.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMap>
+#include <QPair>
+#include <QTextStream>
+
+#include "AssertMacros.h"
+#include "Command.h"
+#include "CommandParser.h"
+#include "Direction.h"
+#include "MazeError.h"
+#include "MazeGenerator.h"
+#include "MazeLibrary.h"
+#include "Mouse.h"
+#include "ReferenceSolvers.h"
+#include "TileGraphic.h"
+
+namespace mms {
+
+const QString GoldenRuns::PROTOCOL_RUNNER = "protocol";
+const QString GoldenRuns::MAZE_DIRECTORY = ":/resources/mazes";
+const int GoldenRuns::GOLDEN_VERSION = 1;
+const int GoldenRuns::PROTOCOL_STEPS_PER_CELL = 4;
+const int GoldenRuns::CRASH_INTERVAL = 17;
+
+bool GoldenRuns::run(const QString& goldenPath, bool update) {
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Every runner on every maze, in a fixed order, timing only the engine
+    QVector<GoldenRun> runs;
+    qint64 solverNanoseconds = 0;
+    qint64 solverCommands = 0;
+    qint64 protocolNanoseconds = 0;
+    qint64 protocolCommands = 0;
+    for (const QString& path : MazeLibrary::getMazeFiles(MAZE_DIRECTORY)) {
+        MazeError error;
+        Maze* maze = MazeGenerator::load(path, &error);
+        if (maze == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to load the bundled maze \"" << path << "\": "
+                << Maze::errorToString(error);
+            return false;
+        }
+        QString name = QFileInfo(path).fileName();
+        for (const QString& solver : ReferenceSolvers::names()) {
+            GoldenRun run = {name, solver, 0, 0, 0, 0, false, QString()};
+            solverNanoseconds += runCommands(
+                maze,
+                ReferenceSolvers::getCommands(solver, maze),
+                &run
+            );
+            solverCommands += run.commands;
+            runs.append(run);
+        }
+        GoldenRun run = {name, PROTOCOL_RUNNER, 0, 0, 0, 0, false, QString()};
+        protocolNanoseconds += runProtocol(maze, &run);
+        protocolCommands += run.commands;
+        runs.append(run);
+        delete maze;
+    }
+
+    QTextStream out(stdout);
+    auto printTiming = [&](
+            const QString& name,
+            qint64 commands,
+            qint64 nanoseconds) {
+        double perCommand = 0 < commands
+            ? static_cast<double>(nanoseconds) / commands
+            : 0.0;
+        out << name << ": " << commands << " commands in "
+            << QString::number(nanoseconds / 1e6, 'f', 1) << " ms ("
+            << QString::number(perCommand, 'f', 0) << " ns per command)"
+            << endl;
+    };
+    printTiming("solvers", solverCommands, solverNanoseconds);
+    printTiming(PROTOCOL_RUNNER, protocolCommands, protocolNanoseconds);
+
+    if (update) {
+        QJsonArray array;
+        for (const GoldenRun& run : runs) {
+            array.append(toJson(run));
+        }
+        QJsonObject object;
+        object["version"] = GOLDEN_VERSION;
+        object["runs"] = array;
+        QFile file(goldenPath);
+        if (
+            !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            file.write(QJsonDocument(object).toJson()) < 0
+        ) {
+            qWarning().noquote().nospace()
+                << "Unable to write the golden runs \"" << goldenPath << "\"";
+            return false;
+        }
+        out << "Wrote " << runs.size() << " golden runs in "
+            << timer.elapsed() << " ms" << endl;
+        return true;
+    }
+
+    // Read the golden runs back, by maze and runner
+    QFile file(goldenPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning().noquote().nospace()
+            << "Unable to read the golden runs \"" << goldenPath << "\"";
+        return false;
+    }
+    QJsonObject object = QJsonDocument::fromJson(file.readAll()).object();
+    if (object["version"].toInt() != GOLDEN_VERSION) {
+        qWarning().noquote().nospace()
+            << "The golden runs \"" << goldenPath
+            << "\" aren't of version " << GOLDEN_VERSION;
+        return false;
+    }
+    QMap<QString, GoldenRun> golden;
+    for (const QJsonValue& value : object["runs"].toArray()) {
+        GoldenRun run = fromJson(value.toObject());
+        golden.insert(getKey(run), run);
+    }
+
+    int numDifferent = 0;
+    for (const GoldenRun& run : runs) {
+        QString key = getKey(run);
+        if (!golden.contains(key)) {
+            out << key << ": no golden run" << endl;
+            numDifferent += 1;
+            continue;
+        }
+        GoldenRun expected = golden.take(key);
+        if (toJson(run) != toJson(expected)) {
+            out << key << ": expected " << QJsonDocument(
+                toJson(expected)).toJson(QJsonDocument::Compact)
+                << ", got " << QJsonDocument(
+                toJson(run)).toJson(QJsonDocument::Compact) << endl;
+            numDifferent += 1;
+        }
+    }
+    for (const QString& key : golden.keys()) {
+        out << key << ": not run" << endl;
+        numDifferent += 1;
+    }
+    out << runs.size() - numDifferent << " of " << runs.size()
+        << " runs match, in " << timer.elapsed() << " ms" << endl;
+    return numDifferent == 0;
+}
+
+qint64 GoldenRuns::runCommands(
+        const Maze* maze,
+        const QVector<Command>& commands,
+        GoldenRun* run) {
+
+    // The solvers' commands are already parsed, so only their specs are
+    // needed, as for a replay
+    QVector<const CommandSpec*> specs(NUM_OPCODES, nullptr);
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        specs[static_cast<int>(spec.opcode)] = &spec;
+    }
+    MazeView view(maze);
+    SimulationEngine engine(maze, &view);
+    engine.setInstant(true);
+    QByteArray responses;
+    QElapsedTimer timer;
+    timer.start();
+    for (const Command& command : commands) {
+        const CommandSpec* spec = specs.at(static_cast<int>(command.opcode));
+        ASSERT_FA(spec == nullptr);
+        responses += engine.executeNow(command, spec).toUtf8() + "\n";
+    }
+    qint64 nanoseconds = timer.nsecsElapsed();
+    finish(maze, &view, engine, responses, run);
+    return nanoseconds;
+}
+
+qint64 GoldenRuns::runProtocol(const Maze* maze, GoldenRun* run) {
+
+    MazeView view(maze);
+    SimulationEngine engine(maze, &view);
+    engine.setInstant(true);
+    QByteArray responses;
+    qint64 nanoseconds = 0;
+    auto send = [&](const QString& line) {
+        QElapsedTimer timer;
+        timer.start();
+        Command command;
+        const CommandSpec* spec = CommandParser::parse(line, &command);
+        ASSERT_FA(spec == nullptr);
+        QString response = engine.executeNow(command, spec);
+        nanoseconds += timer.nsecsElapsed();
+        responses += (line + " " + response + "\n").toUtf8();
+        return response;
+    };
+
+    // The client keeps track of where it is, like any algorithm, and only
+    // moves if the engine says that it did
+    int x = 0;
+    int y = 0;
+    Direction direction = Direction::NORTH;
+    auto moveForward = [&]() {
+        if (send("moveForward") == SimulationEngine::ACK) {
+            x += DIRECTION_DX(direction);
+            y += DIRECTION_DY(direction);
+        }
+    };
+    int numSteps =
+        PROTOCOL_STEPS_PER_CELL * maze->getWidth() * maze->getHeight();
+    for (int step = 1; step <= numSteps; step += 1) {
+        if (engine.hasReachedCenter()) {
+            break;
+        }
+        if (step % CRASH_INTERVAL == 0) {
+            moveForward();
+        }
+        else if (send("wallLeft") == "false") {
+            send("turnLeft");
+            direction = DIRECTION_ROTATE_LEFT(direction);
+            moveForward();
+        }
+        else if (send("wallFront") == "false") {
+            moveForward();
+        }
+        else {
+            send(QString("setWall %1 %2 %3").arg(x).arg(y).arg(
+                DIRECTION_TO_CHAR(direction)));
+            send("turnRight");
+            direction = DIRECTION_ROTATE_RIGHT(direction);
+        }
+        send(QString("setColor %1 %2 g").arg(x).arg(y));
+        send(QString("setText %1 %2 %3").arg(x).arg(y).arg(step));
+    }
+    finish(maze, &view, engine, responses, run);
+    return nanoseconds;
+}
+
+void GoldenRuns::finish(
+        const Maze* maze,
+        MazeView* view,
+        const SimulationEngine& engine,
+        const QByteArray& responses,
+        GoldenRun* run) {
+    run->moves = engine.getNumMoves();
+    run->turns = engine.getNumTurns();
+    run->crashes = engine.getNumCrashes();
+    run->commands = engine.getNumCommands();
+    run->reachedCenter = engine.hasReachedCenter();
+
+    // The simulated time is rounded, so that only changes to what the run
+    // does change the hash, and not the last bits of a sum
+    QByteArray state = responses;
+    QTextStream stream(&state, QIODevice::Append);
+    const Mouse* mouse = engine.getMouse();
+    QPair<int, int> location = mouse->getCurrentDiscretizedTranslation();
+    stream
+        << location.first << " " << location.second << " "
+        << DIRECTION_TO_CHAR(mouse->getCurrentDiscretizedRotation()) << " "
+        << QString::number(engine.getSimulatedSeconds(), 'g', 9) << "\n";
+    for (int x = 0; x < maze->getWidth(); x += 1) {
+        for (int y = 0; y < maze->getHeight(); y += 1) {
+            TileState tile = view->getMazeGraphic()->getTileState(x, y);
+            stream
+                << static_cast<int>(tile.declaredWalls) << " "
+                << static_cast<int>(tile.color) << " "
+                << tile.heat << " " << tile.text << "\n";
+        }
+    }
+    stream.flush();
+    run->hash = QString::fromLatin1(
+        QCryptographicHash::hash(state, QCryptographicHash::Sha1).toHex()
+    );
+}
+
+QJsonObject GoldenRuns::toJson(const GoldenRun& run) {
+    QJsonObject object;
+    object["maze"] = run.maze;
+    object["runner"] = run.runner;
+    object["moves"] = run.moves;
+    object["turns"] = run.turns;
+    object["crashes"] = run.crashes;
+    object["commands"] = static_cast<double>(run.commands);
+    object["reachedCenter"] = run.reachedCenter;
+    object["hash"] = run.hash;
+    return object;
+}
+
+GoldenRun GoldenRuns::fromJson(const QJsonObject& object) {
+    return {
+        object["maze"].toString(),
+        object["runner"].toString(),
+        object["moves"].toInt(),
+        object["turns"].toInt(),
+        object["crashes"].toInt(),
+        static_cast<qint64>(object["commands"].toDouble()),
+        object["reachedCenter"].toBool(),
+        object["hash"].toString(),
+    };
+}
+
+QString GoldenRuns::getKey(const GoldenRun& run) {
+    return run.maze + " " + run.runner;
+}
+
+} 
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Maze.h"
+#include "MazeView.h"
+#include "SimulationEngine.h"
+
+namespace mms {
+
+// What a run did, as far as its golden result is concerned: its counts, and
+// a hash of the final state of the mouse and the view, and of every
+// response along the way
+struct GoldenRun {
+    QString maze; // the name of the maze file
+    QString runner; // a reference solver, or PROTOCOL_RUNNER
+    int moves;
+    int turns;
+    int crashes;
+    qint64 commands;
+    bool reachedCenter;
+    QString hash;
+};
+
+class GoldenRuns {
+
+    // Runs every bundled maze (see resources/mazes) in an instant, headless
+    // engine, once with the commands of each reference solver, and once with
+    // a scripted client that talks the text protocol, line by line, through
+    // the same parser as any algorithm: it follows the left wall, marks the
+    // walls that it senses, colors and labels the cells that it visits, and
+    // every so often moves forward without looking, to crash. The results
+    // are compared with golden results that are checked in, so that a change
+    // to the engine can't change what a run does without it being noticed;
+    // the time spent in the engine is reported for each kind of runner.
+
+public:
+
+    GoldenRuns() = delete;
+
+    static const QString PROTOCOL_RUNNER;
+
+    // Compares every run with its golden result, printing each one that
+    // differs, or is missing from either side; with update, writes the
+    // results to the golden path instead. Returns false if any run differs,
+    // or the golden results couldn't be read or written.
+    static bool run(const QString& goldenPath, bool update);
+
+private:
+
+    static const QString MAZE_DIRECTORY;
+    static const int GOLDEN_VERSION;
+
+    // The scripted client gives up after this many steps per cell, and
+    // moves forward without looking every CRASH_INTERVAL steps
+    static const int PROTOCOL_STEPS_PER_CELL;
+    static const int CRASH_INTERVAL;
+
+    // Each returns the nanoseconds spent in the engine
+    static qint64 runCommands(
+        const Maze* maze,
+        const QVector<Command>& commands,
+        GoldenRun* run);
+    static qint64 runProtocol(const Maze* maze, GoldenRun* run);
+
+    static void finish(
+        const Maze* maze,
+        MazeView* view,
+        const SimulationEngine& engine,
+        const QByteArray& responses,
+        GoldenRun* run);
+
+    static QJsonObject toJson(const GoldenRun& run);
+    static GoldenRun fromJson(const QJsonObject& object);
+    static QString getKey(const GoldenRun& run);
+
+};
+
+} 
@@ -0,0 +1,648 @@
+#include "HeadlessRun.h"
+
+#include <QDebug>
+
+#include "AssertMacros.h"
+#include "CommandParser.h"
+#include "ProcessUtilities.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+HeadlessRun::HeadlessRun(
+        const QString& mazePath,
+        Maze* maze,
+        const QStringList& runArguments,
+        const QString& directory,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool useSharedMemory,
+        bool isReusable,
+        bool isContinuous,
+        QObject* parent) :
+    QObject(parent),
+    m_mazePath(mazePath),
+    m_maze(maze),
+    m_runArguments(runArguments),
+    m_directory(directory),
+    m_tickLimit(tickLimit),
+    m_commandLimit(-1),
+    m_moveLimit(-1),
+    m_processLimits(ProcessUtilities::getNoLimits()),
+    m_cpu(-1),
+    m_latency(nullptr),
+    m_isContest(false),
+    m_contestRules(ContestScorer::DEFAULT_RULES()),
+    m_mouseDefinition(MouseDefinition::getDefault()),
+    m_sensorNoise(SensorNoise()),
+    m_isReusable(isReusable),
+    m_isContinuous(isContinuous),
+    m_engine(nullptr),
+    m_process(new QProcess(this)),
+    m_timeLimitTimer(new QTimer(this)),
+    m_commandFramer(LineFramer()),
+    m_meter(new RunMeter(this)),
+    m_transport(useSharedMemory ? new SharedMemoryTransport(this) : nullptr),
+    m_transportFramer(LineFramer()),
+    m_readBytes(QByteArray()),
+    m_commandLine(QString()),
+    m_responseBytes(QByteArray()),
+    m_startTimestamp(0.0),
+    m_hasClaimedMaze(false),
+    m_isMazeFinished(false),
+    m_isFinished(false),
+    m_result(getUnrunResult(mazePath, RunStatus::FAILED_TO_START, QString())) {
+
+    ASSERT_FA(m_maze == nullptr);
+    m_readBytes.reserve(LineFramer::RESERVED_BYTES);
+    m_responseBytes.reserve(LineFramer::RESERVED_BYTES);
+    createEngine();
+
+    // Stderr is discarded, commands are read from stdout
+    m_process->setStandardErrorFile(QProcess::nullDevice());
+    connect(
+        m_process,
+        &QProcess::readyReadStandardOutput,
+        this,
+        &HeadlessRun::onOutput
+    );
+    connect(
+        m_process,
+        static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(
+            &QProcess::finished
+        ),
+        this,
+        &HeadlessRun::onExit
+    );
+
+    // The process is started without waiting for it, and a process that
+    // fails to start never exits
+    connect(
+        m_process,
+        &QProcess::started,
+        this,
+        &HeadlessRun::onStarted
+    );
+    connect(
+        m_process,
+        &QProcess::errorOccurred,
+        this,
+        [=](QProcess::ProcessError error){
+            if (error == QProcess::FailedToStart) {
+                finish(RunStatus::FAILED_TO_START);
+            }
+        }
+    );
+
+    // Commands may also arrive through shared memory, if it's in use
+    if (m_transport != nullptr) {
+        connect(
+            m_transport,
+            &SharedMemoryTransport::readyRead,
+            this,
+            &HeadlessRun::onTransportOutput
+        );
+    }
+
+    // Don't let a stuck algorithm hold on to its slot forever, though a
+    // contest that has a score is merely done
+    m_timeLimitTimer->setSingleShot(true);
+    m_timeLimitTimer->setInterval(timeLimitSeconds * 1000);
+    connect(m_timeLimitTimer, &QTimer::timeout, this, [=](){
+        if (isContestScored()) {
+            finish(RunStatus::SOLVED);
+            return;
+        }
+        finishOnLimit("time limit", true);
+    });
+}
+
+HeadlessRun::~HeadlessRun() {
+    // Make sure the process is dead before it's deleted
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished();
+    }
+    delete m_maze;
+}
+
+void HeadlessRun::setStepLimits(qint64 commandLimit, int moveLimit) {
+    m_commandLimit = commandLimit;
+    m_moveLimit = moveLimit;
+    m_engine->setCommandLimit(m_commandLimit);
+    m_engine->setMoveLimit(m_moveLimit);
+}
+
+void HeadlessRun::setProcessLimits(const ProcessLimits& limits, int cpu) {
+    m_processLimits = limits;
+    m_cpu = cpu;
+}
+
+void HeadlessRun::setLatency(CommandLatency* latency) {
+    m_latency = latency;
+    m_engine->setLatency(m_latency);
+}
+
+void HeadlessRun::setContestRules(const ContestRules& rules) {
+    ASSERT_FA(m_isReusable);
+    m_isContest = true;
+    m_contestRules = rules;
+    m_engine->setContestRules(m_contestRules);
+}
+
+void HeadlessRun::setMouseDefinition(
+        std::shared_ptr<const MouseDefinition> definition) {
+    m_mouseDefinition = definition;
+    m_engine->setMouseDefinition(m_mouseDefinition);
+}
+
+void HeadlessRun::setSensorNoise(const SensorNoise& noise) {
+    m_sensorNoise = noise;
+    m_engine->setSensorNoise(m_sensorNoise);
+}
+
+void HeadlessRun::start() {
+    m_startTimestamp = SimUtilities::getHighResTimestamp();
+    m_meter->start();
+    if (m_transport != nullptr) {
+        if (!m_transport->open()) {
+            finish(RunStatus::FAILED_TO_START);
+            return;
+        }
+        QProcessEnvironment environment =
+            QProcessEnvironment::systemEnvironment();
+        m_transport->addToEnvironment(&environment);
+        m_process->setProcessEnvironment(environment);
+    }
+
+    // The time limit includes the time that it takes to start
+    m_timeLimitTimer->start();
+    ProcessUtilities::start(m_runArguments, m_directory, m_process);
+}
+
+RunResult HeadlessRun::getResult() const {
+    return m_result;
+}
+
+const Mouse* HeadlessRun::getMouse() const {
+    return m_engine->getMouse();
+}
+
+void HeadlessRun::setNextMaze(const QString& mazePath, Maze* maze) {
+    ASSERT_FA(maze == nullptr);
+    ASSERT_TR(m_isMazeFinished);
+
+    // Nothing refers to the old engine or maze from here on, once it has
+    // sent whatever it was holding back
+    m_engine->flushResponses();
+    delete m_engine;
+    delete m_maze;
+    m_mazePath = mazePath;
+    m_maze = maze;
+    createEngine();
+
+    // The new maze is already claimed, by the request that it answers
+    m_hasClaimedMaze = true;
+    m_isMazeFinished = false;
+    m_result = getUnrunResult(mazePath, RunStatus::FAILED_TO_START, QString());
+    m_startTimestamp = SimUtilities::getHighResTimestamp();
+    m_meter->restart();
+    m_timeLimitTimer->start();
+    onResponse(QString("%1 %2").arg(
+        QString::number(m_maze->getWidth()),
+        QString::number(m_maze->getHeight())
+    ));
+}
+
+QString HeadlessRun::statusToString(RunStatus status) {
+    switch (status) {
+        case RunStatus::SOLVED:
+            return "SOLVED";
+        case RunStatus::EXITED:
+            return "EXITED";
+        case RunStatus::TIMEOUT:
+            return "TIMEOUT";
+        case RunStatus::FAILED_TO_START:
+            return "ERROR";
+        case RunStatus::INVALID_MAZE:
+            return "INVALID";
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+RunResult HeadlessRun::getUnrunResult(
+        const QString& mazePath,
+        RunStatus status,
+        const QString& error) {
+    return {
+        mazePath,
+        status,
+        0,
+        0,
+        0,
+        0,
+        0.0,
+        0.0,
+        0.0,
+        0,
+        CoverageStats(),
+        KnownWallStats(),
+        {0, 0, -1, -1.0, -1.0, 0.0, false},
+        error,
+        false,
+        RunStats(),
+        QString(),
+        QString(),
+    };
+}
+
+QJsonObject HeadlessRun::resultToJson(const RunResult& result) {
+    QJsonObject coverage;
+    coverage["numCells"] = result.coverage.numCells;
+    coverage["numVisited"] = result.coverage.numVisited;
+    coverage["numRevisits"] = result.coverage.numRevisits;
+    coverage["numVisitedBeforeCenter"] =
+        result.coverage.numVisitedBeforeCenter;
+    QJsonObject knownWalls;
+    knownWalls["numWalls"] = result.knownWalls.numWalls;
+    knownWalls["numKnown"] = result.knownWalls.numKnown;
+    knownWalls["numWrong"] = result.knownWalls.numWrong;
+    QJsonObject contest;
+    contest["numRuns"] = result.contest.numRuns;
+    contest["numTouches"] = result.contest.numTouches;
+    contest["bestRun"] = result.contest.bestRun;
+    contest["bestRunSeconds"] = result.contest.bestRunSeconds;
+    contest["score"] = result.contest.score;
+    contest["mazeSeconds"] = result.contest.mazeSeconds;
+    contest["isOver"] = result.contest.isOver;
+    QJsonObject stats;
+    stats["wallSeconds"] = result.stats.wallSeconds;
+    stats["cpuSeconds"] = result.stats.cpuSeconds;
+    stats["peakResidentBytes"] =
+        static_cast<double>(result.stats.peakResidentBytes);
+    stats["commands"] = result.stats.commands;
+    stats["commandsPerSecond"] = result.stats.commandsPerSecond;
+    stats["bytesIn"] = static_cast<double>(result.stats.bytesIn);
+    stats["bytesOut"] = static_cast<double>(result.stats.bytesOut);
+    stats["simulatorSeconds"] = result.stats.simulatorSeconds;
+    stats["algorithmSeconds"] = result.stats.algorithmSeconds;
+    stats["thinks"] = result.stats.thinks;
+    stats["thinkP50Seconds"] = result.stats.thinkP50Seconds;
+    stats["thinkP99Seconds"] = result.stats.thinkP99Seconds;
+    stats["thinkMaxSeconds"] = result.stats.thinkMaxSeconds;
+    QJsonObject object;
+    object["maze"] = result.mazePath;
+    object["status"] = statusToString(result.status);
+    object["moves"] = result.moves;
+    object["turns"] = result.turns;
+    object["crashes"] = result.crashes;
+    object["resets"] = result.resets;
+    object["seconds"] = result.seconds;
+    object["simulatedSeconds"] = result.simulatedSeconds;
+    object["estimatedSeconds"] = result.estimatedSeconds;
+    object["ticks"] = static_cast<double>(result.ticks);
+    object["coverage"] = coverage;
+    object["knownWalls"] = knownWalls;
+    object["contest"] = contest;
+    object["error"] = result.error;
+    object["timeLimited"] = result.isTimeLimited;
+    object["stats"] = stats;
+    object["limits"] = result.limits;
+    return object;
+}
+
+RunResult HeadlessRun::resultFromJson(const QJsonObject& object) {
+
+    // Every status has its own name
+    QString name = object["status"].toString();
+    RunStatus status = RunStatus::FAILED_TO_START;
+    bool isKnown = false;
+    for (RunStatus candidate : {
+        RunStatus::SOLVED,
+        RunStatus::EXITED,
+        RunStatus::TIMEOUT,
+        RunStatus::FAILED_TO_START,
+        RunStatus::INVALID_MAZE,
+    }) {
+        if (statusToString(candidate) == name) {
+            status = candidate;
+            isKnown = true;
+        }
+    }
+    RunResult result = getUnrunResult(
+        object["maze"].toString(),
+        status,
+        object["error"].toString()
+    );
+    if (!isKnown) {
+        result.error = "Not a valid result";
+        return result;
+    }
+
+    QJsonObject coverage = object["coverage"].toObject();
+    QJsonObject knownWalls = object["knownWalls"].toObject();
+    QJsonObject contest = object["contest"].toObject();
+    QJsonObject stats = object["stats"].toObject();
+    result.isTimeLimited = object["timeLimited"].toBool();
+    result.moves = object["moves"].toInt();
+    result.turns = object["turns"].toInt();
+    result.crashes = object["crashes"].toInt();
+    result.resets = object["resets"].toInt();
+    result.seconds = object["seconds"].toDouble();
+    result.simulatedSeconds = object["simulatedSeconds"].toDouble();
+    result.estimatedSeconds = object["estimatedSeconds"].toDouble();
+    result.ticks = static_cast<qint64>(object["ticks"].toDouble());
+    result.coverage.numCells = coverage["numCells"].toInt();
+    result.coverage.numVisited = coverage["numVisited"].toInt();
+    result.coverage.numRevisits = coverage["numRevisits"].toInt();
+    result.coverage.numVisitedBeforeCenter =
+        coverage["numVisitedBeforeCenter"].toInt(-1);
+    result.knownWalls.numWalls = knownWalls["numWalls"].toInt();
+    result.knownWalls.numKnown = knownWalls["numKnown"].toInt();
+    result.knownWalls.numWrong = knownWalls["numWrong"].toInt();
+    result.contest.numRuns = contest["numRuns"].toInt();
+    result.contest.numTouches = contest["numTouches"].toInt();
+    result.contest.bestRun = contest["bestRun"].toInt(-1);
+    result.contest.bestRunSeconds = contest["bestRunSeconds"].toDouble(-1.0);
+    result.contest.score = contest["score"].toDouble(-1.0);
+    result.contest.mazeSeconds = contest["mazeSeconds"].toDouble();
+    result.contest.isOver = contest["isOver"].toBool();
+    result.stats.wallSeconds = stats["wallSeconds"].toDouble();
+    result.stats.cpuSeconds = stats["cpuSeconds"].toDouble(-1.0);
+    result.stats.peakResidentBytes =
+        static_cast<qint64>(stats["peakResidentBytes"].toDouble(-1.0));
+    result.stats.commands = stats["commands"].toInt();
+    result.stats.commandsPerSecond = stats["commandsPerSecond"].toDouble();
+    result.stats.bytesIn = static_cast<qint64>(stats["bytesIn"].toDouble());
+    result.stats.bytesOut = static_cast<qint64>(stats["bytesOut"].toDouble());
+    result.stats.simulatorSeconds = stats["simulatorSeconds"].toDouble();
+    result.stats.algorithmSeconds = stats["algorithmSeconds"].toDouble();
+    result.stats.thinks = stats["thinks"].toInt();
+    result.stats.thinkP50Seconds = stats["thinkP50Seconds"].toDouble();
+    result.stats.thinkP99Seconds = stats["thinkP99Seconds"].toDouble();
+    result.stats.thinkMaxSeconds = stats["thinkMaxSeconds"].toDouble();
+    result.limits = object["limits"].toString();
+    return result;
+}
+
+void HeadlessRun::createEngine() {
+
+    // Nothing to look at, so don't animate anything; continuous movements
+    // are still simulated, just as fast as they can be
+    m_engine = new SimulationEngine(m_maze, nullptr, this);
+    m_engine->setInstant(true);
+    m_engine->setContinuous(m_isContinuous);
+    m_engine->setTickLimit(m_tickLimit);
+    m_engine->setCommandLimit(m_commandLimit);
+    m_engine->setMoveLimit(m_moveLimit);
+    m_engine->setLatency(m_latency);
+    m_engine->setSharedMemoryAvailable(m_transport != nullptr);
+    m_engine->setContestRules(m_contestRules);
+    m_engine->setMouseDefinition(m_mouseDefinition);
+    m_engine->setSensorNoise(m_sensorNoise);
+    connect(
+        m_engine,
+        &SimulationEngine::responsesReady,
+        this,
+        &HeadlessRun::onResponses
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::centerReached,
+        this,
+        &HeadlessRun::onCenterReached
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::contestOver,
+        this,
+        &HeadlessRun::onContestOver
+    );
+    connect(m_engine, &SimulationEngine::tickLimitReached, this, [=](){
+        finishOnLimit("tick limit");
+    });
+    connect(m_engine, &SimulationEngine::stepLimitReached, this, [=](){
+        finishOnLimit(
+            0 <= m_commandLimit && m_commandLimit < m_engine->getNumCommands()
+            ? "command limit"
+            : "move limit"
+        );
+    });
+}
+
+void HeadlessRun::onOutput() {
+    m_readBytes.resize(static_cast<int>(m_process->bytesAvailable()));
+    qint64 size = m_process->read(m_readBytes.data(), m_readBytes.size());
+    if (size <= 0) {
+        return;
+    }
+    m_meter->recordInput(size);
+    m_commandFramer.append(m_readBytes.constData(), static_cast<int>(size));
+    m_engine->beginResponseBatch();
+    while (m_commandFramer.nextLine(&m_commandLine)) {
+        dispatchCommand(m_commandLine);
+    }
+    m_engine->endResponseBatch();
+}
+
+void HeadlessRun::onTransportOutput() {
+    m_transport->readAll(&m_readBytes);
+    m_meter->recordInput(m_readBytes.size());
+    m_transportFramer.append(m_readBytes);
+    m_engine->beginResponseBatch();
+    while (m_transportFramer.nextLine(&m_commandLine)) {
+        dispatchCommand(m_commandLine);
+    }
+    m_engine->endResponseBatch();
+}
+
+void HeadlessRun::dispatchCommand(const QString& command) {
+    if (m_isFinished) {
+        return;
+    }
+    Command parsed;
+    const CommandSpec* spec = CommandParser::parse(command, &parsed);
+    if (spec == nullptr) {
+        return;
+    }
+    m_meter->beginCommand(spec->hasResponse);
+    // Only reusable runs have more than one maze to hand out
+    if (m_isReusable && parsed.opcode == Opcode::NEXT_MAZE) {
+        onNextMaze();
+    }
+    else {
+        m_engine->dispatchCommand(parsed, spec);
+    }
+    m_meter->endCommand();
+}
+
+void HeadlessRun::onNextMaze() {
+
+    // The first request claims the maze that the run started with
+    if (!m_hasClaimedMaze) {
+        m_hasClaimedMaze = true;
+        onResponse(QString("%1 %2").arg(
+            QString::number(m_maze->getWidth()),
+            QString::number(m_maze->getHeight())
+        ));
+        return;
+    }
+
+    // Any later request gives up on the current maze, if it isn't solved
+    finishMaze(RunStatus::EXITED);
+    emit nextMazeRequested();
+    if (m_isMazeFinished) {
+        onResponse(SimulationEngine::NO_MAZE);
+        finish(RunStatus::EXITED);
+    }
+}
+
+void HeadlessRun::onResponse(const QString& response) {
+    // The engine's responses that are being held back came first
+    m_engine->flushResponses();
+    LineFramer::encode(response, &m_responseBytes);
+    onResponses(m_responseBytes, 1);
+}
+
+void HeadlessRun::onResponses(const QByteArray& bytes, int numResponses) {
+    m_meter->recordResponse(bytes.size(), numResponses);
+    // Respond through shared memory if the algorithm has started using it
+    if (m_transport != nullptr && m_transport->isInUse()) {
+        m_transport->write(bytes);
+        return;
+    }
+    m_process->write(bytes.constData(), bytes.size());
+}
+
+void HeadlessRun::onStarted() {
+
+    // Isolate the process before it has done much of anything
+    QString error;
+    bool isIsolated = ProcessUtilities::applyLimits(
+        m_process->processId(),
+        m_processLimits,
+        m_cpu,
+        &error
+    );
+    if (isIsolated) {
+        m_appliedLimits =
+            ProcessUtilities::limitsToString(m_processLimits, m_cpu);
+    }
+    else {
+        qWarning().noquote().nospace()
+            << "Unable to isolate the algorithm for \"" << m_mazePath
+            << "\": " << error;
+    }
+    m_meter->setProcessId(m_process->processId());
+    if (m_transport != nullptr) {
+        m_transport->start();
+    }
+}
+
+void HeadlessRun::onExit(int exitCode, QProcess::ExitStatus exitStatus) {
+    Q_UNUSED(exitCode);
+    Q_UNUSED(exitStatus);
+    finish(isContestScored() ? RunStatus::SOLVED : RunStatus::EXITED);
+}
+
+void HeadlessRun::onCenterReached() {
+
+    // A contest goes on for as long as more runs can count
+    if (m_isContest) {
+        return;
+    }
+
+    // The process is only kept around if it has shown that it knows how to
+    // ask for another maze
+    if (!m_isReusable || !m_hasClaimedMaze) {
+        finish(RunStatus::SOLVED);
+        return;
+    }
+
+    // Let the algorithm know that it's done with this maze, and give it
+    // another time limit to ask for the next one
+    finishMaze(RunStatus::SOLVED);
+    m_engine->requestReset();
+    m_timeLimitTimer->start();
+}
+
+void HeadlessRun::onContestOver() {
+    if (!m_isContest) {
+        return;
+    }
+    if (isContestScored()) {
+        finish(RunStatus::SOLVED);
+        return;
+    }
+    finishOnLimit("contest time limit");
+}
+
+bool HeadlessRun::isContestScored() const {
+    return m_isContest && 0 <= m_engine->getContestScore().bestRun;
+}
+
+void HeadlessRun::finishMaze(RunStatus status) {
+
+    // Only the first reason for finishing a maze counts
+    if (m_isMazeFinished) {
+        return;
+    }
+    m_isMazeFinished = true;
+    m_result.status = status;
+    m_result.moves = m_engine->getNumMoves();
+    m_result.turns = m_engine->getNumTurns();
+    m_result.crashes = m_engine->getNumCrashes();
+    m_result.resets = m_engine->getEstimatedTrialSeconds().size() - 1;
+    m_result.seconds = SimUtilities::getHighResTimestamp() - m_startTimestamp;
+    m_result.simulatedSeconds = m_engine->getSimulatedSeconds();
+    m_result.estimatedSeconds = m_engine->getEstimatedTrialSeconds().last();
+    m_result.ticks = m_engine->getClock().getTicks();
+    m_result.coverage = m_engine->getCoverage();
+    m_result.knownWalls = m_engine->getKnownWallStats();
+    m_result.contest = m_engine->getContestScore();
+    m_meter->stop();
+    m_result.stats = m_meter->getStats();
+    m_result.limits = m_appliedLimits;
+    emit mazeFinished();
+}
+
+void HeadlessRun::finish(RunStatus status) {
+
+    // The current maze ends with the run
+    finishMaze(status);
+
+    // Only the first reason for finishing counts
+    if (m_isFinished) {
+        return;
+    }
+    m_isFinished = true;
+
+    // Stop consuming commands
+    m_engine->stop();
+    m_timeLimitTimer->stop();
+    if (m_transport != nullptr) {
+        m_transport->stop();
+    }
+
+    // Stop producing commands
+    if (m_process->state() != QProcess::NotRunning) {
+        m_process->disconnect(this);
+        m_process->kill();
+        m_process->waitForFinished();
+    }
+
+    emit finished();
+}
+
+void HeadlessRun::finishOnLimit(const QString& limit, bool isTimeLimit) {
+    // Whatever the maze had come to is kept, along with why it ended
+    if (!m_isMazeFinished) {
+        m_result.error = "ran past the " + limit;
+        m_result.isTimeLimited = isTimeLimit;
+    }
+    finish(RunStatus::TIMEOUT);
+}
+
+} 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <memory>
+
+#include <QJsonObject>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "CommandLatency.h"
+#include "ContestScorer.h"
+#include "CoverageStats.h"
+#include "KnownWalls.h"
+#include "LineFramer.h"
+#include "Maze.h"
+#include "MouseDefinition.h"
+#include "ProcessLimits.h"
+#include "RunMeter.h"
+#include "RunStats.h"
+#include "SensorNoise.h"
+#include "SharedMemoryTransport.h"
+#include "SimulationEngine.h"
+
+namespace mms {
+
+enum class RunStatus {
+    SOLVED,
+    EXITED,
+    TIMEOUT,
+    FAILED_TO_START,
+    INVALID_MAZE,
+};
+
+struct RunResult {
+    QString mazePath;
+    RunStatus status;
+    int moves;
+    int turns;
+    int crashes; // movements refused because of a wall
+    int resets; // acknowledged, i.e., the number of trials before the last
+    double seconds;
+    double simulatedSeconds; // of continuous movements, if they were
+    double estimatedSeconds; // of the last trial, by the run time model
+    qint64 ticks; // of the simulation clock, the same on every machine
+    CoverageStats coverage; // of the maze, by the mouse
+    KnownWallStats knownWalls; // as declared by the algorithm
+    ContestScore contest; // of the whole maze, by the rules of the run
+    QString error; // why the maze was rejected, or which limit ended it
+    bool isTimeLimited; // ended by the time limit, unlike on other machines
+    RunStats stats; // not meaningful for rejected mazes
+    QString limits; // how the process was isolated, see ProcessLimits
+    QString duplicateOf; // the maze whose result this is, if it wasn't run
+};
+
+class HeadlessRun : public QObject {
+
+    // Runs a single algorithm process against a single maze, with no window
+    // and no view. The run ends when the mouse first reaches the center, when
+    // the process exits, or when the time limit expires; a tick limit, if
+    // there is one, ends the run once the simulation clock passes it, at the
+    // same point on every machine, while the time limit only catches stuck
+    // algorithms. Command and move limits, if there are any, likewise bound
+    // the work that an algorithm may do. A run that hits any limit is
+    // killed and recorded as a timeout, with whatever it had done so far,
+    // and the limit that it hit as its error.
+    //
+    // A run that's a contest doesn't end at the center: the algorithm may
+    // go back to the start, on its own or with a reset, for more runs, and
+    // the run ends once no more of them can count (see ContestScorer), when
+    // the process exits, or at the time limit. It's solved if any run has
+    // counted by then, and otherwise ends as it would have. Every run is
+    // scored by the default rules anyway, even if it isn't a contest.
+    //
+    // Reusable runs may go on to more mazes, in the same process, if the
+    // algorithm asks for them. Its first nextMaze claims the maze it was
+    // started for; once the mouse reaches the center, a reset is requested,
+    // and its next nextMaze moves on to another maze (giving up on the
+    // current one, if it hasn't been solved). Reaching the center only ends
+    // the run if the algorithm never asked for a maze.
+
+    Q_OBJECT
+
+public:
+
+    // Takes ownership of the maze
+    HeadlessRun(
+        const QString& mazePath,
+        Maze* maze,
+        const QStringList& runArguments,
+        const QString& directory,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool useSharedMemory,
+        bool isReusable,
+        bool isContinuous,
+        QObject* parent = 0);
+    ~HeadlessRun();
+
+    // To be called before the run starts; negative limits are no limits,
+    // and every maze of a reusable run gets the same limits afresh
+    void setStepLimits(qint64 commandLimit, int moveLimit);
+
+    // Likewise; the process is isolated as soon as it has started, and the
+    // CPU is only used if it's to be pinned. Limits that can't be applied
+    // are reported, and left out of the result.
+    void setProcessLimits(const ProcessLimits& limits, int cpu);
+
+    // Likewise; the latency of every command, on every maze, is recorded
+    // into the given histograms, which may be shared by any number of runs
+    void setLatency(CommandLatency* latency);
+
+    // Likewise; makes the run a contest, with the given rules, which can't
+    // be combined with a reusable run
+    void setContestRules(const ContestRules& rules);
+
+    // Likewise; the mouse of every maze that the run plays
+    void setMouseDefinition(std::shared_ptr<const MouseDefinition> definition);
+
+    // Likewise; the walls that the algorithm reads are misread by the noise,
+    // with every maze of a reusable run reading from the start of its stream
+    void setSensorNoise(const SensorNoise& noise);
+
+    void start();
+
+    // The result for the current maze, once mazeFinished has been emitted
+    RunResult getResult() const;
+
+    // The mouse on the current maze, which is only read, e.g., to be shown
+    const Mouse* getMouse() const;
+
+    // To be called in response to nextMazeRequested, if there is a next
+    // maze; takes ownership of the maze
+    void setNextMaze(const QString& mazePath, Maze* maze);
+
+    static QString statusToString(RunStatus status);
+
+    // The result for a maze that was never run, e.g. because it's invalid
+    static RunResult getUnrunResult(
+        const QString& mazePath,
+        RunStatus status,
+        const QString& error);
+
+    // Results travel between machines as JSON objects, with every field; an
+    // object that isn't a result gives a result with an error
+    static QJsonObject resultToJson(const RunResult& result);
+    static RunResult resultFromJson(const QJsonObject& object);
+
+signals:
+
+    // Emitted once for every maze, before the run moves on or finishes
+    void mazeFinished();
+
+    // Emitted when the algorithm asks for another maze; nothing is sent to
+    // the algorithm if setNextMaze isn't called (directly) in response
+    void nextMazeRequested();
+
+    // Emitted once the process is gone and the run is over
+    void finished();
+
+private:
+
+    QString m_mazePath;
+    Maze* m_maze;
+    QStringList m_runArguments;
+    QString m_directory;
+    qint64 m_tickLimit;
+    qint64 m_commandLimit;
+    int m_moveLimit;
+    ProcessLimits m_processLimits;
+    int m_cpu;
+    QString m_appliedLimits;
+    CommandLatency* m_latency;
+    bool m_isContest;
+    ContestRules m_contestRules;
+    std::shared_ptr<const MouseDefinition> m_mouseDefinition;
+    SensorNoise m_sensorNoise;
+    bool m_isReusable;
+    bool m_isContinuous;
+
+    SimulationEngine* m_engine;
+    QProcess* m_process;
+    QTimer* m_timeLimitTimer;
+    LineFramer m_commandFramer;
+    RunMeter* m_meter;
+
+    // Only used if the algorithm talks through shared memory
+    SharedMemoryTransport* m_transport;
+    LineFramer m_transportFramer;
+
+    // Every read, command and response passes through the same storage, so
+    // that a command's round trip doesn't allocate
+    QByteArray m_readBytes;
+    QString m_commandLine;
+    QByteArray m_responseBytes;
+
+    double m_startTimestamp;
+    bool m_hasClaimedMaze;
+    bool m_isMazeFinished;
+    bool m_isFinished;
+    RunResult m_result;
+
+    void createEngine();
+    void onOutput();
+    void onTransportOutput();
+    void dispatchCommand(const QString& command);
+    void onNextMaze();
+    void onResponse(const QString& response);
+    void onResponses(const QByteArray& bytes, int numResponses);
+    void onStarted();
+    void onExit(int exitCode, QProcess::ExitStatus exitStatus);
+    void onCenterReached();
+    void onContestOver();
+    bool isContestScored() const;
+
+    // Records the result for the current maze; finishing the run finishes
+    // the current maze too, unless it's already finished
+    void finishMaze(RunStatus status);
+    void finish(RunStatus status);
+    void finishOnLimit(const QString& limit, bool isTimeLimit = false);
+};
+
+} 
@@ -0,0 +1,56 @@
+#include "KnownWalls.h"
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+KnownWalls::KnownWalls() :
+    m_truth(nullptr),
+    m_stats({0, 0, 0}) {
+}
+
+KnownWalls::KnownWalls(const WallGrid* truth) :
+    m_truth(truth),
+    m_known(truth->getWidth(), truth->getHeight()),
+    m_declared(truth->getWidth(), truth->getHeight()),
+    m_stats({0, 0, 0}) {
+
+    // Every cell has a wall to the north and to the east of it, and the
+    // cells of the edges have the walls to the south and to the west
+    int width = truth->getWidth();
+    int height = truth->getHeight();
+    m_stats.numWalls = 2 * width * height + width + height;
+}
+
+void KnownWalls::declare(int x, int y, Direction direction, bool isWall) {
+    ASSERT_FA(m_truth == nullptr);
+    bool wasKnown = m_known.isWall(x, y, direction);
+    bool isTrue = m_truth->isWall(x, y, direction);
+    bool wasWrong = wasKnown && m_declared.isWall(x, y, direction) != isTrue;
+    bool isWrong = isWall != isTrue;
+    m_stats.numKnown += wasKnown ? 0 : 1;
+    m_stats.numWrong += (isWrong ? 1 : 0) - (wasWrong ? 1 : 0);
+
+    m_known.setWall(x, y, direction, true);
+    m_declared.setWall(x, y, direction, isWall);
+    int nx = x + DIRECTION_DX(direction);
+    int ny = y + DIRECTION_DY(direction);
+    if (0 <= nx && nx < m_truth->getWidth() &&
+        0 <= ny && ny < m_truth->getHeight()) {
+        Direction opposite = DIRECTION_OPPOSITE(direction);
+        m_known.setWall(nx, ny, opposite, true);
+        m_declared.setWall(nx, ny, opposite, isWall);
+    }
+}
+
+KnownWallStats KnownWalls::getStats() const {
+    return m_stats;
+}
+
+int KnownWalls::getWrongBits(int cell) const {
+    ASSERT_FA(m_truth == nullptr);
+    int truth = m_truth->getWallBits(cell);
+    return m_known.getWallBits(cell) & (m_declared.getWallBits(cell) ^ truth);
+}
+
+} 
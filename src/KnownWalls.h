@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Direction.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+// What an algorithm has declared about the walls of a maze, by its latest
+// declaration of each wall, against the walls that are really there
+struct KnownWallStats {
+    int numWalls; // places for a wall in the whole maze, edges included
+    int numKnown; // declared at least once, either way
+    int numWrong; // declared otherwise than the maze has them
+};
+
+class KnownWalls {
+
+    // The walls that an algorithm has declared, as two grids with a bit for
+    // every wall, like the maze's own (see WallGrid): one of the walls that
+    // have been declared at all, and one of whether each was declared to be
+    // there. Each declaration adjusts the counts of known and wrong walls by
+    // the bits that it changed, so the stats are always current, and the
+    // wrong walls of a cell are just a few bitwise operations on the three
+    // grids, so that they can be compared after every step, however large
+    // the maze. No ownership of the truth, which must outlive this.
+
+public:
+
+    KnownWalls();
+    explicit KnownWalls(const WallGrid* truth);
+
+    // Declares the wall on one side of a cell, and the same wall of the
+    // neighbor on that side, to be there or not
+    void declare(int x, int y, Direction direction, bool isWall);
+
+    KnownWallStats getStats() const;
+
+    // The walls of the cell at index x * height + y whose latest declaration
+    // is wrong, one bit for each direction, by the value of the Direction
+    int getWrongBits(int cell) const;
+
+private:
+
+    const WallGrid* m_truth;
+    WallGrid m_known;
+    WallGrid m_declared;
+    KnownWallStats m_stats;
+};
+
+} 
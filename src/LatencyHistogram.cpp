@@ -0,0 +1,102 @@
+#include "LatencyHistogram.h"
+
+#include <QtMath>
+
+namespace mms {
+
+const int LatencyHistogram::SUB_BUCKET_BITS = 5;
+const int LatencyHistogram::SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+const int LatencyHistogram::MAX_BITS = 40;
+
+LatencyHistogram::LatencyHistogram() :
+    m_counts(bucketOf((1LL << MAX_BITS) - 1) + 1, 0),
+    m_count(0),
+    m_maxMicroseconds(0),
+    m_sumMicroseconds(0) {
+}
+
+void LatencyHistogram::record(double seconds) {
+    long long microseconds = static_cast<long long>(seconds * 1000000.0);
+    microseconds = qBound(0LL, microseconds, (1LL << MAX_BITS) - 1);
+    m_counts[bucketOf(microseconds)] += 1;
+    m_count += 1;
+    m_maxMicroseconds = qMax(m_maxMicroseconds, microseconds);
+    m_sumMicroseconds += microseconds;
+}
+
+void LatencyHistogram::clear() {
+    m_counts.fill(0);
+    m_count = 0;
+    m_maxMicroseconds = 0;
+    m_sumMicroseconds = 0;
+}
+
+int LatencyHistogram::getCount() const {
+    return m_count;
+}
+
+double LatencyHistogram::getMaxSeconds() const {
+    return m_maxMicroseconds / 1000000.0;
+}
+
+double LatencyHistogram::getSumSeconds() const {
+    return m_sumMicroseconds / 1000000.0;
+}
+
+int LatencyHistogram::getCountAtMost(double seconds) const {
+    // A bucket counts if every value in it is small enough
+    long long microseconds = static_cast<long long>(seconds * 1000000.0);
+    int count = 0;
+    for (int i = 0; i < m_counts.size(); i += 1) {
+        if (microseconds < highestValueOf(i)) {
+            break;
+        }
+        count += m_counts.at(i);
+    }
+    return count;
+}
+
+double LatencyHistogram::getPercentileSeconds(double fraction) const {
+    if (m_count == 0) {
+        return 0.0;
+    }
+    // The rank of the value, counting from one
+    long long rank = static_cast<long long>(qCeil(fraction * m_count));
+    rank = qBound(1LL, rank, static_cast<long long>(m_count));
+    long long seen = 0;
+    for (int i = 0; i < m_counts.size(); i += 1) {
+        seen += m_counts.at(i);
+        if (rank <= seen) {
+            // No bucket's value is reported as more than was ever seen
+            return qMin(highestValueOf(i), m_maxMicroseconds) / 1000000.0;
+        }
+    }
+    return getMaxSeconds();
+}
+
+int LatencyHistogram::bucketOf(long long microseconds) {
+
+    // Values below 2 * SUB_BUCKETS get a bucket each; above that, each power
+    // of two gets SUB_BUCKETS buckets, using the bits below the highest one
+    if (microseconds < 2 * SUB_BUCKETS) {
+        return static_cast<int>(microseconds);
+    }
+    int highestBit = 0;
+    while ((microseconds >> (highestBit + 1)) != 0) {
+        highestBit += 1;
+    }
+    int shift = highestBit - SUB_BUCKET_BITS;
+    int subBucket = static_cast<int>(microseconds >> shift) - SUB_BUCKETS;
+    return 2 * SUB_BUCKETS + (shift - 1) * SUB_BUCKETS + subBucket;
+}
+
+long long LatencyHistogram::highestValueOf(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+    int subBucket = (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    return ((static_cast<long long>(SUB_BUCKETS + subBucket) + 1) << shift) - 1;
+}
+
+} 
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QVector>
+
+namespace mms {
+
+class LatencyHistogram {
+
+    // Records durations, in microseconds, into buckets whose width grows with
+    // their value, the way HdrHistogram does: each power of two is split into
+    // SUB_BUCKETS buckets, so that any percentile is known to within about 3%
+    // of its value, while a fixed, small number of buckets covers everything
+    // from a microsecond to days. Recording never allocates.
+
+public:
+
+    LatencyHistogram();
+
+    void record(double seconds);
+    void clear();
+
+    int getCount() const;
+    double getMaxSeconds() const;
+    double getSumSeconds() const;
+
+    // The number of recorded values that are no greater than the given
+    // value, to within the resolution of the buckets
+    int getCountAtMost(double seconds) const;
+
+    // The smallest value that at least the given fraction (between zero and
+    // one) of all recorded values are no greater than, to within the
+    // resolution of the buckets; zero if nothing was recorded
+    double getPercentileSeconds(double fraction) const;
+
+private:
+
+    static const int SUB_BUCKET_BITS;
+    static const int SUB_BUCKETS;
+    static const int MAX_BITS;
+
+    QVector<int> m_counts;
+    int m_count;
+    long long m_maxMicroseconds;
+    long long m_sumMicroseconds;
+
+    static int bucketOf(long long microseconds);
+    static long long highestValueOf(int bucket);
+};
+
+} 
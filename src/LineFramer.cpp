@@ -0,0 +1,147 @@
+#include "LineFramer.h"
+
+#include <cstring>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int LineFramer::RESERVED_BYTES = 4096;
+
+LineFramer::LineFramer() :
+    m_buffer(QByteArray()),
+    m_start(0),
+    m_scanned(0) {
+    m_buffer.reserve(RESERVED_BYTES);
+}
+
+void LineFramer::append(const QByteArray& bytes) {
+    append(bytes.constData(), bytes.size());
+}
+
+void LineFramer::append(const char* data, int size) {
+    // Only the partial line (if any) has to move, and removing from the front
+    // keeps the allocation around for next time; appending the bytes (rather
+    // than a QByteArray) never shares another array's storage, which would
+    // have to be copied on the next write
+    if (0 < m_start) {
+        m_buffer.remove(0, m_start);
+        m_scanned -= m_start;
+        m_start = 0;
+    }
+    m_buffer.append(data, size);
+}
+
+bool LineFramer::nextLine(const char** data, int* size) {
+
+    ASSERT_FA(data == nullptr);
+    ASSERT_FA(size == nullptr);
+
+    const char* begin = m_buffer.constData();
+    const void* newline = std::memchr(
+        begin + m_scanned,
+        '\n',
+        m_buffer.size() - m_scanned
+    );
+    if (newline == nullptr) {
+        m_scanned = m_buffer.size();
+        return false;
+    }
+
+    int end = static_cast<const char*>(newline) - begin;
+    *data = begin + m_start;
+    *size = end - m_start;
+
+    // Windows compatibility
+    if (0 < *size && (*data)[*size - 1] == '\r') {
+        *size -= 1;
+    }
+
+    m_start = end + 1;
+    m_scanned = m_start;
+    return true;
+}
+
+bool LineFramer::nextLine(QString* line) {
+
+    ASSERT_FA(line == nullptr);
+
+    const char* data = nullptr;
+    int size = 0;
+    if (!nextLine(&data, &size)) {
+        return false;
+    }
+
+    // Commands are almost always plain ASCII, which can be widened in place
+    // without reallocating the string; anything else goes through the codec
+    bool isAscii = true;
+    for (int i = 0; i < size; i += 1) {
+        if (static_cast<unsigned char>(data[i]) >= 0x80) {
+            isAscii = false;
+            break;
+        }
+    }
+    if (!isAscii) {
+        *line = QString::fromUtf8(data, size);
+        return true;
+    }
+    line->resize(size);
+    QChar* chars = line->data();
+    for (int i = 0; i < size; i += 1) {
+        chars[i] = QChar(static_cast<ushort>(data[i]));
+    }
+    return true;
+}
+
+void LineFramer::clear() {
+    m_buffer.resize(0);
+    m_start = 0;
+    m_scanned = 0;
+}
+
+void LineFramer::encode(const QString& line, QByteArray* bytes) {
+
+    ASSERT_FA(bytes == nullptr);
+
+    // Just like decoding, ASCII is narrowed in place, and anything else goes
+    // through the codec
+    int size = line.size();
+    const QChar* chars = line.constData();
+    for (int i = 0; i < size; i += 1) {
+        if (chars[i].unicode() >= 0x80) {
+            *bytes = line.toUtf8();
+            bytes->append('\n');
+            return;
+        }
+    }
+    bytes->resize(size + 1);
+    char* data = bytes->data();
+    for (int i = 0; i < size; i += 1) {
+        data[i] = static_cast<char>(chars[i].unicode());
+    }
+    data[size] = '\n';
+}
+
+void LineFramer::encodeAppend(const QString& line, QByteArray* bytes) {
+
+    ASSERT_FA(bytes == nullptr);
+
+    int size = line.size();
+    const QChar* chars = line.constData();
+    for (int i = 0; i < size; i += 1) {
+        if (chars[i].unicode() >= 0x80) {
+            bytes->append(line.toUtf8());
+            bytes->append('\n');
+            return;
+        }
+    }
+    int offset = bytes->size();
+    bytes->resize(offset + size + 1);
+    char* data = bytes->data() + offset;
+    for (int i = 0; i < size; i += 1) {
+        data[i] = static_cast<char>(chars[i].unicode());
+    }
+    data[size] = '\n';
+}
+
+} 
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace mms {
+
+class LineFramer {
+
+    // Splits a stream of bytes into newline-terminated lines. Bytes are kept
+    // in a single buffer that's reused across reads; consumed lines are only
+    // discarded (by moving the trailing partial line to the front) when more
+    // bytes arrive, so lines can be handed out as views into the buffer.
+
+public:
+
+    LineFramer();
+
+    // Buffers that are reserved are kept when they're emptied, rather than
+    // freed, so a buffer that a line passes through should reserve this
+    // much, and a framer reserves it for its own buffer
+    static const int RESERVED_BYTES;
+
+    // Appends bytes read from a process; invalidates any outstanding views
+    void append(const QByteArray& bytes);
+    void append(const char* data, int size);
+
+    // Points *data and *size at the next complete line, without the line
+    // terminator, and returns true; returns false if no complete line is
+    // buffered yet. The view is valid until the next call to append()
+    bool nextLine(const char** data, int* size);
+
+    // Like the above, but decodes the line into *line, reusing its storage
+    bool nextLine(QString* line);
+
+    // Drops all buffered bytes, complete lines included
+    void clear();
+
+    // The inverse of nextLine: writes a line and its terminator to *bytes,
+    // reusing its storage, e.g., for a response
+    static void encode(const QString& line, QByteArray* bytes);
+
+    // Like encode, but after whatever *bytes already holds, e.g., to answer
+    // a batch of commands with a single write
+    static void encodeAppend(const QString& line, QByteArray* bytes);
+
+private:
+
+    QByteArray m_buffer;
+
+    // Offset of the first byte that hasn't been handed out yet
+    int m_start;
+
+    // Offset up to which the buffer is known to contain no newline
+    int m_scanned;
+
+};
+
+} 
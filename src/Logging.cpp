@@ -1,15 +1,48 @@
 #include "Logging.h"
 
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QLoggingCategory>
+
 #include "AssertMacros.h"
 
 namespace mms {
 
-QTextStream* Logging::STDOUT = nullptr;
+const int Logging::QUEUE_CAPACITY = 8192;
+const int Logging::WRITE_INTERVAL_MS = 50;
+
+MpscQueue<LogRecord>* Logging::QUEUE = nullptr;
+std::atomic<int> Logging::NUM_DROPPED(0);
+std::atomic<bool> Logging::IS_WRITER_RUNNING(false);
+QThread* Logging::WRITER_THREAD = nullptr;
+QTimer* Logging::WRITER_TIMER = nullptr;
 
 void Logging::init() {
-    ASSERT_TR(STDOUT == nullptr);
-    STDOUT = new QTextStream(stdout);
+    ASSERT_TR(QUEUE == nullptr);
+    QUEUE = new MpscQueue<LogRecord>(QUEUE_CAPACITY);
+
+    // The timer lives on the writer thread, and so does whatever it calls
+    WRITER_THREAD = new QThread();
+    WRITER_TIMER = new QTimer();
+    WRITER_TIMER->setInterval(WRITE_INTERVAL_MS);
+    WRITER_TIMER->moveToThread(WRITER_THREAD);
+    QObject::connect(WRITER_TIMER, &QTimer::timeout, WRITER_TIMER, [](){
+        write();
+    });
+    WRITER_THREAD->start();
+    QMetaObject::invokeMethod(WRITER_TIMER, "start", Qt::QueuedConnection);
+    IS_WRITER_RUNNING.store(true);
+
     qInstallMessageHandler(handler);
+    qAddPostRoutine(shutdown);
+}
+
+void Logging::setFilterRules(const QString& rules) {
+    // Semicolons separate rules on the command line, newlines in the API
+    QString lines = rules;
+    lines.replace(';', '\n');
+    QLoggingCategory::setFilterRules(lines);
 }
 
 void Logging::handler(
@@ -17,15 +50,80 @@ void Logging::handler(
     const QMessageLogContext& context,
     const QString& msg) {
 
-    ASSERT_FA(STDOUT == nullptr);
-    
-    QString formatted = QString("[%1:%2] - %3").arg(
+    ASSERT_FA(QUEUE == nullptr);
+
+    LogRecord record = {
+        type,
+        context.category,
         context.file,
-        QString::number(context.line),
+        context.line,
         msg
+    };
+
+    // Nothing that's queued would be written in time, and nothing after the
+    // writer is gone would be written at all
+    if (type == QtFatalMsg || !IS_WRITER_RUNNING.load()) {
+        QByteArray formatted = format(record);
+        fwrite(formatted.constData(), 1, formatted.size(), stdout);
+        fflush(stdout);
+        return;
+    }
+
+    if (!QUEUE->push(record)) {
+        NUM_DROPPED.fetch_add(1);
+    }
+}
+
+void Logging::write() {
+    QByteArray batch;
+    LogRecord record;
+    while (QUEUE->pop(&record)) {
+        batch.append(format(record));
+    }
+    int numDropped = NUM_DROPPED.exchange(0);
+    if (0 < numDropped) {
+        batch.append(QString("[Logging] - Dropped %1 messages\n").arg(
+            numDropped
+        ).toUtf8());
+    }
+    if (batch.isEmpty()) {
+        return;
+    }
+    fwrite(batch.constData(), 1, batch.size(), stdout);
+    fflush(stdout);
+}
+
+QByteArray Logging::format(const LogRecord& record) {
+    // Messages of the default category are logged as they always have been
+    QString message = record.message;
+    if (record.category != nullptr && qstrcmp(record.category, "default")) {
+        message = QString("%1: %2").arg(record.category, message);
+    }
+    QString formatted = QString("[%1:%2] - %3\n").arg(
+        record.file,
+        QString::number(record.line),
+        message
     );
+    return formatted.toUtf8();
+}
 
-    *STDOUT << formatted << endl;
+void Logging::shutdown() {
+
+    // Once the writer's timer is stopped, the writer won't touch the queue
+    // again, so it's safe to drain it from here
+    QMetaObject::invokeMethod(
+        WRITER_TIMER,
+        "stop",
+        Qt::BlockingQueuedConnection
+    );
+    IS_WRITER_RUNNING.store(false);
+    WRITER_THREAD->quit();
+    WRITER_THREAD->wait();
+    write();
+    delete WRITER_TIMER;
+    WRITER_TIMER = nullptr;
+    delete WRITER_THREAD;
+    WRITER_THREAD = nullptr;
 }
 
 } 
@@ -1,23 +1,68 @@
 #pragma once
 
+#include <atomic>
+
 #include <QDebug>
 #include <QString>
-#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include "MpscQueue.h"
 
 namespace mms {
 
+// A message, as it's handed from the thread that logged it to the writer;
+// the file name points to a string literal, so it's never copied
+struct LogRecord {
+    QtMsgType type;
+    const char* category;
+    const char* file;
+    int line;
+    QString message;
+};
+
 class Logging {
 
+    // Messages are pushed onto a lock-free queue by whichever thread logs
+    // them, and formatted and written to stdout in batches by a thread of
+    // its own, so that logging never waits on the terminal. If the writer
+    // falls behind and the queue fills up, messages are dropped (and
+    // counted) rather than blocking. Fatal messages are written right away,
+    // since the process is about to end.
+    //
+    // Which messages are logged at all is up to the filter rules of
+    // QLoggingCategory, which are checked before a message is even built.
+
 public:
     Logging() = delete;
     static void init();
 
+    // Sets the rules for which messages are logged, in the format of
+    // QLoggingCategory, e.g. "mms.opengl.debug=false;default.debug=false"
+    static void setFilterRules(const QString& rules);
+
 private:
-    static QTextStream* STDOUT;
+    static const int QUEUE_CAPACITY;
+    static const int WRITE_INTERVAL_MS;
+
+    static MpscQueue<LogRecord>* QUEUE;
+    static std::atomic<int> NUM_DROPPED;
+    static std::atomic<bool> IS_WRITER_RUNNING;
+    static QThread* WRITER_THREAD;
+    static QTimer* WRITER_TIMER;
+
     static void handler(
         QtMsgType type,
         const QMessageLogContext& context,
         const QString& msg);
+
+    // Formats and writes everything that's queued; only ever called by one
+    // thread at a time (the writer's, or the main thread's once it's gone)
+    static void write();
+    static QByteArray format(const LogRecord& record);
+
+    // Writes whatever's left, and stops the writer, as the application exits
+    static void shutdown();
 };
 
 } 
@@ -1,31 +1,172 @@
 #include "Map.h"
 
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include <QApplication>
 #include <QElapsedTimer>
-#include <QFile>
+#include <QFontDatabase>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QLoggingCategory>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScreen>
+#include <QSurfaceFormat>
+#include <QVector2D>
+#include <QVector4D>
+#include <QWheelEvent>
+#include <QWindow>
 
+#include "AllocationCounter.h"
 #include "AssertMacros.h"
+#include "BufferInterface.h"
+#include "Color.h"
+#include "ColorManager.h"
 #include "Dimensions.h"
-#include "FontImage.h"
 #include "Logging.h"
+#include "MapResources.h"
+#include "Profiler.h"
+#include "TileTemplate.h"
 #include "TransformationMatrix.h"
 
 namespace mms {
 
+// OpenGL debug messages are logged in a category of their own, so that they
+// can be filtered separately with --log-rules
+Q_LOGGING_CATEGORY(OPENGL_LOG, "mms.opengl")
+
+const double Map::MIN_ZOOM = 0.5;
+const double Map::MAX_ZOOM = 256.0;
+const double Map::WHEEL_DEGREES_PER_DOUBLING = 60.0;
+const double Map::COARSE_TILE_PIXELS = 8.0;
+const int Map::NUM_GPU_SAMPLES = 4;
+const float Map::RIVAL_MOUSE_ALPHA = 0.5;
+const float Map::GHOST_MOUSE_ALPHA = 0.25;
+const double Map::ZOOMED_VIEW_FRACTION = 0.35;
+const double Map::ZOOMED_VIEW_TILES = 5.0;
+const int Map::ZOOMED_VIEW_BORDER_PIXELS = 2;
+const int Map::ZOOMED_VIEW_MIN_PIXELS = 64;
+const double Map::TEXT_UPLOAD_BUDGET_SECONDS = 0.002;
+const int Map::MAX_TEXT_UPLOAD_INTERVAL = 8;
+const double Map::MAX_SWAP_SECONDS = 0.25;
+
 Map::Map(QWidget* parent) :
     QOpenGLWidget(parent),
     m_maze(nullptr),
     m_view(nullptr),
     m_mouseGraphic(nullptr),
+    m_rivalMouseGraphics(QVector<const MouseGraphic*>()),
+    m_ghostMouseGraphics(QVector<const MouseGraphic*>()),
     m_windowWidth(0),
     m_windowHeight(0),
-    m_textureAtlas(nullptr) {
-    ASSERT_RUNS_JUST_ONCE();
+    m_zoom(1.0),
+    m_center(Coordinate()),
+    m_isFollowingMouse(false),
+    m_isDragging(false),
+    m_dragPosition(QPoint()),
+    m_isEditing(false),
+    m_isClicking(false),
+    m_clickPosition(QPoint()),
+    m_transformationVersion(0),
+    m_resources(nullptr),
+    m_isCoarse(false),
+    m_isZoomedViewVisible(false),
+    m_isZoomedViewRotating(false),
+    m_isTileTextureEnabled(false),
+    m_isTileTextureStale(true),
+    m_maxTextureSize(0),
+    m_tileTexture(0),
+    m_tileTexels(QVector<unsigned char>()),
+    m_tileInstanceVBO(QOpenGLBuffer::VertexBuffer),
+    m_tilePositionLocation(-1),
+    m_tileStateLocation(-1),
+    m_mouseVBO(QOpenGLBuffer::VertexBuffer),
+    m_mouseInstanceVBO(QOpenGLBuffer::VertexBuffer),
+    m_mouseInstances(QVector<MouseInstance>()),
+    m_glyphInstanceVBO(QOpenGLBuffer::VertexBuffer),
+    m_snapshot(nullptr),
+    m_isSnapshotNew(false),
+    m_isUploadStale(true),
+    m_isMouseUploadStale(true),
+    m_uploadedTextureLayoutVersion(0),
+    m_uploadedGlyphCount(0),
+    m_mouseVertexCount(0),
+    m_textUploadInterval(1),
+    m_framesSinceTextUpload(0),
+    m_pendingGlyphRanges(QVector<DirtyRange>()),
+    m_uploadBudgetBytes(0),
+    m_deferredFrames(0),
+    m_pendingTileHeatRanges(QVector<DirtyRange>()),
+    m_mouseTriangles(QVector<TriangleGraphic>()),
+    m_textureRanges(QVector<DirtyRange>()),
+    m_mergedRanges(QVector<DirtyRange>()),
+    m_isTimeMonitorPending(false),
+    m_timeMonitorFrame(0),
+    m_frameStats({
+        0, 0.0, 0.0, 0, 0, 0, 0, 0, 0, 0, -1.0, -1.0, -1.0, -1.0, 0, 1, -1, -1
+    }),
+    m_isStatsOverlayVisible(false),
+    m_isGpuTimingEnabled(false),
+    m_frameLog(nullptr),
+    m_offscreenSurface(nullptr),
+    m_offscreenContext(nullptr),
+    m_offscreenFramebuffer(nullptr) {
+    // Take focus when clicked, so that the camera keys work
+    setFocusPolicy(Qt::StrongFocus);
+    connect(
+        this,
+        &QOpenGLWidget::frameSwapped,
+        this,
+        &Map::onFrameSwapped
+    );
+}
+
+Map::~Map() {
+    delete m_frameLog;
+    // The context and surface are children of the map, so they outlive the
+    // buffers and programs, which are destroyed while the context is current
+    if (m_offscreenContext != nullptr) {
+        m_offscreenContext->makeCurrent(m_offscreenSurface);
+        delete m_offscreenFramebuffer;
+        deleteTileTexture();
+        if (m_resources != nullptr) {
+            MapResources::release(m_resources);
+        }
+    }
+    else if (m_resources != nullptr) {
+        // The widget's context is destroyed after the map, too late for the
+        // map to let go of its resources then
+        disconnect(
+            context(),
+            &QOpenGLContext::aboutToBeDestroyed,
+            this,
+            &Map::releaseResources
+        );
+        releaseResources();
+    }
+}
+
+void Map::releaseResources() {
+    // The context is about to be destroyed, but is still valid
+    makeCurrent();
+    deleteTileTexture();
+    MapResources::release(m_resources);
+    m_resources = nullptr;
+    doneCurrent();
 }
 
 void Map::setMaze(const Maze* maze) {
     ASSERT_TR(m_mouseGraphic == nullptr);
+    ASSERT_TR(m_rivalMouseGraphics.isEmpty());
+    ASSERT_TR(m_ghostMouseGraphics.isEmpty());
     m_maze = maze;
     m_view = nullptr;
+    m_isUploadStale = true;
+    m_isTileTextureStale = true;
+    resetCamera();
 }
 
 void Map::setView(const MazeView* view) {
@@ -33,6 +174,9 @@ void Map::setView(const MazeView* view) {
         ASSERT_FA(m_maze == nullptr);
     }
     m_view = view;
+    m_isUploadStale = true;
+    m_isTileTextureStale = true;
+    update();
 }
 
 void Map::setMouseGraphic(const MouseGraphic* mouseGraphic) {
@@ -41,6 +185,30 @@ void Map::setMouseGraphic(const MouseGraphic* mouseGraphic) {
         ASSERT_FA(m_view == nullptr);
     }
     m_mouseGraphic = mouseGraphic;
+    m_isMouseUploadStale = true;
+    update();
+}
+
+void Map::setRivalMouseGraphics(
+        const QVector<const MouseGraphic*>& graphics) {
+    if (!graphics.isEmpty()) {
+        ASSERT_FA(m_maze == nullptr);
+        ASSERT_FA(m_view == nullptr);
+    }
+    m_rivalMouseGraphics = graphics;
+    m_isMouseUploadStale = true;
+    update();
+}
+
+void Map::setGhostMouseGraphics(
+        const QVector<const MouseGraphic*>& graphics) {
+    if (!graphics.isEmpty()) {
+        ASSERT_FA(m_maze == nullptr);
+        ASSERT_FA(m_view == nullptr);
+    }
+    m_ghostMouseGraphics = graphics;
+    m_isMouseUploadStale = true;
+    update();
 }
 
 QStringList Map::getOpenGLVersionInfo() {
@@ -67,6 +235,151 @@ QStringList Map::getOpenGLVersionInfo() {
     return info;
 }
 
+void Map::resetCamera() {
+    m_zoom = 1.0;
+    m_center = Coordinate();
+    if (m_maze != nullptr) {
+        m_center = TransformationMatrix::getMazeCenter(
+            m_maze->getWidth(),
+            m_maze->getHeight()
+        );
+    }
+    m_isFollowingMouse = false;
+    update();
+}
+
+void Map::setFollowingMouse(bool following) {
+    m_isFollowingMouse = following;
+    update();
+}
+
+bool Map::isFollowingMouse() const {
+    return m_isFollowingMouse;
+}
+
+void Map::setZoomedViewVisible(bool visible) {
+    m_isZoomedViewVisible = visible;
+    update();
+}
+
+bool Map::isZoomedViewVisible() const {
+    return m_isZoomedViewVisible;
+}
+
+void Map::setZoomedViewRotating(bool rotating) {
+    m_isZoomedViewRotating = rotating;
+    update();
+}
+
+bool Map::isZoomedViewRotating() const {
+    return m_isZoomedViewRotating;
+}
+
+void Map::setTileTextureEnabled(bool enabled) {
+    // Records that changed while the texture wasn't drawn weren't copied
+    m_isTileTextureEnabled = enabled;
+    m_isTileTextureStale = true;
+    update();
+}
+
+bool Map::isTileTextureEnabled() const {
+    return m_isTileTextureEnabled;
+}
+
+void Map::setUploadBudget(qint64 bytes) {
+    ASSERT_LE(0, bytes);
+    m_uploadBudgetBytes = bytes;
+}
+
+qint64 Map::getUploadBudget() const {
+    return m_uploadBudgetBytes;
+}
+
+void Map::setStatsOverlayVisible(bool visible) {
+    m_isStatsOverlayVisible = visible;
+    update();
+}
+
+bool Map::isStatsOverlayVisible() const {
+    return m_isStatsOverlayVisible;
+}
+
+void Map::setGpuTimingEnabled(bool enabled) {
+    m_isGpuTimingEnabled = enabled;
+}
+
+const FrameStats& Map::getFrameStats() const {
+    return m_frameStats;
+}
+
+bool Map::setFrameLogPath(const QString& path) {
+    delete m_frameLog;
+    m_frameLog = nullptr;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_frameLog = new QFile(path);
+    if (!m_frameLog->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning()
+            << "Unable to open frame log file:"
+            << path;
+        delete m_frameLog;
+        m_frameLog = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool Map::initOffscreen(int width, int height) {
+    ASSERT_TR(m_offscreenContext == nullptr);
+    ASSERT_LT(0, width);
+    ASSERT_LT(0, height);
+    m_offscreenSurface = new QOffscreenSurface();
+    m_offscreenSurface->setParent(this);
+    m_offscreenSurface->setFormat(QSurfaceFormat::defaultFormat());
+    m_offscreenSurface->create();
+    m_offscreenContext = new QOpenGLContext(this);
+    m_offscreenContext->setFormat(QSurfaceFormat::defaultFormat());
+    m_offscreenContext->setShareContext(
+        QOpenGLContext::globalShareContext()
+    );
+    if (
+        !m_offscreenSurface->isValid() ||
+        !m_offscreenContext->create() ||
+        !m_offscreenContext->makeCurrent(m_offscreenSurface)
+    ) {
+        return false;
+    }
+    m_offscreenFramebuffer = new QOpenGLFramebufferObject(width, height);
+    if (!m_offscreenFramebuffer->isValid()) {
+        return false;
+    }
+    m_offscreenFramebuffer->bind();
+    initializeGL();
+    resizeGL(width, height);
+    return true;
+}
+
+QImage Map::renderOffscreen() {
+    ASSERT_FA(m_offscreenFramebuffer == nullptr);
+    m_offscreenContext->makeCurrent(m_offscreenSurface);
+    m_offscreenFramebuffer->bind();
+    glViewport(0, 0, m_windowWidth, m_windowHeight);
+    glClear(GL_COLOR_BUFFER_BIT);
+    paintGL();
+    return m_offscreenFramebuffer->toImage();
+}
+
+void Map::paintOffscreen() {
+    ASSERT_FA(m_offscreenFramebuffer == nullptr);
+    m_offscreenContext->makeCurrent(m_offscreenSurface);
+    m_offscreenFramebuffer->bind();
+    glViewport(0, 0, m_windowWidth, m_windowHeight);
+    glClear(GL_COLOR_BUFFER_BIT);
+    paintGL();
+    glFinish();
+}
+
 void Map::shutdown() {
     makeCurrent();
     m_openGLLogger.stopLogging();
@@ -74,6 +387,19 @@ void Map::shutdown() {
 
 void Map::initOpenGLLogger() {
     if (m_openGLLogger.initialize()) {
+        connect(
+            &m_openGLLogger,
+            &QOpenGLDebugLogger::messageLogged,
+            this,
+            [](const QOpenGLDebugMessage& message){
+                if (message.severity() == QOpenGLDebugMessage::LowSeverity) {
+                    qCDebug(OPENGL_LOG) << message.message();
+                }
+                else {
+                    qCWarning(OPENGL_LOG) << message.message();
+                }
+            }
+        );
         m_openGLLogger.startLogging(QOpenGLDebugLogger::SynchronousLogging);
         m_openGLLogger.enableMessages();
         m_openGLLogger.disableMessages(
@@ -94,68 +420,286 @@ void Map::initializeGL() {
     // Make it possible to call gl functions directly
     initializeOpenGLFunctions();
 
+    // The tiles are drawn with instancing, which needs OpenGL 3.3 (or
+    // OpenGL ES 3.0), or an extension that provides it
+    // (the current context isn't the widget's if the map is offscreen)
+    QOpenGLContext* current = QOpenGLContext::currentContext();
+    QPair<int, int> version = current->format().version();
+    QPair<int, int> required = current->isOpenGLES() ? qMakePair(3, 0) : qMakePair(3, 3);
+    if (
+        version < required &&
+        !current->hasExtension("GL_ARB_instanced_arrays")
+    ) {
+        qWarning()
+            << "Instanced drawing may not be supported by OpenGL version"
+            << QString("%1.%2").arg(version.first).arg(version.second);
+    }
+
     // Set some gl values
     glClearColor(0.0, 0.0, 0.0, 1.0);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_BLEND);
 
-    // Initialize the polygon and texture programs
+    // The programs, template meshes and atlas are shared with every other
+    // map, and only this map's vertex array objects and instance buffers are
+    // created here; the current matrix gets a version that none of the
+    // shared programs have seen. A widget's context is destroyed, and a new
+    // one created, whenever the widget moves to another window, and the
+    // resources are let go of along with the old one.
+    m_resources = MapResources::acquire();
+    m_transformationVersion = m_resources->newTransformationVersion();
+    if (m_offscreenContext == nullptr) {
+        connect(
+            context(),
+            &QOpenGLContext::aboutToBeDestroyed,
+            this,
+            &Map::releaseResources
+        );
+    }
+    initTileProgram();
     initPolygonProgram();
     initTextureProgram();
+    initTileTextureProgram();
+
+    // The texture names of the old context, if any, are gone with it
+    m_tileTexture = 0;
+    m_isTileTextureStale = true;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+
+    // Timer queries are optional; without them, GPU times aren't reported
+    m_timeMonitor.setSampleCount(NUM_GPU_SAMPLES);
+    if (!m_timeMonitor.create()) {
+        qInfo() << "GPU timer queries are not supported";
+    }
 }
 
 void Map::paintGL() {
+    PROFILE_ZONE("Map::paintGL");
 
-    // TODO: upforgrabs
-    // Optimize this code
-    //
-    // QElapsedTimer timer;
-    // timer.start();
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+    bool isCountingAllocations = AllocationCounter::isEnabled();
+    AllocationCounts allocationsBefore = AllocationCounter::getThreadCounts();
+    m_frameStats.frame += 1;
+    m_frameStats.uploadSeconds = 0.0;
+    m_frameStats.uploadBytes = 0;
+    m_frameStats.tilesUploaded = 0;
+    m_frameStats.glyphsUploaded = 0;
+    m_frameStats.trianglesUploaded = 0;
+    m_frameStats.drawCalls = 0;
+    m_frameStats.trianglesDrawn = 0;
+
+    // Pick up the results of the last timed frame, without waiting for them
+    readTimeMonitor();
+
+    // The overlay is drawn with a QPainter, which doesn't restore these
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_BLEND);
 
     // If the view hasn't been set yet, just draw black
     if (m_view == nullptr) {
         glClear(GL_COLOR_BUFFER_BIT);
+        m_frameStats.paintSeconds = paintTimer.nsecsElapsed() / 1e9;
+        updateFrameAllocations(isCountingAllocations, allocationsBefore);
+        drawStatsOverlay();
+        logFrameStats();
         return;
     }
 
-    QVector<TriangleGraphic> mouseBuffer;
-    if (m_mouseGraphic != nullptr) {
-        mouseBuffer = m_mouseGraphic->draw();
+    // Upload whatever changed since the last frame
+    m_snapshot = &m_view->takeSnapshot(&m_isSnapshotNew);
+    QElapsedTimer uploadTimer;
+    uploadTimer.start();
+    updateVertexBufferObjects();
+    updateTileTexture();
+    updateMouseInstances();
+    m_frameStats.uploadSeconds = uploadTimer.nsecsElapsed() / 1e9;
+
+    // Skip whatever's off of the map, and the details that are too small
+    updateVisibleTiles();
+    updateTransformationMatrix();
+
+    // Only time this frame on the GPU if no earlier frame's results are
+    // outstanding; every sample is recorded, even for skipped passes, so
+    // that the intervals always line up with the passes
+    bool isTimed = (
+        m_timeMonitor.isCreated() &&
+        !m_isTimeMonitorPending &&
+        (
+            m_isStatsOverlayVisible ||
+            m_isGpuTimingEnabled ||
+            m_frameLog != nullptr
+        )
+    );
+    if (isTimed) {
+        m_timeMonitor.recordSample();
+    }
+    drawLayers(isTimed);
+    if (isTimed) {
+        m_isTimeMonitorPending = true;
+        m_timeMonitorFrame = m_frameStats.frame;
+    }
+
+    // The close-up reuses everything that was just uploaded
+    drawZoomedView();
+
+    m_frameStats.paintSeconds = paintTimer.nsecsElapsed() / 1e9;
+    updateFrameAllocations(isCountingAllocations, allocationsBefore);
+    drawStatsOverlay();
+    logFrameStats();
+    if (isMouseAnimating()) {
+        update();
+    }
+}
+
+void Map::updateFrameAllocations(
+        bool isCounting,
+        const AllocationCounts& before) {
+    if (!isCounting || !AllocationCounter::isEnabled()) {
+        m_frameStats.allocations = -1;
+        m_frameStats.allocatedBytes = -1;
+        return;
     }
+    AllocationCounts counts = AllocationCounter::getThreadCountsSince(before);
+    m_frameStats.allocations = counts.allocations;
+    m_frameStats.allocatedBytes = counts.bytes;
+}
 
-    // Re-populate both vertex buffer objects
-    repopulateVertexBufferObjects(mouseBuffer);
+void Map::drawLayers(bool isTimed) {
 
     // Draw the tiles
-    drawMap(
-        &m_polygonProgram,
-        &m_polygonVAO,
-        0,
-        3 * m_view->getGraphicCpuBuffer()->size()
-    );
+    if (isTileTextureDrawn()) {
+        drawMap(
+            m_resources->getTileTextureProgram(),
+            &m_tileTextureVAO,
+            0,
+            6,
+            true
+        );
+    }
+    else if (m_isCoarse) {
+        drawMap(
+            m_resources->getTileProgram(),
+            &m_tileVAO,
+            TileTemplate::DETAILED_INDEX_COUNT,
+            TileTemplate::COARSE_INDEX_COUNT,
+            true
+        );
+    }
+    else {
+        drawMap(
+            m_resources->getTileProgram(),
+            &m_tileVAO,
+            0,
+            TileTemplate::DETAILED_INDEX_COUNT,
+            true
+        );
+    }
+    if (isTimed) {
+        m_timeMonitor.recordSample();
+    }
 
-    // Overlay the tile text
-    if (m_textureAtlas != nullptr) {
+    // Overlay the tile text, unless it'd be too small to read
+    if (
+        !m_isCoarse &&
+        m_resources->getTextureAtlas() != nullptr &&
+        0 < m_uploadedGlyphCount
+    ) {
+        m_resources->uploadGlyphs();
         drawMap(
-            &m_textureProgram,
+            m_resources->getTextureProgram(),
             &m_textureVAO,
             0,
-            3 * m_view->getTextureCpuBuffer()->size()
+            6,
+            true
         );
     }
+    if (isTimed) {
+        m_timeMonitor.recordSample();
+    }
+
+    // Draw every mouse at once
+    if (!m_mouseInstances.isEmpty()) {
+        drawMap(
+            m_resources->getPolygonProgram(),
+            &m_mouseVAO,
+            0,
+            m_mouseVertexCount,
+            false
+        );
+    }
+    if (isTimed) {
+        m_timeMonitor.recordSample();
+    }
+}
+
+void Map::drawZoomedView() {
+
+    if (!m_isZoomedViewVisible || m_mouseGraphic == nullptr) {
+        return;
+    }
+    int side = static_cast<int>(
+        ZOOMED_VIEW_FRACTION * std::min(m_windowWidth, m_windowHeight)
+    );
+    if (side < ZOOMED_VIEW_MIN_PIXELS) {
+        return;
+    }
 
-    // Draw the mouse
-    drawMap(
-        &m_polygonProgram,
-        &m_polygonVAO,
-        3 * m_view->getGraphicCpuBuffer()->size(),
-        3 * mouseBuffer.size()
+    // The view is a square in the upper right corner of the map, framed by
+    // a border; OpenGL counts pixels of the framebuffer, which may be more
+    // than those of the widget (but not if the map is offscreen), up from
+    // the bottom
+    int border = ZOOMED_VIEW_BORDER_PIXELS;
+    int left = m_windowWidth - side - border;
+    int bottom = m_windowHeight - side - border;
+    double ratio =
+        m_offscreenFramebuffer == nullptr ? devicePixelRatioF() : 1.0;
+    auto toDevice = [ratio](int pixels) {
+        return static_cast<int>(std::round(pixels * ratio));
+    };
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(
+        toDevice(left - border),
+        toDevice(bottom - border),
+        toDevice(side + 2 * border),
+        toDevice(side + 2 * border)
     );
+    RGB rgb = COLOR_TO_RGB(ColorManager::getTileWallColor());
+    glClearColor(rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    int viewLeft = toDevice(left);
+    int viewBottom = toDevice(bottom);
+    int viewSide = toDevice(side);
+    glScissor(viewLeft, viewBottom, viewSide, viewSide);
+    glClearColor(0.0, 0.0, 0.0, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(viewLeft, viewBottom, viewSide, viewSide);
+
+    // Follow the mouse and, if rotating, keep it facing up; a turned view
+    // can show anything within half of its diagonal of the mouse
+    Coordinate center = m_mouseGraphic->getCurrentTranslation();
+    Angle up = Angle::Degrees(90);
+    if (m_isZoomedViewRotating) {
+        up = m_mouseGraphic->getCurrentRotation();
+    }
+    double span = ZOOMED_VIEW_TILES * Dimensions::tileLength().getMeters();
+    double reach = 0.5 * span * (m_isZoomedViewRotating ? std::sqrt(2.0) : 1.0);
+    setTransformationMatrix(TransformationMatrix::getTurned(
+        Distance::Meters(span),
+        center,
+        up
+    ));
+    m_isCoarse = side / ZOOMED_VIEW_TILES < COARSE_TILE_PIXELS;
+    cullTiles(
+        center.getX().getMeters() - reach,
+        center.getX().getMeters() + reach,
+        center.getY().getMeters() - reach,
+        center.getY().getMeters() + reach
+    );
+    drawLayers(false);
 
-    // TODO: upforgrabs
-    // Optimize this code
-    //
-    // qDebug() << timer.nsecsElapsed();
+    glViewport(0, 0, toDevice(m_windowWidth), toDevice(m_windowHeight));
 }
 
 void Map::resizeGL(int width, int height) {
@@ -163,203 +707,1174 @@ void Map::resizeGL(int width, int height) {
     m_windowHeight = height;
 }
 
-void Map::initPolygonProgram() {
+void Map::wheelEvent(QWheelEvent* event) {
+    if (m_maze == nullptr) {
+        return;
+    }
+    // Most wheels turn in steps of fifteen degrees, reported in eighths of a
+    // degree; while following the mouse, zoom around the middle instead
+    double degrees = event->angleDelta().y() / 8.0;
+    double zoom = m_zoom * std::pow(2.0, degrees / WHEEL_DEGREES_PER_DOUBLING);
+    if (m_isFollowingMouse) {
+        zoomAround(m_center, zoom);
+    }
+    else {
+        zoomAround(pixelToPhysical(event->pos()), zoom);
+    }
+    event->accept();
+}
 
-    m_polygonProgram.addShaderFromSourceCode(
-        QOpenGLShader::Vertex,
-        R"(
-            uniform mat4 transformationMatrix;
-            attribute vec2 coordinate;
-            attribute vec4 inColor;
-            varying vec4 outColor;
-            void main(void) {
-                gl_Position = transformationMatrix * vec4(coordinate, 0.0, 1.0);
-                outColor = inColor;
-            }
-        )"
-    );
-    m_polygonProgram.addShaderFromSourceCode(
-        QOpenGLShader::Fragment,
-        R"(
-            varying vec4 outColor;
-            void main(void) {
-               gl_FragColor = outColor;
-            }
-        )"
+void Map::mousePressEvent(QMouseEvent* event) {
+    if (event->button() != Qt::LeftButton) {
+        QOpenGLWidget::mousePressEvent(event);
+        return;
+    }
+    m_isDragging = true;
+    m_dragPosition = event->pos();
+    m_isClicking = m_isEditing;
+    m_clickPosition = event->pos();
+}
+
+void Map::mouseMoveEvent(QMouseEvent* event) {
+    if (!m_isDragging || m_maze == nullptr) {
+        QOpenGLWidget::mouseMoveEvent(event);
+        return;
+    }
+    // Dragging takes over from following; pixel y grows downward, while
+    // physical y grows upward
+    double pixelsPerMeter = getPixelsPerMeter();
+    if (pixelsPerMeter <= 0.0) {
+        return;
+    }
+    if (
+        (event->pos() - m_clickPosition).manhattanLength() >=
+        QApplication::startDragDistance()
+    ) {
+        m_isClicking = false;
+    }
+    QPoint delta = event->pos() - m_dragPosition;
+    m_dragPosition = event->pos();
+    m_isFollowingMouse = false;
+    m_center = m_center + Coordinate::Cartesian(
+        Distance::Meters(-delta.x() / pixelsPerMeter),
+        Distance::Meters(delta.y() / pixelsPerMeter)
+    );
+    update();
+}
+
+void Map::mouseReleaseEvent(QMouseEvent* event) {
+    if (event->button() != Qt::LeftButton) {
+        QOpenGLWidget::mouseReleaseEvent(event);
+        return;
+    }
+    m_isDragging = false;
+    if (m_isClicking) {
+        m_isClicking = false;
+        clickWall(event->pos());
+    }
+}
+
+void Map::mouseDoubleClickEvent(QMouseEvent* event) {
+    if (m_isEditing) {
+        mousePressEvent(event);
+        return;
+    }
+    resetCamera();
+}
+
+void Map::setEditing(bool editing) {
+    m_isEditing = editing;
+    m_isClicking = false;
+}
+
+bool Map::isEditing() const {
+    return m_isEditing;
+}
+
+void Map::clickWall(const QPoint& pixel) {
+    if (m_maze == nullptr || getPixelsPerMeter() <= 0.0) {
+        return;
+    }
+
+    // The tile under the cursor, and how far across it the cursor is
+    double tileLength = Dimensions::tileLength().getMeters();
+    Coordinate physical = pixelToPhysical(pixel);
+    double tileX = physical.getX().getMeters() / tileLength;
+    double tileY = physical.getY().getMeters() / tileLength;
+    int x = static_cast<int>(std::floor(tileX));
+    int y = static_cast<int>(std::floor(tileY));
+    if (x < 0 || m_maze->getWidth() <= x || y < 0 || m_maze->getHeight() <= y) {
+        return;
+    }
+    double fromSide[] = {
+        1.0 - (tileY - y), // north
+        1.0 - (tileX - x), // east
+        tileY - y, // south
+        tileX - x, // west
+    };
+    int nearest = 0;
+    for (int i = 1; i < NUM_DIRECTIONS; i += 1) {
+        if (fromSide[i] < fromSide[nearest]) {
+            nearest = i;
+        }
+    }
+    emit wallClicked(x, y, DIRECTIONS[nearest]);
+}
+
+void Map::keyPressEvent(QKeyEvent* event) {
+    switch (event->key()) {
+        case Qt::Key_F:
+            setFollowingMouse(!m_isFollowingMouse);
+            break;
+        case Qt::Key_Home:
+            resetCamera();
+            break;
+        case Qt::Key_Z:
+            setZoomedViewVisible(!m_isZoomedViewVisible);
+            break;
+        case Qt::Key_R:
+            setZoomedViewRotating(!m_isZoomedViewRotating);
+            break;
+        case Qt::Key_T:
+            setTileTextureEnabled(!m_isTileTextureEnabled);
+            break;
+        default:
+            QOpenGLWidget::keyPressEvent(event);
+    }
+}
+
+double Map::getPixelsPerMeter() const {
+    return TransformationMatrix::getPixelsPerMeter(
+        m_maze->getWidth(),
+        m_maze->getHeight(),
+        m_windowWidth,
+        m_windowHeight,
+        m_zoom
+    );
+}
+
+Coordinate Map::pixelToPhysical(const QPoint& pixel) const {
+    double pixelsPerMeter = getPixelsPerMeter();
+    if (pixelsPerMeter <= 0.0) {
+        return m_center;
+    }
+    return m_center + Coordinate::Cartesian(
+        Distance::Meters((pixel.x() - 0.5 * m_windowWidth) / pixelsPerMeter),
+        Distance::Meters((0.5 * m_windowHeight - pixel.y()) / pixelsPerMeter)
+    );
+}
+
+void Map::zoomAround(const Coordinate& fixed, double zoom) {
+    // Scale the center's offset from the fixed point, which then stays put
+    zoom = qBound(MIN_ZOOM, zoom, MAX_ZOOM);
+    m_center = fixed + (m_center - fixed) * (m_zoom / zoom);
+    m_zoom = zoom;
+    update();
+}
+
+void Map::updateTransformationMatrix() {
+    // Must come after following the mouse, which moves the center
+    setTransformationMatrix(TransformationMatrix::get(
+        m_maze->getWidth(),
+        m_maze->getHeight(),
+        m_windowWidth,
+        m_windowHeight,
+        m_zoom,
+        m_center
+    ));
+}
+
+void Map::setTransformationMatrix(const QMatrix4x4& matrix) {
+    if (m_transformationVersion == 0 || matrix != m_transformationMatrix) {
+        m_transformationMatrix = matrix;
+        m_transformationVersion = m_resources == nullptr
+            ? 0 : m_resources->newTransformationVersion();
+    }
+}
+
+void Map::updateVisibleTiles() {
+
+    // Follow the mouse before figuring out what's visible
+    if (m_isFollowingMouse && m_mouseGraphic != nullptr) {
+        m_center = m_mouseGraphic->getCurrentTranslation();
+    }
+
+    double pixelsPerMeter = getPixelsPerMeter();
+    double tileLength = Dimensions::tileLength().getMeters();
+    m_isCoarse = tileLength * pixelsPerMeter < COARSE_TILE_PIXELS;
+
+    // The physical bounds of the map
+    double halfWidth = 0.5 * m_windowWidth / std::max(pixelsPerMeter, 1e-9);
+    double halfHeight = 0.5 * m_windowHeight / std::max(pixelsPerMeter, 1e-9);
+    cullTiles(
+        m_center.getX().getMeters() - halfWidth,
+        m_center.getX().getMeters() + halfWidth,
+        m_center.getY().getMeters() - halfHeight,
+        m_center.getY().getMeters() + halfHeight
+    );
+}
+
+void Map::cullTiles(double left, double right, double bottom, double top) {
+
+    double tileLength = Dimensions::tileLength().getMeters();
+    double halfWallWidth = Dimensions::halfWallWidth().getMeters();
+
+    // Chunks are in the order of their records, so visible chunks that are
+    // next to each other in a column can be drawn together
+    m_visibleTileRuns.clear();
+    m_visibleEdgeChunks.clear();
+    for (const TileChunk& chunk : *m_view->getTileChunks()) {
+        bool isVisible = (
+            chunk.x * tileLength - halfWallWidth < right &&
+            (chunk.x + chunk.width) * tileLength + halfWallWidth > left &&
+            chunk.y * tileLength - halfWallWidth < top &&
+            (chunk.y + chunk.height) * tileLength + halfWallWidth > bottom
+        );
+        if (!isVisible) {
+            continue;
+        }
+        if (chunk.x == 0 || chunk.y == 0) {
+            m_visibleEdgeChunks.append(chunk);
+        }
+        if (
+            !m_visibleTileRuns.isEmpty() &&
+            m_visibleTileRuns.last().second == chunk.begin
+        ) {
+            m_visibleTileRuns.last().second = chunk.end;
+        }
+        else {
+            m_visibleTileRuns.append({chunk.begin, chunk.end});
+        }
+    }
+}
+
+void Map::initTileProgram() {
+
+    QOpenGLShaderProgram* program = m_resources->getTileProgram();
+    program->bind();
+
+    m_tileVAO.create();
+    m_tileVAO.bind();
+
+    // Per-vertex attributes, from the shared template mesh
+    m_resources->getTileTemplateVBO()->bind();
+    program->enableAttributeArray("coordinate");
+    program->setAttributeBuffer(
+        "coordinate", // name
+        GL_FLOAT, // type
+        offsetof(VertexTileTemplate, x), // offset (bytes)
+        2, // tupleSize (number of elements in the attribute array)
+        sizeof(VertexTileTemplate) // stride (bytes between vertices)
     );
-    m_polygonProgram.link();
-    m_polygonProgram.bind();
+    program->enableAttributeArray("outward");
+    program->setAttributeBuffer(
+        "outward", // name
+        GL_FLOAT, // type
+        offsetof(VertexTileTemplate, outwardX), // offset (bytes)
+        2, // tupleSize (number of elements in the attribute array)
+        sizeof(VertexTileTemplate) // stride (bytes between vertices)
+    );
+    program->enableAttributeArray("part");
+    program->setAttributeBuffer(
+        "part", // name
+        GL_FLOAT, // type
+        offsetof(VertexTileTemplate, part), // offset (bytes)
+        1, // tupleSize (number of elements in the attribute array)
+        sizeof(VertexTileTemplate) // stride (bytes between vertices)
+    );
+    m_resources->getTileTemplateVBO()->release();
 
-    m_polygonVAO.create();
-    m_polygonVAO.bind();
+    // Per-instance attributes, from the tile records; these are integers, so
+    // they're passed through glVertexAttribPointer without normalization
+    m_tileInstanceVBO.create();
+    m_tileInstanceVBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_tilePositionLocation = program->attributeLocation("tilePosition");
+    program->enableAttributeArray(m_tilePositionLocation);
+    glVertexAttribDivisor(m_tilePositionLocation, 1);
+    m_tileStateLocation = program->attributeLocation("tileState");
+    program->enableAttributeArray(m_tileStateLocation);
+    glVertexAttribDivisor(m_tileStateLocation, 1);
+    setTileInstanceOffset(0, 1);
 
-    m_polygonVBO.create();
-    m_polygonVBO.bind();
-    m_polygonVBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    // The element array binding is part of the vertex array object's state,
+    // so the index buffer stays bound until the VAO is released
+    m_resources->getTileTemplateIBO()->bind();
 
-    m_polygonProgram.enableAttributeArray("coordinate");
-    m_polygonProgram.setAttributeBuffer(
+    m_tileVAO.release();
+    m_resources->getTileTemplateIBO()->release();
+    program->release();
+}
+
+void Map::setTileInstanceOffset(int instance, int stride) {
+    // The tile vertex array object must be bound; the attribute pointers
+    // are part of its state
+    std::size_t base = sizeof(TileInstance) * instance;
+    m_tileInstanceVBO.bind();
+    glVertexAttribPointer(
+        m_tilePositionLocation, // index
+        2, // size (number of elements in the attribute array)
+        GL_UNSIGNED_SHORT, // type
+        GL_FALSE, // normalized
+        sizeof(TileInstance) * stride, // stride (bytes between instances)
+        reinterpret_cast<const void*>(base + offsetof(TileInstance, x))
+    );
+    glVertexAttribPointer(
+        m_tileStateLocation, // index
+        4, // size (number of elements in the attribute array)
+        GL_UNSIGNED_BYTE, // type
+        GL_FALSE, // normalized
+        sizeof(TileInstance) * stride, // stride (bytes between instances)
+        reinterpret_cast<const void*>(base + offsetof(TileInstance, color))
+    );
+    m_tileInstanceVBO.release();
+}
+
+void Map::initPolygonProgram() {
+
+    QOpenGLShaderProgram* program = m_resources->getPolygonProgram();
+    program->bind();
+
+    m_mouseVAO.create();
+    m_mouseVAO.bind();
+
+    m_mouseVBO.create();
+    m_mouseVBO.bind();
+    m_mouseVBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    program->enableAttributeArray("coordinate");
+    program->setAttributeBuffer(
         "coordinate", // name
         GL_FLOAT, // type
         0, // offset (bytes)
         2, // tupleSize (number of elements in the attribute array)
-        2 * sizeof(float) + 4 * sizeof(unsigned char)// stride (bytes between vertices)
+        sizeof(VertexGraphic) // stride (bytes between vertices)
     );
-
-    m_polygonProgram.enableAttributeArray("inColor");
-    m_polygonProgram.setAttributeBuffer(
+    program->enableAttributeArray("inColor");
+    program->setAttributeBuffer(
         "inColor", // name
         GL_UNSIGNED_BYTE, // type
         2 * sizeof(float), // offset (bytes)
         4, // tupleSize (number of elements in the attribute array)
-        2 * sizeof(float) + 4 * sizeof(unsigned char) // stride (bytes between vertices)
+        sizeof(VertexGraphic) // stride (bytes between vertices)
     );
+    m_mouseVBO.release();
 
-    m_polygonVBO.release();
-    m_polygonVAO.release();
-    m_polygonProgram.release();
+    // Per-instance attributes, from the mouse records
+    m_mouseInstanceVBO.create();
+    m_mouseInstanceVBO.bind();
+    m_mouseInstanceVBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    program->enableAttributeArray("pose");
+    program->setAttributeBuffer(
+        "pose", // name
+        GL_FLOAT, // type
+        offsetof(MouseInstance, cosine), // offset (bytes)
+        4, // tupleSize (number of elements in the attribute array)
+        sizeof(MouseInstance) // stride (bytes between mice)
+    );
+    glVertexAttribDivisor(program->attributeLocation("pose"), 1);
+    program->enableAttributeArray("alpha");
+    program->setAttributeBuffer(
+        "alpha", // name
+        GL_FLOAT, // type
+        offsetof(MouseInstance, alpha), // offset (bytes)
+        1, // tupleSize (number of elements in the attribute array)
+        sizeof(MouseInstance) // stride (bytes between mice)
+    );
+    glVertexAttribDivisor(program->attributeLocation("alpha"), 1);
+    m_mouseInstanceVBO.release();
+
+    m_mouseVAO.release();
+    program->release();
 }
 
 void Map::initTextureProgram() {
 
-    m_textureProgram.addShaderFromSourceCode(
-        QOpenGLShader::Vertex,
-        R"(
-            uniform mat4 transformationMatrix;
-            attribute vec2 coordinate;
-            attribute vec2 inTextureCoordinate;
-            varying vec2 outTextureCoordinate;
-            void main() {
-                gl_Position = transformationMatrix * vec4(coordinate, 0.0, 1.0);
-                outTextureCoordinate = inTextureCoordinate;
-            }
-        )"
-    );
-    m_textureProgram.addShaderFromSourceCode(
-        QOpenGLShader::Fragment,
-        R"(
-            uniform sampler2D texture;
-            varying vec2 outTextureCoordinate;
-            void main() {
-                gl_FragColor = texture2D(texture, outTextureCoordinate);
-            }
-        )"
-    );
-    m_textureProgram.link();
-    m_textureProgram.bind();
+    QOpenGLShaderProgram* program = m_resources->getTextureProgram();
+    program->bind();
 
     m_textureVAO.create();
     m_textureVAO.bind();
 
-    m_textureVBO.create();
-    m_textureVBO.bind();
-    m_textureVBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-
-    m_textureProgram.enableAttributeArray("coordinate");
-    m_textureProgram.setAttributeBuffer(
-        "coordinate", // name
+    // Per-vertex attributes, from the shared unit quad
+    m_resources->getGlyphTemplateVBO()->bind();
+    program->enableAttributeArray("corner");
+    program->setAttributeBuffer(
+        "corner", // name
         GL_FLOAT, // type
         0, // offset (bytes)
         2, // tupleSize (number of elements in the attribute array)
-        4 * sizeof(float) // stride (bytes between vertices)
+        2 * sizeof(float) // stride (bytes between vertices)
     );
+    m_resources->getGlyphTemplateVBO()->release();
 
-    m_textureProgram.enableAttributeArray("inTextureCoordinate");
-    m_textureProgram.setAttributeBuffer(
-        "inTextureCoordinate", // name
+    // Per-instance attributes, from the glyph records; the tile position is
+    // an integer, so it's passed through glVertexAttribPointer without
+    // normalization, while the rest are normalized to [0, 1]
+    m_glyphInstanceVBO.create();
+    m_glyphInstanceVBO.bind();
+    m_glyphInstanceVBO.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    int glyphTileLocation = program->attributeLocation("glyphTile");
+    program->enableAttributeArray(glyphTileLocation);
+    glVertexAttribPointer(
+        glyphTileLocation, // index
+        2, // size (number of elements in the attribute array)
+        GL_UNSIGNED_SHORT, // type
+        GL_FALSE, // normalized
+        sizeof(GlyphInstance), // stride (bytes between glyphs)
+        reinterpret_cast<const void*>(offsetof(GlyphInstance, x)) // offset
+    );
+    glVertexAttribDivisor(glyphTileLocation, 1);
+    program->enableAttributeArray("bounds");
+    program->setAttributeBuffer(
+        "bounds", // name
+        GL_UNSIGNED_SHORT, // type
+        offsetof(GlyphInstance, left), // offset (bytes)
+        4, // tupleSize (number of elements in the attribute array)
+        sizeof(GlyphInstance) // stride (bytes between glyphs)
+    );
+    glVertexAttribDivisor(program->attributeLocation("bounds"), 1);
+    program->enableAttributeArray("uBounds");
+    program->setAttributeBuffer(
+        "uBounds", // name
+        GL_UNSIGNED_SHORT, // type
+        offsetof(GlyphInstance, uLeft), // offset (bytes)
+        2, // tupleSize (number of elements in the attribute array)
+        sizeof(GlyphInstance) // stride (bytes between glyphs)
+    );
+    glVertexAttribDivisor(program->attributeLocation("uBounds"), 1);
+    m_glyphInstanceVBO.release();
+
+    m_resources->getGlyphTemplateIBO()->bind();
+
+    m_textureVAO.release();
+    m_resources->getGlyphTemplateIBO()->release();
+    program->release();
+}
+
+void Map::initTileTextureProgram() {
+
+    QOpenGLShaderProgram* program = m_resources->getTileTextureProgram();
+    program->bind();
+
+    m_tileTextureVAO.create();
+    m_tileTextureVAO.bind();
+
+    // The shared unit quad, which the vertex shader stretches over the maze
+    m_resources->getGlyphTemplateVBO()->bind();
+    program->enableAttributeArray("corner");
+    program->setAttributeBuffer(
+        "corner", // name
         GL_FLOAT, // type
-        2 * sizeof(float), // offset (bytes)
+        0, // offset (bytes)
         2, // tupleSize (number of elements in the attribute array)
-        4 * sizeof(float) // stride (bytes between vertices)
+        2 * sizeof(float) // stride (bytes between vertices)
     );
+    m_resources->getGlyphTemplateVBO()->release();
+    m_resources->getGlyphTemplateIBO()->bind();
 
-    // Load the bitmap texture into the texture atlas
-    if (QFile::exists(FontImage::path())) {
-        m_textureAtlas = new QOpenGLTexture(QImage(
-            FontImage::path()
-        ).mirrored());
+    m_tileTextureVAO.release();
+    m_resources->getGlyphTemplateIBO()->release();
+    program->release();
+}
+
+bool Map::isTileTextureDrawn() const {
+    return (
+        m_isTileTextureEnabled &&
+        m_maze->getWidth() <= m_maxTextureSize &&
+        m_maze->getHeight() <= m_maxTextureSize
+    );
+}
+
+void Map::updateTileTexture() {
+
+    if (!isTileTextureDrawn()) {
+        return;
     }
-    else {
-        qWarning()
-            << "Font image file does not exist:"
-            << FontImage::path();
+    int width = m_maze->getWidth();
+    int height = m_maze->getHeight();
+    const QVector<TileInstance>* tileInstance = &m_snapshot->tileInstances;
+    auto copyTexel = [&](const TileInstance& tile) {
+        unsigned char* texel = m_tileTexels.data() + 4 * (
+            tile.y * width + tile.x
+        );
+        texel[0] = tile.color;
+        texel[1] = tile.walls;
+        texel[2] = tile.flags;
+        texel[3] = tile.heat;
+    };
+
+    // The whole texture is uploaded for a new view, and otherwise just the
+    // bounds of the tiles of each dirty range; a range is usually a few
+    // chunks in a column, so its bounds rarely hold many more tiles than it
+    if (m_isTileTextureStale) {
+        m_tileTexels.fill(0, 4 * width * height);
+        for (const TileInstance& tile : *tileInstance) {
+            copyTexel(tile);
+        }
+        if (m_tileTexture == 0) {
+            glGenTextures(1, &m_tileTexture);
+        }
+        glBindTexture(GL_TEXTURE_2D, m_tileTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(
+            GL_TEXTURE_2D, // target
+            0, // level
+            GL_RGBA8, // internalformat
+            width, // width (texels)
+            height, // height (texels)
+            0, // border
+            GL_RGBA, // format
+            GL_UNSIGNED_BYTE, // type
+            m_tileTexels.constData() // pixels
+        );
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_frameStats.uploadBytes += m_tileTexels.size();
+        m_isTileTextureStale = false;
+        return;
+    }
+    // Heat isn't put off here, since only the bounds of the ranges are
+    // uploaded, which costs far less than the records would
+    if (!m_isSnapshotNew) {
+        return;
+    }
+    m_textureRanges.resize(0);
+    for (const DirtyRange& range : m_snapshot->tileDirtyRanges) {
+        m_textureRanges.append(range);
+    }
+    for (const DirtyRange& range : m_snapshot->tileHeatDirtyRanges) {
+        m_textureRanges.append(range);
+    }
+    if (m_textureRanges.isEmpty()) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, m_tileTexture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    for (const DirtyRange& range : m_textureRanges) {
+        int left = width;
+        int right = 0;
+        int bottom = height;
+        int top = 0;
+        for (int i = range.begin; i < range.end; i += 1) {
+            const TileInstance& tile = tileInstance->at(i);
+            copyTexel(tile);
+            left = std::min(left, static_cast<int>(tile.x));
+            right = std::max(right, tile.x + 1);
+            bottom = std::min(bottom, static_cast<int>(tile.y));
+            top = std::max(top, tile.y + 1);
+        }
+        if (right <= left || top <= bottom) {
+            continue;
+        }
+        glTexSubImage2D(
+            GL_TEXTURE_2D, // target
+            0, // level
+            left, // xoffset (texels)
+            bottom, // yoffset (texels)
+            right - left, // width (texels)
+            top - bottom, // height (texels)
+            GL_RGBA, // format
+            GL_UNSIGNED_BYTE, // type
+            m_tileTexels.constData() + 4 * (bottom * width + left) // pixels
+        );
+        m_frameStats.uploadBytes += 4 * (right - left) * (top - bottom);
     }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    m_polygonVBO.release();
-    m_polygonVAO.release();
-    m_polygonProgram.release();
+void Map::deleteTileTexture() {
+    // The context must be current
+    if (m_tileTexture != 0) {
+        glDeleteTextures(1, &m_tileTexture);
+        m_tileTexture = 0;
+    }
+    m_isTileTextureStale = true;
 }
 
-void Map::repopulateVertexBufferObjects(const QVector<TriangleGraphic>& mouseBuffer) {
+void Map::updateVertexBufferObjects() {
+    PROFILE_ZONE("Map::updateVertexBufferObjects");
 
-    // Overwrite the polygon vertex buffer object data
-    m_polygonVBO.bind();
-    m_polygonVBO.allocate(sizeof(TriangleGraphic) * (
-        m_view->getGraphicCpuBuffer()->size() +
-        mouseBuffer.size()
-    ));
-    // Write the maze
-    m_polygonVBO.write(
-        0,
-        &(m_view->getGraphicCpuBuffer()->front()),
-        sizeof(TriangleGraphic) * m_view->getGraphicCpuBuffer()->size()
-    );
-    // Write the mouse
-    if (!mouseBuffer.isEmpty()) {
-        m_polygonVBO.write(
-            sizeof(TriangleGraphic) * m_view->getGraphicCpuBuffer()->size(),
-            &(mouseBuffer.front()),
-            sizeof(TriangleGraphic) * mouseBuffer.size()
+    // Only re-upload static data for a new view or a new text layout
+    bool isTileStale = m_isUploadStale;
+    bool isTextureStale = (
+        m_isUploadStale ||
+        m_uploadedTextureLayoutVersion != m_snapshot->textureLayoutVersion
+    );
+
+    // Tiles; the dirty ranges were already uploaded if the snapshot isn't
+    // new, e.g., if the map was repainted for a camera change. Walls, colors
+    // and fog always go out right away, while heat waits its turn below.
+    const QVector<TileInstance>* tileInstance = &m_snapshot->tileInstances;
+    if (isTileStale) {
+        m_tileInstanceVBO.bind();
+        allocateBuffer(
+            &m_tileInstanceVBO,
+            tileInstance->constData(),
+            sizeof(TileInstance) * tileInstance->size()
+        );
+        m_tileInstanceVBO.release();
+        m_frameStats.tilesUploaded += tileInstance->size();
+        m_pendingTileHeatRanges.clear();
+    }
+    else if (m_isSnapshotNew) {
+        m_tileInstanceVBO.bind();
+        for (const DirtyRange& range : m_snapshot->tileDirtyRanges) {
+            writeBuffer(
+                &m_tileInstanceVBO,
+                sizeof(TileInstance) * range.begin,
+                tileInstance->constData() + range.begin,
+                sizeof(TileInstance) * (range.end - range.begin)
+            );
+            m_frameStats.tilesUploaded += range.end - range.begin;
+        }
+        m_tileInstanceVBO.release();
+        m_pendingTileHeatRanges += m_snapshot->tileHeatDirtyRanges;
+    }
+
+    // The mouse mesh never changes, and is the same for every mouse; only
+    // the poses of the mice do
+    if (m_isMouseUploadStale) {
+        m_mouseTriangles.resize(0);
+        if (m_mouseGraphic != nullptr) {
+            m_mouseGraphic->draw(&m_mouseTriangles);
+        }
+        else if (!m_rivalMouseGraphics.isEmpty()) {
+            m_rivalMouseGraphics.first()->draw(&m_mouseTriangles);
+        }
+        else if (!m_ghostMouseGraphics.isEmpty()) {
+            m_ghostMouseGraphics.first()->draw(&m_mouseTriangles);
+        }
+        m_mouseVBO.bind();
+        allocateBuffer(
+            &m_mouseVBO,
+            m_mouseTriangles.constData(),
+            sizeof(TriangleGraphic) * m_mouseTriangles.size()
         );
+        m_mouseVBO.release();
+        m_mouseVertexCount = 3 * m_mouseTriangles.size();
+        m_frameStats.trianglesUploaded += m_mouseTriangles.size();
     }
-    m_polygonVBO.release();
 
-    // Overwrite the texture vertex buffer object data
-    m_textureVBO.bind();
-    m_textureVBO.allocate(
-        &(m_view->getTextureCpuBuffer()->front()),
-        sizeof(TriangleTexture) * m_view->getTextureCpuBuffer()->size()
+    // Everything else is low priority, and only gets whatever's left of the
+    // upload budget, unless it's been put off for too long
+    bool isBudgeted = (
+        0 < m_uploadBudgetBytes &&
+        m_deferredFrames < MAX_TEXT_UPLOAD_INTERVAL
     );
-    m_textureVBO.release();
+
+    // Heat, which is uploaded from the latest snapshot, so that it has the
+    // latest heat of every tile in the pending ranges
+    m_tileInstanceVBO.bind();
+    m_frameStats.tilesUploaded += writePendingRanges(
+        &m_tileInstanceVBO,
+        tileInstance->constData(),
+        sizeof(TileInstance),
+        &m_pendingTileHeatRanges,
+        isBudgeted
+    );
+    m_tileInstanceVBO.release();
+
+    // Tile text; the glyph buffer changes size as tiles outgrow their
+    // blocks, and when the blocks are compacted, and only as many glyphs as
+    // were uploaded are drawn, so a throttled upload is never overrun. The
+    // ranges of every snapshot are kept until they're uploaded, from the
+    // latest snapshot, which has all of their changes. A reallocation of the
+    // buffer is uploaded all at once, or not at all, and a new text layout
+    // (e.g., for a new view) always goes out right away.
+    const QVector<GlyphInstance>* glyphInstance = &m_snapshot->glyphInstances;
+    if (m_isSnapshotNew) {
+        m_pendingGlyphRanges += m_snapshot->glyphDirtyRanges;
+    }
+    bool isGlyphCountStale = m_uploadedGlyphCount != glyphInstance->size();
+    qint64 glyphBytes = sizeof(GlyphInstance) * glyphInstance->size();
+    m_framesSinceTextUpload += 1;
+    QElapsedTimer textTimer;
+    textTimer.start();
+    int numGlyphs = 0;
+    m_glyphInstanceVBO.bind();
+    if (
+        isTextureStale || (
+            isGlyphCountStale &&
+            m_textUploadInterval <= m_framesSinceTextUpload &&
+            (!isBudgeted || glyphBytes <= getRemainingUploadBudget())
+        )
+    ) {
+        allocateBuffer(
+            &m_glyphInstanceVBO,
+            glyphInstance->constData(),
+            glyphBytes
+        );
+        m_uploadedGlyphCount = glyphInstance->size();
+        m_pendingGlyphRanges.clear();
+        numGlyphs = glyphInstance->size();
+    }
+    else if (
+        !isGlyphCountStale &&
+        m_textUploadInterval <= m_framesSinceTextUpload
+    ) {
+        numGlyphs = writePendingRanges(
+            &m_glyphInstanceVBO,
+            glyphInstance->constData(),
+            sizeof(GlyphInstance),
+            &m_pendingGlyphRanges,
+            isBudgeted
+        );
+    }
+    m_glyphInstanceVBO.release();
+    if (0 < numGlyphs) {
+        double seconds = textTimer.nsecsElapsed() / 1e9;
+        if (TEXT_UPLOAD_BUDGET_SECONDS < seconds) {
+            m_textUploadInterval =
+                std::min(2 * m_textUploadInterval, MAX_TEXT_UPLOAD_INTERVAL);
+        }
+        else if (seconds < 0.5 * TEXT_UPLOAD_BUDGET_SECONDS) {
+            m_textUploadInterval = std::max(m_textUploadInterval / 2, 1);
+        }
+        m_framesSinceTextUpload = 0;
+        m_frameStats.glyphsUploaded += numGlyphs;
+    }
+    m_frameStats.textUploadInterval = m_textUploadInterval;
+
+    // Frames that leave anything behind count towards the limit above
+    bool isDeferred = (
+        !m_pendingTileHeatRanges.isEmpty() ||
+        !m_pendingGlyphRanges.isEmpty() ||
+        m_uploadedGlyphCount != glyphInstance->size()
+    );
+    m_deferredFrames = isDeferred ? m_deferredFrames + 1 : 0;
+
+    m_isUploadStale = false;
+    m_isMouseUploadStale = false;
+    m_uploadedTextureLayoutVersion = m_snapshot->textureLayoutVersion;
+}
+
+int Map::writePendingRanges(
+    QOpenGLBuffer* buffer,
+    const void* data,
+    int elementBytes,
+    QVector<DirtyRange>* ranges,
+    bool isBudgeted
+) {
+    // The buffer must be bound; ranges that don't fit in what's left of the
+    // budget are cut short, and whatever isn't written stays pending
+    MazeView::takeMerged(ranges, &m_mergedRanges);
+    const char* bytes = static_cast<const char*>(data);
+    int numElements = 0;
+    for (DirtyRange range : m_mergedRanges) {
+        if (isBudgeted) {
+            qint64 fit = getRemainingUploadBudget() / elementBytes;
+            if (fit < range.end - range.begin) {
+                int end = range.begin + static_cast<int>(qMax<qint64>(fit, 0));
+                ranges->append({end, range.end});
+                range.end = end;
+            }
+        }
+        if (range.end <= range.begin) {
+            continue;
+        }
+        writeBuffer(
+            buffer,
+            static_cast<qint64>(elementBytes) * range.begin,
+            bytes + static_cast<qint64>(elementBytes) * range.begin,
+            static_cast<qint64>(elementBytes) * (range.end - range.begin)
+        );
+        numElements += range.end - range.begin;
+    }
+    return numElements;
+}
+
+qint64 Map::getRemainingUploadBudget() const {
+    return m_uploadBudgetBytes - m_frameStats.uploadBytes;
+}
+
+void Map::updateMouseInstances() {
+    m_mouseInstances.clear();
+    if (m_mouseGraphic != nullptr) {
+        m_mouseInstances.append(m_mouseGraphic->getInstance(1.0));
+    }
+    for (const MouseGraphic* graphic : m_rivalMouseGraphics) {
+        m_mouseInstances.append(graphic->getInstance(RIVAL_MOUSE_ALPHA));
+    }
+    for (const MouseGraphic* graphic : m_ghostMouseGraphics) {
+        m_mouseInstances.append(graphic->getInstance(GHOST_MOUSE_ALPHA));
+    }
+    if (m_mouseInstances.isEmpty()) {
+        return;
+    }
+    m_mouseInstanceVBO.bind();
+    allocateBuffer(
+        &m_mouseInstanceVBO,
+        m_mouseInstances.constData(),
+        sizeof(MouseInstance) * m_mouseInstances.size()
+    );
+    m_mouseInstanceVBO.release();
+}
+
+bool Map::isMouseAnimating() const {
+    if (m_mouseGraphic != nullptr && m_mouseGraphic->isAnimating()) {
+        return true;
+    }
+    for (const MouseGraphic* graphic : m_rivalMouseGraphics) {
+        if (graphic->isAnimating()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Map::allocateBuffer(
+    QOpenGLBuffer* buffer,
+    const void* data,
+    qint64 count
+) {
+    // Buffer objects are sized in an int of bytes, which Maze::MAX_CELLS
+    // guarantees is enough for any maze that's loaded
+    ASSERT_LE(count, std::numeric_limits<int>::max());
+    buffer->allocate(data, static_cast<int>(count));
+    m_frameStats.uploadBytes += count;
+}
+
+void Map::writeBuffer(
+    QOpenGLBuffer* buffer,
+    qint64 offset,
+    const void* data,
+    qint64 count
+) {
+    ASSERT_LE(offset + count, std::numeric_limits<int>::max());
+    buffer->write(
+        static_cast<int>(offset),
+        data,
+        static_cast<int>(count)
+    );
+    m_frameStats.uploadBytes += count;
 }
 
 void Map::drawMap(
     QOpenGLShaderProgram* program,
     QOpenGLVertexArrayObject* vao,
     int vboStartingIndex,
-    int count
+    int count,
+    bool isIndexed
 ) {
 
     // Start using the program and vertex array object
     program->bind();
     vao->bind();
 
-    // If it's the texture program, bind the texture and set the uniform
-    if (program == &m_textureProgram) {
+    // If it's the texture program, bind the texture and set the uniforms
+    if (program == m_resources->getTextureProgram()) {
         glActiveTexture(GL_TEXTURE0);
-        m_textureAtlas->bind();
+        m_resources->getTextureAtlas()->bind();
         program->setUniformValue("texture", 0);
+        program->setUniformValue(
+            "tileLength",
+            static_cast<float>(Dimensions::tileLength().getMeters())
+        );
+    }
+
+    // If it's the tile texture program, bind the tile texture
+    if (program == m_resources->getTileTextureProgram()) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_tileTexture);
+        program->setUniformValue("tileTexture", 0);
+    }
+
+    // If it's either tile program, set the colors and the shape of the maze
+    if (
+        program == m_resources->getTileProgram() ||
+        program == m_resources->getTileTextureProgram()
+    ) {
+        auto toVector = [](Color color) {
+            RGB rgb = COLOR_TO_RGB(color);
+            return QVector4D(rgb.r / 255.0, rgb.g / 255.0, rgb.b / 255.0, 1.0);
+        };
+        QVector4D palette[NUM_COLORS];
+        for (int i = 0; i < NUM_COLORS; i += 1) {
+            palette[i] = toVector(static_cast<Color>(i));
+        }
+        program->setUniformValueArray("palette", palette, NUM_COLORS);
+        program->setUniformValue(
+            "wallColor",
+            toVector(ColorManager::getTileWallColor())
+        );
+        program->setUniformValue(
+            "cornerColor",
+            toVector(ColorManager::getTileCornerColor())
+        );
+        // Alpha of a wall at each of the TileInstance::WALL_LEVEL_* values
+        program->setUniformValue(
+            "wallAlphas",
+            QVector4D(0.0, 64 / 255.0, 1.0, 0.0)
+        );
+        program->setUniformValue(
+            "mazeSize",
+            QVector2D(m_maze->getWidth(), m_maze->getHeight())
+        );
+        program->setUniformValue(
+            "tileLength",
+            static_cast<float>(Dimensions::tileLength().getMeters())
+        );
+        program->setUniformValue(
+            "halfWallWidth",
+            static_cast<float>(Dimensions::halfWallWidth().getMeters())
+        );
     }
-    
-    // TODO: upforgrabs
-    // This should be QTransform
-    QMatrix4x4 transformationMatrix = TransformationMatrix::get(
-        m_maze->getWidth(),
-        m_maze->getHeight(),
-        m_windowWidth,
-        m_windowHeight
-    );
 
-    program->setUniformValue("transformationMatrix", transformationMatrix);
-    glDrawArrays(GL_TRIANGLES, vboStartingIndex, count);
+    // Only set the transformation matrix if it changed since the last draw
+    int& programVersion =
+        m_resources->getProgramTransformationVersion(program);
+    if (programVersion != m_transformationVersion) {
+        program->setUniformValue(
+            "transformationMatrix",
+            m_transformationMatrix
+        );
+        programVersion = m_transformationVersion;
+    }
+
+    if (program == m_resources->getTileProgram()) {
+        // The bases of every run of visible chunks, then their walls, then
+        // the walls of the edges of the maze; the records of a chunk are
+        // column by column, so its bottom row is a column's height apart
+        const TileTemplate::Layout& layout = m_isCoarse ?
+            TileTemplate::COARSE_LAYOUT :
+            TileTemplate::DETAILED_LAYOUT;
+        int walls = vboStartingIndex + layout.baseIndexCount;
+        int westEdge = walls + layout.wallIndexCount;
+        int southEdge = westEdge + layout.westEdgeIndexCount;
+        ASSERT_EQ(
+            southEdge + layout.southEdgeIndexCount,
+            vboStartingIndex + count
+        );
+        for (const QPair<int, int>& run : m_visibleTileRuns) {
+            setTileInstanceOffset(run.first, 1);
+            drawTileInstances(
+                vboStartingIndex,
+                layout.baseIndexCount,
+                run.second - run.first
+            );
+        }
+        for (const QPair<int, int>& run : m_visibleTileRuns) {
+            setTileInstanceOffset(run.first, 1);
+            drawTileInstances(
+                walls,
+                layout.wallIndexCount,
+                run.second - run.first
+            );
+        }
+        for (const TileChunk& chunk : m_visibleEdgeChunks) {
+            if (chunk.x == 0) {
+                setTileInstanceOffset(chunk.begin, 1);
+                drawTileInstances(
+                    westEdge,
+                    layout.westEdgeIndexCount,
+                    chunk.height
+                );
+            }
+            if (chunk.y == 0) {
+                setTileInstanceOffset(chunk.begin, chunk.height);
+                drawTileInstances(
+                    southEdge,
+                    layout.southEdgeIndexCount,
+                    chunk.width
+                );
+            }
+        }
+    }
+    else if (program == m_resources->getTextureProgram()) {
+        glDrawElementsInstanced(
+            GL_TRIANGLES,
+            count,
+            GL_UNSIGNED_INT,
+            nullptr,
+            m_uploadedGlyphCount
+        );
+        m_frameStats.drawCalls += 1;
+        m_frameStats.trianglesDrawn += count / 3 * m_uploadedGlyphCount;
+    }
+    else if (program == m_resources->getPolygonProgram()) {
+        glDrawArraysInstanced(
+            GL_TRIANGLES,
+            vboStartingIndex,
+            count,
+            m_mouseInstances.size()
+        );
+        m_frameStats.drawCalls += 1;
+        m_frameStats.trianglesDrawn += count / 3 * m_mouseInstances.size();
+    }
+    else if (isIndexed) {
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
+        m_frameStats.drawCalls += 1;
+        m_frameStats.trianglesDrawn += count / 3;
+    }
+    else {
+        glDrawArrays(GL_TRIANGLES, vboStartingIndex, count);
+        m_frameStats.drawCalls += 1;
+        m_frameStats.trianglesDrawn += count / 3;
+    }
 
     // If it's the texture program, we should additionally unbind the texture
-    if (program == &m_textureProgram) {
-        m_textureAtlas->release();
+    if (program == m_resources->getTextureProgram()) {
+        m_resources->getTextureAtlas()->release();
+    }
+    if (program == m_resources->getTileTextureProgram()) {
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     // Stop using the program and vertex array object
     vao->release();
 }
 
+void Map::drawTileInstances(int firstIndex, int count, int instanceCount) {
+    glDrawElementsInstanced(
+        GL_TRIANGLES,
+        count,
+        GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(sizeof(unsigned int) * firstIndex),
+        instanceCount
+    );
+    m_frameStats.drawCalls += 1;
+    m_frameStats.trianglesDrawn += count / 3 * instanceCount;
+}
+
+void Map::readTimeMonitor() {
+    if (!m_isTimeMonitorPending || !m_timeMonitor.isResultAvailable()) {
+        return;
+    }
+    // The results are available, so this doesn't block
+    QVector<GLuint64> intervals = m_timeMonitor.waitForIntervals();
+    ASSERT_EQ(intervals.size(), NUM_GPU_SAMPLES - 1);
+    m_frameStats.gpuFrame = m_timeMonitorFrame;
+    m_frameStats.gpuTilesSeconds = intervals.at(0) / 1e9;
+    m_frameStats.gpuTextSeconds = intervals.at(1) / 1e9;
+    m_frameStats.gpuMouseSeconds = intervals.at(2) / 1e9;
+    m_timeMonitor.reset();
+    m_isTimeMonitorPending = false;
+}
+
+void Map::onFrameSwapped() {
+    if (!m_swapTimer.isValid()) {
+        m_swapTimer.start();
+        return;
+    }
+    double seconds = m_swapTimer.nsecsElapsed() / 1e9;
+    m_swapTimer.restart();
+    m_frameStats.swapSeconds = seconds;
+    QWindow* window = this->window()->windowHandle();
+    QScreen* screen = window != nullptr ? window->screen() : nullptr;
+    if (screen == nullptr || screen->refreshRate() <= 0.0) {
+        return;
+    }
+    if (seconds < MAX_SWAP_SECONDS) {
+        int refreshes = qRound(seconds * screen->refreshRate());
+        m_frameStats.missedRefreshes += std::max(refreshes - 1, 0);
+    }
+}
+
+void Map::drawStatsOverlay() {
+
+    if (!m_isStatsOverlayVisible) {
+        return;
+    }
+
+    // Times that aren't available yet are shown as n/a
+    auto toMillis = [](double seconds) {
+        if (seconds < 0.0) {
+            return QString("n/a");
+        }
+        return QString::number(seconds * 1000, 'f', 3);
+    };
+    QStringList lines;
+    lines.append(QString("frame %1").arg(m_frameStats.frame));
+    lines.append(QString("cpu paint %1 ms, upload %2 ms").arg(
+        toMillis(m_frameStats.paintSeconds),
+        toMillis(m_frameStats.uploadSeconds)
+    ));
+    lines.append(QString("gpu tiles %1 ms, text %2 ms, mouse %3 ms").arg(
+        toMillis(m_frameStats.gpuTilesSeconds),
+        toMillis(m_frameStats.gpuTextSeconds),
+        toMillis(m_frameStats.gpuMouseSeconds)
+    ) + QString(" (frame %1)").arg(m_frameStats.gpuFrame));
+    lines.append(QString("uploaded %1 bytes, %2 draw calls").arg(
+        m_frameStats.uploadBytes
+    ).arg(
+        m_frameStats.drawCalls
+    ) + QString(" (%1 triangles)").arg(m_frameStats.trianglesDrawn));
+    lines.append(QString("uploaded %1 tiles, %2 glyphs, %3 triangles").arg(
+        m_frameStats.tilesUploaded
+    ).arg(
+        m_frameStats.glyphsUploaded
+    ).arg(
+        m_frameStats.trianglesUploaded
+    ));
+    lines.append(QString("swap %1 ms, %2 missed, text every %3 frames").arg(
+        toMillis(m_frameStats.swapSeconds)
+    ).arg(
+        m_frameStats.missedRefreshes
+    ).arg(
+        m_frameStats.textUploadInterval
+    ));
+    if (0 <= m_frameStats.allocations) {
+        lines.append(QString("allocated %1 times, %2 bytes").arg(
+            m_frameStats.allocations
+        ).arg(
+            m_frameStats.allocatedBytes
+        ));
+    }
+
+    // Draw the text on a translucent box in the upper left corner
+    QPainter painter(this);
+    painter.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    QRect bounds = painter.fontMetrics().boundingRect(
+        QRect(0, 0, width(), height()),
+        Qt::AlignLeft | Qt::AlignTop,
+        lines.join("\n")
+    );
+    bounds.translate(6, 6);
+    painter.fillRect(bounds.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(bounds, Qt::AlignLeft | Qt::AlignTop, lines.join("\n"));
+    painter.end();
+}
+
+void Map::logFrameStats() {
+
+    if (m_frameLog == nullptr) {
+        return;
+    }
+
+    // Times that aren't available are logged as null
+    auto toValue = [](double seconds) {
+        return seconds < 0.0 ? QJsonValue() : QJsonValue(seconds);
+    };
+    QJsonObject object;
+    object["frame"] = m_frameStats.frame;
+    object["paintSeconds"] = m_frameStats.paintSeconds;
+    object["uploadSeconds"] = m_frameStats.uploadSeconds;
+    object["uploadBytes"] = m_frameStats.uploadBytes;
+    object["tilesUploaded"] = m_frameStats.tilesUploaded;
+    object["glyphsUploaded"] = m_frameStats.glyphsUploaded;
+    object["trianglesUploaded"] = m_frameStats.trianglesUploaded;
+    object["drawCalls"] = m_frameStats.drawCalls;
+    object["trianglesDrawn"] = m_frameStats.trianglesDrawn;
+    object["gpuFrame"] = m_frameStats.gpuFrame;
+    object["gpuTilesSeconds"] = toValue(m_frameStats.gpuTilesSeconds);
+    object["gpuTextSeconds"] = toValue(m_frameStats.gpuTextSeconds);
+    object["gpuMouseSeconds"] = toValue(m_frameStats.gpuMouseSeconds);
+    object["swapSeconds"] = toValue(m_frameStats.swapSeconds);
+    object["missedRefreshes"] = m_frameStats.missedRefreshes;
+    object["textUploadInterval"] = m_frameStats.textUploadInterval;
+    auto toCount = [](long long count) {
+        return count < 0 ? QJsonValue() : QJsonValue(
+            static_cast<double>(count)
+        );
+    };
+    object["allocations"] = toCount(m_frameStats.allocations);
+    object["allocatedBytes"] = toCount(m_frameStats.allocatedBytes);
+    m_frameLog->write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_frameLog->write("\n");
+    m_frameLog->flush();
+}
+
 } 
@@ -1,47 +1,149 @@
 #pragma once
 
 #include <QOpenGLBuffer> 
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QMatrix4x4>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
 #include <QOpenGLDebugLogger>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
 #include <QOpenGLShaderProgram> 
-#include <QOpenGLTexture> 
+#include <QOpenGLTimeMonitor>
 #include <QOpenGLVertexArrayObject> 
 #include <QOpenGLWidget>
+#include <QPair>
+#include <QPoint>
 #include <QVector>
 
+#include "units/Coordinate.h"
+
+#include "AllocationCounter.h"
+#include "Direction.h"
+#include "FrameStats.h"
+#include "GlyphInstance.h"
+#include "MapResources.h"
 #include "Maze.h"
 #include "MazeView.h"
 #include "MouseGraphic.h"
+#include "MouseInstance.h"
+#include "TileChunk.h"
+#include "TileInstance.h"
 #include "TriangleGraphic.h"
+#include "VertexTileTemplate.h"
+#include "ViewSnapshot.h"
 
 namespace mms {
 
-class Map : public QOpenGLWidget, protected QOpenGLFunctions {
+class Map : public QOpenGLWidget, protected QOpenGLExtraFunctions {
     
-    // NOTE: Inheriting from QOpenGLFunctions allows
-    // us to call the OpenGL functions directly
+    // NOTE: Inheriting from QOpenGLExtraFunctions allows us to call the
+    // OpenGL functions directly, including the instanced drawing functions
 
     Q_OBJECT
 
 public:
 
     Map(QWidget* parent = 0);
+    ~Map();
 
     void setMaze(const Maze* maze);
     void setView(const MazeView* view);
     void setMouseGraphic(const MouseGraphic* mouseGraphic);
 
+    // Other mice in the same maze, drawn faded, along with the mouse
+    void setRivalMouseGraphics(const QVector<const MouseGraphic*>& graphics);
+
+    // Replays of previous runs, drawn fainter still, in the same draw
+    void setGhostMouseGraphics(const QVector<const MouseGraphic*>& graphics);
+
+    // Fits the whole maze within the map, and stops following the mouse
+    void resetCamera();
+
+    // Keeps the mouse in the middle of the map as it moves
+    void setFollowingMouse(bool following);
+    bool isFollowingMouse() const;
+
+    // Shows a close-up of the mouse in a corner of the map, which follows
+    // the mouse and, if rotating, turns with it so that it always faces up
+    void setZoomedViewVisible(bool visible);
+    bool isZoomedViewVisible() const;
+    void setZoomedViewRotating(bool rotating);
+    bool isZoomedViewRotating() const;
+
+    // Draws the tiles as a single quad over the whole maze, which looks up
+    // each tile's record in a texture, rather than as one mesh per tile, so
+    // that drawing them only costs as much as filling the maze's pixels;
+    // mazes larger than the biggest texture are still drawn with meshes
+    void setTileTextureEnabled(bool enabled);
+    bool isTileTextureEnabled() const;
+
     // Retrieves OpenGL version info
     QStringList getOpenGLVersionInfo();
 
+    // Draws the statistics of the most recent frame over the map
+    void setStatsOverlayVisible(bool visible);
+    bool isStatsOverlayVisible() const;
+
+    // Times frames on the GPU even when neither the overlay nor a frame log
+    // needs it, e.g., for benchmarks
+    void setGpuTimingEnabled(bool enabled);
+
+    // The statistics of the most recent frame
+    const FrameStats& getFrameStats() const;
+
+    // The number of bytes that may be uploaded in a frame before the tile
+    // heat and text are put off until later frames (walls, colors, fog and
+    // the mouse are always uploaded right away), or zero for no limit
+    void setUploadBudget(qint64 bytes);
+    qint64 getUploadBudget() const;
+
+    // Writes the statistics of every frame to the given file, as one JSON
+    // object per line; an empty path stops logging
+    bool setFrameLogPath(const QString& path);
+
+    // Draws the map without ever showing it, e.g., to export video. The map
+    // gets a context, surface and framebuffer of its own, of the given size
+    // in pixels, which are made current on the calling thread to initialize
+    // the map and to render each frame; returns false if they can't be made
+    bool initOffscreen(int width, int height);
+    QImage renderOffscreen();
+
+    // Renders a frame without reading it back, and waits for the GPU to
+    // finish it, as a swap would
+    void paintOffscreen();
+
     void shutdown();
 
+    // While editing, clicking the map (rather than dragging it) picks the
+    // wall of the clicked tile that's nearest to the cursor, and reports it;
+    // dragging still pans, and double clicking is just another click
+    void setEditing(bool editing);
+    bool isEditing() const;
+
+signals:
+
+    void wallClicked(int x, int y, Direction direction);
+
 protected:
 
     void initializeGL();
     void paintGL();
     void resizeGL(int width, int height);
 
+    // The wheel zooms around the cursor, dragging pans, double clicking
+    // resets the camera (unless editing), F toggles following the mouse, Z and R toggle the
+    // zoomed view and its rotation, T toggles the tile texture, and Home
+    // resets
+    void wheelEvent(QWheelEvent* event);
+    void mousePressEvent(QMouseEvent* event);
+    void mouseMoveEvent(QMouseEvent* event);
+    void mouseReleaseEvent(QMouseEvent* event);
+    void mouseDoubleClickEvent(QMouseEvent* event);
+    void keyPressEvent(QKeyEvent* event);
+
 private:
 
     // Logger of OpenGL warnings and errors
@@ -56,34 +158,242 @@ private:
     const Maze* m_maze;
     const MazeView* m_view;
     const MouseGraphic* m_mouseGraphic;
+    QVector<const MouseGraphic*> m_rivalMouseGraphics;
+    QVector<const MouseGraphic*> m_ghostMouseGraphics;
 
     // The map's window size, in pixels
     int m_windowWidth;
     int m_windowHeight;
 
-    // Polygon program variables
-    QOpenGLShaderProgram m_polygonProgram;
-    QOpenGLVertexArrayObject m_polygonVAO;
-    QOpenGLBuffer m_polygonVBO;
+    // Camera; a zoom of one fits the whole maze within the map, and the
+    // center is the physical coordinate shown in the middle of the map
+    static const double MIN_ZOOM;
+    static const double MAX_ZOOM;
+    static const double WHEEL_DEGREES_PER_DOUBLING;
+    double m_zoom;
+    Coordinate m_center;
+    bool m_isFollowingMouse;
+    bool m_isDragging;
+    QPoint m_dragPosition;
+    bool m_isEditing;
+    bool m_isClicking;
+    QPoint m_clickPosition;
+    void clickWall(const QPoint& pixel);
+    double getPixelsPerMeter() const;
+    Coordinate pixelToPhysical(const QPoint& pixel) const;
+    void zoomAround(const Coordinate& fixed, double zoom);
+
+    // The transformation matrix is built once per frame and versioned, so
+    // that it's only set on a program when it changed since that program's
+    // last draw; the programs are shared, so the versions come from (and are
+    // tracked by) the shared resources, and are zero until there are any
+    QMatrix4x4 m_transformationMatrix;
+    int m_transformationVersion;
+    void updateTransformationMatrix();
+    void setTransformationMatrix(const QMatrix4x4& matrix);
+
+    // Culling and level of detail; only chunks of tiles that overlap the map
+    // are drawn, as runs of consecutive records, and tiles that are smaller
+    // than COARSE_TILE_PIXELS are drawn with the coarse mesh and no text.
+    // The visible chunks on the west or south edge of the maze also draw the
+    // walls of that edge (see TileTemplate::Layout).
+    static const double COARSE_TILE_PIXELS;
+    QVector<QPair<int, int>> m_visibleTileRuns;
+    QVector<TileChunk> m_visibleEdgeChunks;
+    bool m_isCoarse;
+    void updateVisibleTiles();
+    void cullTiles(double left, double right, double bottom, double top);
 
-    // Texture program variables
-    QOpenGLTexture* m_textureAtlas;
-    QOpenGLShaderProgram m_textureProgram;
+    // The zoomed view is drawn after the map, into a square in its corner
+    // that's ZOOMED_VIEW_FRACTION of the map's shorter side, from the same
+    // buffers but with its own transformation matrix and visible tiles. It
+    // spans ZOOMED_VIEW_TILES tiles, so it only ever draws a few chunks.
+    static const double ZOOMED_VIEW_FRACTION;
+    static const double ZOOMED_VIEW_TILES;
+    static const int ZOOMED_VIEW_BORDER_PIXELS;
+    static const int ZOOMED_VIEW_MIN_PIXELS;
+    bool m_isZoomedViewVisible;
+    bool m_isZoomedViewRotating;
+    void drawZoomedView();
+
+    // The programs, template meshes and texture atlas, shared by every map,
+    // and acquired when the map's context is initialized
+    MapResources* m_resources;
+    void releaseResources();
+
+    // Tile program variables; the shared template mesh is drawn once per
+    // tile, with colors and wall alphas taken from a buffer of per-tile
+    // records that's updated only where it changed
+    QOpenGLVertexArrayObject m_tileVAO;
+    QOpenGLBuffer m_tileInstanceVBO;
+    int m_tilePositionLocation;
+    int m_tileStateLocation;
+
+    // Points the per-instance attributes at the given record, since
+    // instanced draws can't otherwise start at any but the first instance;
+    // each instance after it is stride records further along, so that the
+    // bottom row of a chunk, whose records are a column apart, can be drawn
+    // as easily as a column
+    void setTileInstanceOffset(int instance, int stride);
+
+    // Draws the given part of the tile meshes, for the given instances
+    void drawTileInstances(int firstIndex, int count, int instanceCount);
+
+    // Tile texture program variables; the texture has a texel for each
+    // tile, which is a copy of its record's state, and is kept in sync with
+    // the records through a copy on the CPU, from which the bounds of each
+    // dirty range are uploaded. It's only kept in sync while it's drawn.
+    bool m_isTileTextureEnabled;
+    bool m_isTileTextureStale;
+    int m_maxTextureSize;
+    GLuint m_tileTexture;
+    QVector<unsigned char> m_tileTexels;
+    QOpenGLVertexArrayObject m_tileTextureVAO;
+    bool isTileTextureDrawn() const;
+    void updateTileTexture();
+    void deleteTileTexture();
+
+    // Polygon program variables; the mouse mesh is uploaded once, with its
+    // positions and colors interleaved in a single buffer, and is drawn once
+    // for every mouse, in a single draw call, each instance moved to its
+    // mouse's current pose by a record that's rewritten every frame
+    static const float RIVAL_MOUSE_ALPHA;
+    static const float GHOST_MOUSE_ALPHA;
+    QOpenGLVertexArrayObject m_mouseVAO;
+    QOpenGLBuffer m_mouseVBO;
+    QOpenGLBuffer m_mouseInstanceVBO;
+    QVector<MouseInstance> m_mouseInstances;
+    void updateMouseInstances();
+
+    // Mice are posed as of the time that they're drawn, so while any of them
+    // is animating, every frame schedules the next
+    bool isMouseAnimating() const;
+
+    // Texture program variables; a unit quad is drawn once per glyph, and
+    // stretched over the glyph's bounds. The texture atlas is a signed
+    // distance field, so that glyphs stay sharp at any scale.
     QOpenGLVertexArrayObject m_textureVAO;
-    QOpenGLBuffer m_textureVBO;
+    QOpenGLBuffer m_glyphInstanceVBO;
+
+    // The snapshot of the view that's drawn this frame, which the view owns,
+    // and whether it was published since the previous frame's snapshot
+    const ViewSnapshot* m_snapshot;
+    bool m_isSnapshotNew;
+
+    // Whether the buffers hold stale data for some other view or mouse, and
+    // which text layout (and how many glyphs) were last uploaded
+    bool m_isUploadStale;
+    bool m_isMouseUploadStale;
+    int m_uploadedTextureLayoutVersion;
+    int m_uploadedGlyphCount;
+    int m_mouseVertexCount;
 
-    // Initialize the graphics
+    // Uploads of the tile text are throttled, so that a storm of text changes
+    // can't make the mouse miss frames: whenever an upload takes longer than
+    // TEXT_UPLOAD_BUDGET_SECONDS, the next one waits for twice as many frames
+    // (up to MAX_TEXT_UPLOAD_INTERVAL), and the changes of the frames in
+    // between are coalesced into it; once uploads are cheap again, the
+    // interval halves back down to every frame. A new text layout is always
+    // uploaded right away.
+    static const double TEXT_UPLOAD_BUDGET_SECONDS;
+    static const int MAX_TEXT_UPLOAD_INTERVAL;
+    int m_textUploadInterval;
+    int m_framesSinceTextUpload;
+    QVector<DirtyRange> m_pendingGlyphRanges;
+
+    // Heat and text are also the first to be put off once the frame's uploads
+    // reach the budget, but never for MAX_TEXT_UPLOAD_INTERVAL frames in a
+    // row, so that they're shown eventually, however small the budget
+    qint64 m_uploadBudgetBytes;
+    int m_deferredFrames;
+    QVector<DirtyRange> m_pendingTileHeatRanges;
+    qint64 getRemainingUploadBudget() const;
+
+    // Scratch space for the geometry and ranges of a frame, which is emptied
+    // rather than freed after each use, so that a frame only allocates when
+    // it needs more than any frame before it
+    QVector<TriangleGraphic> m_mouseTriangles;
+    QVector<DirtyRange> m_textureRanges;
+    QVector<DirtyRange> m_mergedRanges;
+
+    // Frame pacing; the default surface format syncs swaps to the display's
+    // refresh, so the interval between swaps shows whether the map keeps up,
+    // and every refresh beyond the first in an interval was missed. Longer
+    // intervals than MAX_SWAP_SECONDS mean the map was idle, not late.
+    static const double MAX_SWAP_SECONDS;
+    QElapsedTimer m_swapTimer;
+    void onFrameSwapped();
+
+    // Frame instrumentation; the time monitor takes a sample before the
+    // tiles and after each of the tiles, the text and the mouse, and a new
+    // frame is only timed once the previous frame's results were read back
+    static const int NUM_GPU_SAMPLES;
+    QOpenGLTimeMonitor m_timeMonitor;
+    bool m_isTimeMonitorPending;
+    int m_timeMonitorFrame;
+    FrameStats m_frameStats;
+    bool m_isStatsOverlayVisible;
+    bool m_isGpuTimingEnabled;
+    QFile* m_frameLog;
+    void readTimeMonitor();
+    void drawStatsOverlay();
+    void logFrameStats();
+
+    // Counts the allocations of the paint that started with the given counts,
+    // unless the counter was off for any of it
+    void updateFrameAllocations(
+        bool isCounting,
+        const AllocationCounts& before);
+
+    // Only created if the map is offscreen
+    QOffscreenSurface* m_offscreenSurface;
+    QOpenGLContext* m_offscreenContext;
+    QOpenGLFramebufferObject* m_offscreenFramebuffer;
+
+    // Initialize this map's vertex array objects and instance buffers, for
+    // the shared programs
+    void initTileProgram();
     void initPolygonProgram();
     void initTextureProgram();
+    void initTileTextureProgram();
+
+    // Drawing helper methods; everything uploaded while painting goes
+    // through the allocate and write helpers, which count the bytes
+    void updateVertexBufferObjects();
+
+    // Draws the tiles, text and mice with the current transformation matrix
+    // and visible tiles, timing each of them if isTimed
+    void drawLayers(bool isTimed);
+    void allocateBuffer(
+        QOpenGLBuffer* buffer,
+        const void* data,
+        qint64 count);
 
-    // Drawing helper methods
-    void repopulateVertexBufferObjects(
-        const QVector<TriangleGraphic>& mouseBuffer);
+    // Writes pending ranges of elements of the bound buffer, within the
+    // budget if isBudgeted, and returns the number of elements written
+    int writePendingRanges(
+        QOpenGLBuffer* buffer,
+        const void* data,
+        int elementBytes,
+        QVector<DirtyRange>* ranges,
+        bool isBudgeted);
+    void writeBuffer(
+        QOpenGLBuffer* buffer,
+        qint64 offset,
+        const void* data,
+        qint64 count);
+    // Draws count vertices starting at vboStartingIndex, or, if the vertex
+    // array object has an index buffer, count indices starting at the first;
+    // the tile program draws count indices starting at vboStartingIndex once
+    // for every visible tile, the texture program draws its indices once for
+    // every glyph, and the polygon program draws its vertices once for every
+    // mouse
     void drawMap(
         QOpenGLShaderProgram* program,
         QOpenGLVertexArrayObject* vao,
         int vboStartingIndex,
-        int count);
+        int count,
+        bool isIndexed);
 };
 
 } 
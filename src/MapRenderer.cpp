@@ -0,0 +1,38 @@
+#include "MapRenderer.h"
+
+#include <QDebug>
+
+#include "OpenGLMapRenderer.h"
+#include "SoftwareMapRenderer.h"
+
+namespace mms {
+
+MapRenderer::~MapRenderer() {
+}
+
+const QMap<QString, RenderBackend>& MapRenderer::STRING_TO_RENDER_BACKEND() {
+    static const QMap<QString, RenderBackend> map = {
+        {"auto", RenderBackend::AUTO},
+        {"opengl", RenderBackend::OPENGL},
+        {"software", RenderBackend::SOFTWARE},
+    };
+    return map;
+}
+
+MapRenderer* MapRenderer::create(RenderBackend backend, int width, int height) {
+    if (backend != RenderBackend::SOFTWARE) {
+        OpenGLMapRenderer* renderer = new OpenGLMapRenderer();
+        if (renderer->init(width, height)) {
+            return renderer;
+        }
+        delete renderer;
+        if (backend == RenderBackend::OPENGL) {
+            qWarning() << "Unable to create an offscreen OpenGL context";
+            return nullptr;
+        }
+        qInfo() << "No offscreen OpenGL context, so rendering in software";
+    }
+    return new SoftwareMapRenderer(width, height);
+}
+
+} 
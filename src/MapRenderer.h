@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QImage>
+#include <QMap>
+#include <QString>
+
+#include "Maze.h"
+#include "MazeView.h"
+#include "MouseGraphic.h"
+
+namespace mms {
+
+enum class RenderBackend {
+    AUTO, // OpenGL if a context can be made, and software otherwise
+    OPENGL, // the map, drawn into an offscreen framebuffer
+    SOFTWARE, // rasterized on the CPU, with no GPU or display at all
+};
+
+class MapRenderer {
+
+    // Draws a maze view and its mouse into images, without a window, for
+    // exporting video and rendering previews. Every backend draws from the
+    // same snapshots of the view and the same mouse meshes as the map in
+    // the window, with the whole maze in view, as the map shows it when its
+    // camera is reset; which platform the OpenGL backend's context comes
+    // from (e.g., EGL, with -platform offscreen) is up to Qt. The software
+    // backend needs neither a GPU nor a display, but leaves out the tile
+    // text, as the map does for tiles that are only a few pixels wide.
+
+public:
+
+    virtual ~MapRenderer();
+
+    static const QMap<QString, RenderBackend>& STRING_TO_RENDER_BACKEND();
+
+    // Images are of the given size in pixels; returns nullptr, having logged
+    // why, if the backend can't be created
+    static MapRenderer* create(RenderBackend backend, int width, int height);
+
+    virtual RenderBackend getBackend() const = 0;
+
+    // No ownership of any of these
+    virtual void setMaze(const Maze* maze) = 0;
+    virtual void setView(const MazeView* view) = 0;
+    virtual void setMouseGraphic(const MouseGraphic* mouseGraphic) = 0;
+
+    // Draws the view's most recently published snapshot
+    virtual QImage render() = 0;
+
+};
+
+} 
@@ -0,0 +1,543 @@
+#include "MapResources.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QOpenGLFunctions>
+#include <QStringList>
+#include <QVector>
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "FontImage.h"
+#include "Profiler.h"
+#include "TileTemplate.h"
+#include "VertexTileTemplate.h"
+
+namespace mms {
+
+QHash<QOpenGLContextGroup*, MapResources*> MapResources::INSTANCES;
+
+Q_LOGGING_CATEGORY(PROGRAMS_LOG, "mms.opengl.programs")
+
+MapResources* MapResources::acquire() {
+    QOpenGLContext* current = QOpenGLContext::currentContext();
+    ASSERT_FA(current == nullptr);
+    MapResources*& resources = INSTANCES[current->shareGroup()];
+    if (resources == nullptr) {
+        resources = new MapResources();
+        resources->m_group = current->shareGroup();
+    }
+    resources->m_numReferences += 1;
+    return resources;
+}
+
+void MapResources::release(MapResources* resources) {
+    ASSERT_FA(resources == nullptr);
+    ASSERT_LT(0, resources->m_numReferences);
+    ASSERT_EQ(
+        QOpenGLContext::currentContext()->shareGroup(),
+        resources->m_group
+    );
+    resources->m_numReferences -= 1;
+    if (resources->m_numReferences == 0) {
+        INSTANCES.remove(resources->m_group);
+        delete resources;
+    }
+}
+
+QOpenGLShaderProgram* MapResources::getTileProgram() {
+    return &m_tileProgram;
+}
+
+QOpenGLShaderProgram* MapResources::getPolygonProgram() {
+    return &m_polygonProgram;
+}
+
+QOpenGLShaderProgram* MapResources::getTextureProgram() {
+    return &m_textureProgram;
+}
+
+QOpenGLShaderProgram* MapResources::getTileTextureProgram() {
+    return &m_tileTextureProgram;
+}
+
+QOpenGLBuffer* MapResources::getTileTemplateVBO() {
+    return &m_tileTemplateVBO;
+}
+
+QOpenGLBuffer* MapResources::getTileTemplateIBO() {
+    return &m_tileTemplateIBO;
+}
+
+QOpenGLBuffer* MapResources::getGlyphTemplateVBO() {
+    return &m_glyphTemplateVBO;
+}
+
+QOpenGLBuffer* MapResources::getGlyphTemplateIBO() {
+    return &m_glyphTemplateIBO;
+}
+
+QOpenGLTexture* MapResources::getTextureAtlas() {
+    return m_textureAtlas;
+}
+
+int MapResources::newTransformationVersion() {
+    m_transformationVersion += 1;
+    return m_transformationVersion;
+}
+
+int& MapResources::getProgramTransformationVersion(
+        const QOpenGLShaderProgram* program) {
+    return m_programTransformationVersions[program];
+}
+
+MapResources::MapResources() :
+    m_group(nullptr),
+    m_numReferences(0),
+    m_transformationVersion(0),
+    m_tileTemplateVBO(QOpenGLBuffer::VertexBuffer),
+    m_tileTemplateIBO(QOpenGLBuffer::IndexBuffer),
+    m_glyphTemplateVBO(QOpenGLBuffer::VertexBuffer),
+    m_glyphTemplateIBO(QOpenGLBuffer::IndexBuffer),
+    m_textureAtlas(nullptr),
+    m_numUploadedGlyphs(0) {
+    PROFILE_ZONE("MapResources::MapResources");
+    QElapsedTimer timer;
+    timer.start();
+    initTileProgram();
+    initPolygonProgram();
+    initTextureProgram();
+    initTileTextureProgram();
+    qCInfo(PROGRAMS_LOG).noquote().nospace()
+        << "Built programs in " << timer.elapsed() << " ms, for "
+        << getDriverIdentity() << ", "
+        << (isProgramBinarySupported()
+            ? "from the program binary cache if they were cached"
+            : "from source, since program binaries aren't supported");
+}
+
+QString MapResources::getDriverIdentity() {
+    QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+    QStringList identity;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        identity.append(
+            reinterpret_cast<const char*>(functions->glGetString(name)));
+    }
+    return identity.join(" / ");
+}
+
+bool MapResources::isProgramBinarySupported() {
+    // The same check as Qt's own, which doesn't use the cache otherwise
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QPair<int, int> version = context->format().version();
+    if (context->isOpenGLES()) {
+        return (
+            qMakePair(3, 0) <= version ||
+            context->hasExtension("GL_OES_get_program_binary")
+        );
+    }
+    return (
+        qMakePair(4, 1) <= version ||
+        context->hasExtension("GL_ARB_get_program_binary")
+    );
+}
+
+MapResources::~MapResources() {
+    delete m_textureAtlas;
+}
+
+void MapResources::initTileProgram() {
+
+    // The palette is indexed by the value of each Color
+    m_tileProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        QString("#define NUM_COLORS %1\n").arg(NUM_COLORS) +
+        R"(
+            uniform mat4 transformationMatrix;
+            uniform vec2 mazeSize;
+            uniform float tileLength;
+            uniform float halfWallWidth;
+            uniform vec4 palette[NUM_COLORS];
+            uniform vec4 wallColor;
+            uniform vec4 cornerColor;
+            uniform vec4 wallAlphas;
+            attribute vec2 coordinate;
+            attribute vec2 outward;
+            attribute float part;
+            attribute vec2 tilePosition;
+            attribute vec4 tileState;
+            varying vec4 outColor;
+            void main(void) {
+
+                // Tiles on the edge of the maze extend by half a wall width
+                vec2 isFirst = vec2(lessThan(tilePosition, vec2(0.5)));
+                vec2 isLast = vec2(greaterThan(tilePosition, mazeSize - 1.5));
+                vec2 extension =
+                    max(outward, 0.0) * isLast - max(-outward, 0.0) * isFirst;
+                vec2 position =
+                    tilePosition * tileLength +
+                    coordinate +
+                    extension * halfWallWidth;
+                gl_Position = transformationMatrix * vec4(position, 0.0, 1.0);
+
+                // The state is (color, walls, flags, heat); walls hold two
+                // bits per direction, and dividing by powers of two is exact.
+                // Heat is mapped from blue, through green, to red.
+                if (part < 0.5) {
+                    outColor = palette[int(tileState.x)];
+                    if (mod(floor(tileState.z / 2.0), 2.0) > 0.5) {
+                        float heat = tileState.w / 255.0;
+                        outColor = vec4(clamp(
+                            1.5 - abs(4.0 * heat - vec3(3.0, 2.0, 1.0)),
+                            0.0,
+                            1.0
+                        ), 1.0);
+                    }
+                }
+                else if (part < 4.5) {
+                    vec4 levels = mod(
+                        floor(tileState.y / vec4(1.0, 4.0, 16.0, 64.0)),
+                        4.0
+                    );
+                    float level = dot(
+                        levels,
+                        vec4(equal(vec4(part), vec4(1.0, 2.0, 3.0, 4.0)))
+                    );
+                    float alpha = dot(
+                        wallAlphas,
+                        vec4(equal(vec4(level), vec4(0.0, 1.0, 2.0, 3.0)))
+                    );
+                    outColor = vec4(wallColor.rgb, alpha);
+                }
+                else {
+                    outColor = cornerColor;
+                }
+                if (mod(tileState.z, 2.0) > 0.5) {
+                    outColor.rgb *= 0.5;
+                }
+            }
+        )"
+    );
+    m_tileProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        R"(
+            varying vec4 outColor;
+            void main(void) {
+               gl_FragColor = outColor;
+            }
+        )"
+    );
+    m_tileProgram.link();
+
+    // The template mesh is the same for every maze and every map, so it's
+    // only ever uploaded once
+    const QVector<VertexTileTemplate>& tileTemplate =
+        TileTemplate::getVertices();
+    m_tileTemplateVBO.create();
+    m_tileTemplateVBO.bind();
+    m_tileTemplateVBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_tileTemplateVBO.allocate(
+        tileTemplate.constData(),
+        sizeof(VertexTileTemplate) * tileTemplate.size()
+    );
+    m_tileTemplateVBO.release();
+
+    const QVector<unsigned int>& tileTemplateIndex =
+        TileTemplate::getIndices();
+    m_tileTemplateIBO.create();
+    m_tileTemplateIBO.bind();
+    m_tileTemplateIBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_tileTemplateIBO.allocate(
+        tileTemplateIndex.constData(),
+        sizeof(unsigned int) * tileTemplateIndex.size()
+    );
+    m_tileTemplateIBO.release();
+}
+
+void MapResources::initPolygonProgram() {
+
+    m_polygonProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        R"(
+            uniform mat4 transformationMatrix;
+            attribute vec2 coordinate;
+            attribute vec4 inColor;
+            attribute vec4 pose;
+            attribute float alpha;
+            varying vec4 outColor;
+            void main(void) {
+                vec2 rotated = vec2(
+                    pose.x * coordinate.x - pose.y * coordinate.y,
+                    pose.y * coordinate.x + pose.x * coordinate.y
+                );
+                gl_Position =
+                    transformationMatrix *
+                    vec4(rotated + pose.zw, 0.0, 1.0);
+                outColor = vec4(inColor.rgb, inColor.a * alpha);
+            }
+        )"
+    );
+    m_polygonProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        R"(
+            varying vec4 outColor;
+            void main(void) {
+               gl_FragColor = outColor;
+            }
+        )"
+    );
+    m_polygonProgram.link();
+}
+
+void MapResources::initTextureProgram() {
+
+    m_textureProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        R"(
+            uniform mat4 transformationMatrix;
+            uniform float tileLength;
+            attribute vec2 corner;
+            attribute vec2 glyphTile;
+            attribute vec4 bounds;
+            attribute vec2 uBounds;
+            varying vec2 outTextureCoordinate;
+            void main() {
+                // The bounds are fractions of the glyph's tile
+                vec2 position =
+                    (glyphTile + mix(bounds.xy, bounds.zw, corner)) *
+                    tileLength;
+                gl_Position = transformationMatrix * vec4(position, 0.0, 1.0);
+                outTextureCoordinate = vec2(
+                    mix(uBounds.x, uBounds.y, corner.x),
+                    corner.y
+                );
+            }
+        )"
+    );
+    m_textureProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        R"(
+            uniform sampler2D texture;
+            varying vec2 outTextureCoordinate;
+            void main() {
+                // Antialias over about a pixel on either side of the edge
+                vec4 texel = texture2D(texture, outTextureCoordinate);
+                float width = fwidth(texel.a);
+                float alpha = smoothstep(0.5 - width, 0.5 + width, texel.a);
+                gl_FragColor = vec4(texel.rgb, alpha);
+            }
+        )"
+    );
+    m_textureProgram.link();
+
+    // A unit quad (lower left, upper left, upper right, lower right), made of
+    // two triangles (LL, UL, UR and LL, UR, LR)
+    static const float corners[] = {0, 0, 0, 1, 1, 1, 1, 0};
+    static const unsigned int indices[] = {0, 1, 2, 0, 2, 3};
+
+    m_glyphTemplateVBO.create();
+    m_glyphTemplateVBO.bind();
+    m_glyphTemplateVBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_glyphTemplateVBO.allocate(corners, sizeof(corners));
+    m_glyphTemplateVBO.release();
+
+    m_glyphTemplateIBO.create();
+    m_glyphTemplateIBO.bind();
+    m_glyphTemplateIBO.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_glyphTemplateIBO.allocate(indices, sizeof(indices));
+    m_glyphTemplateIBO.release();
+
+    // Load the distance field of the bitmap font into the start of the
+    // texture atlas, straight from its precomputed bytes, if it's shipped;
+    // the rest of the atlas starts out blank, and is filled in as glyphs are
+    // rasterized. It has to be filtered linearly, and mipmaps would blur the
+    // glyphs together.
+    QByteArray pixels;
+    int width = 0;
+    int height = 0;
+    if (!FontImage::readPrecomputedField(&pixels, &width, &height)) {
+        if (!QFile::exists(FontImage::path())) {
+            qWarning()
+                << "Font image file does not exist:"
+                << FontImage::path();
+            return;
+        }
+        QImage field = FontImage::distanceField().mirrored().convertToFormat(
+            QImage::Format_RGBA8888);
+        width = field.width();
+        height = field.height();
+        pixels = QByteArray(
+            reinterpret_cast<const char*>(field.constBits()),
+            4 * width * height
+        );
+    }
+    int atlasWidth = FontImage::NUM_CELLS * FontImage::CELL_WIDTH;
+    m_textureAtlas = new QOpenGLTexture(QOpenGLTexture::Target2D);
+    m_textureAtlas->setFormat(QOpenGLTexture::RGBA8_UNorm);
+    m_textureAtlas->setSize(atlasWidth, FontImage::CELL_HEIGHT);
+    m_textureAtlas->setMipLevels(1);
+    m_textureAtlas->allocateStorage(
+        QOpenGLTexture::RGBA,
+        QOpenGLTexture::UInt8);
+    QByteArray blank(4 * atlasWidth * FontImage::CELL_HEIGHT, 0);
+    m_textureAtlas->setData(
+        QOpenGLTexture::RGBA,
+        QOpenGLTexture::UInt8,
+        blank.constData());
+    uploadToAtlas(0, qMin(width, atlasWidth), height, pixels.constData());
+    m_textureAtlas->setMinificationFilter(QOpenGLTexture::Linear);
+    m_textureAtlas->setMagnificationFilter(QOpenGLTexture::Linear);
+    m_textureAtlas->setWrapMode(QOpenGLTexture::ClampToEdge);
+}
+
+void MapResources::uploadGlyphs() {
+    if (m_textureAtlas == nullptr) {
+        return;
+    }
+    int first = FontImage::characters().size() + m_numUploadedGlyphs;
+    const QVector<QImage> fields =
+        FontImage::rasterizedFields(m_numUploadedGlyphs);
+    for (int i = 0; i < fields.size(); i += 1) {
+        QImage field =
+            fields.at(i).mirrored().convertToFormat(QImage::Format_RGBA8888);
+        uploadToAtlas(
+            (first + i) * FontImage::CELL_WIDTH,
+            field.width(),
+            field.height(),
+            field.constBits()
+        );
+    }
+    m_numUploadedGlyphs += fields.size();
+}
+
+void MapResources::uploadToAtlas(
+        int x,
+        int width,
+        int height,
+        const void* pixels) {
+    // Rows of RGBA bytes are always aligned to four bytes, as GL expects
+    QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+    m_textureAtlas->bind();
+    functions->glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        x,
+        0,
+        width,
+        qMin(height, FontImage::CELL_HEIGHT),
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        pixels
+    );
+    m_textureAtlas->release();
+}
+
+void MapResources::initTileTextureProgram() {
+
+    // The same tiles as the tile program, from the same records, but drawn
+    // by a single quad over the whole maze (the unit quad of the glyphs,
+    // stretched), which looks up the record of each fragment's tile in a
+    // texture, and then which part of the detailed mesh the fragment is in
+    m_tileTextureProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Vertex,
+        R"(
+            uniform mat4 transformationMatrix;
+            uniform vec2 mazeSize;
+            uniform float tileLength;
+            uniform float halfWallWidth;
+            attribute vec2 corner;
+            varying vec2 position;
+            void main(void) {
+                // The maze extends by half a wall width on every side
+                position = mix(
+                    vec2(-halfWallWidth),
+                    mazeSize * tileLength + halfWallWidth,
+                    corner
+                );
+                gl_Position = transformationMatrix * vec4(position, 0.0, 1.0);
+            }
+        )"
+    );
+    m_tileTextureProgram.addCacheableShaderFromSourceCode(
+        QOpenGLShader::Fragment,
+        QString("#define NUM_COLORS %1\n").arg(NUM_COLORS) +
+        R"(
+            uniform vec2 mazeSize;
+            uniform float tileLength;
+            uniform float halfWallWidth;
+            uniform vec4 palette[NUM_COLORS];
+            uniform vec4 wallColor;
+            uniform vec4 cornerColor;
+            uniform vec4 wallAlphas;
+            uniform sampler2D tileTexture;
+            varying vec2 position;
+            void main(void) {
+
+                // Fragments past the edge of the maze belong to the tiles
+                // on the edge, and the texel of each tile is its record's
+                // (color, walls, flags, heat), normalized
+                vec2 tile = clamp(
+                    floor(position / tileLength),
+                    vec2(0.0),
+                    mazeSize - 1.0
+                );
+                vec2 local = position - tile * tileLength;
+                vec4 tileState = floor(
+                    texture2D(tileTexture, (tile + 0.5) / mazeSize) * 255.0 +
+                    0.5
+                );
+
+                // The base, as in the tile program
+                vec4 color = palette[int(tileState.x)];
+                if (mod(floor(tileState.z / 2.0), 2.0) > 0.5) {
+                    float heat = tileState.w / 255.0;
+                    color = vec4(clamp(
+                        1.5 - abs(4.0 * heat - vec3(3.0, 2.0, 1.0)),
+                        0.0,
+                        1.0
+                    ), 1.0);
+                }
+
+                // Walls and corners are blended over the base, just like
+                // their quads would be; walls are parts 1 to 4, in the
+                // order of DIRECTIONS (north, east, south, west)
+                vec2 isLow = vec2(lessThan(local, vec2(halfWallWidth)));
+                vec2 isHigh = vec2(
+                    greaterThan(local, vec2(tileLength - halfWallWidth))
+                );
+                vec2 isEdge = max(isLow, isHigh);
+                if (isEdge.x * isEdge.y > 0.5) {
+                    color.rgb = mix(color.rgb, cornerColor.rgb, cornerColor.a);
+                }
+                else if (isEdge.x + isEdge.y > 0.5) {
+                    float part = dot(
+                        vec4(isHigh.y, isHigh.x, isLow.y, isLow.x),
+                        vec4(1.0, 2.0, 3.0, 4.0)
+                    );
+                    vec4 levels = mod(
+                        floor(tileState.y / vec4(1.0, 4.0, 16.0, 64.0)),
+                        4.0
+                    );
+                    float level = dot(
+                        levels,
+                        vec4(equal(vec4(part), vec4(1.0, 2.0, 3.0, 4.0)))
+                    );
+                    float alpha = dot(
+                        wallAlphas,
+                        vec4(equal(vec4(level), vec4(0.0, 1.0, 2.0, 3.0)))
+                    );
+                    color.rgb = mix(color.rgb, wallColor.rgb, alpha);
+                }
+                if (mod(tileState.z, 2.0) > 0.5) {
+                    color.rgb *= 0.5;
+                }
+                gl_FragColor = color;
+            }
+        )"
+    );
+    m_tileTextureProgram.link();
+}
+
+} 
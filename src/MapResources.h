@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+
+namespace mms {
+
+class MapResources {
+
+    // Everything that every map draws with: the programs, the template
+    // meshes of tiles and glyphs, and the texture atlas of the font. There's
+    // one set for each group of contexts that share objects (the application
+    // shares all of its contexts, so in practice, just one), created by the
+    // first map to acquire it and destroyed when the last map releases it.
+    // Vertex array objects can't be shared between contexts, so each map
+    // builds its own from these buffers, along with its own instance buffers
+    // and its own transformation matrix.
+
+public:
+
+    // Both must be called with a context of the share group current
+    static MapResources* acquire();
+    static void release(MapResources* resources);
+
+    QOpenGLShaderProgram* getTileProgram();
+    QOpenGLShaderProgram* getPolygonProgram();
+    QOpenGLShaderProgram* getTextureProgram();
+    QOpenGLShaderProgram* getTileTextureProgram();
+    QOpenGLBuffer* getTileTemplateVBO();
+    QOpenGLBuffer* getTileTemplateIBO();
+    QOpenGLBuffer* getGlyphTemplateVBO();
+    QOpenGLBuffer* getGlyphTemplateIBO();
+
+    // Null if the font image doesn't exist
+    QOpenGLTexture* getTextureAtlas();
+
+    // Uploads the glyphs that were rasterized since the last upload (see
+    // FontImage::glyph) into their cells of the atlas; must be called with a
+    // context of the share group current, before text is drawn
+    void uploadGlyphs();
+
+    // The transformation matrix is a uniform, and so part of the state of a
+    // shared program, which any map may have set last; every matrix that a
+    // map sets is given a version that's unique across all maps, and the
+    // version that was last set on each program is kept here
+    int newTransformationVersion();
+    int& getProgramTransformationVersion(const QOpenGLShaderProgram* program);
+
+private:
+
+    MapResources();
+    ~MapResources();
+
+    static QHash<QOpenGLContextGroup*, MapResources*> INSTANCES;
+
+    QOpenGLContextGroup* m_group;
+    int m_numReferences;
+    int m_transformationVersion;
+    QHash<const QOpenGLShaderProgram*, int> m_programTransformationVersions;
+
+    QOpenGLShaderProgram m_tileProgram;
+    QOpenGLShaderProgram m_polygonProgram;
+    QOpenGLShaderProgram m_textureProgram;
+    QOpenGLShaderProgram m_tileTextureProgram;
+    QOpenGLBuffer m_tileTemplateVBO;
+    QOpenGLBuffer m_tileTemplateIBO;
+    QOpenGLBuffer m_glyphTemplateVBO;
+    QOpenGLBuffer m_glyphTemplateIBO;
+    QOpenGLTexture* m_textureAtlas;
+    int m_numUploadedGlyphs;
+
+    // Every program is cached by Qt, keyed on its sources and on the driver
+    // (the GL vendor, renderer and version), and is compiled from source
+    // whenever it isn't cached, or its binary won't link
+    static QString getDriverIdentity();
+    static bool isProgramBinarySupported();
+
+    void initTileProgram();
+    void initPolygonProgram();
+    void initTextureProgram();
+    void initTileTextureProgram();
+
+    // Writes rows of RGBA pixels, bottom row first, into the atlas, from the
+    // given column of its texels
+    void uploadToAtlas(int x, int width, int height, const void* pixels);
+
+};
+
+} 
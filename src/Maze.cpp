@@ -1,70 +1,336 @@
 #include "Maze.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QByteArray>
+#include <QCryptographicHash>
 #include <QFile>
-#include <QTextStream>
-#include <QQueue>
+#include <QMap>
+#include <QSaveFile>
+#include <QtEndian>
 
 #include "AssertMacros.h"
+#include "DynamicDistances.h"
+#include "FloodFill.h"
+#include "Profiler.h"
 
 namespace mms {
 
-Maze* Maze::fromFile(const QString& path) {
+const qint64 Maze::MAP_THRESHOLD_BYTES = 64 * 1024;
+const QByteArray Maze::BINARY_MAGIC = "MMSB";
+const quint16 Maze::BINARY_VERSION = 1;
+const quint16 Maze::BINARY_HAS_DISTANCES = 1 << 0;
+const int Maze::BINARY_HEADER_SIZE = 20;
+const int Maze::MAX_DIMENSION = 65535;
+const int Maze::MAX_CELLS = 4 * 1024 * 1024;
+
+Maze* Maze::fromFile(const QString& path, MazeError* error) {
+    PROFILE_ZONE("Maze::fromFile");
 
     // Open the file
-    if (path.isEmpty()) {
-        return nullptr;
-    }
     QFile file(path);
-    if (!file.open(QFile::ReadOnly)) {
+    if (
+        path.isEmpty() ||
+        !file.open(QFile::ReadOnly) ||
+        std::numeric_limits<int>::max() < file.size()
+    ) {
+        report(error, {MazeRule::UNREADABLE, 0, -1, -1, Direction::NORTH});
         return nullptr;
     }
 
-    // Read the lines into a vector
-    QString line;
-    QVector<QString> lines;
-    QTextStream stream(&file);
-    while (stream.readLineInto(&line)) {
-        lines.append(line);
+    // Large files are parsed straight from the page cache
+    if (!file.isSequential() && MAP_THRESHOLD_BYTES <= file.size()) {
+        uchar* memory = file.map(0, file.size());
+        if (memory != nullptr) {
+            Maze* maze = fromBytes(
+                reinterpret_cast<const char*>(memory),
+                static_cast<int>(file.size()),
+                error
+            );
+            file.unmap(memory);
+            return maze;
+        }
     }
 
-    // Try map format first, then num
-    Maze* maze = fromMapFile(lines);
-    if (maze != nullptr) {
-        return maze;
+    // Small files (or files that can't be mapped) are read in one go
+    QByteArray bytes = file.readAll();
+    return fromBytes(bytes.constData(), bytes.size(), error);
+}
+
+Maze* Maze::fromData(const QByteArray& data, MazeError* error) {
+    return fromBytes(data.constData(), data.size(), error);
+}
+
+bool Maze::toBinaryFile(const QString& path, bool includeDistances) const {
+
+    // Don't leave a partially written file behind
+    QByteArray bytes = toBinaryData(includeDistances);
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly)) {
+        return false;
     }
-    return fromNumFile(lines);
+    if (file.write(bytes) != bytes.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+QByteArray Maze::toBinaryData(bool includeDistances) const {
+
+    // Header (the checksum is filled in last), walls, distances
+    int width = getWidth();
+    int height = getHeight();
+    int numWallBytes = WallGrid::getNumBytes(width, height);
+    QVector<const QVector<int>*> distances = {
+        &m_distances.center,
+        &m_distances.start,
+        &m_distances.turns,
+    };
+    QByteArray bytes(
+        BINARY_HEADER_SIZE +
+        numWallBytes +
+        (includeDistances ? 4 * distances.size() * width * height : 0),
+        '\0'
+    );
+    uchar* data = reinterpret_cast<uchar*>(bytes.data());
+    std::memcpy(data, BINARY_MAGIC.constData(), BINARY_MAGIC.size());
+    qToLittleEndian<quint16>(BINARY_VERSION, data + 4);
+    qToLittleEndian<quint16>(
+        includeDistances ? BINARY_HAS_DISTANCES : 0, data + 6);
+    qToLittleEndian<quint32>(width, data + 8);
+    qToLittleEndian<quint32>(height, data + 12);
+    std::memcpy(
+        data + BINARY_HEADER_SIZE,
+        m_walls.toBytes().constData(),
+        numWallBytes
+    );
+    if (includeDistances) {
+        uchar* output = data + BINARY_HEADER_SIZE + numWallBytes;
+        for (const QVector<int>* values : distances) {
+            for (int value : *values) {
+                qToLittleEndian<qint32>(value, output);
+                output += 4;
+            }
+        }
+    }
+    qToLittleEndian<quint32>(
+        getChecksum(
+            bytes.constData() + BINARY_HEADER_SIZE,
+            bytes.size() - BINARY_HEADER_SIZE
+        ),
+        data + 16
+    );
+    return bytes;
 }
 
 int Maze::getWidth() const {
-    return m_tiles.size();
+    return m_walls.getWidth();
 }
 
 int Maze::getHeight() const {
-    return m_tiles.at(0).size();
+    return m_walls.getHeight();
 }
 
 const Tile* Maze::getTile(int x, int y) const {
+    return &m_tiles.at(getIndex(x, y));
+}
+
+bool Maze::isWall(int x, int y, Direction direction) const {
+    return m_walls.isWall(x, y, direction);
+}
+
+const WallGrid& Maze::getWalls() const {
+    return m_walls;
+}
+
+quint64 Maze::getHash() const {
+    return getHash(m_walls);
+}
+
+quint64 Maze::getHash(const WallGrid& walls) {
+    // The first eight bytes of the SHA-1 of the size and the walls
+    uchar size[8];
+    qToLittleEndian<quint32>(walls.getWidth(), size);
+    qToLittleEndian<quint32>(walls.getHeight(), size + 4);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(reinterpret_cast<const char*>(size), sizeof(size));
+    hash.addData(walls.toBytes());
+    return qFromBigEndian<quint64>(
+        reinterpret_cast<const uchar*>(hash.result().constData())
+    );
+}
+
+int Maze::getDistance(int x, int y) const {
+    return m_distances.center.at(getIndex(x, y));
+}
+
+int Maze::getStartDistance(int x, int y) const {
+    return m_distances.start.at(getIndex(x, y));
+}
+
+int Maze::getTurnDistance(int x, int y) const {
+    return m_distances.turns.at(getIndex(x, y));
+}
+
+bool Maze::setWall(
+        int x,
+        int y,
+        Direction direction,
+        bool isWall,
+        QVector<QPair<int, int>>* changed) {
+
+    // Only the cell and its neighbor have to be checked, since every other
+    // cell is as valid as it was
+    int nx = x + DIRECTION_DX(direction);
+    int ny = y + DIRECTION_DY(direction);
+    if (
+        x < 0 || getWidth() <= x || y < 0 || getHeight() <= y ||
+        nx < 0 || getWidth() <= nx || ny < 0 || getHeight() <= ny
+    ) {
+        return false;
+    }
+    if (m_walls.isWall(x, y, direction) == isWall) {
+        return true;
+    }
+    m_walls.setWall(x, y, direction, isWall);
+    m_walls.setWall(nx, ny, DIRECTION_OPPOSITE(direction), isWall);
+
+    int first = getIndex(x, y);
+    int second = getIndex(nx, ny);
+    QVector<int> cells;
+    DynamicDistances::update(
+        m_walls, first, second, &m_distances.center, &cells);
+    DynamicDistances::update(
+        m_walls, first, second, &m_distances.start, &cells);
+
+    // A wall can change the best heading of cells anywhere, and the search
+    // over every cell and heading is cheap at the sizes that are edited by
+    // hand, so the turn distances are searched again, and compared
+    QVector<int> turns = getTurnDistances<0, 0>(m_walls, getCenterIndices());
+    for (int cell = 0; cell < turns.size(); cell += 1) {
+        if (turns.at(cell) != m_distances.turns.at(cell)) {
+            cells.append(cell);
+        }
+    }
+    m_distances.turns = turns;
+
+    if (changed != nullptr) {
+        std::sort(cells.begin(), cells.end());
+        cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+        for (int cell : cells) {
+            changed->append({cell / getHeight(), cell % getHeight()});
+        }
+    }
+    return true;
+}
+
+int Maze::getIndex(int x, int y) const {
     ASSERT_LE(0, x);
     ASSERT_LE(0, y);
     ASSERT_LT(x, getWidth());
     ASSERT_LT(y, getHeight());
-    return &m_tiles.at(x).at(y);
+    return getHeight() * x + y;
+}
+
+Maze::Maze(const WallGrid& walls) :
+    Maze(walls, getDistances(walls)) {
 }
 
-Maze::Maze(BasicMaze basicMaze) {
-    QVector<QVector<int>> distances = getDistances(basicMaze);
-    for (int x = 0; x < basicMaze.size(); x += 1) {
-        QVector<Tile> column;
-        for (int y = 0; y < basicMaze.at(x).size(); y += 1) {
-            Tile tile(x, y, distances.at(x).at(y), basicMaze.at(x).at(y));
-            tile.initPolygons(basicMaze.size(), basicMaze.at(x).size());
-            column.append(tile);
+Maze::Maze(const WallGrid& walls, const Distances& distances) :
+    m_walls(walls),
+    m_distances(distances) {
+    int numCells = walls.getWidth() * walls.getHeight();
+    ASSERT_EQ(m_distances.center.size(), numCells);
+    ASSERT_EQ(m_distances.start.size(), numCells);
+    ASSERT_EQ(m_distances.turns.size(), numCells);
+
+    // Whatever built the walls set them one by one, so chunks that are alike
+    // may not be sharing their walls yet
+    m_walls.compact();
+    // One allocation for all of the tiles, in the same order as the arrays
+    m_tiles.reserve(numCells);
+    for (int x = 0; x < getWidth(); x += 1) {
+        for (int y = 0; y < getHeight(); y += 1) {
+            m_tiles.append(Tile(this, x, y));
         }
-        m_tiles.append(column);
     }
 }
 
-Maze* Maze::fromMapFile(QVector<QString> lines) {
+QString Maze::errorToString(const MazeError& error) {
+    static const QMap<Direction, QString> names = {
+        {Direction::NORTH, "north"},
+        {Direction::EAST, "east"},
+        {Direction::SOUTH, "south"},
+        {Direction::WEST, "west"},
+    };
+    QString line = QString("line %1").arg(error.line);
+    QString wall = QString("the %1 wall of (%2, %3)").arg(
+        names.value(error.direction)).arg(error.x).arg(error.y);
+    switch (error.rule) {
+        case MazeRule::UNREADABLE:
+            return "the file can't be read";
+        case MazeRule::UNKNOWN_FORMAT:
+            return "the file isn't in a known maze format";
+        case MazeRule::MALFORMED:
+            return line + " is malformed";
+        case MazeRule::NOT_RECTANGULAR:
+            return QString("column %1 has a different height").arg(error.x);
+        case MazeRule::CORRUPT:
+            return "the binary file is corrupt";
+        case MazeRule::INVALID_SPEC:
+            return "the size isn't supported by the generator";
+        case MazeRule::EMPTY:
+            return "the maze is empty";
+        case MazeRule::TOO_LARGE:
+            return QString("the maze is larger than %1 by %2, or %3 cells")
+                .arg(MAX_DIMENSION)
+                .arg(MAX_DIMENSION)
+                .arg(MAX_CELLS);
+        case MazeRule::NOT_ENCLOSED:
+            return "the maze isn't enclosed at " + wall;
+        case MazeRule::INCONSISTENT:
+            return "the neighbors disagree about " + wall;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+Maze* Maze::fromWalls(const WallGrid& walls, MazeError* error) {
+    if (!isValid(walls, error)) {
+        return nullptr;
+    }
+    return new Maze(walls);
+}
+
+Maze* Maze::fromBytes(const char* data, int size, MazeError* error) {
+    if (
+        BINARY_MAGIC.size() <= size &&
+        std::memcmp(data, BINARY_MAGIC.constData(), BINARY_MAGIC.size()) == 0
+    ) {
+        return fromBinaryFile(data, size, error);
+    }
+
+    // Num files always start with the x coordinate of a cell, and map files
+    // with a corner post, which can be any character (e.g., '+' or 'o'), so
+    // the first visible character decides
+    int first = 0;
+    while (first < size && isSpace(data[first])) {
+        first += 1;
+    }
+    if (first < size && '0' <= data[first] && data[first] <= '9') {
+        return fromNumFile(data, size, error);
+    }
+    if (first < size) {
+        return fromMapFile(data, size, error);
+    }
+    report(error, {MazeRule::UNKNOWN_FORMAT, 0, -1, -1, Direction::NORTH});
+    return nullptr;
+}
+
+Maze* Maze::fromMapFile(const char* data, int size, MazeError* error) {
     // Format:
     //
     //     +---+---+---+
@@ -73,28 +339,32 @@ Maze* Maze::fromMapFile(QVector<QString> lines) {
     //     |   |       |
     //     +---+---+---+
 
-    // Flip the lines to process them from bottom to top
-    for (int i = 0; i < lines.size() / 2; i += 1) {
-        int j = lines.size() - 1 - i;
-        QString one = lines.at(i);
-        QString two = lines.at(j);
-        lines[i] = two;
-        lines[j] = one;
+    // Find the lines, which are numbered from the bottom of the maze
+    QVector<Line> lines = getLines(data, size);
+    auto at = [&](int line, int column) {
+        return data[lines.at(lines.size() - 1 - line).begin + column];
+    };
+
+    // Every row must be followed by its north edge, and must be wide enough
+    // for every cell; line zero (the south edge) decides the width
+    int height = lines.size() / 2;
+    if (lines.size() != 2 * height + 1) {
+        report(error, {
+            MazeRule::MALFORMED, lines.size(), -1, -1, Direction::NORTH});
+        return nullptr;
+    }
+    int width = lines.last().length / 4;
+    for (int i = 0; i < lines.size(); i += 1) {
+        if (lines.at(i).length < 4 * width + 1) {
+            report(error, {
+                MazeRule::MALFORMED, i + 1, -1, -1, Direction::NORTH});
+            return nullptr;
+        }
     }
 
-    BasicMaze basicMaze;
-    for (int y = 0; y < lines.size() / 2; y += 1) {
-	    for (int x = 0; x < lines.at(y).size() / 4; x += 1) {
-
-            // Fill out the maze as necessary
-            while (basicMaze.size() <= x) {
-                QVector<QMap<Direction, bool>> column;
-                basicMaze.append(column);
-            }
-            while (basicMaze.at(x).size() <= y) {
-                QMap<Direction, bool> walls;
-                basicMaze[x].append(walls);
-            }
+    WallGrid walls(width, height);
+    for (int x = 0; x < width; x += 1) {
+        for (int y = 0; y < height; y += 1) {
 
             // Calculate the edges of the cell:
             //
@@ -109,33 +379,23 @@ Maze* Maze::fromMapFile(QVector<QString> lines) {
             int east = 4 * (x + 1);
             int west = 4 * (x + 0);
 
-            // Check bounds
-            if (lines.size() <= north) {
-                return nullptr;
-            }
-            if (lines.at(south + 1).size() <= east) {
-                return nullptr;
-            }
-
             // Add values for the current cell
-            QMap<Direction, bool> walls;
-            walls[Direction::NORTH] = lines.at(north).at(west + 2) != ' ';
-            walls[Direction::EAST]  = lines.at(south + 1).at(east) != ' ';
-            walls[Direction::SOUTH] = lines.at(south).at(west + 2) != ' ';
-            walls[Direction::WEST]  = lines.at(south + 1).at(west) != ' ';
-            basicMaze[x][y] = walls;
+            walls.setWall(x, y, Direction::NORTH, at(north, west + 2) != ' ');
+            walls.setWall(x, y, Direction::EAST, at(south + 1, east) != ' ');
+            walls.setWall(x, y, Direction::SOUTH, at(south, west + 2) != ' ');
+            walls.setWall(x, y, Direction::WEST, at(south + 1, west) != ' ');
         }
     }
 
     // Check if the maze is valid
-    if (!isValid(basicMaze)) {
+    if (!isValid(walls, error)) {
         return nullptr;
     }
 
-    return new Maze(basicMaze);
+    return new Maze(walls);
 }
 
-Maze* Maze::fromNumFile(QVector<QString> lines) {
+Maze* Maze::fromNumFile(const char* data, int size, MazeError* error) {
     // Format:
     //
     //     X Y N E S W
@@ -157,131 +417,342 @@ Maze* Maze::fromNumFile(QVector<QString> lines) {
     //     |   |       |
     //     +---+---+---+
 
-    BasicMaze basicMaze;
-    for (QString line : lines) {
-
-        // Tokenize the line
-        QStringList tokens = line.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 6) {
+    // The size of the maze isn't known until every line has been read, so
+    // the cells are kept as (x, y, walls) triples until then; no line is
+    // shorter than twelve bytes
+    QVector<int> cells;
+    cells.reserve(3 * (size / 12 + 1));
+    QVector<int> columnHeights;
+    QVector<Line> lines = getLines(data, size);
+    for (int lineIndex = 0; lineIndex < lines.size(); lineIndex += 1) {
+
+        // Read exactly six numbers from the line
+        const Line& line = lines.at(lineIndex);
+        MazeError malformed = {
+            MazeRule::MALFORMED, lineIndex + 1, -1, -1, Direction::NORTH};
+        int values[6];
+        int position = line.begin;
+        int end = line.begin + line.length;
+        for (int i = 0; i < 6; i += 1) {
+            while (position < end && isSpace(data[position])) {
+                position += 1;
+            }
+            if (!readNumber(data, end, &position, &values[i])) {
+                report(error, malformed);
+                return nullptr;
+            }
+        }
+        while (position < end && isSpace(data[position])) {
+            position += 1;
+        }
+        if (position != end) {
+            report(error, malformed);
             return nullptr;
         }
 
-        // Extract numeric values
-        bool ok = true;
-        int x = tokens.at(0).toInt(&ok);
-        int y = tokens.at(1).toInt(&ok);
-        bool n = tokens.at(2).toInt(&ok) == 1;
-        bool e = tokens.at(3).toInt(&ok) == 1;
-        bool s = tokens.at(4).toInt(&ok) == 1;
-        bool w = tokens.at(5).toInt(&ok) == 1;
-        if (!ok) {
+        // A cell can't be beyond the largest maze, which is checked before
+        // the columns grow to reach it, so that a single line with a huge
+        // coordinate can't make them take all of memory
+        int x = values[0];
+        int y = values[1];
+        if (x < 0 || y < 0) {
+            report(error, malformed);
+            return nullptr;
+        }
+        if (MAX_DIMENSION <= x || MAX_DIMENSION <= y) {
+            report(error, {
+                MazeRule::TOO_LARGE, lineIndex + 1, -1, -1, Direction::NORTH});
             return nullptr;
         }
 
-        // Fill out the maze as necessary
-        while (basicMaze.size() <= x) {
-            QVector<QMap<Direction, bool>> column;
-            basicMaze.append(column);
+        // Each column is as tall as its highest cell
+        while (columnHeights.size() <= x) {
+            columnHeights.append(0);
         }
-        while (basicMaze.at(x).size() <= y) {
-            QMap<Direction, bool> walls;
-            basicMaze[x].append(walls);
+        columnHeights[x] = qMax(columnHeights.at(x), y + 1);
+        // The walls are packed in the order of DIRECTIONS
+        int bits = 0;
+        for (int i = 0; i < 4; i += 1) {
+            bits |= (values[2 + i] == 1 ? 1 : 0) << i;
+        }
+        cells.append(x);
+        cells.append(y);
+        cells.append(bits);
+    }
+
+    // Every column must have the same number of cells
+    for (int x = 0; x < columnHeights.size(); x += 1) {
+        if (columnHeights.at(x) != columnHeights.at(0)) {
+            report(error, {
+                MazeRule::NOT_RECTANGULAR, 0, x, -1, Direction::NORTH});
+            return nullptr;
         }
+    }
 
-        // Add values for the current cell
-        QMap<Direction, bool> walls;
-        walls[Direction::NORTH] = n;
-        walls[Direction::EAST] = e;
-        walls[Direction::SOUTH] = s;
-        walls[Direction::WEST] = w;
-        basicMaze[x][y] = walls;
+    // Add values for each cell; cells that aren't listed have no walls
+    WallGrid walls(
+        columnHeights.size(),
+        columnHeights.isEmpty() ? 0 : columnHeights.at(0)
+    );
+    for (int i = 0; i < cells.size(); i += 3) {
+        for (int j = 0; j < 4; j += 1) {
+            walls.setWall(
+                cells.at(i),
+                cells.at(i + 1),
+                DIRECTIONS[j],
+                (cells.at(i + 2) >> j) & 1
+            );
+        }
     }
 
     // Check if the maze is valid
-    if (!isValid(basicMaze)) {
+    if (!isValid(walls, error)) {
         return nullptr;
     }
 
-    return new Maze(basicMaze);
+    return new Maze(walls);
 }
 
-bool Maze::isValid(const BasicMaze& basicMaze) {
-    return (
-        isNonempty(basicMaze) &&
-        isRectangular(basicMaze) &&
-        isEnclosed(basicMaze) &&
-        isConsistent(basicMaze)
-    );
-}
+Maze* Maze::fromBinaryFile(const char* data, int size, MazeError* error) {
 
-bool Maze::isNonempty(const BasicMaze& basicMaze) {
-    return 0 < basicMaze.size() && 0 < basicMaze.at(0).size();
-}
+    // Check the header
+    MazeError corrupt = {MazeRule::CORRUPT, 0, -1, -1, Direction::NORTH};
+    if (size < BINARY_HEADER_SIZE) {
+        report(error, corrupt);
+        return nullptr;
+    }
+    const uchar* header = reinterpret_cast<const uchar*>(data);
+    quint16 version = qFromLittleEndian<quint16>(header + 4);
+    quint16 flags = qFromLittleEndian<quint16>(header + 6);
+    quint32 width = qFromLittleEndian<quint32>(header + 8);
+    quint32 height = qFromLittleEndian<quint32>(header + 12);
+    quint32 checksum = qFromLittleEndian<quint32>(header + 16);
+    if (version != BINARY_VERSION) {
+        report(error, corrupt);
+        return nullptr;
+    }
 
-bool Maze::isRectangular(const BasicMaze& basicMaze) {
-    for (int x = 0; x < basicMaze.size() - 1; x += 1) {
-        if (basicMaze.at(x).size() != basicMaze.at(x + 1).size()) {
-            return false;
+    // Check the size (in 64 bits, so that huge dimensions can't overflow)
+    // and the checksum of everything after the header
+    bool hasDistances = flags & BINARY_HAS_DISTANCES;
+    quint64 numCells = static_cast<quint64>(width) * height;
+    quint64 expected =
+        BINARY_HEADER_SIZE +
+        (numCells + 1) / 2 +
+        (hasDistances ? 3 * 4 * numCells : 0);
+    if (
+        numCells == 0 ||
+        static_cast<quint64>(size) != expected ||
+        getChecksum(data + BINARY_HEADER_SIZE, size - BINARY_HEADER_SIZE) !=
+        checksum
+    ) {
+        report(error, corrupt);
+        return nullptr;
+    }
+
+    // Mazes too large to draw are rejected before their walls are read
+    if (!isDrawable(width, height)) {
+        report(error, {MazeRule::TOO_LARGE, 0, -1, -1, Direction::NORTH});
+        return nullptr;
+    }
+
+    // The walls are stored just as they are in memory; a checksum only
+    // shows that they weren't damaged, not that they were ever valid, and
+    // the searches (and the engine) read past the edges of a maze that isn't
+    // enclosed, so they're checked like those of any other file
+    const uchar* body = header + BINARY_HEADER_SIZE;
+    WallGrid walls(width, height, body);
+    if (!isValid(walls, error)) {
+        return nullptr;
+    }
+    if (!hasDistances) {
+        return new Maze(walls);
+    }
+    const uchar* input = body + WallGrid::getNumBytes(width, height);
+    Distances distances;
+    for (QVector<int>* values : {
+        &distances.center,
+        &distances.start,
+        &distances.turns,
+    }) {
+        values->resize(numCells);
+        for (int i = 0; i < values->size(); i += 1) {
+            (*values)[i] = qFromLittleEndian<qint32>(input);
+            input += 4;
         }
     }
-    return true;
+
+    // The move distances are checked rather than searched for, but a cell's
+    // turn distance depends on the costs of its headings, which aren't
+    // stored, so those are searched for
+    QVector<int> centers;
+    for (QPair<int, int> position : getCenterPositions(width, height)) {
+        centers.append(height * position.first + position.second);
+    }
+    if (
+        !areMoveDistancesValid(walls, centers, distances.center) ||
+        !areMoveDistancesValid(walls, {0}, distances.start)
+    ) {
+        report(error, corrupt);
+        return nullptr;
+    }
+    distances.turns = searchTurnDistances(walls);
+    return new Maze(walls, distances);
 }
 
-bool Maze::isEnclosed(const BasicMaze& basicMaze) {
-    int width = basicMaze.size();
-    int height = basicMaze.at(0).size();
-    for (int x = 0; x < width; x += 1) {
-        for (int y = 0; y < height; y += 1) {
-            QMap<Direction, bool> walls = basicMaze.at(x).at(y);
-            if (x == 0 && !walls.value(Direction::WEST)) {
-                return false;
-            }
-            if (y == 0 && !walls.value(Direction::SOUTH)) {
-                return false;
-            }
-            if (x == width - 1 && !walls.value(Direction::EAST)) {
+bool Maze::areMoveDistancesValid(
+        const WallGrid& walls,
+        const QVector<int>& sources,
+        const QVector<int>& distances) {
+    int height = walls.getHeight();
+    int numCells = walls.getWidth() * height;
+    const int offsets[] = {1, height, -1, -height};
+    QVector<bool> isSource(numCells, false);
+    for (int cell : sources) {
+        isSource[cell] = true;
+    }
+
+    // The grid is enclosed, so every open side leads to another cell
+    for (int cell = 0; cell < numCells; cell += 1) {
+        int distance = distances.at(cell);
+        if (isSource.at(cell)) {
+            if (distance != 0) {
                 return false;
             }
-            if (y == height - 1 && !walls.value(Direction::NORTH)) {
-                return false;
+            continue;
+        }
+        int best = -1;
+        int open = ~walls.getWallBits(cell) & 0xf;
+        for (int direction = 0; direction < 4; direction += 1) {
+            if (open & (1 << direction)) {
+                int neighbor = distances.at(cell + offsets[direction]);
+                if (neighbor != -1 && (best == -1 || neighbor < best)) {
+                    best = neighbor;
+                }
             }
         }
+        qint64 expected = best == -1 ? -1 : static_cast<qint64>(best) + 1;
+        if (distance != expected) {
+            return false;
+        }
     }
     return true;
 }
 
-bool Maze::isConsistent(const BasicMaze& basicMaze) {
-    int width = basicMaze.size();
-    int height = basicMaze.at(0).size();
-    for (int x = 0; x < basicMaze.size(); x += 1) {
-        for (int y = 0; y < basicMaze.at(x).size(); y += 1) {
-            QMap<Direction, bool> walls = basicMaze.at(x).at(y);
-            if (
-                0 < x &&
-                walls.value(Direction::WEST) &&
-                !basicMaze.at(x - 1).at(y).value(Direction::EAST)
-            ) {
-                return false;
-            }
-            if (
-                0 < y &&
-                walls.value(Direction::SOUTH) &&
-                !basicMaze.at(x).at(y - 1).value(Direction::NORTH)
-            ) {
-                return false;
+quint32 Maze::getChecksum(const char* data, int size) {
+    // 32-bit FNV-1a
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < size; i += 1) {
+        hash ^= static_cast<uchar>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+QVector<Maze::Line> Maze::getLines(const char* data, int size) {
+    // Like QTextStream::readLine, a trailing newline doesn't start another
+    // line, and carriage returns before a newline are dropped
+    QVector<Line> lines;
+    int begin = 0;
+    while (begin < size) {
+        const void* newline = std::memchr(data + begin, '\n', size - begin);
+        int end = newline == nullptr
+            ? size
+            : static_cast<int>(static_cast<const char*>(newline) - data);
+        int length = end - begin;
+        if (0 < length && data[end - 1] == '\r') {
+            length -= 1;
+        }
+        lines.append({begin, length});
+        begin = end + 1;
+    }
+    return lines;
+}
+
+bool Maze::isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool Maze::readNumber(
+        const char* data,
+        int end,
+        int* position,
+        int* value) {
+    // Non-negative decimal integers only, small enough not to overflow
+    int start = *position;
+    *value = 0;
+    while (
+        *position < end &&
+        '0' <= data[*position] &&
+        data[*position] <= '9'
+    ) {
+        if ((std::numeric_limits<int>::max() - 9) / 10 < *value) {
+            return false;
+        }
+        *value = 10 * *value + (data[*position] - '0');
+        *position += 1;
+    }
+    return start < *position;
+}
+
+void Maze::report(MazeError* error, const MazeError& reason) {
+    if (error != nullptr) {
+        *error = reason;
+    }
+}
+
+bool Maze::isDrawable(qint64 width, qint64 height) {
+    return
+        width <= MAX_DIMENSION &&
+        height <= MAX_DIMENSION &&
+        width * height <= MAX_CELLS;
+}
+
+bool Maze::isValid(const WallGrid& walls, MazeError* error) {
+
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    if (width == 0 || height == 0) {
+        report(error, {MazeRule::EMPTY, 0, -1, -1, Direction::NORTH});
+        return false;
+    }
+    if (!isDrawable(width, height)) {
+        report(error, {MazeRule::TOO_LARGE, 0, -1, -1, Direction::NORTH});
+        return false;
+    }
+
+    // A single pass checks that the edges of the maze are enclosed and that
+    // neighbors agree; checking the east and north walls of every cell covers
+    // every pair of neighboring cells once, in both directions
+    for (int x = 0; x < width; x += 1) {
+        for (int y = 0; y < height; y += 1) {
+            for (Direction direction : DIRECTIONS) {
+                bool isEdge =
+                    (direction == Direction::NORTH && y == height - 1) ||
+                    (direction == Direction::EAST && x == width - 1) ||
+                    (direction == Direction::SOUTH && y == 0) ||
+                    (direction == Direction::WEST && x == 0);
+                if (isEdge && !walls.isWall(x, y, direction)) {
+                    report(error, {MazeRule::NOT_ENCLOSED, 0, x, y, direction});
+                    return false;
+                }
             }
             if (
                 x < width - 1 &&
-                walls.value(Direction::EAST) &&
-                !basicMaze.at(x + 1).at(y).value(Direction::WEST)
+                walls.isWall(x, y, Direction::EAST) !=
+                walls.isWall(x + 1, y, Direction::WEST)
             ) {
+                report(error, {
+                    MazeRule::INCONSISTENT, 0, x, y, Direction::EAST});
                 return false;
             }
             if (
                 y < height - 1 &&
-                walls.value(Direction::NORTH) &&
-                !basicMaze.at(x).at(y + 1).value(Direction::SOUTH)
+                walls.isWall(x, y, Direction::NORTH) !=
+                walls.isWall(x, y + 1, Direction::SOUTH)
             ) {
+                report(error, {
+                    MazeRule::INCONSISTENT, 0, x, y, Direction::NORTH});
                 return false;
             }
         }
@@ -289,51 +760,103 @@ bool Maze::isConsistent(const BasicMaze& basicMaze) {
     return true;
 }
 
-QVector<QVector<int>> Maze::getDistances(BasicMaze basicMaze) {
+Maze::Distances Maze::getDistances(const WallGrid& walls) {
 
-    // Initialize all positions with default value
-    QVector<QVector<int>> distances;
-    for (int x = 0; x < basicMaze.size(); x += 1) {
-        QVector<int> column;
-        for (int y = 0; y < basicMaze.at(x).size(); y += 1) {
-            column.append(-1);
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    if (FloodFill::isFaster(walls)) {
+        QVector<int> centers;
+        for (QPair<int, int> position : getCenterPositions(width, height)) {
+            centers.append(height * position.first + position.second);
         }
-        distances.append(column);
+        Distances distances;
+        distances.center = FloodFill::getMoveDistances(walls, centers);
+        distances.start = FloodFill::getMoveDistances(walls, {0});
+        distances.turns = FloodFill::getTurnDistances(walls, centers);
+        return distances;
     }
 
-    // Set the distances of the center positions to 0 and enqueue them
-    QQueue<QPair<int, int>> discovered;
-    int width = basicMaze.size();
-    int height = basicMaze.at(0).size();
+    // Almost every competition maze is one of these
+    if (width == 16 && height == 16) {
+        return searchDistances<16, 16>(walls);
+    }
+    if (width == 32 && height == 32) {
+        return searchDistances<32, 32>(walls);
+    }
+    return searchDistances<0, 0>(walls);
+}
+
+QVector<int> Maze::searchTurnDistances(const WallGrid& walls) {
+
+    // Searched just as getDistances would
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    QVector<int> centers;
     for (QPair<int, int> position : getCenterPositions(width, height)) {
-        distances[position.first][position.second] = 0;
-        discovered.enqueue(position);
-    }
-
-    // Perform a breadth first search
-    while (!discovered.empty()){
-        QPair<int, int> position = discovered.dequeue();
-        int x = position.first;
-        int y = position.second;
-        for (Direction direction : DIRECTIONS()) {
-            if (!basicMaze.at(x).at(y).value(direction)) {
-                int nx = x;
-                int ny = y;
-                if (direction == Direction::NORTH) {
-                    ny += 1;
-                }
-                if (direction == Direction::EAST) {
-                    nx += 1;
-                }
-                if (direction == Direction::SOUTH) {
-                    ny -= 1;
-                }
-                if (direction == Direction::WEST) {
-                    nx -= 1;
-                }
-                if (distances.at(nx).at(ny) == -1) {
-                    distances[nx][ny] = distances.at(x).at(y) + 1;
-                    discovered.enqueue({nx, ny});
+        centers.append(height * position.first + position.second);
+    }
+    if (FloodFill::isFaster(walls)) {
+        return FloodFill::getTurnDistances(walls, centers);
+    }
+    if (width == 16 && height == 16) {
+        return getTurnDistances<16, 16>(walls, centers);
+    }
+    if (width == 32 && height == 32) {
+        return getTurnDistances<32, 32>(walls, centers);
+    }
+    return getTurnDistances<0, 0>(walls, centers);
+}
+
+template <int WIDTH, int HEIGHT>
+Maze::Distances Maze::searchDistances(const WallGrid& walls) {
+    int height = HEIGHT != 0 ? HEIGHT : walls.getHeight();
+    QVector<int> centers;
+    for (QPair<int, int> position :
+            getCenterPositions(walls.getWidth(), height)) {
+        centers.append(height * position.first + position.second);
+    }
+    Distances distances;
+    distances.center = getMoveDistances<WIDTH, HEIGHT>(walls, centers);
+    distances.start = getMoveDistances<WIDTH, HEIGHT>(walls, {0});
+    distances.turns = getTurnDistances<WIDTH, HEIGHT>(walls, centers);
+    return distances;
+}
+
+template <int WIDTH, int HEIGHT>
+QVector<int> Maze::getMoveDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources) {
+
+    // Cells are indexed by x * height + y, so the neighbor in each direction
+    // (in the order of DIRECTIONS) is a fixed offset away
+    const int height = HEIGHT != 0 ? HEIGHT : walls.getHeight();
+    const int numCells = (WIDTH != 0 ? WIDTH : walls.getWidth()) * height;
+    const int offsets[] = {1, height, -1, -height};
+
+    // Every cell is enqueued at most once, so the queue never wraps
+    QVector<int> distances(numCells, -1);
+    QVector<int> queue(numCells);
+    int head = 0;
+    int tail = 0;
+    for (int cell : sources) {
+        distances[cell] = 0;
+        queue[tail] = cell;
+        tail += 1;
+    }
+
+    // Perform a breadth first search; since the maze is enclosed, every open
+    // side of a cell leads to another cell
+    while (head < tail) {
+        int cell = queue.at(head);
+        head += 1;
+        int open = ~walls.getWallBits(cell) & 0xf;
+        for (int direction = 0; direction < 4; direction += 1) {
+            if (open & (1 << direction)) {
+                int neighbor = cell + offsets[direction];
+                if (distances.at(neighbor) == -1) {
+                    distances[neighbor] = distances.at(cell) + 1;
+                    queue[tail] = neighbor;
+                    tail += 1;
                 }
             }
         }
@@ -341,6 +864,75 @@ QVector<QVector<int>> Maze::getDistances(BasicMaze basicMaze) {
     return distances;
 }
 
+template <int WIDTH, int HEIGHT>
+QVector<int> Maze::getTurnDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources) {
+
+    // The states are (cell, heading) pairs, indexed by 4 * cell + heading;
+    // moving forward and turning by 90 degrees each cost one. The search
+    // runs backwards from the center, so the distance of a state is the cost
+    // of reaching the center from it.
+    const int height = HEIGHT != 0 ? HEIGHT : walls.getHeight();
+    const int numCells = (WIDTH != 0 ? WIDTH : walls.getWidth()) * height;
+    const int offsets[] = {1, height, -1, -height};
+    QVector<int> costs(4 * numCells, -1);
+    QVector<int> queue(4 * numCells);
+    int head = 0;
+    int tail = 0;
+    for (int cell : sources) {
+        for (int heading = 0; heading < 4; heading += 1) {
+            costs[4 * cell + heading] = 0;
+            queue[tail] = 4 * cell + heading;
+            tail += 1;
+        }
+    }
+
+    // A state is reached by turning in place from either neighboring
+    // heading, or by moving forward from the cell behind it, if there's no
+    // wall in between
+    while (head < tail) {
+        int state = queue.at(head);
+        head += 1;
+        int cell = state / 4;
+        int heading = state % 4;
+        auto visit = [&](int previous) {
+            if (costs.at(previous) == -1) {
+                costs[previous] = costs.at(state) + 1;
+                queue[tail] = previous;
+                tail += 1;
+            }
+        };
+        visit(4 * cell + (heading + 1) % 4);
+        visit(4 * cell + (heading + 3) % 4);
+        if (!(walls.getWallBits(cell) & (1 << ((heading + 2) % 4)))) {
+            visit(4 * (cell - offsets[heading]) + heading);
+        }
+    }
+
+    // Each cell is as close as its best heading
+    QVector<int> distances(numCells, -1);
+    for (int cell = 0; cell < numCells; cell += 1) {
+        for (int heading = 0; heading < 4; heading += 1) {
+            int cost = costs.at(4 * cell + heading);
+            int& best = distances[cell];
+            if (cost != -1 && (best == -1 || cost < best)) {
+                best = cost;
+            }
+        }
+    }
+    return distances;
+}
+
+QVector<int> Maze::getCenterIndices() const {
+    QVector<int> centers;
+    for (QPair<int, int> position :
+            getCenterPositions(getWidth(), getHeight())) {
+        centers.append(getIndex(position.first, position.second));
+    }
+    return centers;
+}
+
 QVector<QPair<int, int>> Maze::getCenterPositions(int width, int height) {
 
     // +---+---+
@@ -1,43 +1,181 @@
 #pragma once
 
+#include <QByteArray>
+#include <QPair>
 #include <QString>
 #include <QVector>
 
+#include "Direction.h"
+#include "MazeError.h"
 #include "Tile.h"
+#include "WallGrid.h"
 
 namespace mms {
 
-typedef QVector<QVector<QMap<Direction, bool>>> BasicMaze;
-
 class Maze {
 
 public:
 
-    static Maze* fromFile(const QString& path);
+    // Returns nullptr, and the reason if error isn't nullptr, if the file
+    // isn't a valid maze
+    static Maze* fromFile(const QString& path, MazeError* error = nullptr);
+
+    // Likewise for the contents of a maze file, in any format, e.g. one that
+    // was read on another machine
+    static Maze* fromData(const QByteArray& data, MazeError* error = nullptr);
+    static QString errorToString(const MazeError& error);
+
+    // Validates walls that didn't come from a file, e.g. generated ones
+    static Maze* fromWalls(const WallGrid& walls, MazeError* error = nullptr);
+
+    // The cells of the goal: one, two or four, depending on whether the
+    // width and height are odd or even
+    static QVector<QPair<int, int>> getCenterPositions(int width, int height);
+
+    // Writes the maze in the binary format, optionally with its distances,
+    // so that loading it again skips parsing, validation and the search
+    bool toBinaryFile(const QString& path, bool includeDistances) const;
+    QByteArray toBinaryData(bool includeDistances) const;
 
     int getWidth() const;
     int getHeight() const;
     const Tile* getTile(int x, int y) const;
+    bool isWall(int x, int y, Direction direction) const;
+    const WallGrid& getWalls() const;
+
+    // Identifies the maze by its walls alone, whatever file (or spec) it was
+    // loaded from, so that results on the same maze can be matched up
+    quint64 getHash() const;
+    static quint64 getHash(const WallGrid& walls);
+    int getDistance(int x, int y) const;
+
+    // The number of moves from the starting cell, and the number of moves
+    // plus turns to the center, facing whichever way is best; like the
+    // distance, these are -1 for cells that can't be reached
+    int getStartDistance(int x, int y) const;
+    int getTurnDistance(int x, int y) const;
+
+    // Adds or removes the wall on one side of a cell, and the same wall of
+    // the neighbor on that side, so that the maze stays consistent; walls on
+    // the edges of the maze can't be removed, so that it stays enclosed, and
+    // returns false for those. The move distances are repaired around the
+    // wall (see DynamicDistances), rather than searched again, and the cells
+    // whose distances (of any kind) changed are appended to changed, if it
+    // isn't nullptr. Views of the maze look up its walls when they're built,
+    // so it's only to be edited while nothing else is using it (see
+    // TileGraphic).
+    bool setWall(
+        int x,
+        int y,
+        Direction direction,
+        bool isWall,
+        QVector<QPair<int, int>>* changed = nullptr);
 
 private:
 
-    QVector<QVector<Tile>> m_tiles;
-    explicit Maze(BasicMaze basicMaze);
+    // Each attribute of the cells is kept in its own contiguous array, and
+    // cells are addressed by x * height + y; the tiles are views over those
+    // arrays, which is why the maze can't be copied
+    struct Distances {
+        QVector<int> center;
+        QVector<int> start;
+        QVector<int> turns;
+    };
+    WallGrid m_walls;
+    Distances m_distances;
+    QVector<Tile> m_tiles;
+    int getIndex(int x, int y) const;
+    explicit Maze(const WallGrid& walls);
+    Maze(const WallGrid& walls, const Distances& distances);
+    Q_DISABLE_COPY(Maze)
 
-    // Maze file formats
-    static Maze* fromMapFile(QVector<QString> lines);
-    static Maze* fromNumFile(QVector<QString> lines);
+    // Maze file formats; binary files are recognized by their magic, text
+    // files by their first character that isn't whitespace, and cells are
+    // parsed straight from the bytes of the file into the wall grid. Files of
+    // at least MAP_THRESHOLD_BYTES are memory-mapped rather than read.
+    static const qint64 MAP_THRESHOLD_BYTES;
+    static Maze* fromBytes(const char* data, int size, MazeError* error);
+    static Maze* fromMapFile(const char* data, int size, MazeError* error);
+    static Maze* fromNumFile(const char* data, int size, MazeError* error);
 
-    // Validate the maze
-    static bool isValid(const BasicMaze& basicMaze);
-    static bool isNonempty(const BasicMaze& basicMaze);
-    static bool isRectangular(const BasicMaze& basicMaze);
-    static bool isEnclosed(const BasicMaze& basicMaze);
-    static bool isConsistent(const BasicMaze& basicMaze);
+    // The binary format is a header, the bytes of the wall grid and,
+    // optionally, the distances as little-endian 32-bit integers; the header
+    // is the magic, a version, flags, the width, the height and a checksum
+    // of everything after the header. The checksum only catches damage, so
+    // the walls are validated like those of any other file, and the stored
+    // distances to the center and from the start are checked against them,
+    // in a single pass, rather than searched for again; the turn distances
+    // can't be checked from their per-cell values alone, so they're always
+    // searched for, and the stored ones are ignored.
+    static const QByteArray BINARY_MAGIC;
+    static const quint16 BINARY_VERSION;
+    static const quint16 BINARY_HAS_DISTANCES;
+    static const int BINARY_HEADER_SIZE;
+    static Maze* fromBinaryFile(
+        const char* data,
+        int size,
+        MazeError* error);
+    static quint32 getChecksum(const char* data, int size);
 
-    // Populate distances
-    static QVector<QVector<int>> getDistances(BasicMaze basicMaze);
-    static QVector<QPair<int, int>> getCenterPositions(int width, int height);
+    // Whether the distances are those of a search from the sources: zero at
+    // exactly the sources, and otherwise one more than the least distance of
+    // an open neighbor, or -1 if no neighbor has one. Following the cells
+    // whose distance is one less always ends at a source, so no other
+    // values pass.
+    static bool areMoveDistancesValid(
+        const WallGrid& walls,
+        const QVector<int>& sources,
+        const QVector<int>& distances);
+
+    // Parsing helpers; a line is a span of the file, without its newline
+    struct Line {
+        int begin;
+        int length;
+    };
+    static QVector<Line> getLines(const char* data, int size);
+    static bool isSpace(char c);
+    static bool readNumber(
+        const char* data,
+        int end,
+        int* position,
+        int* value);
+
+    // Every tile and glyph record holds its position in 16 bits, and every
+    // buffer of records (with its text) is sized in an int of bytes, which
+    // bounds the size of a maze that can be drawn; the bounds are checked in
+    // 64 bits, so that huge dimensions can't overflow
+    static const int MAX_DIMENSION;
+    static const int MAX_CELLS;
+    static bool isDrawable(qint64 width, qint64 height);
+
+    // Validate the maze, in a single pass; a grid of walls is rectangular by
+    // construction, so it only has to be nonempty, drawable, enclosed and
+    // consistent
+    static void report(MazeError* error, const MazeError& reason);
+    static bool isValid(const WallGrid& walls, MazeError* error);
+
+    // Populate distances, column by column; each search is breadth first
+    // over flat arrays, with a queue that every cell (or, for turns, every
+    // cell and heading) enters at most once, and neighbors are found from
+    // the open bits of a cell's walls. The searches are templates on the
+    // dimensions, so that the standard sizes (16x16 and 32x32) get a copy in
+    // which the neighbor offsets and array sizes are constants; zero
+    // dimensions are read from the grid, for every other size. Mazes with
+    // enough loops are searched a frontier at a time instead (see
+    // FloodFill), which finds the same distances.
+    static Distances getDistances(const WallGrid& walls);
+    static QVector<int> searchTurnDistances(const WallGrid& walls);
+    template <int WIDTH, int HEIGHT>
+    static Distances searchDistances(const WallGrid& walls);
+    template <int WIDTH, int HEIGHT>
+    static QVector<int> getMoveDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources);
+    template <int WIDTH, int HEIGHT>
+    static QVector<int> getTurnDistances(
+        const WallGrid& walls,
+        const QVector<int>& sources);
+    QVector<int> getCenterIndices() const;
 
 };
 
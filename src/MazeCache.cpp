@@ -0,0 +1,136 @@
+#include "MazeCache.h"
+
+#include <QDebug>
+#include <QFileInfo>
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+#include "MazeLoader.h"
+
+namespace mms {
+
+const qint64 MazeCache::MAX_BYTES = 64 * 1024 * 1024;
+const qint64 MazeCache::TRUTH_BYTES_PER_TILE = 256;
+
+MazeCache::MazeCache() :
+    m_bytes(0) {
+}
+
+MazeCache::~MazeCache() {
+    for (const Entry& entry : m_entries) {
+        delete entry.truth;
+        delete entry.maze;
+    }
+}
+
+QDateTime MazeCache::getLastModified(const QString& path) {
+    // Resources report no modification time, but they never change anyway,
+    // and neither do generated mazes
+    if (MazeGenerator::isSpec(path)) {
+        return QDateTime();
+    }
+    return QFileInfo(path).lastModified();
+}
+
+bool MazeCache::get(const QString& path, Maze** maze, MazeView** truth) {
+    QString key = getKey(path);
+    QDateTime lastModified = getLastModified(path);
+    for (int i = 0; i < m_entries.size(); i += 1) {
+        const Entry& entry = m_entries.at(i);
+        if (entry.path == key && entry.lastModified == lastModified) {
+            m_entries.move(i, 0);
+            *maze = m_entries.first().maze;
+            *truth = m_entries.first().truth;
+            return true;
+        }
+    }
+    return false;
+}
+
+MazeView* MazeCache::getTruth(const Maze* maze) {
+    for (Entry& entry : m_entries) {
+        if (entry.maze != maze) {
+            continue;
+        }
+        if (entry.truth == nullptr) {
+            entry.truth = MazeLoader::createTruth(entry.maze);
+            m_bytes -= entry.bytes;
+            entry.bytes = getBytes(entry.maze, entry.truth);
+            m_bytes += entry.bytes;
+            report(entry);
+        }
+        return entry.truth;
+    }
+    ASSERT_NEVER_RUNS();
+    return nullptr;
+}
+
+void MazeCache::insert(
+        const QString& path,
+        const QDateTime& lastModified,
+        Maze* maze,
+        MazeView* truth) {
+    // Stale entries for the same path are left to age out, since one of
+    // them may be the maze that's currently shown
+    Entry entry;
+    entry.path = getKey(path);
+    entry.lastModified = lastModified;
+    entry.maze = maze;
+    entry.truth = truth;
+    entry.bytes = getBytes(maze, truth);
+    m_entries.prepend(entry);
+    m_bytes += entry.bytes;
+    report(entry);
+}
+
+void MazeCache::trim(const Maze* current) {
+    // Least recently used first
+    for (int i = m_entries.size() - 1; 0 <= i && MAX_BYTES < m_bytes; i -= 1) {
+        if (m_entries.at(i).maze == current) {
+            continue;
+        }
+        Entry entry = m_entries.takeAt(i);
+        m_bytes -= entry.bytes;
+        delete entry.truth;
+        delete entry.maze;
+    }
+}
+
+QString MazeCache::getKey(const QString& path) {
+    // Generated mazes are keyed on their spec
+    if (MazeGenerator::isSpec(path)) {
+        return path;
+    }
+    return QFileInfo(path).absoluteFilePath();
+}
+
+void MazeCache::report(const Entry& entry) const {
+    auto toMiB = [](qint64 bytes) {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    };
+    qInfo().noquote().nospace()
+        << "Maze " << entry.path << " is "
+        << entry.maze->getWidth() << "x" << entry.maze->getHeight()
+        << ", using about " << toMiB(entry.bytes) << " MiB"
+        << (entry.truth == nullptr ? " (without its truth)" : "")
+        << "; the cache holds " << toMiB(m_bytes) << " of "
+        << toMiB(MAX_BYTES) << " MiB";
+}
+
+qint64 MazeCache::getBytes(const Maze* maze, const MazeView* truth) {
+    qint64 numTiles =
+        static_cast<qint64>(maze->getWidth()) * maze->getHeight();
+    qint64 mazeBytes =
+        numTiles * (sizeof(Tile) + sizeof(int)) +
+        maze->getWalls().getMemoryBytes();
+    if (truth == nullptr) {
+        return mazeBytes;
+    }
+    qint64 truthBytes =
+        truth->getTileInstanceCpuBuffer()->capacity() * sizeof(TileInstance) +
+        truth->getGlyphInstanceCpuBuffer()->capacity() * sizeof(GlyphInstance) +
+        numTiles * TRUTH_BYTES_PER_TILE;
+    return mazeBytes + truthBytes;
+}
+
+} 
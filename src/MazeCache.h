@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+#include "Maze.h"
+#include "MazeView.h"
+
+namespace mms {
+
+class MazeCache {
+
+    // Parsed mazes, along with their truth views (the walls declared and the
+    // distances as text), keyed on the path and modification time of the
+    // file they were loaded from, or on the spec they were generated from.
+    // Entries are evicted least recently used first once their estimated
+    // size exceeds MAX_BYTES. The cache is only used from the GUI thread;
+    // the mazes themselves are loaded by the MazeLoader.
+
+public:
+
+    MazeCache();
+    ~MazeCache();
+
+    // The version of the maze at the path, to be captured before loading it
+    static QDateTime getLastModified(const QString& path);
+
+    // Returns whether the maze and truth for the path's current version are
+    // cached; they remain owned by the cache, and the truth is nullptr if it
+    // hasn't been built yet
+    bool get(const QString& path, Maze** maze, MazeView** truth);
+
+    // Returns the truth of a cached maze, building it first if the maze was
+    // inserted without one
+    MazeView* getTruth(const Maze* maze);
+
+    // Takes ownership of a maze and truth (possibly nullptr) that were
+    // loaded from the path when it had the given modification time
+    void insert(
+        const QString& path,
+        const QDateTime& lastModified,
+        Maze* maze,
+        MazeView* truth);
+
+    // Evicts entries until the cache fits within MAX_BYTES, but never the
+    // entry for the maze that's currently in use
+    void trim(const Maze* current);
+
+private:
+
+    struct Entry {
+        QString path;
+        QDateTime lastModified;
+        Maze* maze;
+        MazeView* truth;
+        qint64 bytes;
+    };
+
+    // Most recently used first
+    QList<Entry> m_entries;
+    qint64 m_bytes;
+
+    static const qint64 MAX_BYTES;
+
+    // A rough guess at the heap usage of each tile of a truth view, beyond
+    // its instance records, for the tile graphic and its walls and text
+    static const qint64 TRUTH_BYTES_PER_TILE;
+    static QString getKey(const QString& path);
+    static qint64 getBytes(const Maze* maze, const MazeView* truth);
+
+    // Logs the estimated size of an entry, whenever it changes, along with
+    // that of the whole cache
+    void report(const Entry& entry) const;
+
+    Q_DISABLE_COPY(MazeCache)
+
+};
+
+} 
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Direction.h"
+
+namespace mms {
+
+enum class MazeRule {
+    UNREADABLE, // the file couldn't be read
+    UNKNOWN_FORMAT, // the file isn't in any of the maze file formats
+    MALFORMED, // a line of a text file doesn't follow its format
+    NOT_RECTANGULAR, // the columns of a num file aren't all the same height
+    CORRUPT, // a binary file has the wrong version, size or checksum
+    INVALID_SPEC, // a generated maze's size isn't supported by its algorithm
+    EMPTY, // the maze has no cells
+    TOO_LARGE, // the maze has more columns, rows or cells than can be drawn
+    NOT_ENCLOSED, // a cell on the edge of the maze is missing a wall
+    INCONSISTENT, // two neighboring cells disagree about the wall between them
+};
+
+// Why a maze file was rejected; line is one-based, and is zero unless the
+// rule is about a line, and x, y and direction are only meaningful (and x
+// and y are otherwise -1) if the rule is about a cell
+struct MazeError {
+    MazeRule rule;
+    int line;
+    int x;
+    int y;
+    Direction direction;
+};
+
+} 
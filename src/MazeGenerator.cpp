@@ -0,0 +1,282 @@
+#include "MazeGenerator.h"
+
+#include <QRegularExpression>
+
+#include "AssertMacros.h"
+#include "MazePack.h"
+
+namespace mms {
+
+const int MazeGenerator::MAX_SIZE = 1024;
+
+bool MazeGenerator::isSpec(const QString& text) {
+    static const QRegularExpression pattern(
+        "^([a-z]+):([0-9]{1,9})x([0-9]{1,9}):([0-9]{1,10})$");
+    QRegularExpressionMatch match = pattern.match(text);
+    return (
+        match.hasMatch() &&
+        STRING_TO_MAZE_ALGORITHM().contains(match.captured(1)) &&
+        match.captured(4).toULongLong() <= 0xffffffffull
+    );
+}
+
+QString MazeGenerator::toSpec(
+        MazeAlgorithm algorithm,
+        int width,
+        int height,
+        quint32 seed) {
+    return QString("%1:%2x%3:%4")
+        .arg(STRING_TO_MAZE_ALGORITHM().key(algorithm))
+        .arg(width)
+        .arg(height)
+        .arg(seed);
+}
+
+Maze* MazeGenerator::fromSpec(const QString& spec, MazeError* error) {
+    ASSERT_TR(isSpec(spec));
+    QStringList parts = spec.split(':');
+    QStringList size = parts.at(1).split('x');
+    MazeAlgorithm algorithm = STRING_TO_MAZE_ALGORITHM().value(parts.at(0));
+    int width = size.at(0).toInt();
+    int height = size.at(1).toInt();
+    quint32 seed = parts.at(2).toUInt();
+    if (!isSupported(algorithm, width, height)) {
+        if (error != nullptr) {
+            *error = {MazeRule::INVALID_SPEC, 0, -1, -1, Direction::NORTH};
+        }
+        return nullptr;
+    }
+    return Maze::fromWalls(generate(algorithm, width, height, seed), error);
+}
+
+Maze* MazeGenerator::load(const QString& source, MazeError* error) {
+    if (isSpec(source)) {
+        return fromSpec(source, error);
+    }
+    if (MazePack::isSource(source)) {
+        return MazePack::load(source, error);
+    }
+    return Maze::fromFile(source, error);
+}
+
+bool MazeGenerator::isSupported(
+        MazeAlgorithm algorithm,
+        int width,
+        int height) {
+    int minSize = algorithm == MazeAlgorithm::CLASSIC ? 4 : 1;
+    return (
+        minSize <= width && width <= MAX_SIZE &&
+        minSize <= height && height <= MAX_SIZE
+    );
+}
+
+WallGrid MazeGenerator::generate(
+        MazeAlgorithm algorithm,
+        int width,
+        int height,
+        quint32 seed) {
+    ASSERT_TR(isSupported(algorithm, width, height));
+
+    // Start with every wall in place, and carve passages out of them
+    QVector<unsigned char> full(WallGrid::getNumBytes(width, height), 0xff);
+    WallGrid walls(width, height, full.constData());
+    std::mt19937 rng(seed);
+    switch (algorithm) {
+        case MazeAlgorithm::DFS: {
+            QVector<bool> visited(width * height, false);
+            generateDfs(
+                &walls, &rng, &visited, 0, -1, Direction::NORTH);
+            break;
+        }
+        case MazeAlgorithm::PRIM:
+            generatePrim(&walls, &rng);
+            break;
+        case MazeAlgorithm::CLASSIC:
+            generateClassic(&walls, &rng);
+            break;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+    return walls;
+}
+
+const QMap<QString, MazeAlgorithm>& MazeGenerator::STRING_TO_MAZE_ALGORITHM() {
+    static const QMap<QString, MazeAlgorithm> map = {
+        {"dfs", MazeAlgorithm::DFS},
+        {"prim", MazeAlgorithm::PRIM},
+        {"classic", MazeAlgorithm::CLASSIC},
+    };
+    return map;
+}
+
+int MazeGenerator::random(std::mt19937* rng, int count) {
+    // The slight modulo bias doesn't matter, reproducibility does
+    ASSERT_LT(0, count);
+    return static_cast<int>((*rng)() % static_cast<quint32>(count));
+}
+
+void MazeGenerator::carve(WallGrid* walls, int cell, Direction direction) {
+    int height = walls->getHeight();
+    int x = cell / height;
+    int y = cell % height;
+    walls->setWall(x, y, direction, false);
+    walls->setWall(
+        x + DIRECTION_DX(direction),
+        y + DIRECTION_DY(direction),
+        DIRECTION_OPPOSITE(direction),
+        false);
+}
+
+int MazeGenerator::getNeighbors(
+        const WallGrid& walls,
+        int cell,
+        QPair<int, Direction>* neighbors) {
+    // Writes up to four neighbors, and returns how many there are
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    int x = cell / height;
+    int y = cell % height;
+    int count = 0;
+    if (y < height - 1) {
+        neighbors[count] = {cell + 1, Direction::NORTH};
+        count += 1;
+    }
+    if (x < width - 1) {
+        neighbors[count] = {cell + height, Direction::EAST};
+        count += 1;
+    }
+    if (0 < y) {
+        neighbors[count] = {cell - 1, Direction::SOUTH};
+        count += 1;
+    }
+    if (0 < x) {
+        neighbors[count] = {cell - height, Direction::WEST};
+        count += 1;
+    }
+    return count;
+}
+
+void MazeGenerator::generateDfs(
+        WallGrid* walls,
+        std::mt19937* rng,
+        QVector<bool>* visited,
+        int start,
+        int blockedCell,
+        Direction blockedDirection) {
+
+    // An explicit stack, since mazes may be far too large to recurse
+    QVector<int> stack;
+    stack.append(start);
+    (*visited)[start] = true;
+    QPair<int, Direction> neighbors[4];
+    QPair<int, Direction> candidates[4];
+    while (!stack.isEmpty()) {
+        int cell = stack.last();
+        int numNeighbors = getNeighbors(*walls, cell, neighbors);
+        int numCandidates = 0;
+        for (int i = 0; i < numNeighbors; i += 1) {
+            bool isBlocked =
+                cell == blockedCell &&
+                neighbors[i].second == blockedDirection;
+            if (!visited->at(neighbors[i].first) && !isBlocked) {
+                candidates[numCandidates] = neighbors[i];
+                numCandidates += 1;
+            }
+        }
+        if (numCandidates == 0) {
+            stack.removeLast();
+            continue;
+        }
+        QPair<int, Direction> next = candidates[random(rng, numCandidates)];
+        carve(walls, cell, next.second);
+        (*visited)[next.first] = true;
+        stack.append(next.first);
+    }
+}
+
+void MazeGenerator::generatePrim(WallGrid* walls, std::mt19937* rng) {
+
+    // Grow the maze from a random cell; each step connects a random cell on
+    // the frontier to a random cell that's already part of the maze
+    int numCells = walls->getWidth() * walls->getHeight();
+    QVector<bool> visited(numCells, false);
+    QVector<bool> isFrontier(numCells, false);
+    QVector<int> frontier;
+    QPair<int, Direction> neighbors[4];
+    int start = random(rng, numCells);
+    visited[start] = true;
+    int numNeighbors = getNeighbors(*walls, start, neighbors);
+    for (int i = 0; i < numNeighbors; i += 1) {
+        isFrontier[neighbors[i].first] = true;
+        frontier.append(neighbors[i].first);
+    }
+    while (!frontier.isEmpty()) {
+
+        // Remove a random cell from the frontier, by swapping with the last
+        int index = random(rng, frontier.size());
+        int cell = frontier.at(index);
+        frontier[index] = frontier.last();
+        frontier.removeLast();
+
+        Direction connections[4];
+        int numConnections = 0;
+        numNeighbors = getNeighbors(*walls, cell, neighbors);
+        for (int i = 0; i < numNeighbors; i += 1) {
+            if (visited.at(neighbors[i].first)) {
+                connections[numConnections] = neighbors[i].second;
+                numConnections += 1;
+            }
+            else if (!isFrontier.at(neighbors[i].first)) {
+                isFrontier[neighbors[i].first] = true;
+                frontier.append(neighbors[i].first);
+            }
+        }
+        carve(walls, cell, connections[random(rng, numConnections)]);
+        visited[cell] = true;
+    }
+}
+
+void MazeGenerator::generateClassic(WallGrid* walls, std::mt19937* rng) {
+
+    // The center is a hollow room, with no walls on the middle peg; it's
+    // marked as visited so that the backtracker goes around it
+    int height = walls->getHeight();
+    int numCells = walls->getWidth() * height;
+    QVector<bool> visited(numCells, false);
+    QVector<int> center;
+    for (QPair<int, int> position :
+            Maze::getCenterPositions(walls->getWidth(), height)) {
+        center.append(height * position.first + position.second);
+    }
+    QPair<int, Direction> neighbors[4];
+    for (int cell : center) {
+        visited[cell] = true;
+        int numNeighbors = getNeighbors(*walls, cell, neighbors);
+        for (int i = 0; i < numNeighbors; i += 1) {
+            if (center.contains(neighbors[i].first)) {
+                carve(walls, cell, neighbors[i].second);
+            }
+        }
+    }
+
+    // The starting cell is walled in on three sides, opening to the north;
+    // since the maze is at least 4x4, the ring of cells around the center
+    // keeps every other cell reachable
+    generateDfs(walls, rng, &visited, 0, 0, Direction::EAST);
+
+    // Exactly one entrance into the center
+    QVector<QPair<int, Direction>> entrances;
+    for (int cell : center) {
+        int numNeighbors = getNeighbors(*walls, cell, neighbors);
+        for (int i = 0; i < numNeighbors; i += 1) {
+            if (!center.contains(neighbors[i].first)) {
+                entrances.append({cell, neighbors[i].second});
+            }
+        }
+    }
+    QPair<int, Direction> entrance =
+        entrances.at(random(rng, entrances.size()));
+    carve(walls, entrance.first, entrance.second);
+}
+
+} 
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <random>
+
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "Maze.h"
+#include "MazeError.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+enum class MazeAlgorithm {
+    DFS, // recursive backtracker; long, winding corridors
+    PRIM, // randomized Prim's; many short dead ends
+    CLASSIC, // backtracker around a hollow center with a single entrance
+};
+
+class MazeGenerator {
+
+    // Generates mazes straight into a wall grid. Generation is seeded and
+    // reproducible: the same spec always yields the same maze, on any
+    // platform, since only the raw output of std::mt19937 (whose sequence
+    // is fully specified) is used, and never a standard distribution.
+
+public:
+
+    MazeGenerator() = delete;
+
+    static const int MAX_SIZE;
+
+    // A spec is "<algorithm>:<width>x<height>:<seed>", e.g. "dfs:16x16:42",
+    // with the algorithm one of the keys of STRING_TO_MAZE_ALGORITHM()
+    static bool isSpec(const QString& text);
+    static QString toSpec(
+        MazeAlgorithm algorithm,
+        int width,
+        int height,
+        quint32 seed);
+    static Maze* fromSpec(const QString& spec, MazeError* error = nullptr);
+
+    // Generates the maze for a spec, or loads the maze file at any other
+    // path, so that both can be used wherever a maze is expected
+    static Maze* load(const QString& source, MazeError* error = nullptr);
+
+    // Classic mazes must be at least 4x4, so that the center has a ring of
+    // cells around it; every algorithm supports up to MAX_SIZE in each
+    // dimension
+    static bool isSupported(MazeAlgorithm algorithm, int width, int height);
+    static WallGrid generate(
+        MazeAlgorithm algorithm,
+        int width,
+        int height,
+        quint32 seed);
+
+    static const QMap<QString, MazeAlgorithm>& STRING_TO_MAZE_ALGORITHM();
+
+private:
+
+    // Cells are indexed by x * height + y, as in the wall grid; visited
+    // cells are never carved into again
+    static int random(std::mt19937* rng, int count);
+    static void carve(WallGrid* walls, int cell, Direction direction);
+    static int getNeighbors(
+        const WallGrid& walls,
+        int cell,
+        QPair<int, Direction>* neighbors);
+    static void generateDfs(
+        WallGrid* walls,
+        std::mt19937* rng,
+        QVector<bool>* visited,
+        int start,
+        int blockedCell,
+        Direction blockedDirection);
+    static void generatePrim(WallGrid* walls, std::mt19937* rng);
+    static void generateClassic(WallGrid* walls, std::mt19937* rng);
+
+};
+
+} 
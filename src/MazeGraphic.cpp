@@ -1,21 +1,37 @@
 #include "MazeGraphic.h"
 
+#include <atomic>
+#include <thread>
+
+#include <QThread>
+
 #include "AssertMacros.h"
+#include "Profiler.h"
 
 namespace mms {
 
+const int MazeGraphic::MIN_PARALLEL_TILES = 64 * 1024;
+
 MazeGraphic::MazeGraphic(
         const Maze* maze,
-        BufferInterface* bufferInterface) {
-    for (int x = 0; x < maze->getWidth(); x += 1) {
+        BufferInterface* bufferInterface) :
+    m_bufferInterface(bufferInterface),
+    m_staleTiles(QVector<QPair<int, int>>()) {
+
+    // Each column is built into its own slot, so that they can be built on
+    // any number of threads
+    m_tileGraphics.resize(maze->getWidth());
+    QVector<TileGraphic>* columns = m_tileGraphics.data();
+    forEachColumn(maze->getWidth(), maze->getHeight(), [=](int x) {
         QVector<TileGraphic> column;
+        column.reserve(maze->getHeight());
         for (int y = 0; y < maze->getHeight(); y += 1) {
             column.append(TileGraphic(
                 maze->getTile(x, y),
                 bufferInterface));
         }
-        m_tileGraphics.append(column);
-    }
+        columns[x] = column;
+    });
 }
 
 void MazeGraphic::setWall(int x, int y, Direction direction) {
@@ -26,31 +42,99 @@ void MazeGraphic::clearWall(int x, int y, Direction direction) {
     m_tileGraphics[x][y].clearWall(direction);
 }
 
+void MazeGraphic::setWalls(int x, int y, unsigned char mask) {
+    m_tileGraphics[x][y].setWalls(mask);
+}
+
+void MazeGraphic::refreshTrueWalls(int x, int y) {
+    m_tileGraphics[x][y].refreshTrueWalls();
+}
+
 void MazeGraphic::setColor(int x, int y, Color color) {
-    m_tileGraphics[x][y].setColor(color);
+    if (m_tileGraphics[x][y].setColor(color)) {
+        m_staleTiles.append({x, y});
+    }
 }
 
 void MazeGraphic::clearColor(int x, int y) {
-    m_tileGraphics[x][y].clearColor();
+    if (m_tileGraphics[x][y].clearColor()) {
+        m_staleTiles.append({x, y});
+    }
 }
 
 void MazeGraphic::setText(int x, int y, const QString& text) {
-    m_tileGraphics[x][y].setText(text);
+    if (m_tileGraphics[x][y].setText(text)) {
+        m_staleTiles.append({x, y});
+    }
 }
 
 void MazeGraphic::clearText(int x, int y) {
-    m_tileGraphics[x][y].clearText();
+    if (m_tileGraphics[x][y].clearText()) {
+        m_staleTiles.append({x, y});
+    }
 }
 
-void MazeGraphic::drawPolygons() const {
-    // Fill the GRAPHIC_CPU_BUFFER
-    for (int x = 0; x < m_tileGraphics.size(); x += 1) {
+void MazeGraphic::setFog(int x, int y, bool fog) {
+    m_tileGraphics[x][y].setFog(fog);
+}
+
+void MazeGraphic::setHeat(int x, int y, int heat) {
+    if (m_tileGraphics[x][y].setHeat(heat)) {
+        m_staleTiles.append({x, y});
+    }
+}
+
+void MazeGraphic::clearHeat(int x, int y) {
+    if (m_tileGraphics[x][y].clearHeat()) {
+        m_staleTiles.append({x, y});
+    }
+}
+
+TileState MazeGraphic::getTileState(int x, int y) const {
+    return m_tileGraphics.at(x).at(y).getState();
+}
+
+void MazeGraphic::flush() {
+    PROFILE_ZONE("MazeGraphic::flush");
+    // Tiles that were refreshed in the meantime have nothing left to write
+    for (QPair<int, int> position : m_staleTiles) {
+        m_tileGraphics.at(position.first).at(position.second).flush();
+    }
+    m_staleTiles.clear();
+}
+
+MazeGraphic::State MazeGraphic::getState() const {
+    return m_tileGraphics;
+}
+
+void MazeGraphic::setState(const State& state) {
+    ASSERT_EQ(state.size(), m_tileGraphics.size());
+    for (int x = 0; x < state.size(); x += 1) {
+        if (m_tileGraphics.at(x).isSharedWith(state.at(x))) {
+            continue;
+        }
+        m_tileGraphics[x] = state.at(x);
         for (int y = 0; y < m_tileGraphics.at(x).size(); y += 1) {
-            m_tileGraphics.at(x).at(y).drawPolygons();
+            m_tileGraphics.at(x).at(y).refresh();
         }
     }
 }
 
+void MazeGraphic::drawPolygons() const {
+    // Fill the TILE_INSTANCE_CPU_BUFFER, whose records are all at fixed
+    // offsets, so that each column can be written by any thread, and then
+    // mark all of it dirty at once
+    m_bufferInterface->allocateTileInstanceCpuBuffer();
+    int height = m_tileGraphics.isEmpty() ? 0 : m_tileGraphics.at(0).size();
+    forEachColumn(m_tileGraphics.size(), height, [this](int x) {
+        const QVector<TileGraphic>& column = m_tileGraphics.at(x);
+        for (int y = 0; y < column.size(); y += 1) {
+            column.at(y).drawPolygons();
+        }
+    });
+    m_bufferInterface->markAllTilesDirty();
+}
+
 void MazeGraphic::drawTextures() {
     // Fill the TEXTURE_CPU_BUFFER
     for (int x = 0; x < m_tileGraphics.size(); x += 1) {
@@ -60,4 +144,36 @@ void MazeGraphic::drawTextures() {
     }
 }
 
+void MazeGraphic::forEachColumn(
+        int width,
+        int height,
+        const std::function<void(int)>& function) {
+
+    // Small mazes aren't worth starting threads for; otherwise, each thread
+    // takes the next column until there are none left
+    int numThreads = qMin(QThread::idealThreadCount(), width);
+    if (static_cast<qint64>(width) * height < MIN_PARALLEL_TILES) {
+        numThreads = 1;
+    }
+    std::atomic<int> next(0);
+    auto drawNext = [&]() {
+        while (true) {
+            int x = next.fetch_add(1);
+            if (width <= x) {
+                return;
+            }
+            function(x);
+        }
+    };
+    QVector<std::thread*> threads;
+    for (int i = 1; i < numThreads; i += 1) {
+        threads.append(new std::thread(drawNext));
+    }
+    drawNext();
+    for (std::thread* thread : threads) {
+        thread->join();
+        delete thread;
+    }
+}
+
 } 
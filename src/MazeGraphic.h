@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+
+#include <QPair>
 #include <QVector>
 
 #include "BufferInterface.h"
@@ -19,6 +22,8 @@ public:
 
     void setWall(int x, int y, Direction direction);
     void clearWall(int x, int y, Direction direction);
+    void setWalls(int x, int y, unsigned char mask);
+    void refreshTrueWalls(int x, int y);
 
     void setColor(int x, int y, Color color);
     void clearColor(int x, int y);
@@ -26,14 +31,47 @@ public:
     void setText(int x, int y, const QString& text);
     void clearText(int x, int y);
 
+    void setFog(int x, int y, bool fog);
+
+    void setHeat(int x, int y, int heat);
+    void clearHeat(int x, int y);
+
+    TileState getTileState(int x, int y) const;
+
+    // Colors, text and heat are staged (see TileGraphic), and only written
+    // to the buffers here, once for each tile that changed, with whatever it
+    // was changed to last; to be called before the buffers are read, e.g.,
+    // before publishing a snapshot
+    void flush();
+
     // TODO: upforgrabs
     // Why is only one of these const?
     void drawPolygons() const;
     void drawTextures();
 
+    // The visual state of every tile, by column; columns are implicitly
+    // shared, so getting the state is cheap, and setting it only redraws the
+    // columns that changed since it was gotten
+    typedef QVector<QVector<TileGraphic>> State;
+    State getState() const;
+    void setState(const State& state);
+
 private:
 
-    QVector<QVector<TileGraphic>> m_tileGraphics;
+    State m_tileGraphics;
+    BufferInterface* m_bufferInterface;
+
+    // The tiles with staged changes, each just once
+    QVector<QPair<int, int>> m_staleTiles;
+
+    // Calls the function for every column, from 0 to width - 1, on as many
+    // threads as there are cores, if the maze has at least
+    // MIN_PARALLEL_TILES tiles, or else on this thread
+    static const int MIN_PARALLEL_TILES;
+    static void forEachColumn(
+        int width,
+        int height,
+        const std::function<void(int)>& function);
 
 };
 
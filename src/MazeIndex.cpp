@@ -0,0 +1,443 @@
+#include "MazeIndex.h"
+
+#include <atomic>
+#include <thread>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QThread>
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+#include "MazePack.h"
+#include "MazeSymmetry.h"
+
+namespace mms {
+
+const QString MazeIndex::SIDECAR_NAME = ".mms-index";
+const int MazeIndex::VERSION = 1;
+
+QString MazeIndex::getSidecarPath(const QString& directory) {
+    // A pack's index already has the features of every maze in it
+    if (directory.isEmpty() || MazePack::isPack(directory)) {
+        return "";
+    }
+    return QDir(directory).filePath(SIDECAR_NAME);
+}
+
+QVector<MazeFeatures> MazeIndex::build(
+        const QStringList& sources,
+        const QString& sidecarPath) {
+
+    QMap<QString, QPair<Stamp, MazeFeatures>> entries;
+    if (!sidecarPath.isEmpty()) {
+        readSidecar(sidecarPath, &entries);
+    }
+
+    // Take whatever's still current from the sidecar, and the features of
+    // packed mazes from the index of their pack, which is never stale
+    QVector<MazeFeatures> features(sources.size());
+    QVector<Stamp> stamps(sources.size());
+    QVector<int> missing;
+    for (int i = 0; i < sources.size(); i += 1) {
+        if (MazePack::getFeatures(sources.at(i), &features[i])) {
+            continue;
+        }
+        stamps[i] = getStamp(sources.at(i));
+        auto it = entries.constFind(getKey(sources.at(i)));
+        if (
+            it != entries.constEnd() &&
+            it->first.size == stamps.at(i).size &&
+            it->first.lastModified == stamps.at(i).lastModified
+        ) {
+            features[i] = it->second;
+            features[i].source = sources.at(i);
+        }
+        else {
+            missing.append(i);
+        }
+    }
+    if (missing.isEmpty()) {
+        return features;
+    }
+
+    // Each thread takes the next missing maze until there are none left;
+    // every maze is written by exactly one thread, into its own slot
+    std::atomic<int> next(0);
+    auto compute = [&]() {
+        while (true) {
+            int j = next.fetch_add(1);
+            if (missing.size() <= j) {
+                return;
+            }
+            int i = missing.at(j);
+            Maze* maze = MazeGenerator::load(sources.at(i));
+            features[i] = getFeatures(sources.at(i), maze);
+            delete maze;
+        }
+    };
+    QVector<std::thread*> threads;
+    int numThreads = qMin(QThread::idealThreadCount(), missing.size());
+    for (int i = 1; i < numThreads; i += 1) {
+        threads.append(new std::thread(compute));
+    }
+    compute();
+    for (std::thread* thread : threads) {
+        thread->join();
+        delete thread;
+    }
+    qInfo().noquote().nospace()
+        << "Indexed " << missing.size() << " of " << sources.size()
+        << " mazes";
+
+    if (!sidecarPath.isEmpty()) {
+        for (int i : missing) {
+            entries.insert(
+                getKey(sources.at(i)),
+                {stamps.at(i), features.at(i)}
+            );
+        }
+        if (!writeSidecar(sidecarPath, entries)) {
+            qWarning().noquote().nospace()
+                << "Unable to write the maze index \"" << sidecarPath << "\"";
+        }
+    }
+    return features;
+}
+
+MazeFeatures MazeIndex::getFeatures(const QString& source, const Maze* maze) {
+
+    MazeFeatures features;
+    features.source = source;
+    features.isValid = maze != nullptr;
+    features.width = 0;
+    features.height = 0;
+    features.pathLength = -1;
+    features.deadEnds = 0;
+    features.loops = 0;
+    features.branching = 0.0;
+    features.canonicalHash = 0;
+    if (maze == nullptr) {
+        return features;
+    }
+
+    // Cells are indexed by x * height + y, as in the wall grid, and every
+    // opening is counted by both of the cells it joins
+    const WallGrid& walls = maze->getWalls();
+    int height = walls.getHeight();
+    int numCells = walls.getWidth() * height;
+    const int offsets[] = {1, height, -1, -height};
+    int numOpenings = 0;
+    int numBranchingCells = 0;
+    int totalBranches = 0;
+    int numComponents = 0;
+    QVector<bool> isVisited(numCells, false);
+    QVector<int> queue(numCells);
+    for (int cell = 0; cell < numCells; cell += 1) {
+        int open = ~walls.getWallBits(cell) & 0xf;
+        int numOpen = 0;
+        for (int direction = 0; direction < 4; direction += 1) {
+            if (open & (1 << direction)) {
+                numOpen += 1;
+            }
+        }
+        numOpenings += numOpen;
+        if (numOpen == 1) {
+            features.deadEnds += 1;
+        }
+        else if (1 < numOpen) {
+            numBranchingCells += 1;
+            totalBranches += numOpen - 1;
+        }
+
+        // Every enclosed region counts, not just the one with the start
+        if (isVisited.at(cell)) {
+            continue;
+        }
+        numComponents += 1;
+        isVisited[cell] = true;
+        queue[0] = cell;
+        int head = 0;
+        int tail = 1;
+        while (head < tail) {
+            int current = queue.at(head);
+            head += 1;
+            int currentOpen = ~walls.getWallBits(current) & 0xf;
+            for (int direction = 0; direction < 4; direction += 1) {
+                if (!(currentOpen & (1 << direction))) {
+                    continue;
+                }
+                int neighbor = current + offsets[direction];
+                if (!isVisited.at(neighbor)) {
+                    isVisited[neighbor] = true;
+                    queue[tail] = neighbor;
+                    tail += 1;
+                }
+            }
+        }
+    }
+
+    // A spanning forest has one opening fewer than cells per region, and
+    // each opening beyond those closes a cycle
+    features.width = maze->getWidth();
+    features.height = maze->getHeight();
+    features.pathLength = maze->getDistance(0, 0);
+    features.loops = numOpenings / 2 - numCells + numComponents;
+    if (0 < numBranchingCells) {
+        features.branching =
+            static_cast<double>(totalBranches) / numBranchingCells;
+    }
+    features.canonicalHash = getCanonicalHash(walls);
+    return features;
+}
+
+quint64 MazeIndex::getCanonicalHash(const WallGrid& walls) {
+    return qMin(
+        Maze::getHash(walls),
+        Maze::getHash(MazeSymmetry::apply(walls, Symmetry::TRANSPOSE))
+    );
+}
+
+bool MazeIndex::parseQuery(
+        const QString& text,
+        QVector<Condition>* conditions,
+        QString* error) {
+
+    // The longest operators first, so that "<=" isn't read as "<"
+    static const QVector<QPair<QString, Comparison>> comparisons = {
+        {"<=", Comparison::LESS_OR_EQUAL},
+        {">=", Comparison::GREATER_OR_EQUAL},
+        {"!=", Comparison::NOT_EQUAL},
+        {"=", Comparison::EQUAL},
+        {"<", Comparison::LESS},
+        {">", Comparison::GREATER},
+    };
+
+    conditions->clear();
+    for (const QString& part : text.split(',', QString::SkipEmptyParts)) {
+        QString term = part.trimmed();
+        if (term.isEmpty()) {
+            continue;
+        }
+        int position = -1;
+        QPair<QString, Comparison> comparison;
+        for (const auto& candidate : comparisons) {
+            int index = term.indexOf(candidate.first);
+            if (index != -1 && (position == -1 || index < position)) {
+                position = index;
+                comparison = candidate;
+            }
+        }
+        if (position == -1) {
+            *error = "no comparison in \"" + term + "\"";
+            return false;
+        }
+        QString name = term.left(position).trimmed().toLower();
+        QString value = term.mid(position + comparison.first.size()).trimmed();
+
+        // "size=WxH" is two conditions in one
+        if (name == "size") {
+            QStringList dimensions = value.split('x');
+            bool widthOk = false;
+            bool heightOk = false;
+            double width = 0.0;
+            double height = 0.0;
+            if (dimensions.size() == 2) {
+                width = dimensions.at(0).toDouble(&widthOk);
+                height = dimensions.at(1).toDouble(&heightOk);
+            }
+            if (!widthOk || !heightOk) {
+                *error = "\"" + value + "\" isn't a size, e.g. 16x16";
+                return false;
+            }
+            conditions->append({Feature::WIDTH, comparison.second, width});
+            conditions->append({Feature::HEIGHT, comparison.second, height});
+            continue;
+        }
+        if (!STRING_TO_FEATURE().contains(name)) {
+            *error = "no feature named \"" + name + "\"";
+            return false;
+        }
+        bool valueOk = false;
+        double number = value.toDouble(&valueOk);
+        if (!valueOk) {
+            *error = "\"" + value + "\" isn't a number";
+            return false;
+        }
+        conditions->append(
+            {STRING_TO_FEATURE().value(name), comparison.second, number});
+    }
+    return true;
+}
+
+bool MazeIndex::matches(
+        const MazeFeatures& features,
+        const QVector<Condition>& conditions) {
+    if (!features.isValid) {
+        return false;
+    }
+    for (const Condition& condition : conditions) {
+        double value = getValue(features, condition.feature);
+        bool isMatch = false;
+        switch (condition.comparison) {
+            case Comparison::EQUAL:
+                isMatch = value == condition.value;
+                break;
+            case Comparison::NOT_EQUAL:
+                isMatch = value != condition.value;
+                break;
+            case Comparison::LESS:
+                isMatch = value < condition.value;
+                break;
+            case Comparison::LESS_OR_EQUAL:
+                isMatch = value <= condition.value;
+                break;
+            case Comparison::GREATER:
+                isMatch = value > condition.value;
+                break;
+            case Comparison::GREATER_OR_EQUAL:
+                isMatch = value >= condition.value;
+                break;
+        }
+        if (!isMatch) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const QMap<QString, MazeIndex::Feature>& MazeIndex::STRING_TO_FEATURE() {
+    static const QMap<QString, Feature> map = {
+        {"width", Feature::WIDTH},
+        {"height", Feature::HEIGHT},
+        {"path", Feature::PATH},
+        {"deadends", Feature::DEAD_ENDS},
+        {"loops", Feature::LOOPS},
+        {"branching", Feature::BRANCHING},
+    };
+    return map;
+}
+
+double MazeIndex::getValue(const MazeFeatures& features, Feature feature) {
+    switch (feature) {
+        case Feature::WIDTH:
+            return features.width;
+        case Feature::HEIGHT:
+            return features.height;
+        case Feature::PATH:
+            return features.pathLength;
+        case Feature::DEAD_ENDS:
+            return features.deadEnds;
+        case Feature::LOOPS:
+            return features.loops;
+        case Feature::BRANCHING:
+            return features.branching;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+QString MazeIndex::getKey(const QString& source) {
+    // Files by their name alone, so that the corpus can be moved
+    if (MazeGenerator::isSpec(source)) {
+        return source;
+    }
+    return QFileInfo(source).fileName();
+}
+
+MazeIndex::Stamp MazeIndex::getStamp(const QString& source) {
+    // Generated mazes never change
+    if (MazeGenerator::isSpec(source)) {
+        return {-1, -1};
+    }
+    QFileInfo info(source);
+    return {info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
+
+bool MazeIndex::readSidecar(
+        const QString& path,
+        QMap<QString, QPair<Stamp, MazeFeatures>>* entries) {
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QJsonObject header = QJsonDocument::fromJson(file.readLine()).object();
+    if (header.value("version").toInt() != VERSION) {
+        return false;
+    }
+    while (!file.atEnd()) {
+        QJsonObject object = QJsonDocument::fromJson(file.readLine()).object();
+        if (object.isEmpty()) {
+            continue;
+        }
+        entries->insert(object.value("key").toString(), fromJson(object));
+    }
+    return true;
+}
+
+bool MazeIndex::writeSidecar(
+        const QString& path,
+        const QMap<QString, QPair<Stamp, MazeFeatures>>& entries) {
+
+    // Never leaves a partial sidecar behind
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QJsonObject header;
+    header.insert("version", VERSION);
+    file.write(QJsonDocument(header).toJson(QJsonDocument::Compact) + "\n");
+    for (auto it = entries.constBegin(); it != entries.constEnd(); it += 1) {
+        QJsonObject object = toJson(it->first, it->second);
+        object.insert("key", it.key());
+        file.write(QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n");
+    }
+    return file.commit();
+}
+
+QJsonObject MazeIndex::toJson(
+        const Stamp& stamp,
+        const MazeFeatures& features) {
+    // Hashes are hex, since JSON numbers are doubles
+    QJsonObject object;
+    object.insert("size", stamp.size);
+    object.insert("modified", stamp.lastModified);
+    object.insert("valid", features.isValid);
+    object.insert("width", features.width);
+    object.insert("height", features.height);
+    object.insert("path", features.pathLength);
+    object.insert("deadEnds", features.deadEnds);
+    object.insert("loops", features.loops);
+    object.insert("branching", features.branching);
+    object.insert(
+        "canonicalHash",
+        QString::number(features.canonicalHash, 16)
+    );
+    return object;
+}
+
+QPair<MazeIndex::Stamp, MazeFeatures> MazeIndex::fromJson(
+        const QJsonObject& object) {
+    Stamp stamp;
+    stamp.size = static_cast<qint64>(object.value("size").toDouble());
+    stamp.lastModified =
+        static_cast<qint64>(object.value("modified").toDouble());
+    MazeFeatures features;
+    features.isValid = object.value("valid").toBool();
+    features.width = object.value("width").toInt();
+    features.height = object.value("height").toInt();
+    features.pathLength = object.value("path").toInt();
+    features.deadEnds = object.value("deadEnds").toInt();
+    features.loops = object.value("loops").toInt();
+    features.branching = object.value("branching").toDouble();
+    features.canonicalHash =
+        object.value("canonicalHash").toString().toULongLong(nullptr, 16);
+    return {stamp, features};
+}
+
+} 
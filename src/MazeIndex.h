@@ -0,0 +1,130 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Maze.h"
+
+namespace mms {
+
+// The shape of a maze, for choosing which mazes to run, and for slicing
+// results by them
+struct MazeFeatures {
+    QString source; // the path or spec that the maze was loaded from
+    bool isValid;
+    int width;
+    int height;
+    int pathLength; // moves from the start to the center, or -1
+    int deadEnds; // cells with only the one way out
+    int loops; // independent cycles, i.e., walls that could be added back
+    double branching; // ways on from each cell that isn't a dead end
+    quint64 canonicalHash;
+};
+
+class MazeIndex {
+
+    // The features of every maze in a corpus, computed in parallel the
+    // first time that a maze is seen, and cached in a sidecar file in the
+    // corpus's directory, so that selecting mazes by their features only
+    // reads the sidecar. Entries are keyed on the file's name, size and
+    // modification time, or on a generated maze's spec, and are computed
+    // again whenever those change; the sidecar is rewritten whenever any
+    // entry was. The sidecar has a JSON header line with its version,
+    // followed by one JSON object per maze.
+    //
+    // A query is a comma-separated list of conditions, all of which must
+    // hold, e.g. "size=16x16, loops>0, path>80". Each condition compares a
+    // feature (width, height, path, deadends, loops or branching) with a
+    // number, by =, !=, <, <=, > or >=; "size=WxH" is short for a width and
+    // a height. Invalid mazes match no query. The sidecar is a hidden file,
+    // so it's never mistaken for a maze.
+
+public:
+
+    MazeIndex() = delete;
+
+    static const QString SIDECAR_NAME;
+    static const int VERSION;
+
+    // The sidecar for the mazes in a directory, or empty (for no sidecar)
+    // if there's no directory, or it's a pack (see MazePack)
+    static QString getSidecarPath(const QString& directory);
+
+    // The features of each source, in order, reading whatever's cached and
+    // computing the rest on every core
+    static QVector<MazeFeatures> build(
+        const QStringList& sources,
+        const QString& sidecarPath);
+
+    // The canonical hash is the same for a maze and its reflection about
+    // the diagonal through the start, so that mirrored copies match up
+    static MazeFeatures getFeatures(const QString& source, const Maze* maze);
+
+    // The smaller of the hashes of the walls and of their reflection, which
+    // is the only other symmetry that keeps the start in its corner (and the
+    // goal in the center)
+    static quint64 getCanonicalHash(const WallGrid& walls);
+
+    enum class Feature {
+        WIDTH,
+        HEIGHT,
+        PATH,
+        DEAD_ENDS,
+        LOOPS,
+        BRANCHING,
+    };
+
+    enum class Comparison {
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        LESS_OR_EQUAL,
+        GREATER,
+        GREATER_OR_EQUAL,
+    };
+
+    struct Condition {
+        Feature feature;
+        Comparison comparison;
+        double value;
+    };
+
+    // Returns false, and why, if the query is malformed
+    static bool parseQuery(
+        const QString& text,
+        QVector<Condition>* conditions,
+        QString* error);
+    static bool matches(
+        const MazeFeatures& features,
+        const QVector<Condition>& conditions);
+
+private:
+
+    static const QMap<QString, Feature>& STRING_TO_FEATURE();
+    static double getValue(const MazeFeatures& features, Feature feature);
+
+    // What a cached entry is only valid for
+    struct Stamp {
+        qint64 size;
+        qint64 lastModified; // milliseconds since the epoch
+    };
+    static QString getKey(const QString& source);
+    static Stamp getStamp(const QString& source);
+
+    // Returns false if there's no readable sidecar of the current version
+    static bool readSidecar(
+        const QString& path,
+        QMap<QString, QPair<Stamp, MazeFeatures>>* entries);
+    static bool writeSidecar(
+        const QString& path,
+        const QMap<QString, QPair<Stamp, MazeFeatures>>& entries);
+    static QJsonObject toJson(const Stamp& stamp, const MazeFeatures& features);
+    static QPair<Stamp, MazeFeatures> fromJson(const QJsonObject& object);
+
+};
+
+} 
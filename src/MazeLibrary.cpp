@@ -0,0 +1,109 @@
+#include "MazeLibrary.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+namespace mms {
+
+const int MazeLibrary::SETTLE_MS = 500;
+
+MazeLibrary::MazeLibrary() :
+    m_watcher(new QFileSystemWatcher(this)),
+    m_settleTimer(new QTimer(this)),
+    m_directories(QStringList()),
+    m_changed(QSet<QString>()) {
+    qRegisterMetaType<MazeLibraryEntry>();
+    qRegisterMetaType<QVector<MazeLibraryEntry>>();
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(SETTLE_MS);
+    connect(
+        m_settleTimer,
+        &QTimer::timeout,
+        this,
+        &MazeLibrary::onSettleTimeout
+    );
+    connect(
+        m_watcher,
+        &QFileSystemWatcher::directoryChanged,
+        this,
+        &MazeLibrary::onDirectoryChanged
+    );
+}
+
+void MazeLibrary::setDirectories(const QStringList& directories) {
+    for (const QString& directory : m_directories) {
+        if (!directories.contains(directory)) {
+            m_watcher->removePath(directory);
+            m_changed.remove(directory);
+            emit indexed(directory, QVector<MazeLibraryEntry>());
+        }
+    }
+    QStringList added;
+    for (const QString& directory : directories) {
+        if (!m_directories.contains(directory)) {
+            added.append(directory);
+        }
+    }
+    m_directories = directories;
+    for (const QString& directory : added) {
+        if (!QFileInfo(directory).isDir()) {
+            qWarning().noquote().nospace()
+                << "No maze library directory at \"" << directory << "\"";
+            emit indexed(directory, QVector<MazeLibraryEntry>());
+            continue;
+        }
+        m_watcher->addPath(directory);
+        index(directory);
+    }
+}
+
+QStringList MazeLibrary::getMazeFiles(const QString& directory) {
+    // The sidecar is hidden, so it isn't listed
+    QDir dir(directory);
+    QStringList paths;
+    for (const QString& name : dir.entryList(QDir::Files, QDir::Name)) {
+        paths.append(dir.filePath(name));
+    }
+    return paths;
+}
+
+void MazeLibrary::onDirectoryChanged(const QString& directory) {
+    m_changed.insert(directory);
+    m_settleTimer->start();
+}
+
+void MazeLibrary::onSettleTimeout() {
+
+    // A directory that was removed stops being watched, and is empty until
+    // it's configured again; rewriting a sidecar changes its directory too,
+    // but indexing it again then finds every entry current, and so doesn't
+    // rewrite it again
+    QSet<QString> changed = m_changed;
+    m_changed.clear();
+    for (const QString& directory : changed) {
+        if (!m_directories.contains(directory)) {
+            continue;
+        }
+        if (!QFileInfo(directory).isDir()) {
+            m_watcher->removePath(directory);
+            m_directories.removeAll(directory);
+            emit indexed(directory, QVector<MazeLibraryEntry>());
+            continue;
+        }
+        index(directory);
+    }
+}
+
+void MazeLibrary::index(const QString& directory) {
+    QStringList paths = getMazeFiles(directory);
+    QVector<MazeFeatures> features =
+        MazeIndex::build(paths, MazeIndex::getSidecarPath(directory));
+    QVector<MazeLibraryEntry> entries;
+    for (int i = 0; i < paths.size(); i += 1) {
+        entries.append({features.at(i), QFileInfo(paths.at(i)).size()});
+    }
+    emit indexed(directory, entries);
+}
+
+} 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QMetaType>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "MazeIndex.h"
+
+namespace mms {
+
+// A maze file in a library directory, as of the last time it was indexed
+struct MazeLibraryEntry {
+    MazeFeatures features; // whose source is the file's path
+    qint64 size; // in bytes
+};
+
+class MazeLibrary : public QObject {
+
+    // Keeps an index of the mazes in the library directories: each directory
+    // is indexed once, by the MazeIndex, whose sidecar it shares with the
+    // corpus tools, and then watched, so that it's indexed again whenever
+    // its files change. Files whose size and modification time haven't
+    // changed are read from the sidecar rather than parsed, so reindexing a
+    // directory only costs as much as the files that changed. The index of a
+    // directory is handed over, whole, through the indexed signal, after its
+    // first scan and after every change; indexing a large directory takes a
+    // while, so the library is meant to live on a thread of its own.
+
+    Q_OBJECT
+
+public:
+
+    MazeLibrary();
+
+    // To be invoked on the library's thread, with a queued connection;
+    // directories that are no longer in the list stop being watched, and
+    // are indexed as empty
+    Q_INVOKABLE void setDirectories(const QStringList& directories);
+
+    // The mazes in a directory, in the order that the corpus tools run them
+    static QStringList getMazeFiles(const QString& directory);
+
+signals:
+
+    void indexed(
+        const QString& directory,
+        const QVector<MazeLibraryEntry>& entries);
+
+private:
+
+    // Changes come in bursts (e.g., when files are copied in, or when the
+    // sidecar is rewritten), so a directory is only indexed again once it's
+    // been quiet for a moment
+    static const int SETTLE_MS;
+
+    QFileSystemWatcher* m_watcher;
+    QTimer* m_settleTimer;
+    QStringList m_directories;
+    QSet<QString> m_changed;
+
+    void onDirectoryChanged(const QString& directory);
+    void onSettleTimeout();
+    void index(const QString& directory);
+};
+
+} 
+
+Q_DECLARE_METATYPE(mms::MazeLibraryEntry)
+Q_DECLARE_METATYPE(QVector<mms::MazeLibraryEntry>)
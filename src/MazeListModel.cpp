@@ -0,0 +1,79 @@
+#include "MazeListModel.h"
+
+#include <QMetaObject>
+#include <QPixmap>
+
+namespace mms {
+
+MazeListModel::MazeListModel(MazeThumbnailer* thumbnailer, QObject* parent) :
+    QAbstractListModel(parent),
+    m_thumbnailer(thumbnailer),
+    m_sources(QStringList()),
+    m_rows(QHash<QString, int>()),
+    m_entries(QHash<QString, MazeLibraryEntry>()),
+    m_thumbnails(QHash<QString, QIcon>()) {
+}
+
+void MazeListModel::setSources(
+        const QStringList& sources,
+        const QHash<QString, MazeLibraryEntry>& entries) {
+    beginResetModel();
+    m_sources = sources;
+    m_entries = entries;
+    m_rows.clear();
+    for (int i = 0; i < m_sources.size(); i += 1) {
+        m_rows.insert(m_sources.at(i), i);
+    }
+    endResetModel();
+}
+
+void MazeListModel::setThumbnail(
+        const QString& source,
+        const QImage& thumbnail) {
+    if (thumbnail.isNull()) {
+        return;
+    }
+    m_thumbnails.insert(source, QIcon(QPixmap::fromImage(thumbnail)));
+    auto it = m_rows.constFind(source);
+    if (it != m_rows.constEnd()) {
+        QModelIndex changed = index(it.value());
+        emit dataChanged(changed, changed, {Qt::DecorationRole});
+    }
+}
+
+int MazeListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_sources.size();
+}
+
+QVariant MazeListModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || m_sources.size() <= index.row()) {
+        return QVariant();
+    }
+    const QString& source = m_sources.at(index.row());
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        return source;
+    }
+    if (role == Qt::DecorationRole) {
+        if (!m_thumbnails.contains(source)) {
+            m_thumbnails.insert(source, QIcon());
+            QMetaObject::invokeMethod(
+                m_thumbnailer,
+                "request",
+                Qt::QueuedConnection,
+                Q_ARG(QString, source)
+            );
+        }
+        return m_thumbnails.value(source);
+    }
+    if (role == Qt::ToolTipRole && m_entries.contains(source)) {
+        const MazeLibraryEntry& entry = m_entries[source];
+        return QString("%1x%2, %3 bytes, hash %4")
+            .arg(entry.features.width)
+            .arg(entry.features.height)
+            .arg(entry.size)
+            .arg(entry.features.canonicalHash, 16, 16, QChar('0'));
+    }
+    return QVariant();
+}
+
+} 
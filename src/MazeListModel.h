@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+
+#include "MazeLibrary.h"
+#include "MazeThumbnailer.h"
+
+namespace mms {
+
+class MazeListModel : public QAbstractListModel {
+
+    // The mazes of the maze selector, one row per source. Rows are only
+    // described when a view asks for them, so listing a corpus of any size
+    // only costs a list of strings: a thumbnail is requested the first time
+    // that its row is shown, and kept once it arrives, and a library maze's
+    // tooltip is written from its index entry. With uniform item sizes, a
+    // list view only asks for the rows that it shows.
+
+    Q_OBJECT
+
+public:
+
+    // No ownership of the thumbnailer, which may live on another thread
+    MazeListModel(MazeThumbnailer* thumbnailer, QObject* parent = 0);
+
+    // Replaces every row; thumbnails that already arrived are kept
+    void setSources(
+        const QStringList& sources,
+        const QHash<QString, MazeLibraryEntry>& entries);
+
+    // A null thumbnail means that the maze couldn't be rendered
+    void setThumbnail(const QString& source, const QImage& thumbnail);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+
+private:
+
+    MazeThumbnailer* m_thumbnailer;
+    QStringList m_sources;
+    QHash<QString, int> m_rows;
+    QHash<QString, MazeLibraryEntry> m_entries;
+
+    // A source with no entry hasn't been requested yet, and one with a null
+    // icon hasn't arrived, or couldn't be rendered
+    mutable QHash<QString, QIcon> m_thumbnails;
+};
+
+} 
@@ -0,0 +1,76 @@
+#include "MazeLoader.h"
+
+#include "Direction.h"
+#include "MazeCache.h"
+#include "MazeGenerator.h"
+#include "Tile.h"
+
+namespace mms {
+
+MazeLoader::MazeLoader() {
+    qRegisterMetaType<MazeLoadResult>();
+}
+
+void MazeLoader::load(int requestNumber, const QString& source) {
+    emit loaded(loadNow(requestNumber, source, this));
+}
+
+MazeLoadResult MazeLoader::loadNow(
+        int requestNumber,
+        const QString& source,
+        MazeLoader* progressReporter,
+        bool withTruth) {
+
+    // The version is captured first, so that a file that changes while
+    // it's being read is loaded again next time
+    MazeLoadResult result;
+    result.requestNumber = requestNumber;
+    result.source = source;
+    result.lastModified = MazeCache::getLastModified(source);
+    result.maze = MazeGenerator::load(source, &result.error);
+    result.truth = nullptr;
+    if (result.maze != nullptr && withTruth) {
+        result.truth =
+            createTruth(result.maze, requestNumber, progressReporter);
+    }
+    return result;
+}
+
+MazeView* MazeLoader::createTruth(
+        const Maze* maze,
+        int requestNumber,
+        MazeLoader* progressReporter) {
+
+    // Parsing is done, and building the view and filling it in take about
+    // as long as each other
+    int lastPercent = -1;
+    auto report = [&](int percent) {
+        if (progressReporter != nullptr && percent != lastPercent) {
+            lastPercent = percent;
+            emit progressReporter->progress(requestNumber, percent);
+        }
+    };
+    report(10);
+    MazeView* truth = new MazeView(maze);
+    report(50);
+
+    MazeGraphic* mazeGraphic = truth->getMazeGraphic();
+    for (int x = 0; x < maze->getWidth(); x += 1) {
+        for (int y = 0; y < maze->getHeight(); y += 1) {
+            const Tile* tile = maze->getTile(x, y);
+            for (Direction d : DIRECTIONS) {
+                if (tile->isWall(d)) {
+                    mazeGraphic->setWall(x, y, d);
+                }
+            }
+            int distance = tile->getDistance();
+            QString text = 0 <= distance ? QString::number(distance) : "inf";
+            mazeGraphic->setText(x, y, text);
+        }
+        report(50 + 50 * (x + 1) / maze->getWidth());
+    }
+    truth->publishSnapshot();
+    return truth;
+}
+
+} 
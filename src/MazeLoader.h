@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QDateTime>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+#include "Maze.h"
+#include "MazeError.h"
+#include "MazeView.h"
+
+namespace mms {
+
+// The outcome of loading a maze; if maze is nullptr, error says why, and
+// otherwise the receiver takes ownership of the maze and truth (which is
+// nullptr if it wasn't asked for)
+struct MazeLoadResult {
+    int requestNumber;
+    QString source;
+    QDateTime lastModified;
+    Maze* maze;
+    MazeView* truth;
+    MazeError error;
+};
+
+class MazeLoader : public QObject {
+
+    // Parses (or generates) mazes and builds their truth views, which for
+    // large mazes takes long enough to freeze the GUI, so it's meant to live
+    // on a thread of its own. Nothing that's built is shared until it's
+    // handed over, whole, through the loaded signal.
+
+    Q_OBJECT
+
+public:
+
+    MazeLoader();
+
+    // To be invoked on the loader's thread, with a queued connection
+    Q_INVOKABLE void load(int requestNumber, const QString& source);
+
+    // The same work, on the calling thread, without any signals; the truth
+    // can be left for later if the maze won't be shown right away
+    static MazeLoadResult loadNow(
+        int requestNumber,
+        const QString& source,
+        MazeLoader* progressReporter = nullptr,
+        bool withTruth = true);
+
+    // The truth has walls declared and distance as text
+    static MazeView* createTruth(
+        const Maze* maze,
+        int requestNumber = 0,
+        MazeLoader* progressReporter = nullptr);
+
+signals:
+
+    // Emitted with the percentage of the current load that's done; only
+    // emitted when the percentage changes
+    void progress(int requestNumber, int percent);
+    void loaded(MazeLoadResult result);
+
+};
+
+} 
+
+Q_DECLARE_METATYPE(mms::MazeLoadResult)
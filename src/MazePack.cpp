@@ -0,0 +1,436 @@
+#include "MazePack.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QtEndian>
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+
+namespace mms {
+
+const QString MazePack::SUFFIX = ".mmspack";
+const QByteArray MazePack::MAGIC = "MMSP";
+const quint16 MazePack::VERSION = 1;
+const int MazePack::HEADER_SIZE = 16;
+const int MazePack::ENTRY_SIZE = 64;
+const int MazePack::ALIGNMENT = 8;
+
+QMutex MazePack::CACHE_MUTEX;
+QHash<QString, std::shared_ptr<const MazePack>> MazePack::CACHE;
+
+bool MazePack::isPack(const QString& path) {
+    return path.endsWith(SUFFIX) && QFileInfo(path).isFile();
+}
+
+bool MazePack::isSource(const QString& source) {
+    return source.contains(SUFFIX + "#");
+}
+
+std::shared_ptr<const MazePack> MazePack::open(
+        const QString& path,
+        QString* error) {
+    QString key = QFileInfo(path).absoluteFilePath();
+    {
+        QMutexLocker locker(&CACHE_MUTEX);
+        auto it = CACHE.constFind(key);
+        if (it != CACHE.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // Reading happens outside of the lock; if another thread opened the same
+    // pack in the meantime, its copy is kept, so that it's only mapped once
+    std::shared_ptr<MazePack> pack(new MazePack(path));
+    if (!pack->read(error)) {
+        return nullptr;
+    }
+    QMutexLocker locker(&CACHE_MUTEX);
+    auto it = CACHE.constFind(key);
+    if (it != CACHE.constEnd()) {
+        return it.value();
+    }
+    CACHE.insert(key, pack);
+    return pack;
+}
+
+Maze* MazePack::load(const QString& source, MazeError* error) {
+    MazeError unreadable = {MazeRule::UNREADABLE, 0, -1, -1, Direction::NORTH};
+    QString path;
+    QString name;
+    QString reason;
+    std::shared_ptr<const MazePack> pack;
+    int index = -1;
+    if (splitSource(source, &path, &name)) {
+        pack = open(path, &reason);
+    }
+    if (pack != nullptr) {
+        index = pack->find(name);
+    }
+    if (index == -1) {
+        if (error != nullptr) {
+            *error = unreadable;
+        }
+        return nullptr;
+    }
+    return pack->getMaze(index, error);
+}
+
+bool MazePack::getFeatures(const QString& source, MazeFeatures* features) {
+    QString path;
+    QString name;
+    QString error;
+    if (!splitSource(source, &path, &name)) {
+        return false;
+    }
+    std::shared_ptr<const MazePack> pack = open(path, &error);
+    int index = pack == nullptr ? -1 : pack->find(name);
+    if (index == -1) {
+        return false;
+    }
+    *features = pack->getEntry(index).features;
+    features->source = source;
+    return true;
+}
+
+bool MazePack::write(
+        const QString& path,
+        const QStringList& sources,
+        bool includeDistances,
+        QString* error) {
+
+    if (!path.endsWith(SUFFIX)) {
+        *error = "the path of a pack has to end in \"" + SUFFIX + "\"";
+        return false;
+    }
+
+    // Each thread takes the next source until there are none left; every
+    // maze is written by exactly one thread, into its own slot, and mazes
+    // that are invalid leave their slot empty
+    QVector<MazePackEntry> entries(sources.size());
+    QVector<QByteArray> bodies(sources.size());
+    QVector<MazeError> errors(sources.size());
+    std::atomic<int> next(0);
+    auto compute = [&]() {
+        while (true) {
+            int i = next.fetch_add(1);
+            if (sources.size() <= i) {
+                return;
+            }
+            Maze* maze = MazeGenerator::load(sources.at(i), &errors[i]);
+            if (maze == nullptr) {
+                continue;
+            }
+            entries[i].name = getName(sources.at(i));
+            entries[i].hash = maze->getHash();
+            entries[i].features = MazeIndex::getFeatures(sources.at(i), maze);
+            bodies[i] = maze->toBinaryData(includeDistances);
+            delete maze;
+        }
+    };
+    QVector<std::thread*> threads;
+    int numThreads = qMin(QThread::idealThreadCount(), sources.size());
+    for (int i = 1; i < numThreads; i += 1) {
+        threads.append(new std::thread(compute));
+    }
+    compute();
+    for (std::thread* thread : threads) {
+        thread->join();
+        delete thread;
+    }
+
+    // The names are what sources in the pack are looked up by, so they have
+    // to be unique
+    QVector<int> packed;
+    QSet<QString> names;
+    QByteArray nameBytes;
+    QVector<QPair<int, int>> nameRanges(sources.size());
+    for (int i = 0; i < sources.size(); i += 1) {
+        if (bodies.at(i).isEmpty()) {
+            qWarning().noquote().nospace()
+                << "Invalid maze file \"" << sources.at(i) << "\": "
+                << Maze::errorToString(errors.at(i));
+            continue;
+        }
+        if (names.contains(entries.at(i).name)) {
+            *error = "more than one maze is named \"" + entries.at(i).name
+                + "\"";
+            return false;
+        }
+        names.insert(entries.at(i).name);
+        QByteArray name = entries.at(i).name.toUtf8();
+        nameRanges[i] = {nameBytes.size(), name.size()};
+        nameBytes += name;
+        packed.append(i);
+    }
+
+    // Every maze starts at a multiple of the alignment, after the names
+    auto align = [](quint64 offset) {
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    };
+    quint64 offset = align(
+        HEADER_SIZE +
+        static_cast<quint64>(packed.size()) * ENTRY_SIZE +
+        nameBytes.size()
+    );
+    QByteArray index(HEADER_SIZE + packed.size() * ENTRY_SIZE, '\0');
+    uchar* data = reinterpret_cast<uchar*>(index.data());
+    std::memcpy(data, MAGIC.constData(), MAGIC.size());
+    qToLittleEndian<quint16>(VERSION, data + 4);
+    qToLittleEndian<quint32>(packed.size(), data + 8);
+    qToLittleEndian<quint32>(nameBytes.size(), data + 12);
+    for (int j = 0; j < packed.size(); j += 1) {
+        int i = packed.at(j);
+        MazePackEntry& entry = entries[i];
+        entry.offset = offset;
+        entry.size = bodies.at(i).size();
+        offset = align(offset + entry.size);
+        const MazeFeatures& features = entry.features;
+        quint64 branching = 0;
+        std::memcpy(&branching, &features.branching, sizeof(branching));
+        uchar* output = data + HEADER_SIZE + j * ENTRY_SIZE;
+        qToLittleEndian<quint64>(entry.offset, output);
+        qToLittleEndian<quint32>(entry.size, output + 8);
+        qToLittleEndian<quint32>(features.width, output + 12);
+        qToLittleEndian<quint32>(features.height, output + 16);
+        qToLittleEndian<quint32>(nameRanges.at(i).first, output + 20);
+        qToLittleEndian<quint32>(nameRanges.at(i).second, output + 24);
+        qToLittleEndian<qint32>(features.pathLength, output + 28);
+        qToLittleEndian<qint32>(features.deadEnds, output + 32);
+        qToLittleEndian<qint32>(features.loops, output + 36);
+        qToLittleEndian<quint64>(branching, output + 40);
+        qToLittleEndian<quint64>(entry.hash, output + 48);
+        qToLittleEndian<quint64>(features.canonicalHash, output + 56);
+    }
+
+    // Don't leave a partially written pack behind
+    QSaveFile file(path);
+    if (!file.open(QFile::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    bool ok = file.write(index) == index.size();
+    ok = ok && file.write(nameBytes) == nameBytes.size();
+    for (int i : packed) {
+        QByteArray padding(
+            static_cast<int>(entries.at(i).offset - file.pos()),
+            '\0'
+        );
+        ok = ok && file.write(padding) == padding.size();
+        ok = ok && file.write(bodies.at(i)) == bodies.at(i).size();
+    }
+    if (!ok) {
+        *error = file.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    qInfo().noquote().nospace()
+        << "Packed " << packed.size() << " of " << sources.size()
+        << " mazes";
+    return true;
+}
+
+int MazePack::getSize() const {
+    return m_entries.size();
+}
+
+const MazePackEntry& MazePack::getEntry(int index) const {
+    return m_entries.at(index);
+}
+
+int MazePack::find(const QString& name) const {
+    return m_names.value(name, -1);
+}
+
+QStringList MazePack::getSources() const {
+    QStringList sources;
+    for (const MazePackEntry& entry : m_entries) {
+        sources.append(entry.features.source);
+    }
+    return sources;
+}
+
+Maze* MazePack::getMaze(int index, MazeError* error) const {
+    // Parsed straight from the mapping, which was checked to hold the maze
+    const MazePackEntry& entry = m_entries.at(index);
+    return Maze::fromData(
+        QByteArray::fromRawData(
+            m_data + entry.offset,
+            static_cast<int>(entry.size)
+        ),
+        error
+    );
+}
+
+bool MazePack::unpack(const QString& directory, QString* error) const {
+
+    if (!QDir().mkpath(directory)) {
+        *error = "unable to create \"" + directory + "\"";
+        return false;
+    }
+
+    // The files are written after checking that no two of them collide
+    QDir dir(directory);
+    QStringList paths;
+    QSet<QString> names;
+    for (const MazePackEntry& entry : m_entries) {
+        QString name = QFileInfo(entry.name).completeBaseName() + ".maze";
+        if (names.contains(name)) {
+            *error = "more than one maze would be written to \"" + name
+                + "\"";
+            return false;
+        }
+        names.insert(name);
+        paths.append(dir.filePath(name));
+    }
+    for (int i = 0; i < m_entries.size(); i += 1) {
+        const MazePackEntry& entry = m_entries.at(i);
+        QSaveFile file(paths.at(i));
+        if (
+            !file.open(QFile::WriteOnly) ||
+            file.write(m_data + entry.offset, entry.size) !=
+                static_cast<qint64>(entry.size) ||
+            !file.commit()
+        ) {
+            *error = "couldn't write \"" + paths.at(i) + "\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+MazePack::MazePack(const QString& path) :
+    m_path(path),
+    m_file(path),
+    m_data(nullptr),
+    m_size(0) {
+}
+
+bool MazePack::read(QString* error) {
+
+    if (!m_file.open(QFile::ReadOnly)) {
+        *error = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.size();
+    if (m_size < HEADER_SIZE) {
+        *error = "not a maze pack";
+        return false;
+    }
+
+    // The mapping lasts as long as the file is open, i.e., as long as the
+    // pack, and is only ever read
+    uchar* memory = m_file.map(0, m_size);
+    if (memory == nullptr) {
+        *error = m_file.errorString();
+        return false;
+    }
+    m_data = reinterpret_cast<const char*>(memory);
+    const uchar* header = memory;
+    if (
+        std::memcmp(header, MAGIC.constData(), MAGIC.size()) != 0 ||
+        qFromLittleEndian<quint16>(header + 4) != VERSION
+    ) {
+        *error = "not a maze pack, or of another version";
+        return false;
+    }
+
+    // Everything is checked against the size of the file, in 64 bits, so
+    // that a corrupt pack can't read past the end of the mapping
+    quint64 count = qFromLittleEndian<quint32>(header + 8);
+    quint64 namesSize = qFromLittleEndian<quint32>(header + 12);
+    quint64 namesOffset = HEADER_SIZE + count * ENTRY_SIZE;
+    quint64 size = static_cast<quint64>(m_size);
+    if (size < namesOffset + namesSize) {
+        *error = "the index is corrupt";
+        return false;
+    }
+    for (quint64 i = 0; i < count; i += 1) {
+        const uchar* input = header + HEADER_SIZE + i * ENTRY_SIZE;
+        MazePackEntry entry;
+        entry.offset = qFromLittleEndian<quint64>(input);
+        entry.size = qFromLittleEndian<quint32>(input + 8);
+        quint64 nameOffset = qFromLittleEndian<quint32>(input + 20);
+        quint64 nameSize = qFromLittleEndian<quint32>(input + 24);
+        if (
+            entry.offset < namesOffset + namesSize ||
+            size < entry.size ||
+            size - entry.size < entry.offset ||
+            namesSize < nameSize ||
+            namesSize - nameSize < nameOffset
+        ) {
+            *error = "the index is corrupt";
+            return false;
+        }
+        entry.name = QString::fromUtf8(
+            m_data + namesOffset + nameOffset,
+            static_cast<int>(nameSize)
+        );
+        if (m_names.contains(entry.name)) {
+            *error = "more than one maze is named \"" + entry.name + "\"";
+            return false;
+        }
+        quint64 branching = qFromLittleEndian<quint64>(input + 40);
+        MazeFeatures& features = entry.features;
+        features.source = getSource(m_path, entry.name);
+        features.isValid = true;
+        features.width = qFromLittleEndian<quint32>(input + 12);
+        features.height = qFromLittleEndian<quint32>(input + 16);
+        features.pathLength = qFromLittleEndian<qint32>(input + 28);
+        features.deadEnds = qFromLittleEndian<qint32>(input + 32);
+        features.loops = qFromLittleEndian<qint32>(input + 36);
+        std::memcpy(&features.branching, &branching, sizeof(branching));
+        entry.hash = qFromLittleEndian<quint64>(input + 48);
+        features.canonicalHash = qFromLittleEndian<quint64>(input + 56);
+        m_names.insert(entry.name, m_entries.size());
+        m_entries.append(entry);
+    }
+    return true;
+}
+
+bool MazePack::splitSource(
+        const QString& source,
+        QString* path,
+        QString* name) {
+    int index = source.indexOf(SUFFIX + "#");
+    if (index == -1) {
+        return false;
+    }
+    *path = source.left(index + SUFFIX.size());
+    *name = source.mid(index + SUFFIX.size() + 1);
+    return true;
+}
+
+QString MazePack::getSource(const QString& path, const QString& name) {
+    return path + "#" + name;
+}
+
+QString MazePack::getName(const QString& source) {
+    // Repacking keeps the names of the packed mazes, and generated mazes
+    // are named by their specs
+    QString path;
+    QString name;
+    if (splitSource(source, &path, &name)) {
+        return name;
+    }
+    if (MazeGenerator::isSpec(source)) {
+        return source;
+    }
+    return QFileInfo(source).fileName();
+}
+
+} 
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <memory>
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Maze.h"
+#include "MazeIndex.h"
+
+namespace mms {
+
+// A maze in a pack, as the pack's index describes it
+struct MazePackEntry {
+    QString name; // the file name of the maze that was packed
+    quint64 offset; // of its binary maze file, from the start of the pack
+    quint32 size; // of its binary maze file, in bytes
+    quint64 hash; // see Maze::getHash
+    MazeFeatures features; // whose source is the entry's, see getSource
+};
+
+class MazePack {
+
+    // A corpus of mazes in a single file, so that it can be copied, scanned,
+    // and opened as one. A pack is a header, an index with an entry of fixed
+    // size for every maze (where it is, its dimensions, its hash and its
+    // features, as MazeIndex finds them), the names of the mazes, and then
+    // the mazes themselves, each a complete binary maze file (see
+    // Maze::toBinaryFile), aligned to eight bytes. Everything is little
+    // endian. A pack is memory-mapped when it's opened, and stays mapped
+    // for as long as anything uses it, so reading a maze touches nothing
+    // but its own pages; packs are opened once, and shared, by every
+    // thread of the process. Only valid mazes are packed.
+    //
+    // A maze in a pack is named as a source by the path of the pack, a '#'
+    // and the name of the maze, e.g. "corpus.mmspack#apec2011.num", and
+    // loads wherever any other source does (see MazeGenerator::load); the
+    // path of a pack has to end in its suffix.
+
+public:
+
+    static const QString SUFFIX;
+
+    // Whether the path is that of a pack, or the source is a maze in one
+    static bool isPack(const QString& path);
+    static bool isSource(const QString& source);
+
+    // The pack at the path, which is only ever opened and checked once;
+    // returns nullptr, with the reason, if it can't be
+    static std::shared_ptr<const MazePack> open(
+        const QString& path,
+        QString* error);
+
+    // The maze that the source names, if it can be loaded, as for a file
+    static Maze* load(const QString& source, MazeError* error = nullptr);
+
+    // Packs every valid maze of the sources (files or generated specs) into
+    // the path, in order, loading them on every core; the invalid ones are
+    // reported, and left out. Returns false, with the reason, if the pack
+    // can't be written at all, or two mazes share a name.
+    static bool write(
+        const QString& path,
+        const QStringList& sources,
+        bool includeDistances,
+        QString* error);
+
+    int getSize() const;
+    const MazePackEntry& getEntry(int index) const;
+
+    // The index of the entry with the name, or -1
+    int find(const QString& name) const;
+
+    // The features of the maze that the source names, from the index of its
+    // pack, without loading it; returns false if it can't be found
+    static bool getFeatures(const QString& source, MazeFeatures* features);
+
+    // The source of every entry, in order
+    QStringList getSources() const;
+
+    Maze* getMaze(int index, MazeError* error = nullptr) const;
+
+    // Writes every maze to the directory as a binary maze file, named after
+    // its entry, with its suffix replaced by ".maze"
+    bool unpack(const QString& directory, QString* error) const;
+
+private:
+
+    static const QByteArray MAGIC;
+    static const quint16 VERSION;
+    static const int HEADER_SIZE;
+    static const int ENTRY_SIZE;
+    static const int ALIGNMENT;
+
+    // Every pack that has been opened, by its absolute path
+    static QMutex CACHE_MUTEX;
+    static QHash<QString, std::shared_ptr<const MazePack>> CACHE;
+
+    MazePack(const QString& path);
+
+    QString m_path;
+    QFile m_file;
+    const char* m_data;
+    qint64 m_size;
+    QVector<MazePackEntry> m_entries;
+    QHash<QString, int> m_names;
+
+    // Maps the file, and reads and checks the header and every entry
+    bool read(QString* error);
+
+    // Splits a source into the path of its pack and the name of its maze,
+    // or returns false if it isn't in a pack
+    static bool splitSource(
+        const QString& source,
+        QString* path,
+        QString* name);
+    static QString getSource(const QString& path, const QString& name);
+
+    // The name of the entry of a source that's packed
+    static QString getName(const QString& source);
+
+};
+
+} 
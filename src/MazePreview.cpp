@@ -0,0 +1,215 @@
+#include "MazePreview.h"
+
+#include <atomic>
+#include <thread>
+
+#include <QColor>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFont>
+#include <QPainter>
+#include <QPair>
+#include <QPen>
+#include <QPointF>
+#include <QRectF>
+#include <QThread>
+#include <QTransform>
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "CommandTrace.h"
+#include "Dimensions.h"
+#include "MazeError.h"
+#include "MazeGenerator.h"
+#include "MazeView.h"
+#include "Mouse.h"
+#include "SoftwareMapRenderer.h"
+#include "TraceReplay.h"
+
+namespace mms {
+
+const int MazePreview::MIN_TEXT_PIXELS = 16;
+
+bool MazePreview::run(
+        const QStringList& mazePaths,
+        const QStringList& outputPaths,
+        const QString& tracePath,
+        int run,
+        int width,
+        int height) {
+
+    ASSERT_EQ(mazePaths.size(), outputPaths.size());
+    ASSERT_LE(0, run);
+    ASSERT_LT(0, width);
+    ASSERT_LT(0, height);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The commands are read up front, since the trace file decodes them on
+    // demand, and isn't meant to be read from several threads at once
+    QVector<Command> commands;
+    if (!tracePath.isEmpty()) {
+        QVector<TraceRun> runs;
+        if (!CommandTrace::read(tracePath, &runs)) {
+            qWarning() << "Unable to read command trace file:" << tracePath;
+            return false;
+        }
+        if (runs.size() < run || runs.isEmpty()) {
+            qWarning()
+                << "No run" << run
+                << "in command trace file:" << tracePath;
+            return false;
+        }
+        const TraceRun& traced = runs.at(run == 0 ? runs.size() - 1 : run - 1);
+        commands.reserve(traced.numCommands);
+        for (int i = 0; i < traced.numCommands; i += 1) {
+            commands.append(traced.file->getCommand(traced.firstCommand + i));
+        }
+    }
+
+    // Each thread takes the next maze until there are none left, and only
+    // ever touches its own maze, view and image; warnings are logged as
+    // they happen, and the failures are counted
+    std::atomic<int> next(0);
+    std::atomic<int> failures(0);
+    auto renderNext = [&]() {
+        while (true) {
+            int i = next.fetch_add(1);
+            if (mazePaths.size() <= i) {
+                return;
+            }
+            MazeError error;
+            Maze* maze = MazeGenerator::load(mazePaths.at(i), &error);
+            if (maze == nullptr) {
+                qWarning().noquote().nospace()
+                    << "Unable to load the maze \"" << mazePaths.at(i)
+                    << "\": " << Maze::errorToString(error);
+                failures += 1;
+                continue;
+            }
+            QImage image = render(maze, commands, width, height);
+            delete maze;
+            if (!image.save(outputPaths.at(i))) {
+                qWarning().noquote().nospace()
+                    << "Unable to write the preview \"" << outputPaths.at(i)
+                    << "\"";
+                failures += 1;
+            }
+        }
+    };
+    QVector<std::thread*> threads;
+    int numThreads = qMin(QThread::idealThreadCount(), mazePaths.size());
+    for (int i = 1; i < numThreads; i += 1) {
+        threads.append(new std::thread(renderNext));
+    }
+    renderNext();
+    for (std::thread* thread : threads) {
+        thread->join();
+        delete thread;
+    }
+    qInfo().noquote().nospace()
+        << "Rendered " << mazePaths.size() - failures << " of "
+        << mazePaths.size() << " mazes in " << timer.elapsed() << " ms";
+    return failures == 0;
+}
+
+QImage MazePreview::render(
+        const Maze* maze,
+        const QVector<Command>& commands,
+        int width,
+        int height) {
+
+    // The walls and pegs, exactly as the renderer draws any view
+    MazeView view(maze);
+    SoftwareMapRenderer renderer(width, height);
+    renderer.setMaze(maze);
+    renderer.setView(&view);
+    QImage image = renderer.render();
+
+    // Everything else is drawn in pixels, so that the text isn't flipped
+    QTransform transform = renderer.getTransform();
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    double tileLength = Dimensions::tileLength().getMeters();
+    double tilePixels = transform.mapRect(
+        QRectF(0.0, 0.0, tileLength, tileLength)
+    ).width();
+    if (MIN_TEXT_PIXELS <= tilePixels) {
+        QFont font = painter.font();
+        font.setPixelSize(qMax(1, qRound(0.35 * tilePixels)));
+        painter.setFont(font);
+        RGB rgb = COLOR_TO_RGB(Color::GRAY);
+        painter.setPen(QColor(rgb.r, rgb.g, rgb.b));
+        for (int x = 0; x < maze->getWidth(); x += 1) {
+            for (int y = 0; y < maze->getHeight(); y += 1) {
+                int distance = maze->getDistance(x, y);
+                if (distance < 0) {
+                    continue;
+                }
+                painter.drawText(
+                    transform.mapRect(QRectF(
+                        x * tileLength,
+                        y * tileLength,
+                        tileLength,
+                        tileLength
+                    )),
+                    Qt::AlignCenter,
+                    QString::number(distance)
+                );
+            }
+        }
+    }
+
+    if (!commands.isEmpty()) {
+        RGB rgb = COLOR_TO_RGB(Color::ORANGE);
+        QPen pen(QColor(rgb.r, rgb.g, rgb.b, 192));
+        pen.setWidthF(qMax(1.0, 0.15 * tilePixels));
+        pen.setCapStyle(Qt::RoundCap);
+        pen.setJoinStyle(Qt::RoundJoin);
+        painter.setPen(pen);
+        for (const QPolygonF& stretch : getPath(maze, commands)) {
+            painter.drawPolyline(transform.map(stretch));
+        }
+    }
+    return image;
+}
+
+QVector<QPolygonF> MazePreview::getPath(
+        const Maze* maze,
+        const QVector<Command>& commands) {
+
+    // The replay draws on a view of its own, which isn't drawn at all
+    MazeView view(maze);
+    TraceReplay replay(maze, &view, commands);
+    double tileLength = Dimensions::tileLength().getMeters();
+    auto getCenter = [tileLength](QPair<int, int> cell) {
+        return QPointF(
+            (cell.first + 0.5) * tileLength,
+            (cell.second + 0.5) * tileLength
+        );
+    };
+
+    // A reset starts a new stretch; every other command that moves the
+    // mouse is drawn as a straight line to where it stops, which, for a
+    // whole path at once, cuts its corners
+    const Mouse* mouse = replay.getMouse();
+    QPair<int, int> last = mouse->getCurrentDiscretizedTranslation();
+    QVector<QPolygonF> path(1);
+    path.last().append(getCenter(last));
+    for (int i = 1; i <= replay.getLength(); i += 1) {
+        replay.seek(i);
+        QPair<int, int> cell = mouse->getCurrentDiscretizedTranslation();
+        if (cell == last) {
+            continue;
+        }
+        if (commands.at(i - 1).opcode == Opcode::ACK_RESET) {
+            path.append(QPolygonF());
+        }
+        path.last().append(getCenter(cell));
+        last = cell;
+    }
+    return path;
+}
+
+} 
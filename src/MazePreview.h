@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QImage>
+#include <QPolygonF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Command.h"
+#include "Maze.h"
+
+namespace mms {
+
+class MazePreview {
+
+    // Renders pictures of whole mazes, e.g., for reports, entirely on the
+    // CPU and without any window: the tile records of a fresh view, drawn by
+    // the software map renderer, with the distance of every cell to the
+    // center written on it (if the cells are big enough to read it), and,
+    // optionally, the path that the commands of a run take the mouse along,
+    // replayed in the maze. Mazes are rendered on as many threads as there
+    // are cores, each of which takes the next maze until none are left.
+
+public:
+
+    MazePreview() = delete;
+
+    // Renders each maze to the output path at the same index, as whatever
+    // format the path's suffix names; the commands of the given run of the
+    // trace (counting from one, or zero for the last), if there is a trace,
+    // are replayed in every maze, which is usually just the run's own. Returns
+    // false, having logged why, if the trace couldn't be read, or any maze
+    // couldn't be read or its picture written.
+    static bool run(
+        const QStringList& mazePaths,
+        const QStringList& outputPaths,
+        const QString& tracePath,
+        int run,
+        int width,
+        int height);
+
+    static QImage render(
+        const Maze* maze,
+        const QVector<Command>& commands,
+        int width,
+        int height);
+
+private:
+
+    // Distances are only written in cells that are at least this many
+    // pixels wide
+    static const int MIN_TEXT_PIXELS;
+
+    // The centers of the cells that the mouse stops in, in physical
+    // coordinates, one polygon for every stretch between resets
+    static QVector<QPolygonF> getPath(
+        const Maze* maze,
+        const QVector<Command>& commands);
+
+};
+
+} 
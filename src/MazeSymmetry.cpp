@@ -0,0 +1,153 @@
+#include "MazeSymmetry.h"
+
+#include "AssertMacros.h"
+#include "Maze.h"
+
+namespace mms {
+
+const QVector<Symmetry>& MazeSymmetry::SYMMETRIES() {
+    static const QVector<Symmetry> symmetries = {
+        Symmetry::IDENTITY,
+        Symmetry::ROTATE_90,
+        Symmetry::ROTATE_180,
+        Symmetry::ROTATE_270,
+        Symmetry::MIRROR_X,
+        Symmetry::MIRROR_Y,
+        Symmetry::TRANSPOSE,
+        Symmetry::ANTITRANSPOSE,
+    };
+    return symmetries;
+}
+
+QString MazeSymmetry::toString(Symmetry symmetry) {
+    switch (symmetry) {
+        case Symmetry::IDENTITY:
+            return "identity";
+        case Symmetry::ROTATE_90:
+            return "rotate-90";
+        case Symmetry::ROTATE_180:
+            return "rotate-180";
+        case Symmetry::ROTATE_270:
+            return "rotate-270";
+        case Symmetry::MIRROR_X:
+            return "mirror-x";
+        case Symmetry::MIRROR_Y:
+            return "mirror-y";
+        case Symmetry::TRANSPOSE:
+            return "transpose";
+        case Symmetry::ANTITRANSPOSE:
+            return "antitranspose";
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+QString MazeSymmetry::getVariantName(
+        const QString& source,
+        Symmetry symmetry) {
+    if (symmetry == Symmetry::IDENTITY) {
+        return source;
+    }
+    return source + "@" + toString(symmetry);
+}
+
+WallGrid MazeSymmetry::apply(const WallGrid& walls, Symmetry symmetry) {
+
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    Transform transform = getTransform(symmetry);
+    bool isSwapped = transform.xx == 0;
+    int newWidth = isSwapped ? height : width;
+    int newHeight = isSwapped ? width : height;
+
+    // Negative coefficients are moved back into the maze by its last column
+    // or row, so that every cell lands within the variant
+    int xOffset =
+        (transform.xx < 0 ? width - 1 : 0) +
+        (transform.xy < 0 ? height - 1 : 0);
+    int yOffset =
+        (transform.yx < 0 ? width - 1 : 0) +
+        (transform.yy < 0 ? height - 1 : 0);
+
+    QVector<unsigned char> table = getWallTable(transform);
+    QVector<unsigned char> bytes(WallGrid::getNumBytes(newWidth, newHeight), 0);
+    for (int x = 0; x < width; x += 1) {
+        for (int y = 0; y < height; y += 1) {
+            int newX = transform.xx * x + transform.xy * y + xOffset;
+            int newY = transform.yx * x + transform.yy * y + yOffset;
+            int cell = newX * newHeight + newY;
+            unsigned char bits = table.at(walls.getWallBits(x * height + y));
+            bytes[cell / 2] |= bits << (4 * (cell % 2));
+        }
+    }
+    return WallGrid(newWidth, newHeight, bytes.constData());
+}
+
+quint64 MazeSymmetry::getOrbitHash(const WallGrid& walls) {
+    quint64 hash = Maze::getHash(walls);
+    for (Symmetry symmetry : SYMMETRIES()) {
+        if (symmetry != Symmetry::IDENTITY) {
+            hash = qMin(hash, Maze::getHash(apply(walls, symmetry)));
+        }
+    }
+    return hash;
+}
+
+MazeSymmetry::Transform MazeSymmetry::getTransform(Symmetry symmetry) {
+    switch (symmetry) {
+        case Symmetry::IDENTITY:
+            return {1, 0, 0, 1};
+        case Symmetry::ROTATE_90:
+            return {0, -1, 1, 0};
+        case Symmetry::ROTATE_180:
+            return {-1, 0, 0, -1};
+        case Symmetry::ROTATE_270:
+            return {0, 1, -1, 0};
+        case Symmetry::MIRROR_X:
+            return {-1, 0, 0, 1};
+        case Symmetry::MIRROR_Y:
+            return {1, 0, 0, -1};
+        case Symmetry::TRANSPOSE:
+            return {0, 1, 1, 0};
+        case Symmetry::ANTITRANSPOSE:
+            return {0, -1, -1, 0};
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+QVector<unsigned char> MazeSymmetry::getWallTable(const Transform& transform) {
+
+    // Each direction is a step of one cell, which the transform maps to the
+    // step of another direction
+    static const int steps[NUM_DIRECTIONS][2] = {
+        {0, 1},
+        {1, 0},
+        {0, -1},
+        {-1, 0},
+    };
+    int mapped[NUM_DIRECTIONS];
+    for (int i = 0; i < NUM_DIRECTIONS; i += 1) {
+        int dx = transform.xx * steps[i][0] + transform.xy * steps[i][1];
+        int dy = transform.yx * steps[i][0] + transform.yy * steps[i][1];
+        mapped[i] = -1;
+        for (int j = 0; j < NUM_DIRECTIONS; j += 1) {
+            if (steps[j][0] == dx && steps[j][1] == dy) {
+                mapped[i] = j;
+            }
+        }
+        ASSERT_LE(0, mapped[i]);
+    }
+
+    QVector<unsigned char> table(1 << NUM_DIRECTIONS, 0);
+    for (int bits = 0; bits < table.size(); bits += 1) {
+        for (int i = 0; i < NUM_DIRECTIONS; i += 1) {
+            if (bits & (1 << i)) {
+                table[bits] |= 1 << mapped[i];
+            }
+        }
+    }
+    return table;
+}
+
+} 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "WallGrid.h"
+
+namespace mms {
+
+// The eight symmetries of a rectangle, as maps of the cells of a maze; for a
+// maze that isn't square, the rotations by a quarter turn and the two
+// transpositions swap its width and height
+enum class Symmetry {
+    IDENTITY,
+    ROTATE_90, // counterclockwise
+    ROTATE_180,
+    ROTATE_270,
+    MIRROR_X, // about the vertical axis, i.e., x becomes width - 1 - x
+    MIRROR_Y, // about the horizontal axis
+    TRANSPOSE, // about the diagonal through the start
+    ANTITRANSPOSE, // about the other diagonal
+};
+
+class MazeSymmetry {
+
+    // Maps mazes to their mirror and rotation variants in memory, straight
+    // from one wall grid to another: the four bits of each cell are permuted
+    // with a table (each wall goes to the direction that the symmetry maps
+    // it to), and written to the cell that the symmetry maps the cell to, so
+    // nothing is parsed, validated or searched. A variant of a valid maze is
+    // always enclosed and consistent, and the center of a maze is mapped to
+    // itself, but the start isn't: the start of a variant is the corner that
+    // the symmetry maps to the start, which the center might not be reachable
+    // from.
+
+public:
+
+    MazeSymmetry() = delete;
+
+    // Every symmetry, the identity first
+    static const QVector<Symmetry>& SYMMETRIES();
+
+    static QString toString(Symmetry symmetry);
+
+    // The source of a variant, for display, e.g. "maze.num@rotate-90"; the
+    // identity's is the source itself
+    static QString getVariantName(const QString& source, Symmetry symmetry);
+
+    static WallGrid apply(const WallGrid& walls, Symmetry symmetry);
+
+    // The smallest of the hashes of the maze's variants (see Maze::getHash),
+    // which is the same for every one of them, so that runs of variants can
+    // be linked up, whichever of them a file holds
+    static quint64 getOrbitHash(const WallGrid& walls);
+
+private:
+
+    // The linear part of the map of a symmetry, from x and y to the new x
+    // (xx * x + xy * y) and the new y (yx * x + yy * y), before it's moved
+    // back into the maze
+    struct Transform {
+        int xx;
+        int xy;
+        int yx;
+        int yy;
+    };
+    static Transform getTransform(Symmetry symmetry);
+
+    // The walls of a cell, as mapped by the transform, for every set of walls
+    static QVector<unsigned char> getWallTable(const Transform& transform);
+
+};
+
+} 
@@ -0,0 +1,119 @@
+#include "MazeThumbnailer.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+#include "Direction.h"
+#include "MazeGenerator.h"
+
+namespace mms {
+
+const int MazeThumbnailer::SIZE = 64;
+const QByteArray MazeThumbnailer::VERSION = "1";
+
+MazeThumbnailer::MazeThumbnailer() :
+    m_directory(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        "/thumbnails") {
+}
+
+void MazeThumbnailer::request(const QString& source) {
+
+    // Hashing the file is much faster than parsing it
+    QString key = getKey(source);
+    if (key.isEmpty()) {
+        emit rendered(source, QImage());
+        return;
+    }
+    QString path = m_directory + "/" + key + ".png";
+    QImage thumbnail(path);
+    if (!thumbnail.isNull()) {
+        emit rendered(source, thumbnail);
+        return;
+    }
+
+    // Invalid mazes aren't cached, since they're cheap to reject again
+    Maze* maze = MazeGenerator::load(source);
+    if (maze == nullptr) {
+        emit rendered(source, QImage());
+        return;
+    }
+    thumbnail = render(maze);
+    delete maze;
+
+    // If the thumbnail can't be cached, it's still shown
+    QDir().mkpath(m_directory);
+    thumbnail.save(path, "PNG");
+    emit rendered(source, thumbnail);
+}
+
+QImage MazeThumbnailer::render(const Maze* maze) {
+
+    // Every tile is at least two pixels across, so that corridors are
+    // visible before scaling; the walls of neighboring tiles overlap
+    int width = maze->getWidth();
+    int height = maze->getHeight();
+    int pixelsPerTile = qMax(2, SIZE / qMax(width, height));
+    QImage image(
+        width * pixelsPerTile + 1,
+        height * pixelsPerTile + 1,
+        QImage::Format_RGB32
+    );
+    image.fill(Qt::black);
+    QRgb wall = qRgb(192, 192, 192);
+    auto setPixel = [&](int x, int y) {
+        // Image rows go down, and maze rows go up
+        QRgb* row = reinterpret_cast<QRgb*>(
+            image.scanLine(image.height() - 1 - y)
+        );
+        row[x] = wall;
+    };
+    for (int x = 0; x < width; x += 1) {
+        for (int y = 0; y < height; y += 1) {
+            int left = x * pixelsPerTile;
+            int bottom = y * pixelsPerTile;
+            for (int i = 0; i <= pixelsPerTile; i += 1) {
+                if (maze->isWall(x, y, Direction::NORTH)) {
+                    setPixel(left + i, bottom + pixelsPerTile);
+                }
+                if (maze->isWall(x, y, Direction::EAST)) {
+                    setPixel(left + pixelsPerTile, bottom + i);
+                }
+                if (maze->isWall(x, y, Direction::SOUTH)) {
+                    setPixel(left + i, bottom);
+                }
+                if (maze->isWall(x, y, Direction::WEST)) {
+                    setPixel(left, bottom + i);
+                }
+            }
+        }
+    }
+    if (SIZE < image.width() || SIZE < image.height()) {
+        image = image.scaled(
+            SIZE,
+            SIZE,
+            Qt::KeepAspectRatio,
+            Qt::SmoothTransformation
+        );
+    }
+    return image;
+}
+
+QString MazeThumbnailer::getKey(const QString& source) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(VERSION);
+    if (MazeGenerator::isSpec(source)) {
+        hash.addData(source.toUtf8());
+    }
+    else {
+        QFile file(source);
+        if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+            return QString();
+        }
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+} 
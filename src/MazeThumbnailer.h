@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QImage>
+#include <QObject>
+#include <QString>
+
+#include "Maze.h"
+
+namespace mms {
+
+class MazeThumbnailer : public QObject {
+
+    // Renders small pictures of the walls of mazes, for the maze selector,
+    // and caches them on disk, keyed on a hash of the contents of the maze
+    // file (or of a generated maze's spec), so that a maze is only parsed for
+    // its thumbnail once, however often it's listed; a file whose contents
+    // change gets a new thumbnail. Like the MazeLoader, it's meant to live on
+    // a thread of its own, and hands over each thumbnail through a signal.
+
+    Q_OBJECT
+
+public:
+
+    MazeThumbnailer();
+
+    // The width and height of every thumbnail, in pixels
+    static const int SIZE;
+
+    // To be invoked on the thumbnailer's thread, with a queued connection;
+    // rendered is emitted once for every request
+    Q_INVOKABLE void request(const QString& source);
+
+    // Walls are drawn a whole number of pixels apart, and larger mazes are
+    // scaled down to fit
+    static QImage render(const Maze* maze);
+
+signals:
+
+    // The thumbnail is null if the maze couldn't be read or is invalid
+    void rendered(const QString& source, const QImage& thumbnail);
+
+private:
+
+    // Part of every key, so that thumbnails are rendered again whenever
+    // their look changes
+    static const QByteArray VERSION;
+
+    QString m_directory;
+
+    // An empty key means that the source couldn't be read
+    static QString getKey(const QString& source);
+
+};
+
+} 
@@ -1,48 +1,122 @@
 #include "MazeView.h"
 
+#include <algorithm>
+
 #include "BufferInterface.h"
 #include "Dimensions.h"
 #include "MazeGraphic.h"
+#include "Profiler.h"
 
 namespace mms {
 
+const int MazeView::DIRTY_RANGE_MERGE_GAP = 64;
+
 MazeView::MazeView(const Maze* maze) :
+        m_tileDirtyRanges(QVector<DirtyRange>()),
+        m_tileHeatDirtyRanges(QVector<DirtyRange>()),
+        m_glyphDirtyRanges(QVector<DirtyRange>()),
+        m_textureLayoutVersion(0),
+        m_untakenTileRanges(QVector<DirtyRange>()),
+        m_untakenTileHeatRanges(QVector<DirtyRange>()),
+        m_untakenGlyphRanges(QVector<DirtyRange>()),
         m_bufferInterface(
             {maze->getWidth(), maze->getHeight()},
-            &m_graphicCpuBuffer,
-            &m_textureCpuBuffer),
+            &m_tileInstanceCpuBuffer,
+            &m_glyphInstanceCpuBuffer,
+            &m_tileDirtyRanges,
+            &m_tileHeatDirtyRanges,
+            &m_glyphDirtyRanges),
         m_mazeGraphic(
             maze,
-            &m_bufferInterface) {
+            &m_bufferInterface),
+        m_initialState(MazeGraphic::State()) {
+
+    // Group the tiles, so that they can be culled
+    m_tileChunks = m_bufferInterface.getTileChunks();
 
     // Establish the coordinates for the tile text characters
     initText(2, 5);
 
-    // Populate the data vectors with wall polygons and tile distance text.
+    // Populate the data vectors with tile state and tile distance text.
     m_mazeGraphic.drawPolygons();
     m_mazeGraphic.drawTextures();
+
+    // The columns are implicitly shared, so keeping them around only costs
+    // a copy of the ones that are changed later
+    m_initialState = m_mazeGraphic.getState();
+    publishSnapshot();
 }
 
 MazeGraphic* MazeView::getMazeGraphic() {
     return &m_mazeGraphic;
 }
 
+void MazeView::reset() {
+    PROFILE_ZONE("MazeView::reset");
+    m_mazeGraphic.setState(m_initialState);
+    publishSnapshot();
+}
+
 void MazeView::initTileGraphicText(int numRows, int numCols) {
     initText(numRows, numCols);
+    publishSnapshot();
 }
 
-const QVector<TriangleGraphic>* MazeView::getGraphicCpuBuffer() const {
-    return &m_graphicCpuBuffer;
+const QVector<TileInstance>* MazeView::getTileInstanceCpuBuffer() const {
+    return &m_tileInstanceCpuBuffer;
 }
 
-const QVector<TriangleTexture>* MazeView::getTextureCpuBuffer() const {
-    return &m_textureCpuBuffer;
+const QVector<GlyphInstance>* MazeView::getGlyphInstanceCpuBuffer() const {
+    return &m_glyphInstanceCpuBuffer;
+}
+
+const QVector<TileChunk>* MazeView::getTileChunks() const {
+    return &m_tileChunks;
+}
+
+int MazeView::getTextureLayoutVersion() const {
+    return m_textureLayoutVersion;
+}
+
+void MazeView::publishSnapshot() {
+    m_mazeGraphic.flush();
+    QVector<DirtyRange> tileRanges = takeMerged(&m_tileDirtyRanges);
+    QVector<DirtyRange> tileHeatRanges = takeMerged(&m_tileHeatDirtyRanges);
+    m_bufferInterface.clearTileChunksDirty();
+    QVector<DirtyRange> glyphRanges = takeMerged(&m_glyphDirtyRanges);
+    m_untakenTileRanges += tileRanges;
+    m_untakenTileRanges = takeMerged(&m_untakenTileRanges);
+    m_untakenTileHeatRanges += tileHeatRanges;
+    m_untakenTileHeatRanges = takeMerged(&m_untakenTileHeatRanges);
+    m_untakenGlyphRanges += glyphRanges;
+    m_untakenGlyphRanges = takeMerged(&m_untakenGlyphRanges);
+
+    ViewSnapshot* snapshot = m_snapshots.back();
+    snapshot->tileInstances = m_tileInstanceCpuBuffer;
+    snapshot->glyphInstances = m_glyphInstanceCpuBuffer;
+    snapshot->tileDirtyRanges = m_untakenTileRanges;
+    snapshot->tileHeatDirtyRanges = m_untakenTileHeatRanges;
+    snapshot->glyphDirtyRanges = m_untakenGlyphRanges;
+    snapshot->textureLayoutVersion = m_textureLayoutVersion;
+
+    // If the previous snapshot was taken, the map only misses what changed
+    // since then; otherwise it still misses everything up until now
+    if (m_snapshots.publish()) {
+        m_untakenTileRanges = tileRanges;
+        m_untakenTileHeatRanges = tileHeatRanges;
+        m_untakenGlyphRanges = glyphRanges;
+    }
+}
+
+const ViewSnapshot& MazeView::takeSnapshot(bool* isNew) const {
+    *isNew = m_snapshots.consume();
+    return m_snapshots.front();
 }
 
 void MazeView::initText(int numRows, int numCols) {
 
-    // Initialze the tile text in the buffer class,
-    // do caching for speed improvement
+    // Initialze the tile text in the buffer class, do caching for speed
+    // improvement; this also empties the glyph buffer
     m_bufferInterface.initTileGraphicText(
         Dimensions::wallLength(),
         Dimensions::wallWidth(),
@@ -51,8 +125,43 @@ void MazeView::initText(int numRows, int numCols) {
         
     // TODO: upforgrabs
     // The naming ("draw") is kind of confusing
-    m_textureCpuBuffer.clear();
+    m_textureLayoutVersion += 1;
     m_mazeGraphic.drawTextures();
 }
 
+QVector<DirtyRange> MazeView::takeMerged(QVector<DirtyRange>* ranges) {
+    QVector<DirtyRange> merged;
+    takeMerged(ranges, &merged);
+    return merged;
+}
+
+void MazeView::takeMerged(
+        QVector<DirtyRange>* ranges,
+        QVector<DirtyRange>* merged) {
+    merged->resize(0);
+    if (ranges->isEmpty()) {
+        return;
+    }
+    std::sort(
+        ranges->begin(),
+        ranges->end(),
+        [](const DirtyRange& lhs, const DirtyRange& rhs) {
+            return lhs.begin < rhs.begin;
+        }
+    );
+    merged->append(ranges->first());
+    for (int i = 1; i < ranges->size(); i += 1) {
+        const DirtyRange& range = ranges->at(i);
+        DirtyRange& last = merged->last();
+        if (range.begin <= last.end + DIRTY_RANGE_MERGE_GAP) {
+            last.end = qMax(last.end, range.end);
+        }
+        else {
+            merged->append(range);
+        }
+    }
+    // Keep the allocation around for the next frame
+    ranges->resize(0);
+}
+
 } 
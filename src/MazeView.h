@@ -3,10 +3,14 @@
 #include <QVector>
 
 #include "BufferInterface.h"
+#include "DirtyRange.h"
+#include "GlyphInstance.h"
 #include "Maze.h"
 #include "MazeGraphic.h"
-#include "TriangleGraphic.h"
-#include "TriangleTexture.h"
+#include "TileChunk.h"
+#include "TileInstance.h"
+#include "TripleBuffer.h"
+#include "ViewSnapshot.h"
 
 namespace mms {
 
@@ -17,26 +21,78 @@ public:
     MazeView(const Maze* maze);
     MazeGraphic* getMazeGraphic();
     void initTileGraphicText(int numRows, int numCols);
-    const QVector<TriangleGraphic>* getGraphicCpuBuffer() const;
-    const QVector<TriangleTexture>* getTextureCpuBuffer() const;
+
+    // Returns every tile to how it was drawn when the view was constructed,
+    // i.e., without declared walls, colors, text, heat or fog, and publishes
+    // the result; only the columns that changed since are rewritten, so
+    // that a view can be reused for the next run of the same maze at about
+    // the cost of the run's own changes
+    void reset();
+
+    const QVector<TileInstance>* getTileInstanceCpuBuffer() const;
+    const QVector<GlyphInstance>* getGlyphInstanceCpuBuffer() const;
+
+    // Groups of tiles that can be drawn, or skipped, as a whole
+    const QVector<TileChunk>* getTileChunks() const;
+
+    // Incremented whenever the glyph buffer is rebuilt from scratch, at
+    // which point it has to be re-uploaded
+    int getTextureLayoutVersion() const;
+
+    // The map never reads the buffers above while the view is changing;
+    // whichever thread changes the view publishes a snapshot once it's done
+    // (e.g., once per turn of the event loop), and the map draws the most
+    // recent snapshot, which may be on another thread. Taking a snapshot
+    // doesn't change what the view looks like, hence const. Sets isNew to
+    // whether the snapshot was published since the last one that was taken.
+    // Publishing first writes whatever the maze graphic staged.
+    void publishSnapshot();
+    const ViewSnapshot& takeSnapshot(bool* isNew) const;
+
+    // Sorts and merges the ranges, and empties them; ranges separated by
+    // fewer than DIRTY_RANGE_MERGE_GAP elements are merged into one; the
+    // second replaces *merged with them, reusing its storage
+    static QVector<DirtyRange> takeMerged(QVector<DirtyRange>* ranges);
+    static void takeMerged(
+        QVector<DirtyRange>* ranges,
+        QVector<DirtyRange>* merged);
 
 private:
 
-    // These vectors contain the triangles that will actually be drawn
-    QVector<TriangleGraphic> m_graphicCpuBuffer;
-    QVector<TriangleTexture> m_textureCpuBuffer;
+    // These vectors contain the state of each tile and the glyphs of the
+    // tile text; the geometry of the tiles is the shared TileTemplate
+    QVector<TileInstance> m_tileInstanceCpuBuffer;
+    QVector<GlyphInstance> m_glyphInstanceCpuBuffer;
+    QVector<TileChunk> m_tileChunks;
+
+    QVector<DirtyRange> m_tileDirtyRanges;
+    QVector<DirtyRange> m_tileHeatDirtyRanges;
+    QVector<DirtyRange> m_glyphDirtyRanges;
+    int m_textureLayoutVersion;
+
+    // The published snapshots, and the ranges that changed since the last
+    // snapshot that the map took, which every later snapshot has to include
+    mutable TripleBuffer<ViewSnapshot> m_snapshots;
+    QVector<DirtyRange> m_untakenTileRanges;
+    QVector<DirtyRange> m_untakenTileHeatRanges;
+    QVector<DirtyRange> m_untakenGlyphRanges;
 
     // The buffer interface provides abstractions which the MazeGraphic
-    // uses to populate the vector of TriangleGraphic objects
+    // uses to populate the above vectors
     BufferInterface m_bufferInterface;
 
     // The MazeGraphic is essentially a "handle" into the above vectors;
     // it provides a high-level API for modifying their contents
     MazeGraphic m_mazeGraphic;
+    MazeGraphic::State m_initialState;
 
     // Helper method for initializing TileGraphic text
     void initText(int numRows, int numCols);
 
+    // Ranges separated by fewer elements than this are uploaded as one, since
+    // a few redundant bytes are cheaper than another buffer write call
+    static const int DIRTY_RANGE_MERGE_GAP;
+
 };
 
 } 
@@ -0,0 +1,204 @@
+#include "MetricsEndpoint.h"
+
+#include <QDebug>
+#include <QHostAddress>
+#include <QTextStream>
+
+#include "AssertMacros.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const QVector<double> MetricsEndpoint::LATENCY_BUCKETS = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+    0.25, 0.5, 1.0, 2.5, 5.0, 10.0,
+};
+const int MetricsEndpoint::MAX_REQUEST_BYTES = 64 * 1024;
+
+MetricsEndpoint::MetricsEndpoint(int numSlots, QObject* parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this)),
+    m_numSlots(numSlots),
+    m_startTimestamp(SimUtilities::getHighResTimestamp()),
+    m_numInFlight(0),
+    m_busySeconds(0.0),
+    m_busySince(m_startTimestamp),
+    m_lastCompletedTimestamp(-1.0),
+    m_latency(CommandLatency()) {
+    ASSERT_LT(0, m_numSlots);
+    connect(
+        m_server,
+        &QTcpServer::newConnection,
+        this,
+        &MetricsEndpoint::onNewConnection
+    );
+}
+
+bool MetricsEndpoint::listen(quint16 port) {
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qWarning().noquote().nospace()
+            << "Unable to serve metrics on port " << port << ": "
+            << m_server->errorString();
+        return false;
+    }
+    qInfo().noquote().nospace()
+        << "Serving metrics on port " << m_server->serverPort();
+    return true;
+}
+
+CommandLatency* MetricsEndpoint::getLatency() {
+    return &m_latency;
+}
+
+void MetricsEndpoint::setNumInFlight(int numInFlight) {
+    account();
+    m_numInFlight = numInFlight;
+}
+
+void MetricsEndpoint::recordResult(const RunResult& result) {
+    m_numCompleted[result.status] += 1;
+    m_lastCompletedTimestamp = SimUtilities::getHighResTimestamp();
+}
+
+void MetricsEndpoint::onNewConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* socket = m_server->nextPendingConnection();
+        m_requests.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [=](){
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [=](){
+            m_requests.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MetricsEndpoint::onReadyRead(QTcpSocket* socket) {
+
+    // Only the request line matters, but the headers are read to the end so
+    // that the client doesn't see its request cut off
+    QByteArray& request = m_requests[socket];
+    request.append(socket->readAll());
+    if (MAX_REQUEST_BYTES < request.size()) {
+        socket->abort();
+        return;
+    }
+    if (!request.contains("\r\n\r\n")) {
+        return;
+    }
+    QList<QByteArray> requestLine =
+        request.left(request.indexOf("\r\n")).split(' ');
+    QByteArray method = requestLine.value(0);
+    QByteArray path = requestLine.value(1);
+    path = path.left(path.indexOf('?'));
+
+    QByteArray status = "200 OK";
+    QByteArray body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    }
+    else if (path != "/metrics") {
+        status = "404 Not Found";
+    }
+    else {
+        body = toText().toUtf8();
+    }
+    socket->write(
+        "HTTP/1.1 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n"
+        "\r\n" + body
+    );
+    socket->disconnectFromHost();
+}
+
+void MetricsEndpoint::account() {
+    double now = SimUtilities::getHighResTimestamp();
+    m_busySeconds += m_numInFlight * (now - m_busySince);
+    m_busySince = now;
+}
+
+QString MetricsEndpoint::toText() {
+
+    account();
+    double now = SimUtilities::getHighResTimestamp();
+    double uptime = now - m_startTimestamp;
+    QString text;
+    QTextStream out(&text);
+
+    out << "# HELP mms_jobs_completed_total Jobs completed, by status.\n";
+    out << "# TYPE mms_jobs_completed_total counter\n";
+    for (RunStatus status : {
+        RunStatus::SOLVED,
+        RunStatus::EXITED,
+        RunStatus::TIMEOUT,
+        RunStatus::FAILED_TO_START,
+        RunStatus::INVALID_MAZE,
+    }) {
+        out << "mms_jobs_completed_total{status=\"" << statusToLabel(status)
+            << "\"} " << m_numCompleted.value(status, 0) << "\n";
+    }
+
+    out << "# HELP mms_jobs_in_flight Jobs running right now.\n";
+    out << "# TYPE mms_jobs_in_flight gauge\n";
+    out << "mms_jobs_in_flight " << m_numInFlight << "\n";
+    out << "# HELP mms_job_slots Jobs that may run at once.\n";
+    out << "# TYPE mms_job_slots gauge\n";
+    out << "mms_job_slots " << m_numSlots << "\n";
+
+    out << "# HELP mms_slot_busy_seconds_total Seconds of jobs running, "
+        << "summed over the slots.\n";
+    out << "# TYPE mms_slot_busy_seconds_total counter\n";
+    out << "mms_slot_busy_seconds_total "
+        << QString::number(m_busySeconds, 'f', 3) << "\n";
+    out << "# HELP mms_utilization Share of the slots that were busy, since "
+        << "the start.\n";
+    out << "# TYPE mms_utilization gauge\n";
+    out << "mms_utilization " << QString::number(
+        0.0 < uptime ? m_busySeconds / (m_numSlots * uptime) : 0.0, 'f', 4
+    ) << "\n";
+
+    out << "# HELP mms_uptime_seconds Seconds since the start.\n";
+    out << "# TYPE mms_uptime_seconds gauge\n";
+    out << "mms_uptime_seconds " << QString::number(uptime, 'f', 3) << "\n";
+    out << "# HELP mms_seconds_since_last_job Seconds since a job last "
+        << "completed, or since the start.\n";
+    out << "# TYPE mms_seconds_since_last_job gauge\n";
+    out << "mms_seconds_since_last_job " << QString::number(
+        now - qMax(m_startTimestamp, m_lastCompletedTimestamp), 'f', 3
+    ) << "\n";
+
+    // Cumulative buckets, as Prometheus expects them
+    out << "# HELP mms_command_latency_seconds Round trip of each command, "
+        << "from its line being read to its response being sent.\n";
+    out << "# TYPE mms_command_latency_seconds histogram\n";
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        const LatencyHistogram& histogram = m_latency.getTotal(spec.opcode);
+        if (histogram.getCount() == 0) {
+            continue;
+        }
+        QString labels = "command=\"" + spec.name + "\"";
+        for (double bound : LATENCY_BUCKETS) {
+            out << "mms_command_latency_seconds_bucket{" << labels
+                << ",le=\"" << QString::number(bound) << "\"} "
+                << histogram.getCountAtMost(bound) << "\n";
+        }
+        out << "mms_command_latency_seconds_bucket{" << labels
+            << ",le=\"+Inf\"} " << histogram.getCount() << "\n";
+        out << "mms_command_latency_seconds_sum{" << labels << "} "
+            << QString::number(histogram.getSumSeconds(), 'f', 6) << "\n";
+        out << "mms_command_latency_seconds_count{" << labels << "} "
+            << histogram.getCount() << "\n";
+    }
+
+    out.flush();
+    return text;
+}
+
+QString MetricsEndpoint::statusToLabel(RunStatus status) {
+    return HeadlessRun::statusToString(status).toLower();
+}
+
+} 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "CommandLatency.h"
+#include "HeadlessRun.h"
+
+namespace mms {
+
+class MetricsEndpoint : public QObject {
+
+    // Serves the metrics of a headless batch or worker over HTTP, in the text
+    // format that Prometheus scrapes, at GET /metrics: jobs completed (by
+    // status, so errors and timeouts are counted apart), jobs in flight and
+    // the slots for them, the seconds spent busy in every slot, and the
+    // utilization of the slots since the start, the time since the last job
+    // completed (to catch stalled workers), and a histogram of the round trip
+    // of every kind of command. Every request gets a single response, after
+    // which the connection is closed.
+
+    Q_OBJECT
+
+public:
+
+    MetricsEndpoint(int numSlots, QObject* parent = 0);
+
+    // Returns false if the port can't be listened on
+    bool listen(quint16 port);
+
+    // Where the runs record the latency of their commands
+    CommandLatency* getLatency();
+
+    // To be called whenever a job starts or a slot frees up, and whenever a
+    // job completes
+    void setNumInFlight(int numInFlight);
+    void recordResult(const RunResult& result);
+
+private:
+
+    // The upper bounds of the latency buckets, in seconds
+    static const QVector<double> LATENCY_BUCKETS;
+
+    // Requests that are larger than this are dropped
+    static const int MAX_REQUEST_BYTES;
+
+    QTcpServer* m_server;
+    QHash<QTcpSocket*, QByteArray> m_requests;
+
+    int m_numSlots;
+    double m_startTimestamp;
+    int m_numInFlight;
+    double m_busySeconds;
+    double m_busySince;
+    double m_lastCompletedTimestamp;
+    QMap<RunStatus, qint64> m_numCompleted;
+    CommandLatency m_latency;
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket* socket);
+
+    // Brings the busy time up to date
+    void account();
+
+    QString toText();
+    static QString statusToLabel(RunStatus status);
+
+};
+
+} 
@@ -0,0 +1,270 @@
+#include "MonteCarloRunner.h"
+
+#include <cmath>
+
+#include <QDebug>
+#include <QDir>
+#include <QTextStream>
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+#include "PluginRun.h"
+#include "SensorNoise.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+const double MonteCarloRunner::INTERVAL_Z = 1.959963984540054;
+
+MonteCarloRunner::MonteCarloRunner(
+        const QString& algoName,
+        const QStringList& mazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool continuous,
+        int numTrials,
+        double falsePositiveRate,
+        double falseNegativeRate,
+        quint64 seed,
+        QObject* parent) :
+    QObject(parent),
+    m_algoName(algoName),
+    m_mazes(mazes),
+    m_numJobs(numJobs),
+    m_timeLimitSeconds(timeLimitSeconds),
+    m_tickLimit(tickLimit),
+    m_commandLimit(commandLimit),
+    m_moveLimit(moveLimit),
+    m_continuous(continuous),
+    m_numTrials(numTrials),
+    m_falsePositiveRate(falsePositiveRate),
+    m_falseNegativeRate(falseNegativeRate),
+    m_seed(seed),
+    m_isPlugin(false),
+    m_nextTrial(0),
+    m_numRunning(0) {
+    ASSERT_LT(0, m_numJobs);
+    ASSERT_LT(0, m_numTrials);
+    ASSERT_TR(SensorNoise::isValidRate(m_falsePositiveRate));
+    ASSERT_TR(SensorNoise::isValidRate(m_falseNegativeRate));
+}
+
+bool MonteCarloRunner::start() {
+
+    if (!SettingsMouseAlgos::names().contains(m_algoName)) {
+        qWarning().noquote().nospace()
+            << "No mouse algorithm named \"" << m_algoName << "\"";
+        return false;
+    }
+    m_runArguments = SettingsMouseAlgos::getRunArguments(m_algoName);
+    m_directory = SettingsMouseAlgos::getDirectory(m_algoName);
+    if (SettingsMouseAlgos::getListenPort(m_algoName) != 0) {
+        qWarning().noquote().nospace()
+            << "The mouse algorithm \"" << m_algoName
+            << "\" connects over TCP, so it only runs in the window";
+        return false;
+    }
+    m_isPlugin = SettingsMouseAlgos::isPlugin(m_algoName);
+    if (m_isPlugin) {
+        if (m_continuous) {
+            qWarning().noquote().nospace()
+                << "The plugin \"" << m_algoName
+                << "\" can't be run with continuous movements";
+            return false;
+        }
+        m_libraryPath = QDir(m_directory).absoluteFilePath(
+            SettingsMouseAlgos::getRunCommand(m_algoName).trimmed()
+        );
+    }
+
+    // Every maze is loaded (or generated) once, and rebuilt from its walls
+    // for each of its trials
+    for (const QString& source : m_mazes) {
+        MazeError error;
+        Maze* maze = MazeGenerator::load(source, &error);
+        if (maze == nullptr) {
+            qWarning().noquote().nospace()
+                << "Invalid maze file \"" << source << "\": "
+                << Maze::errorToString(error);
+            return false;
+        }
+        m_trials.append({source, maze->getWalls(), 0, 0, 0, 0.0});
+        delete maze;
+    }
+    if (m_trials.isEmpty()) {
+        qWarning().noquote() << "No mazes to run";
+        return false;
+    }
+
+    // Fill every slot; each finished run starts the next one
+    for (int i = 0; i < m_numJobs; i += 1) {
+        startNextRun();
+    }
+    return true;
+}
+
+void MonteCarloRunner::startNextRun() {
+
+    if (m_trials.size() * m_numTrials <= m_nextTrial) {
+        return;
+    }
+    int index = m_nextTrial / m_numTrials;
+    int trial = m_nextTrial % m_numTrials;
+    m_nextTrial += 1;
+    const MazeTrials& trials = m_trials.at(index);
+    Maze* maze = Maze::fromWalls(trials.walls);
+    ASSERT_FA(maze == nullptr);
+    SensorNoise noise(
+        m_falsePositiveRate,
+        m_falseNegativeRate,
+        m_seed,
+        getStream(index, trial)
+    );
+
+    if (m_isPlugin) {
+        PluginRun* pluginRun = new PluginRun(
+            trials.name,
+            maze,
+            m_libraryPath,
+            m_timeLimitSeconds,
+            m_tickLimit,
+            this
+        );
+        pluginRun->setStepLimits(m_commandLimit, m_moveLimit);
+        pluginRun->setSensorNoise(noise);
+        connect(pluginRun, &PluginRun::mazeFinished, this, [=](){
+            recordResult(index, pluginRun->getResult());
+        });
+        connect(pluginRun, &PluginRun::finished, this, [=](){
+            onRunFinished(pluginRun);
+        });
+        m_numRunning += 1;
+        pluginRun->start();
+        return;
+    }
+    HeadlessRun* headlessRun = new HeadlessRun(
+        trials.name,
+        maze,
+        m_runArguments,
+        m_directory,
+        m_timeLimitSeconds,
+        m_tickLimit,
+        false,
+        false,
+        m_continuous,
+        this
+    );
+    headlessRun->setStepLimits(m_commandLimit, m_moveLimit);
+    headlessRun->setSensorNoise(noise);
+    connect(headlessRun, &HeadlessRun::mazeFinished, this, [=](){
+        recordResult(index, headlessRun->getResult());
+    });
+    connect(headlessRun, &HeadlessRun::finished, this, [=](){
+        onRunFinished(headlessRun);
+    });
+    m_numRunning += 1;
+    headlessRun->start();
+}
+
+void MonteCarloRunner::onRunFinished(QObject* run) {
+    run->deleteLater();
+    m_numRunning -= 1;
+    startNextRun();
+    if (m_numRunning == 0) {
+        printResults();
+        emit done();
+    }
+}
+
+void MonteCarloRunner::recordResult(int maze, const RunResult& result) {
+    MazeTrials& trials = m_trials[maze];
+    trials.numFinished += 1;
+    if (result.status != RunStatus::SOLVED) {
+        return;
+    }
+    trials.numSolved += 1;
+    trials.solvedMoves += result.moves;
+    trials.solvedSeconds += result.estimatedSeconds;
+}
+
+quint64 MonteCarloRunner::getStream(int maze, int trial) {
+    return (static_cast<quint64>(maze) << 32) | static_cast<quint32>(trial);
+}
+
+void MonteCarloRunner::getInterval(
+        int numSuccesses,
+        int numTrials,
+        double* low,
+        double* high) {
+    ASSERT_LT(0, numTrials);
+    double z = INTERVAL_Z;
+    double n = numTrials;
+    double p = numSuccesses / n;
+    double denominator = 1.0 + z * z / n;
+    double center = (p + z * z / (2.0 * n)) / denominator;
+    double margin = z * std::sqrt(
+        p * (1.0 - p) / n + z * z / (4.0 * n * n)
+    ) / denominator;
+    *low = qMax(0.0, center - margin);
+    *high = qMin(1.0, center + margin);
+}
+
+void MonteCarloRunner::printResults() const {
+
+    QTextStream out(stdout);
+
+    int nameWidth = QString("maze").size();
+    for (const MazeTrials& trials : m_trials) {
+        nameWidth = qMax(nameWidth, trials.name.size());
+    }
+    out << QString("maze").leftJustified(nameWidth) << "  "
+        << QString("trials").rightJustified(7)
+        << QString("solved").rightJustified(7)
+        << QString("p").rightJustified(8)
+        << QString("95% interval").rightJustified(16)
+        << QString("moves").rightJustified(10)
+        << QString("est s").rightJustified(10) << endl;
+    int numTrials = 0;
+    int numSolved = 0;
+    for (const MazeTrials& trials : m_trials) {
+        numTrials += trials.numFinished;
+        numSolved += trials.numSolved;
+        out << trials.name.leftJustified(nameWidth) << "  "
+            << QString::number(trials.numFinished).rightJustified(7)
+            << QString::number(trials.numSolved).rightJustified(7);
+        if (trials.numFinished == 0) {
+            out << endl;
+            continue;
+        }
+        double low = 0.0;
+        double high = 0.0;
+        getInterval(trials.numSolved, trials.numFinished, &low, &high);
+        double p = static_cast<double>(trials.numSolved) / trials.numFinished;
+        out << QString::number(p, 'f', 3).rightJustified(8)
+            << QString("%1-%2").arg(
+                QString::number(low, 'f', 3),
+                QString::number(high, 'f', 3)
+            ).rightJustified(16);
+
+        // The means are only of the trials that were solved
+        if (0 < trials.numSolved) {
+            out << QString::number(
+                    static_cast<double>(trials.solvedMoves) / trials.numSolved,
+                    'f', 1
+                ).rightJustified(10)
+                << QString::number(
+                    trials.solvedSeconds / trials.numSolved, 'f', 3
+                ).rightJustified(10);
+        }
+        out << endl;
+    }
+    out << endl << "false positives: " << m_falsePositiveRate
+        << ", false negatives: " << m_falseNegativeRate
+        << ", seed: " << m_seed
+        << ", solved: " << numSolved << " of " << numTrials << endl;
+}
+
+} 
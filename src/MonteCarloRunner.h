@@ -0,0 +1,107 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "HeadlessRun.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+class MonteCarloRunner : public QObject {
+
+    // Measures how robust an algorithm is to sensor noise, by running it a
+    // number of times on every maze, headlessly, with the walls that it
+    // reads misread at the given rates (see SensorNoise), and reporting the
+    // fraction of the trials that solved each maze, i.e., the probability
+    // that the algorithm solves it, along with a 95% confidence interval (a
+    // Wilson score interval, which stays within zero and one however few
+    // trials there are). Trials are run with a fixed number in flight at
+    // once, as in a batch, and every trial of every maze reads from a noise
+    // stream of its own, numbered by the maze and the trial, so the whole
+    // run is reproducible from the seed for a deterministic algorithm, on
+    // any number of cores.
+
+    Q_OBJECT
+
+public:
+
+    MonteCarloRunner(
+        const QString& algoName,
+        const QStringList& mazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool continuous,
+        int numTrials,
+        double falsePositiveRate,
+        double falseNegativeRate,
+        quint64 seed,
+        QObject* parent = 0);
+
+    // Returns false if the run can't be started at all
+    bool start();
+
+signals:
+
+    void done();
+
+private:
+
+    // The standard normal quantile of a 95% interval
+    static const double INTERVAL_Z;
+
+    struct MazeTrials {
+        QString name;
+        WallGrid walls;
+        int numSolved;
+        int numFinished;
+        qint64 solvedMoves; // the sum, over the trials that were solved
+        double solvedSeconds; // likewise, of estimated seconds
+    };
+
+    QString m_algoName;
+    QStringList m_mazes;
+    int m_numJobs;
+    double m_timeLimitSeconds;
+    qint64 m_tickLimit;
+    qint64 m_commandLimit;
+    int m_moveLimit;
+    bool m_continuous;
+    int m_numTrials;
+    double m_falsePositiveRate;
+    double m_falseNegativeRate;
+    quint64 m_seed;
+
+    QStringList m_runArguments;
+    QString m_directory;
+    bool m_isPlugin;
+    QString m_libraryPath;
+
+    // Trials are numbered maze by maze, and started in order
+    QVector<MazeTrials> m_trials;
+    int m_nextTrial;
+    int m_numRunning;
+
+    void startNextRun();
+    void onRunFinished(QObject* run);
+    void recordResult(int maze, const RunResult& result);
+
+    // The stream of noise of the given trial of the given maze
+    static quint64 getStream(int maze, int trial);
+
+    // The bounds of the 95% Wilson score interval of a proportion
+    static void getInterval(
+        int numSuccesses,
+        int numTrials,
+        double* low,
+        double* high);
+
+    void printResults() const;
+};
+
+} 
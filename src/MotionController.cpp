@@ -0,0 +1,431 @@
+#include "MotionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtMath>
+
+#include "units/Distance.h"
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+
+namespace mms {
+
+MotionController::MotionController(const RunTimeParameters& parameters) :
+    m_parameters(parameters),
+    m_location({0, 0}),
+    m_direction(Direction::NORTH),
+    m_endLocation({0, 0}),
+    m_endDirection(Direction::NORTH) {
+    ASSERT_LT(0.0, m_parameters.maxSpeed);
+    ASSERT_LT(0.0, m_parameters.acceleration);
+    ASSERT_LE(0.0, m_parameters.turnSeconds);
+    ASSERT_LT(0.0, m_parameters.curveSpeed);
+    ASSERT_LE(m_parameters.curveSpeed, m_parameters.maxSpeed);
+}
+
+void MotionController::reset(QPair<int, int> location, Direction direction) {
+    m_location = location;
+    m_direction = direction;
+    m_endLocation = location;
+    m_endDirection = direction;
+    m_motions.clear();
+}
+
+bool MotionController::isValid(const MotionPrimitive& primitive) {
+    switch (primitive.type) {
+        case MotionPrimitive::STRAIGHT:
+            return 0 < primitive.cells && primitive.bend == 0;
+        case MotionPrimitive::TURN:
+        case MotionPrimitive::CURVE:
+            return (
+                primitive.cells == 0 &&
+                primitive.bend != 0 &&
+                qAbs(primitive.bend) <= 2
+            );
+        case MotionPrimitive::DIAGONAL:
+            return 0 < primitive.cells && qAbs(primitive.bend) == 1;
+        default:
+            return false;
+    }
+}
+
+void MotionController::push(const MotionPrimitive& primitive) {
+    ASSERT_TR(isValid(primitive));
+    m_motions.append(getMotion(
+        primitive,
+        m_endLocation,
+        m_endDirection,
+        &m_endLocation,
+        &m_endDirection
+    ));
+    plan();
+}
+
+int MotionController::getSize() const {
+    return m_motions.size();
+}
+
+const MotionPrimitive& MotionController::getPrimitive(int index) const {
+    return m_motions.at(index).primitive;
+}
+
+QPair<int, int> MotionController::getStartLocation() const {
+    return m_location;
+}
+
+Direction MotionController::getStartDirection() const {
+    return m_direction;
+}
+
+QPair<int, int> MotionController::getEndLocation() const {
+    return m_endLocation;
+}
+
+Direction MotionController::getEndDirection() const {
+    return m_endDirection;
+}
+
+double MotionController::getStartSeconds(int index) const {
+    return m_motions.at(index).startSeconds;
+}
+
+double MotionController::getSeconds() const {
+    if (m_motions.isEmpty()) {
+        return 0.0;
+    }
+    return m_motions.last().startSeconds + m_motions.last().seconds;
+}
+
+int MotionController::getIndex(double seconds) const {
+    if (m_motions.isEmpty()) {
+        return -1;
+    }
+
+    // The first primitive that starts after the time is the one after it
+    auto next = std::upper_bound(
+        m_motions.begin(),
+        m_motions.end(),
+        seconds,
+        [](double time, const Motion& motion) {
+            return time < motion.startSeconds;
+        }
+    );
+    return qMax(0, static_cast<int>(next - m_motions.begin()) - 1);
+}
+
+MotionPose MotionController::getPose(double seconds) const {
+    int index = getIndex(seconds);
+    if (index == -1) {
+        return {getCenterOfTile(m_location), DIRECTION_TO_ANGLE(m_direction)};
+    }
+    const Motion& motion = m_motions.at(index);
+    double elapsed = qBound(0.0, seconds - motion.startSeconds, motion.seconds);
+    if (motion.primitive.type != MotionPrimitive::TURN) {
+        return getPose(motion, getMeters(motion, elapsed));
+    }
+
+    // Turns speed up and slow down evenly, over half of the turn each
+    if (motion.seconds == 0.0) {
+        return getTurnPose(motion, 1.0);
+    }
+    double fraction = elapsed / motion.seconds;
+    if (fraction < 0.5) {
+        return getTurnPose(motion, 2.0 * fraction * fraction);
+    }
+    return getTurnPose(motion, 1.0 - 2.0 * (1.0 - fraction) * (1.0 - fraction));
+}
+
+MotionPose MotionController::getPose(int index, double fraction) const {
+    const Motion& motion = m_motions.at(index);
+    fraction = qBound(0.0, fraction, 1.0);
+    if (motion.primitive.type == MotionPrimitive::TURN) {
+        return getTurnPose(motion, fraction);
+    }
+    return getPose(motion, motion.length * fraction);
+}
+
+MotionController::Motion MotionController::getMotion(
+        const MotionPrimitive& primitive,
+        QPair<int, int> location,
+        Direction direction,
+        QPair<int, int>* endLocation,
+        Direction* endDirection) const {
+    Motion motion = {
+        primitive, location, direction, {}, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
+    };
+    double tileLength = Dimensions::tileLength().getMeters();
+    double heading = DIRECTION_TO_ANGLE(direction).getRadiansUnbounded();
+    Direction side = 0 < primitive.bend
+        ? DIRECTION_ROTATE_LEFT(direction)
+        : DIRECTION_ROTATE_RIGHT(direction);
+    int forward = 0;
+    int sideways = 0;
+    *endDirection = direction;
+
+    if (primitive.type == MotionPrimitive::STRAIGHT) {
+        addPiece(&motion, heading, primitive.cells * tileLength, 0.0);
+        motion.maxSpeed = m_parameters.maxSpeed;
+        forward = primitive.cells;
+    }
+    else if (primitive.type == MotionPrimitive::TURN) {
+        // Turns stay where they are, and only change direction below
+    }
+    else if (primitive.type == MotionPrimitive::CURVE) {
+        // Half a tile to the edge of the tile, an arc of half a tile around
+        // the corner, and half a tile to the center of the last tile
+        double radius = tileLength / 2.0;
+        double angle = M_PI / 2.0 * primitive.bend;
+        addPiece(&motion, heading, radius, 0.0);
+        addPiece(
+            &motion,
+            heading,
+            qAbs(angle) * radius,
+            (0 < angle ? 1.0 : -1.0) / radius);
+        addPiece(&motion, heading + angle, radius, 0.0);
+        motion.maxSpeed = m_parameters.curveSpeed;
+        forward = qAbs(primitive.bend) == 1 ? 1 : 0;
+        sideways = 1;
+        *endDirection = qAbs(primitive.bend) == 1
+            ? side
+            : DIRECTION_OPPOSITE(direction);
+    }
+    else if (primitive.type == MotionPrimitive::DIAGONAL) {
+        // The middles of the walls that a diagonal crosses are on a line,
+        // which the mouse cuts over to, and from, at the corners; a diagonal
+        // that enters a single tile is just a straight
+        int cells = primitive.cells;
+        forward = (cells + 1) / 2;
+        sideways = cells / 2;
+        *endDirection = cells % 2 == 0 ? side : direction;
+        motion.maxSpeed = m_parameters.maxSpeed;
+        if (cells == 1) {
+            addPiece(&motion, heading, tileLength, 0.0);
+        }
+        else {
+            double corner = M_PI / 4.0 * primitive.bend;
+            double last = cells % 2 == 0
+                ? heading + 2.0 * corner
+                : heading;
+            double diagonal = heading + corner;
+            addPiece(&motion, heading, tileLength / 2.0, 0.0, 0.0, corner);
+            addPiece(
+                &motion,
+                diagonal,
+                (cells - 1) * tileLength / M_SQRT2,
+                0.0);
+            addPiece(
+                &motion,
+                last,
+                tileLength / 2.0,
+                0.0,
+                diagonal - last,
+                0.0);
+        }
+    }
+    else {
+        ASSERT_NEVER_RUNS();
+    }
+
+    if (primitive.type == MotionPrimitive::TURN) {
+        *endDirection = direction;
+        for (int i = 0; i < qAbs(primitive.bend); i += 1) {
+            *endDirection = 0 < primitive.bend
+                ? DIRECTION_ROTATE_LEFT(*endDirection)
+                : DIRECTION_ROTATE_RIGHT(*endDirection);
+        }
+    }
+    *endLocation = {
+        location.first +
+            forward * DIRECTION_DX(direction) +
+            sideways * DIRECTION_DX(side),
+        location.second +
+            forward * DIRECTION_DY(direction) +
+            sideways * DIRECTION_DY(side),
+    };
+
+    // Every piece starts where the one before it ends
+    Coordinate start = getCenterOfTile(location);
+    double x = start.getX().getMeters();
+    double y = start.getY().getMeters();
+    for (Piece& piece : motion.pieces) {
+        piece.x = x;
+        piece.y = y;
+        double end = piece.heading + piece.curvature * piece.length;
+        if (piece.curvature == 0.0) {
+            x += piece.length * std::cos(piece.heading);
+            y += piece.length * std::sin(piece.heading);
+        }
+        else {
+            x += (std::sin(end) - std::sin(piece.heading)) / piece.curvature;
+            y -= (std::cos(end) - std::cos(piece.heading)) / piece.curvature;
+        }
+        motion.length += piece.length;
+    }
+    return motion;
+}
+
+void MotionController::addPiece(
+        Motion* motion,
+        double heading,
+        double length,
+        double curvature,
+        double startTwist,
+        double endTwist) {
+    motion->pieces.append(
+        {0.0, 0.0, heading, length, curvature, startTwist, endTwist}
+    );
+}
+
+void MotionController::plan() {
+    // The mouse is at rest at either end of the queue and around turns,
+    // goes from one straight to the next as fast as it can, and takes the
+    // corners of curves and diagonals at the curve speed
+    QVector<double> speeds(m_motions.size() + 1, 0.0);
+    for (int i = 1; i < m_motions.size(); i += 1) {
+        MotionPrimitive::Type before = m_motions.at(i - 1).primitive.type;
+        MotionPrimitive::Type after = m_motions.at(i).primitive.type;
+        if (before == MotionPrimitive::TURN || after == MotionPrimitive::TURN) {
+            speeds[i] = 0.0;
+        }
+        else if (
+            before == MotionPrimitive::STRAIGHT &&
+            after == MotionPrimitive::STRAIGHT
+        ) {
+            speeds[i] = m_parameters.maxSpeed;
+        }
+        else {
+            speeds[i] = m_parameters.curveSpeed;
+        }
+    }
+
+    // No primitive can change the speed by more than its length allows
+    double acceleration = m_parameters.acceleration;
+    for (int i = 0; i < m_motions.size(); i += 1) {
+        double reach = 2.0 * acceleration * m_motions.at(i).length;
+        speeds[i + 1] = qMin(
+            speeds.at(i + 1),
+            std::sqrt(speeds.at(i) * speeds.at(i) + reach));
+    }
+    for (int i = m_motions.size() - 1; 0 <= i; i -= 1) {
+        double reach = 2.0 * acceleration * m_motions.at(i).length;
+        speeds[i] = qMin(
+            speeds.at(i),
+            std::sqrt(speeds.at(i + 1) * speeds.at(i + 1) + reach));
+    }
+
+    double seconds = 0.0;
+    for (int i = 0; i < m_motions.size(); i += 1) {
+        Motion& motion = m_motions[i];
+        motion.startSpeed = speeds.at(i);
+        motion.endSpeed = speeds.at(i + 1);
+        setProfile(&motion);
+        motion.startSeconds = seconds;
+        seconds += motion.seconds;
+    }
+}
+
+void MotionController::setProfile(Motion* motion) const {
+    if (motion->primitive.type == MotionPrimitive::TURN) {
+        motion->topSpeed = 0.0;
+        motion->seconds =
+            m_parameters.turnSeconds * qAbs(motion->primitive.bend);
+        return;
+    }
+
+    // The top speed is where speeding up meets braking, if that's below the
+    // limit of the primitive; it's never below either end, since the ends
+    // were planned to be in reach of each other
+    double acceleration = m_parameters.acceleration;
+    double v0 = motion->startSpeed;
+    double v1 = motion->endSpeed;
+    double top = std::sqrt(
+        acceleration * motion->length + (v0 * v0 + v1 * v1) / 2.0);
+    top = qMax(qMax(v0, v1), qMin(top, motion->maxSpeed));
+    motion->topSpeed = top;
+    double rampLength = (2.0 * top * top - v0 * v0 - v1 * v1) /
+        (2.0 * acceleration);
+    motion->seconds =
+        (2.0 * top - v0 - v1) / acceleration +
+        qMax(0.0, motion->length - rampLength) / top;
+}
+
+double MotionController::getMeters(const Motion& motion, double seconds) const {
+    double acceleration = m_parameters.acceleration;
+    double v0 = motion.startSpeed;
+    double v1 = motion.endSpeed;
+    double top = motion.topSpeed;
+    double speedUpSeconds = (top - v0) / acceleration;
+    double speedUpLength = (top * top - v0 * v0) / (2.0 * acceleration);
+    double brakeLength = (top * top - v1 * v1) / (2.0 * acceleration);
+    double cruiseLength =
+        qMax(0.0, motion.length - speedUpLength - brakeLength);
+    double cruiseSeconds = cruiseLength / top;
+    if (seconds < speedUpSeconds) {
+        return v0 * seconds + acceleration * seconds * seconds / 2.0;
+    }
+    seconds -= speedUpSeconds;
+    if (seconds < cruiseSeconds) {
+        return speedUpLength + top * seconds;
+    }
+    seconds = qMin(seconds - cruiseSeconds, (top - v1) / acceleration);
+    return qMin(
+        motion.length,
+        speedUpLength + cruiseLength +
+            top * seconds - acceleration * seconds * seconds / 2.0);
+}
+
+MotionPose MotionController::getPose(
+        const Motion& motion,
+        double meters) const {
+    Piece piece = motion.pieces.last();
+    double along = piece.length;
+    for (const Piece& candidate : motion.pieces) {
+        if (meters <= candidate.length) {
+            piece = candidate;
+            along = qMax(0.0, meters);
+            break;
+        }
+        meters -= candidate.length;
+    }
+    double heading = piece.heading + piece.curvature * along;
+    double x = piece.x;
+    double y = piece.y;
+    if (piece.curvature == 0.0) {
+        x += along * std::cos(piece.heading);
+        y += along * std::sin(piece.heading);
+    }
+    else {
+        x += (std::sin(heading) - std::sin(piece.heading)) / piece.curvature;
+        y -= (std::cos(heading) - std::cos(piece.heading)) / piece.curvature;
+    }
+    double twist = piece.startTwist;
+    if (0.0 < piece.length) {
+        twist += (piece.endTwist - piece.startTwist) * along / piece.length;
+    }
+    return {
+        Coordinate::Cartesian(Distance::Meters(x), Distance::Meters(y)),
+        Angle::Radians(heading + twist)
+    };
+}
+
+MotionPose MotionController::getTurnPose(
+        const Motion& motion,
+        double fraction) {
+    Angle start = DIRECTION_TO_ANGLE(motion.direction);
+    return {
+        getCenterOfTile(motion.location),
+        start + Angle::Degrees(90) * (motion.primitive.bend * fraction)
+    };
+}
+
+Coordinate MotionController::getCenterOfTile(QPair<int, int> location) {
+    static const double tileLength = Dimensions::tileLength().getMeters();
+    return Coordinate::Cartesian(
+        Distance::Meters(tileLength * (location.first + 0.5)),
+        Distance::Meters(tileLength * (location.second + 0.5))
+    );
+}
+
+} 
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+#include "units/Angle.h"
+#include "units/Coordinate.h"
+
+#include "Direction.h"
+#include "RunTimeModel.h"
+
+namespace mms {
+
+// A single movement of the mouse on the grid, from the center of a tile to
+// the center of another (or the same) tile
+struct MotionPrimitive {
+    enum Type {
+        STRAIGHT,
+        TURN,
+        CURVE,
+        DIAGONAL,
+    };
+    Type type;
+    // The number of tiles entered by a straight or a diagonal
+    int cells;
+    // Which way a turn, a curve or a diagonal bends, counterclockwise: the
+    // quarter turns of a turn or a curve (one or two either way), and one
+    // (left) or minus one (right) for a diagonal
+    int bend;
+};
+
+// Where the mouse is and which way it faces, in meters, like the maze
+struct MotionPose {
+    Coordinate translation;
+    Angle rotation;
+};
+
+class MotionController {
+
+    // A queue of motion primitives, from a grid pose at which the mouse is
+    // at rest, each of which starts where the one before it ends. Straights
+    // drive along the tiles, curves and diagonals take the paths of the run
+    // time model (through the middles of the walls that they cross, with
+    // arcs of half a tile for curves), and turns spin in place. The queue is
+    // planned as a whole whenever it changes, within the limits of the run
+    // time parameters: the mouse speeds up and brakes at a constant
+    // acceleration, takes curves and the corners of diagonals at the curve
+    // speed, is at rest wherever it turns in place and at the end of the
+    // queue, and carries its speed from one primitive to the next otherwise.
+    // The pose of the mouse is then known in closed form at any time since
+    // the start of the queue, which is what drawing, pipelining moves and
+    // estimating the time of a path all need.
+
+public:
+
+    MotionController(
+        const RunTimeParameters& parameters =
+            RunTimeModel::DEFAULT_PARAMETERS());
+
+    // Empties the queue, with the mouse at rest in the center of the tile
+    void reset(QPair<int, int> location, Direction direction);
+
+    // Whether the primitive is one that can be queued: straights and
+    // diagonals enter at least one tile, turns and curves enter none, and
+    // bend by one or two quarter turns, and straights don't bend at all
+    static bool isValid(const MotionPrimitive& primitive);
+
+    // Queues the primitive, and plans the queue again, which only changes
+    // the profile of any primitive that used to end at rest before it
+    void push(const MotionPrimitive& primitive);
+
+    int getSize() const;
+    const MotionPrimitive& getPrimitive(int index) const;
+
+    // The grid pose at the start of the queue, and at the end of everything
+    // in it, which is exact
+    QPair<int, int> getStartLocation() const;
+    Direction getStartDirection() const;
+    QPair<int, int> getEndLocation() const;
+    Direction getEndDirection() const;
+
+    // When each primitive starts, and how long the whole queue takes
+    double getStartSeconds(int index) const;
+    double getSeconds() const;
+
+    // The primitive in progress at the given time, i.e., the last one once
+    // the queue is complete, or -1 if it's empty
+    int getIndex(double seconds) const;
+
+    // The pose at the given time since the start of the queue, clamped to
+    // its duration
+    MotionPose getPose(double seconds) const;
+
+    // The pose the given fraction of the way through a primitive (of its
+    // length, or of its angle for a turn), regardless of its profile, for
+    // whatever keeps time on its own
+    MotionPose getPose(int index, double fraction) const;
+
+private:
+
+    // A stretch of the path of a primitive, along which the heading changes
+    // at a constant rate per meter (none for a line), and the body turns
+    // evenly, relative to the heading, from one twist to the other, for the
+    // corners of diagonals; lengths are in meters and angles in radians
+    struct Piece {
+        double x;
+        double y;
+        double heading;
+        double length;
+        double curvature;
+        double startTwist;
+        double endTwist;
+    };
+
+    // A queued primitive, where it starts, its path, and its profile
+    struct Motion {
+        MotionPrimitive primitive;
+        QPair<int, int> location;
+        Direction direction;
+        QVector<Piece> pieces;
+        double length;
+        double maxSpeed;
+        double startSpeed;
+        double endSpeed;
+        double topSpeed;
+        double startSeconds;
+        double seconds;
+    };
+
+    RunTimeParameters m_parameters;
+    QPair<int, int> m_location;
+    Direction m_direction;
+    QPair<int, int> m_endLocation;
+    Direction m_endDirection;
+    QVector<Motion> m_motions;
+
+    // The path of a primitive, and where it ends up on the grid
+    Motion getMotion(
+        const MotionPrimitive& primitive,
+        QPair<int, int> location,
+        Direction direction,
+        QPair<int, int>* endLocation,
+        Direction* endDirection) const;
+    static void addPiece(
+        Motion* motion,
+        double heading,
+        double length,
+        double curvature,
+        double startTwist = 0.0,
+        double endTwist = 0.0);
+
+    // Sets the speeds at which the primitives start and end, going forward
+    // and then backward over the queue, then their profiles and times
+    void plan();
+    void setProfile(Motion* motion) const;
+
+    // How far along its path the mouse is, the given time into a primitive
+    double getMeters(const Motion& motion, double seconds) const;
+    MotionPose getPose(const Motion& motion, double meters) const;
+    static MotionPose getTurnPose(const Motion& motion, double fraction);
+    static Coordinate getCenterOfTile(QPair<int, int> location);
+
+};
+
+} 
@@ -0,0 +1,194 @@
+#include "MotionWorker.h"
+
+#include <QMutexLocker>
+#include <QtMath>
+
+#include "units/Distance.h"
+
+#include "Dimensions.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const int MotionWorker::TICK_MS = 1;
+const int MotionWorker::MAX_STEPS_PER_TICK = 100;
+
+MotionWorker::MotionWorker(
+        const WallGrid* walls,
+        const Polygon& body,
+        const QVector<SensorMount>& mounts) :
+    QObject(nullptr),
+    m_timer(new QTimer(this)),
+    m_dynamics(MouseDynamics()),
+    m_sensors(walls, mounts),
+    m_collisionDetector(walls),
+    m_body(body),
+    m_movement(-1),
+    m_startX(0.0),
+    m_startY(0.0),
+    m_startHeading(0.0),
+    m_isTurn(false),
+    m_amount(0.0),
+    m_readings(m_sensors.getCount(), 0.0),
+    m_contacts(QVector<Contact>()),
+    m_isPaused(false),
+    m_lastTimestamp(0.0),
+    m_owedSeconds(0.0),
+    m_publishedMovement(-1),
+    m_publishedFraction(0.0),
+    m_publishedReadings(QVector<double>()),
+    m_publishedContacts(QVector<Contact>()) {
+
+    // The timer is a child, so it moves to the worker's thread with it
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(TICK_MS);
+    connect(m_timer, &QTimer::timeout, this, &MotionWorker::tick);
+}
+
+void MotionWorker::startStraight(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        double meters) {
+    m_dynamics.startStraight(meters);
+    start(movement, x, y, heading, false, meters);
+}
+
+void MotionWorker::startTurn(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        double radians) {
+    m_dynamics.startTurn(radians);
+    start(movement, x, y, heading, true, radians);
+}
+
+void MotionWorker::setPaused(bool paused) {
+    m_isPaused = paused;
+    // Time spent paused isn't owed
+    m_lastTimestamp = SimUtilities::getHighResTimestamp();
+}
+
+void MotionWorker::stop() {
+    m_timer->stop();
+    m_movement = -1;
+    publish();
+}
+
+double MotionWorker::getFraction(int movement) const {
+    QMutexLocker locker(&m_mutex);
+    if (movement != m_publishedMovement) {
+        return 0.0;
+    }
+    return m_publishedFraction;
+}
+
+QVector<double> MotionWorker::getSensorReadings(int movement) const {
+    QMutexLocker locker(&m_mutex);
+    if (movement != m_publishedMovement) {
+        return QVector<double>();
+    }
+    return m_publishedReadings;
+}
+
+QVector<Contact> MotionWorker::getContacts(int movement) const {
+    QMutexLocker locker(&m_mutex);
+    if (movement != m_publishedMovement) {
+        return QVector<Contact>();
+    }
+    return m_publishedContacts;
+}
+
+void MotionWorker::start(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        bool isTurn,
+        double amount) {
+    m_movement = movement;
+    m_startX = x;
+    m_startY = y;
+    m_startHeading = heading;
+    m_isTurn = isTurn;
+    m_amount = amount;
+    sense();
+    m_lastTimestamp = SimUtilities::getHighResTimestamp();
+    m_owedSeconds = 0.0;
+    publish();
+    m_timer->start();
+}
+
+void MotionWorker::tick() {
+    double now = SimUtilities::getHighResTimestamp();
+    double elapsed = now - m_lastTimestamp;
+    m_lastTimestamp = now;
+    if (m_isPaused) {
+        return;
+    }
+
+    // Take every timestep that's owed, carrying over the remainder
+    m_owedSeconds += elapsed;
+    int steps = static_cast<int>(
+        m_owedSeconds / MouseDynamics::TIMESTEP_SECONDS
+    );
+    if (MAX_STEPS_PER_TICK < steps) {
+        steps = MAX_STEPS_PER_TICK;
+        m_owedSeconds = steps * MouseDynamics::TIMESTEP_SECONDS;
+    }
+    m_owedSeconds -= steps * MouseDynamics::TIMESTEP_SECONDS;
+    bool isDone = m_dynamics.isDone();
+    for (int i = 0; i < steps && !isDone; i += 1) {
+        isDone = m_dynamics.step();
+        sense();
+    }
+    publish();
+
+    if (isDone) {
+        m_timer->stop();
+        emit movementCompleted(m_movement, m_dynamics.getElapsedSeconds());
+    }
+}
+
+void MotionWorker::sense() {
+    // The mouse only ever moves along its heading, or turns in place
+    double traveled = m_dynamics.getFraction() * m_amount;
+    double x = m_startX;
+    double y = m_startY;
+    double heading = m_startHeading;
+    if (m_isTurn) {
+        heading += traveled;
+    }
+    else {
+        x += traveled * qCos(heading);
+        y += traveled * qSin(heading);
+    }
+    m_sensors.read(x, y, heading, m_readings.data());
+
+    // The mouse is only ever near the walls of the tile that it's in
+    Coordinate translation = Coordinate::Cartesian(
+        Distance::Meters(x),
+        Distance::Meters(y)
+    );
+    double tileLength = Dimensions::tileLength().getMeters();
+    QPair<int, int> tile = {
+        static_cast<int>(qFloor(x / tileLength)),
+        static_cast<int>(qFloor(y / tileLength))
+    };
+    m_contacts = m_collisionDetector.check(
+        m_body.transform(translation, Angle::Radians(heading), translation),
+        tile
+    );
+}
+
+void MotionWorker::publish() {
+    QMutexLocker locker(&m_mutex);
+    m_publishedMovement = m_movement;
+    m_publishedFraction = m_dynamics.getFraction();
+    m_publishedReadings = m_readings;
+    m_publishedContacts = m_contacts;
+}
+
+} 
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "CollisionDetector.h"
+#include "DistanceSensors.h"
+#include "MouseDynamics.h"
+#include "Polygon.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+class MotionWorker : public QObject {
+
+    // Steps the dynamics of the mouse in real time, on a thread of its own,
+    // so that the physics keeps its fixed timestep no matter how often the
+    // mouse is drawn. Every tick of its timer, it takes as many timesteps as
+    // real time has passed (up to MAX_STEPS_PER_TICK, beyond which the
+    // simulation is slowed down rather than allowed to fall behind forever).
+    // Movements are numbered by whoever starts them, so that progress of a
+    // movement that's since been abandoned is never mistaken for progress of
+    // the current one. The distance sensors are read, all at once, and the
+    // body is tested against the nearby walls, after every timestep.
+
+    Q_OBJECT
+
+public:
+
+    // No ownership of the walls, which mustn't change while the worker runs;
+    // the body is centered on the origin, facing east
+    MotionWorker(
+        const WallGrid* walls,
+        const Polygon& body,
+        const QVector<SensorMount>& mounts);
+
+    // To be invoked on the worker's thread (e.g., with a queued connection);
+    // movements start from the given pose, in meters and radians
+    Q_INVOKABLE void startStraight(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        double meters);
+    Q_INVOKABLE void startTurn(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        double radians);
+    Q_INVOKABLE void setPaused(bool paused);
+    Q_INVOKABLE void stop();
+
+    // How much of the given movement is complete, from zero to one; zero if
+    // the movement hasn't started yet. May be called from any thread.
+    double getFraction(int movement) const;
+
+    // The latest reading of every sensor, during the given movement; empty
+    // if the movement hasn't started yet. May be called from any thread.
+    QVector<double> getSensorReadings(int movement) const;
+
+    // Where the body overlapped the walls, as of the latest timestep of the
+    // given movement; empty if it didn't, or if the movement hasn't started
+    // yet. May be called from any thread.
+    QVector<Contact> getContacts(int movement) const;
+
+signals:
+
+    // Emitted with the simulated time that the movement took
+    void movementCompleted(int movement, double seconds);
+
+private:
+
+    static const int TICK_MS;
+    static const int MAX_STEPS_PER_TICK;
+
+    QTimer* m_timer;
+    MouseDynamics m_dynamics;
+    DistanceSensors m_sensors;
+    CollisionDetector m_collisionDetector;
+    Polygon m_body;
+    int m_movement;
+
+    // The pose at the start of the movement, and how far it goes
+    double m_startX;
+    double m_startY;
+    double m_startHeading;
+    bool m_isTurn;
+    double m_amount;
+    QVector<double> m_readings;
+    QVector<Contact> m_contacts;
+
+    bool m_isPaused;
+    double m_lastTimestamp;
+    double m_owedSeconds;
+
+    // The progress that other threads can see
+    mutable QMutex m_mutex;
+    int m_publishedMovement;
+    double m_publishedFraction;
+    QVector<double> m_publishedReadings;
+    QVector<Contact> m_publishedContacts;
+
+    void start(
+        int movement,
+        double x,
+        double y,
+        double heading,
+        bool isTurn,
+        double amount);
+    void sense();
+    void tick();
+    void publish();
+};
+
+} 
@@ -5,103 +5,117 @@
 #include <QVector>
 #include <QtMath>
 
-#include "units/Distance.h"
-
 #include "AssertMacros.h"
-#include "Dimensions.h"
-#include "GeometryUtilities.h"
+#include "SimUtilities.h"
 
 namespace mms {
 
-Mouse::Mouse() {
+Mouse::Mouse(std::shared_ptr<const MouseDefinition> definition) :
+    m_location({0, 0}),
+    m_direction(Direction::NORTH),
+    m_motion(MotionController()),
+    m_fraction(0.0),
+    m_fractionPerSecond(0.0),
+    m_animationTimestamp(0.0) {
 
     // The initial translation of the mouse is just the center of the starting tile
-    Distance halfOfTileDistance = Dimensions::halfTileLength();
-    m_initialTranslation = Coordinate::Cartesian(halfOfTileDistance, halfOfTileDistance);
-    m_currentTranslation = m_initialTranslation;
+    m_initialTranslation = m_motion.getPose(0.0).translation;
 
     // The initial rotation of the mouse is determined by the starting tile walls
-    m_initialRotation = DIRECTION_TO_ANGLE().value(Direction::NORTH);
-    m_currentRotation = m_initialRotation;
-
-    // Initialize the body, wheels, and sensors, such that they have the
-    // correct initial translation and rotation
-    QVector<Coordinate> bodyVertices = {
-        Coordinate::Cartesian(Distance::Meters(0.00), Distance::Meters(0.00)),
-        Coordinate::Cartesian(Distance::Meters(0.00), Distance::Meters(0.06)),
-        Coordinate::Cartesian(Distance::Meters(0.03), Distance::Meters(0.09)),
-        Coordinate::Cartesian(Distance::Meters(0.06), Distance::Meters(0.06)),
-        Coordinate::Cartesian(Distance::Meters(0.06), Distance::Meters(0.00)),
-    };
-    Coordinate centerOfMass = Coordinate::Cartesian(
-        Distance::Meters(0.06),
-        Distance::Meters(0.06)
-    );
-    for (int i = 0; i < bodyVertices.size(); i += 1) {
-        bodyVertices[i] = GeometryUtilities::translateVertex(
-            bodyVertices.at(i),
-            centerOfMass
-        );
-    }
-    m_initialBodyPolygon = Polygon(bodyVertices);
-
-    // Initialize the wheel polygon
-    QVector<Coordinate> wheelVertices = {
-        Coordinate::Cartesian(Distance::Meters(-0.005), Distance::Meters(0.01)),
-        Coordinate::Cartesian(Distance::Meters(-0.005), Distance::Meters(0.05)),
-        Coordinate::Cartesian(Distance::Meters(0.065), Distance::Meters(0.05)),
-        Coordinate::Cartesian(Distance::Meters(0.065), Distance::Meters(0.01)),
-    };
-    for (int i = 0; i < wheelVertices.size(); i += 1) {
-        wheelVertices[i] = GeometryUtilities::translateVertex(
-            wheelVertices.at(i),
-            centerOfMass
-        );
-    }
-    m_initialWheelPolygon = Polygon(wheelVertices);
+    m_initialRotation = DIRECTION_TO_ANGLE(m_direction);
+
+    setDefinition(definition);
+}
 
-    // Force triangulation of the drawable polygons, thus ensuring
-    // that we only triangulate once, at the beginning of execution
-    m_initialBodyPolygon.getTriangles();
-    m_initialWheelPolygon.getTriangles();
+void Mouse::setDefinition(std::shared_ptr<const MouseDefinition> definition) {
+    // The definition's polygons are already triangulated, at the initial
+    // translation and rotation, and copying them keeps their triangles
+    m_definition = definition;
+    m_initialBodyPolygon = m_definition->getBodyPolygon();
+    m_initialWheelPolygon = m_definition->getWheelPolygon();
+}
+
+const MouseDefinition* Mouse::getDefinition() const {
+    return m_definition.get();
 }
 
 void Mouse::reset() {
-    teleport(
-        m_initialTranslation,
-        DIRECTION_TO_ANGLE().value(Direction::NORTH)
-    );
+    teleport({0, 0}, Direction::NORTH);
+}
+
+void Mouse::teleport(QPair<int, int> location, Direction direction) {
+    m_location = location;
+    m_direction = direction;
+    m_motion.reset(location, direction);
+    m_fraction = 0.0;
+    m_fractionPerSecond = 0.0;
+}
+
+void Mouse::setMovement(const MotionPrimitive& primitive, double fraction) {
+    m_motion.reset(m_location, m_direction);
+    m_motion.push(primitive);
+    m_fraction = fraction;
+    m_fractionPerSecond = 0.0;
+}
+
+void Mouse::animate(double fractionPerSecond) {
+    ASSERT_LE(0.0, fractionPerSecond);
+    m_fraction = getFraction();
+    m_fractionPerSecond = fractionPerSecond;
+    m_animationTimestamp = SimUtilities::getHighResTimestamp();
+}
+
+bool Mouse::isAnimating() const {
+    return m_fractionPerSecond != 0.0 && getFraction() < 1.0;
+}
+
+const MotionController& Mouse::getMotion() const {
+    return m_motion;
+}
+
+QPair<int, int> Mouse::getDestination() const {
+    return m_motion.getEndLocation();
+}
+
+Direction Mouse::getDestinationDirection() const {
+    return m_motion.getEndDirection();
 }
 
-void Mouse::teleport(const Coordinate& translation, const Angle& rotation) {
-    m_currentTranslation = translation;
-    m_currentRotation = rotation;
+double Mouse::getFraction() const {
+    if (m_fractionPerSecond == 0.0) {
+        return m_fraction;
+    }
+    double elapsed =
+        SimUtilities::getHighResTimestamp() - m_animationTimestamp;
+    return qMin(1.0, m_fraction + elapsed * m_fractionPerSecond);
+}
+
+double Mouse::getFractionPerSecond() const {
+    return m_fractionPerSecond;
 }
 
 QPair<int, int> Mouse::getCurrentDiscretizedTranslation() const {
-    static Distance tileLength = Dimensions::tileLength();
-    int x = static_cast<int>(qFloor(m_currentTranslation.getX() / tileLength));
-    int y = static_cast<int>(qFloor(m_currentTranslation.getY() / tileLength));
-    return {x, y};
+    return m_location;
 }
 
 Direction Mouse::getCurrentDiscretizedRotation() const {
-    int dir = static_cast<int>(qFloor(
-        (m_currentRotation + Angle::Degrees(45)).getRadiansZeroTo2pi() /
-        Angle::Degrees(90).getRadiansZeroTo2pi()
-    ));
-    switch (dir) {
-        case 0:
-            return Direction::EAST;
-        case 1:
-            return Direction::NORTH;
-        case 2:
-            return Direction::WEST;
-        case 3:
-            return Direction::SOUTH;
-        default:
-            ASSERT_NEVER_RUNS();
-    }
+    return m_direction;
+}
+
+Coordinate Mouse::getInitialTranslation() const {
+    return m_initialTranslation;
+}
+
+Angle Mouse::getInitialRotation() const {
+    return m_initialRotation;
+}
+
+Coordinate Mouse::getCurrentTranslation() const {
+    return getCurrentPose().translation;
+}
+
+Angle Mouse::getCurrentRotation() const {
+    return getCurrentPose().rotation;
 }
 
 Polygon Mouse::getCurrentBodyPolygon() const {
@@ -112,12 +126,27 @@ Polygon Mouse::getCurrentWheelPolygon() const {
     return getCurrentPolygon(m_initialWheelPolygon);
 }
 
+Polygon Mouse::getInitialBodyPolygon() const {
+    return m_initialBodyPolygon;
+}
+
+Polygon Mouse::getInitialWheelPolygon() const {
+    return m_initialWheelPolygon;
+}
+
 Polygon Mouse::getCurrentPolygon(const Polygon& initialPolygon) const {
-    return initialPolygon
-        .translate(m_currentTranslation - m_initialTranslation)
-        .rotateAroundPoint(
-            m_currentRotation - m_initialRotation,
-            m_currentTranslation);
+    MotionPose pose = getCurrentPose();
+    return initialPolygon.transform(
+        pose.translation - m_initialTranslation,
+        pose.rotation - m_initialRotation,
+        pose.translation);
+}
+
+MotionPose Mouse::getCurrentPose() const {
+    if (m_motion.getSize() == 0) {
+        return m_motion.getPose(0.0);
+    }
+    return m_motion.getPose(0, getFraction());
 }
 
 } 
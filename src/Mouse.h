@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include <QMap>
 #include <QMutex>
 #include <QPair>
@@ -10,6 +12,8 @@
 
 #include "Direction.h"
 #include "Maze.h"
+#include "MotionController.h"
+#include "MouseDefinition.h"
 #include "Polygon.h"
 
 namespace mms {
@@ -18,31 +22,80 @@ class Mouse {
 
 public:
 
-    Mouse();
+    Mouse(
+        std::shared_ptr<const MouseDefinition> definition =
+            MouseDefinition::getDefault());
+
+    // The shape of the mouse, and its sensors, which are shared with every
+    // other mouse of the same definition
+    void setDefinition(std::shared_ptr<const MouseDefinition> definition);
+    const MouseDefinition* getDefinition() const;
 
     // Resets the mouse to the beginning of the maze
     void reset();
 
-    // Sets the current translation and rotation of the mouse
-    void teleport(const Coordinate& translation, const Angle& rotation);
+    // Places the mouse, at rest, in the center of the given tile
+    void teleport(QPair<int, int> location, Direction direction);
+
+    // Sets the movement in progress, from the mouse's grid pose, and the
+    // fraction of it that's complete (of its length, or of its angle for a
+    // turn); the movement follows the path of its motion primitive
+    void setMovement(const MotionPrimitive& primitive, double fraction);
+
+    // Keeps the movement in progress going, from its fraction as of now, at
+    // the given fraction of the way per second, until it's complete; the
+    // fraction is computed from the time whenever the pose is asked for, so
+    // that the mouse moves smoothly however rarely it's updated
+    void animate(double fractionPerSecond);
+    bool isAnimating() const;
 
-    // Gets the current discretized translation and rotation of the mouse
+    // The movement in progress, as of now, e.g., to hand it on to a mouse
+    // that mirrors this one; the motion holds the movement's primitive, if
+    // there is one, and the grid pose that it ends at
+    const MotionController& getMotion() const;
+    QPair<int, int> getDestination() const;
+    Direction getDestinationDirection() const;
+    double getFraction() const;
+    double getFractionPerSecond() const;
+
+    // Gets the grid pose of the mouse, which is exact, and which only changes
+    // once a movement completes
     QPair<int, int> getCurrentDiscretizedTranslation() const;
     Direction getCurrentDiscretizedRotation() const;
 
+    // Gets the exact translation and rotation of the mouse, both initially
+    // and currently; the current pose is computed from the grid pose and the
+    // movement in progress, only when it's asked for (i.e., when drawing)
+    Coordinate getInitialTranslation() const;
+    Angle getInitialRotation() const;
+    Coordinate getCurrentTranslation() const;
+    Angle getCurrentRotation() const;
+
     // Retrieves the polygon of just the body of the mouse
     Polygon getCurrentBodyPolygon() const;
     Polygon getCurrentWheelPolygon() const;
 
+    // Retrieves the same polygons, at the initial translation and rotation
+    Polygon getInitialBodyPolygon() const;
+    Polygon getInitialWheelPolygon() const;
+
 private:
 
-    // The translation and rotation of the mouse
+    // The initial translation and rotation of the mouse
     Coordinate m_initialTranslation;
-    Coordinate m_currentTranslation;
     Angle m_initialRotation;
-    Angle m_currentRotation;
+
+    // The grid pose of the mouse, and the movement in progress
+    QPair<int, int> m_location;
+    Direction m_direction;
+    MotionController m_motion;
+    double m_fraction;
+    double m_fractionPerSecond;
+    double m_animationTimestamp;
+    MotionPose getCurrentPose() const;
 
     // The parts of the mouse at the starting location
+    std::shared_ptr<const MouseDefinition> m_definition;
     Polygon m_initialBodyPolygon;
     Polygon m_initialWheelPolygon;
     Polygon getCurrentPolygon(const Polygon& initialPolygon) const;
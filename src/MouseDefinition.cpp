@@ -0,0 +1,361 @@
+#include "MouseDefinition.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QCryptographicHash>
+#include <QDomDocument>
+#include <QFile>
+#include <QMutexLocker>
+#include <QtMath>
+
+#include "units/Distance.h"
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+
+namespace mms {
+
+QMutex MouseDefinition::CACHE_MUTEX;
+QHash<QByteArray, std::shared_ptr<const MouseDefinition>>
+    MouseDefinition::CACHE;
+
+std::shared_ptr<const MouseDefinition> MouseDefinition::getDefault() {
+    static const std::shared_ptr<const MouseDefinition> definition = [](){
+        QString error;
+        std::shared_ptr<const MouseDefinition> loaded =
+            load(":/resources/mice/default.xml", &error);
+        ASSERT_TR(loaded != nullptr);
+        return loaded;
+    }();
+    return definition;
+}
+
+std::shared_ptr<const MouseDefinition> MouseDefinition::load(
+        const QString& path,
+        QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return nullptr;
+    }
+    QByteArray bytes = file.readAll();
+    QByteArray hash = QCryptographicHash::hash(
+        bytes,
+        QCryptographicHash::Sha1
+    );
+    {
+        QMutexLocker locker(&CACHE_MUTEX);
+        auto it = CACHE.constFind(hash);
+        if (it != CACHE.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // Parsing happens outside of the lock; if another thread parsed the same
+    // file in the meantime, its copy is kept, so that there's only ever one
+    std::shared_ptr<const MouseDefinition> definition(
+        parse(bytes, hash, error));
+    if (definition == nullptr) {
+        return nullptr;
+    }
+    QMutexLocker locker(&CACHE_MUTEX);
+    auto it = CACHE.constFind(hash);
+    if (it != CACHE.constEnd()) {
+        return it.value();
+    }
+    CACHE.insert(hash, definition);
+    return definition;
+}
+
+QByteArray MouseDefinition::getHash() const {
+    return m_hash;
+}
+
+const Polygon& MouseDefinition::getBodyPolygon() const {
+    return m_body;
+}
+
+const Polygon& MouseDefinition::getWheelPolygon() const {
+    return m_wheel;
+}
+
+const Polygon& MouseDefinition::getCollisionHull() const {
+    return m_hull;
+}
+
+const QVector<SensorMount>& MouseDefinition::getSensorMounts() const {
+    return m_mounts;
+}
+
+MouseDefinition::MouseDefinition(
+        const QByteArray& hash,
+        const Polygon& body,
+        const Polygon& wheel,
+        const Polygon& hull,
+        const QVector<SensorMount>& mounts) :
+    m_hash(hash),
+    m_body(body),
+    m_wheel(wheel),
+    m_hull(hull),
+    m_mounts(mounts) {
+}
+
+MouseDefinition* MouseDefinition::parse(
+        const QByteArray& bytes,
+        const QByteArray& hash,
+        QString* error) {
+    QDomDocument document;
+    QString message;
+    int line = 0;
+    if (!document.setContent(bytes, &message, &line)) {
+        *error = QString("Invalid XML on line %1: %2").arg(line).arg(message);
+        return nullptr;
+    }
+    QDomElement root = document.documentElement();
+    if (root.tagName() != "Mouse") {
+        *error = "Not a mouse, which is a \"Mouse\" element";
+        return nullptr;
+    }
+    Frame frame = {0.0, 0.0, 0.0};
+    double forward = 0.0;
+    if (
+        !readNumber(root, "Forward-Direction", &forward, error) ||
+        !readPoint(root, "Center-Of-Mass", &frame.x, &frame.y, error)
+    ) {
+        return nullptr;
+    }
+    frame.forward = qDegreesToRadians(forward);
+
+    // The body has to be a simple polygon, which triangulates
+    QVector<Coordinate> body;
+    QVector<Coordinate> ownBody;
+    QDomElement bodyElement = root.firstChildElement("Body");
+    for (
+        QDomElement vertex = bodyElement.firstChildElement("Vertex");
+        !vertex.isNull();
+        vertex = vertex.nextSiblingElement("Vertex")
+    ) {
+        double x = 0.0;
+        double y = 0.0;
+        if (
+            !readNumber(vertex, "X", &x, error) ||
+            !readNumber(vertex, "Y", &y, error)
+        ) {
+            return nullptr;
+        }
+        ownBody.append(toOwnFrame(frame, x, y));
+        body.append(toInitialPose(ownBody.last()));
+    }
+    QVector<Coordinate> hull = getConvexHull(ownBody);
+    if (hull.size() < 3) {
+        *error = "The \"Body\" needs at least three vertices, not in a line";
+        return nullptr;
+    }
+    Polygon bodyPolygon(body);
+    if (bodyPolygon.getTriangles().isEmpty()) {
+        *error = "The vertices of the \"Body\" aren't a simple polygon";
+        return nullptr;
+    }
+
+    // Each wheel is a rectangle of its diameter along its direction, and of
+    // its width across it, and they're drawn as the rectangle that spans them
+    double minX = 0.0;
+    double minY = 0.0;
+    double maxX = 0.0;
+    double maxY = 0.0;
+    int numWheels = 0;
+    for (
+        QDomElement wheel = root.firstChildElement("Wheel");
+        !wheel.isNull();
+        wheel = wheel.nextSiblingElement("Wheel")
+    ) {
+        double diameter = 0.0;
+        double width = 0.0;
+        double x = 0.0;
+        double y = 0.0;
+        double direction = 0.0;
+        if (
+            !readNumber(wheel, "Diameter", &diameter, error) ||
+            !readNumber(wheel, "Width", &width, error) ||
+            !readPoint(wheel, "Position", &x, &y, error) ||
+            !readNumber(wheel, "Direction", &direction, error)
+        ) {
+            return nullptr;
+        }
+        if (diameter <= 0.0 || width <= 0.0) {
+            *error = "Every \"Wheel\" needs a positive diameter and width";
+            return nullptr;
+        }
+        double radians = qDegreesToRadians(direction);
+        double alongX = std::cos(radians) * diameter / 2.0;
+        double alongY = std::sin(radians) * diameter / 2.0;
+        double acrossX = -std::sin(radians) * width / 2.0;
+        double acrossY = std::cos(radians) * width / 2.0;
+        for (int i = 0; i < 4; i += 1) {
+            double along = i < 2 ? 1.0 : -1.0;
+            double across = i % 2 == 0 ? 1.0 : -1.0;
+            Coordinate corner = toOwnFrame(
+                frame,
+                x + along * alongX + across * acrossX,
+                y + along * alongY + across * acrossY
+            );
+            double cornerX = corner.getX().getMeters();
+            double cornerY = corner.getY().getMeters();
+            bool isFirst = numWheels == 0 && i == 0;
+            minX = isFirst ? cornerX : qMin(minX, cornerX);
+            minY = isFirst ? cornerY : qMin(minY, cornerY);
+            maxX = isFirst ? cornerX : qMax(maxX, cornerX);
+            maxY = isFirst ? cornerY : qMax(maxY, cornerY);
+        }
+        numWheels += 1;
+    }
+    if (numWheels == 0) {
+        *error = "The mouse needs at least one \"Wheel\"";
+        return nullptr;
+    }
+    QVector<Coordinate> wheel;
+    for (QPair<double, double> corner : QVector<QPair<double, double>>{
+        {minX, minY}, {maxX, minY}, {maxX, maxY}, {minX, maxY}
+    }) {
+        wheel.append(toInitialPose(Coordinate::Cartesian(
+            Distance::Meters(corner.first),
+            Distance::Meters(corner.second)
+        )));
+    }
+
+    QVector<SensorMount> mounts;
+    for (
+        QDomElement sensor = root.firstChildElement("Sensor");
+        !sensor.isNull();
+        sensor = sensor.nextSiblingElement("Sensor")
+    ) {
+        double range = 0.0;
+        double x = 0.0;
+        double y = 0.0;
+        double direction = 0.0;
+        if (
+            !readNumber(sensor, "Range", &range, error) ||
+            !readPoint(sensor, "Position", &x, &y, error) ||
+            !readNumber(sensor, "Direction", &direction, error)
+        ) {
+            return nullptr;
+        }
+        if (range <= 0.0) {
+            *error = "Every \"Sensor\" needs a positive range";
+            return nullptr;
+        }
+        Coordinate position = toOwnFrame(frame, x, y);
+        mounts.append({
+            position.getX().getMeters(),
+            position.getY().getMeters(),
+            qDegreesToRadians(direction) - frame.forward,
+            range
+        });
+    }
+    if (mounts.isEmpty()) {
+        mounts = DistanceSensors::DEFAULT_MOUNTS();
+    }
+
+    // Everything is triangulated up front, since a shared definition can't
+    // be triangulated lazily from several threads at once
+    Polygon wheelPolygon(wheel);
+    Polygon hullPolygon(hull);
+    wheelPolygon.getTriangles();
+    hullPolygon.getTriangles();
+    return new MouseDefinition(
+        hash,
+        bodyPolygon,
+        wheelPolygon,
+        hullPolygon,
+        mounts
+    );
+}
+
+Coordinate MouseDefinition::toOwnFrame(const Frame& frame, double x, double y) {
+    double dx = x - frame.x;
+    double dy = y - frame.y;
+    double cosine = std::cos(frame.forward);
+    double sine = std::sin(frame.forward);
+    return Coordinate::Cartesian(
+        Distance::Meters(dx * cosine + dy * sine),
+        Distance::Meters(dy * cosine - dx * sine)
+    );
+}
+
+Coordinate MouseDefinition::toInitialPose(const Coordinate& point) {
+    // Facing north, i.e., a quarter turn counterclockwise from east
+    double center = Dimensions::halfTileLength().getMeters();
+    return Coordinate::Cartesian(
+        Distance::Meters(center - point.getY().getMeters()),
+        Distance::Meters(center + point.getX().getMeters())
+    );
+}
+
+bool MouseDefinition::readNumber(
+        const QDomElement& parent,
+        const QString& tag,
+        double* value,
+        QString* error) {
+    bool ok = false;
+    *value = parent.firstChildElement(tag).text().trimmed().toDouble(&ok);
+    if (!ok || !std::isfinite(*value)) {
+        *error = QString("Missing or invalid \"%1\" in \"%2\"").arg(
+            tag, parent.tagName());
+        return false;
+    }
+    return true;
+}
+
+bool MouseDefinition::readPoint(
+        const QDomElement& parent,
+        const QString& tag,
+        double* x,
+        double* y,
+        QString* error) {
+    QDomElement point = parent.firstChildElement(tag);
+    if (point.isNull()) {
+        *error = QString("Missing \"%1\" in \"%2\"").arg(
+            tag, parent.tagName());
+        return false;
+    }
+    return readNumber(point, "X", x, error) && readNumber(point, "Y", y, error);
+}
+
+QVector<Coordinate> MouseDefinition::getConvexHull(QVector<Coordinate> points) {
+    auto cross = [](
+            const Coordinate& o,
+            const Coordinate& a,
+            const Coordinate& b) {
+        return
+            (a.getX() - o.getX()).getMeters() *
+                (b.getY() - o.getY()).getMeters() -
+            (a.getY() - o.getY()).getMeters() *
+                (b.getX() - o.getX()).getMeters();
+    };
+    std::sort(points.begin(), points.end());
+    if (points.size() < 3) {
+        return points;
+    }
+
+    // The lower hull, left to right, and then the upper hull, right to left
+    QVector<Coordinate> hull;
+    for (int pass = 0; pass < 2; pass += 1) {
+        int start = hull.size();
+        for (int i = 0; i < points.size(); i += 1) {
+            const Coordinate& point =
+                points.at(pass == 0 ? i : points.size() - 1 - i);
+            while (
+                start + 2 <= hull.size() &&
+                cross(hull.at(hull.size() - 2), hull.last(), point) <= 0.0
+            ) {
+                hull.removeLast();
+            }
+            hull.append(point);
+        }
+        hull.removeLast();
+    }
+    return hull;
+}
+
+} 
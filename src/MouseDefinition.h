@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QDomElement>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "units/Coordinate.h"
+
+#include "DistanceSensors.h"
+#include "Polygon.h"
+
+namespace mms {
+
+class MouseDefinition {
+
+    // The shape of a mouse, and where its sensors are, as read from a mouse
+    // file in the format of older versions of the simulator: a forward
+    // direction, a center of mass, the vertices of the body, and the wheels
+    // and sensors, in any frame. Everything that's derived from the file is
+    // worked out once, when it's parsed: the polygons are triangulated, the
+    // collision hull is built, and the sensors are turned into mounts, so
+    // that a definition is immutable from then on. Definitions are cached on
+    // the SHA-1 of the file's contents, and shared, so that any number of
+    // runs, on any number of threads, use a single copy of each mouse, however
+    // many times (and from wherever) it's loaded; the cache is never evicted,
+    // since a definition is only a few hundred bytes.
+
+public:
+
+    // The mouse of the simulator, from resources/mice/default.xml
+    static std::shared_ptr<const MouseDefinition> getDefault();
+
+    // Returns nullptr, and sets the error, if the file can't be read or
+    // isn't a valid mouse; safe to call from any thread
+    static std::shared_ptr<const MouseDefinition> load(
+        const QString& path,
+        QString* error);
+
+    // The SHA-1 of the file that the definition was parsed from
+    QByteArray getHash() const;
+
+    // The body, and the rectangle that spans the wheels (which is drawn
+    // underneath it), at the initial pose of the mouse: at the center of
+    // the starting tile, facing north
+    const Polygon& getBodyPolygon() const;
+    const Polygon& getWheelPolygon() const;
+
+    // The convex hull of the body, in the mouse's own frame (centered on the
+    // origin and facing east), as walls are checked against it
+    const Polygon& getCollisionHull() const;
+
+    // Where the rays of the sensors start, and which way they point; the
+    // defaults of the distance sensors if the file has none
+    const QVector<SensorMount>& getSensorMounts() const;
+
+private:
+
+    MouseDefinition(
+        const QByteArray& hash,
+        const Polygon& body,
+        const Polygon& wheel,
+        const Polygon& hull,
+        const QVector<SensorMount>& mounts);
+
+    QByteArray m_hash;
+    Polygon m_body;
+    Polygon m_wheel;
+    Polygon m_hull;
+    QVector<SensorMount> m_mounts;
+
+    static QMutex CACHE_MUTEX;
+    static QHash<QByteArray, std::shared_ptr<const MouseDefinition>> CACHE;
+
+    static MouseDefinition* parse(
+        const QByteArray& bytes,
+        const QByteArray& hash,
+        QString* error);
+
+    // The frame of the file, in which the mouse faces the forward direction
+    // (in radians) from its center of mass
+    struct Frame {
+        double x;
+        double y;
+        double forward;
+    };
+
+    // Converts a point from the frame of the file to the mouse's own frame,
+    // and from that to the initial pose of the mouse
+    static Coordinate toOwnFrame(const Frame& frame, double x, double y);
+    static Coordinate toInitialPose(const Coordinate& point);
+
+    // Each returns false, and sets the error, if the tag is missing, or
+    // isn't a number (or a point, with numbers as its "X" and "Y")
+    static bool readNumber(
+        const QDomElement& parent,
+        const QString& tag,
+        double* value,
+        QString* error);
+    static bool readPoint(
+        const QDomElement& parent,
+        const QString& tag,
+        double* x,
+        double* y,
+        QString* error);
+
+    // Counterclockwise, without any collinear points (monotone chain)
+    static QVector<Coordinate> getConvexHull(QVector<Coordinate> points);
+
+};
+
+} 
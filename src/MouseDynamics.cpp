@@ -0,0 +1,193 @@
+#include "MouseDynamics.h"
+
+#include <QtMath>
+
+namespace mms {
+
+const double MouseDynamics::TIMESTEP_SECONDS = 0.001;
+const Duration MouseDynamics::TIMESTEP = Seconds(TIMESTEP_SECONDS);
+
+const Length MouseDynamics::WHEEL_RADIUS = Meters(0.016);
+const Length MouseDynamics::TRACK_WIDTH = Meters(0.072);
+const Duration MouseDynamics::MOTOR_TIME_CONSTANT = Seconds(0.02);
+const AngularSpeed MouseDynamics::MAX_WHEEL_SPEED = RadiansPerSecond(150.0);
+const double MouseDynamics::ENCODER_TICKS_PER_REVOLUTION = 512.0;
+
+const Speed MouseDynamics::MAX_SPEED = MetersPerSecond(1.5);
+const Acceleration MouseDynamics::MAX_ACCELERATION =
+    MetersPerSecondSquared(4.0);
+const AngularSpeed MouseDynamics::MAX_TURN_SPEED = RadiansPerSecond(12.0);
+const AngularAcceleration MouseDynamics::MAX_TURN_ACCELERATION =
+    RadiansPerSecondSquared(60.0);
+
+const double MouseDynamics::MIN_SPEED_FRACTION = 0.01;
+const double MouseDynamics::TOLERANCE = 0.0001;
+
+// A wheel that turns by a radian, without slipping, rolls by its radius
+static const AngularDistance RADIAN = AngularDistance::SI(1.0);
+
+MouseDynamics::MouseDynamics() :
+    m_isTurn(false),
+    m_direction(1.0),
+    m_straight(),
+    m_turn(),
+    m_elapsed(),
+    m_isDone(true),
+    m_leftWheelVelocity(),
+    m_rightWheelVelocity(),
+    m_leftWheelRotation(),
+    m_rightWheelRotation() {
+}
+
+void MouseDynamics::startStraight(double meters) {
+    start(false, meters);
+}
+
+void MouseDynamics::startTurn(double radians) {
+    start(true, radians);
+}
+
+bool MouseDynamics::step() {
+    if (m_isDone) {
+        return true;
+    }
+    if (m_isTurn) {
+        stepSegment(&m_turn, MAX_TURN_SPEED, MAX_TURN_ACCELERATION);
+    }
+    else {
+        stepSegment(&m_straight, MAX_SPEED, MAX_ACCELERATION);
+    }
+    return m_isDone;
+}
+
+double MouseDynamics::finish() {
+    while (!step()) {
+    }
+    return m_elapsed.getSI();
+}
+
+bool MouseDynamics::isDone() const {
+    return m_isDone;
+}
+
+double MouseDynamics::getFraction() const {
+    return m_isTurn ? getFraction(m_turn) : getFraction(m_straight);
+}
+
+double MouseDynamics::getElapsedSeconds() const {
+    return m_elapsed.getSI();
+}
+
+int MouseDynamics::getLeftEncoderTicks() const {
+    return static_cast<int>(
+        (m_leftWheelRotation / (RADIAN * (2.0 * M_PI))).getSI() *
+        ENCODER_TICKS_PER_REVOLUTION
+    );
+}
+
+int MouseDynamics::getRightEncoderTicks() const {
+    return static_cast<int>(
+        (m_rightWheelRotation / (RADIAN * (2.0 * M_PI))).getSI() *
+        ENCODER_TICKS_PER_REVOLUTION
+    );
+}
+
+void MouseDynamics::start(bool isTurn, double amount) {
+    m_isTurn = isTurn;
+    m_direction = amount < 0.0 ? -1.0 : 1.0;
+    m_straight = Segment<1, 0>();
+    m_turn = Segment<0, 1>();
+    if (isTurn) {
+        m_turn.target = AngularDistance::SI(qAbs(amount));
+    }
+    else {
+        m_straight.target = Length::SI(qAbs(amount));
+    }
+    m_elapsed = Duration();
+    m_isDone = qAbs(amount) <= TOLERANCE;
+    m_leftWheelVelocity = AngularSpeed();
+    m_rightWheelVelocity = AngularSpeed();
+}
+
+template <int LENGTH, int ANGLE>
+void MouseDynamics::stepSegment(
+        Segment<LENGTH, ANGLE>* segment,
+        Quantity<LENGTH, ANGLE, -1> maxSpeed,
+        Quantity<LENGTH, ANGLE, -2> maxAcceleration) {
+    using Amount = Quantity<LENGTH, ANGLE, 0>;
+    using SegmentSpeed = Quantity<LENGTH, ANGLE, -1>;
+
+    // The fastest speed from which the mouse can still stop in time
+    Amount remaining = qMax(segment->target - segment->traveled, Amount());
+    SegmentSpeed desired = qMin(
+        maxSpeed,
+        squareRoot(maxAcceleration * 2.0 * remaining)
+    );
+    desired = qMax(desired, maxSpeed * MIN_SPEED_FRACTION);
+    segment->commandedSpeed = qMin(
+        desired,
+        segment->commandedSpeed + maxAcceleration * TIMESTEP
+    );
+
+    // Both wheels turn forward to drive straight, and in opposite directions
+    // to turn in place
+    AngularSpeed wheelSpeed = qMin(
+        getWheelSpeed(segment->commandedSpeed),
+        MAX_WHEEL_SPEED
+    );
+    AngularSpeed leftCommand =
+        m_isTurn ? wheelSpeed * -m_direction : wheelSpeed;
+    AngularSpeed rightCommand =
+        m_isTurn ? wheelSpeed * m_direction : wheelSpeed;
+
+    // The motors lag behind what they're commanded to do
+    Scalar response = TIMESTEP / MOTOR_TIME_CONSTANT;
+    m_leftWheelVelocity += (leftCommand - m_leftWheelVelocity) * response;
+    m_rightWheelVelocity += (rightCommand - m_rightWheelVelocity) * response;
+    m_leftWheelRotation += m_leftWheelVelocity * TIMESTEP;
+    m_rightWheelRotation += m_rightWheelVelocity * TIMESTEP;
+
+    // Advance along the segment by however far the wheels actually went
+    SegmentSpeed speed;
+    getSegmentSpeed(&speed);
+    segment->traveled += speed * TIMESTEP;
+    m_elapsed += TIMESTEP;
+
+    // Every segment ends at rest, exactly where it was supposed to
+    if (segment->target - segment->traveled <= Amount::SI(TOLERANCE)) {
+        segment->traveled = segment->target;
+        segment->commandedSpeed = SegmentSpeed();
+        m_leftWheelVelocity = AngularSpeed();
+        m_rightWheelVelocity = AngularSpeed();
+        m_isDone = true;
+    }
+}
+
+AngularSpeed MouseDynamics::getWheelSpeed(Speed speed) const {
+    return speed / WHEEL_RADIUS * RADIAN;
+}
+
+AngularSpeed MouseDynamics::getWheelSpeed(AngularSpeed speed) const {
+    // Each wheel drives around a circle whose diameter is the track
+    return speed / WHEEL_RADIUS * (TRACK_WIDTH / 2.0);
+}
+
+void MouseDynamics::getSegmentSpeed(Speed* speed) const {
+    *speed = WHEEL_RADIUS *
+        (m_leftWheelVelocity + m_rightWheelVelocity) / 2.0 / RADIAN;
+}
+
+void MouseDynamics::getSegmentSpeed(AngularSpeed* speed) const {
+    *speed = WHEEL_RADIUS * m_direction *
+        (m_rightWheelVelocity - m_leftWheelVelocity) / TRACK_WIDTH;
+}
+
+template <int LENGTH, int ANGLE>
+double MouseDynamics::getFraction(const Segment<LENGTH, ANGLE>& segment) {
+    if (segment.target <= Quantity<LENGTH, ANGLE, 0>()) {
+        return 1.0;
+    }
+    return qBound(0.0, (segment.traveled / segment.target).getSI(), 1.0);
+}
+
+} 
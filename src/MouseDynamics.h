@@ -0,0 +1,114 @@
+#pragma once
+
+#include "units/Quantity.h"
+
+namespace mms {
+
+class MouseDynamics {
+
+    // A differential drive: two wheels, each driven by a motor that responds
+    // to a commanded angular velocity with a first-order lag. Every segment,
+    // i.e., a drive straight ahead or a turn in place, is followed with a
+    // trapezoidal velocity profile that ends at rest, and the state is
+    // integrated with a fixed timestep, so that a segment takes exactly the
+    // same simulated time no matter how (or how fast) it's stepped.
+    //
+    // Only the motion along the segment is modelled; the mouse never drifts
+    // off of the line between the centers of the tiles. The physics is in
+    // dimensional quantities (see Quantity), which compile down to the same
+    // arithmetic on doubles, and so it's only the interface that's in plain
+    // meters, radians and seconds.
+
+public:
+
+    static const double TIMESTEP_SECONDS;
+
+    MouseDynamics();
+
+    // Starts a new segment, from rest; turns are counterclockwise if the
+    // angle is positive
+    void startStraight(double meters);
+    void startTurn(double radians);
+
+    // Advances the segment by one timestep; returns true once it's complete
+    bool step();
+
+    // Steps the rest of the segment, and returns the simulated time that it
+    // took, from its start
+    double finish();
+
+    bool isDone() const;
+
+    // How much of the segment is complete, from zero to one
+    double getFraction() const;
+
+    // The simulated time since the segment started
+    double getElapsedSeconds() const;
+
+    // The total rotation of each wheel, in encoder ticks, since construction
+    int getLeftEncoderTicks() const;
+    int getRightEncoderTicks() const;
+
+private:
+
+    static const Duration TIMESTEP;
+    static const Length WHEEL_RADIUS;
+    static const Length TRACK_WIDTH;
+    static const Duration MOTOR_TIME_CONSTANT;
+    static const AngularSpeed MAX_WHEEL_SPEED;
+    static const double ENCODER_TICKS_PER_REVOLUTION;
+
+    // Profile limits
+    static const Speed MAX_SPEED;
+    static const Acceleration MAX_ACCELERATION;
+    static const AngularSpeed MAX_TURN_SPEED;
+    static const AngularAcceleration MAX_TURN_ACCELERATION;
+
+    // The profile never commands less than this fraction of the maximum
+    // speed, so that the lag can't keep the mouse from arriving; a segment
+    // is complete within the tolerance, in meters or radians
+    static const double MIN_SPEED_FRACTION;
+    static const double TOLERANCE;
+
+    // The progress of a segment, in its own dimension: a length for a
+    // straight, and an angle for a turn
+    template <int LENGTH, int ANGLE>
+    struct Segment {
+        Quantity<LENGTH, ANGLE, 0> target;
+        Quantity<LENGTH, ANGLE, 0> traveled;
+        Quantity<LENGTH, ANGLE, -1> commandedSpeed;
+    };
+
+    bool m_isTurn;
+    double m_direction;
+    Segment<1, 0> m_straight;
+    Segment<0, 1> m_turn;
+    Duration m_elapsed;
+    bool m_isDone;
+
+    AngularSpeed m_leftWheelVelocity;
+    AngularSpeed m_rightWheelVelocity;
+    AngularDistance m_leftWheelRotation;
+    AngularDistance m_rightWheelRotation;
+
+    void start(bool isTurn, double amount);
+
+    // Advances either kind of segment by one timestep, with its limits
+    template <int LENGTH, int ANGLE>
+    void stepSegment(
+        Segment<LENGTH, ANGLE>* segment,
+        Quantity<LENGTH, ANGLE, -1> maxSpeed,
+        Quantity<LENGTH, ANGLE, -2> maxAcceleration);
+
+    // How fast the wheels must turn for the segment's speed, and how fast
+    // the mouse goes along the segment for the wheels' velocities
+    AngularSpeed getWheelSpeed(Speed speed) const;
+    AngularSpeed getWheelSpeed(AngularSpeed speed) const;
+    void getSegmentSpeed(Speed* speed) const;
+    void getSegmentSpeed(AngularSpeed* speed) const;
+
+    template <int LENGTH, int ANGLE>
+    static double getFraction(const Segment<LENGTH, ANGLE>& segment);
+};
+
+} 
@@ -9,19 +9,55 @@ MouseGraphic::MouseGraphic(const Mouse* mouse) :
     m_mouse(mouse) {
 }
 
-QVector<TriangleGraphic> MouseGraphic::draw() const {
-    QVector<TriangleGraphic> buffer;
-    buffer.append(SimUtilities::polygonToTriangleGraphics(
-        m_mouse->getCurrentWheelPolygon(),
+void MouseGraphic::draw(QVector<TriangleGraphic>* buffer) const {
+    SimUtilities::appendTriangleGraphics(
+        m_mouse->getInitialWheelPolygon(),
         ColorManager::getMouseWheelColor(),
-        255
-    ));
-    buffer.append(SimUtilities::polygonToTriangleGraphics(
-        m_mouse->getCurrentBodyPolygon(),
+        255,
+        buffer
+    );
+    SimUtilities::appendTriangleGraphics(
+        m_mouse->getInitialBodyPolygon(),
         ColorManager::getMouseBodyColor(),
-        255
-    ));
-    return buffer;
+        255,
+        buffer
+    );
+}
+
+MouseInstance MouseGraphic::getInstance(float alpha) const {
+    // Rotating around the initial translation, and then moving it to the
+    // current translation, is the same as rotating around the origin, and
+    // then translating by what's left of the current translation once the
+    // rotated initial translation is taken away
+    Coordinate initial = m_mouse->getInitialTranslation();
+    Coordinate current = m_mouse->getCurrentTranslation();
+    Angle rotation = m_mouse->getCurrentRotation() - m_mouse->getInitialRotation();
+    double sine = 0.0;
+    double cosine = 0.0;
+    rotation.getSinCos(&sine, &cosine);
+    double x0 = initial.getX().getMeters();
+    double y0 = initial.getY().getMeters();
+    double x = current.getX().getMeters() - (cosine * x0 - sine * y0);
+    double y = current.getY().getMeters() - (sine * x0 + cosine * y0);
+    return {
+        static_cast<float>(cosine),
+        static_cast<float>(sine),
+        static_cast<float>(x),
+        static_cast<float>(y),
+        alpha,
+    };
+}
+
+Coordinate MouseGraphic::getCurrentTranslation() const {
+    return m_mouse->getCurrentTranslation();
+}
+
+Angle MouseGraphic::getCurrentRotation() const {
+    return m_mouse->getCurrentRotation();
+}
+
+bool MouseGraphic::isAnimating() const {
+    return m_mouse->isAnimating();
 }
 
 } 
@@ -3,6 +3,7 @@
 #include <QVector>
 
 #include "Mouse.h"
+#include "MouseInstance.h"
 #include "TriangleGraphic.h"
 
 namespace mms {
@@ -11,7 +12,22 @@ class MouseGraphic {
 
 public:
     MouseGraphic(const Mouse* mouse);
-    QVector<TriangleGraphic> draw() const;
+
+    // Appends the mouse at its initial translation and rotation; this never
+    // changes, so it only needs to be drawn once
+    void draw(QVector<TriangleGraphic>* buffer) const;
+
+    // Maps the drawn mouse to its current translation and rotation
+    MouseInstance getInstance(float alpha) const;
+
+    // Where the mouse is now, and which way it's facing, e.g., for the map
+    // to follow it
+    Coordinate getCurrentTranslation() const;
+    Angle getCurrentRotation() const;
+
+    // Whether the mouse moves from one frame to the next on its own, i.e.,
+    // whether it needs to be redrawn even if nothing else changes
+    bool isAnimating() const;
 
 private:
     const Mouse* m_mouse;
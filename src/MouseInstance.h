@@ -0,0 +1,17 @@
+#pragma once
+
+namespace mms {
+
+// A single mouse, drawn as an instance of the mouse mesh; a vertex of the mesh
+// (i.e., of the mouse at its initial pose) is rotated by the angle with the
+// given cosine and sine, and then translated by (x, y), which places it at
+// the mouse's current pose. Every color of the mesh is faded by the alpha.
+struct MouseInstance {
+    float cosine;
+    float sine;
+    float x;
+    float y;
+    float alpha;
+};
+
+} 
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+template<class T>
+class MpscQueue {
+
+    // A bounded, lock-free queue for any number of producer threads and
+    // exactly one consumer thread. Producers claim a slot by advancing the
+    // write index, and each slot's sequence number says whether it's ready
+    // to be written or read on the current lap around the ring. The capacity
+    // must be a power of two so that wrapping doesn't skip any slots.
+
+public:
+
+    MpscQueue(int capacity);
+    ~MpscQueue();
+
+    // Any thread; returns false if the queue is full
+    bool push(const T& value);
+
+    // Consumer only; returns false if the queue is empty
+    bool pop(T* value);
+
+private:
+
+    struct Slot {
+        std::atomic<unsigned int> sequence;
+        T value;
+    };
+
+    Slot* m_slots;
+    unsigned int m_mask;
+    std::atomic<unsigned int> m_write;
+    unsigned int m_read;
+
+};
+
+template<class T>
+MpscQueue<T>::MpscQueue(int capacity) :
+    m_slots(nullptr),
+    m_mask(static_cast<unsigned int>(capacity) - 1),
+    m_write(0),
+    m_read(0) {
+    ASSERT_LT(0, capacity);
+    ASSERT_EQ(capacity & (capacity - 1), 0);
+    m_slots = new Slot[capacity];
+    for (int i = 0; i < capacity; i += 1) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<class T>
+MpscQueue<T>::~MpscQueue() {
+    delete[] m_slots;
+}
+
+template<class T>
+bool MpscQueue<T>::push(const T& value) {
+    unsigned int write = m_write.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &m_slots[write & m_mask];
+        unsigned int sequence = slot->sequence.load(std::memory_order_acquire);
+        int difference = static_cast<int>(sequence - write);
+        if (difference == 0) {
+            // The slot is free on this lap; claim it, unless another
+            // producer got there first (which reloads write)
+            if (m_write.compare_exchange_weak(
+                write,
+                write + 1,
+                std::memory_order_relaxed
+            )) {
+                slot->value = value;
+                slot->sequence.store(write + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0) {
+            // The slot still holds a value from the previous lap
+            return false;
+        }
+        else {
+            write = m_write.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<class T>
+bool MpscQueue<T>::pop(T* value) {
+    Slot* slot = &m_slots[m_read & m_mask];
+    unsigned int sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != m_read + 1) {
+        return false;
+    }
+    *value = slot->value;
+    slot->value = T();
+    slot->sequence.store(m_read + m_mask + 1, std::memory_order_release);
+    m_read += 1;
+    return true;
+}
+
+} 
@@ -0,0 +1,32 @@
+#include "OpenGLMapRenderer.h"
+
+namespace mms {
+
+OpenGLMapRenderer::OpenGLMapRenderer() : m_map() {
+}
+
+bool OpenGLMapRenderer::init(int width, int height) {
+    return m_map.initOffscreen(width, height);
+}
+
+RenderBackend OpenGLMapRenderer::getBackend() const {
+    return RenderBackend::OPENGL;
+}
+
+void OpenGLMapRenderer::setMaze(const Maze* maze) {
+    m_map.setMaze(maze);
+}
+
+void OpenGLMapRenderer::setView(const MazeView* view) {
+    m_map.setView(view);
+}
+
+void OpenGLMapRenderer::setMouseGraphic(const MouseGraphic* mouseGraphic) {
+    m_map.setMouseGraphic(mouseGraphic);
+}
+
+QImage OpenGLMapRenderer::render() {
+    return m_map.renderOffscreen();
+}
+
+} 
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Map.h"
+#include "MapRenderer.h"
+
+namespace mms {
+
+class OpenGLMapRenderer : public MapRenderer {
+
+    // A map that's never shown, drawing into an offscreen framebuffer with
+    // the same programs and buffers as the map in the window
+
+public:
+
+    OpenGLMapRenderer();
+
+    // Returns false if the map's context or framebuffer can't be made
+    bool init(int width, int height);
+
+    RenderBackend getBackend() const;
+    void setMaze(const Maze* maze);
+    void setView(const MazeView* view);
+    void setMouseGraphic(const MouseGraphic* mouseGraphic);
+    QImage render();
+
+private:
+
+    Map m_map;
+
+};
+
+} 
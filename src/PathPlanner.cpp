@@ -0,0 +1,437 @@
+#include "PathPlanner.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int PathPlanner::CLUSTER_SIZE = 16;
+
+// The displacement of a step in each direction, by the value of the
+// Direction
+static const int DX[] = {0, 1, 0, -1};
+static const int DY[] = {1, 0, -1, 0};
+
+PathPlanner::PathPlanner(const WallGrid& walls) :
+    m_walls(walls),
+    m_numRows((walls.getHeight() + CLUSTER_SIZE - 1) / CLUSTER_SIZE) {
+
+    int width = walls.getWidth();
+    int height = walls.getHeight();
+    int numColumns = (width + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+
+    // Clusters are the same if they're the same size and have the same
+    // walls, one byte for each cell; a cell is a node if it's open on a side
+    // that leaves the cluster, so alike clusters have alike nodes too
+    QHash<QByteArray, int> tables;
+    for (int column = 0; column < numColumns; column += 1) {
+        for (int row = 0; row < m_numRows; row += 1) {
+            Cluster cluster = {
+                column * CLUSTER_SIZE,
+                row * CLUSTER_SIZE,
+                -1,
+                m_nodeCells.size(),
+            };
+            int clusterWidth = qMin(CLUSTER_SIZE, width - cluster.x);
+            int clusterHeight = qMin(CLUSTER_SIZE, height - cluster.y);
+            QByteArray key(2 + clusterWidth * clusterHeight, '\0');
+            key[0] = static_cast<char>(clusterWidth);
+            key[1] = static_cast<char>(clusterHeight);
+            for (int x = 0; x < clusterWidth; x += 1) {
+                for (int y = 0; y < clusterHeight; y += 1) {
+                    key[2 + x * clusterHeight + y] = static_cast<char>(
+                        walls.getWallBits(
+                            (cluster.x + x) * height + cluster.y + y));
+                }
+            }
+            cluster.table = tables.value(key, -1);
+            int index = m_clusters.size();
+            if (0 <= cluster.table) {
+                m_clusters.append(cluster);
+            }
+            else {
+                cluster.table = m_tables.size();
+                tables.insert(key, cluster.table);
+                m_tables.append({clusterWidth, clusterHeight, {}, {}, {}});
+                m_clusters.append(cluster);
+
+                // The distances from each node, by a search of the cluster
+                Table& table = m_tables.last();
+                table.nodes.fill(-1, clusterWidth * clusterHeight);
+                for (int x = 0; x < clusterWidth; x += 1) {
+                    for (int y = 0; y < clusterHeight; y += 1) {
+                        int open = ~key.at(2 + x * clusterHeight + y) & 0xf;
+                        bool isNode =
+                            (open & 1 && y == clusterHeight - 1) ||
+                            (open & 2 && x == clusterWidth - 1) ||
+                            (open & 4 && y == 0) ||
+                            (open & 8 && x == 0);
+                        if (isNode) {
+                            table.nodes[x * clusterHeight + y] =
+                                table.cells.size();
+                            table.cells.append(x * clusterHeight + y);
+                        }
+                    }
+                }
+                int numNodes = table.cells.size();
+                table.distances.fill(-1, numNodes * numNodes);
+                for (int i = 0; i < numNodes; i += 1) {
+                    int cell = table.cells.at(i);
+                    QVector<int> distances = getLocalDistances(index, {
+                        (cluster.x + cell / clusterHeight) * height +
+                            cluster.y + cell % clusterHeight
+                    });
+                    for (int j = 0; j < numNodes; j += 1) {
+                        table.distances[i * numNodes + j] =
+                            distances.at(table.cells.at(j));
+                    }
+                }
+            }
+            const Table& table = m_tables.at(cluster.table);
+            for (int cell : table.cells) {
+                m_nodeCells.append(
+                    (cluster.x + cell / table.height) * height +
+                        cluster.y + cell % table.height);
+                m_nodeClusters.append(index);
+            }
+        }
+    }
+
+    // Each opening is stored by both of the nodes that it joins, just as
+    // the walls are by both of their cells
+    for (int node = 0; node < m_nodeCells.size(); node += 1) {
+        m_openingBegins.append(m_openings.size());
+        int cell = m_nodeCells.at(node);
+        int x = cell / height;
+        int y = cell % height;
+        int open = ~walls.getWallBits(cell) & 0xf;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int nx = x + DX[direction];
+            int ny = y + DY[direction];
+            if (
+                !(open & (1 << direction)) ||
+                nx < 0 || width <= nx || ny < 0 || height <= ny
+            ) {
+                continue;
+            }
+            int neighbor = nx * height + ny;
+            int other = getCluster(neighbor);
+            if (other == m_nodeClusters.at(node)) {
+                continue;
+            }
+            const Cluster& cluster = m_clusters.at(other);
+            const Table& table = m_tables.at(cluster.table);
+            int local = table.nodes.at(
+                (nx - cluster.x) * table.height + ny - cluster.y);
+            ASSERT_LE(0, local);
+            m_openings.append(cluster.firstNode + local);
+        }
+    }
+    m_openingBegins.append(m_openings.size());
+}
+
+int PathPlanner::getDistance(int from, const QVector<int>& goals) const {
+    return search(from, goals).distance;
+}
+
+QVector<int> PathPlanner::getPath(
+        int from,
+        const QVector<int>& goals) const {
+    Search result = search(from, goals);
+    if (result.distance < 0) {
+        return {};
+    }
+
+    // Consecutive nodes are either joined by an opening, i.e., they're
+    // neighbors, or by a path within their cluster
+    QVector<int> path = {from};
+    int cell = from;
+    for (int node : result.nodes) {
+        int next = m_nodeCells.at(node);
+        int cluster = m_nodeClusters.at(node);
+        if (cluster != getCluster(cell)) {
+            path.append(next);
+        }
+        else if (next != cell) {
+            appendLocalPath(
+                cluster,
+                getLocalDistances(cluster, {next}),
+                cell,
+                &path);
+        }
+        cell = next;
+    }
+    int cluster = getCluster(cell);
+    QVector<int> localGoals;
+    for (int goal : goals) {
+        if (getCluster(goal) == cluster) {
+            localGoals.append(goal);
+        }
+    }
+    appendLocalPath(
+        cluster,
+        getLocalDistances(cluster, localGoals),
+        cell,
+        &path);
+    ASSERT_EQ(path.size(), result.distance + 1);
+    return path;
+}
+
+int PathPlanner::getNumClusters() const {
+    return m_clusters.size();
+}
+
+int PathPlanner::getNumTables() const {
+    return m_tables.size();
+}
+
+int PathPlanner::getNumNodes() const {
+    return m_nodeCells.size();
+}
+
+qint64 PathPlanner::getMemoryBytes() const {
+    qint64 numInts =
+        m_nodeCells.size() +
+        m_nodeClusters.size() +
+        m_openingBegins.size() +
+        m_openings.size();
+    for (const Table& table : m_tables) {
+        numInts +=
+            table.cells.size() + table.nodes.size() + table.distances.size();
+    }
+    return
+        static_cast<qint64>(sizeof(int)) * numInts +
+        static_cast<qint64>(sizeof(Cluster)) * m_clusters.size() +
+        static_cast<qint64>(sizeof(Table)) * m_tables.size();
+}
+
+int PathPlanner::getCluster(int cell) const {
+    int height = m_walls.getHeight();
+    return
+        (cell / height / CLUSTER_SIZE) * m_numRows +
+        (cell % height) / CLUSTER_SIZE;
+}
+
+QVector<int> PathPlanner::getLocalDistances(
+        int cluster,
+        const QVector<int>& sources) const {
+    const Cluster& origin = m_clusters.at(cluster);
+    const Table& table = m_tables.at(origin.table);
+    int height = m_walls.getHeight();
+    QVector<int> distances(table.width * table.height, -1);
+    QVector<int> queue;
+    for (int source : sources) {
+        int local =
+            (source / height - origin.x) * table.height +
+            source % height - origin.y;
+        if (distances.at(local) == -1) {
+            distances[local] = 0;
+            queue.append(local);
+        }
+    }
+    for (int i = 0; i < queue.size(); i += 1) {
+        int local = queue.at(i);
+        int x = local / table.height;
+        int y = local % table.height;
+        int open = ~m_walls.getWallBits(
+            (origin.x + x) * height + origin.y + y) & 0xf;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int nx = x + DX[direction];
+            int ny = y + DY[direction];
+            if (
+                !(open & (1 << direction)) ||
+                nx < 0 || table.width <= nx || ny < 0 || table.height <= ny
+            ) {
+                continue;
+            }
+            int neighbor = nx * table.height + ny;
+            if (distances.at(neighbor) == -1) {
+                distances[neighbor] = distances.at(local) + 1;
+                queue.append(neighbor);
+            }
+        }
+    }
+    return distances;
+}
+
+void PathPlanner::appendLocalPath(
+        int cluster,
+        const QVector<int>& distances,
+        int from,
+        QVector<int>* path) const {
+    const Cluster& origin = m_clusters.at(cluster);
+    const Table& table = m_tables.at(origin.table);
+    int height = m_walls.getHeight();
+    int x = from / height - origin.x;
+    int y = from % height - origin.y;
+    int distance = distances.at(x * table.height + y);
+    ASSERT_LE(0, distance);
+    while (0 < distance) {
+        int open = ~m_walls.getWallBits(
+            (origin.x + x) * height + origin.y + y) & 0xf;
+        int direction = 0;
+        for (; direction < 4; direction += 1) {
+            int nx = x + DX[direction];
+            int ny = y + DY[direction];
+            if (
+                open & (1 << direction) &&
+                0 <= nx && nx < table.width && 0 <= ny && ny < table.height &&
+                distances.at(nx * table.height + ny) == distance - 1
+            ) {
+                break;
+            }
+        }
+        ASSERT_LT(direction, 4);
+        x += DX[direction];
+        y += DY[direction];
+        distance -= 1;
+        path->append((origin.x + x) * height + origin.y + y);
+    }
+}
+
+PathPlanner::Search PathPlanner::search(
+        int from,
+        const QVector<int>& goals) const {
+
+    // The search is towards the box around the goals, whose distance
+    // (ignoring walls) never overestimates that of a goal, and never drops
+    // by more than a move per move, so nodes are settled in order
+    int height = m_walls.getHeight();
+    Search result = {-1, {}};
+    if (goals.isEmpty()) {
+        return result;
+    }
+    int minX = goals.first() / height;
+    int maxX = minX;
+    int minY = goals.first() % height;
+    int maxY = minY;
+    QMap<int, QVector<int>> clusterGoals;
+    for (int goal : goals) {
+        minX = qMin(minX, goal / height);
+        maxX = qMax(maxX, goal / height);
+        minY = qMin(minY, goal % height);
+        maxY = qMax(maxY, goal % height);
+        clusterGoals[getCluster(goal)].append(goal);
+    }
+    auto getEstimate = [&](int cell) {
+        int x = cell / height;
+        int y = cell % height;
+        return
+            qMax(0, minX - x) + qMax(0, x - maxX) +
+            qMax(0, minY - y) + qMax(0, y - maxY);
+    };
+
+    // The distance from each node to the closest goal in its cluster, by a
+    // path within the cluster, if there is one
+    int numNodes = m_nodeCells.size();
+    QVector<int> goalDistances(numNodes, -1);
+    for (auto it = clusterGoals.constBegin(); it != clusterGoals.constEnd();
+            ++it) {
+        QVector<int> distances = getLocalDistances(it.key(), it.value());
+        const Cluster& cluster = m_clusters.at(it.key());
+        const Table& table = m_tables.at(cluster.table);
+        for (int i = 0; i < table.cells.size(); i += 1) {
+            goalDistances[cluster.firstNode + i] =
+                distances.at(table.cells.at(i));
+        }
+    }
+
+    // A path within the start's cluster is the first candidate
+    int start = getCluster(from);
+    QVector<int> startDistances = getLocalDistances(start, {from});
+    const Cluster& startCluster = m_clusters.at(start);
+    const Table& startTable = m_tables.at(startCluster.table);
+    auto local = [&](int cell) {
+        return
+            (cell / height - startCluster.x) * startTable.height +
+            cell % height - startCluster.y;
+    };
+    for (int goal : clusterGoals.value(start)) {
+        int distance = startDistances.at(local(goal));
+        if (0 <= distance &&
+                (result.distance < 0 || distance < result.distance)) {
+            result.distance = distance;
+        }
+    }
+
+    // The nodes are searched by their distance plus their estimate
+    QVector<int> distances(numNodes, -1);
+    QVector<int> previous(numNodes, -1);
+    std::priority_queue<
+        std::pair<int, int>,
+        std::vector<std::pair<int, int>>,
+        std::greater<std::pair<int, int>>
+    > queue;
+    auto relax = [&](int node, int through, int distance) {
+        if (distances.at(node) < 0 || distance < distances.at(node)) {
+            distances[node] = distance;
+            previous[node] = through;
+            queue.push({distance + getEstimate(m_nodeCells.at(node)), node});
+        }
+    };
+    for (int i = 0; i < startTable.cells.size(); i += 1) {
+        int distance = startDistances.at(startTable.cells.at(i));
+        if (0 <= distance) {
+            relax(startCluster.firstNode + i, -1, distance);
+        }
+    }
+    int last = -1;
+    while (!queue.empty()) {
+        std::pair<int, int> top = queue.top();
+        queue.pop();
+        int node = top.second;
+        int distance = distances.at(node);
+        if (distance + getEstimate(m_nodeCells.at(node)) < top.first) {
+            continue;
+        }
+        if (0 <= result.distance && result.distance <= top.first) {
+            break;
+        }
+        int goalDistance = goalDistances.at(node);
+        if (0 <= goalDistance && (
+                result.distance < 0 ||
+                distance + goalDistance < result.distance)) {
+            result.distance = distance + goalDistance;
+            last = node;
+        }
+        for (int i = m_openingBegins.at(node);
+                i < m_openingBegins.at(node + 1); i += 1) {
+            relax(m_openings.at(i), node, distance + 1);
+        }
+
+        // A node that was reached from within its cluster (or from the
+        // start, within the start's) is no closer to any node of the cluster
+        // than whatever it was reached from, which was already no further
+        int through = previous.at(node);
+        int current = m_nodeClusters.at(node);
+        if (through == -1 || m_nodeClusters.at(through) == current) {
+            continue;
+        }
+        const Cluster& cluster = m_clusters.at(current);
+        const Table& table = m_tables.at(cluster.table);
+        int numLocal = table.cells.size();
+        int begin = (node - cluster.firstNode) * numLocal;
+        for (int i = 0; i < numLocal; i += 1) {
+            int step = table.distances.at(begin + i);
+            if (0 < step) {
+                relax(cluster.firstNode + i, node, distance + step);
+            }
+        }
+    }
+    for (int node = last; node != -1; node = previous.at(node)) {
+        result.nodes.append(node);
+    }
+    std::reverse(result.nodes.begin(), result.nodes.end());
+    return result;
+}
+
+} 
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QVector>
+
+#include "WallGrid.h"
+
+namespace mms {
+
+class PathPlanner {
+
+    // Shortest paths between any two cells of a maze, for mazes that are too
+    // big to search whole for every query. The maze is cut into clusters of
+    // CLUSTER_SIZE by CLUSTER_SIZE cells, and every cell on the edge of a
+    // cluster that's open to a cell of another cluster is a node of a graph
+    // whose edges are those openings (a move each) and the distances between
+    // the nodes of each cluster, by paths that stay within it, which are
+    // found up front; clusters with the same walls share their distances,
+    // as the chunks of a WallGrid share their walls. A query searches the
+    // cells of the clusters of the start and of the goals, and then the
+    // graph, towards the goals (by their distance, ignoring walls), so that
+    // a query on a 256x256 maze takes about a tenth of the time of a search
+    // of every cell. Every path between two clusters goes through nodes, and
+    // whatever lies between two of them is either an opening or a path
+    // within a cluster, so the distances are exact, the same as those of a
+    // search of every cell (see Maze).
+    //
+    // Cells are by their index, x * height + y; the grid must be enclosed.
+
+public:
+
+    static const int CLUSTER_SIZE;
+
+    // The grid is copied, which is cheap, since copies share their chunks
+    PathPlanner(const WallGrid& walls);
+
+    // The number of moves from the cell to the closest of the goals, or -1
+    // if none of them can be reached
+    int getDistance(int from, const QVector<int>& goals) const;
+
+    // The cells of a shortest path from the cell to the closest of the
+    // goals, both included, or nothing if none of them can be reached
+    QVector<int> getPath(int from, const QVector<int>& goals) const;
+
+    int getNumClusters() const;
+    int getNumTables() const;
+    int getNumNodes() const;
+
+    // What the graph and the distances take, in bytes, besides the walls
+    qint64 getMemoryBytes() const;
+
+private:
+
+    // The nodes of the clusters that share it, by their cell within the
+    // cluster (x * height + y, from the cluster's first cell), the node of
+    // every cell (or -1), and the distance between every pair of nodes
+    // (numNodes * from + to), or -1 if they can't reach each other within
+    // the cluster
+    struct Table {
+        int width;
+        int height;
+        QVector<int> cells;
+        QVector<int> nodes;
+        QVector<int> distances;
+    };
+
+    // A cluster's first cell, its table, and the node of the graph that its
+    // table's first node is; clusters are by x * m_numRows + y
+    struct Cluster {
+        int x;
+        int y;
+        int table;
+        int firstNode;
+    };
+
+    // The distance of a query, and the nodes that its path goes through, in
+    // order; none if the path stays within the start's cluster
+    struct Search {
+        int distance;
+        QVector<int> nodes;
+    };
+
+    WallGrid m_walls;
+    int m_numRows;
+    QVector<Table> m_tables;
+    QVector<Cluster> m_clusters;
+
+    // The cell and cluster of every node, and the nodes of other clusters
+    // that it's open to, from openings.at(node) up to openings.at(node + 1)
+    QVector<int> m_nodeCells;
+    QVector<int> m_nodeClusters;
+    QVector<int> m_openingBegins;
+    QVector<int> m_openings;
+
+    int getCluster(int cell) const;
+
+    // The distance from the closest of the sources (which are in the
+    // cluster) to every cell of the cluster, by paths within it, by their
+    // cell within the cluster
+    QVector<int> getLocalDistances(
+        int cluster,
+        const QVector<int>& sources) const;
+
+    // Appends the cells of a path from the cell down to a cell whose local
+    // distance is zero, not including the cell itself
+    void appendLocalPath(
+        int cluster,
+        const QVector<int>& distances,
+        int from,
+        QVector<int>* path) const;
+
+    Search search(int from, const QVector<int>& goals) const;
+};
+
+} 
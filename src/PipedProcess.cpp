@@ -0,0 +1,128 @@
+#include "PipedProcess.h"
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mms {
+
+const int PipedProcess::MAX_READ_BYTES = 64 * 1024;
+
+PipedProcess::PipedProcess(QObject* parent) :
+    QProcess(parent),
+    m_readFd(-1),
+    m_writeFd(-1),
+    m_notifier(nullptr),
+    m_isPaused(false),
+    m_isAtEnd(false) {
+#ifdef Q_OS_UNIX
+    // Neither end is inherited as it is; the child only gets the write end,
+    // as its stdout, from setupChildProcess
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        return;
+    }
+    for (int fd : fds) {
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    m_readFd = fds[0];
+    m_writeFd = fds[1];
+    m_notifier = new QSocketNotifier(m_readFd, QSocketNotifier::Read, this);
+    connect(
+        m_notifier,
+        &QSocketNotifier::activated,
+        this,
+        &PipedProcess::outputReady
+    );
+    connect(this, &QProcess::started, this, &PipedProcess::closeWriteEnd);
+    connect(
+        this,
+        &QProcess::errorOccurred,
+        this,
+        [=](QProcess::ProcessError error){
+            if (error == QProcess::FailedToStart) {
+                closeWriteEnd();
+            }
+        }
+    );
+#endif
+}
+
+PipedProcess::~PipedProcess() {
+#ifdef Q_OS_UNIX
+    closeWriteEnd();
+    if (m_readFd != -1) {
+        delete m_notifier;
+        ::close(m_readFd);
+    }
+#endif
+}
+
+bool PipedProcess::isPiped() const {
+    return m_readFd != -1;
+}
+
+QByteArray PipedProcess::readOutput() {
+    QByteArray output;
+#ifdef Q_OS_UNIX
+    if (m_readFd == -1 || m_isAtEnd) {
+        return output;
+    }
+    output.resize(MAX_READ_BYTES);
+    ssize_t size = 0;
+    while (size < MAX_READ_BYTES) {
+        ssize_t count = ::read(
+            m_readFd,
+            output.data() + size,
+            MAX_READ_BYTES - size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count == 0) {
+            // Every writer is gone, so there's nothing left to wait for
+            m_isAtEnd = true;
+            updateNotifier();
+        }
+        if (count <= 0) {
+            break;
+        }
+        size += count;
+    }
+    output.resize(static_cast<int>(size));
+#endif
+    return output;
+}
+
+void PipedProcess::setOutputPaused(bool paused) {
+    m_isPaused = paused;
+    updateNotifier();
+}
+
+void PipedProcess::setupChildProcess() {
+#ifdef Q_OS_UNIX
+    // Runs in the child, after QProcess has set up its own pipes
+    if (m_writeFd != -1) {
+        ::dup2(m_writeFd, STDOUT_FILENO);
+    }
+#endif
+}
+
+void PipedProcess::closeWriteEnd() {
+#ifdef Q_OS_UNIX
+    if (m_writeFd != -1) {
+        ::close(m_writeFd);
+        m_writeFd = -1;
+    }
+#endif
+}
+
+void PipedProcess::updateNotifier() {
+    if (m_notifier != nullptr) {
+        m_notifier->setEnabled(!m_isPaused && !m_isAtEnd);
+    }
+}
+
+} 
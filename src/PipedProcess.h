@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QSocketNotifier>
+
+namespace mms {
+
+class PipedProcess : public QProcess {
+
+    // A process whose stdout is a pipe of its own, rather than QProcess's,
+    // so that reading it can be paused: QProcess reads everything that the
+    // process writes as soon as it's written, however much of it piles up,
+    // whereas a pipe that isn't read fills up, and then blocks the process's
+    // writes until it's read again. Only on Unix; elsewhere, stdout is read
+    // through QProcess as usual, and pausing doesn't do anything.
+
+    Q_OBJECT
+
+public:
+
+    PipedProcess(QObject* parent = nullptr);
+    ~PipedProcess();
+
+    // Whether stdout is read with readOutput, rather than with QProcess's
+    // own functions
+    bool isPiped() const;
+
+    // Reads at most MAX_READ_BYTES of whatever's in the pipe, without
+    // waiting for more
+    QByteArray readOutput();
+
+    // Paused pipes aren't read, and don't emit outputReady, until resumed
+    void setOutputPaused(bool paused);
+
+signals:
+
+    void outputReady();
+
+protected:
+
+    void setupChildProcess() override;
+
+private:
+
+    static const int MAX_READ_BYTES;
+
+    // The ends of the pipe, or -1 once they're closed; the write end is
+    // closed in this process as soon as the child has its copy
+    int m_readFd;
+    int m_writeFd;
+    QSocketNotifier* m_notifier;
+    bool m_isPaused;
+    bool m_isAtEnd;
+
+    void closeWriteEnd();
+    void updateNotifier();
+
+};
+
+} 
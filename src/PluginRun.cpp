@@ -0,0 +1,631 @@
+#include "PluginRun.h"
+
+#include <QDebug>
+#include <QMetaObject>
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "Direction.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const int PluginRun::ABANDON_MS = 1000;
+const double PluginRun::STEP_SLICE_SECONDS = 0.002;
+const int PluginRun::CALLS_PER_CLOCK_CHECK = 256;
+
+PluginRun::PluginRun(
+        const QString& mazePath,
+        Maze* maze,
+        const QString& libraryPath,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        QObject* parent) :
+    QObject(parent),
+    m_session(std::make_shared<Session>()),
+    m_abandonTimer(new QTimer(this)),
+    m_result(HeadlessRun::getUnrunResult(
+        mazePath,
+        RunStatus::FAILED_TO_START,
+        QString()
+    )),
+    m_isStarted(false),
+    m_isFinished(false),
+    m_step(nullptr),
+    m_stop(nullptr),
+    m_state(nullptr) {
+
+    ASSERT_FA(maze == nullptr);
+    m_session->mazePath = mazePath;
+    m_session->maze = maze;
+    m_session->libraryPath = libraryPath;
+    m_session->timeLimitSeconds = timeLimitSeconds;
+    m_session->tickLimit = tickLimit;
+    m_session->commandLimit = -1;
+    m_session->moveLimit = -1;
+    m_session->isContest = false;
+    m_session->contestRules = ContestScorer::DEFAULT_RULES();
+    m_session->mouseDefinition = MouseDefinition::getDefault();
+    m_session->sensorNoise = SensorNoise();
+    m_session->engine = nullptr;
+    m_session->callsUntilClockCheck = CALLS_PER_CLOCK_CHECK;
+    m_session->startTimestamp = 0.0;
+    m_session->status = RunStatus::FAILED_TO_START;
+    m_session->isTimeLimited = false;
+    m_session->result = m_result;
+    m_session->isOver = false;
+    m_session->owner = this;
+
+    m_session->api.abiVersion = MMS_PLUGIN_ABI_VERSION;
+    m_session->api.context = m_session.get();
+    m_session->api.mazeWidth = &PluginRun::mazeWidth;
+    m_session->api.mazeHeight = &PluginRun::mazeHeight;
+    m_session->api.wallFront = &PluginRun::wallFront;
+    m_session->api.wallRight = &PluginRun::wallRight;
+    m_session->api.wallLeft = &PluginRun::wallLeft;
+    m_session->api.moveForward = &PluginRun::moveForward;
+    m_session->api.turnRight = &PluginRun::turnRight;
+    m_session->api.turnLeft = &PluginRun::turnLeft;
+    m_session->api.setWall = &PluginRun::setWall;
+    m_session->api.clearWall = &PluginRun::clearWall;
+    m_session->api.setColor = &PluginRun::setColor;
+    m_session->api.clearColor = &PluginRun::clearColor;
+    m_session->api.clearAllColor = &PluginRun::clearAllColor;
+    m_session->api.setText = &PluginRun::setText;
+    m_session->api.clearText = &PluginRun::clearText;
+    m_session->api.clearAllText = &PluginRun::clearAllText;
+    m_session->api.wasReset = &PluginRun::wasReset;
+    m_session->api.ackReset = &PluginRun::ackReset;
+    m_session->api.isOver = &PluginRun::isOver;
+
+    // The plugin's thread checks the time limit itself; this only catches
+    // plugins that never call back to find out that the run is over
+    m_abandonTimer->setSingleShot(true);
+    m_abandonTimer->setInterval(
+        static_cast<int>(timeLimitSeconds * 1000) + ABANDON_MS
+    );
+    connect(
+        m_abandonTimer,
+        &QTimer::timeout,
+        this,
+        &PluginRun::abandon
+    );
+}
+
+PluginRun::~PluginRun() {
+    if (!m_isStarted) {
+        delete m_session->maze;
+        return;
+    }
+    if (m_step != nullptr) {
+        // Its steps only ever run on this thread, so none is running now
+        if (m_state != nullptr) {
+            m_stop(m_state);
+            m_state = nullptr;
+        }
+        delete m_session->engine;
+        delete m_session->maze;
+        return;
+    }
+    if (m_thread.joinable()) {
+        // Whatever the thread is up to, nobody's waiting for it anymore
+        {
+            std::lock_guard<std::mutex> lock(m_session->mutex);
+            m_session->owner = nullptr;
+        }
+        m_session->isOver = true;
+        m_thread.detach();
+    }
+}
+
+void PluginRun::setStepLimits(qint64 commandLimit, int moveLimit) {
+    ASSERT_FA(m_isStarted);
+    m_session->commandLimit = commandLimit;
+    m_session->moveLimit = moveLimit;
+}
+
+void PluginRun::setContestRules(const ContestRules& rules) {
+    ASSERT_FA(m_isStarted);
+    m_session->isContest = true;
+    m_session->contestRules = rules;
+}
+
+void PluginRun::setMouseDefinition(
+        std::shared_ptr<const MouseDefinition> definition) {
+    ASSERT_FA(m_isStarted);
+    m_session->mouseDefinition = definition;
+}
+
+void PluginRun::setSensorNoise(const SensorNoise& noise) {
+    ASSERT_FA(m_isStarted);
+    m_session->sensorNoise = noise;
+}
+
+void PluginRun::start() {
+    ASSERT_FA(m_isStarted);
+    m_isStarted = true;
+    QLibrary library(m_session->libraryPath);
+    if (library.resolve(MMS_PLUGIN_STEP_SYMBOL) != nullptr) {
+        startResumable(&library);
+        return;
+    }
+    m_abandonTimer->start();
+    m_thread = std::thread(&PluginRun::run, m_session);
+}
+
+RunResult PluginRun::getResult() const {
+    return m_result;
+}
+
+void PluginRun::onSessionEnded() {
+    // The run may have given up on the thread just before it ended
+    if (m_isFinished) {
+        return;
+    }
+    m_isFinished = true;
+    m_abandonTimer->stop();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_result = m_session->result;
+    emit mazeFinished();
+    emit finished();
+}
+
+void PluginRun::abandon() {
+    if (m_isFinished) {
+        return;
+    }
+    m_isFinished = true;
+    {
+        std::lock_guard<std::mutex> lock(m_session->mutex);
+        m_session->owner = nullptr;
+    }
+    m_session->isOver = true;
+    m_thread.detach();
+
+    // None of what the plugin did can be read while its thread still runs
+    m_result = HeadlessRun::getUnrunResult(
+        m_session->mazePath,
+        RunStatus::TIMEOUT,
+        "ran past the time limit, and the plugin never returned"
+    );
+    m_result.isTimeLimited = true;
+    qWarning().noquote().nospace()
+        << "Abandoned the plugin \"" << m_session->libraryPath
+        << "\" for \"" << m_session->mazePath << "\"";
+    emit mazeFinished();
+    emit finished();
+}
+
+void PluginRun::run(std::shared_ptr<Session> session) {
+
+    session->startTimestamp = SimUtilities::getHighResTimestamp();
+    createEngine(session.get());
+
+    // The library is never unloaded, since an abandoned plugin may still be
+    // running it, and since another run may be about to load it again
+    QLibrary library(session->libraryPath);
+    MmsRunFunction function = reinterpret_cast<MmsRunFunction>(
+        library.resolve(MMS_PLUGIN_RUN_SYMBOL)
+    );
+    if (function == nullptr) {
+        end(session.get(), RunStatus::FAILED_TO_START, library.errorString());
+    }
+    else {
+        function(&session->api);
+        endReturned(session.get());
+    }
+    cleanUp(session.get());
+
+    std::lock_guard<std::mutex> lock(session->mutex);
+    if (session->owner != nullptr) {
+        QMetaObject::invokeMethod(
+            session->owner,
+            "onSessionEnded",
+            Qt::QueuedConnection
+        );
+    }
+}
+
+void PluginRun::startResumable(QLibrary* library) {
+
+    m_step = reinterpret_cast<MmsStepFunction>(
+        library->resolve(MMS_PLUGIN_STEP_SYMBOL)
+    );
+    m_stop = reinterpret_cast<MmsStopFunction>(
+        library->resolve(MMS_PLUGIN_STOP_SYMBOL)
+    );
+    MmsStartFunction start = reinterpret_cast<MmsStartFunction>(
+        library->resolve(MMS_PLUGIN_START_SYMBOL)
+    );
+    Session* session = m_session.get();
+    session->startTimestamp = SimUtilities::getHighResTimestamp();
+    createEngine(session);
+    if (start == nullptr || m_stop == nullptr) {
+        end(
+            session,
+            RunStatus::FAILED_TO_START,
+            QString("a resumable plugin must export %1, %2 and %3").arg(
+                MMS_PLUGIN_START_SYMBOL,
+                MMS_PLUGIN_STEP_SYMBOL,
+                MMS_PLUGIN_STOP_SYMBOL
+            )
+        );
+        cleanUp(session);
+        QMetaObject::invokeMethod(this, "onSessionEnded", Qt::QueuedConnection);
+        return;
+    }
+    m_state = start(&session->api);
+
+    // Every run takes its first step on a later turn of the event loop, just
+    // as a plugin on a thread would start some time after being started
+    QMetaObject::invokeMethod(this, "resume", Qt::QueuedConnection);
+}
+
+void PluginRun::resume() {
+
+    Session* session = m_session.get();
+    double deadline =
+        SimUtilities::getHighResTimestamp() + STEP_SLICE_SECONDS;
+    bool isDone = false;
+    while (!isDone && !session->isOver) {
+        isDone = m_step(m_state, &session->api) == 0;
+        double now = SimUtilities::getHighResTimestamp();
+        if (session->timeLimitSeconds < now - session->startTimestamp) {
+            endOnTimeLimit(session);
+        }
+        if (deadline < now) {
+            break;
+        }
+    }
+    if (!isDone && !session->isOver) {
+        QMetaObject::invokeMethod(this, "resume", Qt::QueuedConnection);
+        return;
+    }
+
+    // The plugin is stopped whether or not it was done, like a coroutine
+    // that's destroyed while it's suspended
+    endReturned(session);
+    m_stop(m_state);
+    m_state = nullptr;
+    cleanUp(session);
+    onSessionEnded();
+}
+
+void PluginRun::createEngine(Session* session) {
+
+    // Direct connections only, since the thread has no event loop; every
+    // signal is emitted from within a call to the engine
+    session->engine = new SimulationEngine(session->maze, nullptr, nullptr);
+    session->engine->setInstant(true);
+    session->engine->setContinuous(false);
+    session->engine->setTickLimit(session->tickLimit);
+    session->engine->setCommandLimit(session->commandLimit);
+    session->engine->setMoveLimit(session->moveLimit);
+    session->engine->setContestRules(session->contestRules);
+    session->engine->setMouseDefinition(session->mouseDefinition);
+    session->engine->setSensorNoise(session->sensorNoise);
+    SimulationEngine* engine = session->engine;
+    QObject::connect(
+        engine,
+        &SimulationEngine::centerReached,
+        [=](){
+            if (!session->isContest) {
+                end(session, RunStatus::SOLVED, QString());
+            }
+        }
+    );
+    QObject::connect(
+        engine,
+        &SimulationEngine::contestOver,
+        [=](){
+            if (!session->isContest) {
+                return;
+            }
+            if (0 <= engine->getContestScore().bestRun) {
+                end(session, RunStatus::SOLVED, QString());
+                return;
+            }
+            end(
+                session,
+                RunStatus::TIMEOUT,
+                "ran past the contest time limit"
+            );
+        }
+    );
+    QObject::connect(
+        engine,
+        &SimulationEngine::tickLimitReached,
+        [=](){
+            end(session, RunStatus::TIMEOUT, "ran past the tick limit");
+        }
+    );
+    QObject::connect(
+        engine,
+        &SimulationEngine::stepLimitReached,
+        [=](){
+            bool isCommandLimit =
+                0 <= session->commandLimit &&
+                session->commandLimit < engine->getNumCommands();
+            end(
+                session,
+                RunStatus::TIMEOUT,
+                isCommandLimit
+                ? "ran past the command limit"
+                : "ran past the move limit"
+            );
+        }
+    );
+}
+
+void PluginRun::end(Session* session, RunStatus status, const QString& error) {
+    // Only the first reason for ending counts
+    if (session->isOver) {
+        return;
+    }
+    session->isOver = true;
+    session->status = status;
+    session->error = error;
+    session->engine->stop();
+}
+
+void PluginRun::endOnTimeLimit(Session* session) {
+    // Unless it's already over, like any other reason
+    if (session->isOver) {
+        return;
+    }
+    end(session, RunStatus::TIMEOUT, "ran past the time limit");
+    session->isTimeLimited = true;
+}
+
+void PluginRun::endReturned(Session* session) {
+    // Does nothing if the run already ended for any other reason
+    bool isScored =
+        session->isContest &&
+        0 <= session->engine->getContestScore().bestRun;
+    end(
+        session,
+        isScored ? RunStatus::SOLVED : RunStatus::EXITED,
+        QString()
+    );
+}
+
+void PluginRun::cleanUp(Session* session) {
+    session->result = getResult(session);
+    delete session->engine;
+    session->engine = nullptr;
+    delete session->maze;
+    session->maze = nullptr;
+}
+
+RunResult PluginRun::getResult(Session* session) {
+    SimulationEngine* engine = session->engine;
+    RunResult result = HeadlessRun::getUnrunResult(
+        session->mazePath,
+        session->status,
+        session->error
+    );
+    result.isTimeLimited = session->isTimeLimited;
+    result.moves = engine->getNumMoves();
+    result.turns = engine->getNumTurns();
+    result.crashes = engine->getNumCrashes();
+    result.resets = engine->getEstimatedTrialSeconds().size() - 1;
+    result.seconds =
+        SimUtilities::getHighResTimestamp() - session->startTimestamp;
+    result.simulatedSeconds = engine->getSimulatedSeconds();
+    result.estimatedSeconds = engine->getEstimatedTrialSeconds().last();
+    result.ticks = engine->getClock().getTicks();
+    result.coverage = engine->getCoverage();
+    result.knownWalls = engine->getKnownWallStats();
+    result.contest = engine->getContestScore();
+
+    // Nothing crosses a pipe, and the plugin shares the simulator's process,
+    // so there's no telling its time or memory apart from the simulator's
+    result.stats.wallSeconds = result.seconds;
+    result.stats.cpuSeconds = -1.0;
+    result.stats.peakResidentBytes = -1;
+    result.stats.commands = engine->getNumCommands();
+    result.stats.commandsPerSecond =
+        0.0 < result.seconds ? result.stats.commands / result.seconds : 0.0;
+    return result;
+}
+
+QString PluginRun::execute(Session* session, const Command& command) {
+    if (session->isOver) {
+        return "";
+    }
+    session->callsUntilClockCheck -= 1;
+    if (session->callsUntilClockCheck <= 0) {
+        session->callsUntilClockCheck = CALLS_PER_CLOCK_CHECK;
+        double elapsed =
+            SimUtilities::getHighResTimestamp() - session->startTimestamp;
+        if (session->timeLimitSeconds < elapsed) {
+            endOnTimeLimit(session);
+            return "";
+        }
+    }
+    return session->engine->executeNow(command, getSpec(command.opcode));
+}
+
+Command PluginRun::getCommand(Opcode opcode) {
+    Command command;
+    command.opcode = opcode;
+    for (int i = 0; i < Command::MAX_INTS; i += 1) {
+        command.ints[i] = 0;
+    }
+    command.numInts = 0;
+    return command;
+}
+
+const CommandSpec* PluginRun::getSpec(Opcode opcode) {
+    static const QVector<const CommandSpec*> specs = [](){
+        QVector<const CommandSpec*> table(NUM_OPCODES, nullptr);
+        for (const CommandSpec& spec : COMMAND_SPECS()) {
+            table[static_cast<int>(spec.opcode)] = &spec;
+        }
+        return table;
+    }();
+    return specs.at(static_cast<int>(opcode));
+}
+
+int PluginRun::mazeWidth(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::MAZE_WIDTH)));
+}
+
+int PluginRun::mazeHeight(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::MAZE_HEIGHT)));
+}
+
+int PluginRun::wallFront(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::WALL_FRONT)));
+}
+
+int PluginRun::wallRight(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::WALL_RIGHT)));
+}
+
+int PluginRun::wallLeft(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::WALL_LEFT)));
+}
+
+int PluginRun::moveForward(void* context, int distance) {
+    Session* session = static_cast<Session*>(context);
+    Command command = getCommand(Opcode::MOVE_FORWARD);
+    command.ints[0] = distance;
+    command.numInts = 1;
+    return toMoved(execute(session, command));
+}
+
+int PluginRun::turnRight(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toMoved(execute(session, getCommand(Opcode::TURN_RIGHT)));
+}
+
+int PluginRun::turnLeft(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toMoved(execute(session, getCommand(Opcode::TURN_LEFT)));
+}
+
+void PluginRun::setWall(void* context, int x, int y, char direction) {
+    Session* session = static_cast<Session*>(context);
+    // Just like the parser, drop whatever isn't a direction
+    if (!IS_DIRECTION_CHAR(direction)) {
+        return;
+    }
+    Command command = getCommand(Opcode::SET_WALL);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    command.character = QChar(direction);
+    execute(session, command);
+}
+
+void PluginRun::clearWall(void* context, int x, int y, char direction) {
+    Session* session = static_cast<Session*>(context);
+    if (!IS_DIRECTION_CHAR(direction)) {
+        return;
+    }
+    Command command = getCommand(Opcode::CLEAR_WALL);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    command.character = QChar(direction);
+    execute(session, command);
+}
+
+void PluginRun::setColor(void* context, int x, int y, char color) {
+    Session* session = static_cast<Session*>(context);
+    if (!IS_COLOR_CHAR(QChar(color))) {
+        return;
+    }
+    Command command = getCommand(Opcode::SET_COLOR);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    command.character = QChar(color);
+    execute(session, command);
+}
+
+void PluginRun::clearColor(void* context, int x, int y) {
+    Session* session = static_cast<Session*>(context);
+    Command command = getCommand(Opcode::CLEAR_COLOR);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    execute(session, command);
+}
+
+void PluginRun::clearAllColor(void* context) {
+    Session* session = static_cast<Session*>(context);
+    execute(session, getCommand(Opcode::CLEAR_ALL_COLOR));
+}
+
+void PluginRun::setText(void* context, int x, int y, const char* text) {
+    Session* session = static_cast<Session*>(context);
+    if (text == nullptr) {
+        return;
+    }
+    Command command = getCommand(Opcode::SET_TEXT);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    command.text = QString::fromUtf8(text);
+    execute(session, command);
+}
+
+void PluginRun::clearText(void* context, int x, int y) {
+    Session* session = static_cast<Session*>(context);
+    Command command = getCommand(Opcode::CLEAR_TEXT);
+    command.ints[0] = x;
+    command.ints[1] = y;
+    command.numInts = 2;
+    execute(session, command);
+}
+
+void PluginRun::clearAllText(void* context) {
+    Session* session = static_cast<Session*>(context);
+    execute(session, getCommand(Opcode::CLEAR_ALL_TEXT));
+}
+
+int PluginRun::wasReset(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return toAnswer(execute(session, getCommand(Opcode::WAS_RESET)));
+}
+
+void PluginRun::ackReset(void* context) {
+    Session* session = static_cast<Session*>(context);
+    execute(session, getCommand(Opcode::ACK_RESET));
+}
+
+int PluginRun::isOver(void* context) {
+    Session* session = static_cast<Session*>(context);
+    return session->isOver ? 1 : 0;
+}
+
+int PluginRun::toAnswer(const QString& response) {
+    if (response.isEmpty()) {
+        return MMS_OVER;
+    }
+    if (response == "true") {
+        return 1;
+    }
+    if (response == "false") {
+        return 0;
+    }
+    return response.toInt();
+}
+
+int PluginRun::toMoved(const QString& response) {
+    if (response.isEmpty()) {
+        return MMS_OVER;
+    }
+    return response.startsWith(SimulationEngine::CRASH) ? 0 : 1;
+}
+
+} 
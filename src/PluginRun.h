@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <QLibrary>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "AlgoPlugin.h"
+#include "Command.h"
+#include "HeadlessRun.h"
+#include "Maze.h"
+#include "MouseDefinition.h"
+#include "SensorNoise.h"
+#include "SimulationEngine.h"
+
+namespace mms {
+
+class PluginRun : public QObject {
+
+    // Runs an algorithm that's a shared library (see AlgoPlugin.h) against a
+    // single maze, like a HeadlessRun does for an algorithm that's a process,
+    // and with the same limits. The plugin is called on a thread of its own,
+    // which also owns the engine, so that every call goes straight to the
+    // engine and back; the engine is always instant, and never continuous,
+    // so that every command is done by the time it returns. The run ends
+    // when the mouse first reaches the center (or, in a contest, once no
+    // more runs can count), when the plugin returns, or
+    // when a limit is reached, at which point the engine stops, and the
+    // plugin is told that the run is over. A plugin that still hasn't
+    // returned ABANDON_MS after its time limit is left to itself.
+    //
+    // A resumable plugin is stepped on the run's own thread instead, with
+    // the engine on that thread too: each turn of the event loop takes its
+    // steps for at most STEP_SLICE_SECONDS, and then yields to whatever else
+    // is running on the thread, e.g., the other runs of a batch, so that
+    // they all take turns. The run ends in the same ways, and the plugin's
+    // state is stopped as soon as it does, whether or not it was done.
+
+    Q_OBJECT
+
+public:
+
+    // Takes ownership of the maze
+    PluginRun(
+        const QString& mazePath,
+        Maze* maze,
+        const QString& libraryPath,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        QObject* parent = 0);
+    ~PluginRun();
+
+    // To be called before the run starts; negative limits are no limits
+    void setStepLimits(qint64 commandLimit, int moveLimit);
+
+    // Likewise; makes the run a contest, as for a HeadlessRun
+    void setContestRules(const ContestRules& rules);
+
+    // Likewise; the definition is shared with the plugin's thread
+    void setMouseDefinition(std::shared_ptr<const MouseDefinition> definition);
+
+    // Likewise; the walls that the plugin reads are misread by the noise
+    void setSensorNoise(const SensorNoise& noise);
+
+    void start();
+
+    // The result, once mazeFinished has been emitted
+    RunResult getResult() const;
+
+signals:
+
+    // Emitted once, just before finished, for parity with HeadlessRun
+    void mazeFinished();
+    void finished();
+
+private:
+
+    static const int ABANDON_MS;
+    static const double STEP_SLICE_SECONDS;
+
+    // How many calls go by between checks of the time limit
+    static const int CALLS_PER_CLOCK_CHECK;
+
+    // Everything that the plugin's thread uses, which lives for as long as
+    // either the run or the thread does, so that the run can give up on a
+    // plugin that never returns
+    struct Session {
+        QString mazePath;
+        Maze* maze;
+        QString libraryPath;
+        double timeLimitSeconds;
+        qint64 tickLimit;
+        qint64 commandLimit;
+        int moveLimit;
+        bool isContest;
+        ContestRules contestRules;
+        std::shared_ptr<const MouseDefinition> mouseDefinition;
+        SensorNoise sensorNoise;
+
+        // Only touched by the plugin's thread, once it has started
+        SimulationEngine* engine;
+        MmsApi api;
+        int callsUntilClockCheck;
+        double startTimestamp;
+        RunStatus status;
+        QString error;
+        bool isTimeLimited;
+        RunResult result;
+
+        // Whether the run is over, as the plugin is told; and, under the
+        // mutex, whether anyone is still waiting for the thread to finish
+        std::atomic<bool> isOver;
+        std::mutex mutex;
+        PluginRun* owner;
+    };
+
+    std::shared_ptr<Session> m_session;
+    std::thread m_thread;
+    QTimer* m_abandonTimer;
+    RunResult m_result;
+    bool m_isStarted;
+    bool m_isFinished;
+
+    // Only set for a resumable plugin, whose state is null once it's stopped
+    MmsStepFunction m_step;
+    MmsStopFunction m_stop;
+    void* m_state;
+
+    Q_INVOKABLE void onSessionEnded();
+    void abandon();
+
+    // Starts a resumable plugin, and takes its steps
+    void startResumable(QLibrary* library);
+    Q_INVOKABLE void resume();
+
+    // The body of the plugin's thread
+    static void run(std::shared_ptr<Session> session);
+    static void createEngine(Session* session);
+    static void end(Session* session, RunStatus status, const QString& error);
+    static void endOnTimeLimit(Session* session);
+
+    // Ends the run once the plugin is done, and then records the result and
+    // deletes the engine and the maze
+    static void endReturned(Session* session);
+    static void cleanUp(Session* session);
+    static RunResult getResult(Session* session);
+
+    // Does a single command, and returns its response, or an empty string if
+    // the run is over (or the command has no response)
+    static QString execute(Session* session, const Command& command);
+    static Command getCommand(Opcode opcode);
+    static const CommandSpec* getSpec(Opcode opcode);
+
+    // The functions of the API, each of which takes its session as context
+    static int mazeWidth(void* context);
+    static int mazeHeight(void* context);
+    static int wallFront(void* context);
+    static int wallRight(void* context);
+    static int wallLeft(void* context);
+    static int moveForward(void* context, int distance);
+    static int turnRight(void* context);
+    static int turnLeft(void* context);
+    static void setWall(void* context, int x, int y, char direction);
+    static void clearWall(void* context, int x, int y, char direction);
+    static void setColor(void* context, int x, int y, char color);
+    static void clearColor(void* context, int x, int y);
+    static void clearAllColor(void* context);
+    static void setText(void* context, int x, int y, const char* text);
+    static void clearText(void* context, int x, int y);
+    static void clearAllText(void* context);
+    static int wasReset(void* context);
+    static void ackReset(void* context);
+    static int isOver(void* context);
+
+    // Parses the response of a query, or of a movement
+    static int toAnswer(const QString& response);
+    static int toMoved(const QString& response);
+
+};
+
+} 
@@ -13,12 +13,12 @@ Polygon::Polygon() {
 }
 
 Polygon::Polygon(const Polygon& polygon) :
-    m_vertices(polygon.getVertices()) {
+    m_vertices(polygon.m_vertices) {
     // If the polygon being copyed has already been triangulated, we should
     // grab the triangles, lest we have to re-triangulate in the future. If not,
     // we can be lazy, in case the triangles for this polygon aren't needed.
     if (polygon.alreadyPerformedTriangulation()) {
-        m_triangles = polygon.getTriangles();
+        m_triangles = polygon.m_triangles;
     }
     else {
         // Uncomment to log untriangulated polygon copies
@@ -33,26 +33,26 @@ Polygon::Polygon(const Polygon& polygon) :
     }
 }
 
-Polygon::Polygon(QVector<Coordinate> vertices) :
-    m_vertices(vertices),
+Polygon::Polygon(const QVector<Coordinate>& vertices) {
     // Postpone triangulation until we absolutely have to do it.
-    m_triangles({}) {
+    m_vertices.append(vertices.constData(), vertices.size());
     ASSERT_LE(3, m_vertices.size());
     // If the number of vertices is three, the triangulation is trivial
     if (m_vertices.size() == 3) {
-        m_triangles = {{
+        Triangle triangle = {
             m_vertices.at(0),
             m_vertices.at(1),
             m_vertices.at(2),
-        }};
+        };
+        m_triangles.append(triangle);
     }
 }
 
-QVector<Coordinate> Polygon::getVertices() const {
+const Polygon::Vertices& Polygon::getVertices() const {
     return m_vertices;
 }
 
-QVector<Triangle> Polygon::getTriangles() const {
+const Polygon::Triangles& Polygon::getTriangles() const {
     // Lazy initialization here
     if (m_triangles.size() == 0) {
         m_triangles = triangulate(m_vertices);
@@ -61,44 +61,47 @@ QVector<Triangle> Polygon::getTriangles() const {
 }
 
 Polygon Polygon::translate(const Coordinate& translation) const {
-
-    QVector<Coordinate> vertices;
-    for (const Coordinate& vertex : m_vertices) {
-        vertices.append(GeometryUtilities::translateVertex(vertex, translation));
-    }
-
-    QVector<Triangle> triangles;
-    for (const Triangle& triangle : m_triangles) {
-        triangles.append({
-            GeometryUtilities::translateVertex(triangle.p1, translation),
-            GeometryUtilities::translateVertex(triangle.p2, translation),
-            GeometryUtilities::translateVertex(triangle.p3, translation),
-        });
-    }
-
-    return Polygon(vertices, triangles);
+    return transform(translation, Angle(), Coordinate());
 }
 
 Polygon Polygon::rotateAroundPoint(const Angle& angle, const Coordinate& point) const {
+    return transform(Coordinate(), angle, point);
+}
 
-    QVector<Coordinate> vertices;
-    for (const Coordinate& vertex : m_vertices) {
-        vertices.append(GeometryUtilities::rotateVertexAroundPoint(vertex, point, angle));
-    }
-
-    QVector<Triangle> triangles;
-    for (const Triangle& triangle : m_triangles) {
-        triangles.append({
-            GeometryUtilities::rotateVertexAroundPoint(triangle.p1, point, angle),
-            GeometryUtilities::rotateVertexAroundPoint(triangle.p2, point, angle),
-            GeometryUtilities::rotateVertexAroundPoint(triangle.p3, point, angle),
-        });
-    }
+Polygon Polygon::transform(
+        const Coordinate& translation,
+        const Angle& angle,
+        const Coordinate& point) const {
+
+    // Compute the sine and cosine once, rather than once per vertex
+    Rotation rotation(angle);
+
+    Vertices vertices(m_vertices.size());
+    GeometryUtilities::transformVertices(
+        m_vertices.constData(),
+        m_vertices.size(),
+        translation,
+        rotation,
+        point,
+        vertices.data());
+
+    // A triangle is just three consecutive coordinates
+    static_assert(
+        sizeof(Triangle) == 3 * sizeof(Coordinate),
+        "Triangles must be tightly packed coordinates");
+    Triangles triangles(m_triangles.size());
+    GeometryUtilities::transformVertices(
+        reinterpret_cast<const Coordinate*>(m_triangles.constData()),
+        3 * m_triangles.size(),
+        translation,
+        rotation,
+        point,
+        reinterpret_cast<Coordinate*>(triangles.data()));
 
     return Polygon(vertices, triangles);
 }
 
-Polygon::Polygon(QVector<Coordinate> vertices, QVector<Triangle> triangles) :
+Polygon::Polygon(const Vertices& vertices, const Triangles& triangles) :
     m_vertices(vertices),
     m_triangles(triangles) {
 }
@@ -107,7 +110,23 @@ bool Polygon::alreadyPerformedTriangulation() const {
     return 0 < m_triangles.size();
 }
 
-QVector<Triangle> Polygon::triangulate(QVector<Coordinate> vertices) {
+Polygon::Triangles Polygon::triangulate(const Vertices& vertices) {
+
+    // Fast path for convex polygons, emitting counterclockwise triangles just
+    // like the ear clipping does
+    int orientation = getConvexOrientation(vertices);
+    if (orientation != 0) {
+        Triangles triangles;
+        for (int i = 1; i + 1 < vertices.size(); i += 1) {
+            Triangle triangle = {
+                vertices.at(0),
+                vertices.at(orientation == 1 ? i : i + 1),
+                vertices.at(orientation == 1 ? i + 1 : i),
+            };
+            triangles.append(triangle);
+        }
+        return triangles;
+    }
 
     // Populate the TPPLPoly
     TPPLPoly tpplPoly;
@@ -123,17 +142,70 @@ QVector<Triangle> Polygon::triangulate(QVector<Coordinate> vertices) {
     std::list<TPPLPoly> result;
     triangulator.Triangulate_EC(&tpplPoly, &result);
 
-    // Populate the output vector
-    QVector<Triangle> triangles;
+    // Populate the output array
+    Triangles triangles;
     for (auto it = result.begin(); it != result.end(); it++) {
-        triangles.append({
+        Triangle triangle = {
             Coordinate::Cartesian(Distance::Meters((*it)[0].x), Distance::Meters((*it)[0].y)),
             Coordinate::Cartesian(Distance::Meters((*it)[1].x), Distance::Meters((*it)[1].y)),
             Coordinate::Cartesian(Distance::Meters((*it)[2].x), Distance::Meters((*it)[2].y)),
-        });
+        };
+        triangles.append(triangle);
     }
 
     return triangles;
 }
 
+int Polygon::getConvexOrientation(const Vertices& vertices) {
+
+    // A polygon is convex if it always turns the same way, and if its edges
+    // change horizontal and vertical direction at most twice each going
+    // around it (which rules out self-intersecting shapes like pentagrams)
+    int size = vertices.size();
+    int turn = 0;
+    int xFlips = 0;
+    int yFlips = 0;
+    int previousXSign = 0;
+    int previousYSign = 0;
+    for (int i = 0; i < 2 * size; i += 1) {
+        const Coordinate& a = vertices.at(i % size);
+        const Coordinate& b = vertices.at((i + 1) % size);
+        const Coordinate& c = vertices.at((i + 2) % size);
+        double dx = b.getX().getMeters() - a.getX().getMeters();
+        double dy = b.getY().getMeters() - a.getY().getMeters();
+        int xSign = (0.0 < dx) - (dx < 0.0);
+        int ySign = (0.0 < dy) - (dy < 0.0);
+        // The first time around only establishes the previous directions,
+        // so that the flip from the last edge to the first is counted
+        if (size <= i) {
+            double cross =
+                dx * (c.getY().getMeters() - b.getY().getMeters()) -
+                dy * (c.getX().getMeters() - b.getX().getMeters());
+            int sign = (0.0 < cross) - (cross < 0.0);
+            if (sign != 0) {
+                if (turn != 0 && sign != turn) {
+                    return 0;
+                }
+                turn = sign;
+            }
+            if (xSign != 0 && previousXSign != 0 && xSign != previousXSign) {
+                xFlips += 1;
+            }
+            if (ySign != 0 && previousYSign != 0 && ySign != previousYSign) {
+                yFlips += 1;
+            }
+        }
+        if (xSign != 0) {
+            previousXSign = xSign;
+        }
+        if (ySign != 0) {
+            previousYSign = ySign;
+        }
+    }
+    if (2 < xFlips || 2 < yFlips) {
+        return 0;
+    }
+    return turn;
+}
+
 } 
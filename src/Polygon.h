@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QVarLengthArray>
 #include <QVector>
 
 #include "Triangle.h"
@@ -12,38 +13,59 @@ class Polygon {
 
 public:
 
+    // Nearly all polygons are small (the mouse's body has five vertices), so
+    // vertices and triangles are stored inline, and only polygons with more
+    // than INLINE_VERTICES vertices allocate. The value is in the header,
+    // since it's a template argument.
+    static const int INLINE_VERTICES = 8;
+    typedef QVarLengthArray<Coordinate, INLINE_VERTICES> Vertices;
+    typedef QVarLengthArray<Triangle, INLINE_VERTICES - 2> Triangles;
+
     Polygon();
     Polygon(const Polygon& polygon);
-    Polygon(QVector<Coordinate> vertices);
+    Polygon(const QVector<Coordinate>& vertices);
 
-    QVector<Coordinate> getVertices() const;
-    QVector<Triangle> getTriangles() const;
+    const Vertices& getVertices() const;
+    const Triangles& getTriangles() const;
 
     Polygon translate(const Coordinate& translation) const;
     Polygon rotateAroundPoint(const Angle& angle, const Coordinate& point) const;
 
+    // Equivalent to translate(translation).rotateAroundPoint(angle, point),
+    // but transforms every vertex in a single pass
+    Polygon transform(
+        const Coordinate& translation,
+        const Angle& angle,
+        const Coordinate& point) const;
+
 private:
 
-    QVector<Coordinate> m_vertices;
+    Vertices m_vertices;
 
     // We're lazy about triangulation, since it's expensive and not always
     // necessary. The "mutable" keyword allows us to assign m_triangles in the
     // const function getTriangles().
-    mutable QVector<Triangle> m_triangles;
+    mutable Triangles m_triangles;
 
     // This special constructor makes it so that rotate and translate don't
     // require re-triangulation. We keep it private since it's pretty easy to
     // abuse the fact that the triangles argument should be the triangulation
     // of the polygon specified by the vertices argument.
-    Polygon(QVector<Coordinate> vertices, QVector<Triangle> triangles);
+    Polygon(const Vertices& vertices, const Triangles& triangles);
 
     // Tells us whether or not the polygon has already performed triangulation.
     // This is used in the copy constructor, and allows us to be lazy without
     // throwing away information.
     bool alreadyPerformedTriangulation() const;
 
-    // Actually peforms the triangulation of the polygon.
-    static QVector<Triangle> triangulate(QVector<Coordinate> vertices);
+    // Actually peforms the triangulation of the polygon. Convex polygons,
+    // which include every rectangle, are triangulated as a fan around their
+    // first vertex; anything else goes through ear clipping.
+    static Triangles triangulate(const Vertices& vertices);
+
+    // Returns 1 if the polygon is convex with counterclockwise vertices, -1
+    // if it's convex with clockwise vertices, and 0 if it isn't convex
+    static int getConvexOrientation(const Vertices& vertices);
 
 };
 
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mms {
+
+// How an algorithm's process is isolated from the others running at the
+// same time, so that their CPU times can be compared. Pinned processes each
+// get a CPU of their own, chosen by whoever starts them; the memory limit
+// bounds the process's address space; and the niceness lowers (or, with
+// privileges, raises) its priority.
+struct ProcessLimits {
+    bool isPinned;
+    qint64 memoryBytes; // negative for no limit
+    int niceness; // zero to leave the priority alone
+};
+
+} 
@@ -1,23 +1,274 @@
 #include "ProcessUtilities.h"
 
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
 #include <QStringList>
 
 namespace mms {
 
-bool ProcessUtilities::start(
-    const QString& command,
+void ProcessUtilities::start(
+    const QStringList& arguments,
     const QString& directory,
     QProcess* process
 ) {
-    QStringList args = command.split(' ', QString::SkipEmptyParts);
+    // An empty program fails to start, like any other missing program
+    QStringList args = arguments;
     QString bin;
     if (!args.isEmpty()) {
-        bin = args.at(0);
-        args.removeFirst();
+        bin = args.takeFirst();
     }
     process->setWorkingDirectory(directory);
     process->start(bin, args);
-    return process->waitForStarted();
+}
+
+QStringList ProcessUtilities::splitCommand(const QString& command) {
+    QStringList arguments;
+    QString argument;
+    int quoteCount = 0;
+    bool isInQuote = false;
+    for (QChar c : command) {
+        if (c == '"') {
+            quoteCount += 1;
+            if (quoteCount == 3) {
+                quoteCount = 0;
+                argument += c;
+            }
+            continue;
+        }
+        // A single quote opens or closes a group, a pair is nothing at all
+        if (quoteCount == 1) {
+            isInQuote = !isInQuote;
+        }
+        quoteCount = 0;
+        if (!isInQuote && c.isSpace()) {
+            if (!argument.isEmpty()) {
+                arguments.append(argument);
+                argument.clear();
+            }
+        }
+        else {
+            argument += c;
+        }
+    }
+    if (!argument.isEmpty()) {
+        arguments.append(argument);
+    }
+    return arguments;
+}
+
+QString ProcessUtilities::getBuildFingerprint(
+    const QString& command,
+    const QString& directory
+) {
+    // Sort the files, since the order of iteration isn't specified
+    QDir root(directory);
+    QStringList lines;
+    QDirIterator it(
+        directory,
+        QDir::Files | QDir::NoDotAndDotDot,
+        QDirIterator::Subdirectories
+    );
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        lines.append(
+            root.relativeFilePath(info.filePath()) + " " +
+            QString::number(info.size()) + " " +
+            QString::number(info.lastModified().toMSecsSinceEpoch())
+        );
+    }
+    lines.sort();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(command.toUtf8());
+    hash.addData(QDir(directory).absolutePath().toUtf8());
+    for (const QString& line : lines) {
+        hash.addData("\n");
+        hash.addData(line.toUtf8());
+    }
+    return QString(hash.result().toHex());
+}
+
+bool ProcessUtilities::getResourceUsage(
+    qint64 processId,
+    double* cpuSeconds,
+    qint64* peakResidentBytes
+) {
+#ifdef Q_OS_LINUX
+    // The times are the 14th and 15th fields of stat, in clock ticks; the
+    // name in the second field may contain spaces, so count from its end
+    QFile stat(QString("/proc/%1/stat").arg(processId));
+    if (!stat.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray contents = stat.readAll();
+    int nameEnd = contents.lastIndexOf(')');
+    if (nameEnd < 0) {
+        return false;
+    }
+    QList<QByteArray> fields = contents.mid(nameEnd + 2).split(' ');
+    if (fields.size() < 13) {
+        return false;
+    }
+    double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+    *cpuSeconds =
+        (fields.at(11).toLongLong() + fields.at(12).toLongLong()) /
+        ticksPerSecond;
+
+    // The peak is the "VmHWM" line of status, in kilobytes
+    QFile status(QString("/proc/%1/status").arg(processId));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    *peakResidentBytes = -1;
+    for (const QByteArray& line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            QList<QByteArray> parts = line.simplified().split(' ');
+            *peakResidentBytes = parts.value(1).toLongLong() * 1024;
+        }
+    }
+    return true;
+#else
+    Q_UNUSED(processId);
+    Q_UNUSED(cpuSeconds);
+    Q_UNUSED(peakResidentBytes);
+    return false;
+#endif
+}
+
+bool ProcessUtilities::applyLimits(
+    qint64 processId,
+    const ProcessLimits& limits,
+    int cpu,
+    QString* error
+) {
+#if defined(Q_OS_LINUX)
+    pid_t pid = static_cast<pid_t>(processId);
+    if (limits.isPinned) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(pid, sizeof(set), &set) != 0) {
+            *error = QString("unable to pin to cpu %1").arg(cpu);
+            return false;
+        }
+    }
+    if (0 <= limits.memoryBytes) {
+        struct rlimit limit;
+        limit.rlim_cur = static_cast<rlim_t>(limits.memoryBytes);
+        limit.rlim_max = static_cast<rlim_t>(limits.memoryBytes);
+        if (prlimit(pid, RLIMIT_AS, &limit, nullptr) != 0) {
+            *error = "unable to limit memory";
+            return false;
+        }
+    }
+    if (limits.niceness != 0) {
+        if (setpriority(PRIO_PROCESS, pid, limits.niceness) != 0) {
+            *error = "unable to set the nice value";
+            return false;
+        }
+    }
+    return true;
+#elif defined(Q_OS_WIN)
+    HANDLE process = OpenProcess(
+        PROCESS_SET_INFORMATION | PROCESS_SET_QUOTA | PROCESS_TERMINATE |
+            PROCESS_QUERY_INFORMATION,
+        FALSE,
+        static_cast<DWORD>(processId)
+    );
+    if (process == NULL) {
+        *error = "unable to open the process";
+        return false;
+    }
+    bool isApplied = true;
+    if (limits.isPinned) {
+        DWORD_PTR mask = static_cast<DWORD_PTR>(1) << cpu;
+        if (!SetProcessAffinityMask(process, mask)) {
+            *error = QString("unable to pin to cpu %1").arg(cpu);
+            isApplied = false;
+        }
+    }
+
+    // The job outlives its handle for as long as the process is in it
+    if (isApplied && 0 <= limits.memoryBytes) {
+        HANDLE job = CreateJobObject(NULL, NULL);
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION information = {};
+        information.BasicLimitInformation.LimitFlags =
+            JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+        information.ProcessMemoryLimit =
+            static_cast<SIZE_T>(limits.memoryBytes);
+        if (
+            job == NULL ||
+            !SetInformationJobObject(
+                job,
+                JobObjectExtendedLimitInformation,
+                &information,
+                sizeof(information)) ||
+            !AssignProcessToJobObject(job, process)
+        ) {
+            *error = "unable to limit memory";
+            isApplied = false;
+        }
+        if (job != NULL) {
+            CloseHandle(job);
+        }
+    }
+
+    // Windows only has priority classes, so positive niceness is below
+    // normal, and negative is above
+    if (isApplied && limits.niceness != 0) {
+        DWORD priority = 0 < limits.niceness
+            ? BELOW_NORMAL_PRIORITY_CLASS
+            : ABOVE_NORMAL_PRIORITY_CLASS;
+        if (!SetPriorityClass(process, priority)) {
+            *error = "unable to set the priority class";
+            isApplied = false;
+        }
+    }
+    CloseHandle(process);
+    return isApplied;
+#else
+    Q_UNUSED(processId);
+    Q_UNUSED(cpu);
+    if (limits.isPinned || 0 <= limits.memoryBytes || limits.niceness != 0) {
+        *error = "process limits aren't supported on this platform";
+        return false;
+    }
+    return true;
+#endif
+}
+
+QString ProcessUtilities::limitsToString(
+    const ProcessLimits& limits,
+    int cpu
+) {
+    QStringList parts;
+    if (limits.isPinned) {
+        parts.append(QString("cpu %1").arg(cpu));
+    }
+    if (0 <= limits.memoryBytes) {
+        parts.append(QString("%1 MiB").arg(limits.memoryBytes / 1048576));
+    }
+    if (limits.niceness != 0) {
+        parts.append(QString("nice %1").arg(limits.niceness));
+    }
+    return parts.join(", ");
+}
+
+ProcessLimits ProcessUtilities::getNoLimits() {
+    return {false, -1, 0};
 }
 
 } 
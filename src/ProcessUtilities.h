@@ -2,6 +2,9 @@
 
 #include <QProcess>
 #include <QString>
+#include <QStringList>
+
+#include "ProcessLimits.h"
 
 namespace mms {
 
@@ -11,10 +14,53 @@ public:
 
     ProcessUtilities() = delete;
 
-    static bool start(
-        const QString& command,
+    // Starts the first argument as a program, with the rest as its
+    // arguments, without waiting for it to start; whether it did is told by
+    // the process's started or errorOccurred signal (either of which may be
+    // emitted before this returns, so connect to them first)
+    static void start(
+        const QStringList& arguments,
         const QString& directory,
         QProcess* process);
+
+    // Splits a command into arguments the way that QProcess does: arguments
+    // are separated by whitespace, double quotes group arguments with spaces,
+    // and three consecutive double quotes are a literal double quote
+    static QStringList splitCommand(const QString& command);
+
+    // Fingerprints a build from its command, and from the relative path,
+    // size and modification time of every file in the directory (except
+    // hidden ones); if the fingerprint hasn't changed since the last
+    // successful build, building again would be redundant
+    static QString getBuildFingerprint(
+        const QString& command,
+        const QString& directory);
+
+    // Reads the CPU time (user and system) that a running process has used
+    // so far, and the peak of its resident set size; returns false if the
+    // process is gone, or if this isn't supported on this platform
+    static bool getResourceUsage(
+        qint64 processId,
+        double* cpuSeconds,
+        qint64* peakResidentBytes);
+
+    // Isolates a running process: on Linux, by its CPU affinity, the limit
+    // on its address space and its nice value; on Windows, by its affinity,
+    // a job object's memory limit and its priority class. The CPU is only
+    // used if the process is to be pinned. Returns false, and why, if any
+    // limit couldn't be applied, or isn't supported on this platform.
+    static bool applyLimits(
+        qint64 processId,
+        const ProcessLimits& limits,
+        int cpu,
+        QString* error);
+
+    // What applyLimits applied, as recorded with the results, e.g.
+    // "cpu 3, 512 MiB, nice 10", or empty if there were no limits
+    static QString limitsToString(const ProcessLimits& limits, int cpu);
+
+    // No isolation at all
+    static ProcessLimits getNoLimits();
 };
 
 } 
@@ -0,0 +1,299 @@
+#include "ProcessWorker.h"
+
+#include <QMetaObject>
+
+#include "AssertMacros.h"
+#include "CommandParser.h"
+#include "ProcessUtilities.h"
+#include "Profiler.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const int ProcessWorker::QUEUE_CAPACITY = 4096;
+const qint64 ProcessWorker::SOCKET_BUFFER_BYTES = 64 * 1024;
+const double ProcessWorker::CONSUMER_SLICE_SECONDS = 0.002;
+
+ProcessWorker::ProcessWorker() :
+    QObject(nullptr),
+    m_process(nullptr),
+    m_server(nullptr),
+    m_socket(nullptr),
+    m_logFramer(LineFramer()),
+    m_commandFramer(LineFramer()),
+    m_commandLine(QString()),
+    m_readTimestamp(0.0),
+    m_queue(QUEUE_CAPACITY),
+    m_isNotified(false),
+    m_numBytesRead(0),
+    m_pending(ParsedCommand()),
+    m_hasPending(false),
+    m_isStalled(false) {
+    qRegisterMetaType<QProcess::ExitStatus>("QProcess::ExitStatus");
+}
+
+void ProcessWorker::start(
+        const QStringList& arguments,
+        const QString& directory) {
+
+    // Make sure the process is created on (and thus owned by) this thread
+    ASSERT_TR(m_process == nullptr);
+    ASSERT_TR(m_server == nullptr);
+    m_process = new PipedProcess(this);
+
+    connect(
+        m_process,
+        &QProcess::readyReadStandardError,
+        this,
+        &ProcessWorker::onStandardError
+    );
+    if (m_process->isPiped()) {
+        connect(
+            m_process,
+            &PipedProcess::outputReady,
+            this,
+            &ProcessWorker::onPipeOutput
+        );
+    }
+    else {
+        connect(
+            m_process,
+            &QProcess::readyReadStandardOutput,
+            this,
+            &ProcessWorker::onStandardOutput
+        );
+    }
+    connect(
+        m_process,
+        static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(
+            &QProcess::finished
+        ),
+        this,
+        &ProcessWorker::onProcessFinished
+    );
+
+    // A process that fails to start never finishes, so this is its only
+    // notification of any kind; other errors are followed by finished()
+    connect(m_process, &QProcess::started, this, [=](){
+        emit started(m_process->processId());
+    });
+    connect(
+        m_process,
+        &QProcess::errorOccurred,
+        this,
+        [=](QProcess::ProcessError error){
+            if (error == QProcess::FailedToStart) {
+                emit failedToStart(m_process->errorString());
+            }
+        }
+    );
+
+    ProcessUtilities::start(arguments, directory, m_process);
+}
+
+void ProcessWorker::listen(int port) {
+
+    // Likewise, the server and the socket belong to this thread
+    ASSERT_TR(m_process == nullptr);
+    ASSERT_TR(m_server == nullptr);
+    m_server = new QTcpServer(this);
+    connect(
+        m_server,
+        &QTcpServer::newConnection,
+        this,
+        &ProcessWorker::onConnection
+    );
+    if (!m_server->listen(QHostAddress::Any, static_cast<quint16>(port))) {
+        emit failedToStart(QString("Unable to listen on port %1: %2").arg(
+            QString::number(port),
+            m_server->errorString()
+        ));
+    }
+}
+
+void ProcessWorker::write(const QByteArray& bytes) {
+    if (m_socket != nullptr) {
+        m_socket->write(bytes);
+        m_socket->flush();
+        return;
+    }
+    if (m_process == nullptr) {
+        return;
+    }
+    m_process->write(bytes);
+}
+
+void ProcessWorker::kill() {
+    if (m_server != nullptr) {
+        m_server->close();
+    }
+    if (m_socket != nullptr) {
+        // Nobody's listening for the disconnection anymore
+        m_socket->disconnect(this);
+        m_socket->abort();
+    }
+    if (m_process == nullptr) {
+        return;
+    }
+    m_process->kill();
+    m_process->waitForFinished();
+}
+
+bool ProcessWorker::takeCommand(ParsedCommand* parsed) {
+
+    // Clear the flag before looking at the queue, so that anything pushed
+    // after this point results in another notification
+    m_isNotified.store(false);
+    if (!m_queue.pop(parsed)) {
+        return false;
+    }
+
+    // Now that there's room, let the worker pick up where it left off
+    if (m_isStalled.exchange(false)) {
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+qint64 ProcessWorker::takeNumBytesRead() {
+    return m_numBytesRead.exchange(0);
+}
+
+void ProcessWorker::onStandardError() {
+    m_logFramer.append(m_process->readAllStandardError());
+    QStringList logs;
+    QString log;
+    while (m_logFramer.nextLine(&log)) {
+        logs.append(log);
+    }
+    if (!logs.isEmpty()) {
+        emit logsReady(logs);
+    }
+}
+
+void ProcessWorker::onStandardOutput() {
+    onOutput(m_process->readAllStandardOutput());
+}
+
+void ProcessWorker::onPipeOutput() {
+    onOutput(m_process->readOutput());
+}
+
+void ProcessWorker::onProcessFinished(
+        int exitCode,
+        QProcess::ExitStatus exitStatus) {
+
+    // Whatever's still in the pipe was written before the process finished,
+    // and there's no more than a pipe's worth of it, so read it even if the
+    // queue is full
+    if (m_process->isPiped()) {
+        QByteArray output = m_process->readOutput();
+        while (!output.isEmpty()) {
+            onOutput(output);
+            output = m_process->readOutput();
+        }
+    }
+    emit finished(exitCode, exitStatus);
+}
+
+void ProcessWorker::onConnection() {
+
+    // Only the first algorithm to connect is run; the rest are refused
+    m_socket = m_server->nextPendingConnection();
+    m_server->close();
+    if (m_socket == nullptr) {
+        return;
+    }
+    m_socket->setParent(this);
+    m_socket->setReadBufferSize(SOCKET_BUFFER_BYTES);
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    m_socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+    connect(
+        m_socket,
+        &QTcpSocket::readyRead,
+        this,
+        &ProcessWorker::onSocketOutput
+    );
+    connect(m_socket, &QTcpSocket::disconnected, this, [=](){
+        emit finished(0, QProcess::NormalExit);
+    });
+    emit started(0);
+
+    // The algorithm may have had something to say right away
+    onSocketOutput();
+}
+
+void ProcessWorker::onSocketOutput() {
+    // Leave the rest in the buffer, which stops filling once it's full
+    if (m_hasPending) {
+        return;
+    }
+    onOutput(m_socket->readAll());
+}
+
+void ProcessWorker::onOutput(const QByteArray& output) {
+    m_readTimestamp = SimUtilities::getHighResTimestamp();
+    m_numBytesRead.fetch_add(output.size());
+    m_commandFramer.append(output);
+    drain();
+}
+
+void ProcessWorker::drain() {
+    PROFILE_ZONE("ProcessWorker::drain");
+    if (m_hasPending) {
+        if (!push(m_pending)) {
+            return;
+        }
+        m_hasPending = false;
+    }
+    while (m_commandFramer.nextLine(&m_commandLine)) {
+        ParsedCommand parsed;
+        parsed.spec = CommandParser::parse(m_commandLine, &parsed.command);
+        parsed.receivedTimestamp = m_readTimestamp;
+        // Malformed lines could only ever get an invalid response
+        if (parsed.spec == nullptr) {
+            continue;
+        }
+        if (!push(parsed)) {
+            m_pending = parsed;
+            m_hasPending = true;
+            setOutputPaused(true);
+            return;
+        }
+    }
+    setOutputPaused(false);
+}
+
+void ProcessWorker::setOutputPaused(bool paused) {
+    if (m_process != nullptr) {
+        m_process->setOutputPaused(paused);
+    }
+
+    // Whatever the connection buffered in the meantime won't be announced
+    // again, so read it on the next turn of the event loop
+    if (!paused && m_socket != nullptr && 0 < m_socket->bytesAvailable()) {
+        QMetaObject::invokeMethod(
+            this,
+            "onSocketOutput",
+            Qt::QueuedConnection
+        );
+    }
+}
+
+bool ProcessWorker::push(const ParsedCommand& parsed) {
+    if (!m_queue.push(parsed)) {
+        m_isStalled.store(true);
+        // The consumer may have emptied the queue in the meantime, in which
+        // case it won't see the stall; try once more to avoid getting stuck
+        if (!m_queue.push(parsed)) {
+            return false;
+        }
+        m_isStalled.store(false);
+    }
+    if (!m_isNotified.exchange(true)) {
+        emit commandsAvailable();
+    }
+    return true;
+}
+
+} 
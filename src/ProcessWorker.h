@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "Command.h"
+#include "LineFramer.h"
+#include "PipedProcess.h"
+#include "SpscQueue.h"
+
+namespace mms {
+
+struct ParsedCommand {
+    Command command;
+    const CommandSpec* spec;
+    double receivedTimestamp; // when the output that completed it was read
+};
+
+class ProcessWorker : public QObject {
+
+    // Owns an algorithm process and does all of the reading, framing, and
+    // parsing of its output on the thread it lives on, so that a busy GUI
+    // thread doesn't slow down command intake. Parsed commands are handed to
+    // the thread that created the worker through a lock-free queue.
+    //
+    // The queue is bounded: once it's full, the worker stops reading, and
+    // whatever the algorithm writes next piles up in the pipe (or in the
+    // connection's buffers) until the algorithm's writes block, so that
+    // memory is bounded however fast the algorithm writes. Reading resumes
+    // as soon as the consumer makes room.
+    //
+    // Instead of a process, the worker may listen for a single algorithm to
+    // connect over TCP, e.g., from another machine or from a robot's own
+    // board, and speak the same protocol over the connection. Nagle's
+    // algorithm is disabled, and every response is flushed as soon as it's
+    // written, so that each round trip costs only the network's latency.
+    // The connection stands in for the process: it "starts" once the
+    // algorithm connects (with no process id, i.e., zero), and "finishes"
+    // once either end closes it; there are no logs.
+
+    Q_OBJECT
+
+public:
+
+    ProcessWorker();
+
+    // To be invoked on the worker's thread (e.g., with a queued connection);
+    // start() doesn't wait for the process, which emits either started() or
+    // failedToStart() once it's known whether it could be started
+    Q_INVOKABLE void start(
+        const QStringList& arguments,
+        const QString& directory);
+    Q_INVOKABLE void listen(int port);
+    Q_INVOKABLE void write(const QByteArray& bytes);
+    Q_INVOKABLE void kill();
+
+    // Consumer side, for the creating thread only
+    bool takeCommand(ParsedCommand* parsed);
+
+    // Consumers on a GUI thread should stop taking commands once they've
+    // spent this long at it, and take the rest on the next turn of the event
+    // loop, so that a flood of commands can't keep the window from
+    // responding or the map from being drawn
+    static const double CONSUMER_SLICE_SECONDS;
+
+    // The number of bytes read from stdout since the last call; may be
+    // called from any thread
+    qint64 takeNumBytesRead();
+
+signals:
+
+    void started(qint64 processId);
+    void failedToStart(const QString& error);
+
+    void logsReady(const QStringList& logs);
+
+    // Emitted when commands become available after the queue has been
+    // drained; consumers should take commands until there are none left
+    void commandsAvailable();
+
+    void finished(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+
+    static const int QUEUE_CAPACITY;
+
+    // How much of the connection is buffered before it's read, which is
+    // also all that's buffered while the queue is full
+    static const qint64 SOCKET_BUFFER_BYTES;
+
+    PipedProcess* m_process;
+    QTcpServer* m_server;
+    QTcpSocket* m_socket;
+    LineFramer m_logFramer;
+    LineFramer m_commandFramer;
+    QString m_commandLine; // reused, so that decoding doesn't allocate
+    double m_readTimestamp;
+
+    SpscQueue<ParsedCommand> m_queue;
+    std::atomic<bool> m_isNotified;
+    std::atomic<qint64> m_numBytesRead;
+
+    // If the queue fills up, the command that didn't fit is held here, and
+    // parsing and reading stop until the consumer makes room
+    ParsedCommand m_pending;
+    bool m_hasPending;
+    std::atomic<bool> m_isStalled;
+
+    void onStandardError();
+    void onStandardOutput();
+    void onPipeOutput();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onConnection();
+    Q_INVOKABLE void onSocketOutput();
+    void onOutput(const QByteArray& output);
+    void setOutputPaused(bool paused);
+    Q_INVOKABLE void drain();
+    bool push(const ParsedCommand& parsed);
+
+};
+
+} 
@@ -0,0 +1,185 @@
+#include "Profiler.h"
+
+#include <chrono>
+
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+
+namespace mms {
+
+const int Profiler::EVENTS_PER_THREAD = 64 * 1024;
+
+std::atomic<bool> Profiler::IS_ENABLED(false);
+
+void Profiler::setEnabled(bool enabled) {
+    // Start the clock now, rather than with the first zone
+    now();
+    IS_ENABLED.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled() {
+    return IS_ENABLED.load(std::memory_order_relaxed);
+}
+
+qint64 Profiler::now() {
+    static const std::chrono::steady_clock::time_point epoch =
+        std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch
+    ).count();
+}
+
+void Profiler::record(const char* name, qint64 start, qint64 end) {
+    record(getRing(), name, start, end);
+}
+
+void Profiler::recordOnTrack(
+        const QString& track,
+        const char* name,
+        qint64 start,
+        qint64 end) {
+    record(getTrackRing(track), name, start, end);
+}
+
+void Profiler::record(Ring* ring, const char* name, qint64 start, qint64 end) {
+    // Only ever contended while the rings are being written, or by another
+    // thread that records on the same track
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    ring->events[ring->next] = {name, start, end - start};
+    ring->next += 1;
+    if (ring->next == ring->events.size()) {
+        ring->next = 0;
+        ring->isFull = true;
+    }
+}
+
+bool Profiler::write(const QString& path) {
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    // Each ring is only locked for as long as it takes to copy it
+    QVector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(RINGS_MUTEX());
+        rings = RINGS();
+    }
+    bool isFirst = true;
+    for (Ring* ring : rings) {
+        QVector<ProfileEvent> events;
+        QString threadName;
+        {
+            std::lock_guard<std::mutex> lock(ring->mutex);
+            threadName = ring->threadName;
+            if (ring->isFull) {
+                events = ring->events.mid(ring->next);
+            }
+            events += ring->events.mid(0, ring->next);
+        }
+        if (!isFirst) {
+            stream << ",";
+        }
+        isFirst = false;
+        stream
+            << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << ring->threadId << ",\"args\":{\"name\":\"" << threadName
+            << "\"}}";
+
+        // Timestamps are in microseconds, to the nanosecond
+        for (const ProfileEvent& event : events) {
+            stream
+                << ",\n{\"name\":\"" << event.name
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+                << ",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+                << ",\"dur\":"
+                << QString::number(event.duration / 1000.0, 'f', 3) << "}";
+        }
+    }
+    stream << "\n]}\n";
+    stream.flush();
+    return file.commit();
+}
+
+std::mutex& Profiler::RINGS_MUTEX() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+QVector<Profiler::Ring*>& Profiler::RINGS() {
+    static QVector<Ring*> rings;
+    return rings;
+}
+
+Profiler::Ring* Profiler::getRing() {
+
+    static thread_local Ring* ring = nullptr;
+    if (ring != nullptr) {
+        return ring;
+    }
+
+    // Named threads keep their names; the rest are numbered, in the order
+    // that they first recorded a zone
+    std::lock_guard<std::mutex> lock(RINGS_MUTEX());
+    QThread* thread = QThread::currentThread();
+    if (!thread->objectName().isEmpty()) {
+        ring = newRing(thread->objectName());
+    }
+    else if (
+        QCoreApplication::instance() != nullptr &&
+        thread == QCoreApplication::instance()->thread()
+    ) {
+        ring = newRing("main");
+    }
+    else {
+        ring = newRing(QString("thread %1").arg(RINGS().size() + 1));
+    }
+    return ring;
+}
+
+Profiler::Ring* Profiler::getTrackRing(const QString& track) {
+
+    // There are only ever a few rings, so they're just searched
+    std::lock_guard<std::mutex> lock(RINGS_MUTEX());
+    for (Ring* ring : RINGS()) {
+        if (ring->isTrack && ring->threadName == track) {
+            return ring;
+        }
+    }
+    Ring* ring = newRing(track);
+    ring->isTrack = true;
+    return ring;
+}
+
+Profiler::Ring* Profiler::newRing(const QString& name) {
+    // Only called with the rings locked
+    Ring* ring = new Ring();
+    ring->events.resize(EVENTS_PER_THREAD);
+    ring->next = 0;
+    ring->isFull = false;
+    ring->threadId = RINGS().size() + 1;
+    ring->threadName = name;
+    ring->isTrack = false;
+    RINGS().append(ring);
+    return ring;
+}
+
+ProfileZone::ProfileZone(const char* name) :
+    m_name(name),
+    m_start(Profiler::isEnabled() ? Profiler::now() : -1) {
+}
+
+ProfileZone::~ProfileZone() {
+    if (m_start < 0) {
+        return;
+    }
+    Profiler::record(m_name, m_start, Profiler::now());
+}
+
+} 
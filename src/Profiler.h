@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include <QString>
+#include <QVector>
+
+namespace mms {
+
+// A span of time spent in a zone, in nanoseconds since the profiler's epoch;
+// the name points to a string literal, so it's never copied
+struct ProfileEvent {
+    const char* name;
+    qint64 start;
+    qint64 duration;
+};
+
+class Profiler {
+
+    // A scoped-zone profiler that's always compiled in, but records nothing
+    // until it's enabled, so that a zone costs a single atomic load when it's
+    // off. Each thread records its zones into a ring of its own, holding its
+    // last EVENTS_PER_THREAD zones, so recording never contends with other
+    // threads and never allocates once the ring exists. Writing copies every
+    // ring out as a Chrome trace (the JSON that chrome://tracing and Perfetto
+    // open), with one track per thread, and may be done at any time, e.g.,
+    // whenever something looks slow. Rings outlive their threads, so zones
+    // of threads that have since finished are written too.
+
+public:
+
+    Profiler() = delete;
+
+    static const int EVENTS_PER_THREAD;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Nanoseconds since the profiler's epoch, i.e., its first use
+    static qint64 now();
+
+    // Records a zone for the calling thread
+    static void record(const char* name, qint64 start, qint64 end);
+
+    // Records a zone on a track of its own, by name, rather than on the
+    // calling thread's, for time that isn't spent in any of the simulator's
+    // threads, e.g., in an algorithm's process
+    static void recordOnTrack(
+        const QString& track,
+        const char* name,
+        qint64 start,
+        qint64 end);
+
+    // Returns false if the file can't be written
+    static bool write(const QString& path);
+
+private:
+
+    struct Ring {
+        std::mutex mutex;
+        QVector<ProfileEvent> events;
+        int next;
+        bool isFull;
+        int threadId;
+        QString threadName;
+        bool isTrack;
+    };
+
+    static std::atomic<bool> IS_ENABLED;
+
+    // Every ring ever created, in the order that their threads first
+    // recorded a zone
+    static std::mutex& RINGS_MUTEX();
+    static QVector<Ring*>& RINGS();
+
+    static Ring* getRing();
+    static Ring* getTrackRing(const QString& track);
+    static Ring* newRing(const QString& name);
+    static void record(Ring* ring, const char* name, qint64 start, qint64 end);
+
+};
+
+class ProfileZone {
+
+    // Records the time from its construction to its destruction as a zone,
+    // if the profiler was enabled when it was constructed
+
+public:
+
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+private:
+
+    const char* m_name;
+    qint64 m_start;
+
+};
+
+// Profiles the rest of the enclosing scope, under the given name
+#define PROFILE_ZONE(name) mms::ProfileZone profileZone(name)
+
+} 
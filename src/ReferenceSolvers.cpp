@@ -0,0 +1,458 @@
+#include "ReferenceSolvers.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <QPair>
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+#include "RunTimeModel.h"
+
+namespace mms {
+
+// The displacement of a step in each direction, by the value of the
+// Direction; turning right adds one to the value, turning left subtracts one
+static const int DX[] = {0, 1, 0, -1};
+static const int DY[] = {1, 0, -1, 0};
+
+// A command without arguments, as an algorithm would have sent it
+static Command getCommand(Opcode opcode) {
+    Command command;
+    command.opcode = opcode;
+    for (int i = 0; i < Command::MAX_INTS; i += 1) {
+        command.ints[i] = 0;
+    }
+    command.numInts = 0;
+    return command;
+}
+
+std::mutex ReferenceSolvers::FASTEST_PATH_MUTEX;
+QMap<quint64, ReferenceResult> ReferenceSolvers::FASTEST_PATH_CACHE;
+
+class ReferenceSolvers::Walker {
+
+    // The mouse of a single solver; directions are handled by their values,
+    // so that each step is only a bit of arithmetic
+
+public:
+
+    Walker(const Maze* maze) :
+        m_maze(maze),
+        m_x(0),
+        m_y(0),
+        m_heading(static_cast<int>(Direction::NORTH)),
+        m_moves(0),
+        m_turns(0),
+        m_model(RunTimeModel()),
+        m_tileLength(Dimensions::tileLength().getMeters()),
+        m_commands(nullptr) {
+    }
+
+    // Every step is appended to the commands from now on, if there are any
+    void setCommands(QVector<Command>* commands) {
+        m_commands = commands;
+    }
+
+    const Maze* getMaze() const {
+        return m_maze;
+    }
+
+    int getX() const {
+        return m_x;
+    }
+
+    int getY() const {
+        return m_y;
+    }
+
+    int getHeading() const {
+        return m_heading;
+    }
+
+    bool isWall(int direction) const {
+        return m_maze->isWall(m_x, m_y, static_cast<Direction>(direction));
+    }
+
+    bool isInCenter() const {
+        return m_maze->getDistance(m_x, m_y) == 0;
+    }
+
+    int getMoves() const {
+        return m_moves;
+    }
+
+    // Turns to face the direction, and then moves a cell forward
+    void step(int direction) {
+        int quarterTurns = (direction - m_heading + 4) % 4;
+        int numTurns = quarterTurns == 3 ? 1 : quarterTurns;
+        for (int i = 0; i < numTurns; i += 1) {
+            m_model.addTurn();
+        }
+        m_turns += numTurns;
+        m_heading = direction;
+        ASSERT_FA(isWall(direction));
+        m_x += DX[direction];
+        m_y += DY[direction];
+        m_moves += 1;
+        m_model.addStraight(m_tileLength);
+        if (m_commands != nullptr) {
+            Opcode turn = quarterTurns == 3 ? Opcode::TURN_LEFT :
+                Opcode::TURN_RIGHT;
+            for (int i = 0; i < numTurns; i += 1) {
+                m_commands->append(getCommand(turn));
+            }
+            m_commands->append(getCommand(Opcode::MOVE_FORWARD));
+        }
+    }
+
+    ReferenceResult getResult(const QString& name) const {
+        return {name, isInCenter(), m_moves, m_turns, m_model.getSeconds()};
+    }
+
+private:
+
+    const Maze* m_maze;
+    int m_x;
+    int m_y;
+    int m_heading;
+    int m_moves;
+    int m_turns;
+    RunTimeModel m_model;
+    double m_tileLength;
+    QVector<Command>* m_commands;
+};
+
+QStringList ReferenceSolvers::names() {
+    return {"leftWallFollow", "floodFill", "shortestPath", "fastestPath"};
+}
+
+ReferenceResult ReferenceSolvers::solve(const QString& name, const Maze* maze) {
+    // The only solver that takes more than microseconds, so it's cached
+    if (name == "fastestPath") {
+        return getFastestPath(maze);
+    }
+    Walker walker(maze);
+    drive(name, &walker);
+    return walker.getResult(name);
+}
+
+QVector<Command> ReferenceSolvers::getCommands(
+        const QString& name,
+        const Maze* maze) {
+    QVector<Command> commands;
+    Walker walker(maze);
+    walker.setCommands(&commands);
+    drive(name, &walker);
+    return commands;
+}
+
+void ReferenceSolvers::drive(const QString& name, Walker* walker) {
+    if (name == "leftWallFollow") {
+        leftWallFollow(walker);
+    }
+    else if (name == "floodFill") {
+        floodFill(walker);
+    }
+    else if (name == "shortestPath") {
+        shortestPath(walker);
+    }
+    else if (name == "fastestPath") {
+        fastestPath(walker);
+    }
+    else {
+        ASSERT_NEVER_RUNS();
+    }
+}
+
+QVector<ReferenceResult> ReferenceSolvers::solveAll(const Maze* maze) {
+    QVector<ReferenceResult> results;
+    for (const QString& name : names()) {
+        results.append(solve(name, maze));
+    }
+    return results;
+}
+
+void ReferenceSolvers::leftWallFollow(Walker* walker) {
+
+    // Once every cell has been left in every direction, the mouse is going
+    // around in circles, e.g., around an island with the center in it
+    const Maze* maze = walker->getMaze();
+    int limit = 4 * maze->getWidth() * maze->getHeight();
+    while (!walker->isInCenter() && walker->getMoves() < limit) {
+        for (int turn : {3, 0, 1, 2}) {
+            int direction = (walker->getHeading() + turn) % 4;
+            if (!walker->isWall(direction)) {
+                walker->step(direction);
+                break;
+            }
+        }
+    }
+}
+
+void ReferenceSolvers::floodFill(Walker* walker) {
+
+    const Maze* maze = walker->getMaze();
+    int width = maze->getWidth();
+    int height = maze->getHeight();
+    int numCells = width * height;
+
+    // The walls that the mouse has seen, four bits per cell, by the value of
+    // the Direction, and the distance of every cell from the center as far
+    // as the mouse knows, i.e., as if every wall it hasn't seen were open
+    QVector<unsigned char> known(numCells, 0);
+    QVector<int> distances(numCells, -1);
+    QVector<int> queue;
+    for (const QPair<int, int>& center :
+            Maze::getCenterPositions(width, height)) {
+        int cell = center.first * height + center.second;
+        distances[cell] = 0;
+        queue.append(cell);
+    }
+    for (int i = 0; i < queue.size(); i += 1) {
+        int cell = queue.at(i);
+        int x = cell / height;
+        int y = cell % height;
+        for (int direction = 0; direction < 4; direction += 1) {
+            int nx = x + DX[direction];
+            int ny = y + DY[direction];
+            if (0 <= nx && nx < width && 0 <= ny && ny < height) {
+                int neighbor = nx * height + ny;
+                if (distances.at(neighbor) == -1) {
+                    distances[neighbor] = distances.at(cell) + 1;
+                    queue.append(neighbor);
+                }
+            }
+        }
+    }
+
+    // The neighbors of a cell that the mouse thinks that it can move to
+    auto isOpen = [&](int x, int y, int direction){
+        int nx = x + DX[direction];
+        int ny = y + DY[direction];
+        return (
+            0 <= nx && nx < width && 0 <= ny && ny < height &&
+            !(known.at(x * height + y) & (1 << direction))
+        );
+    };
+
+    // Walls that the mouse sees are only ever added, so distances only ever
+    // grow; each cell whose distance is no longer one more than that of its
+    // closest open neighbor is fixed, and its neighbors are checked in turn
+    QVector<int> stack;
+    auto update = [&](){
+        while (!stack.isEmpty()) {
+            int cell = stack.takeLast();
+            if (distances.at(cell) == 0) {
+                continue;
+            }
+            int x = cell / height;
+            int y = cell % height;
+            int closest = -1;
+            for (int direction = 0; direction < 4; direction += 1) {
+                if (isOpen(x, y, direction)) {
+                    int neighbor = (x + DX[direction]) * height +
+                        (y + DY[direction]);
+                    int distance = distances.at(neighbor);
+                    if (closest == -1 || distance < closest) {
+                        closest = distance;
+                    }
+                }
+            }
+            if (closest == -1 || distances.at(cell) == closest + 1) {
+                continue;
+            }
+            distances[cell] = closest + 1;
+            for (int direction = 0; direction < 4; direction += 1) {
+                if (isOpen(x, y, direction)) {
+                    stack.append(
+                        (x + DX[direction]) * height + (y + DY[direction]));
+                }
+            }
+        }
+    };
+
+    // Flood fill always gets to the center of a valid maze; the limit only
+    // stops it in mazes whose center can't be reached
+    int limit = 16 * numCells;
+    while (!walker->isInCenter() && walker->getMoves() < limit) {
+
+        // Look at the walls of the current cell
+        int x = walker->getX();
+        int y = walker->getY();
+        int cell = x * height + y;
+        for (int direction = 0; direction < 4; direction += 1) {
+            if (!walker->isWall(direction) || !isOpen(x, y, direction)) {
+                continue;
+            }
+            known[cell] |= 1 << direction;
+            stack.append(cell);
+            int nx = x + DX[direction];
+            int ny = y + DY[direction];
+            int neighbor = nx * height + ny;
+            known[neighbor] |= 1 << ((direction + 2) % 4);
+            stack.append(neighbor);
+        }
+        update();
+
+        // Head for the closest neighbor, preferring to go straight
+        int best = -1;
+        int bestDistance = -1;
+        for (int turn : {0, 1, 3, 2}) {
+            int direction = (walker->getHeading() + turn) % 4;
+            if (!isOpen(x, y, direction)) {
+                continue;
+            }
+            int neighbor = (x + DX[direction]) * height + (y + DY[direction]);
+            int distance = distances.at(neighbor);
+            if (best == -1 || distance < bestDistance) {
+                best = direction;
+                bestDistance = distance;
+            }
+        }
+        if (best == -1) {
+            return;
+        }
+        walker->step(best);
+    }
+}
+
+void ReferenceSolvers::shortestPath(Walker* walker) {
+
+    // Every cell along a shortest path is one closer to the center than the
+    // one before it; going straight, where possible, saves turns
+    const Maze* maze = walker->getMaze();
+    if (maze->getDistance(0, 0) < 0) {
+        return;
+    }
+    while (!walker->isInCenter()) {
+        int distance = maze->getDistance(walker->getX(), walker->getY());
+        for (int turn : {0, 1, 3, 2}) {
+            int direction = (walker->getHeading() + turn) % 4;
+            if (walker->isWall(direction)) {
+                continue;
+            }
+            int nx = walker->getX() + DX[direction];
+            int ny = walker->getY() + DY[direction];
+            if (maze->getDistance(nx, ny) == distance - 1) {
+                walker->step(direction);
+                break;
+            }
+        }
+    }
+}
+
+void ReferenceSolvers::fastestPath(Walker* walker) {
+
+    // Every turn is made in place, from rest, so a path's estimated time is
+    // the time of each of its straights, from rest to rest, plus the time of
+    // its turns; a shortest path search over every (cell, heading) finds
+    // the fastest, where a state leads to the same cell turned a quarter
+    // either way, or to any cell straight ahead that's in view. Straights
+    // end at the center, since reaching it ends the run.
+    const Maze* maze = walker->getMaze();
+    int width = maze->getWidth();
+    int height = maze->getHeight();
+    int numStates = 4 * width * height;
+    double tileLength = Dimensions::tileLength().getMeters();
+    double turnSeconds = RunTimeModel::DEFAULT_PARAMETERS().turnSeconds;
+    QVector<double> straightSeconds(qMax(width, height), 0.0);
+    for (int cells = 1; cells < straightSeconds.size(); cells += 1) {
+        RunTimeModel model;
+        model.addStraight(cells * tileLength);
+        straightSeconds[cells] = model.getSeconds();
+    }
+
+    // States are (x * height + y) * 4 + heading
+    QVector<double> seconds(numStates, -1.0);
+    QVector<int> previous(numStates, -1);
+    std::priority_queue<
+        std::pair<double, int>,
+        std::vector<std::pair<double, int>>,
+        std::greater<std::pair<double, int>>
+    > queue;
+    auto relax = [&](int state, int from, double time) {
+        if (seconds.at(state) < 0.0 || time < seconds.at(state)) {
+            seconds[state] = time;
+            previous[state] = from;
+            queue.push({time, state});
+        }
+    };
+    relax(static_cast<int>(Direction::NORTH), -1, 0.0);
+    int goal = -1;
+    while (!queue.empty()) {
+        std::pair<double, int> top = queue.top();
+        queue.pop();
+        int state = top.second;
+        if (seconds.at(state) < top.first) {
+            continue;
+        }
+        int cell = state / 4;
+        int heading = state % 4;
+        int x = cell / height;
+        int y = cell % height;
+        if (maze->getDistance(x, y) == 0) {
+            goal = state;
+            break;
+        }
+        relax(cell * 4 + (heading + 1) % 4, state, top.first + turnSeconds);
+        relax(cell * 4 + (heading + 3) % 4, state, top.first + turnSeconds);
+        int nx = x;
+        int ny = y;
+        for (int cells = 1; ; cells += 1) {
+            if (maze->isWall(nx, ny, static_cast<Direction>(heading))) {
+                break;
+            }
+            nx += DX[heading];
+            ny += DY[heading];
+            relax(
+                (nx * height + ny) * 4 + heading,
+                state,
+                top.first + straightSeconds.at(cells)
+            );
+            if (maze->getDistance(nx, ny) == 0) {
+                break;
+            }
+        }
+    }
+    if (goal == -1) {
+        return;
+    }
+
+    // Retrace the path, and drive it a cell at a time; the walker turns
+    // before each straight, as the path did
+    QVector<int> path;
+    for (int state = goal; state != -1; state = previous.at(state)) {
+        path.prepend(state);
+    }
+    for (int i = 1; i < path.size(); i += 1) {
+        int from = path.at(i - 1) / 4;
+        int to = path.at(i) / 4;
+        int heading = path.at(i) % 4;
+        while (from != to) {
+            walker->step(heading);
+            from = walker->getX() * height + walker->getY();
+        }
+    }
+}
+
+ReferenceResult ReferenceSolvers::getFastestPath(const Maze* maze) {
+    quint64 hash = maze->getHash();
+    {
+        std::lock_guard<std::mutex> lock(FASTEST_PATH_MUTEX);
+        auto it = FASTEST_PATH_CACHE.constFind(hash);
+        if (it != FASTEST_PATH_CACHE.constEnd()) {
+            return it.value();
+        }
+    }
+    Walker walker(maze);
+    fastestPath(&walker);
+    ReferenceResult result = walker.getResult("fastestPath");
+    std::lock_guard<std::mutex> lock(FASTEST_PATH_MUTEX);
+    FASTEST_PATH_CACHE.insert(hash, result);
+    return result;
+}
+
+} 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "Command.h"
+#include "Maze.h"
+
+namespace mms {
+
+struct ReferenceResult {
+    QString name; // of the solver
+    bool isSolved; // whether it reached the center
+    int moves;
+    int turns;
+    double estimatedSeconds; // by the default run time model
+};
+
+class ReferenceSolvers {
+
+    // A few simple algorithms that solve a maze in-process, straight against
+    // its walls, with no engine and no process, so that they give a baseline
+    // for any maze in microseconds. The mouse starts in the starting cell,
+    // facing north, and learns the walls of each cell as it enters it (only
+    // the shortest path solver knows the whole maze up front). Moves and turns
+    // are counted the way that the engine counts them, with turning around
+    // counting as two turns, and solvers that go around in circles give up.
+    // The fastest path solver is the one exception to microseconds: it finds
+    // the path with the lowest estimated time (see RunTimeModel), which is
+    // the fastest that any algorithm could possibly solve the maze in, by a
+    // search over every heading of every cell, and takes about a millisecond
+    // on a 64x64 maze; its results are cached by the maze's hash.
+
+public:
+
+    // leftWallFollow, floodFill, shortestPath and fastestPath
+    static QStringList names();
+
+    static ReferenceResult solve(const QString& name, const Maze* maze);
+    static QVector<ReferenceResult> solveAll(const Maze* maze);
+
+    // The solver's run as the commands that an algorithm would have sent,
+    // i.e., turns and single-cell moves, so that it can be replayed like a
+    // recorded run; never cached
+    static QVector<Command> getCommands(const QString& name, const Maze* maze);
+
+private:
+
+    class Walker;
+    static void drive(const QString& name, Walker* walker);
+    static void leftWallFollow(Walker* walker);
+    static void floodFill(Walker* walker);
+    static void shortestPath(Walker* walker);
+    static void fastestPath(Walker* walker);
+
+    // Under the mutex, since mazes are solved on many threads at once
+    static std::mutex FASTEST_PATH_MUTEX;
+    static QMap<quint64, ReferenceResult> FASTEST_PATH_CACHE;
+    static ReferenceResult getFastestPath(const Maze* maze);
+};
+
+} 
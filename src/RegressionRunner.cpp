@@ -0,0 +1,433 @@
+#include "RegressionRunner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QDebug>
+#include <QDir>
+
+#include "AssertMacros.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+const int RegressionRunner::MIN_TEST_MAZES = 10;
+const double RegressionRunner::SIGNIFICANCE = 0.05;
+
+RegressionRunner::RegressionRunner(
+        const QString& algoName,
+        const QString& baselineDirectory,
+        const QString& candidateDirectory,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool continuous,
+        double threshold,
+        const QString& storePath,
+        QObject* parent) :
+    QObject(parent),
+    m_algoName(algoName),
+    m_mazeDirectory(mazeDirectory),
+    m_generatedMazes(generatedMazes),
+    m_numJobs(numJobs),
+    m_timeLimitSeconds(timeLimitSeconds),
+    m_tickLimit(tickLimit),
+    m_continuous(continuous),
+    m_threshold(threshold),
+    m_storePath(storePath),
+    m_versions(NUM_SIDES),
+    m_numBuilding(0),
+    m_hasRegressed(false),
+    m_nextJobIndex(0),
+    m_numRunning(0),
+    m_results(NUM_SIDES),
+    m_store(nullptr) {
+    ASSERT_LT(0, m_numJobs);
+    ASSERT_LE(0.0, m_threshold);
+    for (const QString& directory : {baselineDirectory, candidateDirectory}) {
+        AlgoBuild* build = new AlgoBuild(algoName, this);
+        if (!directory.isEmpty()) {
+            build->setDirectory(directory);
+        }
+        m_builds.append(build);
+    }
+}
+
+RegressionRunner::~RegressionRunner() {
+    delete m_store;
+}
+
+bool RegressionRunner::start() {
+
+    if (!SettingsMouseAlgos::names().contains(m_algoName)) {
+        qWarning().noquote().nospace()
+            << "No mouse algorithm named \"" << m_algoName << "\"";
+        return false;
+    }
+    for (AlgoBuild* build : m_builds) {
+        if (!QDir(build->getDirectory()).exists()) {
+            qWarning().noquote().nospace()
+                << "No directory at \"" << build->getDirectory() << "\"";
+            return false;
+        }
+    }
+    m_runArguments = SettingsMouseAlgos::getRunArguments(m_algoName);
+    if (!loadMazePaths()) {
+        return false;
+    }
+    if (!m_storePath.isEmpty()) {
+        m_store = ResultStore::open(m_storePath);
+        if (m_store == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open result store \"" << m_storePath << "\"";
+            return false;
+        }
+    }
+
+    // Both builds at once; every build finishes asynchronously
+    for (AlgoBuild* build : m_builds) {
+        connect(
+            build,
+            &AlgoBuild::finished,
+            this,
+            &RegressionRunner::onBuildFinished
+        );
+        m_numBuilding += 1;
+        qInfo().noquote().nospace()
+            << "Building \"" << build->getDirectory() << "\"";
+        build->start();
+    }
+    return true;
+}
+
+bool RegressionRunner::hasRegressed() const {
+    return m_hasRegressed;
+}
+
+bool RegressionRunner::loadMazePaths() {
+
+    QStringList paths;
+    if (!m_mazeDirectory.isEmpty()) {
+        QDir dir(m_mazeDirectory);
+        if (!dir.exists()) {
+            qWarning().noquote().nospace()
+                << "No maze directory at \"" << m_mazeDirectory << "\"";
+            return false;
+        }
+        for (const QString& name : dir.entryList(QDir::Files, QDir::Name)) {
+            paths.append(dir.filePath(name));
+        }
+    }
+    paths.append(m_generatedMazes);
+
+    // Every maze is loaded again for each of its runs, since runs take
+    // ownership of their mazes, but only rejected once
+    for (const QString& path : paths) {
+        MazeError error;
+        Maze* maze = MazeGenerator::load(path, &error);
+        if (maze == nullptr) {
+            qWarning().noquote().nospace()
+                << "Skipping invalid maze \"" << path << "\": "
+                << Maze::errorToString(error);
+            continue;
+        }
+        m_mazePaths.append(path);
+        m_mazeHashes.append(maze->getHash());
+        delete maze;
+    }
+    if (m_mazePaths.isEmpty()) {
+        qWarning() << "No valid mazes to run";
+        return false;
+    }
+    for (QVector<RunResult>& results : m_results) {
+        results.resize(m_mazePaths.size());
+    }
+    return true;
+}
+
+void RegressionRunner::onBuildFinished() {
+
+    m_numBuilding -= 1;
+    if (0 < m_numBuilding) {
+        return;
+    }
+
+    // Nothing can be compared unless both builds succeeded
+    bool isBuilt = true;
+    for (int side = 0; side < NUM_SIDES; side += 1) {
+        AlgoBuild* build = m_builds.at(side);
+        if (!build->isSuccessful()) {
+            qWarning().noquote().nospace()
+                << "The build in \"" << build->getDirectory()
+                << "\" failed\n" << build->getOutput();
+            isBuilt = false;
+            continue;
+        }
+        m_versions[side] = ResultStore::toVersion(build->getFingerprint());
+    }
+    if (!isBuilt) {
+        m_hasRegressed = true;
+        emit done();
+        return;
+    }
+
+    // Fill every slot; each finished run starts the next one
+    for (int i = 0; i < m_numJobs; i += 1) {
+        startNextRun();
+    }
+}
+
+void RegressionRunner::startNextRun() {
+
+    // Each maze is run against both sides, one after the other
+    if (m_nextJobIndex == NUM_SIDES * m_mazePaths.size()) {
+        return;
+    }
+    int side = m_nextJobIndex % NUM_SIDES;
+    int mazeIndex = m_nextJobIndex / NUM_SIDES;
+    m_nextJobIndex += 1;
+
+    // The maze was valid when the comparison started, and generated mazes
+    // are deterministic
+    QString path = m_mazePaths.at(mazeIndex);
+    MazeError error;
+    Maze* maze = MazeGenerator::load(path, &error);
+    ASSERT_FA(maze == nullptr);
+
+    HeadlessRun* run = new HeadlessRun(
+        path,
+        maze,
+        m_runArguments,
+        m_builds.at(side)->getDirectory(),
+        m_timeLimitSeconds,
+        m_tickLimit,
+        false,
+        false,
+        m_continuous,
+        this
+    );
+    connect(run, &HeadlessRun::finished, this, [=](){
+        onRunFinished(run, side, mazeIndex);
+    });
+    m_numRunning += 1;
+    run->start();
+}
+
+void RegressionRunner::onRunFinished(HeadlessRun* run, int side, int maze) {
+
+    run->deleteLater();
+    m_numRunning -= 1;
+    m_results[side][maze] = run->getResult();
+    if (m_store != nullptr) {
+        m_store->append(ResultStore::toRow(
+            m_results.at(side).at(maze),
+            m_mazeHashes.at(maze),
+            m_algoName,
+            m_versions.at(side)
+        ));
+    }
+
+    startNextRun();
+    if (m_numRunning == 0) {
+        finish();
+    }
+}
+
+void RegressionRunner::finish() {
+    if (m_store != nullptr) {
+        m_store->flush();
+    }
+    QTextStream out(stdout);
+    int numRegressed = printDeltas(&out);
+    printTest(&out);
+    m_hasRegressed = 0 < numRegressed;
+    out << endl << numRegressed << " of " << m_mazePaths.size()
+        << " mazes regressed by more than "
+        << QString::number(100.0 * m_threshold, 'f', 1) << "%: "
+        << (m_hasRegressed ? "FAIL" : "PASS") << endl;
+    emit done();
+}
+
+int RegressionRunner::printDeltas(QTextStream* out) const {
+
+    int pathWidth = QString("maze").size();
+    for (const QString& path : m_mazePaths) {
+        pathWidth = qMax(pathWidth, path.size());
+    }
+    *out << QString("maze").leftJustified(pathWidth) << "  "
+        << QString("baseline").leftJustified(10)
+        << QString("candidate").leftJustified(10)
+        << QString("moves").rightJustified(8)
+        << QString("delta").rightJustified(8)
+        << QString("est s").rightJustified(10)
+        << QString("delta").rightJustified(10)
+        << QString("delta %").rightJustified(9) << endl;
+
+    int numRegressed = 0;
+    for (int i = 0; i < m_mazePaths.size(); i += 1) {
+        const RunResult& baseline = m_results.at(BASELINE).at(i);
+        const RunResult& candidate = m_results.at(CANDIDATE).at(i);
+        bool isBaselineSolved = baseline.status == RunStatus::SOLVED;
+        bool isCandidateSolved = candidate.status == RunStatus::SOLVED;
+        *out << m_mazePaths.at(i).leftJustified(pathWidth) << "  "
+            << HeadlessRun::statusToString(baseline.status).leftJustified(10)
+            << HeadlessRun::statusToString(candidate.status).leftJustified(10)
+            << QString::number(candidate.moves).rightJustified(8);
+
+        // Deltas only mean something if both sides solved the maze
+        QString flag;
+        if (isBaselineSolved && isCandidateSolved) {
+            double deltaSeconds =
+                candidate.estimatedSeconds - baseline.estimatedSeconds;
+            double deltaPercent = 0.0;
+            if (0.0 < baseline.estimatedSeconds) {
+                deltaPercent = 100.0 * deltaSeconds / baseline.estimatedSeconds;
+            }
+            *out << QString::number(candidate.moves - baseline.moves)
+                    .rightJustified(8)
+                << QString::number(candidate.estimatedSeconds, 'f', 3)
+                    .rightJustified(10)
+                << QString::number(deltaSeconds, 'f', 3).rightJustified(10)
+                << QString::number(deltaPercent, 'f', 1).rightJustified(9);
+            if (m_threshold * baseline.estimatedSeconds < deltaSeconds) {
+                flag = "REGRESSED";
+            }
+            else if (deltaSeconds < -m_threshold * baseline.estimatedSeconds) {
+                flag = "improved";
+            }
+        }
+        else {
+            *out << QString("-").rightJustified(8)
+                << QString::number(candidate.estimatedSeconds, 'f', 3)
+                    .rightJustified(10)
+                << QString("-").rightJustified(10)
+                << QString("-").rightJustified(9);
+            if (isBaselineSolved) {
+                flag = "REGRESSED";
+            }
+            else if (isCandidateSolved) {
+                flag = "improved";
+            }
+        }
+        if (flag == "REGRESSED") {
+            numRegressed += 1;
+        }
+        if (!flag.isEmpty()) {
+            *out << "  " << flag;
+        }
+        *out << endl;
+    }
+    return numRegressed;
+}
+
+void RegressionRunner::printTest(QTextStream* out) const {
+
+    // Paired over the mazes that both sides solved
+    QVector<double> differences;
+    QVector<double> percents;
+    int totalMoveDelta = 0;
+    for (int i = 0; i < m_mazePaths.size(); i += 1) {
+        const RunResult& baseline = m_results.at(BASELINE).at(i);
+        const RunResult& candidate = m_results.at(CANDIDATE).at(i);
+        if (
+            baseline.status != RunStatus::SOLVED ||
+            candidate.status != RunStatus::SOLVED
+        ) {
+            continue;
+        }
+        differences.append(
+            candidate.estimatedSeconds - baseline.estimatedSeconds);
+        if (0.0 < baseline.estimatedSeconds) {
+            percents.append(
+                100.0 * differences.last() / baseline.estimatedSeconds);
+        }
+        totalMoveDelta += candidate.moves - baseline.moves;
+    }
+    *out << endl << "solved by both: " << differences.size() << "/"
+        << m_mazePaths.size();
+    if (differences.isEmpty()) {
+        *out << endl;
+        return;
+    }
+    std::sort(percents.begin(), percents.end());
+    double medianPercent = 0.0;
+    if (!percents.isEmpty()) {
+        int middle = percents.size() / 2;
+        medianPercent = percents.size() % 2 == 1
+            ? percents.at(middle)
+            : (percents.at(middle - 1) + percents.at(middle)) / 2.0;
+    }
+    *out << ", average move delta: "
+        << QString::number(
+            static_cast<double>(totalMoveDelta) / differences.size(), 'f', 1)
+        << ", median estimated time delta: "
+        << QString::number(medianPercent, 'f', 1) << "%" << endl;
+
+    int numNonZero = 0;
+    double pValue = getSignedRankPValue(differences, &numNonZero);
+    *out << "signed-rank test over " << numNonZero
+        << " mazes whose times differ: p = "
+        << QString::number(pValue, 'f', 4);
+    if (numNonZero < MIN_TEST_MAZES) {
+        *out << " (too few mazes to be meaningful)";
+    }
+    else if (pValue < SIGNIFICANCE) {
+        *out << " (the candidate is significantly "
+            << (medianPercent < 0.0 ? "faster" : "slower") << ")";
+    }
+    else {
+        *out << " (no significant difference)";
+    }
+    *out << endl;
+}
+
+double RegressionRunner::getSignedRankPValue(
+        const QVector<double>& differences,
+        int* numNonZero) {
+
+    // Rank the absolute differences, giving ties the average of their ranks
+    QVector<double> nonZero;
+    for (double difference : differences) {
+        if (difference != 0.0) {
+            nonZero.append(difference);
+        }
+    }
+    *numNonZero = nonZero.size();
+    if (nonZero.isEmpty()) {
+        return 1.0;
+    }
+    std::sort(nonZero.begin(), nonZero.end(), [](double a, double b) {
+        return std::fabs(a) < std::fabs(b);
+    });
+    double positiveRanks = 0.0;
+    int i = 0;
+    while (i < nonZero.size()) {
+        int j = i;
+        while (
+            j + 1 < nonZero.size() &&
+            std::fabs(nonZero.at(j + 1)) == std::fabs(nonZero.at(i))
+        ) {
+            j += 1;
+        }
+        double rank = (i + j) / 2.0 + 1.0;
+        for (int k = i; k <= j; k += 1) {
+            if (0.0 < nonZero.at(k)) {
+                positiveRanks += rank;
+            }
+        }
+        i = j + 1;
+    }
+
+    // With a continuity correction
+    double n = nonZero.size();
+    double mean = n * (n + 1.0) / 4.0;
+    double deviation = std::sqrt(n * (n + 1.0) * (2.0 * n + 1.0) / 24.0);
+    double z = qMax(0.0, std::fabs(positiveRanks - mean) - 0.5) / deviation;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+} 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include "AlgoBuild.h"
+#include "HeadlessRun.h"
+#include "ResultStore.h"
+
+namespace mms {
+
+class RegressionRunner : public QObject {
+
+    // Compares two builds of the same algorithm, from two directories (e.g.
+    // two checkouts at different revisions), on the same mazes. Both are
+    // built with the algorithm's build command, and then every maze is run
+    // against both, from a single queue, with a fixed number of headless runs
+    // in flight at once. Once every run has finished, the per-maze deltas of
+    // the candidate from the baseline are printed, along with a paired test
+    // of whether the candidate's estimated times differ from the baseline's
+    // at all. A maze regressed if the baseline solved it and the candidate
+    // didn't, or if the candidate's estimated time is worse by more than the
+    // threshold.
+
+    Q_OBJECT
+
+public:
+
+    // The threshold is a fraction of the baseline's estimated time; an empty
+    // candidate directory is the algorithm's configured directory
+    RegressionRunner(
+        const QString& algoName,
+        const QString& baselineDirectory,
+        const QString& candidateDirectory,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool continuous,
+        double threshold,
+        const QString& storePath,
+        QObject* parent = 0);
+    ~RegressionRunner();
+
+    // Returns false if the comparison can't be started at all
+    bool start();
+
+    // Whether any maze regressed (or either build failed), once done
+    bool hasRegressed() const;
+
+signals:
+
+    void done();
+
+private:
+
+    // The builds being compared, in this order
+    enum Side {
+        BASELINE = 0,
+        CANDIDATE = 1,
+        NUM_SIDES = 2,
+    };
+
+    // Below this many mazes whose times differ, the test means little
+    static const int MIN_TEST_MAZES;
+    static const double SIGNIFICANCE;
+
+    QString m_algoName;
+    QString m_mazeDirectory;
+    QStringList m_generatedMazes;
+    int m_numJobs;
+    double m_timeLimitSeconds;
+    qint64 m_tickLimit;
+    bool m_continuous;
+    double m_threshold;
+    QString m_storePath;
+
+    QVector<AlgoBuild*> m_builds;
+    QVector<QString> m_versions;
+    QStringList m_runArguments;
+    int m_numBuilding;
+    bool m_hasRegressed;
+
+    QStringList m_mazePaths;
+    QVector<quint64> m_mazeHashes;
+    int m_nextJobIndex;
+    int m_numRunning;
+
+    // The result of each side on every maze, which is also appended to the
+    // store, if there is one
+    QVector<QVector<RunResult>> m_results;
+    ResultStore* m_store;
+
+    bool loadMazePaths();
+    void onBuildFinished();
+    void startNextRun();
+    void onRunFinished(HeadlessRun* run, int side, int maze);
+    void finish();
+
+    // Prints a row for every maze, and returns the number that regressed
+    int printDeltas(QTextStream* out) const;
+    void printTest(QTextStream* out) const;
+
+    // The two-sided p-value of the Wilcoxon signed-rank test of whether the
+    // differences are centered on zero, by the normal approximation, and
+    // the number of differences that aren't zero
+    static double getSignedRankPValue(
+        const QVector<double>& differences,
+        int* numNonZero);
+};
+
+} 
@@ -0,0 +1,118 @@
+#include "RemoteWorker.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QTimer>
+
+namespace mms {
+
+const int RemoteWorker::RECONNECT_MILLISECONDS = 5000;
+
+RemoteWorker* RemoteWorker::create(const QString& address, QObject* parent) {
+    int colon = address.lastIndexOf(':');
+    bool portOk = false;
+    quint16 port = address.mid(colon + 1).toUShort(&portOk);
+    if (colon < 1 || !portOk || port == 0) {
+        return nullptr;
+    }
+    return new RemoteWorker(address.left(colon), port, parent);
+}
+
+RemoteWorker::RemoteWorker(
+        const QString& host,
+        quint16 port,
+        QObject* parent) :
+    QObject(parent),
+    m_host(host),
+    m_port(port),
+    m_socket(new QTcpSocket(this)),
+    m_numSlots(0) {
+    connect(
+        m_socket,
+        &QTcpSocket::readyRead,
+        this,
+        &RemoteWorker::onReadyRead
+    );
+    // Failing to connect never emits disconnected, but always ends up here
+    connect(
+        m_socket,
+        &QAbstractSocket::stateChanged,
+        this,
+        [=](QAbstractSocket::SocketState state){
+            if (state == QAbstractSocket::UnconnectedState) {
+                onDisconnected();
+            }
+        }
+    );
+}
+
+QString RemoteWorker::getAddress() const {
+    return m_host + ":" + QString::number(m_port);
+}
+
+void RemoteWorker::connectToWorker() {
+    m_socket->connectToHost(m_host, m_port);
+}
+
+int RemoteWorker::getNumFreeSlots() const {
+    return qMax(0, m_numSlots - m_runningJobs.size());
+}
+
+void RemoteWorker::startJob(int id, const QJsonObject& job) {
+    QJsonObject message = job;
+    message["type"] = "run";
+    message["id"] = id;
+    m_socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    m_socket->write("\n");
+    m_runningJobs.insert(id);
+}
+
+void RemoteWorker::onReadyRead() {
+    m_framer.append(m_socket->readAll());
+    QString line;
+    while (m_framer.nextLine(&line)) {
+        QJsonObject message = QJsonDocument::fromJson(line.toUtf8()).object();
+        QString type = message["type"].toString();
+        if (type == "hello") {
+            m_numSlots = message["slots"].toInt();
+            qInfo().noquote().nospace()
+                << "Connected to worker " << getAddress() << ", with "
+                << m_numSlots << " slots";
+            emit ready();
+        }
+        else if (type == "result") {
+            // Results of jobs that were already handed back are dropped
+            int id = message["id"].toInt(-1);
+            if (m_runningJobs.remove(id)) {
+                emit jobFinished(
+                    id,
+                    HeadlessRun::resultFromJson(message["result"].toObject())
+                );
+            }
+        }
+        else {
+            qWarning().noquote().nospace()
+                << "Unexpected message from worker " << getAddress() << ": "
+                << line;
+        }
+    }
+}
+
+void RemoteWorker::onDisconnected() {
+    qWarning().noquote().nospace()
+        << (0 < m_numSlots ? "Lost worker " : "Couldn't connect to worker ")
+        << getAddress() << ": " << m_socket->errorString();
+    m_numSlots = 0;
+    m_framer.clear();
+    QList<int> jobs = m_runningJobs.toList();
+    m_runningJobs.clear();
+    QTimer::singleShot(
+        RECONNECT_MILLISECONDS,
+        this,
+        &RemoteWorker::connectToWorker
+    );
+    emit lost(jobs);
+}
+
+} 
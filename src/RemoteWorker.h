@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTcpSocket>
+
+#include "HeadlessRun.h"
+#include "LineFramer.h"
+
+namespace mms {
+
+class RemoteWorker : public QObject {
+
+    // The coordinator's end of a connection to a worker, i.e. another mms
+    // started with --worker. Messages are JSON objects, one per line, in
+    // both directions: the worker greets the coordinator with how many runs
+    // it's willing to keep in flight, the coordinator sends it jobs (never
+    // more than that many at once), and the worker sends back a result for
+    // each one. Jobs that are in flight when the connection is lost are
+    // handed back, and the connection is retried every few seconds.
+
+    Q_OBJECT
+
+public:
+
+    // Returns nullptr if the address isn't of the form host:port
+    static RemoteWorker* create(const QString& address, QObject* parent = 0);
+
+    QString getAddress() const;
+    void connectToWorker();
+
+    // The number of jobs that can be started right away; zero until the
+    // worker has greeted the coordinator
+    int getNumFreeSlots() const;
+
+    // The job is a "run" message, without its id
+    void startJob(int id, const QJsonObject& job);
+
+signals:
+
+    // Emitted every time the worker greets the coordinator
+    void ready();
+
+    void jobFinished(int id, const RunResult& result);
+
+    // Emitted every time the connection is lost (or fails), with the jobs
+    // that were in flight
+    void lost(const QList<int>& jobs);
+
+private:
+
+    // How long to wait before connecting again
+    static const int RECONNECT_MILLISECONDS;
+
+    RemoteWorker(const QString& host, quint16 port, QObject* parent);
+
+    QString m_host;
+    quint16 m_port;
+    QTcpSocket* m_socket;
+    LineFramer m_framer;
+    int m_numSlots;
+    QSet<int> m_runningJobs;
+
+    void onReadyRead();
+    void onDisconnected();
+};
+
+} 
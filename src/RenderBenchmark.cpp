@@ -0,0 +1,199 @@
+#include "RenderBenchmark.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QTextStream>
+
+#include "Color.h"
+#include "Direction.h"
+#include "Map.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "MazeView.h"
+#include "Mouse.h"
+#include "MouseGraphic.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+const QVector<int>& RenderBenchmark::DEFAULT_SIZES() {
+    static const QVector<int> sizes = {16, 32, 64, 128, 256, 512};
+    return sizes;
+}
+
+const QVector<int>& RenderBenchmark::DEFAULT_CHURNS() {
+    static const QVector<int> churns = {0, 10, 100, 1000};
+    return churns;
+}
+
+bool RenderBenchmark::run(
+        const QVector<int>& sizes,
+        const QVector<int>& churns,
+        double seconds,
+        int width,
+        int height) {
+    for (int size : sizes) {
+        for (int churn : churns) {
+            if (!measure(size, churn, seconds, width, height)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool RenderBenchmark::measure(
+        int size,
+        int churn,
+        double seconds,
+        int width,
+        int height) {
+
+    WallGrid walls = MazeGenerator::generate(
+        MazeAlgorithm::DFS,
+        size,
+        size,
+        static_cast<quint32>(size)
+    );
+    Maze* maze = Maze::fromWalls(walls);
+    if (maze == nullptr) {
+        qWarning() << "Unable to generate a maze of size" << size;
+        return false;
+    }
+    MazeView view(maze);
+    Mouse mouse;
+    MouseGraphic mouseGraphic(&mouse);
+    Map map;
+    if (!map.initOffscreen(width, height)) {
+        qWarning() << "Unable to create an offscreen OpenGL context";
+        delete maze;
+        return false;
+    }
+    map.setMaze(maze);
+    map.setView(&view);
+    map.setMouseGraphic(&mouseGraphic);
+    map.setGpuTimingEnabled(true);
+
+    // The first frame uploads everything, so it isn't counted
+    view.publishSnapshot();
+    map.paintOffscreen();
+
+    std::minstd_rand random(static_cast<quint32>(size * 1000 + churn));
+    QVector<double> frameSeconds;
+    double paintSeconds = 0.0;
+    double uploadSeconds = 0.0;
+    double uploadBytes = 0.0;
+    double drawCalls = 0.0;
+    double trianglesDrawn = 0.0;
+    double gpuSeconds = 0.0;
+    int gpuFrames = 0;
+    int lastGpuFrame = map.getFrameStats().gpuFrame;
+    QElapsedTimer total;
+    total.start();
+    while (total.nsecsElapsed() < seconds * 1e9) {
+        QElapsedTimer frame;
+        frame.start();
+        applyChurn(
+            view.getMazeGraphic(),
+            size,
+            churn,
+            frameSeconds.size(),
+            &random
+        );
+        view.publishSnapshot();
+        map.paintOffscreen();
+        frameSeconds.append(frame.nsecsElapsed() / 1e9);
+
+        const FrameStats& stats = map.getFrameStats();
+        paintSeconds += stats.paintSeconds;
+        uploadSeconds += stats.uploadSeconds;
+        uploadBytes += stats.uploadBytes;
+        drawCalls += stats.drawCalls;
+        trianglesDrawn += stats.trianglesDrawn;
+
+        // GPU times arrive a frame or more late, and only for timed frames
+        if (stats.gpuFrame != lastGpuFrame && 0.0 <= stats.gpuTilesSeconds) {
+            gpuSeconds += (
+                stats.gpuTilesSeconds +
+                stats.gpuTextSeconds +
+                stats.gpuMouseSeconds
+            );
+            gpuFrames += 1;
+            lastGpuFrame = stats.gpuFrame;
+        }
+    }
+    double elapsed = total.nsecsElapsed() / 1e9;
+    delete maze;
+
+    int frames = frameSeconds.size();
+    QJsonObject object;
+    object["name"] = "render";
+    object["mazeSize"] = size;
+    object["churn"] = churn;
+    object["frames"] = frames;
+    object["framesPerSecond"] = frames / elapsed;
+    object["frameSecondsP50"] = getPercentile(frameSeconds, 0.50);
+    object["frameSecondsP99"] = getPercentile(frameSeconds, 0.99);
+    object["frameSecondsMax"] = getPercentile(frameSeconds, 1.0);
+    object["paintSeconds"] = frames == 0 ? 0.0 : paintSeconds / frames;
+    object["uploadSeconds"] = frames == 0 ? 0.0 : uploadSeconds / frames;
+    object["uploadBytes"] = frames == 0 ? 0.0 : uploadBytes / frames;
+    object["drawCalls"] = frames == 0 ? 0.0 : drawCalls / frames;
+    object["trianglesDrawn"] = frames == 0 ? 0.0 : trianglesDrawn / frames;
+    object["gpuSeconds"] =
+        gpuFrames == 0 ? QJsonValue() : QJsonValue(gpuSeconds / gpuFrames);
+    QTextStream out(stdout);
+    out << QJsonDocument(object).toJson(QJsonDocument::Compact) << "\n";
+    out.flush();
+    return true;
+}
+
+void RenderBenchmark::applyChurn(
+        MazeGraphic* graphic,
+        int size,
+        int churn,
+        int frame,
+        std::minstd_rand* random) {
+    for (int i = 0; i < churn; i += 1) {
+        int x = static_cast<int>((*random)() % size);
+        int y = static_cast<int>((*random)() % size);
+        switch (i % 3) {
+            case 0:
+                graphic->setColor(
+                    x,
+                    y,
+                    static_cast<Color>((*random)() % NUM_COLORS)
+                );
+                break;
+            case 1: {
+                Direction direction = DIRECTIONS[(*random)() % NUM_DIRECTIONS];
+                if ((*random)() % 2 == 0) {
+                    graphic->setWall(x, y, direction);
+                }
+                else {
+                    graphic->clearWall(x, y, direction);
+                }
+                break;
+            }
+            case 2:
+                graphic->setText(x, y, QString::number(frame % 1000));
+                break;
+        }
+    }
+}
+
+double RenderBenchmark::getPercentile(QVector<double> values, double fraction) {
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    int index = static_cast<int>(fraction * (values.size() - 1) + 0.5);
+    return values.at(index);
+}
+
+} 
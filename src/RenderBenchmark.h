@@ -0,0 +1,59 @@
+#pragma once
+
+#include <random>
+
+#include <QVector>
+
+#include "MazeGraphic.h"
+
+namespace mms {
+
+class RenderBenchmark {
+
+    // Times the map, drawn into an offscreen framebuffer so that no window
+    // (or, with -platform offscreen, no display) is needed, on generated
+    // mazes of each size, while each frame changes a number of random tiles
+    // (the churn), in turn their color, a wall, and their text. Every frame
+    // is timed on the GPU as well, and waited for, as a swap would be. Prints
+    // one JSON object per size and churn to stdout, so that the costs of
+    // drawing can be compared across builds.
+
+public:
+
+    RenderBenchmark() = delete;
+
+    static const QVector<int>& DEFAULT_SIZES();
+    static const QVector<int>& DEFAULT_CHURNS();
+
+    // Renders for the given number of seconds for each size and churn, with
+    // a map of the given size in pixels; returns false, having logged why,
+    // if the map can't be created
+    static bool run(
+        const QVector<int>& sizes,
+        const QVector<int>& churns,
+        double seconds,
+        int width,
+        int height);
+
+private:
+
+    static bool measure(
+        int size,
+        int churn,
+        double seconds,
+        int width,
+        int height);
+
+    static void applyChurn(
+        MazeGraphic* graphic,
+        int size,
+        int churn,
+        int frame,
+        std::minstd_rand* random);
+
+    // The value at the given fraction of the way through the sorted values
+    static double getPercentile(QVector<double> values, double fraction);
+
+};
+
+} 
@@ -0,0 +1,198 @@
+#include "ReplayComparison.h"
+
+#include <QDebug>
+#include <QVector>
+
+#include "AssertMacros.h"
+#include "MazeError.h"
+#include "MazeGenerator.h"
+#include "MazeView.h"
+
+namespace mms {
+
+int ReplayComparison::run(
+        const QString& pathA,
+        int runA,
+        const QString& pathB,
+        int runB,
+        int interval) {
+
+    ASSERT_LT(0, interval);
+    TraceRun traceRunA;
+    TraceRun traceRunB;
+    Maze* mazeA = nullptr;
+    Maze* mazeB = nullptr;
+    if (
+        !load(pathA, runA, &traceRunA, &mazeA) ||
+        !load(pathB, runB, &traceRunB, &mazeB)
+    ) {
+        delete mazeA;
+        return 1;
+    }
+    if (
+        mazeA->getWidth() != mazeB->getWidth() ||
+        mazeA->getHeight() != mazeB->getHeight()
+    ) {
+        qWarning().noquote().nospace()
+            << "The runs are against mazes of different sizes: \""
+            << traceRunA.mazeSource << "\" and \""
+            << traceRunB.mazeSource << "\"";
+        delete mazeA;
+        delete mazeB;
+        return 1;
+    }
+
+    // Nothing is drawn, but the views hold the state of the tiles
+    int code = 0;
+    {
+        MazeView viewA(mazeA);
+        MazeView viewB(mazeB);
+        TraceReplay replayA(mazeA, &viewA, traceRunA);
+        TraceReplay replayB(mazeB, &viewB, traceRunB);
+        int length = qMax(replayA.getLength(), replayB.getLength());
+
+        QTextStream out(stdout);
+        out << QString("command").rightJustified(8)
+            << QString("pose A").rightJustified(10)
+            << QString("pose B").rightJustified(10)
+            << QString("walls").rightJustified(7)
+            << QString("colors").rightJustified(7)
+            << QString("text").rightJustified(7)
+            << QString("heat").rightJustified(7)
+            << QString("visits").rightJustified(7) << endl;
+
+        // The runs are equal at the start, and the first compared position
+        // at which they aren't pins the first difference to an interval
+        int firstDifferent = -1;
+        int previous = 0;
+        int position = 0;
+        while (true) {
+            replayA.seek(qMin(position, replayA.getLength()));
+            replayB.seek(qMin(position, replayB.getLength()));
+            ReplayFrame frameA = replayA.getFrame();
+            ReplayFrame frameB = replayB.getFrame();
+            Differences differences = compare(frameA, frameB);
+            if (isDifferent(differences)) {
+                printRow(&out, position, frameA, frameB, differences);
+                if (firstDifferent == -1) {
+                    firstDifferent = previous;
+                }
+            }
+            if (position == length) {
+                break;
+            }
+            previous = position;
+            position = qMin(position + interval, length);
+        }
+
+        // Go back to the last position at which they were the same, which
+        // only replays from the nearest checkpoint, and step one command at
+        // a time from there
+        if (firstDifferent == -1) {
+            out << "IDENTICAL" << endl;
+        }
+        else {
+            code = 2;
+            position = firstDifferent;
+            do {
+                position += 1;
+                replayA.seek(qMin(position, replayA.getLength()));
+                replayB.seek(qMin(position, replayB.getLength()));
+            } while (
+                !isDifferent(compare(replayA.getFrame(), replayB.getFrame()))
+            );
+            out << "DIFFERENT after command " << position << endl;
+        }
+    }
+    delete mazeA;
+    delete mazeB;
+    return code;
+}
+
+ReplayComparison::Differences ReplayComparison::compare(
+        const ReplayFrame& a,
+        const ReplayFrame& b) {
+    ASSERT_EQ(a.tiles.size(), b.tiles.size());
+    Differences differences = {
+        a.location != b.location || a.direction != b.direction,
+        0, 0, 0, 0, 0
+    };
+    for (int i = 0; i < a.tiles.size(); i += 1) {
+        const TileState& tileA = a.tiles.at(i);
+        const TileState& tileB = b.tiles.at(i);
+        if (tileA == tileB && a.visitCounts.at(i) == b.visitCounts.at(i)) {
+            continue;
+        }
+        differences.walls += tileA.declaredWalls != tileB.declaredWalls;
+        differences.colors += tileA.color != tileB.color;
+        differences.text += tileA.text != tileB.text;
+        differences.heat += tileA.heat != tileB.heat;
+        differences.visits += a.visitCounts.at(i) != b.visitCounts.at(i);
+    }
+    return differences;
+}
+
+bool ReplayComparison::isDifferent(const Differences& differences) {
+    return (
+        differences.isPoseDifferent ||
+        0 < differences.walls ||
+        0 < differences.colors ||
+        0 < differences.text ||
+        0 < differences.heat ||
+        0 < differences.visits
+    );
+}
+
+void ReplayComparison::printRow(
+        QTextStream* out,
+        int position,
+        const ReplayFrame& a,
+        const ReplayFrame& b,
+        const Differences& differences) {
+    auto pose = [](const ReplayFrame& frame){
+        return QString("%1,%2 %3").arg(
+            QString::number(frame.location.first),
+            QString::number(frame.location.second),
+            QString(DIRECTION_TO_CHAR(frame.direction))
+        );
+    };
+    *out << QString::number(position).rightJustified(8)
+        << pose(a).rightJustified(10)
+        << pose(b).rightJustified(10)
+        << QString::number(differences.walls).rightJustified(7)
+        << QString::number(differences.colors).rightJustified(7)
+        << QString::number(differences.text).rightJustified(7)
+        << QString::number(differences.heat).rightJustified(7)
+        << QString::number(differences.visits).rightJustified(7) << endl;
+}
+
+bool ReplayComparison::load(
+        const QString& path,
+        int run,
+        TraceRun* traceRun,
+        Maze** maze) {
+    QVector<TraceRun> runs;
+    if (!CommandTrace::read(path, &runs)) {
+        qWarning() << "Unable to read command trace file:" << path;
+        return false;
+    }
+    if (run < 0 || runs.size() < run || runs.isEmpty()) {
+        qWarning()
+            << "No run" << run
+            << "in command trace file:" << path;
+        return false;
+    }
+    *traceRun = runs.at(run == 0 ? runs.size() - 1 : run - 1);
+    MazeError error;
+    *maze = MazeGenerator::load(traceRun->mazeSource, &error);
+    if (*maze == nullptr) {
+        qWarning()
+            << "Unable to load the maze of the compared run:"
+            << traceRun->mazeSource
+            << Maze::errorToString(error);
+        return false;
+    }
+    return true;
+}
+
+} 
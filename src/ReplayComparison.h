@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QString>
+#include <QTextStream>
+
+#include "CommandTrace.h"
+#include "Maze.h"
+#include "TraceReplay.h"
+
+namespace mms {
+
+class ReplayComparison {
+
+    // Replays two recorded runs side by side, each against its own maze
+    // (which must be the same size as the other), and compares what they
+    // show at the same command positions, every so many commands: the
+    // mouse's pose, and each cell's declared walls, color, text, heat and
+    // visits. Both runs only ever move forward, so a comparison costs a
+    // single pass over each of them, plus one interval to pin down the
+    // first command after which they differ; a run that's shorter than the
+    // other stays at its end.
+
+public:
+
+    ReplayComparison() = delete;
+
+    // Runs are numbered from one, and zero is the last run in its trace.
+    // Prints a row for every compared position at which the runs differ,
+    // followed by the first command after which they did; returns 0 if they
+    // never differ, 2 if they do, and 1 if either run couldn't be read.
+    static int run(
+        const QString& pathA,
+        int runA,
+        const QString& pathB,
+        int runB,
+        int interval);
+
+private:
+
+    // How many cells differ, in each of the ways that they can
+    struct Differences {
+        bool isPoseDifferent;
+        int walls;
+        int colors;
+        int text;
+        int heat;
+        int visits;
+    };
+    static Differences compare(const ReplayFrame& a, const ReplayFrame& b);
+    static bool isDifferent(const Differences& differences);
+    static void printRow(
+        QTextStream* out,
+        int position,
+        const ReplayFrame& a,
+        const ReplayFrame& b,
+        const Differences& differences);
+
+    // Reads a run from a trace, and loads its maze; logs why if it can't
+    static bool load(
+        const QString& path,
+        int run,
+        TraceRun* traceRun,
+        Maze** maze);
+
+};
+
+} 
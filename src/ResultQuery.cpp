@@ -0,0 +1,135 @@
+#include "ResultQuery.h"
+
+#include <QDebug>
+#include <QMap>
+#include <QTextStream>
+#include <QVector>
+
+#include "ResultStore.h"
+
+namespace mms {
+
+QStringList ResultQuery::groupings() {
+    return {"algo", "version", "maze"};
+}
+
+bool ResultQuery::summarize(
+        const QString& path,
+        const QString& grouping,
+        const QString& algoFilter,
+        const QString& mazeFilter) {
+
+    if (!groupings().contains(grouping)) {
+        qWarning().noquote().nospace()
+            << "No grouping named \"" << grouping << "\"";
+        return false;
+    }
+
+    // Everything but the timestamps
+    int columns = 0;
+    for (ResultColumn column : {
+        ResultColumn::MAZE_HASH,
+        ResultColumn::MAZE,
+        ResultColumn::ALGO,
+        ResultColumn::VERSION,
+        ResultColumn::STATUS,
+        ResultColumn::MOVES,
+        ResultColumn::TURNS,
+        ResultColumn::CRASHES,
+        ResultColumn::RESETS,
+        ResultColumn::ESTIMATED_SECONDS,
+        ResultColumn::CPU_SECONDS,
+    }) {
+        columns |= ResultStore::getColumnBit(column);
+    }
+    QVector<ResultRow> rows;
+    if (!ResultStore::read(path, columns, &rows)) {
+        qWarning().noquote().nospace()
+            << "Unable to read result store \"" << path << "\"";
+        return false;
+    }
+
+    struct Group {
+        int runs;
+        int solved;
+        int totalMoves;
+        int totalTurns;
+        int crashes;
+        int resets;
+        double totalEstimatedSeconds;
+        double cpuSeconds;
+    };
+    QMap<QString, Group> groups;
+    for (const ResultRow& row : rows) {
+        QString hash = QString("%1").arg(row.mazeHash, 16, 16, QChar('0'));
+        if (!algoFilter.isEmpty() && row.algo != algoFilter) {
+            continue;
+        }
+        if (
+            !mazeFilter.isEmpty() &&
+            hash != mazeFilter.toLower() &&
+            row.maze != mazeFilter
+        ) {
+            continue;
+        }
+        QString key = row.algo;
+        if (grouping == "version") {
+            key = row.algo + " " +
+                (row.version.isEmpty() ? QString("-") : row.version);
+        }
+        else if (grouping == "maze") {
+            key = hash + " " + row.maze;
+        }
+        Group& group = groups[key];
+        group.runs += 1;
+        group.crashes += row.crashes;
+        group.resets += row.resets;
+        if (0.0 <= row.cpuSeconds) {
+            group.cpuSeconds += row.cpuSeconds;
+        }
+        if (row.status == RunStatus::SOLVED) {
+            group.solved += 1;
+            group.totalMoves += row.moves;
+            group.totalTurns += row.turns;
+            group.totalEstimatedSeconds += row.estimatedSeconds;
+        }
+    }
+
+    QTextStream out(stdout);
+    int keyWidth = grouping.size();
+    for (const QString& key : groups.keys()) {
+        keyWidth = qMax(keyWidth, key.size());
+    }
+    out << grouping.leftJustified(keyWidth)
+        << QString("runs").rightJustified(8)
+        << QString("solved").rightJustified(8)
+        << QString("avg moves").rightJustified(11)
+        << QString("avg turns").rightJustified(11)
+        << QString("crashes").rightJustified(9)
+        << QString("resets").rightJustified(8)
+        << QString("avg est s").rightJustified(11)
+        << QString("cpu").rightJustified(12) << endl;
+
+    // Averages only make sense over the runs that actually solved the maze
+    for (auto it = groups.constBegin(); it != groups.constEnd(); it += 1) {
+        const Group& group = it.value();
+        int solved = qMax(1, group.solved);
+        out << it.key().leftJustified(keyWidth)
+            << QString::number(group.runs).rightJustified(8)
+            << QString::number(group.solved).rightJustified(8)
+            << QString::number(static_cast<double>(group.totalMoves) / solved,
+                'f', 1).rightJustified(11)
+            << QString::number(static_cast<double>(group.totalTurns) / solved,
+                'f', 1).rightJustified(11)
+            << QString::number(group.crashes).rightJustified(9)
+            << QString::number(group.resets).rightJustified(8)
+            << QString::number(group.totalEstimatedSeconds / solved, 'f', 3)
+                .rightJustified(11)
+            << QString::number(group.cpuSeconds, 'f', 3).rightJustified(12)
+            << endl;
+    }
+    out << endl << rows.size() << " runs in the store" << endl;
+    return true;
+}
+
+} 
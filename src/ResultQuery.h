@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+namespace mms {
+
+class ResultQuery {
+
+    // Summarizes the runs in a result store, without running anything: the
+    // runs are grouped by algorithm, by version of an algorithm, or by maze,
+    // optionally only for one algorithm or one maze, and a table of each
+    // group's totals and averages is printed to stdout. Only the columns
+    // that the summary needs are decoded.
+
+public:
+
+    ResultQuery() = delete;
+
+    // The names of the groupings, the first of which is the default
+    static QStringList groupings();
+
+    // The maze filter matches the maze's hash (in hex) or its path or spec;
+    // empty filters match everything. Returns false if the store can't be
+    // read, or the grouping isn't one of the above.
+    static bool summarize(
+        const QString& path,
+        const QString& grouping,
+        const QString& algoFilter,
+        const QString& mazeFilter);
+
+};
+
+} 
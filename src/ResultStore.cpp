@@ -0,0 +1,531 @@
+#include "ResultStore.h"
+
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QStringList>
+#include <QtEndian>
+
+#include "AssertMacros.h"
+#include "SettingsMouseAlgos.h"
+#include "SimulationEngine.h"
+
+namespace mms {
+
+const QByteArray ResultStore::MAGIC = "MMSR";
+const quint16 ResultStore::VERSION = 1;
+const int ResultStore::NUM_COLUMNS = 15;
+const int ResultStore::ROWS_PER_BLOCK = 4096;
+const qint64 ResultStore::FLUSH_MS = 5000;
+
+ResultStore* ResultStore::open(const QString& path) {
+    QFile* file = new QFile(path);
+    if (!file->open(QIODevice::ReadWrite)) {
+        delete file;
+        return nullptr;
+    }
+    if (file->size() == 0) {
+        QByteArray header = MAGIC;
+        appendNumber(&header, VERSION, 2);
+        appendNumber(&header, 0, 2);
+        file->write(header);
+        file->flush();
+    }
+    else {
+        // Appending to an existing store continues it, without the block
+        // that was being written if its writer died
+        QByteArray bytes;
+        const char* data = getContents(file, &bytes);
+        qint64 validSize = getValidSize(data, file->size());
+        if (bytes.isEmpty()) {
+            file->unmap(reinterpret_cast<uchar*>(const_cast<char*>(data)));
+        }
+        if (validSize < 0) {
+            delete file;
+            return nullptr;
+        }
+        if (validSize < file->size()) {
+            file->resize(validSize);
+        }
+    }
+    file->seek(file->size());
+    return new ResultStore(file);
+}
+
+bool ResultStore::read(
+        const QString& path,
+        int columns,
+        QVector<ResultRow>* rows) {
+    ASSERT_FA(rows == nullptr);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray bytes;
+    const char* data = getContents(&file, &bytes);
+    qint64 validSize = getValidSize(data, file.size());
+    if (validSize < 0) {
+        return false;
+    }
+
+    // Only the blocks' headers and the wanted columns are ever touched
+    rows->clear();
+    qint64 offset = MAGIC.size() + 4;
+    while (offset < validSize) {
+        int numRows = static_cast<int>(readNumber(data + offset, 4));
+        int numColumns = static_cast<int>(readNumber(data + offset + 4, 4));
+        const char* lengths = data + offset + 8;
+        offset += 8 + 4 * static_cast<qint64>(numColumns);
+        int start = rows->size();
+        rows->resize(start + numRows);
+        for (int i = 0; i < numColumns; i += 1) {
+            int length = static_cast<int>(readNumber(lengths + 4 * i, 4));
+            ResultColumn column = static_cast<ResultColumn>(i);
+            if (
+                i < NUM_COLUMNS &&
+                (columns & getColumnBit(column)) != 0 &&
+                !decodeColumn(column, data + offset, length, rows, start,
+                    numRows)
+            ) {
+                return false;
+            }
+            offset += length;
+        }
+    }
+    return true;
+}
+
+int ResultStore::getColumnBit(ResultColumn column) {
+    return 1 << static_cast<int>(column);
+}
+
+ResultRow ResultStore::toRow(
+        const RunResult& result,
+        quint64 mazeHash,
+        const QString& algoName,
+        const QString& version,
+        quint64 jobKey) {
+    if (!isReusable(result)) {
+        jobKey = 0;
+    }
+    QByteArray json;
+    if (jobKey != 0) {
+        json = QJsonDocument(HeadlessRun::resultToJson(result)).toJson(
+            QJsonDocument::Compact
+        );
+    }
+    return {
+        mazeHash,
+        result.mazePath,
+        algoName,
+        version,
+        result.status,
+        result.moves,
+        result.turns,
+        result.crashes,
+        result.resets,
+        result.ticks,
+        result.estimatedSeconds,
+        result.stats.cpuSeconds,
+        QDateTime::currentMSecsSinceEpoch(),
+        jobKey,
+        QString::fromUtf8(json),
+    };
+}
+
+quint64 ResultStore::getJobKey(
+        const QString& version,
+        quint64 mazeHash,
+        const QString& rules) {
+    if (version.isEmpty()) {
+        return 0;
+    }
+    QByteArray hash = QCryptographicHash::hash(
+        QString("%1;%2;%3;%4")
+            .arg(version)
+            .arg(SimulationEngine::RESULT_VERSION)
+            .arg(mazeHash)
+            .arg(rules)
+            .toUtf8(),
+        QCryptographicHash::Sha1
+    );
+    // Zero is no key at all
+    quint64 key = readNumber(hash.constData(), 8);
+    return key == 0 ? 1 : key;
+}
+
+bool ResultStore::isReusable(const RunResult& result) {
+    switch (result.status) {
+        case RunStatus::SOLVED:
+        case RunStatus::EXITED:
+            return true;
+        case RunStatus::TIMEOUT:
+            // Every other limit is reached at the same point every time
+            return !result.isTimeLimited;
+        default:
+            return false;
+    }
+}
+
+bool ResultStore::readJobs(
+        const QString& path,
+        QHash<quint64, RunResult>* results) {
+    ASSERT_FA(results == nullptr);
+    results->clear();
+    if (!QFile::exists(path)) {
+        return true;
+    }
+    QVector<ResultRow> rows;
+    int columns =
+        getColumnBit(ResultColumn::JOB_KEY) |
+        getColumnBit(ResultColumn::RESULT);
+    if (!read(path, columns, &rows)) {
+        return false;
+    }
+
+    // Results that can't be parsed (which come back as failures to start)
+    // are run again; rows without a key are stored without their result, so
+    // they're never found
+    for (const ResultRow& row : rows) {
+        RunResult result = HeadlessRun::resultFromJson(
+            QJsonDocument::fromJson(row.result.toUtf8()).object()
+        );
+        if (isReusable(result)) {
+            results->insert(row.jobKey, result);
+        }
+    }
+    return true;
+}
+
+QString ResultStore::getVersion(const QString& algoName) {
+    return toVersion(SettingsMouseAlgos::getBuildFingerprint(algoName));
+}
+
+QString ResultStore::toVersion(const QString& fingerprint) {
+    if (fingerprint.isEmpty()) {
+        return QString();
+    }
+    return QString::fromLatin1(QCryptographicHash::hash(
+        fingerprint.toUtf8(),
+        QCryptographicHash::Sha1
+    ).toHex().left(16));
+}
+
+ResultStore::ResultStore(QFile* file) : m_file(file) {
+}
+
+ResultStore::~ResultStore() {
+    flush();
+    delete m_file;
+}
+
+void ResultStore::append(const ResultRow& row) {
+    if (m_rows.isEmpty()) {
+        m_oldestRowTimer.start();
+    }
+    m_rows.append(row);
+    if (
+        ROWS_PER_BLOCK <= m_rows.size() ||
+        FLUSH_MS <= m_oldestRowTimer.elapsed()
+    ) {
+        flush();
+    }
+}
+
+void ResultStore::flush() {
+    if (m_rows.isEmpty()) {
+        return;
+    }
+    QByteArray block;
+    appendNumber(&block, m_rows.size(), 4);
+    appendNumber(&block, NUM_COLUMNS, 4);
+    QVector<QByteArray> encoded;
+    for (int i = 0; i < NUM_COLUMNS; i += 1) {
+        encoded.append(encodeColumn(static_cast<ResultColumn>(i), m_rows));
+        appendNumber(&block, encoded.last().size(), 4);
+    }
+    for (const QByteArray& column : encoded) {
+        block.append(column);
+    }
+    m_file->write(block);
+    m_file->flush();
+    m_rows.clear();
+}
+
+const char* ResultStore::getContents(QFile* file, QByteArray* bytes) {
+    uchar* memory = nullptr;
+    if (0 < file->size()) {
+        memory = file->map(0, file->size());
+    }
+    if (memory != nullptr) {
+        return reinterpret_cast<const char*>(memory);
+    }
+    file->seek(0);
+    *bytes = file->readAll();
+    return bytes->constData();
+}
+
+qint64 ResultStore::getValidSize(const char* data, qint64 size) {
+    qint64 headerSize = MAGIC.size() + 4;
+    if (
+        size < headerSize ||
+        memcmp(data, MAGIC.constData(), MAGIC.size()) != 0 ||
+        readNumber(data + MAGIC.size(), 2) != VERSION
+    ) {
+        return -1;
+    }
+
+    // Each block is only complete once every one of its columns is there
+    qint64 offset = headerSize;
+    while (8 <= size - offset) {
+        quint64 numColumns = readNumber(data + offset + 4, 4);
+        quint64 headerBytes = 8 + 4 * numColumns;
+        if (static_cast<quint64>(size - offset) < headerBytes) {
+            break;
+        }
+        quint64 blockBytes = headerBytes;
+        for (quint64 i = 0; i < numColumns; i += 1) {
+            blockBytes += readNumber(data + offset + 8 + 4 * i, 4);
+        }
+        if (static_cast<quint64>(size - offset) < blockBytes) {
+            break;
+        }
+        offset += blockBytes;
+    }
+    return offset;
+}
+
+QByteArray ResultStore::encodeColumn(
+        ResultColumn column,
+        const QVector<ResultRow>& rows) {
+
+    QByteArray bytes;
+    int size = getNumberSize(column);
+    if (0 < size) {
+        bytes.reserve(size * rows.size());
+        for (const ResultRow& row : rows) {
+            appendNumber(&bytes, getNumber(column, row), size);
+        }
+        return bytes;
+    }
+
+    // Text is mostly the same few strings over and over
+    QHash<QString, int> indices;
+    QStringList strings;
+    QByteArray stringIndices;
+    for (const ResultRow& row : rows) {
+        QString text = getText(column, row);
+        int index = indices.value(text, -1);
+        if (index < 0) {
+            index = strings.size();
+            indices.insert(text, index);
+            strings.append(text);
+        }
+        appendNumber(&stringIndices, index, 4);
+    }
+    appendNumber(&bytes, strings.size(), 4);
+    for (const QString& string : strings) {
+        QByteArray utf8 = string.toUtf8();
+        appendNumber(&bytes, utf8.size(), 4);
+        bytes.append(utf8);
+    }
+    bytes.append(stringIndices);
+    return bytes;
+}
+
+bool ResultStore::decodeColumn(
+        ResultColumn column,
+        const char* data,
+        int size,
+        QVector<ResultRow>* rows,
+        int start,
+        int count) {
+
+    int numberSize = getNumberSize(column);
+    if (0 < numberSize) {
+        if (size != numberSize * count) {
+            return false;
+        }
+        for (int i = 0; i < count; i += 1) {
+            setNumber(
+                column,
+                readNumber(data + numberSize * i, numberSize),
+                &(*rows)[start + i]
+            );
+        }
+        return true;
+    }
+
+    // The distinct strings, and then the index of each row's
+    if (size < 4) {
+        return false;
+    }
+    quint64 numStrings = readNumber(data, 4);
+    QStringList strings;
+    int offset = 4;
+    for (quint64 i = 0; i < numStrings; i += 1) {
+        if (size - offset < 4) {
+            return false;
+        }
+        quint64 length = readNumber(data + offset, 4);
+        offset += 4;
+        if (static_cast<quint64>(size - offset) < length) {
+            return false;
+        }
+        strings.append(
+            QString::fromUtf8(data + offset, static_cast<int>(length)));
+        offset += static_cast<int>(length);
+    }
+    if (size - offset != 4 * count) {
+        return false;
+    }
+    for (int i = 0; i < count; i += 1) {
+        quint64 index = readNumber(data + offset + 4 * i, 4);
+        if (static_cast<quint64>(strings.size()) <= index) {
+            return false;
+        }
+        *getTextField(column, &(*rows)[start + i]) =
+            strings.at(static_cast<int>(index));
+    }
+    return true;
+}
+
+int ResultStore::getNumberSize(ResultColumn column) {
+    switch (column) {
+        case ResultColumn::MAZE:
+        case ResultColumn::ALGO:
+        case ResultColumn::VERSION:
+        case ResultColumn::RESULT:
+            return 0;
+        case ResultColumn::STATUS:
+            return 1;
+        case ResultColumn::MOVES:
+        case ResultColumn::TURNS:
+        case ResultColumn::CRASHES:
+        case ResultColumn::RESETS:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+quint64 ResultStore::getNumber(ResultColumn column, const ResultRow& row) {
+    quint64 bits = 0;
+    switch (column) {
+        case ResultColumn::MAZE_HASH:
+            return row.mazeHash;
+        case ResultColumn::STATUS:
+            return static_cast<quint64>(row.status);
+        case ResultColumn::MOVES:
+            return static_cast<quint32>(row.moves);
+        case ResultColumn::TURNS:
+            return static_cast<quint32>(row.turns);
+        case ResultColumn::CRASHES:
+            return static_cast<quint32>(row.crashes);
+        case ResultColumn::RESETS:
+            return static_cast<quint32>(row.resets);
+        case ResultColumn::TICKS:
+            return static_cast<quint64>(row.ticks);
+        case ResultColumn::ESTIMATED_SECONDS:
+            memcpy(&bits, &row.estimatedSeconds, sizeof(bits));
+            return bits;
+        case ResultColumn::CPU_SECONDS:
+            memcpy(&bits, &row.cpuSeconds, sizeof(bits));
+            return bits;
+        case ResultColumn::TIMESTAMP:
+            return static_cast<quint64>(row.timestamp);
+        case ResultColumn::JOB_KEY:
+            return row.jobKey;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+void ResultStore::setNumber(
+        ResultColumn column,
+        quint64 value,
+        ResultRow* row) {
+    switch (column) {
+        case ResultColumn::MAZE_HASH:
+            row->mazeHash = value;
+            break;
+        case ResultColumn::STATUS:
+            row->status = static_cast<RunStatus>(value);
+            break;
+        case ResultColumn::MOVES:
+            row->moves = static_cast<qint32>(static_cast<quint32>(value));
+            break;
+        case ResultColumn::TURNS:
+            row->turns = static_cast<qint32>(static_cast<quint32>(value));
+            break;
+        case ResultColumn::CRASHES:
+            row->crashes = static_cast<qint32>(static_cast<quint32>(value));
+            break;
+        case ResultColumn::RESETS:
+            row->resets = static_cast<qint32>(static_cast<quint32>(value));
+            break;
+        case ResultColumn::TICKS:
+            row->ticks = static_cast<qint64>(value);
+            break;
+        case ResultColumn::ESTIMATED_SECONDS:
+            memcpy(&row->estimatedSeconds, &value, sizeof(value));
+            break;
+        case ResultColumn::CPU_SECONDS:
+            memcpy(&row->cpuSeconds, &value, sizeof(value));
+            break;
+        case ResultColumn::TIMESTAMP:
+            row->timestamp = static_cast<qint64>(value);
+            break;
+        case ResultColumn::JOB_KEY:
+            row->jobKey = value;
+            break;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+QString ResultStore::getText(ResultColumn column, const ResultRow& row) {
+    switch (column) {
+        case ResultColumn::MAZE:
+            return row.maze;
+        case ResultColumn::ALGO:
+            return row.algo;
+        case ResultColumn::VERSION:
+            return row.version;
+        case ResultColumn::RESULT:
+            return row.result;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+QString* ResultStore::getTextField(ResultColumn column, ResultRow* row) {
+    switch (column) {
+        case ResultColumn::MAZE:
+            return &row->maze;
+        case ResultColumn::ALGO:
+            return &row->algo;
+        case ResultColumn::VERSION:
+            return &row->version;
+        case ResultColumn::RESULT:
+            return &row->result;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+quint64 ResultStore::readNumber(const char* data, int size) {
+    uchar encoded[8] = {0};
+    memcpy(encoded, data, size);
+    return qFromLittleEndian<quint64>(encoded);
+}
+
+void ResultStore::appendNumber(QByteArray* bytes, quint64 value, int size) {
+    uchar encoded[8];
+    qToLittleEndian<quint64>(value, encoded);
+    bytes->append(reinterpret_cast<const char*>(encoded), size);
+}
+
+} 
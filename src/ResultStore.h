@@ -0,0 +1,186 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "HeadlessRun.h"
+
+namespace mms {
+
+// The columns of a result store, in the order that they're stored in
+enum class ResultColumn {
+    MAZE_HASH = 0,
+    MAZE = 1,
+    ALGO = 2,
+    VERSION = 3,
+    STATUS = 4,
+    MOVES = 5,
+    TURNS = 6,
+    CRASHES = 7,
+    RESETS = 8,
+    TICKS = 9,
+    ESTIMATED_SECONDS = 10,
+    CPU_SECONDS = 11,
+    TIMESTAMP = 12,
+    JOB_KEY = 13,
+    RESULT = 14,
+};
+
+// A run, as stored; columns that weren't read are left zero (or empty)
+struct ResultRow {
+    quint64 mazeHash; // of the walls, see Maze::getHash
+    QString maze; // the path or spec that the maze was loaded from
+    QString algo;
+    QString version; // of the algorithm's last successful build, if any
+    RunStatus status;
+    int moves;
+    int turns;
+    int crashes;
+    int resets;
+    qint64 ticks;
+    double estimatedSeconds;
+    double cpuSeconds; // negative if it isn't available
+    qint64 timestamp; // milliseconds since the epoch, when the run finished
+    quint64 jobKey; // see getJobKey, or zero if the run can't be reused
+    QString result; // the whole result, as JSON, if the run can be reused
+};
+
+class ResultStore {
+
+    // An append-only, columnar record of runs, with one row per run, that
+    // can be analyzed again without running anything. Rows are buffered, and
+    // written as a block once there are ROWS_PER_BLOCK of them, once the
+    // oldest is FLUSH_MS old (as of the next row), or once the store is
+    // closed. Readers only decode the columns that they ask for.
+    //
+    // The file starts with the magic bytes "MMSR", then a 16-bit version and
+    // 16 reserved bits. Each block is a 32-bit row count and a 32-bit column
+    // count, the 32-bit byte length of each column, and the columns, in the
+    // order of ResultColumn. Numbers are stored one after another, as 8 bytes
+    // for hashes, keys, ticks, seconds (as IEEE doubles) and timestamps, 1
+    // byte for the status (in the order of RunStatus), and 4 bytes for the
+    // rest. Text is a 32-bit count of distinct strings, each as a 32-bit
+    // length and UTF-8, followed by the 32-bit index of each row's string.
+    // All numbers are little-endian. A final block that's incomplete (e.g.,
+    // because the writer was killed) is dropped by the next writer, and
+    // ignored by readers; columns that a block doesn't have are left zero,
+    // and columns that a reader doesn't know are skipped.
+    //
+    // Runs whose inputs are all known can be memoized: such a run's row has
+    // a key for its job (see getJobKey) and its whole result, so that a later
+    // batch or tournament can take the result from the store, rather than
+    // run the same job again.
+
+public:
+
+    // Returns nullptr if the file can't be opened for appending, or is
+    // something other than a result store
+    static ResultStore* open(const QString& path);
+
+    // Reads back every row in the store at the given path, with only the
+    // given columns (a mask of getColumnBit); returns false if the file
+    // can't be read, or isn't a result store
+    static bool read(
+        const QString& path,
+        int columns,
+        QVector<ResultRow>* rows);
+    static int getColumnBit(ResultColumn column);
+
+    // The row for a run of a version of the named algorithm against a maze
+    // with the given hash, finished now, as the job with the given key, if
+    // it can be reused
+    static ResultRow toRow(
+        const RunResult& result,
+        quint64 mazeHash,
+        const QString& algoName,
+        const QString& version,
+        quint64 jobKey = 0);
+
+    // Identifies a job whose result only depends on its inputs: the version
+    // of the algorithm, the maze's hash, the rules it's run by (every limit
+    // and setting that could change the result, as text), and the engine's
+    // RESULT_VERSION (see SimulationEngine); zero if the algorithm's version
+    // isn't known, since nothing can be said about what was run
+    static quint64 getJobKey(
+        const QString& version,
+        quint64 mazeHash,
+        const QString& rules);
+
+    // Whether the same job would end the same way, as long as the algorithm
+    // is deterministic, i.e., the run wasn't cut short by the clock on the
+    // wall, and did start
+    static bool isReusable(const RunResult& result);
+
+    // Reads the result of every job in the store at the given path, the last
+    // one for each key; returns false if the file exists, but can't be read
+    // or isn't a result store
+    static bool readJobs(
+        const QString& path,
+        QHash<quint64, RunResult>* results);
+
+    // Identifies the last successful build of the named algorithm, or empty
+    // if it was never built
+    static QString getVersion(const QString& algoName);
+
+    // Identifies a build by its fingerprint
+    static QString toVersion(const QString& fingerprint);
+
+    // Writes whatever's buffered
+    ~ResultStore();
+
+    static const QByteArray MAGIC;
+    static const quint16 VERSION;
+
+    void append(const ResultRow& row);
+    void flush();
+
+private:
+
+    ResultStore(QFile* file);
+
+    static const int NUM_COLUMNS;
+    static const int ROWS_PER_BLOCK;
+    static const qint64 FLUSH_MS;
+
+    QFile* m_file;
+    QVector<ResultRow> m_rows;
+    QElapsedTimer m_oldestRowTimer;
+
+    // Maps the whole file, or else reads it into bytes
+    static const char* getContents(QFile* file, QByteArray* bytes);
+
+    // The size of the store, up to the end of its last complete block, or -1
+    // if it isn't a store at all
+    static qint64 getValidSize(const char* data, qint64 size);
+
+    static QByteArray encodeColumn(
+        ResultColumn column,
+        const QVector<ResultRow>& rows);
+
+    // Decodes a column of count rows into the rows from start on, or returns
+    // false if it's malformed
+    static bool decodeColumn(
+        ResultColumn column,
+        const char* data,
+        int size,
+        QVector<ResultRow>* rows,
+        int start,
+        int count);
+
+    // The size of each number in a column, zero for text, and its bits
+    static int getNumberSize(ResultColumn column);
+    static quint64 getNumber(ResultColumn column, const ResultRow& row);
+    static void setNumber(ResultColumn column, quint64 value, ResultRow* row);
+    static QString getText(ResultColumn column, const ResultRow& row);
+    static QString* getTextField(ResultColumn column, ResultRow* row);
+
+    static void appendNumber(QByteArray* bytes, quint64 value, int size);
+    static quint64 readNumber(const char* data, int size);
+
+};
+
+} 
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QVector>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+template<class T>
+class RingQueue {
+
+    // An unbounded queue for a single thread, whose slots are allocated up
+    // front and reused lap after lap around the ring, so that queueing and
+    // dequeueing never allocate, or copy more than the value itself, unless
+    // the ring is full, in which case it doubles. A slot keeps its value
+    // until it's overwritten, so values that own memory (e.g., strings) keep
+    // their capacity for the next value queued in their slot. The capacity
+    // is always a power of two so that wrapping is a mask.
+
+public:
+
+    RingQueue(int capacity);
+
+    bool isEmpty() const;
+    int size() const;
+
+    // The value at the head, which the queue must not be empty for; it stays
+    // valid until the head is dequeued, or a value is enqueued
+    const T& head() const;
+
+    void enqueue(const T& value);
+    void dequeue();
+    void clear();
+
+private:
+
+    QVector<T> m_slots;
+    int m_mask;
+    int m_read;
+    int m_size;
+
+};
+
+template<class T>
+RingQueue<T>::RingQueue(int capacity) :
+    m_slots(capacity),
+    m_mask(capacity - 1),
+    m_read(0),
+    m_size(0) {
+    ASSERT_LT(0, capacity);
+    ASSERT_EQ(capacity & (capacity - 1), 0);
+}
+
+template<class T>
+bool RingQueue<T>::isEmpty() const {
+    return m_size == 0;
+}
+
+template<class T>
+int RingQueue<T>::size() const {
+    return m_size;
+}
+
+template<class T>
+const T& RingQueue<T>::head() const {
+    ASSERT_LT(0, m_size);
+    return m_slots.at(m_read);
+}
+
+template<class T>
+void RingQueue<T>::enqueue(const T& value) {
+    if (m_size == m_slots.size()) {
+        // Unwrap the values into the front of a ring that's twice the size
+        QVector<T> slots(2 * m_slots.size());
+        for (int i = 0; i < m_size; i += 1) {
+            slots[i] = m_slots.at((m_read + i) & m_mask);
+        }
+        m_slots.swap(slots);
+        m_mask = m_slots.size() - 1;
+        m_read = 0;
+    }
+    m_slots[(m_read + m_size) & m_mask] = value;
+    m_size += 1;
+}
+
+template<class T>
+void RingQueue<T>::dequeue() {
+    ASSERT_LT(0, m_size);
+    m_read = (m_read + 1) & m_mask;
+    m_size -= 1;
+}
+
+template<class T>
+void RingQueue<T>::clear() {
+    m_read = 0;
+    m_size = 0;
+}
+
+} 
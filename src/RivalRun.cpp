@@ -0,0 +1,179 @@
+#include "RivalRun.h"
+
+#include <QMetaObject>
+#include <QTimer>
+
+#include "AssertMacros.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+RivalRun::RivalRun(const QString& name, const Maze* maze, QThread* ioThread) :
+    QObject(nullptr),
+    m_name(name),
+    m_ioThread(ioThread),
+    m_view(new MazeView(maze)),
+    m_engine(new SimulationEngine(maze, m_view)),
+    m_mouseGraphic(new MouseGraphic(m_engine->getMouse())),
+    m_worker(nullptr) {
+    connect(
+        m_engine,
+        &SimulationEngine::responsesReady,
+        this,
+        &RivalRun::writeResponses
+    );
+}
+
+RivalRun::~RivalRun() {
+    cancel();
+    delete m_engine;
+    delete m_view;
+    delete m_mouseGraphic;
+}
+
+QString RivalRun::getName() const {
+    return m_name;
+}
+
+SimulationEngine* RivalRun::getEngine() const {
+    return m_engine;
+}
+
+const MazeView* RivalRun::getView() const {
+    return m_view;
+}
+
+const MouseGraphic* RivalRun::getMouseGraphic() const {
+    return m_mouseGraphic;
+}
+
+void RivalRun::start(
+        const QStringList& runArguments,
+        const QString& directory) {
+    ASSERT_TR(m_worker == nullptr);
+    ProcessWorker* worker = new ProcessWorker();
+    worker->moveToThread(m_ioThread);
+    m_worker = worker;
+
+    connect(worker, &ProcessWorker::logsReady, this, [=](QStringList logs){
+        if (worker == m_worker) {
+            log(logs);
+        }
+    });
+    connect(worker, &ProcessWorker::commandsAvailable, this, [=](){
+        if (worker == m_worker) {
+            onCommandsAvailable();
+        }
+    });
+    connect(
+        worker,
+        &ProcessWorker::finished,
+        this,
+        [=](int exitCode, QProcess::ExitStatus exitStatus){
+            if (worker == m_worker) {
+                onExit(exitCode, exitStatus);
+            }
+        }
+    );
+    connect(worker, &ProcessWorker::failedToStart, this, [=](QString error){
+        if (worker == m_worker) {
+            log({error});
+            onExit(-1, QProcess::CrashExit);
+        }
+    });
+
+    QMetaObject::invokeMethod(
+        worker,
+        "start",
+        Qt::QueuedConnection,
+        Q_ARG(QStringList, runArguments),
+        Q_ARG(QString, directory)
+    );
+}
+
+bool RivalRun::isRunning() const {
+    return m_worker != nullptr;
+}
+
+void RivalRun::cancel() {
+    if (m_worker == nullptr) {
+        return;
+    }
+    QMetaObject::invokeMethod(
+        m_worker,
+        "kill",
+        Qt::BlockingQueuedConnection
+    );
+    // The exit notification is queued behind us; clean up right away
+    onExit(-1, QProcess::CrashExit);
+}
+
+void RivalRun::onCommandsAvailable() {
+    double deadline =
+        SimUtilities::getHighResTimestamp() +
+        ProcessWorker::CONSUMER_SLICE_SECONDS;
+    ParsedCommand parsed;
+    m_engine->beginResponseBatch();
+    while (m_worker->takeCommand(&parsed)) {
+        m_engine->dispatchCommand(
+            parsed.command,
+            parsed.spec,
+            parsed.receivedTimestamp
+        );
+        if (deadline < SimUtilities::getHighResTimestamp()) {
+            ProcessWorker* worker = m_worker;
+            QTimer::singleShot(0, this, [=](){
+                if (worker == m_worker) {
+                    onCommandsAvailable();
+                }
+            });
+            break;
+        }
+    }
+    m_engine->endResponseBatch();
+}
+
+void RivalRun::writeResponses(const QByteArray& bytes, int numResponses) {
+    Q_UNUSED(numResponses);
+    if (m_worker == nullptr) {
+        return;
+    }
+    QMetaObject::invokeMethod(
+        m_worker,
+        "write",
+        Qt::QueuedConnection,
+        Q_ARG(QByteArray, bytes)
+    );
+}
+
+void RivalRun::onExit(int exitCode, QProcess::ExitStatus exitStatus) {
+
+    // Anything the worker sent before it goes away is ignored from now on
+    m_worker->deleteLater();
+    m_worker = nullptr;
+    m_engine->stop();
+
+    // Enough to compare the rival with the window's own algorithm
+    QStringList trialSeconds;
+    for (double seconds : m_engine->getEstimatedTrialSeconds()) {
+        trialSeconds.append(QString::number(seconds, 'f', 3) + " s");
+    }
+    log({QString("Exited with code %1, after %2 moves and %3 turns; "
+        "estimated run time of each trial: %4").arg(
+            QString::number(exitCode),
+            QString::number(m_engine->getNumMoves()),
+            QString::number(m_engine->getNumTurns()),
+            trialSeconds.join(", ")
+        )});
+    emit exited(exitCode, exitStatus);
+}
+
+void RivalRun::log(const QStringList& lines) {
+    QStringList prefixed;
+    for (const QString& line : lines) {
+        prefixed.append(QString("[%1] %2").arg(m_name, line));
+    }
+    emit logsReady(prefixed);
+}
+
+} 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+#include "Maze.h"
+#include "MazeView.h"
+#include "MouseGraphic.h"
+#include "ProcessWorker.h"
+#include "SimulationEngine.h"
+
+namespace mms {
+
+class RivalRun : public QObject {
+
+    // Another algorithm, run alongside the window's own against the same
+    // maze, with a process of its own (read and parsed on the given I/O
+    // thread), and its own engine, view and mouse. Only its mouse and its
+    // output are shown; whoever owns it keeps its engine's settings in step
+    // with those of the window's own engine.
+
+    Q_OBJECT
+
+public:
+
+    // No ownership of the maze or the thread; the view, engine and mouse are
+    // created right away, so that the mouse can be shown before the process
+    // has started
+    RivalRun(const QString& name, const Maze* maze, QThread* ioThread);
+
+    // Kills the process, if it's still running
+    ~RivalRun();
+
+    QString getName() const;
+    SimulationEngine* getEngine() const;
+    const MazeView* getView() const;
+    const MouseGraphic* getMouseGraphic() const;
+
+    // Doesn't wait for the process to start
+    void start(const QStringList& runArguments, const QString& directory);
+    bool isRunning() const;
+    void cancel();
+
+signals:
+
+    // Lines logged by the process, or about it, prefixed with its name
+    void logsReady(const QStringList& logs);
+
+    void exited(int exitCode, QProcess::ExitStatus exitStatus);
+
+private:
+
+    QString m_name;
+    QThread* m_ioThread;
+    MazeView* m_view;
+    SimulationEngine* m_engine;
+    MouseGraphic* m_mouseGraphic;
+
+    // Notifications from a worker that's since been replaced are ignored
+    ProcessWorker* m_worker;
+
+    void onCommandsAvailable();
+    void writeResponses(const QByteArray& bytes, int numResponses);
+    void onExit(int exitCode, QProcess::ExitStatus exitStatus);
+    void log(const QStringList& lines);
+};
+
+} 
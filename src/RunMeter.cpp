@@ -0,0 +1,197 @@
+#include "RunMeter.h"
+
+#include "ProcessUtilities.h"
+#include "Profiler.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const int RunMeter::SAMPLE_INTERVAL_MS = 250;
+
+RunMeter::RunMeter(QObject* parent) :
+    QObject(parent),
+    m_sampleTimer(new QTimer(this)),
+    m_processId(0),
+    m_isRunning(false),
+    m_startCpuSeconds(0.0),
+    m_cpuSeconds(-1.0),
+    m_peakResidentBytes(-1),
+    m_startTimestamp(0.0),
+    m_lastTimestamp(0.0),
+    m_stopTimestamp(0.0),
+    m_numPendingResponses(0),
+    m_isDispatching(false),
+    m_stats({0.0, -1.0, -1, 0, 0.0, 0, 0, 0.0, 0.0, 0, 0.0, 0.0, 0.0}),
+    m_thinkTimes(LatencyHistogram()),
+    m_thinkStart(-1),
+    m_thinkTrack() {
+    m_sampleTimer->setInterval(SAMPLE_INTERVAL_MS);
+    connect(m_sampleTimer, &QTimer::timeout, this, [=](){
+        sample();
+    });
+}
+
+void RunMeter::start() {
+    m_processId = 0;
+    m_cpuSeconds = -1.0;
+    m_peakResidentBytes = -1;
+    restart();
+}
+
+void RunMeter::restart() {
+    m_isRunning = true;
+    m_startCpuSeconds = qMax(m_cpuSeconds, 0.0);
+    m_startTimestamp = SimUtilities::getHighResTimestamp();
+    m_lastTimestamp = m_startTimestamp;
+    m_numPendingResponses = 0;
+    m_isDispatching = false;
+    m_stats = {0.0, -1.0, -1, 0, 0.0, 0, 0, 0.0, 0.0, 0, 0.0, 0.0, 0.0};
+    m_thinkTimes.clear();
+    m_thinkStart = Profiler::now();
+    if (m_processId != 0) {
+        m_sampleTimer->start();
+    }
+}
+
+void RunMeter::setProcessId(qint64 processId) {
+    m_processId = processId;
+    sample();
+    if (m_isRunning) {
+        m_sampleTimer->start();
+    }
+}
+
+void RunMeter::stop() {
+    if (!m_isRunning) {
+        return;
+    }
+    account();
+    sample();
+    m_sampleTimer->stop();
+    m_thinkStart = -1;
+    m_stopTimestamp = m_lastTimestamp;
+    m_isRunning = false;
+}
+
+void RunMeter::recordInput(qint64 bytes) {
+    m_stats.bytesIn += bytes;
+}
+
+void RunMeter::recordResponse(qint64 bytes, int numResponses) {
+    account();
+    m_stats.bytesOut += bytes;
+    m_numPendingResponses -= qMin(m_numPendingResponses, numResponses);
+    if (m_isRunning && m_numPendingResponses == 0 && m_thinkStart < 0) {
+        m_thinkStart = Profiler::now();
+    }
+}
+
+void RunMeter::beginCommand(bool hasResponse) {
+    account();
+    if (0 <= m_thinkStart) {
+        qint64 now = Profiler::now();
+        m_thinkTimes.record((now - m_thinkStart) / 1e9);
+        if (!m_thinkTrack.isEmpty() && Profiler::isEnabled()) {
+            Profiler::recordOnTrack(m_thinkTrack, "think", m_thinkStart, now);
+        }
+        m_thinkStart = -1;
+    }
+    m_stats.commands += 1;
+    if (hasResponse) {
+        m_numPendingResponses += 1;
+    }
+    m_isDispatching = true;
+}
+
+void RunMeter::endCommand() {
+    account();
+    m_isDispatching = false;
+}
+
+void RunMeter::setThinkTrack(const QString& track) {
+    m_thinkTrack = track;
+}
+
+RunStats RunMeter::getStats() const {
+    RunStats stats = m_stats;
+    stats.thinks = m_thinkTimes.getCount();
+    stats.thinkP50Seconds = m_thinkTimes.getPercentileSeconds(0.5);
+    stats.thinkP99Seconds = m_thinkTimes.getPercentileSeconds(0.99);
+    stats.thinkMaxSeconds = m_thinkTimes.getMaxSeconds();
+    double end = m_isRunning ? SimUtilities::getHighResTimestamp()
+                             : m_stopTimestamp;
+    stats.wallSeconds = end - m_startTimestamp;
+    if (0.0 < stats.wallSeconds) {
+        stats.commandsPerSecond = stats.commands / stats.wallSeconds;
+    }
+    if (0.0 <= m_cpuSeconds) {
+        stats.cpuSeconds = m_cpuSeconds - m_startCpuSeconds;
+    }
+    stats.peakResidentBytes = m_peakResidentBytes;
+    return stats;
+}
+
+QString RunMeter::format(const RunStats& stats) {
+    QString cpu = "n/a";
+    if (0.0 <= stats.cpuSeconds) {
+        cpu = QString::number(stats.cpuSeconds, 'f', 3) + " s";
+    }
+    QString peak = "n/a";
+    if (0 <= stats.peakResidentBytes) {
+        peak = QString::number(stats.peakResidentBytes / 1048576.0, 'f', 1) +
+            " MB";
+    }
+    return QString(
+        "wall %1 s, cpu %2, peak rss %3, %4 commands (%5/s), "
+        "%6 bytes in, %7 bytes out, waited %8 s on the simulator and "
+        "%9 s on the algorithm, "
+        "%10 think times (p50 %11 ms, p99 %12 ms, max %13 ms)"
+    ).arg(
+        QString::number(stats.wallSeconds, 'f', 3),
+        cpu,
+        peak,
+        QString::number(stats.commands),
+        QString::number(stats.commandsPerSecond, 'f', 1),
+        QString::number(stats.bytesIn),
+        QString::number(stats.bytesOut),
+        QString::number(stats.simulatorSeconds, 'f', 3),
+        QString::number(stats.algorithmSeconds, 'f', 3)
+    ).arg(
+        QString::number(stats.thinks),
+        QString::number(stats.thinkP50Seconds * 1000.0, 'f', 3),
+        QString::number(stats.thinkP99Seconds * 1000.0, 'f', 3),
+        QString::number(stats.thinkMaxSeconds * 1000.0, 'f', 3)
+    );
+}
+
+void RunMeter::sample() {
+    if (m_processId == 0) {
+        return;
+    }
+    double cpuSeconds = 0.0;
+    qint64 peakResidentBytes = 0;
+    bool isSampled = ProcessUtilities::getResourceUsage(
+        m_processId,
+        &cpuSeconds,
+        &peakResidentBytes);
+    if (isSampled) {
+        m_cpuSeconds = cpuSeconds;
+        m_peakResidentBytes = qMax(m_peakResidentBytes, peakResidentBytes);
+    }
+}
+
+void RunMeter::account() {
+    if (!m_isRunning) {
+        return;
+    }
+    double now = SimUtilities::getHighResTimestamp();
+    if (m_isDispatching || 0 < m_numPendingResponses) {
+        m_stats.simulatorSeconds += now - m_lastTimestamp;
+    }
+    else {
+        m_stats.algorithmSeconds += now - m_lastTimestamp;
+    }
+    m_lastTimestamp = now;
+}
+
+} 
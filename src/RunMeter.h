@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "LatencyHistogram.h"
+#include "RunStats.h"
+
+namespace mms {
+
+class RunMeter : public QObject {
+
+    // Collects the statistics of a run, as the run reports its input,
+    // commands and responses. The process has to be sampled while it's still
+    // running, since a process that's gone can't be asked about its resource
+    // usage; it's sampled periodically, and once more when the meter stops.
+    //
+    // A single process may be metered over several consecutive intervals
+    // (e.g., one per maze); each restart begins a new interval, and its CPU
+    // time is counted from there, though the peak resident set size is
+    // always the peak of the whole process.
+    //
+    // The algorithm's think times (see RunStats) are measured with the
+    // profiler's clock, and, while the profiler is enabled, each one can be
+    // recorded as a zone of its own track, next to the simulator's threads.
+
+    Q_OBJECT
+
+public:
+
+    RunMeter(QObject* parent = 0);
+
+    // Starts metering a new process, or a new interval of the same process;
+    // sampling starts once the process is known
+    void start();
+    void restart();
+    void setProcessId(qint64 processId);
+
+    // Counting stops, and the process is sampled a final time, until the
+    // next restart
+    void stop();
+
+    void recordInput(qint64 bytes);
+    void recordResponse(qint64 bytes, int numResponses = 1);
+
+    // To be called around the handling of every command
+    void beginCommand(bool hasResponse);
+    void endCommand();
+
+    // The profiler track (see Profiler) that think times are recorded on,
+    // or none, which is the default
+    void setThinkTrack(const QString& track);
+
+    RunStats getStats() const;
+
+    // A single line summary, for people to read
+    static QString format(const RunStats& stats);
+
+private:
+
+    static const int SAMPLE_INTERVAL_MS;
+
+    QTimer* m_sampleTimer;
+    qint64 m_processId;
+    bool m_isRunning;
+
+    // The CPU time at the start of the interval, and the latest sample,
+    // which is negative until the process has been sampled
+    double m_startCpuSeconds;
+    double m_cpuSeconds;
+    qint64 m_peakResidentBytes;
+
+    double m_startTimestamp;
+    double m_lastTimestamp;
+    double m_stopTimestamp;
+    int m_numPendingResponses;
+    bool m_isDispatching;
+    RunStats m_stats;
+
+    // When the current think time began, by the profiler's clock, or -1 if
+    // the algorithm is waiting on the simulator
+    LatencyHistogram m_thinkTimes;
+    qint64 m_thinkStart;
+    QString m_thinkTrack;
+
+    void sample();
+
+    // Attributes the time since the last event to the simulator or the
+    // algorithm, depending on which one was being waited on
+    void account();
+};
+
+} 
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mms {
+
+// Resource accounting for a single run of an algorithm. The CPU time and the
+// peak resident set size are sampled from the operating system while the
+// process runs, so they're negative if they aren't available. Time spent
+// waiting on the simulator is time when the algorithm had a command without
+// a response yet (or when a command was being performed); the rest of the
+// wall time was spent waiting on the algorithm. Of that time, the algorithm's
+// think times are the gaps from the start of the run, and from each moment
+// that it had every response that it was waiting for, until its next
+// command.
+struct RunStats {
+    double wallSeconds; // time from the start of the run to its end
+    double cpuSeconds; // user and system time used by the process
+    qint64 peakResidentBytes; // peak resident set size of the process
+    int commands; // number of commands received
+    double commandsPerSecond; // commands received per second of wall time
+    qint64 bytesIn; // bytes of commands read from the algorithm
+    qint64 bytesOut; // bytes of responses written to the algorithm
+    double simulatorSeconds; // time spent waiting on the simulator
+    double algorithmSeconds; // time spent waiting on the algorithm
+    int thinks; // number of think times
+    double thinkP50Seconds; // of the think times, or zero if there were none
+    double thinkP99Seconds;
+    double thinkMaxSeconds;
+};
+
+} 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mms {
+
+// What a mouse did over a whole run, i.e., across resets. Each trial starts
+// from the starting cell, either at the start of the run or after a reset;
+// the best trial is the one that reached the center in the least estimated
+// time. Times that never happened are negative.
+struct RunSummary {
+    int moves;
+    int turns;
+    int crashes;
+    int resets;
+    int cellsExplored; // distinct cells visited
+    int numCells; // in the whole maze
+    qint64 firstCenterTicks; // of the simulation clock
+    double firstCenterSeconds; // of the simulation clock
+    int firstCenterMoves;
+    int bestTrial; // counting from zero, or -1
+    double bestTrialSeconds; // estimated, from the start to the center
+    double estimatedSeconds; // of every trial, in total
+};
+
+} 
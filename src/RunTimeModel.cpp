@@ -0,0 +1,82 @@
+#include "RunTimeModel.h"
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+RunTimeModel::RunTimeModel(const RunTimeParameters& parameters) :
+    m_parameters(parameters),
+    m_time(),
+    m_straightLength(),
+    m_straightSpeed() {
+    ASSERT_LT(0.0, m_parameters.maxSpeed);
+    ASSERT_LT(0.0, m_parameters.acceleration);
+    ASSERT_LE(0.0, m_parameters.turnSeconds);
+    ASSERT_LT(0.0, m_parameters.curveSpeed);
+    ASSERT_LE(m_parameters.curveSpeed, m_parameters.maxSpeed);
+}
+
+const RunTimeParameters& RunTimeModel::DEFAULT_PARAMETERS() {
+    static const RunTimeParameters parameters = {1.5, 4.0, 0.3, 0.6};
+    return parameters;
+}
+
+void RunTimeModel::addStraight(double meters) {
+    m_straightLength += Meters(meters);
+}
+
+void RunTimeModel::addTurn() {
+    m_time += getStraightTime(m_straightLength, m_straightSpeed, Speed());
+    m_time += Seconds(m_parameters.turnSeconds);
+    m_straightLength = Length();
+    m_straightSpeed = Speed();
+}
+
+void RunTimeModel::addCurve(double meters) {
+    Speed speed = MetersPerSecond(m_parameters.curveSpeed);
+    m_time += getStraightTime(m_straightLength, m_straightSpeed, speed);
+    m_time += Meters(meters) / speed;
+    m_straightLength = Length();
+    m_straightSpeed = speed;
+}
+
+double RunTimeModel::getSeconds() const {
+    return (
+        m_time +
+        getStraightTime(m_straightLength, m_straightSpeed, Speed())
+    ).getSI();
+}
+
+Duration RunTimeModel::getStraightTime(
+        Length length,
+        Speed startSpeed,
+        Speed endSpeed) const {
+    if (length <= Length()) {
+        return Duration();
+    }
+    Acceleration acceleration =
+        MetersPerSecondSquared(m_parameters.acceleration);
+
+    // The top speed is where speeding up meets braking, if that's below the
+    // limit; if it isn't above both ends, the straight is too short to get
+    // from one speed to the other, and the speed is taken to change evenly
+    Speed fastestEnd = endSpeed < startSpeed ? startSpeed : endSpeed;
+    auto topSquared =
+        acceleration * length +
+        (startSpeed * startSpeed + endSpeed * endSpeed) / 2.0;
+    if (topSquared <= fastestEnd * fastestEnd) {
+        return length * 2.0 / (startSpeed + endSpeed);
+    }
+    Speed top = squareRoot(topSquared);
+    if (MetersPerSecond(m_parameters.maxSpeed) < top) {
+        top = MetersPerSecond(m_parameters.maxSpeed);
+    }
+    Length rampLength =
+        (top * top * 2.0 - startSpeed * startSpeed - endSpeed * endSpeed) /
+        (acceleration * 2.0);
+    return
+        (top * 2.0 - startSpeed - endSpeed) / acceleration +
+        (length - rampLength) / top;
+}
+
+} 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "units/Quantity.h"
+
+namespace mms {
+
+// A mouse's limits, as far as the time of a run is concerned; speeds are in
+// meters per second, and the acceleration (also used to brake) is in meters
+// per second squared
+struct RunTimeParameters {
+    double maxSpeed;
+    double acceleration;
+    double turnSeconds;
+    double curveSpeed;
+};
+
+class RunTimeModel {
+
+    // Estimates how long a real mouse would take to make the movements of a
+    // run, in closed form, so that runs can be ranked by time without
+    // simulating any physics. The mouse drives every straight as fast as it
+    // can, speeding up and braking at a constant acceleration, turns in place
+    // from rest in a fixed time, and takes every curve at a constant speed.
+    // Consecutive straights make up a single straight, since nothing slows
+    // the mouse down between them.
+
+public:
+
+    RunTimeModel(const RunTimeParameters& parameters = DEFAULT_PARAMETERS());
+
+    // Close to the limits of the continuous movement dynamics, with curves
+    // taken no faster than the mouse can accelerate sideways around a curve
+    // with a radius of half a tile
+    static const RunTimeParameters& DEFAULT_PARAMETERS();
+
+    void addStraight(double meters);
+    void addTurn();
+    void addCurve(double meters);
+
+    // The estimated time of every movement so far, including the straight
+    // that's still in progress
+    double getSeconds() const;
+
+private:
+
+    RunTimeParameters m_parameters;
+
+    // The time of every completed straight, turn and curve, and the length
+    // of the current straight, and the speed that it started at
+    Duration m_time;
+    Length m_straightLength;
+    Speed m_straightSpeed;
+
+    // The time to drive the given distance, from one speed to another
+    Duration getStraightTime(
+        Length length,
+        Speed startSpeed,
+        Speed endSpeed) const;
+};
+
+} 
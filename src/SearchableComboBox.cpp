@@ -0,0 +1,57 @@
+#include "SearchableComboBox.h"
+
+#include <QCompleter>
+#include <QLineEdit>
+#include <QListView>
+
+namespace mms {
+
+SearchableComboBox::SearchableComboBox(QWidget* parent) : QComboBox(parent) {
+    setEditable(true);
+    setInsertPolicy(QComboBox::NoInsert);
+    setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    QListView* view = new QListView();
+    view->setUniformItemSizes(true);
+    setView(view);
+
+    QCompleter* completer = new QCompleter(model(), this);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setFilterMode(Qt::MatchContains);
+    completer->setCompletionMode(QCompleter::PopupCompletion);
+    QListView* popup = new QListView();
+    popup->setUniformItemSizes(true);
+    completer->setPopup(popup);
+    setCompleter(completer);
+    connect(
+        lineEdit(),
+        &QLineEdit::editingFinished,
+        this,
+        &SearchableComboBox::onEditingFinished
+    );
+}
+
+void SearchableComboBox::setModel(QAbstractItemModel* model) {
+    QComboBox::setModel(model);
+    completer()->setModel(model);
+}
+
+QString SearchableComboBox::getSelectedText() const {
+    return itemText(currentIndex());
+}
+
+void SearchableComboBox::select(const QString& text) {
+    int index = findText(text);
+    if (index == -1 && 0 < count()) {
+        index = 0;
+    }
+    setCurrentIndex(index);
+    setEditText(getSelectedText());
+}
+
+void SearchableComboBox::onEditingFinished() {
+    if (lineEdit()->text() != getSelectedText()) {
+        setEditText(getSelectedText());
+    }
+}
+
+} 
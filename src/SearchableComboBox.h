@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QComboBox>
+#include <QString>
+#include <QWidget>
+
+namespace mms {
+
+class SearchableComboBox : public QComboBox {
+
+    // A combo box whose items can be searched by typing any part of them:
+    // matching items are listed in a popup as the text is typed, and
+    // choosing one activates it as if it had been chosen from the combo
+    // box's own list. Text that matches no item is discarded once editing
+    // finishes. Both lists lay out their rows as though they were all the
+    // same size, and the combo box isn't sized to its contents, so that
+    // only the rows that are shown are ever asked for, however many there
+    // are. The current item is the one that was last chosen, rather than
+    // whatever's being typed.
+
+    Q_OBJECT
+
+public:
+
+    SearchableComboBox(QWidget* parent = 0);
+
+    // Hides QComboBox::setModel, so that searches use the new model too
+    void setModel(QAbstractItemModel* model);
+
+    // The text of the current item, or empty if there is none
+    QString getSelectedText() const;
+
+    // Makes the item with the text current, or else the first item
+    void select(const QString& text);
+
+private:
+
+    void onEditingFinished();
+};
+
+} 
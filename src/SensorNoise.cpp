@@ -0,0 +1,86 @@
+#include "SensorNoise.h"
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int SensorNoise::BATCH_SIZE = 64;
+const quint64 SensorNoise::GOLDEN_GAMMA = 0x9e3779b97f4a7c15ULL;
+const double SensorNoise::UNIT = 1.0 / 9007199254740992.0;
+
+SensorNoise::SensorNoise() :
+    SensorNoise(0.0, 0.0, 0, 0) {
+}
+
+SensorNoise::SensorNoise(
+        double falsePositiveRate,
+        double falseNegativeRate,
+        quint64 seed,
+        quint64 stream) :
+    m_falsePositiveRate(falsePositiveRate),
+    m_falseNegativeRate(falseNegativeRate),
+    m_key(mix(mix(seed) + stream * GOLDEN_GAMMA)),
+    m_counter(0),
+    m_batch(QVector<double>(BATCH_SIZE)),
+    m_next(BATCH_SIZE) {
+    ASSERT_TR(isValidRate(m_falsePositiveRate));
+    ASSERT_TR(isValidRate(m_falseNegativeRate));
+}
+
+bool SensorNoise::isValidRate(double rate) {
+    return 0.0 <= rate && rate <= 1.0;
+}
+
+bool SensorNoise::isEnabled() const {
+    return 0.0 < m_falsePositiveRate || 0.0 < m_falseNegativeRate;
+}
+
+double SensorNoise::getFalsePositiveRate() const {
+    return m_falsePositiveRate;
+}
+
+double SensorNoise::getFalseNegativeRate() const {
+    return m_falseNegativeRate;
+}
+
+bool SensorNoise::read(bool isWall) {
+    if (!isEnabled()) {
+        return isWall;
+    }
+    if (m_next == BATCH_SIZE) {
+        refill();
+    }
+    double number = m_batch.at(m_next);
+    m_next += 1;
+
+    // A rate of one always misreads, since every number is less than one
+    if (isWall) {
+        return !(number < m_falseNegativeRate);
+    }
+    return number < m_falsePositiveRate;
+}
+
+quint64 SensorNoise::getNumReadings() const {
+    return m_counter - static_cast<quint64>(BATCH_SIZE - m_next);
+}
+
+void SensorNoise::refill() {
+    double* batch = m_batch.data();
+    quint64 key = m_key;
+    quint64 counter = m_counter;
+    for (int i = 0; i < BATCH_SIZE; i += 1) {
+        quint64 hash = mix(key + (counter + i) * GOLDEN_GAMMA);
+        batch[i] = static_cast<double>(hash >> 11) * UNIT;
+    }
+    m_counter += BATCH_SIZE;
+    m_next = 0;
+}
+
+quint64 SensorNoise::mix(quint64 value) {
+    // The finalizer of SplitMix64
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+} 
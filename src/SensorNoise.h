@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QVector>
+#include <QtGlobal>
+
+namespace mms {
+
+class SensorNoise {
+
+    // Misreads walls, as real sensors do: a wall is missed with the false
+    // negative rate, and an open side is read as a wall with the false
+    // positive rate. Every reading draws the next number of a counter-based
+    // stream, i.e., its number is a hash of the seed, the stream and its
+    // index, rather than the next state of a generator, so that any number
+    // of runs (e.g., the trials of a Monte Carlo run, on as many threads)
+    // can each have a stream of their own, reproducible from the seed alone,
+    // regardless of which ran where or when. Numbers are generated a batch
+    // at a time, in a loop in which each is independent of the others,
+    // which the compiler is free to vectorize. Noise with both rates zero,
+    // which is the default, reads every wall as it is, and draws nothing.
+
+public:
+
+    SensorNoise();
+    SensorNoise(
+        double falsePositiveRate,
+        double falseNegativeRate,
+        quint64 seed,
+        quint64 stream);
+
+    // Rates are probabilities, from zero to one
+    static bool isValidRate(double rate);
+
+    bool isEnabled() const;
+    double getFalsePositiveRate() const;
+    double getFalseNegativeRate() const;
+
+    // What the sensor reads, given whether there's a wall
+    bool read(bool isWall);
+
+    // How many readings have drawn from the stream so far
+    quint64 getNumReadings() const;
+
+private:
+
+    static const int BATCH_SIZE;
+
+    // The golden ratio increment of SplitMix64, which spaces the counters of
+    // a stream (and the streams of a seed) out over the whole range of the
+    // hash, and the unit of a uniform number, which takes the top 53 bits of
+    // a hash, i.e., all that a double can hold exactly
+    static const quint64 GOLDEN_GAMMA;
+    static const double UNIT;
+
+    double m_falsePositiveRate;
+    double m_falseNegativeRate;
+    quint64 m_key;
+    quint64 m_counter;
+    QVector<double> m_batch;
+    int m_next;
+
+    // Fills the batch with the uniform numbers, from zero up to one, that
+    // follow the counter
+    void refill();
+    static quint64 mix(quint64 value);
+
+};
+
+} 
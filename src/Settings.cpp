@@ -8,6 +8,7 @@
 namespace mms {
 
 Settings* Settings::INSTANCE = nullptr;
+const int Settings::WRITE_DELAY_MS = 500;
 
 void Settings::init() {
     ASSERT_TR(INSTANCE == nullptr);
@@ -19,21 +20,61 @@ Settings* Settings::get() {
     return INSTANCE;
 }
 
-QString Settings::value(QString group, QString key) {
+void Settings::flush() {
+
+    m_writeTimer.stop();
+    if (m_dirtyValues.isEmpty() && m_dirtyGroups.isEmpty()) {
+        return;
+    }
+
+    // Write every changed group with a single QSettings
     QSettings settings;
-    settings.beginGroup(group);
-    return settings.value(key).toString();
+    for (const QString& group : m_dirtyValues) {
+        const QMap<QString, QString>& values = m_values[group];
+        settings.beginGroup(group);
+        QMap<QString, QString>::const_iterator it;
+        for (it = values.constBegin(); it != values.constEnd(); it += 1) {
+            settings.setValue(it.key(), it.value());
+        }
+        settings.endGroup();
+    }
+    for (const QString& group : m_dirtyGroups) {
+        // Arrays can shrink, so the old entries must be removed first
+        settings.remove(group);
+        settings.beginWriteArray(group);
+        const QVector<QMap<QString, QString>>& entries = m_groups[group];
+        for (int i = 0; i < entries.size(); i += 1) {
+            settings.setArrayIndex(i);
+            const QMap<QString, QString>& entry = entries.at(i);
+            QMap<QString, QString>::const_iterator it;
+            for (it = entry.constBegin(); it != entry.constEnd(); it += 1) {
+                settings.setValue(it.key(), it.value());
+            }
+        }
+        settings.endArray();
+    }
+    settings.sync();
+    m_dirtyValues.clear();
+    m_dirtyGroups.clear();
+}
+
+QString Settings::value(QString group, QString key) {
+    return getValues(group)->value(key);
 }
 
 void Settings::update(QString group, QString key, QString value) {
-    QSettings settings;
-    settings.beginGroup(group);
-    settings.setValue(key, value);
+    QMap<QString, QString>* values = getValues(group);
+    if (values->contains(key) && values->value(key) == value) {
+        return;
+    }
+    values->insert(key, value);
+    m_dirtyValues.insert(group);
+    scheduleWrite();
 }
 
 QStringList Settings::values(QString group, QString key) {
     QStringList values;
-    for (const auto& entry : getGroup(group)) {
+    for (const auto& entry : *getGroup(group)) {
         values << entry.value(key);
     }
     values.sort(Qt::CaseInsensitive);
@@ -46,19 +87,10 @@ void Settings::add(QString group, QMap<QString, QString> entry) {
     ASSERT_FA(group.isEmpty());
     ASSERT_FA(entry.isEmpty());
 
-    // Get the current size
-    QSettings settings;
-    int size = settings.beginReadArray(group);
-    settings.endArray();
-
     // Append the element at the current size
-    settings.beginWriteArray(group);
-    settings.setArrayIndex(size);
-    QMap<QString, QString>::const_iterator it;
-    for (it = entry.constBegin(); it != entry.constEnd(); it += 1) {
-        settings.setValue(it.key(), it.value());
-    }
-    settings.endArray();
+    getGroup(group)->append(entry);
+    m_dirtyGroups.insert(group);
+    scheduleWrite();
 }
 
 void Settings::remove(QString group, QString key, QString value) {
@@ -67,27 +99,20 @@ void Settings::remove(QString group, QString key, QString value) {
     ASSERT_FA(group.isEmpty());
     ASSERT_FA(key.isEmpty());
 
-    // Get all existing entries
-    QVector<QMap<QString, QString>> entries = getGroup(group);
-
-    // Remove all existing entries
-    QSettings settings;
-    settings.remove(group);
-
-    // Write back entries that don't have value given
-    settings.beginWriteArray(group);
-    int index = 0;
-    for (const auto& entry : entries) {
+    // Keep the entries that don't have value given
+    QVector<QMap<QString, QString>>* entries = getGroup(group);
+    QVector<QMap<QString, QString>> remaining;
+    for (const auto& entry : *entries) {
         if (entry.value(key) != value) {
-            settings.setArrayIndex(index);
-            QMap<QString, QString>::const_iterator it;
-            for (it = entry.constBegin(); it != entry.constEnd(); it += 1) {
-                settings.setValue(it.key(), it.value());
-            }
-            index += 1;
+            remaining.append(entry);
         }
     }
-    settings.endArray();
+    if (remaining.size() == entries->size()) {
+        return;
+    }
+    *entries = remaining;
+    m_dirtyGroups.insert(group);
+    scheduleWrite();
 }
 
 QVector<QMap<QString, QString>> Settings::find(
@@ -101,7 +126,7 @@ QVector<QMap<QString, QString>> Settings::find(
 
     // Find entries that match the criteria
     QVector<QMap<QString, QString>> entries;
-    for (const auto& entry : getGroup(group)) {
+    for (const auto& entry : *getGroup(group)) {
         if (entry.value(key) == value) {
             entries.append(entry);
         }
@@ -139,27 +164,71 @@ Settings::Settings() {
     QCoreApplication::setOrganizationName("mackorone");
     QCoreApplication::setOrganizationDomain("www.github.com/mackorone");
     QCoreApplication::setApplicationName("mms");
+
+    // Changes are written once they've stopped arriving for a moment, or
+    // when the application quits, whichever comes first
+    m_writeTimer.setSingleShot(true);
+    m_writeTimer.setInterval(WRITE_DELAY_MS);
+    QObject::connect(
+        &m_writeTimer,
+        &QTimer::timeout,
+        [this]() {
+            flush();
+        }
+    );
+    QObject::connect(
+        QCoreApplication::instance(),
+        &QCoreApplication::aboutToQuit,
+        [this]() {
+            flush();
+        }
+    );
+}
+
+void Settings::scheduleWrite() {
+    if (!m_writeTimer.isActive()) {
+        m_writeTimer.start();
+    }
 }
 
-QVector<QMap<QString, QString>> Settings::getGroup(QString group) {
+QMap<QString, QString>* Settings::getValues(QString group) {
+
+    // Read the group the first time it's used
+    if (!m_values.contains(group)) {
+        QMap<QString, QString> values;
+        QSettings settings;
+        settings.beginGroup(group);
+        for (const QString& key : settings.childKeys()) {
+            values[key] = settings.value(key).toString();
+        }
+        settings.endGroup();
+        m_values[group] = values;
+    }
+    return &m_values[group];
+}
+
+QVector<QMap<QString, QString>>* Settings::getGroup(QString group) {
 
     // Group must be nonempty
     ASSERT_FA(group.isEmpty());
 
-    // Get all entries for a given group
-    QVector<QMap<QString, QString>> entries;
-    QSettings settings;
-    int size = settings.beginReadArray(group);
-    for (int i = 0; i < size; i += 1) {
-        settings.setArrayIndex(i);
-        QMap<QString, QString> map;
-        for (QString key : settings.allKeys()) {
-            map[key] = settings.value(key).toString();
+    // Read all entries for the group the first time it's used
+    if (!m_groups.contains(group)) {
+        QVector<QMap<QString, QString>> entries;
+        QSettings settings;
+        int size = settings.beginReadArray(group);
+        for (int i = 0; i < size; i += 1) {
+            settings.setArrayIndex(i);
+            QMap<QString, QString> map;
+            for (QString key : settings.allKeys()) {
+                map[key] = settings.value(key).toString();
+            }
+            entries.append(map);
         }
-        entries.append(map);
+        settings.endArray();
+        m_groups[group] = entries;
     }
-    settings.endArray();
-    return entries;
+    return &m_groups[group];
 }
 
 } 
@@ -1,19 +1,30 @@
 #pragma once
 
 #include <QMap>
+#include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
 #include <QVector>
 
 namespace mms {
 
 class Settings {
 
+    // Each group is read from disk (or the registry) the first time it's
+    // used, and is kept in memory after that. Changes are made to the copy in
+    // memory, and written back together WRITE_DELAY_MS later, so that a burst
+    // of changes is a single write; any pending changes are also written when
+    // the application quits.
+
 public:
 
     static void init();
     static Settings* get();
 
+    // Writes any pending changes right away
+    void flush();
+
     // --- Non-array Functions --- //
 
     QString value(QString group, QString key);
@@ -48,8 +59,20 @@ private:
     Settings();
     static Settings* INSTANCE;
 
-    // Returns all entries for a given group
-    QVector<QMap<QString, QString>> getGroup(QString group);
+    // The groups read so far, with values and with arrays of entries
+    QMap<QString, QMap<QString, QString>> m_values;
+    QMap<QString, QVector<QMap<QString, QString>>> m_groups;
+
+    // The groups with changes that haven't been written yet
+    static const int WRITE_DELAY_MS;
+    QSet<QString> m_dirtyValues;
+    QSet<QString> m_dirtyGroups;
+    QTimer m_writeTimer;
+    void scheduleWrite();
+
+    // Returns all values, or all entries, of the given group
+    QMap<QString, QString>* getValues(QString group);
+    QVector<QMap<QString, QString>>* getGroup(QString group);
 
 };
 
@@ -6,6 +6,8 @@ namespace mms {
 
 const QString SettingsMazeFiles::GROUP = "maze-files";
 const QString SettingsMazeFiles::KEY_PATH = "path";
+const QString SettingsMazeFiles::LIBRARY_GROUP = "maze-libraries";
+const QString SettingsMazeFiles::KEY_DIRECTORY = "directory";
 
 QStringList SettingsMazeFiles::getAllPaths() {
     return Settings::get()->values(GROUP, KEY_PATH);
@@ -21,4 +23,19 @@ void SettingsMazeFiles::removePath(QString path) {
     Settings::get()->remove(GROUP, KEY_PATH, path);
 }
 
+QStringList SettingsMazeFiles::getLibraryDirectories() {
+    return Settings::get()->values(LIBRARY_GROUP, KEY_DIRECTORY);
+}
+
+void SettingsMazeFiles::addLibraryDirectory(QString directory) {
+    Settings* settings = Settings::get();
+    if (settings->find(LIBRARY_GROUP, KEY_DIRECTORY, directory).isEmpty()) {
+        settings::get()->add(LIBRARY_GROUP, {{KEY_DIRECTORY, directory}});
+    }
+}
+
+void SettingsMazeFiles::removeLibraryDirectory(QString directory) {
+    Settings::get()->remove(LIBRARY_GROUP, KEY_DIRECTORY, directory);
+}
+
 }
@@ -13,9 +13,16 @@ public:
     static void addPath(QString path);
     static void removePath(QString path);
 
+    // Directories whose mazes are all listed, and kept up to date
+    static QStringList getLibraryDirectories();
+    static void addLibraryDirectory(QString directory);
+    static void removeLibraryDirectory(QString directory);
+
 private:
     static const QString GROUP;
     static const QString KEY_PATH;
+    static const QString LIBRARY_GROUP;
+    static const QString KEY_DIRECTORY;
 
 };
 
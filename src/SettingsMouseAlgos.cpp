@@ -1,7 +1,12 @@
 #include "SettingsMouseAlgos.h"
 
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonValue>
+
 #include "AssertMacros.h"
 #include "ConfigDialog.h"
+#include "ProcessUtilities.h"
 #include "Settings.h"
 
 namespace mms {
@@ -11,6 +16,11 @@ const QString SettingsMouseAlgos::KEY_NAME = "name";
 const QString SettingsMouseAlgos::KEY_DIR_PATH = "directory";
 const QString SettingsMouseAlgos::KEY_BUILD_COMMAND = "buildCommand";
 const QString SettingsMouseAlgos::KEY_RUN_COMMAND = "runCommand";
+const QString SettingsMouseAlgos::KEY_BUILD_FINGERPRINT = "buildFingerprint";
+const QString SettingsMouseAlgos::KEY_BUILD_ARGUMENTS = "buildArguments";
+const QString SettingsMouseAlgos::KEY_RUN_ARGUMENTS = "runArguments";
+const QString SettingsMouseAlgos::KEY_IS_PLUGIN = "isPlugin";
+const QString SettingsMouseAlgos::KEY_LISTEN_PORT = "listenPort";
 
 QStringList SettingsMouseAlgos::names() {
     return Settings::get()->values(GROUP, KEY_NAME);
@@ -28,17 +38,55 @@ QString SettingsMouseAlgos::getRunCommand(const QString& name) {
     return getValue(name, KEY_RUN_COMMAND);
 }
 
+QStringList SettingsMouseAlgos::getBuildArguments(const QString& name) {
+    return getArguments(name, KEY_BUILD_ARGUMENTS, KEY_BUILD_COMMAND);
+}
+
+QStringList SettingsMouseAlgos::getRunArguments(const QString& name) {
+    return getArguments(name, KEY_RUN_ARGUMENTS, KEY_RUN_COMMAND);
+}
+
+bool SettingsMouseAlgos::isPlugin(const QString& name) {
+    // Algorithms that were saved before plugins existed are programs
+    return getValue(name, KEY_IS_PLUGIN) == "true";
+}
+
+int SettingsMouseAlgos::getListenPort(const QString& name) {
+    bool ok = false;
+    int port = getValue(name, KEY_LISTEN_PORT).toInt(&ok);
+    return ok && 0 < port && port <= 65535 ? port : 0;
+}
+
+QString SettingsMouseAlgos::getBuildFingerprint(const QString& name) {
+    return getValue(name, KEY_BUILD_FINGERPRINT);
+}
+
+void SettingsMouseAlgos::setBuildFingerprint(
+    const QString& name,
+    const QString& fingerprint
+) {
+    Settings::get()->update(GROUP, KEY_NAME, name, {
+        {KEY_BUILD_FINGERPRINT, fingerprint},
+    });
+}
+
 void SettingsMouseAlgos::add(
     const QString& name,
     const QString& directory,
     const QString& buildCommand,
-    const QString& runCommand
+    const QString& runCommand,
+    bool isPlugin,
+    int listenPort
 ) {
     Settings::get()->add(GROUP, {
         {KEY_NAME, name},
         {KEY_DIR_PATH, directory},
         {KEY_BUILD_COMMAND, buildCommand},
         {KEY_RUN_COMMAND, runCommand},
+        {KEY_BUILD_ARGUMENTS, encodeArguments(buildCommand)},
+        {KEY_RUN_ARGUMENTS, encodeArguments(runCommand)},
+        {KEY_IS_PLUGIN, isPlugin ? "true" : "false"},
+        {KEY_LISTEN_PORT, QString::number(listenPort)},
     });
 }
 
@@ -47,13 +95,19 @@ void SettingsMouseAlgos::update(
     const QString& newName,
     const QString& newDirectory,
     const QString& newBuildCommand,
-    const QString& newRunCommand
+    const QString& newRunCommand,
+    bool newIsPlugin,
+    int newListenPort
 ) {
     Settings::get()->update(GROUP, KEY_NAME, name, {
         {KEY_NAME, newName},
         {KEY_DIR_PATH, newDirectory},
         {KEY_BUILD_COMMAND, newBuildCommand},
         {KEY_RUN_COMMAND, newRunCommand},
+        {KEY_BUILD_ARGUMENTS, encodeArguments(newBuildCommand)},
+        {KEY_RUN_ARGUMENTS, encodeArguments(newRunCommand)},
+        {KEY_IS_PLUGIN, newIsPlugin ? "true" : "false"},
+        {KEY_LISTEN_PORT, QString::number(newListenPort)},
     });
 }
 
@@ -70,4 +124,30 @@ QString SettingsMouseAlgos::getValue(const QString& name, const QString& key) {
     return (vector.size() == 0 ? "" : vector.at(0).value(key));
 }
 
+QStringList SettingsMouseAlgos::getArguments(
+    const QString& name,
+    const QString& argumentsKey,
+    const QString& commandKey
+) {
+    QJsonDocument document =
+        QJsonDocument::fromJson(getValue(name, argumentsKey).toUtf8());
+    if (!document.isArray()) {
+        return ProcessUtilities::splitCommand(getValue(name, commandKey));
+    }
+    QStringList arguments;
+    for (const QJsonValue& value : document.array()) {
+        arguments.append(value.toString());
+    }
+    return arguments;
+}
+
+QString SettingsMouseAlgos::encodeArguments(const QString& command) {
+    QJsonArray array = QJsonArray::fromStringList(
+        ProcessUtilities::splitCommand(command)
+    );
+    return QString::fromUtf8(
+        QJsonDocument(array).toJson(QJsonDocument::Compact)
+    );
+}
+
 } //namespace mms
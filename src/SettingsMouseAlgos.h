@@ -16,17 +16,40 @@ public:
     static QString getBuildCommand(const QString& name);
     static QString getRunCommand(const QString& name);
 
+    // The commands, as they're run; they're split once, when they're saved,
+    // and split on the fly for algorithms that were saved before that
+    static QStringList getBuildArguments(const QString& name);
+    static QStringList getRunArguments(const QString& name);
+
+    // Whether the algorithm is a shared library (see AlgoPlugin.h) rather
+    // than a program, in which case its run command is the library's path
+    static bool isPlugin(const QString& name);
+
+    // The port that the simulator listens on for the algorithm to connect
+    // to, rather than running it, or zero if it's run as a program
+    static int getListenPort(const QString& name);
+
+    // The fingerprint of the last successful build, if any
+    static QString getBuildFingerprint(const QString& name);
+    static void setBuildFingerprint(
+        const QString& name,
+        const QString& fingerprint);
+
     static void add(
         const QString& name,
         const QString& directory,
         const QString& buildCommand,
-        const QString& runCommand);
+        const QString& runCommand,
+        bool isPlugin,
+        int listenPort);
     static void update(
         const QString& name,
         const QString& newName,
         const QString& newDirectory,
         const QString& newBuildCommand,
-        const QString& newRunCommand);
+        const QString& newRunCommand,
+        bool newIsPlugin,
+        int newListenPort);
     static void remove(const QString& name);
 
 private:
@@ -36,8 +59,20 @@ private:
     static const QString KEY_DIR_PATH;
     static const QString KEY_BUILD_COMMAND;
     static const QString KEY_RUN_COMMAND;
+    static const QString KEY_BUILD_FINGERPRINT;
+    static const QString KEY_BUILD_ARGUMENTS;
+    static const QString KEY_RUN_ARGUMENTS;
+    static const QString KEY_IS_PLUGIN;
+    static const QString KEY_LISTEN_PORT;
     
     static QString getValue(const QString& name, const QString& key);
+
+    // Arguments are stored as JSON arrays of strings
+    static QStringList getArguments(
+        const QString& name,
+        const QString& argumentsKey,
+        const QString& commandKey);
+    static QString encodeArguments(const QString& command);
     
 };
 
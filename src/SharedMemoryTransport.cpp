@@ -0,0 +1,168 @@
+#include "SharedMemoryTransport.h"
+
+#include <atomic>
+#include <cstring>
+
+#include <QDir>
+
+#include "AssertMacros.h"
+#include "LineFramer.h"
+
+namespace mms {
+
+namespace {
+
+// Free-running indices; the number of unread bytes is (write - read), and
+// byte i of the stream lives at data[i % capacity]
+struct RingHeader {
+    std::atomic<quint32> write;
+    std::atomic<quint32> read;
+};
+
+struct Header {
+    quint32 magic;
+    quint32 capacity;
+    RingHeader requests;
+    RingHeader responses;
+};
+
+static_assert(sizeof(std::atomic<quint32>) == 4, "Unexpected atomic size");
+static_assert(sizeof(Header) == 24, "Unexpected header layout");
+
+}
+
+const QString SharedMemoryTransport::ENVIRONMENT_VARIABLE = "MMS_SHM_PATH";
+const quint32 SharedMemoryTransport::MAGIC = 0x31534d4d; // "MMS1"
+const quint32 SharedMemoryTransport::CAPACITY = 1 << 16;
+const int SharedMemoryTransport::HEADER_SIZE = 64;
+const int SharedMemoryTransport::IDLE_POLLS_BEFORE_BACKOFF = 1000;
+
+SharedMemoryTransport::SharedMemoryTransport(QObject* parent) :
+    QObject(parent),
+    m_file(QDir::temp().filePath("mms-shm-XXXXXX")),
+    m_memory(nullptr),
+    m_pollTimer(new QTimer(this)),
+    m_pending(QByteArray()),
+    m_idlePolls(0),
+    m_isInUse(false) {
+    m_pending.reserve(LineFramer::RESERVED_BYTES);
+    connect(m_pollTimer, &QTimer::timeout, this, &SharedMemoryTransport::poll);
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    if (m_memory != nullptr) {
+        m_file.unmap(m_memory);
+    }
+}
+
+bool SharedMemoryTransport::open() {
+    ASSERT_TR(m_memory == nullptr);
+    if (!m_file.open()) {
+        return false;
+    }
+    // Resizing zero-fills, so both rings start out empty
+    if (!m_file.resize(HEADER_SIZE + 2 * CAPACITY)) {
+        return false;
+    }
+    m_memory = m_file.map(0, m_file.size());
+    if (m_memory == nullptr) {
+        return false;
+    }
+    Header* header = reinterpret_cast<Header*>(m_memory);
+    header->capacity = CAPACITY;
+    header->requests.write.store(0);
+    header->requests.read.store(0);
+    header->responses.write.store(0);
+    header->responses.read.store(0);
+    // Written last, so the algorithm can wait for it
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MAGIC;
+    return true;
+}
+
+void SharedMemoryTransport::addToEnvironment(
+        QProcessEnvironment* environment) const {
+    ASSERT_FA(m_memory == nullptr);
+    environment->insert(ENVIRONMENT_VARIABLE, m_file.fileName());
+}
+
+void SharedMemoryTransport::start() {
+    ASSERT_FA(m_memory == nullptr);
+    m_idlePolls = 0;
+    m_pollTimer->start(0);
+}
+
+void SharedMemoryTransport::stop() {
+    m_pollTimer->stop();
+}
+
+bool SharedMemoryTransport::isInUse() const {
+    return m_isInUse;
+}
+
+void SharedMemoryTransport::readAll(QByteArray* bytes) {
+    ASSERT_FA(bytes == nullptr);
+    ASSERT_FA(m_memory == nullptr);
+    Header* header = reinterpret_cast<Header*>(m_memory);
+    const uchar* data = m_memory + HEADER_SIZE;
+    quint32 read = header->requests.read.load(std::memory_order_relaxed);
+    quint32 write = header->requests.write.load(std::memory_order_acquire);
+    quint32 size = write - read;
+    ASSERT_LE(size, CAPACITY);
+    bytes->resize(static_cast<int>(size));
+    quint32 offset = read % CAPACITY;
+    quint32 first = qMin(size, CAPACITY - offset);
+    std::memcpy(bytes->data(), data + offset, first);
+    std::memcpy(bytes->data() + first, data, size - first);
+    header->requests.read.store(write, std::memory_order_release);
+}
+
+void SharedMemoryTransport::write(const QByteArray& bytes) {
+    m_pending.append(bytes.constData(), bytes.size());
+    flush();
+}
+
+void SharedMemoryTransport::poll() {
+
+    flush();
+
+    Header* header = reinterpret_cast<Header*>(m_memory);
+    quint32 read = header->requests.read.load(std::memory_order_relaxed);
+    quint32 write = header->requests.write.load(std::memory_order_acquire);
+    if (read != write) {
+        if (0 < m_pollTimer->interval()) {
+            m_pollTimer->setInterval(0);
+        }
+        m_idlePolls = 0;
+        m_isInUse = true;
+        emit readyRead();
+        return;
+    }
+
+    // Spin while the algorithm is chatty, but back off once it goes quiet so
+    // that an idle (or thinking) algorithm doesn't cost a whole core
+    m_idlePolls += 1;
+    if (m_idlePolls == IDLE_POLLS_BEFORE_BACKOFF) {
+        m_pollTimer->setInterval(1);
+    }
+}
+
+void SharedMemoryTransport::flush() {
+    if (m_pending.isEmpty()) {
+        return;
+    }
+    Header* header = reinterpret_cast<Header*>(m_memory);
+    uchar* data = m_memory + HEADER_SIZE + CAPACITY;
+    quint32 write = header->responses.write.load(std::memory_order_relaxed);
+    quint32 read = header->responses.read.load(std::memory_order_acquire);
+    quint32 space = CAPACITY - (write - read);
+    quint32 size = qMin(space, static_cast<quint32>(m_pending.size()));
+    quint32 offset = write % CAPACITY;
+    quint32 first = qMin(size, CAPACITY - offset);
+    std::memcpy(data + offset, m_pending.constData(), first);
+    std::memcpy(data, m_pending.constData() + first, size - first);
+    header->responses.write.store(write + size, std::memory_order_release);
+    m_pending.remove(0, static_cast<int>(size));
+}
+
+} 
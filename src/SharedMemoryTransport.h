@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcessEnvironment>
+#include <QString>
+#include <QTemporaryFile>
+#include <QTimer>
+
+namespace mms {
+
+class SharedMemoryTransport : public QObject {
+
+    // An optional alternative to stdin/stdout for the text protocol. A
+    // temporary file is memory-mapped by both the simulator and the algorithm
+    // and holds two single-producer, single-consumer byte rings: requests
+    // (algorithm to simulator) and responses (simulator to algorithm). The
+    // path is handed to the algorithm via the MMS_SHM_PATH environment
+    // variable. See the README for the exact layout.
+
+    Q_OBJECT
+
+public:
+
+    static const QString ENVIRONMENT_VARIABLE;
+
+    SharedMemoryTransport(QObject* parent = 0);
+    ~SharedMemoryTransport();
+
+    // Creates and maps the file; returns false on failure
+    bool open();
+
+    // Adds the path of the mapped file to an algorithm's environment
+    void addToEnvironment(QProcessEnvironment* environment) const;
+
+    // Starts and stops polling the request ring
+    void start();
+    void stop();
+
+    // Whether any request has arrived through shared memory yet
+    bool isInUse() const;
+
+    // Replaces *bytes with every request byte that's arrived since the last
+    // call, reusing its storage
+    void readAll(QByteArray* bytes);
+
+    // Queues bytes for the algorithm (by copying them, into storage that's
+    // kept); whatever doesn't fit in the response ring right away is flushed
+    // as the algorithm makes room
+    void write(const QByteArray& bytes);
+
+signals:
+
+    void readyRead();
+
+private:
+
+    static const quint32 MAGIC;
+    static const quint32 CAPACITY;
+    static const int HEADER_SIZE;
+    static const int IDLE_POLLS_BEFORE_BACKOFF;
+
+    QTemporaryFile m_file;
+    uchar* m_memory;
+    QTimer* m_pollTimer;
+    QByteArray m_pending;
+    int m_idlePolls;
+    bool m_isInUse;
+
+    void poll();
+    void flush();
+
+};
+
+} 
@@ -10,14 +10,16 @@ double SimUtilities::getHighResTimestamp() {
     return QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000.0;
 }
 
-QVector<TriangleGraphic> SimUtilities::polygonToTriangleGraphics(
+void SimUtilities::appendTriangleGraphics(
         const Polygon& polygon,
         Color color,
-        unsigned char alpha) {
-    QVector<Triangle> triangles = polygon.getTriangles();
-    QVector<TriangleGraphic> triangleGraphics;
-    RGB colorValues = COLOR_TO_RGB().value(color);
-    for (Triangle triangle : triangles) {
+        unsigned char alpha,
+        QVector<TriangleGraphic>* buffer) {
+    ASSERT_FA(buffer == nullptr);
+    const Polygon::Triangles& triangles = polygon.getTriangles();
+    buffer->reserve(buffer->size() + triangles.size());
+    RGB colorValues = COLOR_TO_RGB(color);
+    for (const Triangle& triangle : triangles) {
         TriangleGraphic graphic;
         graphic.p1 = {
             static_cast<float>(triangle.p1.getX().getMeters()),
@@ -37,9 +39,8 @@ QVector<TriangleGraphic> SimUtilities::polygonToTriangleGraphics(
             colorValues,
             alpha,
         };
-        triangleGraphics.append(graphic);
+        buffer->append(graphic);
     }
-    return triangleGraphics;
 }
 
 } 
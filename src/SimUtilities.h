@@ -20,11 +20,13 @@ public:
     // Like time() in <ctime> but higher resolution (returns seconds since epoch)
     static double getHighResTimestamp();
 
-    // Converts a polygon to a vector of triangle graphics
-    static QVector<TriangleGraphic> polygonToTriangleGraphics(
+    // Converts a polygon to triangle graphics, appended to the buffer, so
+    // that a buffer can be reused for every polygon of a mesh
+    static void appendTriangleGraphics(
         const Polygon& polygon,
         Color color,
-        unsigned char alpha);
+        unsigned char alpha,
+        QVector<TriangleGraphic>* buffer);
 
 };
 
@@ -0,0 +1,31 @@
+#include "SimulationClock.h"
+
+#include <QtMath>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int SimulationClock::TICKS_PER_SECOND = 1000;
+
+SimulationClock::SimulationClock() : m_ticks(0) {
+}
+
+void SimulationClock::advance(qint64 ticks) {
+    ASSERT_LE(0, ticks);
+    m_ticks += ticks;
+}
+
+void SimulationClock::advanceSeconds(double seconds) {
+    advance(qRound64(seconds * TICKS_PER_SECOND));
+}
+
+qint64 SimulationClock::getTicks() const {
+    return m_ticks;
+}
+
+double SimulationClock::getSeconds() const {
+    return static_cast<double>(m_ticks) / TICKS_PER_SECOND;
+}
+
+} 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace mms {
+
+class SimulationClock {
+
+    // Simulated time, counted in whole ticks, so that it's the same on every
+    // machine, however loaded; a tick is one timestep of the mouse dynamics.
+    // The clock only ever advances when the simulation does, and never looks
+    // at the wall clock, which at most paces how often it's advanced.
+
+public:
+
+    SimulationClock();
+
+    static const int TICKS_PER_SECOND;
+
+    void advance(qint64 ticks);
+
+    // Rounds to the nearest tick, e.g., for a whole number of timesteps
+    // that were summed in floating point
+    void advanceSeconds(double seconds);
+
+    qint64 getTicks() const;
+    double getSeconds() const;
+
+private:
+
+    qint64 m_ticks;
+};
+
+} 
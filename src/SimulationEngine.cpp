@@ -0,0 +1,2526 @@
+#include "SimulationEngine.h"
+
+#include <QMap>
+#include <QMetaObject>
+#include <QStringList>
+#include <QtMath>
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "Dimensions.h"
+#include "CommandParser.h"
+#include "FontImage.h"
+#include "LineFramer.h"
+#include "Profiler.h"
+#include "SimUtilities.h"
+
+namespace mms {
+
+const QString SimulationEngine::ACK = "ack";
+const QString SimulationEngine::CRASH = "crash";
+const QString SimulationEngine::DONE = "done";
+const QString SimulationEngine::HELLO = "mms";
+const QString SimulationEngine::INVALID = "invalid";
+const QString SimulationEngine::NO_MAZE = "none";
+const QString SimulationEngine::QUEUED = "queued";
+const QString SimulationEngine::TRUE_RESPONSE = "true";
+const QString SimulationEngine::FALSE_RESPONSE = "false";
+const QString SimulationEngine::WALLS_RESPONSES[16] = {
+    "0", "1", "2", "3", "4", "5", "6", "7",
+    "8", "9", "10", "11", "12", "13", "14", "15",
+};
+const QChar SimulationEngine::NO_COLOR = '.';
+const int SimulationEngine::MAX_HEAT = 255;
+const int SimulationEngine::PROTOCOL_VERSION = 1;
+const int SimulationEngine::RESULT_VERSION = 1;
+
+const double SimulationEngine::MIN_PROGRESS_PER_SECOND = 10.0;
+const double SimulationEngine::MAX_PROGRESS_PER_SECOND = 5000.0;
+const double SimulationEngine::PROGRESS_REQUIRED_FOR_MOVE = 100.0;
+const double SimulationEngine::PROGRESS_REQUIRED_FOR_TURN = 33.33;
+const double SimulationEngine::PROGRESS_PER_TICK = 1.0;
+const int SimulationEngine::CONTINUOUS_POLL_MS = 16;
+const double SimulationEngine::PROCESSING_SLICE_SECONDS = 0.002;
+const int SimulationEngine::INITIAL_QUEUE_CAPACITY = 64;
+const double SimulationEngine::MIN_DISPLAY_SECONDS = 0.008;
+
+const int SimulationEngine::WALL_MASK_FRONT = 1;
+const int SimulationEngine::WALL_MASK_RIGHT = 2;
+const int SimulationEngine::WALL_MASK_BACK = 4;
+const int SimulationEngine::WALL_MASK_LEFT = 8;
+
+SimulationEngine::SimulationEngine(
+        const Maze* maze,
+        MazeView* view,
+        QObject* parent) :
+    QObject(parent),
+    m_maze(maze),
+    m_view(view),
+    m_mouse(new Mouse()),
+    m_trace(nullptr),
+    m_latency(nullptr),
+    m_commandAllocations(QVector<AllocationCounts>(NUM_OPCODES, {0, 0, 0})),
+    m_isPaused(false),
+    m_wasReset(false),
+    m_isStopped(false),
+    m_commandQueue(INITIAL_QUEUE_CAPACITY),
+    m_commandQueueTimer(new QTimer(this)),
+    m_queueLimit(-1),
+    m_maxQueuedCommands(0),
+    m_responseBytes(QByteArray()),
+    m_numResponses(0),
+    m_isBatchingResponses(false),
+    m_displayTimer(new QTimer(this)),
+    m_displayTimestamp(0.0),
+    m_headStartedTimestamp(0.0),
+    m_isAsyncMoves(false),
+    m_numAsyncMoves(0),
+    m_isPushingSensors(false),
+    m_startingLocation({0, 0}),
+    m_startingDirection(Direction::NORTH),
+    m_movement(Movement::NONE),
+    m_movementCells(1),
+    m_movementPath(QVector<Direction>()),
+    m_movementProgress(0.0),
+    m_movementStepSize(0.0),
+    m_movementStepTimestamp(0.0),
+    m_progressPerSecond(MAX_PROGRESS_PER_SECOND),
+    m_isInstant(false),
+    m_isTrailEnabled(false),
+    m_trail(QVector<QPair<int, int>>()),
+    m_fastForwardCells(QVector<QPair<int, int>>()),
+    m_fastForwardIndex(-1),
+    m_clock(SimulationClock()),
+    m_tickLimit(-1),
+    m_movementTicks(0),
+    m_numMoves(0),
+    m_numTurns(0),
+    m_numCrashes(0),
+    m_reachedCenter(false),
+    m_firstCenterTicks(-1),
+    m_firstCenterMoves(-1),
+    m_numCommands(0),
+    m_commandLimit(-1),
+    m_moveLimit(-1),
+    m_isStepLimitReached(false),
+    m_visitCounts(QVector<int>()),
+    m_coverage({0, 0, 0, -1}),
+    m_knownWalls(KnownWalls()),
+    m_isFogEnabled(false),
+    m_isDistanceOverlayEnabled(false),
+    m_isDistanceOverlayStale(false),
+    m_overlayDistances(DynamicDistances()),
+    m_overlayChanged(QVector<int>()),
+    m_cellProfile(QVector<CellProfile>()),
+    m_profileCell(0),
+    m_profileTimestamp(SimUtilities::getHighResTimestamp()),
+    m_profileOverlay(ProfileMetric::NONE),
+    m_runTimeParameters(RunTimeModel::DEFAULT_PARAMETERS()),
+    m_runTimeModel(m_runTimeParameters),
+    m_trialSeconds(QVector<double>()),
+    m_trialCenterSeconds(-1.0),
+    m_trialsCenterSeconds(QVector<double>()),
+    m_contestScorer(ContestScorer()),
+    m_isContestOver(false),
+    m_sensorNoise(SensorNoise()),
+    m_isContinuous(false),
+    m_isMovementContinuous(false),
+    m_dynamics(MouseDynamics()),
+    m_motionThread(nullptr),
+    m_motionWorker(nullptr),
+    m_motionNumber(0),
+    m_simulatedSeconds(0.0),
+    m_isSharedMemoryAvailable(false),
+    m_hasClaimedMaze(false),
+    m_tilesWithColor(TileSet()),
+    m_tilesWithText(TileSet()),
+    m_tilesWithHeat(TileSet()) {
+
+    ASSERT_FA(m_maze == nullptr);
+
+    // The mouse starts out in the starting cell
+    m_coverage.numCells = m_maze->getWidth() * m_maze->getHeight();
+    m_visitCounts.fill(0, m_coverage.numCells);
+    m_visitCounts[getCellIndex(0, 0)] = 1;
+    m_coverage.numVisited = 1;
+    m_knownWalls = KnownWalls(&m_maze->getWalls());
+    m_cellProfile.fill({0.0, 0, 0, 0}, m_coverage.numCells);
+    m_profileCell = getCellIndex(0, 0);
+    m_tilesWithColor = TileSet(m_maze->getWidth(), m_maze->getHeight());
+    m_tilesWithText = TileSet(m_maze->getWidth(), m_maze->getHeight());
+    m_tilesWithHeat = TileSet(m_maze->getWidth(), m_maze->getHeight());
+
+    // Configure command queue timer
+    m_commandQueueTimer->setSingleShot(true);
+    m_commandQueueTimer->setTimerType(Qt::PreciseTimer);
+    connect(
+        m_commandQueueTimer,
+        &QTimer::timeout,
+        this,
+        &SimulationEngine::processQueuedCommands
+    );
+
+    // Configure display timer
+    m_displayTimer->setSingleShot(true);
+    connect(
+        m_displayTimer,
+        &QTimer::timeout,
+        this,
+        &SimulationEngine::publishDisplay
+    );
+}
+
+SimulationEngine::~SimulationEngine() {
+    if (m_motionThread != nullptr) {
+        QMetaObject::invokeMethod(
+            m_motionWorker,
+            "stop",
+            Qt::BlockingQueuedConnection
+        );
+        m_motionThread->quit();
+        m_motionThread->wait();
+        delete m_motionWorker;
+        delete m_motionThread;
+    }
+    delete m_mouse;
+}
+
+const Mouse* SimulationEngine::getMouse() const {
+    return m_mouse;
+}
+
+void SimulationEngine::dispatchCommand(const QString& command) {
+    PROFILE_ZONE("SimulationEngine::dispatchCommand");
+
+    // Once stopped, the engine ignores all input
+    if (m_isStopped) {
+        return;
+    }
+
+    // Each line is parsed exactly once; anything that isn't a well-formed
+    // command would only ever get an invalid response, so drop it here
+    Command parsed;
+    const CommandSpec* spec = CommandParser::parse(command, &parsed);
+    if (spec == nullptr) {
+        return;
+    }
+    dispatchCommand(parsed, spec);
+}
+
+void SimulationEngine::dispatchCommand(
+        const Command& parsed,
+        const CommandSpec* spec,
+        double receivedTimestamp) {
+    PROFILE_ZONE("SimulationEngine::dispatchCommand");
+
+    ASSERT_FA(spec == nullptr);
+
+    // Once stopped, the engine ignores all input
+    if (m_isStopped) {
+        return;
+    }
+
+    if (!countCommand()) {
+        return;
+    }
+
+    if (m_trace != nullptr) {
+        m_trace->recordCommand(parsed);
+    }
+
+    double dispatchedTimestamp = 0.0;
+    if (m_latency != nullptr) {
+        dispatchedTimestamp = SimUtilities::getHighResTimestamp();
+        if (receivedTimestamp < 0.0) {
+            receivedTimestamp = dispatchedTimestamp;
+        }
+    }
+
+    // For performance reasons, handle no-response commands inline (don't queue
+    // them with the commands that elicit a response, just perform the action)
+    if (!spec->hasResponse) {
+        executeInlineCommand(parsed);
+        if (m_latency != nullptr) {
+            m_latency->record(
+                parsed.opcode,
+                receivedTimestamp,
+                dispatchedTimestamp,
+                dispatchedTimestamp,
+                dispatchedTimestamp
+            );
+        }
+        return;
+    }
+
+    // Asynchronous movements are answered right away, and again once they're
+    // done; responding may cause the engine to be stopped
+    int sequenceNumber = 0;
+    if (m_isAsyncMoves && isMovement(parsed.opcode)) {
+        m_numAsyncMoves += 1;
+        sequenceNumber = m_numAsyncMoves;
+        QString response = QUEUED + " " + QString::number(sequenceNumber);
+        if (m_trace != nullptr) {
+            m_trace->recordResponse(parsed.opcode, response);
+        }
+        respond(response);
+        if (m_isStopped) {
+            flushUnbatchedResponses();
+            return;
+        }
+    }
+
+    // Enqueue the serial command, process it if
+    // future processing is not already scheduled
+    m_commandQueue.enqueue(
+        {parsed, receivedTimestamp, dispatchedTimestamp, sequenceNumber}
+    );
+    m_maxQueuedCommands = qMax(m_maxQueuedCommands, m_commandQueue.size());
+    if (!m_commandQueueTimer->isActive()) {
+        processQueuedCommands();
+    }
+    flushUnbatchedResponses();
+}
+
+QString SimulationEngine::executeNow(
+        const Command& parsed,
+        const CommandSpec* spec) {
+
+    ASSERT_FA(spec == nullptr);
+    ASSERT_TR(m_isInstant);
+    ASSERT_FA(m_isContinuous);
+    ASSERT_TR(m_commandQueue.isEmpty());
+    if (m_isStopped || !countCommand()) {
+        return "";
+    }
+    if (m_trace != nullptr) {
+        m_trace->recordCommand(parsed);
+    }
+    if (!spec->hasResponse) {
+        executeInlineCommand(parsed);
+        return "";
+    }
+
+    // Just like a queued instant command, with every segment of the
+    // movement done before returning
+    QString response = executeCommand(parsed);
+    beginMovement();
+    if (isMoving()) {
+        response = ACK;
+    }
+    while (isMoving()) {
+        updateMouseProgress(progressRequired(m_movement) - m_movementProgress);
+        if (m_isStopped) {
+            return "";
+        }
+        if (!isMoving()) {
+            startNextPathSegment();
+        }
+    }
+    response = toSensorResponse(response, parsed.opcode);
+    if (m_trace != nullptr) {
+        m_trace->recordResponse(parsed.opcode, response);
+    }
+    if (response.startsWith(CRASH)) {
+        m_numCrashes += 1;
+    }
+    return response == INVALID ? "" : response;
+}
+
+void SimulationEngine::setPaused(bool paused) {
+    m_isPaused = paused;
+    if (m_isPaused) {
+        freezeMouseProgress();
+    }
+    if (m_motionWorker != nullptr) {
+        QMetaObject::invokeMethod(
+            m_motionWorker,
+            "setPaused",
+            Qt::QueuedConnection,
+            Q_ARG(bool, paused)
+        );
+    }
+    if (!m_isPaused) {
+        processQueuedCommands();
+    }
+}
+
+bool SimulationEngine::isPaused() const {
+    return m_isPaused;
+}
+
+void SimulationEngine::requestReset() {
+    m_wasReset = true;
+}
+
+void SimulationEngine::setProgressPerSecond(double progressPerSecond) {
+    ASSERT_LT(0.0, progressPerSecond);
+    bool isFrozen = freezeMouseProgress();
+    m_progressPerSecond = progressPerSecond;
+    if (isFrozen) {
+        scheduleMouseProgressUpdate();
+    }
+}
+
+void SimulationEngine::setInstant(bool instant) {
+    m_isInstant = instant;
+    // A movement that's already being animated finishes at its own pace,
+    // rather than jumping ahead
+}
+
+bool SimulationEngine::isInstant() const {
+    return m_isInstant;
+}
+
+void SimulationEngine::setTrailEnabled(bool enabled) {
+    m_isTrailEnabled = enabled;
+}
+
+QVector<QPair<int, int>> SimulationEngine::getTrail() const {
+    return m_trail;
+}
+
+void SimulationEngine::setFastForward(const QVector<QPair<int, int>>& cells) {
+    m_fastForwardCells = cells;
+    m_fastForwardIndex = cells.isEmpty() ? -1 : 0;
+}
+
+bool SimulationEngine::isFastForwarding() const {
+    return 0 <= m_fastForwardIndex;
+}
+
+bool SimulationEngine::isMovingInstantly() const {
+    return m_isInstant || isFastForwarding();
+}
+
+void SimulationEngine::followFastForward(QPair<int, int> position) {
+    bool hasDiverged = m_fastForwardCells.at(m_fastForwardIndex) != position;
+    if (!hasDiverged) {
+        m_fastForwardIndex += 1;
+        if (m_fastForwardIndex < m_fastForwardCells.size()) {
+            return;
+        }
+    }
+    int numCells = m_fastForwardIndex;
+    m_fastForwardIndex = -1;
+    m_fastForwardCells.clear();
+    emit fastForwardEnded(numCells, hasDiverged);
+}
+
+void SimulationEngine::setContinuous(bool continuous) {
+    m_isContinuous = continuous;
+}
+
+bool SimulationEngine::isContinuous() const {
+    return m_isContinuous;
+}
+
+double SimulationEngine::getSimulatedSeconds() const {
+    return m_simulatedSeconds;
+}
+
+const SimulationClock& SimulationEngine::getClock() const {
+    return m_clock;
+}
+
+void SimulationEngine::setTickLimit(qint64 ticks) {
+    m_tickLimit = ticks;
+}
+
+void SimulationEngine::setCommandLimit(qint64 commands) {
+    m_commandLimit = commands;
+}
+
+void SimulationEngine::setMoveLimit(int moves) {
+    m_moveLimit = moves;
+}
+
+bool SimulationEngine::countCommand() {
+    m_numCommands += 1;
+    m_cellProfile[m_profileCell].commands += 1;
+    if (0 <= m_commandLimit && m_commandLimit < m_numCommands) {
+        reachStepLimit();
+        return false;
+    }
+    return true;
+}
+
+void SimulationEngine::reachStepLimit() {
+    if (!m_isStepLimitReached) {
+        m_isStepLimitReached = true;
+        emit stepLimitReached();
+    }
+}
+
+void SimulationEngine::setTrace(CommandTrace* trace) {
+    m_trace = trace;
+}
+
+void SimulationEngine::setLatency(CommandLatency* latency) {
+    m_latency = latency;
+}
+
+const QVector<AllocationCounts>& SimulationEngine::getCommandAllocations()
+        const {
+    return m_commandAllocations;
+}
+
+QString SimulationEngine::commandAllocationsToString(
+        const QVector<AllocationCounts>& allocations) {
+    QStringList parts;
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        const AllocationCounts& counts =
+            allocations.at(static_cast<int>(spec.opcode));
+        if (counts.samples == 0) {
+            continue;
+        }
+        parts.append(QString("%1 %2 (%3 B)").arg(
+            spec.name,
+            QString::number(
+                static_cast<double>(counts.allocations) / counts.samples,
+                'f',
+                1
+            ),
+            QString::number(
+                static_cast<double>(counts.bytes) / counts.samples,
+                'f',
+                0
+            )
+        ));
+    }
+    return parts.isEmpty() ? "none" : parts.join(", ");
+}
+
+EngineCheckpoint SimulationEngine::getCheckpoint() const {
+    ASSERT_TR(m_movement == Movement::NONE);
+    ASSERT_TR(m_commandQueue.isEmpty());
+    EngineCheckpoint checkpoint;
+    checkpoint.location = m_startingLocation;
+    checkpoint.direction = m_startingDirection;
+    checkpoint.numMoves = m_numMoves;
+    checkpoint.numTurns = m_numTurns;
+    checkpoint.numCrashes = m_numCrashes;
+    checkpoint.reachedCenter = m_reachedCenter;
+    checkpoint.firstCenterTicks = m_firstCenterTicks;
+    checkpoint.firstCenterMoves = m_firstCenterMoves;
+    checkpoint.runTimeModel = m_runTimeModel;
+    checkpoint.trialSeconds = m_trialSeconds;
+    checkpoint.trialCenterSeconds = m_trialCenterSeconds;
+    checkpoint.trialsCenterSeconds = m_trialsCenterSeconds;
+    checkpoint.contestScorer = m_contestScorer;
+    checkpoint.isContestOver = m_isContestOver;
+    checkpoint.sensorNoise = m_sensorNoise;
+    checkpoint.isAsyncMoves = m_isAsyncMoves;
+    checkpoint.numAsyncMoves = m_numAsyncMoves;
+    checkpoint.isPushingSensors = m_isPushingSensors;
+    checkpoint.clock = m_clock;
+    checkpoint.visitCounts = m_visitCounts;
+    checkpoint.coverage = m_coverage;
+    checkpoint.knownWalls = m_knownWalls;
+    checkpoint.cellProfile = getCellProfile();
+    checkpoint.tilesWithColor = m_tilesWithColor;
+    checkpoint.tilesWithText = m_tilesWithText;
+    checkpoint.tilesWithHeat = m_tilesWithHeat;
+    if (m_view != nullptr) {
+        checkpoint.tiles = m_view->getMazeGraphic()->getState();
+    }
+    return checkpoint;
+}
+
+void SimulationEngine::restoreCheckpoint(const EngineCheckpoint& checkpoint) {
+    m_commandQueueTimer->stop();
+    clearCommandQueue();
+    stopContinuousMovement();
+    m_wasReset = false;
+    resetMovement();
+    m_startingLocation = checkpoint.location;
+    m_startingDirection = checkpoint.direction;
+    m_mouse->teleport(m_startingLocation, m_startingDirection);
+    moveProfileCell(m_startingLocation);
+    m_numMoves = checkpoint.numMoves;
+    m_numTurns = checkpoint.numTurns;
+    m_numCrashes = checkpoint.numCrashes;
+    m_reachedCenter = checkpoint.reachedCenter;
+    m_firstCenterTicks = checkpoint.firstCenterTicks;
+    m_firstCenterMoves = checkpoint.firstCenterMoves;
+    m_runTimeModel = checkpoint.runTimeModel;
+    m_trialSeconds = checkpoint.trialSeconds;
+    m_trialCenterSeconds = checkpoint.trialCenterSeconds;
+    m_trialsCenterSeconds = checkpoint.trialsCenterSeconds;
+    m_contestScorer = checkpoint.contestScorer;
+    m_isContestOver = checkpoint.isContestOver;
+    m_sensorNoise = checkpoint.sensorNoise;
+    m_isAsyncMoves = checkpoint.isAsyncMoves;
+    m_numAsyncMoves = checkpoint.numAsyncMoves;
+    m_isPushingSensors = checkpoint.isPushingSensors;
+    m_clock = checkpoint.clock;
+    m_visitCounts = checkpoint.visitCounts;
+    m_coverage = checkpoint.coverage;
+    m_knownWalls = checkpoint.knownWalls;
+    m_trail.clear();
+    m_fastForwardIndex = -1;
+    m_fastForwardCells.clear();
+    m_cellProfile = checkpoint.cellProfile;
+    m_tilesWithColor = checkpoint.tilesWithColor;
+    m_tilesWithText = checkpoint.tilesWithText;
+    m_tilesWithHeat = checkpoint.tilesWithHeat;
+    if (m_view != nullptr) {
+        m_view->getMazeGraphic()->setState(checkpoint.tiles);
+    }
+    // The fog may have been toggled since the checkpoint was taken, and the
+    // restored text may not be the overlay's
+    updateFog();
+    invalidateDistanceOverlay();
+    changeDisplay();
+}
+
+void SimulationEngine::setQueueLimit(int limit) {
+    m_queueLimit = limit;
+}
+
+int SimulationEngine::getQueueLimit() const {
+    return m_queueLimit;
+}
+
+bool SimulationEngine::isQueueFull() const {
+    return 0 < m_queueLimit && m_queueLimit <= m_commandQueue.size();
+}
+
+void SimulationEngine::setSharedMemoryAvailable(bool available) {
+    m_isSharedMemoryAvailable = available;
+}
+
+void SimulationEngine::stop() {
+    freezeMouseProgress();
+    m_isStopped = true;
+    m_isPaused = false;
+    m_wasReset = false;
+    m_commandQueueTimer->stop();
+    clearCommandQueue();
+    m_pathSegments.clear();
+    stopContinuousMovement();
+}
+
+int SimulationEngine::getNumMoves() const {
+    return m_numMoves;
+}
+
+int SimulationEngine::getNumTurns() const {
+    return m_numTurns;
+}
+
+int SimulationEngine::getNumCrashes() const {
+    return m_numCrashes;
+}
+
+qint64 SimulationEngine::getNumCommands() const {
+    return m_numCommands;
+}
+
+CoverageStats SimulationEngine::getCoverage() const {
+    return m_coverage;
+}
+
+int SimulationEngine::getVisitCount(int x, int y) const {
+    ASSERT_TR(isWithinMaze(x, y));
+    return m_visitCounts.at(getCellIndex(x, y));
+}
+
+QString SimulationEngine::coverageToString(const CoverageStats& coverage) {
+    QString string = QString("%1 of %2 cells visited, %3 revisits").arg(
+        QString::number(coverage.numVisited),
+        QString::number(coverage.numCells),
+        QString::number(coverage.numRevisits)
+    );
+    if (coverage.numVisitedBeforeCenter < 0) {
+        return string + ", center not reached";
+    }
+    return string + QString(", %1% explored before reaching the center").arg(
+        QString::number(
+            100.0 * coverage.numVisitedBeforeCenter / coverage.numCells,
+            'f',
+            1
+        )
+    );
+}
+
+KnownWallStats SimulationEngine::getKnownWallStats() const {
+    return m_knownWalls.getStats();
+}
+
+QVector<Wall> SimulationEngine::getWrongWalls() const {
+    QVector<Wall> walls;
+    if (m_knownWalls.getStats().numWrong == 0) {
+        return walls;
+    }
+    for (int x = 0; x < m_maze->getWidth(); x += 1) {
+        for (int y = 0; y < m_maze->getHeight(); y += 1) {
+            int wrong = m_knownWalls.getWrongBits(getCellIndex(x, y));
+            for (Direction d : DIRECTIONS) {
+                if (!(wrong & (1 << DIRECTION_INDEX(d)))) {
+                    continue;
+                }
+                if ((d == Direction::SOUTH && 0 < y) ||
+                    (d == Direction::WEST && 0 < x)) {
+                    continue;
+                }
+                walls.append({x, y, d});
+            }
+        }
+    }
+    return walls;
+}
+
+QString SimulationEngine::knownWallsToString(const KnownWallStats& stats) {
+    return QString("%1% of walls known, %2 declared wrong").arg(
+        QString::number(
+            stats.numWalls == 0 ? 0.0 : 100.0 * stats.numKnown / stats.numWalls,
+            'f',
+            1
+        ),
+        QString::number(stats.numWrong)
+    );
+}
+
+QVector<CellProfile> SimulationEngine::getCellProfile() const {
+    QVector<CellProfile> profile = m_cellProfile;
+    profile[m_profileCell].wallSeconds +=
+        SimUtilities::getHighResTimestamp() - m_profileTimestamp;
+    for (int i = 0; i < profile.size(); i += 1) {
+        profile[i].visits = m_visitCounts.at(i);
+    }
+    return profile;
+}
+
+void SimulationEngine::moveProfileCell(QPair<int, int> position) {
+    double now = SimUtilities::getHighResTimestamp();
+    m_cellProfile[m_profileCell].wallSeconds += now - m_profileTimestamp;
+    m_profileCell = getCellIndex(position.first, position.second);
+    m_profileTimestamp = now;
+}
+
+void SimulationEngine::setFogEnabled(bool enabled) {
+    m_isFogEnabled = enabled;
+    updateFog();
+    if (m_view != nullptr) {
+        changeDisplay();
+    }
+}
+
+bool SimulationEngine::isFogEnabled() const {
+    return m_isFogEnabled;
+}
+
+void SimulationEngine::setDistanceOverlayEnabled(bool enabled) {
+    if (enabled == m_isDistanceOverlayEnabled) {
+        return;
+    }
+    if (m_view == nullptr) {
+        m_isDistanceOverlayEnabled = enabled;
+        return;
+    }
+    if (enabled) {
+        clearAllText();
+        m_isDistanceOverlayEnabled = true;
+        invalidateDistanceOverlay();
+    }
+    else {
+        m_isDistanceOverlayEnabled = false;
+        for (int x = 0; x < m_maze->getWidth(); x += 1) {
+            for (int y = 0; y < m_maze->getHeight(); y += 1) {
+                m_view->getMazeGraphic()->clearText(x, y);
+            }
+        }
+        m_overlayChanged.clear();
+    }
+    changeDisplay();
+}
+
+bool SimulationEngine::isDistanceOverlayEnabled() const {
+    return m_isDistanceOverlayEnabled;
+}
+
+void SimulationEngine::setProfileOverlay(ProfileMetric metric) {
+    if (metric == m_profileOverlay) {
+        return;
+    }
+    if (m_view == nullptr) {
+        m_profileOverlay = metric;
+        return;
+    }
+    if (m_profileOverlay == ProfileMetric::NONE) {
+        clearAllHeat();
+    }
+    m_profileOverlay = metric;
+    if (metric == ProfileMetric::NONE) {
+        for (int x = 0; x < m_maze->getWidth(); x += 1) {
+            for (int y = 0; y < m_maze->getHeight(); y += 1) {
+                m_view->getMazeGraphic()->clearHeat(x, y);
+            }
+        }
+        changeDisplay();
+        return;
+    }
+    refreshProfileOverlay();
+}
+
+ProfileMetric SimulationEngine::getProfileOverlay() const {
+    return m_profileOverlay;
+}
+
+void SimulationEngine::refreshProfileOverlay() {
+    if (m_profileOverlay == ProfileMetric::NONE || m_view == nullptr) {
+        return;
+    }
+    PROFILE_ZONE("SimulationEngine::refreshProfileOverlay");
+
+    // Every tile is scaled to the largest value, and tiles with nothing to
+    // show have no heat at all
+    QVector<CellProfile> profile = getCellProfile();
+    QVector<double> values(profile.size(), 0.0);
+    double maxValue = 0.0;
+    for (int i = 0; i < profile.size(); i += 1) {
+        const CellProfile& cell = profile.at(i);
+        switch (m_profileOverlay) {
+            case ProfileMetric::WALL_TIME:
+                values[i] = cell.wallSeconds;
+                break;
+            case ProfileMetric::SIMULATED_TIME:
+                values[i] = static_cast<double>(cell.ticks);
+                break;
+            case ProfileMetric::COMMANDS:
+                values[i] = static_cast<double>(cell.commands);
+                break;
+            case ProfileMetric::REVISITS:
+                values[i] = qMax(0, cell.visits - 1);
+                break;
+            default:
+                ASSERT_NEVER_RUNS();
+        }
+        maxValue = qMax(maxValue, values.at(i));
+    }
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    int height = m_maze->getHeight();
+    for (int i = 0; i < values.size(); i += 1) {
+        int heat = -1;
+        if (0.0 < values.at(i)) {
+            heat = qRound(values.at(i) / maxValue * MAX_HEAT);
+        }
+        mazeGraphic->setHeat(i / height, i % height, heat);
+    }
+    changeDisplay();
+}
+
+int SimulationEngine::getNumQueuedCommands() const {
+    return m_commandQueue.size();
+}
+
+int SimulationEngine::getMaxQueuedCommands() const {
+    return m_maxQueuedCommands;
+}
+
+bool SimulationEngine::hasReachedCenter() const {
+    return m_reachedCenter;
+}
+
+void SimulationEngine::setRunTimeParameters(
+        const RunTimeParameters& parameters) {
+    m_runTimeParameters = parameters;
+}
+
+void SimulationEngine::setMouseDefinition(
+        std::shared_ptr<const MouseDefinition> definition) {
+    ASSERT_TR(m_motionWorker == nullptr);
+    m_mouse->setDefinition(definition);
+}
+
+void SimulationEngine::setSensorNoise(const SensorNoise& noise) {
+    m_sensorNoise = noise;
+}
+
+QVector<double> SimulationEngine::getEstimatedTrialSeconds() const {
+    QVector<double> trialSeconds = m_trialSeconds;
+    trialSeconds.append(m_runTimeModel.getSeconds());
+    return trialSeconds;
+}
+
+void SimulationEngine::setContestRules(const ContestRules& rules) {
+    m_contestScorer = ContestScorer(rules);
+    m_isContestOver = false;
+}
+
+ContestScore SimulationEngine::getContestScore() const {
+    return m_contestScorer.getScore(m_runTimeModel.getSeconds());
+}
+
+RunSummary SimulationEngine::getSummary() const {
+    RunSummary summary;
+    summary.moves = m_numMoves;
+    summary.turns = m_numTurns;
+    summary.crashes = m_numCrashes;
+    summary.resets = m_trialSeconds.size();
+    summary.cellsExplored = m_coverage.numVisited;
+    summary.numCells = m_coverage.numCells;
+    summary.firstCenterTicks = m_firstCenterTicks;
+    summary.firstCenterSeconds = -1.0;
+    if (0 <= m_firstCenterTicks) {
+        summary.firstCenterSeconds =
+            static_cast<double>(m_firstCenterTicks) /
+            SimulationClock::TICKS_PER_SECOND;
+    }
+    summary.firstCenterMoves = m_firstCenterMoves;
+    summary.bestTrial = -1;
+    summary.bestTrialSeconds = -1.0;
+    QVector<double> centerSeconds = m_trialsCenterSeconds;
+    centerSeconds.append(m_trialCenterSeconds);
+    for (int i = 0; i < centerSeconds.size(); i += 1) {
+        double seconds = centerSeconds.at(i);
+        if (0.0 <= seconds && (
+            summary.bestTrial < 0 || seconds < summary.bestTrialSeconds
+        )) {
+            summary.bestTrial = i;
+            summary.bestTrialSeconds = seconds;
+        }
+    }
+    summary.estimatedSeconds = 0.0;
+    for (double seconds : getEstimatedTrialSeconds()) {
+        summary.estimatedSeconds += seconds;
+    }
+    return summary;
+}
+
+QString SimulationEngine::summaryToString(const RunSummary& summary) {
+    QString string = QString(
+        "%1 moves, %2 turns, %3 crashes, %4 resets, %5 of %6 cells explored"
+    ).arg(
+        QString::number(summary.moves),
+        QString::number(summary.turns),
+        QString::number(summary.crashes),
+        QString::number(summary.resets),
+        QString::number(summary.cellsExplored),
+        QString::number(summary.numCells)
+    );
+    if (summary.firstCenterTicks < 0) {
+        return string + ", center not reached";
+    }
+    string += QString(", center first reached after %1 moves (%2 s)").arg(
+        QString::number(summary.firstCenterMoves),
+        QString::number(summary.firstCenterSeconds, 'f', 3)
+    );
+    if (0 <= summary.bestTrial) {
+        string += QString(", best run to the center in trial %1 (%2 s)").arg(
+            QString::number(summary.bestTrial + 1),
+            QString::number(summary.bestTrialSeconds, 'f', 3)
+        );
+    }
+    return string;
+}
+
+QString SimulationEngine::executeCommand(const Command& command) {
+    PROFILE_ZONE("SimulationEngine::executeCommand");
+    AllocationScope allocationScope(
+        &m_commandAllocations[static_cast<int>(command.opcode)]);
+    switch (command.opcode) {
+        case Opcode::HELLO:
+            return hello();
+        case Opcode::MAZE_WIDTH:
+            return QString::number(mazeWidth());
+        case Opcode::MAZE_HEIGHT:
+            return QString::number(mazeHeight());
+        case Opcode::WALL_FRONT:
+            return boolToString(wallFront());
+        case Opcode::WALL_RIGHT:
+            return boolToString(wallRight());
+        case Opcode::WALL_LEFT:
+            return boolToString(wallLeft());
+        case Opcode::WALLS:
+            return WALLS_RESPONSES[walls()];
+        case Opcode::MOVE_FORWARD: {
+            // Without a count, keep the original single-cell response
+            if (command.numInts == 0) {
+                return moveForward(1, nullptr) ? "" : CRASH;
+            }
+            int numCells = command.ints[0];
+            if (numCells < 1) {
+                return INVALID;
+            }
+            QPair<int, int> blocked;
+            if (!moveForward(numCells, &blocked)) {
+                return crashToString(blocked);
+            }
+            return "";
+        }
+        case Opcode::TURN_RIGHT:
+            turnRight();
+            return "";
+        case Opcode::TURN_LEFT:
+            turnLeft();
+            return "";
+        case Opcode::CURVE_RIGHT:
+        case Opcode::CURVE_LEFT:
+        case Opcode::CURVE_RIGHT_180:
+        case Opcode::CURVE_LEFT_180: {
+            static const QMap<Opcode, Movement> movements = {
+                {Opcode::CURVE_RIGHT, Movement::CURVE_RIGHT},
+                {Opcode::CURVE_LEFT, Movement::CURVE_LEFT},
+                {Opcode::CURVE_RIGHT_180, Movement::CURVE_RIGHT_180},
+                {Opcode::CURVE_LEFT_180, Movement::CURVE_LEFT_180},
+            };
+            QPair<int, int> blocked;
+            if (!curve(movements.value(command.opcode), &blocked)) {
+                return crashToString(blocked);
+            }
+            return "";
+        }
+        case Opcode::DIAGONAL_RIGHT:
+        case Opcode::DIAGONAL_LEFT: {
+            // Anything shorter than two tiles isn't a diagonal
+            int numCells = command.ints[0];
+            if (numCells < 2) {
+                return INVALID;
+            }
+            Movement movement = command.opcode == Opcode::DIAGONAL_RIGHT
+                ? Movement::DIAGONAL_RIGHT
+                : Movement::DIAGONAL_LEFT;
+            QPair<int, int> blocked;
+            if (!diagonal(movement, numCells, &blocked)) {
+                return crashToString(blocked);
+            }
+            return "";
+        }
+        case Opcode::RUN_PATH:
+            return runPath(command.text);
+        case Opcode::WAS_RESET:
+            return boolToString(wasReset());
+        case Opcode::ACK_RESET:
+            ackReset();
+            return ACK;
+        case Opcode::NEXT_MAZE:
+            return nextMaze();
+        case Opcode::ASYNC_MOVES:
+            m_isAsyncMoves = true;
+            return ACK;
+        case Opcode::PUSH_SENSORS:
+            m_isPushingSensors = true;
+            return ACK;
+        default:
+            return INVALID;
+    }
+}
+
+void SimulationEngine::executeInlineCommand(const Command& command) {
+    AllocationScope allocationScope(
+        &m_commandAllocations[static_cast<int>(command.opcode)]);
+    switch (command.opcode) {
+        case Opcode::SET_WALL:
+            setWall(command.ints[0], command.ints[1], command.character);
+            break;
+        case Opcode::CLEAR_WALL:
+            clearWall(command.ints[0], command.ints[1], command.character);
+            break;
+        case Opcode::SET_WALLS:
+            setWalls(command.ints[0], command.ints[1], command.ints[2]);
+            break;
+        case Opcode::SET_WALL_ROW:
+            setWallRow(command.ints[0], command.text);
+            break;
+        case Opcode::SET_COLOR:
+            setColor(command.ints[0], command.ints[1], command.character);
+            break;
+        case Opcode::CLEAR_COLOR:
+            clearColor(command.ints[0], command.ints[1]);
+            break;
+        case Opcode::CLEAR_ALL_COLOR:
+            clearAllColor();
+            break;
+        case Opcode::SET_COLOR_RECT:
+            setColorRect(
+                command.ints[0],
+                command.ints[1],
+                command.ints[2],
+                command.ints[3],
+                command.character);
+            break;
+        case Opcode::SET_COLOR_GRID:
+            setColorGrid(command.text);
+            break;
+        case Opcode::SET_TEXT:
+            setText(command.ints[0], command.ints[1], command.text);
+            break;
+        case Opcode::CLEAR_TEXT:
+            clearText(command.ints[0], command.ints[1]);
+            break;
+        case Opcode::CLEAR_ALL_TEXT:
+            clearAllText();
+            break;
+        case Opcode::SET_TEXT_ROW:
+            setTextRow(command.ints[0], command.text);
+            break;
+        case Opcode::SET_HEAT:
+            setHeat(command.ints[0], command.ints[1], command.ints[2]);
+            break;
+        case Opcode::SET_HEAT_ROW:
+            setHeatRow(command.ints[0], command.text);
+            break;
+        case Opcode::CLEAR_ALL_HEAT:
+            clearAllHeat();
+            break;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+    if (m_view != nullptr) {
+        changeDisplay();
+    }
+}
+
+void SimulationEngine::changeDisplay() {
+    // Without a view, only the mouse can have changed, and there's nothing
+    // to publish
+    if (m_view == nullptr) {
+        emit displayChanged();
+        return;
+    }
+    if (!m_displayTimer->isActive()) {
+        double remaining =
+            m_displayTimestamp + MIN_DISPLAY_SECONDS -
+            SimUtilities::getHighResTimestamp();
+        m_displayTimer->start(qMax(0, qCeil(remaining * 1000)));
+    }
+}
+
+void SimulationEngine::publishDisplay() {
+    m_displayTimestamp = SimUtilities::getHighResTimestamp();
+    updateDistanceOverlay();
+    m_view->publishSnapshot();
+    emit displayChanged();
+}
+
+void SimulationEngine::clearCommandQueue() {
+    m_commandQueue.clear();
+}
+
+bool SimulationEngine::isMovement(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::MOVE_FORWARD:
+        case Opcode::TURN_RIGHT:
+        case Opcode::TURN_LEFT:
+        case Opcode::CURVE_RIGHT:
+        case Opcode::CURVE_LEFT:
+        case Opcode::CURVE_RIGHT_180:
+        case Opcode::CURVE_LEFT_180:
+        case Opcode::DIAGONAL_RIGHT:
+        case Opcode::DIAGONAL_LEFT:
+        case Opcode::RUN_PATH:
+            return true;
+        default:
+            return false;
+    }
+}
+
+QString SimulationEngine::toAsyncResponse(
+        const QString& response,
+        int sequenceNumber) const {
+    // E.g., "done 3", "crash 3" or "crash 3 1 2"; an asynchronous movement
+    // that's invalid can't be dropped, since it was already answered
+    QString number = QString::number(sequenceNumber);
+    if (response.startsWith(ACK)) {
+        return DONE + " " + number + response.mid(ACK.size());
+    }
+    if (response == INVALID) {
+        return INVALID + " " + number;
+    }
+    ASSERT_TR(response.startsWith(CRASH));
+    return CRASH + " " + number + response.mid(CRASH.size());
+}
+
+QString SimulationEngine::toSensorResponse(
+        const QString& response,
+        Opcode opcode) {
+    if (!m_isPushingSensors || response != ACK || !isMovement(opcode)) {
+        return response;
+    }
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    return QString("%1 %2 %3 %4 %5").arg(
+        ACK,
+        QString::number(position.first),
+        QString::number(position.second),
+        QString(DIRECTION_TO_CHAR(direction)),
+        WALLS_RESPONSES[walls()]
+    );
+}
+
+void SimulationEngine::beginResponseBatch() {
+    m_isBatchingResponses = true;
+}
+
+void SimulationEngine::endResponseBatch() {
+    m_isBatchingResponses = false;
+    flushResponses();
+}
+
+void SimulationEngine::flushResponses() {
+    if (m_numResponses == 0) {
+        return;
+    }
+    emit responsesReady(m_responseBytes, m_numResponses);
+    m_responseBytes.resize(0);
+    m_numResponses = 0;
+}
+
+void SimulationEngine::respond(const QString& response) {
+    if (m_responseBytes.capacity() < LineFramer::RESERVED_BYTES) {
+        m_responseBytes.reserve(LineFramer::RESERVED_BYTES);
+    }
+    LineFramer::encodeAppend(response, &m_responseBytes);
+    m_numResponses += 1;
+}
+
+void SimulationEngine::flushUnbatchedResponses() {
+    if (!m_isBatchingResponses) {
+        flushResponses();
+    }
+}
+
+void SimulationEngine::processQueuedCommands() {
+    PROFILE_ZONE("SimulationEngine::processQueuedCommands");
+    // Whatever the slice ends with, the algorithm is waiting on its responses
+    processCommandSlice();
+    flushUnbatchedResponses();
+}
+
+void SimulationEngine::processCommandSlice() {
+    double deadline =
+        SimUtilities::getHighResTimestamp() + PROCESSING_SLICE_SECONDS;
+    while (!m_commandQueue.isEmpty() && !m_isPaused && !m_isStopped) {
+        // Yield between commands, e.g., to a long queue of instant moves;
+        // new commands are only queued until the timer fires
+        if (!isMoving() && deadline < SimUtilities::getHighResTimestamp()) {
+            m_commandQueueTimer->start(0);
+            break;
+        }
+        QString response = "";
+        if (isMoving()) {
+            updateMouseProgress(
+                m_isMovementContinuous
+                    ? getContinuousProgress()
+                    : m_movementStepSize
+            );
+            // Observers of completed movements may have stopped the engine
+            if (m_isStopped) {
+                return;
+            }
+            if (!isMoving() && !startNextPathSegment()) {
+                response = ACK;
+            }
+        }
+        else {
+            if (m_latency != nullptr) {
+                m_headStartedTimestamp = SimUtilities::getHighResTimestamp();
+            }
+            response = executeCommand(m_commandQueue.head().command);
+            beginMovement();
+            // Instant movements (and every segment of an instant path) go
+            // straight to the destination
+            if (isMovingInstantly() && isMoving()) {
+                while (isMoving()) {
+                    updateMouseProgress(
+                        progressRequired(m_movement) - m_movementProgress
+                    );
+                    if (m_isStopped) {
+                        return;
+                    }
+                    if (!isMoving()) {
+                        startNextPathSegment();
+                    }
+                }
+                response = ACK;
+            }
+            else if (m_isMovementContinuous) {
+                startContinuousMovement();
+            }
+        }
+        if (!response.isEmpty()) {
+            // Dequeue before responding, since the response may cause the
+            // engine to be stopped; drop all invalid commands on the floor
+            // (but keep them in the trace)
+            const QueuedCommand& queued = m_commandQueue.head();
+            Opcode opcode = queued.command.opcode;
+            double receivedTimestamp = queued.receivedTimestamp;
+            double dispatchedTimestamp = queued.dispatchedTimestamp;
+            int sequenceNumber = queued.sequenceNumber;
+            m_commandQueue.dequeue();
+            if (m_commandQueue.size() + 1 == m_queueLimit) {
+                emit queueReady();
+            }
+            response = toSensorResponse(response, opcode);
+            if (sequenceNumber != 0) {
+                response = toAsyncResponse(response, sequenceNumber);
+            }
+            if (m_trace != nullptr) {
+                m_trace->recordResponse(opcode, response);
+            }
+            if (m_latency != nullptr) {
+                m_latency->record(
+                    opcode,
+                    receivedTimestamp,
+                    dispatchedTimestamp,
+                    m_headStartedTimestamp,
+                    SimUtilities::getHighResTimestamp()
+                );
+            }
+            if (response.startsWith(CRASH)) {
+                m_numCrashes += 1;
+            }
+            if (response != INVALID) {
+                respond(response);
+            }
+        }
+        else {
+            scheduleMouseProgressUpdate();
+            break;
+        }
+    }
+}
+
+double SimulationEngine::progressRequired(Movement movement) {
+    switch (movement) {
+        case Movement::MOVE_FORWARD:
+            return PROGRESS_REQUIRED_FOR_MOVE * m_movementCells;
+        case Movement::TURN_RIGHT:
+        case Movement::TURN_LEFT:
+            return PROGRESS_REQUIRED_FOR_TURN;
+        case Movement::CURVE_RIGHT:
+        case Movement::CURVE_LEFT:
+        case Movement::CURVE_RIGHT_180:
+        case Movement::CURVE_LEFT_180:
+        case Movement::DIAGONAL_RIGHT:
+        case Movement::DIAGONAL_LEFT:
+            return PROGRESS_REQUIRED_FOR_MOVE * m_movementPath.size();
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+void SimulationEngine::updateMouseProgress(double progress) {
+    PROFILE_ZONE("SimulationEngine::updateMouseProgress");
+
+    // Increment the movement progress, calculate fraction complete
+    m_movementProgress += progress;
+    double required = progressRequired(m_movement);
+    double remaining = required - m_movementProgress;
+    if (remaining < 0) {
+        remaining = 0;
+    }
+    double fraction = 1.0 - (remaining / required);
+
+    // Only the primitive and the fraction are handed to the mouse, which
+    // works out the destination on the grid, and computes its continuous
+    // pose when (and if) it's drawn
+    m_mouse->setMovement(getMotionPrimitive(), fraction);
+    QPair<int, int> destinationLocation = m_mouse->getDestination();
+    Direction destinationDirection = m_mouse->getDestinationDirection();
+    ASSERT_TR(isWithinMaze(
+        destinationLocation.first,
+        destinationLocation.second
+    ));
+    changeDisplay();
+
+    // Settle the mouse at its destination, reset movement state if done
+    if (remaining == 0.0) {
+        Movement completed = m_movement;
+        QPair<int, int> origin = m_startingLocation;
+        QVector<Direction> path = m_movementPath;
+        m_startingLocation = destinationLocation;
+        m_startingDirection = destinationDirection;
+        m_mouse->teleport(m_startingLocation, m_startingDirection);
+        m_movement = Movement::NONE;
+        m_movementCells = 1;
+        m_movementPath.clear();
+        m_movementProgress = 0.0;
+        m_movementStepSize = 0.0;
+        advanceClock();
+        onMovementCompleted(completed, origin, path);
+        updateContest();
+    }
+}
+
+void SimulationEngine::scheduleMouseProgressUpdate() {
+
+    // Continuous movements take as long as they take; they're polled at
+    // about the rate at which they're drawn, and completed as soon as the
+    // motion worker says they are
+    if (m_isMovementContinuous) {
+        m_commandQueueTimer->start(CONTINUOUS_POLL_MS);
+        return;
+    }
+
+    // Calculate progressRemaining, should be nonzero
+    double required = progressRequired(m_movement);
+    double progressRemaining = required - m_movementProgress;
+    ASSERT_LT(0.0, progressRemaining);
+
+    // The rest of the movement is a single step, which the mouse animates
+    // on its own, from the time, whenever it's drawn; the engine only wakes
+    // up once the movement is complete
+    double secondsRemaining = progressRemaining / m_progressPerSecond;
+    m_movementStepSize = progressRemaining;
+    m_movementStepTimestamp = SimUtilities::getHighResTimestamp();
+    m_mouse->animate(m_progressPerSecond / required);
+    m_commandQueueTimer->start(secondsRemaining * 1000);
+}
+
+bool SimulationEngine::freezeMouseProgress() {
+    if (
+        !isMoving() ||
+        m_isMovementContinuous ||
+        !m_commandQueueTimer->isActive()
+    ) {
+        return false;
+    }
+    double elapsed =
+        SimUtilities::getHighResTimestamp() - m_movementStepTimestamp;
+    double progress = elapsed * m_progressPerSecond;
+    if (m_movementStepSize <= progress) {
+        return false;
+    }
+
+    // Whatever's left is rescheduled from here, by the next progress update
+    m_commandQueueTimer->stop();
+    updateMouseProgress(progress);
+    m_movementStepSize = 0.0;
+    return true;
+}
+
+bool SimulationEngine::isMoving() {
+    return m_movement != Movement::NONE;
+}
+
+void SimulationEngine::resetMovement() {
+    m_startingLocation = {0, 0};
+    m_startingDirection = Direction::NORTH;
+    m_movement = Movement::NONE;
+    m_pathSegments.clear();
+    m_movementCells = 1;
+    m_movementPath.clear();
+    m_movementProgress = 0.0;
+    m_movementStepSize = 0.0;
+    m_movementStepTimestamp = 0.0;
+    m_movementTicks = 0;
+}
+
+void SimulationEngine::beginMovement() {
+    // The dynamics only know how to drive straight and turn in place
+    m_isMovementContinuous =
+        m_isContinuous && isMoving() && m_movementPath.isEmpty();
+    if (isMoving()) {
+        m_movementTicks = getMovementTicks();
+    }
+}
+
+bool SimulationEngine::startNextPathSegment() {
+    if (m_pathSegments.isEmpty()) {
+        return false;
+    }
+    PathSegment segment = m_pathSegments.takeFirst();
+    m_movement = segment.movement;
+    m_movementCells = segment.numCells;
+    beginMovement();
+    if (m_isMovementContinuous && !isMovingInstantly()) {
+        startContinuousMovement();
+    }
+    return true;
+}
+
+void SimulationEngine::onMovementCompleted(
+        Movement movement,
+        QPair<int, int> origin,
+        const QVector<Direction>& path) {
+
+    // Every tile along a curve or diagonal counts as a move, and every
+    // quarter turn that it makes, overall, as a turn
+    if (!path.isEmpty()) {
+        QPair<int, int> position = origin;
+        bool enteredStart = false;
+        bool enteredCenter = false;
+        for (Direction direction : path) {
+            Wall step = getOpposingWall({
+                position.first,
+                position.second,
+                direction
+            });
+            position = {step.x, step.y};
+            enterTile(position);
+            enteredStart = enteredStart || isStart(position);
+            enteredCenter = enteredCenter || isCenter(position);
+        }
+        m_numTurns += qAbs(getQuarterTurns(movement, path.size()));
+        addPathToRunTimeModel(movement, path.size());
+        if (enteredStart) {
+            reachStart();
+        }
+        if (enteredCenter) {
+            reachTrialCenter();
+        }
+        return;
+    }
+
+    if (movement != Movement::MOVE_FORWARD) {
+        m_numTurns += 1;
+        m_runTimeModel.addTurn();
+        return;
+    }
+
+    // Visit every cell entered by the (possibly multi-cell) move, so that
+    // driving straight through the center counts as reaching it
+    QPair<int, int> position = origin;
+    while (position != m_startingLocation) {
+        Wall step = getOpposingWall({
+            position.first,
+            position.second,
+            m_startingDirection
+        });
+        position = {step.x, step.y};
+        enterTile(position);
+        m_runTimeModel.addStraight(Dimensions::tileLength().getMeters());
+        if (isStart(position)) {
+            reachStart();
+        }
+        if (isCenter(position)) {
+            reachTrialCenter();
+        }
+    }
+}
+
+qint64 SimulationEngine::getMovementTicks() {
+    if (m_isMovementContinuous) {
+        double seconds = simulateMovement();
+        return qRound64(seconds * SimulationClock::TICKS_PER_SECOND);
+    }
+    return static_cast<qint64>(
+        qCeil(progressRequired(m_movement) / PROGRESS_PER_TICK)
+    );
+}
+
+void SimulationEngine::advanceClock() {
+    qint64 before = m_clock.getTicks();
+    m_clock.advance(m_movementTicks);
+    m_cellProfile[m_profileCell].ticks += m_movementTicks;
+    if (m_isMovementContinuous) {
+        m_simulatedSeconds +=
+            static_cast<double>(m_movementTicks) /
+            SimulationClock::TICKS_PER_SECOND;
+    }
+    m_movementTicks = 0;
+    if (0 <= m_tickLimit && before <= m_tickLimit &&
+            m_tickLimit < m_clock.getTicks()) {
+        emit tickLimitReached();
+    }
+}
+
+void SimulationEngine::enterTile(QPair<int, int> position) {
+    m_numMoves += 1;
+    if (0 <= m_moveLimit && m_moveLimit < m_numMoves) {
+        reachStepLimit();
+    }
+    moveProfileCell(position);
+    if (m_isTrailEnabled) {
+        m_trail.append(position);
+    }
+    if (isFastForwarding()) {
+        followFastForward(position);
+    }
+
+    int& count = m_visitCounts[getCellIndex(position.first, position.second)];
+    if (count == 0) {
+        m_coverage.numVisited += 1;
+        if (m_isFogEnabled && m_view != nullptr) {
+            m_view->getMazeGraphic()->setFog(
+                position.first,
+                position.second,
+                false
+            );
+        }
+    }
+    else {
+        m_coverage.numRevisits += 1;
+    }
+    count += 1;
+
+    // The clock has already been advanced past the whole movement
+    if (!m_reachedCenter && isCenter(position)) {
+        m_reachedCenter = true;
+        m_firstCenterTicks = m_clock.getTicks();
+        m_firstCenterMoves = m_numMoves;
+        m_coverage.numVisitedBeforeCenter = m_coverage.numVisited;
+        emit centerReached();
+    }
+}
+
+bool SimulationEngine::isStart(QPair<int, int> position) const {
+    // The mouse starts, and is reset to, the bottom left corner
+    return position == QPair<int, int>(0, 0);
+}
+
+bool SimulationEngine::isCenter(QPair<int, int> position) const {
+    // Center tiles are exactly the ones with distance zero, i.e., the ones
+    // of Maze::getCenterPositions
+    return m_maze->getDistance(position.first, position.second) == 0;
+}
+
+void SimulationEngine::reachStart() {
+    m_contestScorer.enterStart(m_runTimeModel.getSeconds());
+}
+
+void SimulationEngine::reachTrialCenter() {
+    if (m_trialCenterSeconds < 0.0) {
+        m_trialCenterSeconds = m_runTimeModel.getSeconds();
+    }
+    m_contestScorer.enterCenter(m_runTimeModel.getSeconds());
+}
+
+void SimulationEngine::updateContest() {
+    if (!m_isContestOver && getContestScore().isOver) {
+        m_isContestOver = true;
+        emit contestOver();
+    }
+}
+
+int SimulationEngine::getCellIndex(int x, int y) const {
+    return x * m_maze->getHeight() + y;
+}
+
+void SimulationEngine::updateFog() {
+    if (m_view == nullptr) {
+        return;
+    }
+    for (int x = 0; x < m_maze->getWidth(); x += 1) {
+        for (int y = 0; y < m_maze->getHeight(); y += 1) {
+            bool fog = m_isFogEnabled && getVisitCount(x, y) == 0;
+            m_view->getMazeGraphic()->setFog(x, y, fog);
+        }
+    }
+}
+
+void SimulationEngine::invalidateDistanceOverlay() {
+    m_overlayChanged.clear();
+    m_isDistanceOverlayStale = true;
+}
+
+void SimulationEngine::updateDistanceOverlayWall(
+        int x,
+        int y,
+        Direction d,
+        bool isWall) {
+    // A stale overlay is searched again anyway
+    if (m_isDistanceOverlayEnabled && !m_isDistanceOverlayStale) {
+        m_overlayDistances.setWall(x, y, d, isWall, &m_overlayChanged);
+    }
+}
+
+void SimulationEngine::updateDistanceOverlay() {
+    if (!m_isDistanceOverlayEnabled) {
+        return;
+    }
+    if (!m_isDistanceOverlayStale && m_overlayChanged.isEmpty()) {
+        return;
+    }
+    PROFILE_ZONE("SimulationEngine::updateDistanceOverlay");
+
+    // A stale overlay is searched again, outward from the center cells,
+    // through the walls as the view has them, which are the declared ones,
+    // and every tile is rewritten
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    int width = m_maze->getWidth();
+    int height = m_maze->getHeight();
+    if (m_isDistanceOverlayStale) {
+        WallGrid walls(width, height);
+        m_overlayChanged.clear();
+        for (int x = 0; x < width; x += 1) {
+            for (int y = 0; y < height; y += 1) {
+                unsigned char declared =
+                    mazeGraphic->getTileState(x, y).declaredWalls;
+                for (Direction d : DIRECTIONS) {
+                    walls.setWall(
+                        x, y, d, declared & (1 << DIRECTION_INDEX(d)));
+                }
+                m_overlayChanged.append(getCellIndex(x, y));
+            }
+        }
+        m_overlayDistances = DynamicDistances(
+            walls,
+            Maze::getCenterPositions(width, height)
+        );
+        m_isDistanceOverlayStale = false;
+    }
+
+    // Cells that no path reaches are left blank
+    for (int cell : m_overlayChanged) {
+        int distance = m_overlayDistances.getDistances().at(cell);
+        if (distance == -1) {
+            mazeGraphic->clearText(cell / height, cell % height);
+        }
+        else {
+            mazeGraphic->setText(
+                cell / height,
+                cell % height,
+                QString::number(distance)
+            );
+        }
+    }
+    m_overlayChanged.clear();
+}
+
+double SimulationEngine::getMovementAmount() {
+    switch (m_movement) {
+        case Movement::MOVE_FORWARD:
+            return Dimensions::tileLength().getMeters() * m_movementCells;
+        case Movement::TURN_LEFT:
+            return M_PI / 2.0;
+        case Movement::TURN_RIGHT:
+            return -M_PI / 2.0;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+void SimulationEngine::startContinuousMovement() {
+
+    // Only engines that animate continuous movements need the thread
+    if (m_motionThread == nullptr) {
+        m_motionThread = new QThread();
+        m_motionWorker = new MotionWorker(
+            &m_maze->getWalls(),
+            getBody(),
+            m_mouse->getDefinition()->getSensorMounts()
+        );
+        m_motionWorker->moveToThread(m_motionThread);
+        connect(
+            m_motionWorker,
+            &MotionWorker::movementCompleted,
+            this,
+            [=](int movement){
+                if (movement != m_motionNumber) {
+                    return;
+                }
+                // Its time was already known when it was executed
+                // Don't wait for the next poll
+                if (m_commandQueueTimer->isActive()) {
+                    m_commandQueueTimer->stop();
+                    processQueuedCommands();
+                }
+            }
+        );
+        m_motionThread->start();
+    }
+    m_motionNumber += 1;
+    QMetaObject::invokeMethod(
+        m_motionWorker,
+        m_movement == Movement::MOVE_FORWARD ? "startStraight" : "startTurn",
+        Qt::QueuedConnection,
+        Q_ARG(int, m_motionNumber),
+        Q_ARG(double, m_mouse->getCurrentTranslation().getX().getMeters()),
+        Q_ARG(double, m_mouse->getCurrentTranslation().getY().getMeters()),
+        Q_ARG(double, m_mouse->getCurrentRotation().getRadiansUnbounded()),
+        Q_ARG(double, getMovementAmount())
+    );
+}
+
+double SimulationEngine::simulateMovement() {
+    if (m_movement == Movement::MOVE_FORWARD) {
+        m_dynamics.startStraight(getMovementAmount());
+    }
+    else {
+        m_dynamics.startTurn(getMovementAmount());
+    }
+    return m_dynamics.finish();
+}
+
+double SimulationEngine::getContinuousProgress() {
+    double fraction = 0.0;
+    if (m_motionWorker != nullptr) {
+        fraction = m_motionWorker->getFraction(m_motionNumber);
+    }
+    // A complete movement must be exactly complete, despite rounding
+    double required = progressRequired(m_movement);
+    if (1.0 <= fraction) {
+        return required;
+    }
+    return qMax(fraction * required - m_movementProgress, 0.0);
+}
+
+QVector<double> SimulationEngine::getSensorReadings() const {
+    if (m_isMovementContinuous && m_motionWorker != nullptr) {
+        QVector<double> readings =
+            m_motionWorker->getSensorReadings(m_motionNumber);
+        if (!readings.isEmpty()) {
+            return readings;
+        }
+    }
+    DistanceSensors sensors(
+        &m_maze->getWalls(),
+        m_mouse->getDefinition()->getSensorMounts()
+    );
+    QVector<double> readings(sensors.getCount(), 0.0);
+    Coordinate translation = m_mouse->getCurrentTranslation();
+    sensors.read(
+        translation.getX().getMeters(),
+        translation.getY().getMeters(),
+        m_mouse->getCurrentRotation().getRadiansUnbounded(),
+        readings.data()
+    );
+    return readings;
+}
+
+QVector<Contact> SimulationEngine::getContacts() const {
+    if (m_isMovementContinuous && m_motionWorker != nullptr) {
+        return m_motionWorker->getContacts(m_motionNumber);
+    }
+    // The discretized translation lags behind a movement of several cells,
+    // so the tile is the one that the mouse is actually in
+    double tileLength = Dimensions::tileLength().getMeters();
+    Coordinate translation = m_mouse->getCurrentTranslation();
+    QPair<int, int> tile = {
+        static_cast<int>(qFloor(translation.getX().getMeters() / tileLength)),
+        static_cast<int>(qFloor(translation.getY().getMeters() / tileLength))
+    };
+    CollisionDetector detector(&m_maze->getWalls());
+    return detector.check(m_mouse->getCurrentBodyPolygon(), tile);
+}
+
+Polygon SimulationEngine::getBody() const {
+    return m_mouse->getDefinition()->getCollisionHull();
+}
+
+void SimulationEngine::stopContinuousMovement() {
+    // Anything that the worker is still doing is of no interest any more
+    m_motionNumber += 1;
+    m_isMovementContinuous = false;
+    if (m_motionWorker != nullptr) {
+        QMetaObject::invokeMethod(
+            m_motionWorker,
+            "stop",
+            Qt::QueuedConnection
+        );
+    }
+}
+
+int SimulationEngine::mazeWidth() {
+    return m_maze->getWidth();
+}
+
+int SimulationEngine::mazeHeight() {
+    return m_maze->getHeight();
+}
+
+bool SimulationEngine::wallFront() {
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    return readWall({position.first, position.second, direction});
+}
+
+bool SimulationEngine::wallRight() {
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction =
+        DIRECTION_ROTATE_RIGHT(m_mouse->getCurrentDiscretizedRotation());
+    return readWall({position.first, position.second, direction});
+}
+
+bool SimulationEngine::wallLeft() {
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction =
+        DIRECTION_ROTATE_LEFT(m_mouse->getCurrentDiscretizedRotation());
+    return readWall({position.first, position.second, direction});
+}
+
+int SimulationEngine::walls() {
+    // Every reading comes from the same discretized pose, so a single query
+    // can't observe the mouse halfway through a movement
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction front = m_mouse->getCurrentDiscretizedRotation();
+    Direction right = DIRECTION_ROTATE_RIGHT(front);
+    Direction back = DIRECTION_OPPOSITE(front);
+    Direction left = DIRECTION_ROTATE_LEFT(front);
+    int mask = 0;
+    if (readWall({position.first, position.second, front})) {
+        mask |= WALL_MASK_FRONT;
+    }
+    if (readWall({position.first, position.second, right})) {
+        mask |= WALL_MASK_RIGHT;
+    }
+    if (readWall({position.first, position.second, back})) {
+        mask |= WALL_MASK_BACK;
+    }
+    if (readWall({position.first, position.second, left})) {
+        mask |= WALL_MASK_LEFT;
+    }
+    return mask;
+}
+
+bool SimulationEngine::moveForward(int numCells, QPair<int, int>* blocked) {
+    // Check the whole straight run up front, so that a crash doesn't leave
+    // the mouse somewhere in the middle of it
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    for (int i = 0; i < numCells; i += 1) {
+        if (isWall({position.first, position.second, direction})) {
+            if (blocked != nullptr) {
+                *blocked = position;
+            }
+            return false;
+        }
+        Wall next = getOpposingWall({
+            position.first,
+            position.second,
+            direction
+        });
+        position = {next.x, next.y};
+    }
+    m_movement = Movement::MOVE_FORWARD;
+    m_movementCells = numCells;
+    return true;
+}
+
+void SimulationEngine::turnRight() {
+    m_movement = Movement::TURN_RIGHT;
+}
+
+void SimulationEngine::turnLeft() {
+    m_movement = Movement::TURN_LEFT;
+}
+
+bool SimulationEngine::curve(Movement movement, QPair<int, int>* blocked) {
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    bool isRight =
+        movement == Movement::CURVE_RIGHT ||
+        movement == Movement::CURVE_RIGHT_180;
+    Direction side = isRight
+        ? DIRECTION_ROTATE_RIGHT(direction)
+        : DIRECTION_ROTATE_LEFT(direction);
+    QVector<Direction> path = {direction, side};
+    if (
+        movement == Movement::CURVE_RIGHT_180 ||
+        movement == Movement::CURVE_LEFT_180
+    ) {
+        path.append(isRight
+            ? DIRECTION_ROTATE_RIGHT(side)
+            : DIRECTION_ROTATE_LEFT(side));
+    }
+    return startPath(movement, path, blocked);
+}
+
+bool SimulationEngine::diagonal(
+        Movement movement,
+        int numCells,
+        QPair<int, int>* blocked) {
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    Direction side = movement == Movement::DIAGONAL_RIGHT
+        ? DIRECTION_ROTATE_RIGHT(direction)
+        : DIRECTION_ROTATE_LEFT(direction);
+    QVector<Direction> path;
+    for (int i = 0; i < numCells; i += 1) {
+        path.append(i % 2 == 0 ? direction : side);
+    }
+    return startPath(movement, path, blocked);
+}
+
+bool SimulationEngine::startPath(
+        Movement movement,
+        const QVector<Direction>& path,
+        QPair<int, int>* blocked) {
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    for (Direction direction : path) {
+        if (isWall({position.first, position.second, direction})) {
+            *blocked = position;
+            return false;
+        }
+        Wall next = getOpposingWall({
+            position.first,
+            position.second,
+            direction
+        });
+        position = {next.x, next.y};
+    }
+    m_movement = movement;
+    m_movementPath = path;
+    return true;
+}
+
+QString SimulationEngine::runPath(const QString& moves) {
+    QVector<PathSegment> path;
+    if (!parsePath(moves, &path)) {
+        return INVALID;
+    }
+
+    // Check every segment up front, in a single pass over the wall grid, so
+    // that a crash doesn't leave the mouse somewhere along the way
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    for (int i = 0; i < path.size(); i += 1) {
+        const PathSegment& segment = path.at(i);
+        if (segment.movement == Movement::TURN_RIGHT) {
+            direction = DIRECTION_ROTATE_RIGHT(direction);
+            continue;
+        }
+        if (segment.movement == Movement::TURN_LEFT) {
+            direction = DIRECTION_ROTATE_LEFT(direction);
+            continue;
+        }
+        for (int j = 0; j < segment.numCells; j += 1) {
+            if (isWall({position.first, position.second, direction})) {
+                return QString("%1 %2 %3 %4").arg(
+                    CRASH,
+                    QString::number(i),
+                    QString::number(position.first),
+                    QString::number(position.second)
+                );
+            }
+            Wall next = getOpposingWall({
+                position.first,
+                position.second,
+                direction
+            });
+            position = {next.x, next.y};
+        }
+    }
+
+    // The first segment is started like any other movement, and the rest
+    // as each one before it completes
+    m_pathSegments = path;
+    PathSegment first = m_pathSegments.takeFirst();
+    m_movement = first.movement;
+    m_movementCells = first.numCells;
+    return "";
+}
+
+bool SimulationEngine::parsePath(
+        const QString& moves,
+        QVector<PathSegment>* path) {
+    for (const QString& token : moves.split(' ', QString::SkipEmptyParts)) {
+        if (token == "R") {
+            path->append({Movement::TURN_RIGHT, 1});
+        }
+        else if (token == "L") {
+            path->append({Movement::TURN_LEFT, 1});
+        }
+        else if (token.startsWith('F')) {
+            bool ok = true;
+            int numCells = token.size() == 1 ? 1 : token.mid(1).toInt(&ok);
+            if (!ok || numCells < 1) {
+                return false;
+            }
+            path->append({Movement::MOVE_FORWARD, numCells});
+        }
+        else {
+            return false;
+        }
+    }
+    return !path->isEmpty();
+}
+
+int SimulationEngine::getQuarterTurns(Movement movement, int numCells) const {
+    switch (movement) {
+        case Movement::CURVE_RIGHT:
+            return -1;
+        case Movement::CURVE_LEFT:
+            return 1;
+        case Movement::CURVE_RIGHT_180:
+            return -2;
+        case Movement::CURVE_LEFT_180:
+            return 2;
+        // Diagonals that enter an even number of tiles end up facing the side
+        case Movement::DIAGONAL_RIGHT:
+            return numCells % 2 == 0 ? -1 : 0;
+        case Movement::DIAGONAL_LEFT:
+            return numCells % 2 == 0 ? 1 : 0;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+MotionPrimitive SimulationEngine::getMotionPrimitive() const {
+    switch (m_movement) {
+        case Movement::MOVE_FORWARD:
+            return {MotionPrimitive::STRAIGHT, m_movementCells, 0};
+        case Movement::TURN_RIGHT:
+            return {MotionPrimitive::TURN, 0, -1};
+        case Movement::TURN_LEFT:
+            return {MotionPrimitive::TURN, 0, 1};
+        case Movement::CURVE_RIGHT:
+        case Movement::CURVE_LEFT:
+        case Movement::CURVE_RIGHT_180:
+        case Movement::CURVE_LEFT_180:
+            return {
+                MotionPrimitive::CURVE,
+                0,
+                getQuarterTurns(m_movement, m_movementPath.size())
+            };
+        case Movement::DIAGONAL_RIGHT:
+            return {MotionPrimitive::DIAGONAL, m_movementPath.size(), -1};
+        case Movement::DIAGONAL_LEFT:
+            return {MotionPrimitive::DIAGONAL, m_movementPath.size(), 1};
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+void SimulationEngine::addPathToRunTimeModel(
+        Movement movement,
+        int numCells) {
+
+    // Every path starts and ends with half a tile, between the center of a
+    // tile and its edge; diagonals cut across the corners of the tiles in
+    // between, from the middle of one wall to the middle of the next
+    double tileLength = Dimensions::tileLength().getMeters();
+    double radius = tileLength / 2.0;
+    m_runTimeModel.addStraight(radius);
+    switch (movement) {
+        case Movement::CURVE_RIGHT:
+        case Movement::CURVE_LEFT:
+            m_runTimeModel.addCurve(M_PI / 2.0 * radius);
+            break;
+        case Movement::CURVE_RIGHT_180:
+        case Movement::CURVE_LEFT_180:
+            m_runTimeModel.addCurve(M_PI * radius);
+            break;
+        case Movement::DIAGONAL_RIGHT:
+        case Movement::DIAGONAL_LEFT:
+            m_runTimeModel.addCurve(M_PI / 4.0 * radius);
+            m_runTimeModel.addStraight((numCells - 1) * tileLength / M_SQRT2);
+            m_runTimeModel.addCurve(M_PI / 4.0 * radius);
+            break;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+    m_runTimeModel.addStraight(radius);
+}
+
+void SimulationEngine::setWall(int x, int y, QChar direction) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (!IS_DIRECTION_CHAR(direction.toLatin1())) {
+        return;
+    }
+    Direction d = CHAR_TO_DIRECTION(direction.toLatin1());
+    m_knownWalls.declare(x, y, d, true);
+    if (m_view == nullptr) {
+        return;
+    }
+    updateDistanceOverlayWall(x, y, d, true);
+    m_view->getMazeGraphic()->setWall(x, y, d);
+    Wall opposingWall = getOpposingWall({x, y, d});
+    if (isWithinMaze(opposingWall.x, opposingWall.y)) {
+        m_view->getMazeGraphic()->setWall(
+            opposingWall.x,
+            opposingWall.y,
+            opposingWall.d
+        );
+    }
+}
+
+void SimulationEngine::clearWall(int x, int y, QChar direction) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (!IS_DIRECTION_CHAR(direction.toLatin1())) {
+        return;
+    }
+    Direction d = CHAR_TO_DIRECTION(direction.toLatin1());
+    m_knownWalls.declare(x, y, d, false);
+    if (m_view == nullptr) {
+        return;
+    }
+    updateDistanceOverlayWall(x, y, d, false);
+    m_view->getMazeGraphic()->clearWall(x, y, d);
+    Wall opposingWall = getOpposingWall({x, y, d});
+    if (isWithinMaze(opposingWall.x, opposingWall.y)) {
+        m_view->getMazeGraphic()->clearWall(
+            opposingWall.x,
+            opposingWall.y,
+            opposingWall.d
+        );
+    }
+}
+
+void SimulationEngine::setWalls(int x, int y, int mask) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (mask < 0 || 0xF < mask) {
+        return;
+    }
+    declareWalls(x, y, static_cast<unsigned char>(mask));
+}
+
+void SimulationEngine::setWallRow(int y, const QString& masks) {
+    if (y < 0 || m_maze->getHeight() <= y) {
+        return;
+    }
+
+    // Like a row of heats, the whole row is parsed before any of it is
+    // applied, so that a malformed row is ignored
+    static const QString digits = "0123456789abcdef";
+    QVector<unsigned char> row;
+    row.reserve(m_maze->getWidth());
+    for (QChar c : masks) {
+        if (c == ' ') {
+            continue;
+        }
+        int mask = digits.indexOf(c.toLower());
+        if (mask < 0) {
+            return;
+        }
+        if (row.size() < m_maze->getWidth()) {
+            row.append(static_cast<unsigned char>(mask));
+        }
+    }
+    for (int x = 0; x < row.size(); x += 1) {
+        declareWalls(x, y, row.at(x));
+    }
+}
+
+void SimulationEngine::declareWalls(int x, int y, unsigned char mask) {
+    for (Direction d : DIRECTIONS) {
+        m_knownWalls.declare(x, y, d, mask & (1 << DIRECTION_INDEX(d)));
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    mazeGraphic->setWalls(x, y, mask);
+    for (Direction d : DIRECTIONS) {
+        updateDistanceOverlayWall(x, y, d, mask & (1 << DIRECTION_INDEX(d)));
+        Wall opposingWall = getOpposingWall({x, y, d});
+        if (!isWithinMaze(opposingWall.x, opposingWall.y)) {
+            continue;
+        }
+        if (mask & (1 << DIRECTION_INDEX(d))) {
+            mazeGraphic->setWall(
+                opposingWall.x,
+                opposingWall.y,
+                opposingWall.d
+            );
+        }
+        else {
+            mazeGraphic->clearWall(
+                opposingWall.x,
+                opposingWall.y,
+                opposingWall.d
+            );
+        }
+    }
+}
+
+void SimulationEngine::setColor(int x, int y, QChar color) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (!IS_COLOR_CHAR(color)) {
+        return;
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+    m_view->getMazeGraphic()->setColor(x, y, CHAR_TO_COLOR(color));
+    m_tilesWithColor.insert({x, y});
+}
+
+void SimulationEngine::clearColor(int x, int y) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+    m_view->getMazeGraphic()->clearColor(x, y);
+}
+
+void SimulationEngine::clearAllColor() {
+    if (m_view == nullptr) {
+        return;
+    }
+    for (QPair<int, int> position : m_tilesWithColor.getTiles()) {
+        m_view->getMazeGraphic()->clearColor(position.first, position.second);
+    }
+    m_tilesWithColor.clear();
+}
+
+void SimulationEngine::setColorRect(
+        int x0,
+        int y0,
+        int x1,
+        int y1,
+        QChar color) {
+    if (!IS_COLOR_CHAR(color)) {
+        return;
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+    // The corners may be given in any order, and the rectangle is clipped to
+    // the maze, so that e.g. a border can be painted without bounds checks
+    int left = qMax(0, qMin(x0, x1));
+    int right = qMin(m_maze->getWidth() - 1, qMax(x0, x1));
+    int bottom = qMax(0, qMin(y0, y1));
+    int top = qMin(m_maze->getHeight() - 1, qMax(y0, y1));
+    Color value = CHAR_TO_COLOR(color);
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    for (int x = left; x <= right; x += 1) {
+        for (int y = bottom; y <= top; y += 1) {
+            mazeGraphic->setColor(x, y, value);
+            m_tilesWithColor.insert(x, y);
+        }
+    }
+}
+
+void SimulationEngine::setColorGrid(const QString& runs) {
+
+    // Each run is an optional count followed by a color character, or by
+    // NO_COLOR, and the runs cover the cells row by row, starting from the
+    // bottom left; the whole grid is decoded before any of it is applied, so
+    // that a malformed grid is ignored, like any other malformed command
+    int numCells = m_maze->getWidth() * m_maze->getHeight();
+    QVector<QChar> colors;
+    colors.reserve(numCells);
+    int count = -1;
+    for (QChar c : runs) {
+        if (c.isDigit()) {
+            count = qMax(count, 0) * 10 + c.digitValue();
+            if (numCells < count) {
+                return;
+            }
+            continue;
+        }
+        if (c == ' ' && count == -1) {
+            continue;
+        }
+        if (c != NO_COLOR && !IS_COLOR_CHAR(c)) {
+            return;
+        }
+        int length = count == -1 ? 1 : count;
+        if (numCells < colors.size() + length) {
+            return;
+        }
+        colors.insert(colors.size(), length, c);
+        count = -1;
+    }
+    if (count != -1) {
+        return;
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    int width = m_maze->getWidth();
+    for (int i = 0; i < colors.size(); i += 1) {
+        int x = i % width;
+        int y = i / width;
+        if (colors.at(i) == NO_COLOR) {
+            mazeGraphic->clearColor(x, y);
+            continue;
+        }
+        mazeGraphic->setColor(x, y, CHAR_TO_COLOR(colors.at(i)));
+        m_tilesWithColor.insert(x, y);
+    }
+}
+
+void SimulationEngine::setText(int x, int y, QString text) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (m_view == nullptr || m_isDistanceOverlayEnabled) {
+        return;
+    }
+    // Characters that aren't in the font image are displayed as '?'
+    for (int i = 0; i < text.size(); i += 1) {
+        if (!FontImage::isValid(text.at(i))) {
+            text[i] = '?';
+        }
+    }
+    m_view->getMazeGraphic()->setText(x, y, text);
+    m_tilesWithText.insert({x, y});
+}
+
+void SimulationEngine::clearText(int x, int y) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (m_view == nullptr || m_isDistanceOverlayEnabled) {
+        return;
+    }
+    m_view->getMazeGraphic()->clearText(x, y);
+}
+
+void SimulationEngine::setTextRow(int y, const QString& values) {
+    if (y < 0 || m_maze->getHeight() <= y) {
+        return;
+    }
+    if (m_view == nullptr) {
+        return;
+    }
+    // The values go in consecutive cells, starting from the left; any that
+    // don't fit in the maze are dropped
+    QVector<QStringRef> refs = values.splitRef(' ', QString::SkipEmptyParts);
+    int numValues = qMin(refs.size(), m_maze->getWidth());
+    for (int x = 0; x < numValues; x += 1) {
+        setText(x, y, refs.at(x).toString());
+    }
+}
+
+void SimulationEngine::clearAllText() {
+    if (m_view == nullptr || m_isDistanceOverlayEnabled) {
+        return;
+    }
+    for (QPair<int, int> position : m_tilesWithText.getTiles()) {
+        m_view->getMazeGraphic()->clearText(position.first, position.second);
+    }
+    m_tilesWithText.clear();
+}
+
+void SimulationEngine::setHeat(int x, int y, int heat) {
+    if (!isWithinMaze(x, y)) {
+        return;
+    }
+    if (heat < -1 || MAX_HEAT < heat) {
+        return;
+    }
+    if (m_view == nullptr || m_profileOverlay != ProfileMetric::NONE) {
+        return;
+    }
+    m_view->getMazeGraphic()->setHeat(x, y, heat);
+    m_tilesWithHeat.insert(x, y);
+}
+
+void SimulationEngine::setHeatRow(int y, const QString& values) {
+    if (y < 0 || m_maze->getHeight() <= y) {
+        return;
+    }
+
+    // Like a grid of colors, the whole row is parsed before any of it is
+    // applied, so that a malformed row is ignored
+    QVector<QStringRef> refs = values.splitRef(' ', QString::SkipEmptyParts);
+    int numValues = qMin(refs.size(), m_maze->getWidth());
+    QVector<int> heats;
+    heats.reserve(numValues);
+    for (int x = 0; x < numValues; x += 1) {
+        const QStringRef& ref = refs.at(x);
+        if (ref.size() == 1 && ref.at(0) == NO_COLOR) {
+            heats.append(-1);
+            continue;
+        }
+        bool ok = false;
+        int heat = ref.toInt(&ok);
+        if (!ok || heat < 0 || MAX_HEAT < heat) {
+            return;
+        }
+        heats.append(heat);
+    }
+    if (m_view == nullptr || m_profileOverlay != ProfileMetric::NONE) {
+        return;
+    }
+    MazeGraphic* mazeGraphic = m_view->getMazeGraphic();
+    for (int x = 0; x < heats.size(); x += 1) {
+        mazeGraphic->setHeat(x, y, heats.at(x));
+        m_tilesWithHeat.insert(x, y);
+    }
+}
+
+void SimulationEngine::clearAllHeat() {
+    if (m_view == nullptr || m_profileOverlay != ProfileMetric::NONE) {
+        return;
+    }
+    for (QPair<int, int> position : m_tilesWithHeat.getTiles()) {
+        m_view->getMazeGraphic()->clearHeat(position.first, position.second);
+    }
+    m_tilesWithHeat.clear();
+}
+
+bool SimulationEngine::wasReset() {
+    return m_wasReset;
+}
+
+void SimulationEngine::ackReset() {
+    m_mouse->reset();
+    resetMovement();
+    moveProfileCell(m_startingLocation);
+    m_trialSeconds.append(m_runTimeModel.getSeconds());
+    m_trialsCenterSeconds.append(m_trialCenterSeconds);
+    m_trialCenterSeconds = -1.0;
+    m_contestScorer.endTrial(m_runTimeModel.getSeconds());
+    m_runTimeModel = RunTimeModel(m_runTimeParameters);
+    m_wasReset = false;
+    changeDisplay();
+    emit resetAcknowledged();
+    updateContest();
+}
+
+QString SimulationEngine::hello() {
+    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
+    Direction direction = m_mouse->getCurrentDiscretizedRotation();
+    QStringList words = {
+        HELLO,
+        QString::number(PROTOCOL_VERSION),
+        QString::number(mazeWidth()),
+        QString::number(mazeHeight()),
+        QString::number(position.first),
+        QString::number(position.second),
+        QString(DIRECTION_TO_CHAR(direction)),
+        "bulk",
+        "runPath",
+        "asyncMoves",
+        "pushSensors",
+    };
+    if (m_isSharedMemoryAvailable) {
+        words.append("shm");
+    }
+    return words.join(" ");
+}
+
+QString SimulationEngine::nextMaze() {
+    if (m_hasClaimedMaze) {
+        return NO_MAZE;
+    }
+    m_hasClaimedMaze = true;
+    return QString("%1 %2").arg(
+        QString::number(m_maze->getWidth()),
+        QString::number(m_maze->getHeight())
+    );
+}
+
+QString SimulationEngine::boolToString(bool value) const {
+    return value ? TRUE_RESPONSE : FALSE_RESPONSE;
+}
+
+QString SimulationEngine::crashToString(QPair<int, int> blocked) const {
+    return QString("%1 %2 %3").arg(
+        CRASH,
+        QString::number(blocked.first),
+        QString::number(blocked.second)
+    );
+}
+
+bool SimulationEngine::isWall(Wall wall) const {
+    return m_maze->isWall(wall.x, wall.y, wall.d);
+}
+
+bool SimulationEngine::readWall(Wall wall) {
+    return m_sensorNoise.read(isWall(wall));
+}
+
+bool SimulationEngine::isWithinMaze(int x, int y) const {
+    return (
+        0 <= x && x < m_maze->getWidth() &&
+        0 <= y && y < m_maze->getHeight()
+    );
+}
+
+Wall SimulationEngine::getOpposingWall(Wall wall) const {
+    return {
+        wall.x + DIRECTION_DX(wall.d),
+        wall.y + DIRECTION_DY(wall.d),
+        DIRECTION_OPPOSITE(wall.d),
+    };
+}
+
+} 
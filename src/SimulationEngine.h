@@ -0,0 +1,752 @@
+#pragma once
+
+#include <memory>
+
+#include <QByteArray>
+#include <QChar>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+#include "AllocationCounter.h"
+#include "CellProfile.h"
+#include "CollisionDetector.h"
+#include "Command.h"
+#include "CoverageStats.h"
+#include "CommandLatency.h"
+#include "ContestScorer.h"
+#include "CommandTrace.h"
+#include "Direction.h"
+#include "DistanceSensors.h"
+#include "DynamicDistances.h"
+#include "KnownWalls.h"
+#include "Maze.h"
+#include "MazeGraphic.h"
+#include "MazeView.h"
+#include "MotionController.h"
+#include "MotionWorker.h"
+#include "Mouse.h"
+#include "MouseDefinition.h"
+#include "MouseDynamics.h"
+#include "Polygon.h"
+#include "RingQueue.h"
+#include "RunSummary.h"
+#include "RunTimeModel.h"
+#include "SensorNoise.h"
+#include "SimulationClock.h"
+#include "TileSet.h"
+
+namespace mms {
+
+enum class Movement {
+    MOVE_FORWARD,
+    TURN_RIGHT,
+    TURN_LEFT,
+    CURVE_RIGHT,
+    CURVE_LEFT,
+    CURVE_RIGHT_180,
+    CURVE_LEFT_180,
+    DIAGONAL_RIGHT,
+    DIAGONAL_LEFT,
+    NONE,
+};
+
+struct Wall {
+    int x;
+    int y;
+    Direction d;
+};
+
+// A move forward (by some number of cells) or a turn, as part of a path
+struct PathSegment {
+    Movement movement;
+    int numCells;
+};
+
+// Everything about an engine, and its view, that commands can change; only
+// taken while the mouse is at rest, with no commands queued
+struct EngineCheckpoint {
+    QPair<int, int> location;
+    Direction direction;
+    int numMoves;
+    int numTurns;
+    int numCrashes;
+    bool reachedCenter;
+    qint64 firstCenterTicks;
+    int firstCenterMoves;
+    RunTimeModel runTimeModel;
+    QVector<double> trialSeconds;
+    double trialCenterSeconds;
+    QVector<double> trialsCenterSeconds;
+    ContestScorer contestScorer;
+    bool isContestOver;
+    SensorNoise sensorNoise;
+    bool isAsyncMoves;
+    int numAsyncMoves;
+    bool isPushingSensors;
+    SimulationClock clock;
+    QVector<int> visitCounts;
+    CoverageStats coverage;
+    KnownWalls knownWalls;
+    QVector<CellProfile> cellProfile;
+    TileSet tilesWithColor;
+    TileSet tilesWithText;
+    TileSet tilesWithHeat;
+    MazeGraphic::State tiles;
+};
+
+class SimulationEngine : public QObject {
+
+    // The engine owns the mouse and implements the semantics of every command
+    // in the mouse API. It has no dependency on widgets or OpenGL, so it can
+    // drive an algorithm without a window. If a view is given, visualization
+    // commands are applied to it; otherwise they're validated and dropped.
+
+    Q_OBJECT
+
+public:
+
+    // No ownership of the maze or the view - only pointers
+    SimulationEngine(const Maze* maze, MazeView* view, QObject* parent = 0);
+    ~SimulationEngine();
+
+    static const double MIN_PROGRESS_PER_SECOND;
+    static const double MAX_PROGRESS_PER_SECOND;
+
+    // The response to nextMaze when there are no more mazes
+    static const QString NO_MAZE;
+
+    // The start of the response to a movement that ran into a wall
+    static const QString CRASH;
+
+    // The starts of the responses to asynchronous movements (once the
+    // algorithm has sent asyncMoves): right away, and once they're done
+    static const QString QUEUED;
+    static const QString DONE;
+
+    // The character that clears a cell in the runs of setColorGrid
+    static const QChar NO_COLOR;
+
+    // The first word of the response to hello, and the version of the
+    // protocol that follows it; the version only goes up when the meaning of
+    // an existing command changes, since new commands are capabilities
+    static const QString HELLO;
+    static const int PROTOCOL_VERSION;
+
+    // Goes up whenever a change to the engine (its movements, limits, run
+    // time model or scoring) could change the result of a run, so that runs
+    // memoized under an older version are run again (see ResultStore)
+    static const int RESULT_VERSION;
+
+    const Mouse* getMouse() const;
+
+    // Handles a single, complete line of algorithm output
+    void dispatchCommand(const QString& command);
+
+    // Handles a command that has already been parsed, e.g., off-thread; the
+    // timestamp is when its line was read, if that was before now
+    void dispatchCommand(
+        const Command& parsed,
+        const CommandSpec* spec,
+        double receivedTimestamp = -1.0);
+
+    // Does a command right away, and returns its response, which is empty
+    // for commands without one, or if the engine stopped along the way; only
+    // for instant engines that aren't continuous, with nothing queued, e.g.,
+    // for algorithms that are called directly rather than over a pipe
+    QString executeNow(const Command& parsed, const CommandSpec* spec);
+
+    // Responses are held back between these, and emitted together at the
+    // end, e.g., around every command that was read at once; flushing emits
+    // whatever is held back right away, e.g., before the algorithm is sent
+    // anything that doesn't come from the engine
+    void beginResponseBatch();
+    void endResponseBatch();
+    void flushResponses();
+
+    // Paused engines hold on to queued commands until resumed
+    void setPaused(bool paused);
+    bool isPaused() const;
+
+    // Simulates a press of the reset button
+    void requestReset();
+
+    // Sets the rate at which movements progress
+    void setProgressPerSecond(double progressPerSecond);
+
+    // Instant movements complete as soon as they're executed, without any
+    // animation; the rate at which movements progress is ignored
+    void setInstant(bool instant);
+    bool isInstant() const;
+
+    // Records the cells that the mouse enters, in order, from then on; the
+    // trail isn't part of checkpoints, so restoring one clears it
+    void setTrailEnabled(bool enabled);
+    QVector<QPair<int, int>> getTrail() const;
+
+    // Makes every movement instant, whatever setInstant says, for as long
+    // as the mouse enters the given cells in order, e.g., the trail of an
+    // earlier run of the same algorithm, so that a run can skip ahead to
+    // where an earlier one was; once the mouse has entered every one of
+    // them, or any other cell instead of the next one, fastForwardEnded is
+    // emitted, and the movement in progress is the last one that's instant
+    void setFastForward(const QVector<QPair<int, int>>& cells);
+    bool isFastForwarding() const;
+
+    // Continuous movements follow the dynamics of a real mouse, stepped with
+    // a fixed timestep, rather than progressing at a constant rate: animated
+    // ones play out in real time (ignoring the rate), and instant ones are
+    // stepped to completion at once. Takes effect from the next movement.
+    void setContinuous(bool continuous);
+    bool isContinuous() const;
+
+    // The simulated time of every continuous movement so far
+    double getSimulatedSeconds() const;
+
+    // The simulated time of every movement so far, whether or not it was
+    // animated or continuous; each movement advances the clock by a fixed
+    // number of ticks once it's complete, so two runs of the same algorithm
+    // read the same time, however fast the machines that they ran on
+    const SimulationClock& getClock() const;
+
+    // Once a movement takes the clock past the limit (if it isn't negative),
+    // tickLimitReached is emitted, just once
+    void setTickLimit(qint64 ticks);
+
+    // Once the algorithm sends more commands than the command limit, or the
+    // mouse makes more moves than the move limit (if they aren't negative),
+    // stepLimitReached is emitted, just once; the command that goes over the
+    // limit isn't executed
+    void setCommandLimit(qint64 commands);
+    void setMoveLimit(int moves);
+
+    // The distance (in meters) seen by each of the default distance sensors,
+    // as of the latest timestep of a continuous movement, or else for the
+    // mouse's current pose
+    QVector<double> getSensorReadings() const;
+
+    // Where the mouse's body overlaps the walls of the tiles around it, as of
+    // the latest timestep of a continuous movement, or else right now
+    QVector<Contact> getContacts() const;
+
+    // Bounds the commands that may be queued at once (if the limit is
+    // positive); the engine queues whatever it's given regardless, so it's
+    // up to the caller to stop dispatching commands with responses while
+    // the queue is full, and to pick up again on queueReady
+    void setQueueLimit(int limit);
+    int getQueueLimit() const;
+    bool isQueueFull() const;
+
+    // Whether the algorithm was given shared memory to talk through (see
+    // SharedMemoryTransport), as advertised in the response to hello
+    void setSharedMemoryAvailable(bool available);
+
+    // Drops all queued commands; the engine won't respond after this
+    void stop();
+
+    // Records every command, and every response, to the given trace; no
+    // ownership, and the trace must outlive the engine (or be unset)
+    void setTrace(CommandTrace* trace);
+
+    // Records the latency of every command to the given histograms; no
+    // ownership, and they must outlive the engine (or be unset)
+    void setLatency(CommandLatency* latency);
+
+    // The allocations made while executing each kind of command, indexed by
+    // opcode, while the allocation counter is enabled (see AllocationCounter)
+    const QVector<AllocationCounts>& getCommandAllocations() const;
+    static QString commandAllocationsToString(
+        const QVector<AllocationCounts>& allocations);
+
+    // Takes the state of an engine at rest, and returns to it later, e.g.,
+    // to seek within a replay without starting over
+    EngineCheckpoint getCheckpoint() const;
+    void restoreCheckpoint(const EngineCheckpoint& checkpoint);
+
+    // Statistics about completed movements
+    int getNumMoves() const;
+    int getNumTurns() const;
+    int getNumCrashes() const; // movements refused because of a wall
+    qint64 getNumCommands() const; // of every kind, since the engine started
+    int getNumQueuedCommands() const; // waiting behind the current movement
+    int getMaxQueuedCommands() const; // the most that ever were at once
+    bool hasReachedCenter() const;
+
+    // Which cells the mouse has visited, and how often, over the whole run
+    // (i.e., across resets)
+    CoverageStats getCoverage() const;
+    int getVisitCount(int x, int y) const;
+    static QString coverageToString(const CoverageStats& coverage);
+
+    // Which walls the algorithm has declared, with setWall, clearWall and
+    // their bulk versions, and which of those declarations are wrong, as of
+    // its latest declaration of each wall; kept whether or not there's a
+    // view, so that headless runs can report them too. Each wrong wall is
+    // listed once, from the cell to the south or west of it, except on the
+    // edges of the maze.
+    KnownWallStats getKnownWallStats() const;
+    QVector<Wall> getWrongWalls() const;
+    static QString knownWallsToString(const KnownWallStats& stats);
+
+    // Where the run has spent its time and its commands, and how often the
+    // mouse entered each cell, over the whole run (see CellProfile), by
+    // cell index (x * height + y); the time of the cell that the mouse is
+    // in runs up to now
+    QVector<CellProfile> getCellProfile() const;
+
+    // The statistics above, and when the mouse reached the center, as of now
+    RunSummary getSummary() const;
+    static QString summaryToString(const RunSummary& summary);
+
+    // Fogs every tile of the view that the mouse hasn't visited yet, and
+    // clears the fog from each tile as the mouse first enters it
+    void setFogEnabled(bool enabled);
+    bool isFogEnabled() const;
+
+    // Writes, as the text of every tile of the view, its distance in cells
+    // to the center, through the walls that the algorithm has declared (and
+    // any that it hasn't, i.e., as a flood fill would), kept up to date as
+    // walls are declared; while it's enabled, the algorithm's own text isn't
+    // displayed, and disabling it clears the text of every tile
+    void setDistanceOverlayEnabled(bool enabled);
+    bool isDistanceOverlayEnabled() const;
+
+    // Shows one metric of the cell profile as the heat of every tile of the
+    // view, relative to the largest value of any tile, as of the last time
+    // that it was refreshed; while it's shown, the algorithm's own heat isn't
+    // displayed, and hiding it clears the heat of every tile
+    void setProfileOverlay(ProfileMetric metric);
+    ProfileMetric getProfileOverlay() const;
+    void refreshProfileOverlay();
+
+    // The estimated time that a real mouse would take to make the movements
+    // of each trial (i.e., the movements between resets), with the current
+    // trial last; the parameters take effect from the next trial
+    void setRunTimeParameters(const RunTimeParameters& parameters);
+    QVector<double> getEstimatedTrialSeconds() const;
+
+    // The shape of the mouse and its sensors, which are shared (and never
+    // reparsed) by every engine with the same definition; to be set before
+    // the run starts
+    void setMouseDefinition(
+        std::shared_ptr<const MouseDefinition> definition);
+
+    // Misreads the walls that wallFront, wallRight, wallLeft and walls read
+    // (see SensorNoise), with every reading drawn from the noise's stream,
+    // which carries on from trial to trial; movements still crash into the
+    // walls that are really there. To be set before the run starts.
+    void setSensorNoise(const SensorNoise& noise);
+
+    // The score of the run so far as a contest, by the given rules (see
+    // ContestScorer), which take effect from the start of the run; every
+    // reset is a touch, and the maze time is the run's estimated time
+    void setContestRules(const ContestRules& rules);
+    ContestScore getContestScore() const;
+
+signals:
+
+    // Emitted with responses that should be sent to the algorithm, already
+    // encoded (see LineFramer), and how many there are; the responses of a
+    // slice of queued commands, and of a dispatch (or batch of them), are
+    // emitted together, so that they can be sent with a single write
+    void responsesReady(const QByteArray& bytes, int numResponses);
+
+    // Emitted once the algorithm has acknowledged a requested reset
+    void resetAcknowledged();
+
+    // Emitted the first time the mouse completes a move into the center
+    void centerReached();
+
+    // Emitted once, as soon as no more runs of the contest can count
+    void contestOver();
+
+    // Emitted once a fast-forward is over, with the number of its cells that
+    // the mouse entered, and whether it left them for some other cell
+    void fastForwardEnded(int numCells, bool hasDiverged);
+
+    // Emitted whenever the mouse moves or the view changes, i.e., whenever
+    // a map that shows them needs to be repainted; changes to the view are
+    // coalesced, and the signal comes once their snapshot is published
+    void displayChanged();
+
+    void tickLimitReached();
+    void stepLimitReached();
+
+    // Emitted whenever a full queue (see setQueueLimit) gets room again
+    void queueReady();
+
+private:
+
+    // ----- Objects -----
+
+    const Maze* m_maze;
+    MazeView* m_view;
+    Mouse* m_mouse;
+    CommandTrace* m_trace;
+    CommandLatency* m_latency;
+
+    // ----- State -----
+
+    QVector<AllocationCounts> m_commandAllocations;
+
+    bool m_isPaused;
+    bool m_wasReset;
+    bool m_isStopped;
+
+    // ----- Communication -----
+
+    static const QString ACK;
+    static const QString INVALID;
+
+    // The responses to queries are built once, since copying a QString only
+    // shares its storage, so that answering one never allocates
+    static const QString TRUE_RESPONSE;
+    static const QString FALSE_RESPONSE;
+    static const QString WALLS_RESPONSES[16];
+
+    // Queued commands are processed for at most PROCESSING_SLICE_SECONDS at
+    // a time; the rest are processed on the next turn of the event loop
+    static const double PROCESSING_SLICE_SECONDS;
+
+    // Each queued command, already parsed, with when it was received and
+    // dispatched, and its sequence number; the queue's slots are reused, so
+    // queueing and dequeueing commands doesn't allocate
+    struct QueuedCommand {
+        Command command;
+        double receivedTimestamp;
+        double dispatchedTimestamp;
+        int sequenceNumber;
+    };
+    static const int INITIAL_QUEUE_CAPACITY;
+    RingQueue<QueuedCommand> m_commandQueue;
+    QTimer* m_commandQueueTimer;
+    int m_queueLimit;
+    int m_maxQueuedCommands;
+
+    // The responses that haven't been emitted yet, encoded one after the
+    // other into a buffer that's reused; they're emitted at the end of every
+    // slice and every dispatch, unless they're being batched
+    QByteArray m_responseBytes;
+    int m_numResponses;
+    bool m_isBatchingResponses;
+    void respond(const QString& response);
+    void flushUnbatchedResponses();
+
+    // Every change to the display within a turn of the event loop is
+    // published to the view's snapshot, and signaled, just once, and not
+    // within MIN_DISPLAY_SECONDS of the last publish; the map can't show
+    // them any sooner, and every publish is followed by a copy of whichever
+    // buffers change next, so a storm of changes costs a bounded number of
+    // copies per second
+    static const double MIN_DISPLAY_SECONDS;
+    QTimer* m_displayTimer;
+    double m_displayTimestamp;
+    void changeDisplay();
+    void publishDisplay();
+
+    // When each queued command was received and dispatched, and when the
+    // command at the head of the queue started executing; all zero unless
+    // latency is being recorded
+    double m_headStartedTimestamp;
+    void clearCommandQueue();
+
+    // Once the algorithm opts in, movements don't block it: each one is
+    // answered as soon as it's queued, with its sequence number (counting
+    // the asynchronous movements from one), and again once it's done, with
+    // its sequence number in front of whatever it would have been answered
+    // with; the sequence number of each queued command is zero if it isn't
+    // an asynchronous movement
+    bool m_isAsyncMoves;
+    int m_numAsyncMoves;
+    static bool isMovement(Opcode opcode);
+    QString toAsyncResponse(const QString& response, int sequenceNumber) const;
+
+    // Once the algorithm subscribes, the ack of every completed movement
+    // carries what the mouse would otherwise have to ask for next: its cell,
+    // its heading and the walls around it, e.g., "ack 0 1 n 9"
+    bool m_isPushingSensors;
+    QString toSensorResponse(const QString& response, Opcode opcode);
+
+    QString executeCommand(const Command& command);
+    void executeInlineCommand(const Command& command);
+    void processQueuedCommands();
+    void processCommandSlice();
+
+    // ----- Movement -----
+
+    static const double PROGRESS_REQUIRED_FOR_MOVE;
+    static const double PROGRESS_REQUIRED_FOR_TURN;
+
+    // Movements that aren't continuous take one tick of the simulation clock
+    // for every PROGRESS_PER_TICK of progress (or part thereof); how quickly
+    // they play out is only a matter of the progress per second, which
+    // merely paces the animation
+    static const double PROGRESS_PER_TICK;
+
+    QPair<int, int> m_startingLocation;
+    Direction m_startingDirection;
+    Movement m_movement;
+    // The rest of the path that's being run, if any, one segment after
+    // another, without responding in between
+    QVector<PathSegment> m_pathSegments;
+    int m_movementCells;
+    // The direction of every step from tile to tile of a curve or diagonal
+    QVector<Direction> m_movementPath;
+    double m_movementProgress;
+    double m_movementStepSize;
+    double m_movementStepTimestamp;
+    double m_progressPerSecond;
+    bool m_isInstant;
+
+    // The cells entered so far, if they're recorded, and the cells of the
+    // fast-forward, with the index of the next one to enter, or -1
+    bool m_isTrailEnabled;
+    QVector<QPair<int, int>> m_trail;
+    QVector<QPair<int, int>> m_fastForwardCells;
+    int m_fastForwardIndex;
+    bool isMovingInstantly() const;
+    void followFastForward(QPair<int, int> position);
+
+    // The clock is advanced by the length of the movement in progress once
+    // it's complete; the length is fixed when the movement is executed
+    SimulationClock m_clock;
+    qint64 m_tickLimit;
+    qint64 m_movementTicks;
+    qint64 getMovementTicks();
+    void advanceClock();
+
+    int m_numMoves;
+    int m_numTurns;
+    int m_numCrashes;
+    bool m_reachedCenter;
+    qint64 m_firstCenterTicks;
+    int m_firstCenterMoves;
+
+    // Step budgets aren't part of checkpoints, since they bound the work
+    // that the algorithm does, not the state of the maze
+    qint64 m_numCommands;
+    qint64 m_commandLimit;
+    int m_moveLimit;
+    bool m_isStepLimitReached;
+    void reachStepLimit();
+
+    // Counts a command, and returns false if it's over the command limit
+    bool countCommand();
+
+    // The number of times that each cell was entered, by column
+    QVector<int> m_visitCounts;
+    CoverageStats m_coverage;
+    KnownWalls m_knownWalls;
+    bool m_isFogEnabled;
+    int getCellIndex(int x, int y) const;
+    void updateFog();
+
+    // The distances of the overlay, through the declared walls, which are
+    // kept up to date as walls are declared, and the cells whose distances
+    // changed since the overlay was last written, which are the only ones
+    // that are rewritten when the display is published. A stale overlay is
+    // searched again from the view's walls, and rewritten whole, e.g., once
+    // the view's tiles were restored from a checkpoint.
+    bool m_isDistanceOverlayEnabled;
+    bool m_isDistanceOverlayStale;
+    DynamicDistances m_overlayDistances;
+    QVector<int> m_overlayChanged;
+    void invalidateDistanceOverlay();
+    void updateDistanceOverlay();
+    void updateDistanceOverlayWall(int x, int y, Direction d, bool isWall);
+
+    // The cell profile, without the visits, which are the visit counts, and
+    // the cell that time and commands go to, with when the mouse entered it
+    QVector<CellProfile> m_cellProfile;
+    int m_profileCell;
+    double m_profileTimestamp;
+    ProfileMetric m_profileOverlay;
+    void moveProfileCell(QPair<int, int> position);
+    bool isStart(QPair<int, int> position) const;
+    bool isCenter(QPair<int, int> position) const;
+    void reachStart();
+    void reachTrialCenter();
+
+    // The estimated time of the current trial, and of every one before it,
+    // along with when each one first reached the center, or -1
+    RunTimeParameters m_runTimeParameters;
+    RunTimeModel m_runTimeModel;
+    QVector<double> m_trialSeconds;
+    double m_trialCenterSeconds;
+    QVector<double> m_trialsCenterSeconds;
+    ContestScorer m_contestScorer;
+    bool m_isContestOver;
+    void updateContest();
+
+    // Only ever applied to what the algorithm is told
+    SensorNoise m_sensorNoise;
+    bool readWall(Wall wall);
+
+    double progressRequired(Movement movement);
+    void updateMouseProgress(double progress);
+    void scheduleMouseProgressUpdate();
+
+    // Stops the mouse where it's drawn, partway through the step that it's
+    // animating, so that the rest of the movement can be scheduled anew;
+    // returns false if there was no such step, or it's about to complete
+    bool freezeMouseProgress();
+    bool isMoving();
+    void resetMovement();
+
+    // Readies the movement that was just set up (by a command, or by the
+    // next segment of a path) to progress, and fixes its length in ticks
+    void beginMovement();
+    // Returns false if there are no more segments of the path to start
+    bool startNextPathSegment();
+    void onMovementCompleted(
+        Movement movement,
+        QPair<int, int> origin,
+        const QVector<Direction>& path);
+    void enterTile(QPair<int, int> position);
+
+    // ----- Continuous movement -----
+
+    // Animated continuous movements are stepped by a worker on the motion
+    // thread (only created once it's needed), and polled for their progress
+    // every CONTINUOUS_POLL_MS; the motion number tells the current movement
+    // apart from any that were abandoned
+    static const int CONTINUOUS_POLL_MS;
+    bool m_isContinuous;
+    bool m_isMovementContinuous;
+    MouseDynamics m_dynamics;
+    QThread* m_motionThread;
+    MotionWorker* m_motionWorker;
+    int m_motionNumber;
+    double m_simulatedSeconds;
+
+    // The length (in meters) or angle (in radians, counterclockwise) of the
+    // movement that was just executed
+    double getMovementAmount();
+    void startContinuousMovement();
+
+    // The simulated time of the movement, stepped to completion at once;
+    // animated movements take just as many timesteps, however they're paced
+    double simulateMovement();
+    double getContinuousProgress();
+    void stopContinuousMovement();
+
+    // The collision hull of the mouse's body, in its own frame, for the
+    // motion worker
+    Polygon getBody() const;
+
+    // ----- API -----
+
+    int mazeWidth();
+    int mazeHeight();
+
+    bool wallFront();
+    bool wallRight();
+    bool wallLeft();
+
+    // Bits of the response to "walls", relative to the mouse's heading
+    static const int WALL_MASK_FRONT;
+    static const int WALL_MASK_RIGHT;
+    static const int WALL_MASK_BACK;
+    static const int WALL_MASK_LEFT;
+    int walls();
+
+    // Returns false, and the cell whose front wall is in the way, if the
+    // mouse can't move numCells cells straight ahead
+    bool moveForward(int numCells, QPair<int, int>* blocked);
+    void turnRight();
+    void turnLeft();
+
+    // Curves sweep around the post ahead and to the side, with a radius of
+    // half a tile, into the tile diagonally ahead (or, for a 180 degree
+    // curve, the tile beside the mouse). Diagonals enter numCells tiles,
+    // alternately ahead and to the side, with a 45 degree turn at either end.
+    // Both check every wall along the way up front, like moveForward.
+    bool curve(Movement movement, QPair<int, int>* blocked);
+    bool diagonal(Movement movement, int numCells, QPair<int, int>* blocked);
+    bool startPath(
+        Movement movement,
+        const QVector<Direction>& path,
+        QPair<int, int>* blocked);
+    int getQuarterTurns(Movement movement, int numCells) const;
+
+    // The movement in progress, as the mouse follows it
+    MotionPrimitive getMotionPrimitive() const;
+
+    // Runs a whole path of moves forward and turns, e.g., "F5 R F3 L F2",
+    // which is checked against the walls up front, and then driven, segment
+    // after segment, as a single movement; returns the response to a crash,
+    // with the index of the segment that crashed, if any segment would, or
+    // INVALID if the path is malformed
+    QString runPath(const QString& moves);
+    static bool parsePath(const QString& moves, QVector<PathSegment>* path);
+    void addPathToRunTimeModel(Movement movement, int numCells);
+
+    void setWall(int x, int y, QChar direction);
+    void clearWall(int x, int y, QChar direction);
+
+    // Bulk versions of setWall and clearWall, for algorithms that declare
+    // much of their wall map at once: every wall of a cell, or of a row of
+    // cells, from a mask with a bit for each direction (1 for north, 2 for
+    // east, 4 for south and 8 for west), along with the opposing walls of
+    // the neighboring cells; rows are hexadecimal digits, one for each cell
+    void setWalls(int x, int y, int mask);
+    void setWallRow(int y, const QString& masks);
+    void declareWalls(int x, int y, unsigned char mask);
+
+    void setColor(int x, int y, QChar color);
+    void clearColor(int x, int y);
+    void clearAllColor();
+
+    // Bulk versions of setColor and setText, for algorithms that repaint
+    // much of the maze at once; each is a single command, applied in a
+    // single pass, rather than one command per cell
+    void setColorRect(int x0, int y0, int x1, int y1, QChar color);
+    void setColorGrid(const QString& runs);
+
+    void setText(int x, int y, QString text);
+    void clearText(int x, int y);
+    void clearAllText();
+    void setTextRow(int y, const QString& values);
+
+    // The heatmap; a heat, from 0 to MAX_HEAT, replaces the tile's color,
+    // and a heat of NO_COLOR (in a row) or -1 (on its own) clears it
+    static const int MAX_HEAT;
+    void setHeat(int x, int y, int heat);
+    void setHeatRow(int y, const QString& values);
+    void clearAllHeat();
+
+    bool wasReset();
+    void ackReset();
+
+    // Everything that an algorithm would otherwise have to ask for, or
+    // probe for, before it starts: the protocol version, the maze's size,
+    // the mouse's pose, and the optional commands and transports that it
+    // may use, e.g., "mms 1 16 16 0 0 n bulk runPath asyncMoves"
+    bool m_isSharedMemoryAvailable;
+    QString hello();
+
+    // An engine only ever has the one maze, which the first request claims;
+    // running several mazes in one process is up to the engine's owner
+    bool m_hasClaimedMaze;
+    QString nextMaze();
+
+    // ----- Helpers -----
+
+    // The tiles that may have color or text; clearing a single tile leaves it
+    // in the set, since clearing it again when all are cleared is harmless,
+    // and clearing all only visits the tiles that were ever set since
+    TileSet m_tilesWithColor;
+    TileSet m_tilesWithText;
+    TileSet m_tilesWithHeat;
+
+    QString boolToString(bool value) const;
+    QString crashToString(QPair<int, int> blocked) const;
+    bool isWall(Wall wall) const;
+    bool isWithinMaze(int x, int y) const;
+    Wall getOpposingWall(Wall wall) const;
+};
+
+} 
@@ -0,0 +1,236 @@
+#include "SoftwareMapRenderer.h"
+
+#include <QPainter>
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+
+#include "AssertMacros.h"
+#include "Color.h"
+#include "ColorManager.h"
+#include "Dimensions.h"
+#include "Direction.h"
+#include "MouseInstance.h"
+#include "TransformationMatrix.h"
+
+namespace mms {
+
+SoftwareMapRenderer::SoftwareMapRenderer(int width, int height) :
+    m_width(width),
+    m_height(height),
+    m_maze(nullptr),
+    m_view(nullptr),
+    m_mouseGraphic(nullptr),
+    m_mouseTriangles(QVector<TriangleGraphic>()) {
+}
+
+RenderBackend SoftwareMapRenderer::getBackend() const {
+    return RenderBackend::SOFTWARE;
+}
+
+void SoftwareMapRenderer::setMaze(const Maze* maze) {
+    m_maze = maze;
+}
+
+void SoftwareMapRenderer::setView(const MazeView* view) {
+    m_view = view;
+}
+
+void SoftwareMapRenderer::setMouseGraphic(const MouseGraphic* mouseGraphic) {
+    m_mouseGraphic = mouseGraphic;
+    m_mouseTriangles.clear();
+    if (m_mouseGraphic != nullptr) {
+        m_mouseGraphic->draw(&m_mouseTriangles);
+    }
+}
+
+QImage SoftwareMapRenderer::render() {
+
+    QImage image(m_width, m_height, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    if (m_maze == nullptr || m_view == nullptr) {
+        return image;
+    }
+
+    QPainter painter(&image);
+    painter.setTransform(getTransform());
+    painter.setPen(Qt::NoPen);
+
+    bool isNew = false;
+    const QVector<TileInstance>& tiles =
+        m_view->takeSnapshot(&isNew).tileInstances;
+    double tileLength = Dimensions::tileLength().getMeters();
+    double halfWallWidth = Dimensions::halfWallWidth().getMeters();
+    for (const TileInstance& tile : tiles) {
+        painter.fillRect(
+            QRectF(
+                tile.x * tileLength,
+                tile.y * tileLength,
+                tileLength,
+                tileLength
+            ),
+            getFogged(getBaseColor(tile), tile)
+        );
+    }
+
+    // Each wall that two tiles share is drawn by the tile south or west of
+    // it, and the walls on the west and south edges by the first column and
+    // row; the alpha of each level is the tile program's
+    static const int WALL_ALPHAS[] = {0, 64, 255, 0};
+    RGB wallRgb = COLOR_TO_RGB(ColorManager::getTileWallColor());
+    RGB cornerRgb = COLOR_TO_RGB(ColorManager::getTileCornerColor());
+    for (const TileInstance& tile : tiles) {
+        double left = tile.x * tileLength;
+        double bottom = tile.y * tileLength;
+        for (int i = 0; i < NUM_DIRECTIONS; i += 1) {
+            Direction direction = static_cast<Direction>(i);
+            bool isDrawn =
+                direction == Direction::NORTH ||
+                direction == Direction::EAST ||
+                (direction == Direction::WEST && tile.x == 0) ||
+                (direction == Direction::SOUTH && tile.y == 0);
+            int level = (tile.walls >> (2 * i)) & 3;
+            if (!isDrawn || WALL_ALPHAS[level] == 0) {
+                continue;
+            }
+            QRectF wall;
+            bool isHorizontal =
+                direction == Direction::NORTH ||
+                direction == Direction::SOUTH;
+            if (isHorizontal) {
+                double y = direction == Direction::NORTH
+                    ? bottom + tileLength
+                    : bottom;
+                wall = QRectF(
+                    left + halfWallWidth,
+                    y - halfWallWidth,
+                    tileLength - 2 * halfWallWidth,
+                    2 * halfWallWidth
+                );
+            }
+            else {
+                double x = direction == Direction::EAST
+                    ? left + tileLength
+                    : left;
+                wall = QRectF(
+                    x - halfWallWidth,
+                    bottom + halfWallWidth,
+                    2 * halfWallWidth,
+                    tileLength - 2 * halfWallWidth
+                );
+            }
+            QColor color(wallRgb.r, wallRgb.g, wallRgb.b, WALL_ALPHAS[level]);
+            painter.fillRect(wall, getFogged(color, tile));
+        }
+
+        // Every tile draws the peg at its northeast corner, and those of the
+        // first column and row draw the pegs along the edges
+        QColor peg =
+            getFogged(QColor(cornerRgb.r, cornerRgb.g, cornerRgb.b), tile);
+        QVector<QPointF> corners;
+        corners.append(QPointF(left + tileLength, bottom + tileLength));
+        if (tile.x == 0) {
+            corners.append(QPointF(left, bottom + tileLength));
+        }
+        if (tile.y == 0) {
+            corners.append(QPointF(left + tileLength, bottom));
+        }
+        if (tile.x == 0 && tile.y == 0) {
+            corners.append(QPointF(left, bottom));
+        }
+        for (const QPointF& corner : corners) {
+            painter.fillRect(
+                QRectF(
+                    corner.x() - halfWallWidth,
+                    corner.y() - halfWallWidth,
+                    2 * halfWallWidth,
+                    2 * halfWallWidth
+                ),
+                peg
+            );
+        }
+    }
+
+    // The mouse mesh, rotated and then translated by its instance
+    if (m_mouseGraphic != nullptr) {
+        painter.setRenderHint(QPainter::Antialiasing);
+        MouseInstance instance = m_mouseGraphic->getInstance(1.0);
+        for (const TriangleGraphic& triangle : m_mouseTriangles) {
+            QPolygonF polygon;
+            for (const VertexGraphic* vertex :
+                    {&triangle.p1, &triangle.p2, &triangle.p3}) {
+                polygon.append(QPointF(
+                    instance.cosine * vertex->x - instance.sine * vertex->y +
+                        instance.x,
+                    instance.sine * vertex->x + instance.cosine * vertex->y +
+                        instance.y
+                ));
+            }
+            const VertexGraphic& first = triangle.p1;
+            painter.setBrush(QColor(
+                first.rgb.r,
+                first.rgb.g,
+                first.rgb.b,
+                qRound(first.a * instance.alpha)
+            ));
+            painter.drawPolygon(polygon);
+        }
+    }
+    return image;
+}
+
+QTransform SoftwareMapRenderer::getTransform() const {
+    ASSERT_FA(m_maze == nullptr);
+
+    // The whole maze, as the map shows it once its camera is reset, in
+    // physical coordinates, with rows going up
+    double pixelsPerMeter = TransformationMatrix::getPixelsPerMeter(
+        m_maze->getWidth(),
+        m_maze->getHeight(),
+        m_width,
+        m_height,
+        1.0
+    );
+    Coordinate center = TransformationMatrix::getMazeCenter(
+        m_maze->getWidth(),
+        m_maze->getHeight()
+    );
+    QTransform transform;
+    transform.translate(0.5 * m_width, 0.5 * m_height);
+    transform.scale(pixelsPerMeter, -pixelsPerMeter);
+    transform.translate(
+        -center.getX().getMeters(),
+        -center.getY().getMeters()
+    );
+    return transform;
+}
+
+QColor SoftwareMapRenderer::getBaseColor(const TileInstance& tile) {
+
+    // Heat is mapped from blue, through green, to red, as in the tile
+    // program
+    if (tile.flags & TileInstance::FLAG_HEAT) {
+        double heat = tile.heat / 255.0;
+        auto channel = [heat](double peak) {
+            double value = 1.5 - qAbs(4.0 * heat - peak);
+            return qRound(255 * qBound(0.0, value, 1.0));
+        };
+        return QColor(channel(3.0), channel(2.0), channel(1.0));
+    }
+    RGB rgb = COLOR_TO_RGB(static_cast<Color>(tile.color));
+    return QColor(rgb.r, rgb.g, rgb.b);
+}
+
+QColor SoftwareMapRenderer::getFogged(QColor color, const TileInstance& tile) {
+    if (tile.flags & TileInstance::FLAG_FOG) {
+        color.setRgb(
+            color.red() / 2,
+            color.green() / 2,
+            color.blue() / 2,
+            color.alpha()
+        );
+    }
+    return color;
+}
+
+} 
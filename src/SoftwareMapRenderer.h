@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QColor>
+#include <QImage>
+#include <QTransform>
+#include <QVector>
+
+#include "MapRenderer.h"
+#include "TileInstance.h"
+#include "TriangleGraphic.h"
+
+namespace mms {
+
+class SoftwareMapRenderer : public MapRenderer {
+
+    // Rasterizes the tile records of the view's snapshots and the mouse
+    // mesh with a QPainter, the way the tile and polygon programs draw them:
+    // first the bases of every tile, in their colors (or their heat), then
+    // the walls at their levels and the pegs, darkened by fog, and then the
+    // mouse, moved to its current pose
+
+public:
+
+    SoftwareMapRenderer(int width, int height);
+
+    RenderBackend getBackend() const;
+    void setMaze(const Maze* maze);
+    void setView(const MazeView* view);
+    void setMouseGraphic(const MouseGraphic* mouseGraphic);
+    QImage render();
+
+    // From physical coordinates, in meters, to the pixels of the rendered
+    // image, e.g., to draw more on top of it
+    QTransform getTransform() const;
+
+private:
+
+    int m_width;
+    int m_height;
+
+    // No ownership here - only pointers
+    const Maze* m_maze;
+    const MazeView* m_view;
+    const MouseGraphic* m_mouseGraphic;
+
+    // The mouse mesh is drawn once, at its initial pose, as in the map
+    QVector<TriangleGraphic> m_mouseTriangles;
+
+    static QColor getBaseColor(const TileInstance& tile);
+    static QColor getFogged(QColor color, const TileInstance& tile);
+
+};
+
+} 
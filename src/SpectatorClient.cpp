@@ -0,0 +1,259 @@
+#include "SpectatorClient.h"
+
+#include <QDebug>
+#include <QTimer>
+
+#include "Direction.h"
+#include "MazeError.h"
+#include "SpectatorServer.h"
+#include "ViewDelta.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+const int SpectatorClient::RECONNECT_MILLISECONDS = 5000;
+
+SpectatorClient* SpectatorClient::create(
+        const QString& address,
+        Map* map,
+        QObject* parent) {
+    int colon = address.lastIndexOf(':');
+    bool portOk = false;
+    quint16 port = address.mid(colon + 1).toUShort(&portOk);
+    if (colon < 1 || !portOk || port == 0) {
+        return nullptr;
+    }
+    return new SpectatorClient(address.left(colon), port, map, parent);
+}
+
+SpectatorClient::SpectatorClient(
+        const QString& host,
+        quint16 port,
+        Map* map,
+        QObject* parent) :
+    QObject(parent),
+    m_host(host),
+    m_port(port),
+    m_socket(new QTcpSocket(this)),
+    m_isHeaderRead(false),
+    m_map(map),
+    m_maze(nullptr),
+    m_view(nullptr),
+    m_mouse(Mouse()),
+    m_mouseGraphic(&m_mouse) {
+    connect(
+        m_socket,
+        &QTcpSocket::readyRead,
+        this,
+        &SpectatorClient::onReadyRead
+    );
+    // Failing to connect never emits disconnected, but always ends up here
+    connect(
+        m_socket,
+        &QAbstractSocket::stateChanged,
+        this,
+        [=](QAbstractSocket::SocketState state){
+            if (state == QAbstractSocket::UnconnectedState) {
+                onDisconnected();
+            }
+        }
+    );
+}
+
+SpectatorClient::~SpectatorClient() {
+    setMaze(nullptr);
+}
+
+void SpectatorClient::connectToServer() {
+    m_socket->connectToHost(m_host, m_port);
+}
+
+void SpectatorClient::onReadyRead() {
+    m_framer.append(m_socket->readAll());
+    const char* data = nullptr;
+    int size = 0;
+    while (m_framer.nextLine(&data, &size)) {
+        QByteArray line(data, size);
+        if (!readLine(line)) {
+            qWarning().noquote().nospace()
+                << "Unexpected line from " << m_host << ":" << m_port
+                << ": " << line;
+            m_socket->abort();
+            return;
+        }
+    }
+
+    // Everything that was read is drawn at once
+    if (m_view != nullptr) {
+        m_view->publishSnapshot();
+    }
+    m_map->update();
+}
+
+void SpectatorClient::onDisconnected() {
+    qWarning().noquote().nospace()
+        << (m_isHeaderRead ? "Lost " : "Couldn't connect to ")
+        << m_host << ":" << m_port << ": " << m_socket->errorString();
+    m_isHeaderRead = false;
+    m_framer.clear();
+    QTimer::singleShot(
+        RECONNECT_MILLISECONDS,
+        this,
+        &SpectatorClient::connectToServer
+    );
+}
+
+bool SpectatorClient::readLine(const QByteArray& line) {
+    if (!m_isHeaderRead) {
+        m_isHeaderRead = line == SpectatorServer::HEADER;
+        if (m_isHeaderRead) {
+            qInfo().noquote().nospace()
+                << "Spectating " << m_host << ":" << m_port;
+        }
+        return m_isHeaderRead;
+    }
+    QList<QByteArray> fields = line.split(' ');
+    QByteArray type = fields.takeFirst();
+    if (type == "maze") {
+        return readMaze(fields);
+    }
+    // Tiles and the mouse only ever follow a maze
+    if (m_maze == nullptr) {
+        return false;
+    }
+    if (type == "tiles") {
+        return readTiles(fields);
+    }
+    if (type == "mouse") {
+        return readMouse(fields);
+    }
+    return false;
+}
+
+bool SpectatorClient::readMaze(const QList<QByteArray>& fields) {
+    if (fields.size() != 3) {
+        return false;
+    }
+    bool widthOk = false;
+    bool heightOk = false;
+    int width = fields.at(0).toInt(&widthOk);
+    int height = fields.at(1).toInt(&heightOk);
+    if (!widthOk || !heightOk || width < 1 || height < 1) {
+        return false;
+    }
+
+    // The size of the walls is checked before anything is allocated for
+    // them, and what they make up is checked like any other maze
+    QByteArray bytes = QByteArray::fromHex(fields.at(2));
+    if (bytes.size() != (static_cast<qint64>(width) * height + 1) / 2) {
+        return false;
+    }
+    WallGrid walls(
+        width,
+        height,
+        reinterpret_cast<const unsigned char*>(bytes.constData())
+    );
+    MazeError error;
+    Maze* maze = Maze::fromWalls(walls, &error);
+    if (maze == nullptr) {
+        qWarning().noquote()
+            << "Invalid maze:" << Maze::errorToString(error);
+        return false;
+    }
+    setMaze(maze);
+    return true;
+}
+
+bool SpectatorClient::readTiles(const QList<QByteArray>& fields) {
+    return fields.size() == 1 && ViewDelta::apply(
+        QByteArray::fromBase64(fields.at(0)),
+        m_maze->getWidth(),
+        m_maze->getHeight(),
+        m_view->getMazeGraphic()
+    );
+}
+
+bool SpectatorClient::readMouse(const QList<QByteArray>& fields) {
+    if (fields.size() != 8 || fields.at(2).size() != 1) {
+        return false;
+    }
+    if (fields.at(3).size() != 1) {
+        return false;
+    }
+    bool ok[7] = {false, false, false, false, false, false, false};
+    QPair<int, int> location = {
+        fields.at(0).toInt(&ok[0]),
+        fields.at(1).toInt(&ok[1])
+    };
+    char direction = fields.at(2).at(0);
+    int type = QByteArray("stcd").indexOf(fields.at(3).at(0));
+    MotionPrimitive primitive = {
+        MotionPrimitive::STRAIGHT,
+        fields.at(4).toInt(&ok[2]),
+        fields.at(5).toInt(&ok[3])
+    };
+    ok[4] = type != -1 || (
+        fields.at(3) == "-" && primitive.cells == 0 && primitive.bend == 0
+    );
+    double fraction = fields.at(6).toDouble(&ok[5]);
+    double fractionPerSecond = fields.at(7).toDouble(&ok[6]);
+    for (bool isOk : ok) {
+        if (!isOk) {
+            return false;
+        }
+    }
+    if (type != -1) {
+        primitive.type = static_cast<MotionPrimitive::Type>(type);
+    }
+    if (
+        !isWithinMaze(location) ||
+        !IS_DIRECTION_CHAR(direction) ||
+        (type != -1 && !MotionController::isValid(primitive)) ||
+        m_maze->getWidth() + m_maze->getHeight() < primitive.cells ||
+        !(0.0 <= fraction && fraction <= 1.0) ||
+        !(0.0 <= fractionPerSecond)
+    ) {
+        return false;
+    }
+    m_mouse.teleport(location, CHAR_TO_DIRECTION(direction));
+    if (type == -1) {
+        return true;
+    }
+
+    // The movement has to end within the maze, like any the engine starts
+    m_mouse.setMovement(primitive, fraction);
+    if (!isWithinMaze(m_mouse.getDestination())) {
+        m_mouse.teleport(location, CHAR_TO_DIRECTION(direction));
+        return false;
+    }
+    if (0.0 < fractionPerSecond) {
+        m_mouse.animate(fractionPerSecond);
+    }
+    return true;
+}
+
+bool SpectatorClient::isWithinMaze(QPair<int, int> cell) const {
+    return (
+        0 <= cell.first && cell.first < m_maze->getWidth() &&
+        0 <= cell.second && cell.second < m_maze->getHeight()
+    );
+}
+
+void SpectatorClient::setMaze(Maze* maze) {
+    m_map->setMouseGraphic(nullptr);
+    m_map->setMaze(nullptr);
+    delete m_view;
+    delete m_maze;
+    m_view = nullptr;
+    m_maze = maze;
+    m_mouse.reset();
+    if (m_maze == nullptr) {
+        return;
+    }
+    m_view = new MazeView(m_maze);
+    m_map->setMaze(m_maze);
+    m_map->setView(m_view);
+    m_map->setMouseGraphic(&m_mouseGraphic);
+}
+
+} 
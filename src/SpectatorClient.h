@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QTcpSocket>
+
+#include "LineFramer.h"
+#include "Map.h"
+#include "Maze.h"
+#include "MazeView.h"
+#include "Mouse.h"
+#include "MouseGraphic.h"
+
+namespace mms {
+
+class SpectatorClient : public QObject {
+
+    // Watches a run that's streamed by a SpectatorServer, read-only, on a
+    // map: the client keeps a maze, a view and a mouse of its own, applies
+    // the lines of the stream to them, and animates the mouse locally. A
+    // line that doesn't parse ends the connection; once it's lost, the last
+    // state stays on the map, and the client reconnects every
+    // RECONNECT_MILLISECONDS.
+
+    Q_OBJECT
+
+public:
+
+    // Returns nullptr if the address isn't host:port; no ownership of the map
+    static SpectatorClient* create(
+        const QString& address,
+        Map* map,
+        QObject* parent = 0);
+    ~SpectatorClient();
+
+    void connectToServer();
+
+private:
+
+    static const int RECONNECT_MILLISECONDS;
+
+    SpectatorClient(
+        const QString& host,
+        quint16 port,
+        Map* map,
+        QObject* parent);
+
+    QString m_host;
+    quint16 m_port;
+    QTcpSocket* m_socket;
+    LineFramer m_framer;
+    bool m_isHeaderRead;
+
+    Map* m_map;
+    Maze* m_maze;
+    MazeView* m_view;
+    Mouse m_mouse;
+    MouseGraphic m_mouseGraphic;
+
+    void onReadyRead();
+    void onDisconnected();
+
+    // Returns false if the line isn't valid
+    bool readLine(const QByteArray& line);
+    bool readMaze(const QList<QByteArray>& fields);
+    bool readTiles(const QList<QByteArray>& fields);
+    bool readMouse(const QList<QByteArray>& fields);
+    bool isWithinMaze(QPair<int, int> cell) const;
+
+    // Shows the maze instead of the current one, if any; takes ownership
+    void setMaze(Maze* maze);
+
+};
+
+} 
@@ -0,0 +1,184 @@
+#include "SpectatorServer.h"
+
+#include <QDebug>
+#include <QHostAddress>
+
+#include "ColorManager.h"
+#include "Direction.h"
+#include "ViewDelta.h"
+
+namespace mms {
+
+const QByteArray SpectatorServer::HEADER = "mms-spectator 2";
+const int SpectatorServer::BROADCAST_MS = 50;
+const qint64 SpectatorServer::MAX_PENDING_BYTES = 1024 * 1024;
+
+SpectatorServer::SpectatorServer(QObject* parent) :
+    QObject(parent),
+    m_server(new QTcpServer(this)),
+    m_broadcastTimer(new QTimer(this)),
+    m_maze(nullptr),
+    m_view(nullptr),
+    m_mouse(nullptr) {
+    connect(
+        m_server,
+        &QTcpServer::newConnection,
+        this,
+        &SpectatorServer::onNewConnection
+    );
+    m_broadcastTimer->setSingleShot(true);
+    connect(
+        m_broadcastTimer,
+        &QTimer::timeout,
+        this,
+        &SpectatorServer::broadcast
+    );
+}
+
+bool SpectatorServer::listen(quint16 port) {
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qWarning().noquote().nospace()
+            << "Unable to serve spectators on port " << port << ": "
+            << m_server->errorString();
+        return false;
+    }
+    qInfo().noquote().nospace()
+        << "Serving spectators on port " << m_server->serverPort();
+    return true;
+}
+
+void SpectatorServer::setRun(
+        const Maze* maze,
+        MazeView* view,
+        const Mouse* mouse) {
+
+    // Spectators see the end of the run that's replaced, if it changed
+    // since the last broadcast
+    broadcast();
+    m_maze = maze;
+    m_view = view;
+    m_mouse = mouse;
+    m_tiles.clear();
+    if (m_maze == nullptr) {
+        return;
+    }
+
+    // Spectators start the new run from a blank maze, like the view did
+    m_tiles.fill(getBlankTile(), m_maze->getWidth() * m_maze->getHeight());
+    QByteArray maze = getMazeLine();
+    const QVector<QTcpSocket*> spectators = m_spectators;
+    for (QTcpSocket* spectator : spectators) {
+        send(spectator, maze);
+    }
+    broadcast();
+}
+
+void SpectatorServer::update() {
+    if (m_maze != nullptr && !m_broadcastTimer->isActive()) {
+        m_broadcastTimer->start(BROADCAST_MS);
+    }
+}
+
+void SpectatorServer::onNewConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* spectator = m_server->nextPendingConnection();
+        connect(spectator, &QTcpSocket::disconnected, this, [=](){
+            m_spectators.removeOne(spectator);
+            spectator->deleteLater();
+        });
+
+        // Whatever changed since the last broadcast is sent to everyone
+        // else first, so that the tiles are as they were last sent
+        broadcast();
+        QByteArray snapshot = HEADER + "\n";
+        if (m_maze != nullptr) {
+            snapshot += getMazeLine();
+            ViewDelta delta;
+            TileState blank = getBlankTile();
+            for (int i = 0; i < m_tiles.size(); i += 1) {
+                delta.setDifference(i, blank, m_tiles.at(i));
+            }
+            snapshot += getTilesLine(delta);
+            snapshot += getMouseLine();
+        }
+        m_spectators.append(spectator);
+        send(spectator, snapshot);
+    }
+}
+
+void SpectatorServer::broadcast() {
+    m_broadcastTimer->stop();
+    if (m_maze == nullptr) {
+        return;
+    }
+    ViewDelta delta;
+    const MazeGraphic* graphic = m_view->getMazeGraphic();
+    for (int x = 0; x < m_maze->getWidth(); x += 1) {
+        for (int y = 0; y < m_maze->getHeight(); y += 1) {
+            int index = x * m_maze->getHeight() + y;
+            TileState tile = graphic->getTileState(x, y);
+            if (tile != m_tiles.at(index)) {
+                delta.setDifference(index, m_tiles.at(index), tile);
+                m_tiles[index] = tile;
+            }
+        }
+    }
+    QByteArray lines = getTilesLine(delta) + getMouseLine();
+
+    // Spectators that are dropped leave the list as they disconnect
+    const QVector<QTcpSocket*> spectators = m_spectators;
+    for (QTcpSocket* spectator : spectators) {
+        send(spectator, lines);
+    }
+}
+
+void SpectatorServer::send(QTcpSocket* spectator, const QByteArray& bytes) {
+    if (MAX_PENDING_BYTES < spectator->bytesToWrite()) {
+        qWarning().noquote().nospace()
+            << "Dropped spectator " << spectator->peerAddress().toString()
+            << ", which fell behind";
+        spectator->abort();
+        return;
+    }
+    spectator->write(bytes);
+}
+
+QByteArray SpectatorServer::getMazeLine() const {
+    QByteArray bytes = m_maze->getWalls().toBytes();
+    return "maze " + QByteArray::number(m_maze->getWidth()) + " " +
+        QByteArray::number(m_maze->getHeight()) + " " + bytes.toHex() + "\n";
+}
+
+QByteArray SpectatorServer::getTilesLine(const ViewDelta& delta) {
+    if (delta.isEmpty()) {
+        return QByteArray();
+    }
+    return "tiles " + delta.encode().toBase64() + "\n";
+}
+
+QByteArray SpectatorServer::getMouseLine() const {
+    QPair<int, int> location = m_mouse->getCurrentDiscretizedTranslation();
+    char direction = DIRECTION_TO_CHAR(
+        m_mouse->getCurrentDiscretizedRotation());
+    const MotionController& motion = m_mouse->getMotion();
+    MotionPrimitive primitive = {MotionPrimitive::STRAIGHT, 0, 0};
+    char type = '-';
+    if (0 < motion.getSize()) {
+        primitive = motion.getPrimitive(0);
+        type = "stcd"[primitive.type];
+    }
+    return "mouse " + QByteArray::number(location.first) + " " +
+        QByteArray::number(location.second) + " " + QByteArray(1, direction) +
+        " " + QByteArray(1, type) +
+        " " + QByteArray::number(primitive.cells) +
+        " " + QByteArray::number(primitive.bend) +
+        " " + QByteArray::number(m_mouse->getFraction(), 'g', 6) +
+        " " + QByteArray::number(m_mouse->getFractionPerSecond(), 'g', 6) +
+        "\n";
+}
+
+TileState SpectatorServer::getBlankTile() {
+    return {0, ColorManager::getTileBaseColor(), QString(), -1};
+}
+
+} 
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QVector>
+
+#include "Maze.h"
+#include "MazeView.h"
+#include "Mouse.h"
+#include "TileGraphic.h"
+#include "ViewDelta.h"
+
+namespace mms {
+
+class SpectatorServer : public QObject {
+
+    // Streams the run in the window to read-only spectators (see
+    // SpectatorClient) over TCP, as lines of text: the walls of the maze
+    // once, then only the tiles that changed (see ViewDelta), and the
+    // movement of the mouse, which spectators animate on their own (see
+    // Mouse::animate), so that a spectator costs a few bytes for every
+    // movement rather than a video stream. Changes are
+    // sent at most every BROADCAST_MS, with each tile as it was changed to
+    // last, and a spectator that joins late is sent every tile that isn't
+    // blank first. Spectators that fall behind by more than MAX_PENDING_BYTES
+    // are dropped, rather than buffered for. Fog isn't streamed, so
+    // spectators always see the whole maze.
+
+    Q_OBJECT
+
+public:
+
+    SpectatorServer(QObject* parent = 0);
+
+    // Returns false if the port can't be listened on
+    bool listen(quint16 port);
+
+    // The run to stream, or nullptrs for none; no ownership of any of them,
+    // which are to be kept until the run is replaced
+    void setRun(const Maze* maze, MazeView* view, const Mouse* mouse);
+
+    // To be called whenever the run's view or mouse changes
+    void update();
+
+    // The first line of every stream, with the version of the format
+    static const QByteArray HEADER;
+
+private:
+
+    static const int BROADCAST_MS;
+    static const qint64 MAX_PENDING_BYTES;
+
+    QTcpServer* m_server;
+    QVector<QTcpSocket*> m_spectators;
+    QTimer* m_broadcastTimer;
+
+    const Maze* m_maze;
+    MazeView* m_view;
+    const Mouse* m_mouse;
+
+    // Every tile as it was last sent, by index x * height + y
+    QVector<TileState> m_tiles;
+
+    void onNewConnection();
+    void broadcast();
+    void send(QTcpSocket* spectator, const QByteArray& bytes);
+
+    // "maze <width> <height> <walls>", with the walls as the hex of their
+    // packed bytes (see WallGrid); "tiles <delta>", with the delta in
+    // base64, or nothing if it's empty; and "mouse <x> <y> <direction>
+    // <primitive> <cells> <bend> <fraction> <fraction per second>", with the
+    // type of the movement's motion primitive as one of "stcd", or "-" for
+    // none (see MotionPrimitive)
+    QByteArray getMazeLine() const;
+    static QByteArray getTilesLine(const ViewDelta& delta);
+    QByteArray getMouseLine() const;
+    static TileState getBlankTile();
+
+};
+
+} 
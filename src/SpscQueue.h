@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+
+#include <QVector>
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+template<class T>
+class SpscQueue {
+
+    // A bounded, lock-free queue for exactly one producer thread and exactly
+    // one consumer thread. Indices run freely and wrap around; the capacity
+    // must be a power of two so that wrapping doesn't skip any slots.
+
+public:
+
+    SpscQueue(int capacity);
+
+    // Producer only; returns false if the queue is full
+    bool push(const T& value);
+
+    // Consumer only; returns false if the queue is empty
+    bool pop(T* value);
+
+private:
+
+    // The slots are only ever accessed through the raw pointer, so neither
+    // thread can trigger a (non-thread-safe) detach of the vector
+    QVector<T> m_slots;
+    T* m_data;
+    unsigned int m_mask;
+    std::atomic<unsigned int> m_read;
+    std::atomic<unsigned int> m_write;
+
+};
+
+template<class T>
+SpscQueue<T>::SpscQueue(int capacity) :
+    m_slots(capacity),
+    m_data(m_slots.data()),
+    m_mask(static_cast<unsigned int>(capacity) - 1),
+    m_read(0),
+    m_write(0) {
+    ASSERT_LT(0, capacity);
+    ASSERT_EQ(capacity & (capacity - 1), 0);
+}
+
+template<class T>
+bool SpscQueue<T>::push(const T& value) {
+    unsigned int write = m_write.load(std::memory_order_relaxed);
+    unsigned int read = m_read.load(std::memory_order_acquire);
+    if (write - read > m_mask) {
+        return false;
+    }
+    m_data[write & m_mask] = value;
+    m_write.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool SpscQueue<T>::pop(T* value) {
+    unsigned int read = m_read.load(std::memory_order_relaxed);
+    unsigned int write = m_write.load(std::memory_order_acquire);
+    if (read == write) {
+        return false;
+    }
+    *value = m_data[read & m_mask];
+    m_read.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+} 
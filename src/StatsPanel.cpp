@@ -0,0 +1,173 @@
+#include "StatsPanel.h"
+
+#include <QFontDatabase>
+#include <QGridLayout>
+
+namespace mms {
+
+StatsPanel::StatsPanel(QWidget* parent) :
+    QGroupBox("Stats", parent),
+    m_commandsPerSecond(nullptr),
+    m_queuedCommands(nullptr),
+    m_framesPerSecond(nullptr),
+    m_paintMilliseconds(nullptr),
+    m_cpuPercent(nullptr),
+    m_movesAndTurns(nullptr),
+    m_knownWalls(nullptr),
+    m_contestScore(nullptr),
+    m_mazeSeconds(nullptr),
+    m_bytesPerSecond(nullptr),
+    m_frameAllocations(nullptr),
+    m_commandAllocations(nullptr),
+    m_previous(StatsSample()),
+    m_hasPrevious(false) {
+
+    setLayout(new QGridLayout());
+    m_commandsPerSecond = addRow(0, 0, "cmd/s");
+    m_queuedCommands = addRow(1, 0, "queued");
+    m_cpuPercent = addRow(2, 0, "cpu");
+    m_commandAllocations = addRow(3, 0, "allocs/cmd");
+    m_knownWalls = addRow(4, 0, "walls");
+    m_bytesPerSecond = addRow(0, 1, "pipe");
+    m_movesAndTurns = addRow(1, 1, "moves");
+    m_framesPerSecond = addRow(2, 1, "fps");
+    m_paintMilliseconds = addRow(3, 1, "paint");
+    m_frameAllocations = addRow(4, 1, "allocs");
+    m_contestScore = addRow(5, 0, "score");
+    m_mazeSeconds = addRow(5, 1, "maze");
+}
+
+void StatsPanel::addSample(const StatsSample& sample) {
+
+    // Rates need two samples, and counters restart with each run
+    double seconds = sample.timestamp - m_previous.timestamp;
+    bool hasRates = m_hasPrevious && 0.0 < seconds;
+    bool hasRunRates = (
+        hasRates &&
+        sample.isRunning &&
+        m_previous.isRunning &&
+        m_previous.commands <= sample.commands
+    );
+
+    m_framesPerSecond->setText(rateToString(
+        hasRates ? (sample.frame - m_previous.frame) / seconds : -1.0,
+        1
+    ));
+    m_paintMilliseconds->setText(
+        0 < sample.frame
+        ? QString::number(sample.paintSeconds * 1000.0, 'f', 2) + " ms"
+        : "-"
+    );
+    m_commandsPerSecond->setText(rateToString(
+        hasRunRates ? (sample.commands - m_previous.commands) / seconds : -1.0,
+        0
+    ));
+    m_bytesPerSecond->setText(
+        hasRunRates
+        ? QString::number(
+            (sample.bytes - m_previous.bytes) / seconds / 1024.0, 'f', 1
+          ) + " KiB/s"
+        : "-"
+    );
+    bool hasCpu = (
+        hasRunRates &&
+        0.0 <= sample.cpuSeconds &&
+        0.0 <= m_previous.cpuSeconds
+    );
+    m_cpuPercent->setText(
+        hasCpu
+        ? QString::number(
+            100.0 * (sample.cpuSeconds - m_previous.cpuSeconds) / seconds,
+            'f', 0
+          ) + "%"
+        : "-"
+    );
+    m_frameAllocations->setText(
+        0 < sample.frame && 0 <= sample.frameAllocations
+        ? QString("%1 / %2 B").arg(sample.frameAllocations).arg(
+            sample.frameAllocatedBytes
+          )
+        : "-"
+    );
+    qint64 commandsCounted =
+        sample.commandsCounted - m_previous.commandsCounted;
+    bool hasCommandAllocations = (
+        hasRunRates &&
+        sample.isCountingAllocations &&
+        m_previous.isCountingAllocations &&
+        0 < commandsCounted
+    );
+    m_commandAllocations->setText(rateToString(
+        hasCommandAllocations
+        ? static_cast<double>(
+            sample.commandAllocations - m_previous.commandAllocations
+          ) / commandsCounted
+        : -1.0,
+        1
+    ));
+    m_queuedCommands->setText(
+        sample.isRunning
+        ? QString("%1 / %2").arg(sample.queuedCommands).arg(
+            sample.maxQueuedCommands)
+        : "-"
+    );
+    m_movesAndTurns->setText(
+        sample.isRunning
+        ? QString("%1 / %2").arg(sample.moves).arg(sample.turns)
+        : "-"
+    );
+
+    // The share of the walls known, and how many of them are wrong
+    const KnownWallStats& walls = sample.knownWalls;
+    m_knownWalls->setText(
+        sample.isRunning && 0 < walls.numWalls
+        ? QString("%1% / %2").arg(
+            QString::number(100.0 * walls.numKnown / walls.numWalls, 'f', 0)
+          ).arg(walls.numWrong)
+        : "-"
+    );
+
+    // The contest's best score so far, by which run, and its maze time
+    const ContestScore& contest = sample.contest;
+    m_contestScore->setText(
+        sample.isRunning
+        ? (
+            0 <= contest.bestRun
+            ? QString("%1 s (%2)").arg(
+                QString::number(contest.score, 'f', 2)
+              ).arg(contest.bestRun + 1)
+            : QString("none (%1)").arg(contest.numRuns)
+          )
+        : "-"
+    );
+    m_mazeSeconds->setText(
+        sample.isRunning
+        ? QString::number(contest.mazeSeconds, 'f', 1) + " s" +
+            (contest.isOver ? ", over" : "")
+        : "-"
+    );
+
+    m_previous = sample;
+    m_hasPrevious = true;
+}
+
+QLabel* StatsPanel::addRow(int row, int column, const QString& name) {
+    QGridLayout* grid = static_cast<QGridLayout*>(layout());
+    QLabel* nameLabel = new QLabel(name);
+    nameLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    QLabel* valueLabel = new QLabel("-");
+    valueLabel->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    valueLabel->setMinimumWidth(90);
+    grid->addWidget(nameLabel, row, 2 * column);
+    grid->addWidget(valueLabel, row, 2 * column + 1);
+    return valueLabel;
+}
+
+QString StatsPanel::rateToString(double rate, int precision) {
+    if (rate < 0.0) {
+        return "-";
+    }
+    return QString::number(rate, 'f', precision);
+}
+
+} 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QGroupBox>
+#include <QLabel>
+#include <QString>
+
+#include "ContestScorer.h"
+#include "KnownWalls.h"
+
+namespace mms {
+
+// Cumulative counters, as read at a single moment; rates are the change in
+// them from one sample to the next
+struct StatsSample {
+    double timestamp;
+    int frame; // paints of the map so far
+    double paintSeconds; // of the most recent paint
+    qint64 frameAllocations; // of the most recent paint, or negative
+    qint64 frameAllocatedBytes;
+    bool isRunning; // whether the rest of the sample means anything
+    qint64 commands;
+    int queuedCommands;
+    int maxQueuedCommands; // the most that ever were at once
+    double cpuSeconds; // of the algorithm's process, or negative
+    int moves;
+    int turns;
+    qint64 bytes; // in and out of the algorithm's pipes
+    KnownWallStats knownWalls;
+    ContestScore contest;
+    bool isCountingAllocations;
+    qint64 commandAllocations; // made while executing commands
+    qint64 commandsCounted; // commands executed while counting
+};
+
+class StatsPanel : public QGroupBox {
+
+    // Live statistics of the map and of the current run, each updated from
+    // the difference between the latest two samples; values of the run are
+    // dashes while nothing is running
+
+    Q_OBJECT
+
+public:
+
+    StatsPanel(QWidget* parent = 0);
+
+    void addSample(const StatsSample& sample);
+
+private:
+
+    QLabel* m_commandsPerSecond;
+    QLabel* m_queuedCommands;
+    QLabel* m_framesPerSecond;
+    QLabel* m_paintMilliseconds;
+    QLabel* m_cpuPercent;
+    QLabel* m_movesAndTurns;
+    QLabel* m_knownWalls;
+    QLabel* m_contestScore;
+    QLabel* m_mazeSeconds;
+    QLabel* m_bytesPerSecond;
+    QLabel* m_frameAllocations;
+    QLabel* m_commandAllocations;
+
+    StatsSample m_previous;
+    bool m_hasPrevious;
+
+    QLabel* addRow(int row, int column, const QString& name);
+    static QString rateToString(double rate, int precision);
+
+};
+
+} 
@@ -0,0 +1,172 @@
+#include "SyntheticAlgo.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include <QMap>
+#include <QStringList>
+
+namespace mms {
+
+namespace {
+
+// Commands that have a response are flushed, and answered, right away; the
+// others are buffered until then, or until the end
+class Protocol {
+
+public:
+
+    Protocol() : m_numCommands(0), m_isOver(false) {
+    }
+
+    qint64 getNumCommands() const {
+        return m_numCommands;
+    }
+
+    // Whether the simulator has gone away
+    bool isOver() const {
+        return m_isOver;
+    }
+
+    void send(const char* command) {
+        m_numCommands += 1;
+        if (std::fputs(command, stdout) < 0 || std::fputc('\n', stdout) < 0) {
+            m_isOver = true;
+        }
+    }
+
+    // Returns the response to the command, or an empty string if there is
+    // none, e.g., because the simulator has gone away
+    QString ask(const char* command) {
+        send(command);
+        std::fflush(stdout);
+        char line[64];
+        if (std::fgets(line, sizeof(line), stdin) == nullptr) {
+            m_isOver = true;
+            return "";
+        }
+        line[std::strcspn(line, "\r\n")] = '\0';
+        return QString(line);
+    }
+
+    void finish() {
+        std::fflush(stdout);
+    }
+
+private:
+
+    qint64 m_numCommands;
+    bool m_isOver;
+
+};
+
+}
+
+const QString SyntheticAlgo::DEFAULT_MIX =
+    "sensors=4, turns=1, moves=1, colors=4, texts=4";
+
+bool SyntheticAlgo::parseMix(
+        const QString& text,
+        SyntheticMix* mix,
+        QString* error) {
+    QMap<QString, int*> weights = {
+        {"sensors", &mix->sensors},
+        {"turns", &mix->turns},
+        {"moves", &mix->moves},
+        {"colors", &mix->colors},
+        {"texts", &mix->texts},
+    };
+    for (int* weight : weights) {
+        *weight = 0;
+    }
+    int total = 0;
+    for (const QString& part : text.split(',', QString::SkipEmptyParts)) {
+        QStringList pair = part.trimmed().split('=');
+        bool ok = false;
+        int weight = pair.value(1).trimmed().toInt(&ok);
+        QString kind = pair.value(0).trimmed();
+        if (pair.size() != 2 || !weights.contains(kind) || !ok || weight < 0) {
+            *error = QString("Invalid part of the mix: \"%1\"").arg(
+                part.trimmed()
+            );
+            return false;
+        }
+        *weights.value(kind) = weight;
+        total += weight;
+    }
+    if (total == 0) {
+        *error = "Every weight of the mix is zero";
+        return false;
+    }
+    return true;
+}
+
+int SyntheticAlgo::run(
+        const SyntheticMix& mix,
+        qint64 commands,
+        quint32 seed) {
+    Protocol protocol;
+    int width = protocol.ask("mazeWidth").toInt();
+    int height = protocol.ask("mazeHeight").toInt();
+    if (protocol.isOver() || width < 1 || height < 1) {
+        return 1;
+    }
+
+    std::minstd_rand random(seed);
+    std::discrete_distribution<int> kinds({
+        static_cast<double>(mix.sensors),
+        static_cast<double>(mix.turns),
+        static_cast<double>(mix.moves),
+        static_cast<double>(mix.colors),
+        static_cast<double>(mix.texts),
+    });
+    static const char* const SENSORS[] = {"wallFront", "wallRight", "wallLeft"};
+    static const char COLORS[] = "rgbycaw";
+    char command[64];
+
+    while (protocol.getNumCommands() < commands && !protocol.isOver()) {
+        int x = static_cast<int>(random() % width);
+        int y = static_cast<int>(random() % height);
+        switch (kinds(random)) {
+            case 0:
+                protocol.ask(SENSORS[random() % 3]);
+                break;
+            case 1:
+                protocol.ask("turnRight");
+                break;
+            case 2:
+                if (protocol.ask("wallFront") == "false") {
+                    protocol.ask("moveForward");
+                }
+                else {
+                    protocol.ask("turnLeft");
+                }
+                break;
+            case 3:
+                std::snprintf(
+                    command,
+                    sizeof(command),
+                    "setColor %d %d %c",
+                    x,
+                    y,
+                    COLORS[random() % (sizeof(COLORS) - 1)]);
+                protocol.send(command);
+                break;
+            case 4:
+                std::snprintf(
+                    command,
+                    sizeof(command),
+                    "setText %d %d %u",
+                    x,
+                    y,
+                    static_cast<unsigned>(random() % 1000));
+                protocol.send(command);
+                break;
+        }
+    }
+    protocol.finish();
+    return 0;
+}
+
+} 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+namespace mms {
+
+// How often each kind of step is taken, relative to the others
+struct SyntheticMix {
+    int sensors; // one of wallFront, wallRight or wallLeft
+    int turns; // turnRight
+    int moves; // wallFront, then moveForward if it's open, else turnLeft
+    int colors; // setColor of a random cell
+    int texts; // setText of a random cell
+};
+
+class SyntheticAlgo {
+
+    // A built-in algorithm that does nothing but send commands, for timing
+    // the protocol end to end: it talks to the simulator over stdin and
+    // stdout, like any other algorithm, taking random steps in proportion
+    // to the mix until it has sent the given number of commands, and then
+    // exits. It writes as much as it can before it needs an answer, just
+    // like a real algorithm should, so that storms of setColor and setText
+    // arrive as fast as they're made. The steps only depend on the seed, and
+    // on the walls that the mouse sees, so that two runs on the same maze
+    // send the same commands.
+
+public:
+
+    SyntheticAlgo() = delete;
+
+    static const QString DEFAULT_MIX;
+
+    // A mix is a comma-separated list of "<kind>=<weight>", e.g.
+    // "sensors=4, colors=8"; kinds that aren't listed have zero weight.
+    // Returns false, and why, if it's malformed or every weight is zero.
+    static bool parseMix(
+        const QString& text,
+        SyntheticMix* mix,
+        QString* error);
+
+    // Returns the process's exit code
+    static int run(const SyntheticMix& mix, qint64 commands, quint32 seed);
+
+};
+
+} 
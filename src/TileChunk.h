@@ -0,0 +1,16 @@
+#pragma once
+
+namespace mms {
+
+// A rectangle of tiles whose records are contiguous in the tile instance
+// buffer, so that the whole rectangle can be drawn, or skipped, at once
+struct TileChunk {
+    int x; // x position of the lower left tile
+    int y; // y position of the lower left tile
+    int width; // number of tiles across
+    int height; // number of tiles up
+    int begin; // index of the first record of the chunk
+    int end; // index one past the last record of the chunk
+};
+
+} 
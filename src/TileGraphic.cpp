@@ -5,10 +5,35 @@
 #include "AssertMacros.h"
 #include "Color.h"
 #include "ColorManager.h"
-#include "FontImage.h"
+#include "Profiler.h"
+#include "TileInstance.h"
 
 namespace mms {
 
+const unsigned char TileGraphic::WALL_LEVELS[4] = {
+    TileInstance::WALL_LEVEL_NONE,
+    TileInstance::WALL_LEVEL_HIDDEN,
+    TileInstance::WALL_LEVEL_DECLARED,
+    TileInstance::WALL_LEVEL_DECLARED,
+};
+
+const unsigned char TileGraphic::STALE_COLOR = 1;
+const unsigned char TileGraphic::STALE_TEXT = 2;
+const unsigned char TileGraphic::STALE_HEAT = 4;
+
+bool TileState::operator==(const TileState& other) const {
+    return (
+        declaredWalls == other.declaredWalls &&
+        color == other.color &&
+        text == other.text &&
+        heat == other.heat
+    );
+}
+
+bool TileState::operator!=(const TileState& other) const {
+    return !(*this == other);
+}
+
 TileGraphic::TileGraphic() {
     ASSERT_NEVER_RUNS();
 }
@@ -18,86 +43,184 @@ TileGraphic::TileGraphic(
     BufferInterface* bufferInterface) :
     m_tile(tile),
     m_bufferInterface(bufferInterface),
-    m_color(ColorManager::getTileBaseColor()) {
+    m_declaredWalls(0),
+    m_trueWalls(0),
+    m_color(ColorManager::getTileBaseColor()),
+    m_fog(false),
+    m_heat(-1),
+    m_stale(0) {
+    // The maze only changes while it's being edited, so its walls are
+    // looked up once, and again only when refreshed
+    for (Direction direction : DIRECTIONS) {
+        if (m_tile->isWall(direction)) {
+            m_trueWalls |= 1 << DIRECTION_INDEX(direction);
+        }
+    }
 }
 
 void TileGraphic::setWall(Direction direction) {
-    m_walls[direction] = true;
+    unsigned char bit = 1 << DIRECTION_INDEX(direction);
+    if (m_declaredWalls & bit) {
+        return;
+    }
+    m_declaredWalls |= bit;
     updateWall(direction);
 }
 
 void TileGraphic::clearWall(Direction direction) {
-    m_walls.remove(direction);
+    unsigned char bit = 1 << DIRECTION_INDEX(direction);
+    if (!(m_declaredWalls & bit)) {
+        return;
+    }
+    m_declaredWalls &= ~bit;
     updateWall(direction);
 }
 
-void TileGraphic::setColor(Color color) {
+void TileGraphic::setWalls(unsigned char mask) {
+    unsigned char changed = (m_declaredWalls ^ mask) & 0xF;
+    m_declaredWalls = mask & 0xF;
+    for (Direction direction : DIRECTIONS) {
+        if (changed & (1 << DIRECTION_INDEX(direction))) {
+            updateWall(direction);
+        }
+    }
+}
+
+void TileGraphic::refreshTrueWalls() {
+    unsigned char trueWalls = 0;
+    for (Direction direction : DIRECTIONS) {
+        if (m_tile->isWall(direction)) {
+            trueWalls |= 1 << DIRECTION_INDEX(direction);
+        }
+    }
+    unsigned char changed = m_trueWalls ^ trueWalls;
+    m_trueWalls = trueWalls;
+    for (Direction direction : DIRECTIONS) {
+        if (changed & (1 << DIRECTION_INDEX(direction))) {
+            updateWall(direction);
+        }
+    }
+}
+
+bool TileGraphic::setColor(Color color) {
+    if (color == m_color) {
+        return false;
+    }
     m_color = color;
-    updateColor();
+    return stage(STALE_COLOR);
 }
 
-void TileGraphic::clearColor() {
-    m_color = ColorManager::getTileBaseColor();
-    updateColor();
+bool TileGraphic::clearColor() {
+    return setColor(ColorManager::getTileBaseColor());
 }
 
-void TileGraphic::setText(const QString& text) {
+bool TileGraphic::setText(const QString& text) {
+    if (text == m_text) {
+        return false;
+    }
     m_text = text;
-    updateText();
+    return stage(STALE_TEXT);
 }
 
-void TileGraphic::clearText() {
-    m_text = "";
-    updateText();
+bool TileGraphic::clearText() {
+    return setText("");
 }
 
-void TileGraphic::drawPolygons() const {
+void TileGraphic::setFog(bool fog) {
+    if (fog == m_fog) {
+        return;
+    }
+    m_fog = fog;
+    updateFog();
+}
+
+bool TileGraphic::setHeat(int heat) {
+    if (heat == m_heat) {
+        return false;
+    }
+    m_heat = heat;
+    return stage(STALE_HEAT);
+}
 
-    // Note that the order in which we call insertIntoGraphicCpuBuffer
-    // determines the order in which the polygons are drawn. Also note that the
-    // *StartingIndex methods in GrahicsUtilities.h depend upon this order.
+bool TileGraphic::clearHeat() {
+    return setHeat(-1);
+}
 
-    // Draw the base of the tile
-    m_bufferInterface->insertIntoGraphicCpuBuffer(
-        m_tile->getFullPolygon(), m_color, 255);
+TileState TileGraphic::getState() const {
+    return {m_declaredWalls, m_color, m_text, m_heat};
+}
 
-    // Draw each of the walls of the tile
-    for (Direction direction : DIRECTIONS()) {
-        m_bufferInterface->insertIntoGraphicCpuBuffer(
-            m_tile->getWallPolygon(direction),
-            ColorManager::getTileWallColor(),
-            getWallAlpha(direction));
+void TileGraphic::flush() const {
+    if (m_stale & STALE_COLOR) {
+        updateColor();
     }
+    if (m_stale & STALE_TEXT) {
+        updateText();
+    }
+    if (m_stale & STALE_HEAT) {
+        updateHeat();
+    }
+    m_stale = 0;
+}
+
+void TileGraphic::drawPolygons() const {
 
-    // Draw the corners of the tile
-    for (Polygon polygon : m_tile->getCornerPolygons()) {
-        m_bufferInterface->insertIntoGraphicCpuBuffer(
-            polygon,
-            ColorManager::getTileCornerColor(),
-            255);
+    // The geometry of the tile is shared with every other tile, so all we
+    // need is a record of the tile's state
+    m_bufferInterface->writeTileInstance(getInstance());
+}
+
+TileInstance TileGraphic::getInstance() const {
+    TileInstance instance;
+    instance.x = static_cast<unsigned short>(m_tile->getX());
+    instance.y = static_cast<unsigned short>(m_tile->getY());
+    instance.color = static_cast<unsigned char>(m_color);
+    instance.walls = 0;
+    for (Direction direction : DIRECTIONS) {
+        instance.walls |= static_cast<unsigned char>(
+            getWallLevel(direction) << (2 * DIRECTION_INDEX(direction))
+        );
+    }
+    instance.flags = 0;
+    if (m_fog) {
+        instance.flags |= TileInstance::FLAG_FOG;
+    }
+    instance.heat = 0;
+    if (0 <= m_heat) {
+        instance.flags |= TileInstance::FLAG_HEAT;
+        instance.heat = static_cast<unsigned char>(m_heat);
     }
+    return instance;
 }
 
 void TileGraphic::drawTextures() {
-    // Insert all of the triangle texture objects into the buffer ...
-    QPair<int, int> maxRowsAndCols =
-        m_bufferInterface->getTileGraphicTextMaxSize();
-    for (int row = 0; row < maxRowsAndCols.first; row += 1) {
-        for (int col = 0; col < maxRowsAndCols.second; col += 1) {
-            m_bufferInterface->insertIntoTextureCpuBuffer();
-        }
+    // Only the glyphs that are shown take up space in the buffer
+    updateText();
+}
+
+void TileGraphic::refresh() const {
+    updateColor();
+    for (Direction direction : DIRECTIONS) {
+        updateWall(direction);
     }
-    // ... and then populate those triangle texture objects with data
+    updateFog();
+    updateHeat();
     updateText();
+    m_stale = 0;
+}
+
+bool TileGraphic::stage(unsigned char part) {
+    bool wasStale = m_stale != 0;
+    m_stale |= part;
+    return !wasStale;
 }
 
 void TileGraphic::updateWall(Direction direction) const {
-    m_bufferInterface->updateTileGraphicWallColor(
+    m_bufferInterface->updateTileGraphicWall(
         m_tile->getX(),
         m_tile->getY(),
         direction,
-        ColorManager::getTileWallColor(),
-        getWallAlpha(direction)
+        getWallLevel(direction)
     );
 }
 
@@ -110,15 +233,14 @@ void TileGraphic::updateColor() const {
 }
 
 void TileGraphic::updateText() const {
+    PROFILE_ZONE("TileGraphic::updateText");
 
     // First, retrieve the maximum number of rows and cols of text allowed
     QPair<int, int> maxRowsAndCols =
         m_bufferInterface->getTileGraphicTextMaxSize();
 
-    // Then, generate the rows of text that will be displayed
+    // Then, split the text into the rows that will be displayed
     QStringList rowsOfText;
-
-    // Split the text into rows
     QString remaining = m_text;
     while (!remaining.isEmpty() && rowsOfText.size() < maxRowsAndCols.first) {
         QString row = remaining.left(maxRowsAndCols.second);
@@ -126,47 +248,33 @@ void TileGraphic::updateText() const {
         remaining = remaining.mid(maxRowsAndCols.second);
     }
 
-    // For all possible character positions, insert some character
-    // (blank if necessary) into the tile text cpu buffer
-    for (int row = 0; row < maxRowsAndCols.first; row += 1) {
-        for (int col = 0; col < maxRowsAndCols.second; col += 1) {
-            int numRows = std::min(
-                static_cast<int>(rowsOfText.size()),
-                maxRowsAndCols.first
-            );
-            int numCols = std::min(
-                static_cast<int>(row < rowsOfText.size() ? rowsOfText.at(row).size() : 0),
-                maxRowsAndCols.second
-            );
-            QChar c = ' ';
-            if (
-                row < rowsOfText.size() &&
-                col < rowsOfText.at(row).size()
-            ) {
-                c = rowsOfText.at(row).at(col);
-            }
-            ASSERT_TR(FontImage::positions().contains(c));
-            m_bufferInterface->updateTileGraphicText(
-                m_tile->getX(),
-                m_tile->getY(),
-                numRows,
-                numCols,
-                row,
-                col,
-                c
-            );
-        }
-    }
+    // Finally, replace the tile's glyphs with the glyphs of those rows
+    m_bufferInterface->updateTileGraphicText(
+        m_tile->getX(),
+        m_tile->getY(),
+        rowsOfText
+    );
 }
 
-unsigned char TileGraphic::getWallAlpha(Direction direction) const {
-    if (m_walls.value(direction)) {
-        return 255;
-    }
-    if (m_tile->isWall(direction)) {
-        return 64;
-    }
-    return 0;
+void TileGraphic::updateFog() const {
+    m_bufferInterface->updateTileGraphicFog(
+        m_tile->getX(),
+        m_tile->getY(),
+        m_fog);
+}
+
+void TileGraphic::updateHeat() const {
+    m_bufferInterface->updateTileGraphicHeat(
+        m_tile->getX(),
+        m_tile->getY(),
+        m_heat);
+}
+
+unsigned char TileGraphic::getWallLevel(Direction direction) const {
+    int shift = DIRECTION_INDEX(direction);
+    int declared = (m_declaredWalls >> shift) & 1;
+    int real = (m_trueWalls >> shift) & 1;
+    return WALL_LEVELS[(declared << 1) | real];
 }
 
 } 
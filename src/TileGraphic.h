@@ -1,14 +1,26 @@
 #pragma once
 
-#include <QMap>
 #include <QPair>
+#include <QString>
 
 #include "BufferInterface.h"
 #include "Color.h"
 #include "Tile.h"
+#include "TileInstance.h"
 
 namespace mms {
 
+// Everything about a tile that an algorithm can change, without any of the
+// buffers that draw it, e.g., to compare two runs
+struct TileState {
+    unsigned char declaredWalls; // a bit for every direction, as in setWalls
+    Color color;
+    QString text;
+    int heat; // or -1 for none
+    bool operator==(const TileState& other) const;
+    bool operator!=(const TileState& other) const;
+};
+
 class TileGraphic {
 
 public:
@@ -21,27 +33,71 @@ public:
     void setWall(Direction direction);
     void clearWall(Direction direction);
 
-    void setColor(const Color color);
-    void clearColor();
+    // Declares exactly the walls in the mask (a bit for every direction, by
+    // the value of the Direction), and redraws only the ones that changed
+    void setWalls(unsigned char mask);
+
+    // Looks up the walls that are really there again, after the maze was
+    // edited, and redraws only the ones that changed
+    void refreshTrueWalls();
+
+    // Changes to the color, the text and the heat are only staged, and
+    // written to the buffers by flush, so that a tile that changes many times
+    // between frames is only written with its final state; each returns
+    // whether the tile has just become stale, i.e., needs to be flushed
+    bool setColor(const Color color);
+    bool clearColor();
+
+    bool setText(const QString& text);
+    bool clearText();
+
+    // Fogged tiles are drawn darker than the rest
+    void setFog(bool fog);
 
-    void setText(const QString& text);
-    void clearText();
+    // Tiles with heat, from 0 to 255, are drawn in the heatmap's colors
+    // instead of their own
+    bool setHeat(int heat);
+    bool clearHeat();
+
+    TileState getState() const;
+
+    // Writes whatever was staged since the last flush; mutates nothing but
+    // the staging itself, so that flushing doesn't detach a shared copy
+    void flush() const;
 
     // TODO: upforgrabs
     // Rename these to "reload" or something
+    // The first only writes the tile's own record, without marking it dirty,
+    // and so may be called for other tiles on other threads at the same time
     void drawPolygons() const;
     void drawTextures();
 
+    // Rewrites all of the tile's state to the buffers, e.g., after the tile
+    // was replaced by a copy of an earlier version of itself; this includes
+    // whatever was staged
+    void refresh() const;
+
 private:
 
     // Input and output objects
     const Tile* m_tile;
     BufferInterface* m_bufferInterface;
 
-    // Visual state
-    QMap<Direction, bool> m_walls;
+    // Visual state; the declared walls, and the walls that are really there,
+    // each take a bit for every direction, by the value of the Direction
+    unsigned char m_declaredWalls;
+    unsigned char m_trueWalls;
     Color m_color;
     QString m_text;
+    bool m_fog;
+    int m_heat;
+
+    // Which of the staged parts of the state haven't been written yet
+    static const unsigned char STALE_COLOR;
+    static const unsigned char STALE_TEXT;
+    static const unsigned char STALE_HEAT;
+    mutable unsigned char m_stale;
+    bool stage(unsigned char part);
 
     // Helper functions
     // TODO: upforgrabs
@@ -49,8 +105,16 @@ private:
     void updateWall(Direction direction) const;
     void updateColor() const;
     void updateText() const;
+    void updateFog() const;
+    void updateHeat() const;
     
-    unsigned char getWallAlpha(Direction direction) const;
+    // The level of a wall, by whether it's declared (the high bit of the
+    // index) and whether it's really there (the low bit)
+    static const unsigned char WALL_LEVELS[4];
+    unsigned char getWallLevel(Direction direction) const;
+
+    // The record of the tile's current state
+    TileInstance getInstance() const;
 };
 
 } 
@@ -1,7 +1,6 @@
 #include "TileGraphicTextCache.h"
 
 #include "AssertMacros.h"
-#include "FontImage.h"
 
 namespace mms {
 
@@ -13,41 +12,44 @@ void TileGraphicTextCache::init(
     m_wallLength = wallLength;
     m_wallWidth = wallWidth;
     m_tileGraphicTextMaxSize = tileGraphicTextMaxSize;
-    m_tileGraphicTextPositions = buildPositionCache();
+    m_tileGraphicTextBoxes = buildPositionCache();
 }
 
 QPair<int, int> TileGraphicTextCache::getTileGraphicTextMaxSize() const {
     return m_tileGraphicTextMaxSize;
 }
 
-QPair<double, double> TileGraphicTextCache::getFontImageCharacterPosition(QChar c) const {
-    ASSERT_TR(FontImage::positions().contains(c));
-    return FontImage::positions().value(c);
+FontImage::Glyph TileGraphicTextCache::getFontImageCharacterPosition(
+        QChar c) const {
+    // An index into a table for ASCII, since this is done for every
+    // character of every text
+    FontImage::Glyph glyph = FontImage::glyph(c);
+    ASSERT_TR(glyph.isValid);
+    return glyph;
 }
 
-QPair<Coordinate, Coordinate> TileGraphicTextCache::getTileGraphicTextPosition(
-        int x, int y, int numRows, int numCols, int row, int col) const {
-
-    // Get the character position in the maze for the starting tile
-    QPair<Coordinate, Coordinate> textPosition = m_tileGraphicTextPositions.value(
-        {
-            {numRows, numCols},
-            {row, col}
-        }
-    );
-
-    // Now get the character position in the maze for *this* tile
-    Distance tileLength = m_wallLength + m_wallWidth;
-    Coordinate offset = Coordinate::Cartesian(tileLength * x, tileLength * y);
-    Coordinate LL = textPosition.first + offset;
-    Coordinate UR = textPosition.second + offset;
+const TileGraphicTextCache::TextBox&
+TileGraphicTextCache::getTileGraphicTextBox(
+        int numRows, int numCols, int row, int col) const {
+    ASSERT_LE(numRows, m_tileGraphicTextMaxSize.first);
+    ASSERT_LE(numCols, m_tileGraphicTextMaxSize.second);
+    ASSERT_LE(0, row);
+    ASSERT_LT(row, numRows);
+    ASSERT_LE(0, col);
+    ASSERT_LT(col, numCols);
+    return m_tileGraphicTextBoxes.at(
+        getTextBoxIndex(numRows, numCols, row, col));
+}
 
-    return {LL, UR};
+int TileGraphicTextCache::getTextBoxIndex(
+        int numRows, int numCols, int row, int col) const {
+    int maxRows = m_tileGraphicTextMaxSize.first;
+    int maxCols = m_tileGraphicTextMaxSize.second;
+    return ((numRows * (maxCols + 1) + numCols) * maxRows + row) * maxCols
+        + col;
 }
 
-QMap<
-    QPair<QPair<int, int>, QPair<int, int>>,
-    QPair<Coordinate, Coordinate>>
+QVector<TileGraphicTextCache::TextBox>
 TileGraphicTextCache::buildPositionCache() {
 
     // The tile graphic text could look like either of the following, depending
@@ -71,12 +73,11 @@ TileGraphicTextCache::buildPositionCache() {
     //     *[A]--------------------------*-*    *[A]--------------------------*-*
     //     *-*---------------------------*-*    *-*---------------------------*-*
 
-    QMap<
-        QPair<QPair<int, int>, QPair<int, int>>,
-        QPair<Coordinate, Coordinate>> positionCache;
-
     int maxRows = m_tileGraphicTextMaxSize.first;
     int maxCols = m_tileGraphicTextMaxSize.second;
+    QVector<TextBox> positionCache(
+        (maxRows + 1) * (maxCols + 1) * maxRows * maxCols);
+    Distance tileLength = m_wallLength + m_wallWidth;
     double borderFraction = 0.05;  // border padding
 
     // First we get the unscaled diagonal
@@ -123,14 +124,14 @@ TileGraphicTextCache::buildPositionCache() {
                         E.getY() + characterHeight * ((numRows - row - 1) + rowOffset + 1)
                     );
 
-                    // Insert the position into the cache
-                    positionCache.insert(
-                        {
-                            {numRows, numCols}, // Num rows/cols to be drawn
-                            {row, col} // Row and col of the current character
-                        },
-                        {LL, UR} // Lower left and upper right texture coord
-                    );
+                    // Insert the position into the cache, as fractions of
+                    // the tile length (tile (0, 0) starts at the origin)
+                    positionCache[getTextBoxIndex(numRows, numCols, row, col)] = {
+                        static_cast<float>(LL.getX() / tileLength),
+                        static_cast<float>(LL.getY() / tileLength),
+                        static_cast<float>(UR.getX() / tileLength),
+                        static_cast<float>(UR.getY() / tileLength),
+                    };
                 }
             }
         }
@@ -1,17 +1,28 @@
 #pragma once
 
 #include <QChar>
-#include <QMap>
 #include <QPair>
+#include <QVector>
 
 #include "units/Coordinate.h"
 
+#include "FontImage.h"
+
 namespace mms {
 
 class TileGraphicTextCache {
 
 public:
-    
+
+    // The bounds of a character, as fractions of the tile length, relative to
+    // the lower left corner of the tile (the same for every tile)
+    struct TextBox {
+        float left;
+        float bottom;
+        float right;
+        float top;
+    };
+
     // Initialize the cache
     void init(
         const Distance& wallLength,
@@ -22,11 +33,12 @@ public:
     QPair<int, int> getTileGraphicTextMaxSize() const;
 
     // Return a characters starting and ending position in the font image
-    QPair<double, double> getFontImageCharacterPosition(QChar c) const;
+    FontImage::Glyph getFontImageCharacterPosition(QChar c) const;
 
-    // Retrieve the LL and UR coordinates for a particular location
-    QPair<Coordinate, Coordinate> getTileGraphicTextPosition(
-        int x, int y, int numRows, int numCols, int row, int col) const;
+    // Retrieve the bounds of the character at the given row and column of
+    // text with the given number of rows and columns
+    const TextBox& getTileGraphicTextBox(
+        int numRows, int numCols, int row, int col) const;
 
 private:
 
@@ -37,16 +49,14 @@ private:
     // The max rows and cols of text per tile
     QPair<int, int> m_tileGraphicTextMaxSize;
 
-    // A map of the number of rows/cols to be displayed and the current row/col
-    // to the LL/UR text coordinates for the starting tile, namely tile (0, 0)
-    QMap<
-        QPair<QPair<int, int>, QPair<int, int>>,
-        QPair<Coordinate, Coordinate>> m_tileGraphicTextPositions;
+    // The bounds of every character, for every number of rows/cols to be
+    // displayed, flattened into a single array so that a lookup is just an
+    // index computation rather than a search through nested pairs
+    QVector<TextBox> m_tileGraphicTextBoxes;
+    int getTextBoxIndex(int numRows, int numCols, int row, int col) const;
 
     // Just a helper method for building the text position cache
-    QMap<
-        QPair<QPair<int, int>, QPair<int, int>>,
-        QPair<Coordinate, Coordinate>> buildPositionCache();
+    QVector<TextBox> buildPositionCache();
 };
 
 } 
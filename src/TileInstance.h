@@ -0,0 +1,26 @@
+#pragma once
+
+namespace mms {
+
+// The visual state of a single tile, read once per tile by the instanced
+// draw of the tile template mesh
+struct TileInstance {
+
+    // Levels of the two bits stored for each wall
+    static const unsigned char WALL_LEVEL_NONE = 0; // not drawn
+    static const unsigned char WALL_LEVEL_HIDDEN = 1; // undeclared, but real
+    static const unsigned char WALL_LEVEL_DECLARED = 2; // declared
+
+    // Bits of the flags
+    static const unsigned char FLAG_FOG = 1;
+    static const unsigned char FLAG_HEAT = 2; // the heat is shown
+
+    unsigned short x; // x position of the tile
+    unsigned short y; // y position of the tile
+    unsigned char color; // index of the base Color
+    unsigned char walls; // a wall level for each of DIRECTIONS, low first
+    unsigned char flags; // some combination of FLAG_* values
+    unsigned char heat; // heatmap value, from 0 (cold) to 255 (hot)
+};
+
+} 
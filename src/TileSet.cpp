@@ -0,0 +1,45 @@
+#include "TileSet.h"
+
+#include <limits>
+
+namespace mms {
+
+TileSet::TileSet() : TileSet(0, 0) {
+}
+
+TileSet::TileSet(int width, int height) :
+    m_height(height),
+    m_generation(1),
+    m_stamps(QVector<int>(width * height, 0)),
+    m_tiles(QVector<QPair<int, int>>()) {
+}
+
+bool TileSet::insert(int x, int y) {
+    int& stamp = m_stamps[x * m_height + y];
+    if (stamp == m_generation) {
+        return false;
+    }
+    stamp = m_generation;
+    m_tiles.append({x, y});
+    return true;
+}
+
+bool TileSet::contains(int x, int y) const {
+    return m_stamps.at(x * m_height + y) == m_generation;
+}
+
+void TileSet::clear() {
+    m_tiles.clear();
+    if (m_generation == std::numeric_limits<int>::max()) {
+        // Only the stamps of the newest generation matter
+        m_stamps.fill(0);
+        m_generation = 0;
+    }
+    m_generation += 1;
+}
+
+const QVector<QPair<int, int>>& TileSet::getTiles() const {
+    return m_tiles;
+}
+
+} 
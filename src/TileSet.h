@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+namespace mms {
+
+class TileSet {
+
+    // A set of the tiles of a maze that's cleared in constant time. Each tile
+    // is stamped with the generation in which it was last inserted, so that
+    // inserting is an array write rather than a hash insert, and clearing just
+    // starts a new generation, leaving the stale stamps where they are.
+
+public:
+
+    TileSet();
+    TileSet(int width, int height);
+
+    // Returns whether the tile wasn't already in the set
+    bool insert(int x, int y);
+    bool contains(int x, int y) const;
+    void clear();
+
+    // Every tile inserted since the set was last cleared, in order
+    const QVector<QPair<int, int>>& getTiles() const;
+
+private:
+
+    int m_height;
+    int m_generation;
+    QVector<int> m_stamps;
+    QVector<QPair<int, int>> m_tiles;
+};
+
+} 
@@ -0,0 +1,177 @@
+#include "TileTemplate.h"
+
+#include "AssertMacros.h"
+#include "Dimensions.h"
+#include "Direction.h"
+
+namespace mms {
+
+const TileTemplate::Layout TileTemplate::DETAILED_LAYOUT = {
+    1 * 6, // base
+    3 * 6, // north wall, east wall, and the corner between them
+    3 * 6, // west wall, and the corners at either end of it
+    2 * 6, // south wall, and the corner east of it
+};
+const TileTemplate::Layout TileTemplate::COARSE_LAYOUT = {
+    1 * 6, // base
+    2 * 6, // north wall and east wall
+    1 * 6, // west wall
+    1 * 6, // south wall
+};
+const int TileTemplate::DETAILED_INDEX_COUNT = 9 * 6;
+const int TileTemplate::COARSE_INDEX_COUNT = 5 * 6;
+
+const QVector<VertexTileTemplate>& TileTemplate::getVertices() {
+    return getMesh().vertices;
+}
+
+const QVector<unsigned int>& TileTemplate::getIndices() {
+    return getMesh().indices;
+}
+
+const TileTemplate::Mesh& TileTemplate::getMesh() {
+    static const Mesh mesh = build();
+    return mesh;
+}
+
+TileTemplate::Mesh TileTemplate::build() {
+
+    // The base covers the whole tile, and the walls and corners are
+    // centered on the edges of the tile, so that they also cover the halves
+    // of the walls and corners that the neighboring tiles don't draw
+
+    Mesh mesh;
+    QVector<VertexTileTemplate>* vertices = &mesh.vertices;
+    QVector<unsigned int>* indices = &mesh.indices;
+    float l = Dimensions::tileLength().getMeters();
+    float w = Dimensions::halfWallWidth().getMeters();
+    float north = 1 + DIRECTION_INDEX(Direction::NORTH);
+    float east = 1 + DIRECTION_INDEX(Direction::EAST);
+    float south = 1 + DIRECTION_INDEX(Direction::SOUTH);
+    float west = 1 + DIRECTION_INDEX(Direction::WEST);
+
+    // Base of the tile
+    insertQuad(vertices, indices, {
+        {0, 0, -1, -1, 0},
+        {0, l, -1, 1, 0},
+        {l, l, 1, 1, 0},
+        {l, 0, 1, -1, 0},
+    });
+
+    // North and east walls, and the corner between them
+    insertQuad(vertices, indices, {
+        {w, l - w, 0, 0, north},
+        {w, l + w, 0, 0, north},
+        {l - w, l + w, 0, 0, north},
+        {l - w, l - w, 0, 0, north},
+    });
+    insertQuad(vertices, indices, {
+        {l - w, w, 0, 0, east},
+        {l - w, l - w, 0, 0, east},
+        {l + w, l - w, 0, 0, east},
+        {l + w, w, 0, 0, east},
+    });
+    insertQuad(vertices, indices, {
+        {l - w, l - w, 0, 0, 5},
+        {l - w, l + w, 0, 0, 5},
+        {l + w, l + w, 0, 0, 5},
+        {l + w, l - w, 0, 0, 5},
+    });
+
+    // West edge of the maze; the corner below the wall is flat, except on
+    // the south edge, where its lower vertices are pushed down by a whole
+    // wall width, so that only the corner of the maze draws it
+    insertQuad(vertices, indices, {
+        {-w, w, 0, 0, west},
+        {-w, l - w, 0, 0, west},
+        {w, l - w, 0, 0, west},
+        {w, w, 0, 0, west},
+    });
+    insertQuad(vertices, indices, {
+        {-w, l - w, 0, 0, 5},
+        {-w, l + w, 0, 0, 5},
+        {w, l + w, 0, 0, 5},
+        {w, l - w, 0, 0, 5},
+    });
+    insertQuad(vertices, indices, {
+        {-w, w, 0, -2, 5},
+        {-w, w, 0, 0, 5},
+        {w, w, 0, 0, 5},
+        {w, w, 0, -2, 5},
+    });
+
+    // South edge of the maze
+    insertQuad(vertices, indices, {
+        {w, -w, 0, 0, south},
+        {w, w, 0, 0, south},
+        {l - w, w, 0, 0, south},
+        {l - w, -w, 0, 0, south},
+    });
+    insertQuad(vertices, indices, {
+        {l - w, -w, 0, 0, 5},
+        {l - w, w, 0, 0, 5},
+        {l + w, w, 0, 0, 5},
+        {l + w, -w, 0, 0, 5},
+    });
+    ASSERT_EQ(indices->size(), DETAILED_INDEX_COUNT);
+
+    //   +-------------+
+    //   |      N      |
+    //   +-----------+-+
+    //   |           | |
+    //   |   base    |E|
+    //   |           | |
+    //   +-----------+-+
+    //   |             |
+    //
+    // The coarse walls cover the corners, which are too small to see; the
+    // north and south walls are extended by half a wall width on the edges
+    // of the maze, so that they also cover the corners of the maze
+
+    insertQuad(vertices, indices, {
+        {0, 0, -1, -1, 0},
+        {0, l, -1, 1, 0},
+        {l, l, 1, 1, 0},
+        {l, 0, 1, -1, 0},
+    });
+    insertQuad(vertices, indices, {
+        {0, l - w, -1, 0, north},
+        {0, l + w, -1, 0, north},
+        {l, l + w, 1, 0, north},
+        {l, l - w, 1, 0, north},
+    });
+    insertQuad(vertices, indices, {
+        {l - w, w, 0, 0, east},
+        {l - w, l - w, 0, 0, east},
+        {l + w, l - w, 0, 0, east},
+        {l + w, w, 0, 0, east},
+    });
+    insertQuad(vertices, indices, {
+        {-w, w, 0, 0, west},
+        {-w, l - w, 0, 0, west},
+        {w, l - w, 0, 0, west},
+        {w, w, 0, 0, west},
+    });
+    insertQuad(vertices, indices, {
+        {0, -w, -1, 0, south},
+        {0, w, -1, 0, south},
+        {l, w, 1, 0, south},
+        {l, -w, 1, 0, south},
+    });
+    ASSERT_EQ(indices->size(), DETAILED_INDEX_COUNT + COARSE_INDEX_COUNT);
+    return mesh;
+}
+
+void TileTemplate::insertQuad(
+        QVector<VertexTileTemplate>* vertices,
+        QVector<unsigned int>* indices,
+        const QVector<VertexTileTemplate>& corners) {
+    ASSERT_EQ(corners.size(), 4);
+    unsigned int base = vertices->size();
+    vertices->append(corners);
+    for (unsigned int index : {0, 1, 2, 0, 2, 3}) {
+        indices->append(base + index);
+    }
+}
+
+} 
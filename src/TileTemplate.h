@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QVector>
+
+#include "VertexTileTemplate.h"
+
+namespace mms {
+
+class TileTemplate {
+
+    // The mesh that's drawn once for every tile of every maze. It only
+    // depends on the Dimensions constants, so it's built once, on first use,
+    // and each tile is placed by its instance record in the vertex shader.
+
+public:
+
+    TileTemplate() = delete;
+
+    // Each mesh is drawn in parts, in this order. Every tile draws its base,
+    // and then its north and east walls, which are full width, reaching
+    // halfway into the neighboring tiles, so that each wall that two tiles
+    // share is only drawn once, by the tile south or west of it (and so with
+    // that tile's fog). The bases have to be drawn before any of the walls,
+    // which would otherwise be covered by the bases of later tiles. The
+    // walls on the west and south edges of the maze have no such tile, and
+    // are drawn by the tiles of the first column and row, respectively.
+    struct Layout {
+        int baseIndexCount;
+        int wallIndexCount;
+        int westEdgeIndexCount;
+        int southEdgeIndexCount;
+    };
+
+    // The indices hold two meshes, one after the other. The detailed mesh
+    // also has a corner for each wall; the coarse mesh, for tiles that are
+    // only a few pixels wide, doesn't.
+    static const Layout DETAILED_LAYOUT;
+    static const Layout COARSE_LAYOUT;
+    static const int DETAILED_INDEX_COUNT;
+    static const int COARSE_INDEX_COUNT;
+
+    static const QVector<VertexTileTemplate>& getVertices();
+    static const QVector<unsigned int>& getIndices();
+
+private:
+
+    struct Mesh {
+        QVector<VertexTileTemplate> vertices;
+        QVector<unsigned int> indices;
+    };
+    static const Mesh& getMesh();
+    static Mesh build();
+
+    // Appends a quad, given in order around its perimeter
+    static void insertQuad(
+        QVector<VertexTileTemplate>* vertices,
+        QVector<unsigned int>* indices,
+        const QVector<VertexTileTemplate>& corners);
+
+};
+
+} 
@@ -0,0 +1,195 @@
+#include "TournamentGrid.h"
+
+#include <cmath>
+
+#include <QColor>
+#include <QHelpEvent>
+#include <QPainter>
+#include <QPolygonF>
+#include <QToolTip>
+
+#include "AssertMacros.h"
+#include "Maze.h"
+#include "MazeError.h"
+#include "MazeGenerator.h"
+#include "MazeThumbnailer.h"
+
+namespace mms {
+
+const int TournamentGrid::SAMPLE_MS = 250;
+const int TournamentGrid::CELL_SIZE = 128;
+const int TournamentGrid::CELL_SPACING = 4;
+
+TournamentGrid::TournamentGrid(
+        const TournamentRunner* runner,
+        QWidget* parent) :
+    QOpenGLWidget(parent),
+    m_runner(runner),
+    m_sampleTimer(new QTimer(this)),
+    m_slots(runner->getNumLocalSlots()),
+    m_isSlotOccupied(runner->getNumLocalSlots(), false) {
+
+    setWindowTitle("Tournament");
+    m_sampleTimer->setInterval(SAMPLE_MS);
+    connect(m_sampleTimer, &QTimer::timeout, this, &TournamentGrid::sample);
+    m_sampleTimer->start();
+}
+
+QSize TournamentGrid::sizeHint() const {
+    int numColumns = getNumColumns();
+    int numRows = (m_slots.size() + numColumns - 1) / numColumns;
+    return QSize(
+        numColumns * (CELL_SIZE + CELL_SPACING) + CELL_SPACING,
+        numRows * (CELL_SIZE + CELL_SPACING) + CELL_SPACING
+    );
+}
+
+void TournamentGrid::paintGL() {
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    for (int i = 0; i < m_slots.size(); i += 1) {
+        QRect cell = getCellRect(i);
+        painter.fillRect(cell, QColor(24, 24, 24));
+        if (!m_isSlotOccupied.at(i)) {
+            continue;
+        }
+        const TournamentRunner::RunSample& sample = m_slots.at(i);
+        const MazeImage& maze = getMazeImage(sample.maze);
+        if (maze.image.isNull()) {
+            continue;
+        }
+
+        // The walls keep their aspect ratio, centered in the cell
+        QSize size = maze.image.size().scaled(cell.size(), Qt::KeepAspectRatio);
+        QRect target(QPoint(0, 0), size);
+        target.moveCenter(cell.center());
+        painter.drawImage(target, maze.image);
+
+        // The mouse is a triangle in the color of its algorithm, pointing
+        // the way it's facing (rows of the maze go up)
+        double tileWidth = target.width() / static_cast<double>(maze.width);
+        double tileHeight = target.height() / static_cast<double>(maze.height);
+        QPointF center(
+            target.left() + (sample.position.first + 0.5) * tileWidth,
+            target.bottom() - (sample.position.second + 0.5) * tileHeight
+        );
+        double radius = 0.4 * qMin(tileWidth, tileHeight);
+        double angle = static_cast<int>(sample.direction) * M_PI / 2.0;
+        QPolygonF triangle;
+        for (double corner : {0.0, 2.5, -2.5}) {
+            triangle.append(center + QPointF(
+                radius * std::sin(angle + corner),
+                -radius * std::cos(angle + corner)
+            ));
+        }
+        QColor color = QColor::fromHsv((sample.entrant * 67) % 360, 255, 255);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(color);
+        painter.drawPolygon(triangle);
+    }
+}
+
+bool TournamentGrid::event(QEvent* event) {
+    if (event->type() != QEvent::ToolTip) {
+        return QOpenGLWidget::event(event);
+    }
+    QHelpEvent* helpEvent = static_cast<QHelpEvent*>(event);
+    int slot = getSlotAt(helpEvent->pos());
+    if (slot == -1 || !m_isSlotOccupied.at(slot)) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+    const TournamentRunner::RunSample& sample = m_slots.at(slot);
+    QToolTip::showText(
+        helpEvent->globalPos(),
+        m_runner->getEntrantName(sample.entrant) + " on " +
+            m_runner->getMazePath(sample.maze),
+        this,
+        getCellRect(slot)
+    );
+    return true;
+}
+
+void TournamentGrid::sample() {
+
+    // Runs that are still in flight stay where they are, and new runs take
+    // the first free slots
+    QVector<TournamentRunner::RunSample> samples = m_runner->sampleRuns();
+    QVector<bool> isPlaced(samples.size(), false);
+    for (int i = 0; i < m_slots.size(); i += 1) {
+        bool isStillRunning = false;
+        for (int j = 0; j < samples.size() && m_isSlotOccupied.at(i); j += 1) {
+            if (samples.at(j).id == m_slots.at(i).id) {
+                m_slots[i] = samples.at(j);
+                isPlaced[j] = true;
+                isStillRunning = true;
+            }
+        }
+        m_isSlotOccupied[i] = isStillRunning;
+    }
+    int slot = 0;
+    for (int j = 0; j < samples.size(); j += 1) {
+        if (isPlaced.at(j)) {
+            continue;
+        }
+        while (slot < m_slots.size() && m_isSlotOccupied.at(slot)) {
+            slot += 1;
+        }
+        ASSERT_LT(slot, m_slots.size());
+        m_slots[slot] = samples.at(j);
+        m_isSlotOccupied[slot] = true;
+    }
+
+    setWindowTitle(
+        QString("Tournament (%1/%2 runs finished)")
+            .arg(m_runner->getNumFinished())
+            .arg(m_runner->getNumRuns())
+    );
+    update();
+}
+
+int TournamentGrid::getNumColumns() const {
+    int numSlots = qMax(1, m_slots.size());
+    return static_cast<int>(std::ceil(std::sqrt(numSlots)));
+}
+
+QRect TournamentGrid::getCellRect(int slot) const {
+    int numColumns = getNumColumns();
+    return QRect(
+        CELL_SPACING + (slot % numColumns) * (CELL_SIZE + CELL_SPACING),
+        CELL_SPACING + (slot / numColumns) * (CELL_SIZE + CELL_SPACING),
+        CELL_SIZE,
+        CELL_SIZE
+    );
+}
+
+int TournamentGrid::getSlotAt(const QPoint& position) const {
+    for (int i = 0; i < m_slots.size(); i += 1) {
+        if (getCellRect(i).contains(position)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const TournamentGrid::MazeImage& TournamentGrid::getMazeImage(int maze) {
+
+    // Every maze was valid when the tournament started, and generated mazes
+    // are deterministic, but an image stays null if that changes
+    if (!m_mazeImages.contains(maze)) {
+        MazeError error;
+        Maze* loaded = MazeGenerator::load(m_runner->getMazePath(maze), &error);
+        MazeImage image = {QImage(), 1, 1};
+        if (loaded != nullptr) {
+            image.image = MazeThumbnailer::render(loaded);
+            image.width = loaded->getWidth();
+            image.height = loaded->getHeight();
+            delete loaded;
+        }
+        m_mazeImages.insert(maze, image);
+    }
+    return m_mazeImages[maze];
+}
+
+} 
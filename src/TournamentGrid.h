@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QEvent>
+#include <QImage>
+#include <QMap>
+#include <QOpenGLWidget>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QTimer>
+#include <QVector>
+
+#include "TournamentRunner.h"
+
+namespace mms {
+
+class TournamentGrid : public QOpenGLWidget {
+
+    // A live view of a tournament: a grid of small thumbnails, one for each
+    // local slot, of the run in it. A thumbnail is the walls of its run's
+    // maze, which are rendered once for each maze, and then drawn as a
+    // texture that the widget's single context keeps, with just the mouse
+    // on top; tile text is left out, but hovering over a thumbnail tells
+    // which algorithm is running in it, and on which maze. The runs are
+    // sampled on a timer (see TournamentRunner::sampleRuns) rather than
+    // followed, so that the grid costs them nothing, however fast they go.
+
+    Q_OBJECT
+
+public:
+
+    // No ownership of the runner
+    TournamentGrid(const TournamentRunner* runner, QWidget* parent = 0);
+
+    QSize sizeHint() const;
+
+protected:
+
+    void paintGL();
+    bool event(QEvent* event);
+
+private:
+
+    static const int SAMPLE_MS;
+    static const int CELL_SIZE;
+    static const int CELL_SPACING;
+
+    // The walls of a maze, and its size in tiles, for placing the mouse
+    struct MazeImage {
+        QImage image;
+        int width;
+        int height;
+    };
+
+    const TournamentRunner* m_runner;
+    QTimer* m_sampleTimer;
+
+    // A run keeps its slot for as long as it's in flight, so that the
+    // thumbnails don't move around as runs finish
+    QVector<TournamentRunner::RunSample> m_slots;
+    QVector<bool> m_isSlotOccupied;
+    QMap<int, MazeImage> m_mazeImages;
+
+    void sample();
+    int getNumColumns() const;
+    QRect getCellRect(int slot) const;
+    int getSlotAt(const QPoint& position) const;
+    const MazeImage& getMazeImage(int maze);
+};
+
+} 
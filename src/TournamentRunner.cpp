@@ -0,0 +1,637 @@
+#include "TournamentRunner.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include "AssertMacros.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+const int TournamentRunner::MAX_ATTEMPTS = 3;
+
+TournamentRunner::TournamentRunner(
+        const QStringList& algoNames,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        const QStringList& workerAddresses,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool useSharedMemory,
+        bool continuous,
+        const ProcessLimits& processLimits,
+        const QString& resultsPath,
+        const QString& storePath,
+        QObject* parent) :
+    QObject(parent),
+    m_algoNames(algoNames),
+    m_mazeDirectory(mazeDirectory),
+    m_generatedMazes(generatedMazes),
+    m_numJobs(numJobs),
+    m_workerAddresses(workerAddresses),
+    m_timeLimitSeconds(timeLimitSeconds),
+    m_tickLimit(tickLimit),
+    m_useSharedMemory(useSharedMemory),
+    m_continuous(continuous),
+    m_processLimits(processLimits),
+    m_resultsPath(resultsPath),
+    m_storePath(storePath),
+    m_isMemoized(false),
+    m_nextBuildIndex(0),
+    m_numBuilding(0),
+    m_numRunning(0),
+    m_numFinished(0),
+    m_store(nullptr) {
+    ASSERT_LE(0, m_numJobs);
+    ASSERT_TR(0 < m_numJobs || !m_workerAddresses.isEmpty());
+    for (int i = 0; i < m_numJobs; i += 1) {
+        m_freeCpus.append(i);
+    }
+}
+
+TournamentRunner::~TournamentRunner() {
+    delete m_store;
+}
+
+void TournamentRunner::setMemoized(bool isMemoized) {
+    ASSERT_TR(!isMemoized || !m_storePath.isEmpty());
+    m_isMemoized = isMemoized;
+}
+
+bool TournamentRunner::start() {
+
+    QStringList names = m_algoNames;
+    if (names.isEmpty()) {
+        names = SettingsMouseAlgos::names();
+    }
+    if (names.isEmpty()) {
+        qWarning() << "No mouse algorithms to enter";
+        return false;
+    }
+    for (const QString& name : names) {
+        if (!SettingsMouseAlgos::names().contains(name)) {
+            qWarning().noquote().nospace()
+                << "No mouse algorithm named \"" << name << "\"";
+            return false;
+        }
+        m_entrants.append({
+            name,
+            SettingsMouseAlgos::getRunArguments(name),
+            SettingsMouseAlgos::getDirectory(name),
+            true,
+        });
+    }
+    for (const QString& address : m_workerAddresses) {
+        RemoteWorker* worker = RemoteWorker::create(address, this);
+        if (worker == nullptr) {
+            qWarning().noquote().nospace()
+                << "Invalid worker address \"" << address << "\"";
+            return false;
+        }
+        m_workers.append(worker);
+    }
+    if (!loadMazePaths()) {
+        return false;
+    }
+    if (m_isMemoized && !ResultStore::readJobs(m_storePath, &m_memoized)) {
+        qWarning().noquote().nospace()
+            << "Unable to read result store \"" << m_storePath << "\"";
+        return false;
+    }
+    if (!m_storePath.isEmpty()) {
+        m_store = ResultStore::open(m_storePath);
+        if (m_store == nullptr) {
+            qWarning().noquote().nospace()
+                << "Unable to open result store \"" << m_storePath << "\"";
+            return false;
+        }
+    }
+
+    // Fill every slot with builds (every build finishes asynchronously);
+    // once they've all finished, the runs start
+    m_builds.resize(m_entrants.size());
+    for (int i = 0; i < qMax(1, m_numJobs); i += 1) {
+        startNextBuild();
+    }
+    return true;
+}
+
+QVector<TournamentRunner::RunSample> TournamentRunner::sampleRuns() const {
+    QVector<RunSample> samples;
+    samples.reserve(m_localRuns.size());
+    for (int id : m_localRuns.keys()) {
+        const Job& job = m_jobs.at(id);
+        const Mouse* mouse = m_localRuns.value(id)->getMouse();
+        samples.append({
+            id,
+            job.entrant,
+            job.maze,
+            mouse->getCurrentDiscretizedTranslation(),
+            mouse->getCurrentDiscretizedRotation()
+        });
+    }
+    return samples;
+}
+
+int TournamentRunner::getNumLocalSlots() const {
+    return m_numJobs;
+}
+
+int TournamentRunner::getNumRuns() const {
+    return m_jobs.size();
+}
+
+int TournamentRunner::getNumFinished() const {
+    return m_numFinished;
+}
+
+QString TournamentRunner::getEntrantName(int entrant) const {
+    return m_entrants.at(entrant).name;
+}
+
+QString TournamentRunner::getMazePath(int maze) const {
+    return m_mazePaths.at(maze);
+}
+
+bool TournamentRunner::loadMazePaths() {
+
+    QStringList paths;
+    if (!m_mazeDirectory.isEmpty()) {
+        QDir dir(m_mazeDirectory);
+        if (!dir.exists()) {
+            qWarning().noquote().nospace()
+                << "No maze directory at \"" << m_mazeDirectory << "\"";
+            return false;
+        }
+        for (const QString& name : dir.entryList(QDir::Files, QDir::Name)) {
+            paths.append(dir.filePath(name));
+        }
+    }
+    paths.append(m_generatedMazes);
+
+    // Every maze is loaded again for each of its runs, since runs take
+    // ownership of their mazes, but only rejected once
+    for (const QString& path : paths) {
+        MazeError error;
+        Maze* maze = MazeGenerator::load(path, &error);
+        if (maze == nullptr) {
+            qWarning().noquote().nospace()
+                << "Skipping invalid maze \"" << path << "\": "
+                << Maze::errorToString(error);
+            continue;
+        }
+        m_mazePaths.append(path);
+        m_mazeHashes.append(maze->getHash());
+        delete maze;
+
+        // Workers generate their own mazes, but can't read our files
+        QByteArray data;
+        if (!m_workers.isEmpty() && !MazeGenerator::isSpec(path)) {
+            QFile file(path);
+            if (file.open(QIODevice::ReadOnly)) {
+                data = file.readAll();
+            }
+        }
+        m_mazeData.append(data);
+    }
+    if (m_mazePaths.isEmpty()) {
+        qWarning() << "No valid mazes to run";
+        return false;
+    }
+    return true;
+}
+
+void TournamentRunner::startNextBuild() {
+    if (m_nextBuildIndex == m_entrants.size()) {
+        return;
+    }
+    int index = m_nextBuildIndex;
+    m_nextBuildIndex += 1;
+    AlgoBuild* build = new AlgoBuild(m_entrants.at(index).name, this);
+    connect(build, &AlgoBuild::finished, this, [=](){
+        onBuildFinished(index);
+    });
+    m_builds[index] = build;
+    m_numBuilding += 1;
+    qInfo().noquote().nospace()
+        << "Building \"" << m_entrants.at(index).name << "\"";
+    build->start();
+}
+
+void TournamentRunner::onBuildFinished(int index) {
+
+    AlgoBuild* build = m_builds.at(index);
+    build->deleteLater();
+    m_numBuilding -= 1;
+
+    Entrant& entrant = m_entrants[index];
+    if (!build->isSuccessful()) {
+        qWarning().noquote().nospace()
+            << "Disqualifying \"" << entrant.name
+            << "\": its build failed\n" << build->getOutput();
+        entrant.isQualified = false;
+    }
+
+    startNextBuild();
+    if (m_numBuilding == 0) {
+        onBuildsFinished();
+    }
+}
+
+void TournamentRunner::onBuildsFinished() {
+
+    int numQualified = 0;
+    for (const Entrant& entrant : m_entrants) {
+        if (entrant.isQualified) {
+            numQualified += 1;
+        }
+    }
+    m_results.resize(m_entrants.size());
+    for (QVector<RunResult>& results : m_results) {
+        results.resize(m_mazePaths.size());
+    }
+
+    // Every job has a key if there's a store, so that later tournaments can
+    // reuse it, but only memoized ones look their keys up; the arguments it
+    // runs with are part of its key, since they aren't part of the version
+    // of what was built (see AlgoBuild). Nothing is run for the jobs that
+    // are found, so the store doesn't hear of them again.
+    QStringList versions;
+    for (const Entrant& entrant : m_entrants) {
+        versions.append(ResultStore::getVersion(entrant.name));
+    }
+    QString rules = getRules();
+    int numReused = 0;
+    for (int j = 0; j < m_mazePaths.size(); j += 1) {
+        for (int i = 0; i < m_entrants.size(); i += 1) {
+            if (!m_entrants.at(i).isQualified) {
+                continue;
+            }
+            quint64 key = 0;
+            if (m_store != nullptr) {
+                key = ResultStore::getJobKey(
+                    versions.at(i),
+                    m_mazeHashes.at(j),
+                    rules + ";run=" + m_entrants.at(i).runArguments.join(' ')
+                );
+            }
+            m_jobs.append({i, j, 0, key});
+            auto it = m_memoized.constFind(key);
+            if (key != 0 && it != m_memoized.constEnd()) {
+                m_results[i][j] = it.value();
+                m_results[i][j].mazePath = m_mazePaths.at(j);
+                m_numFinished += 1;
+                numReused += 1;
+                continue;
+            }
+            m_queue.append(m_jobs.size() - 1);
+        }
+    }
+    qInfo().noquote().nospace()
+        << numQualified << " algorithms qualified, " << m_mazePaths.size()
+        << " mazes, " << m_jobs.size() << " runs";
+    if (m_isMemoized) {
+        qInfo().noquote().nospace()
+            << numReused << " runs reused from the store, "
+            << m_queue.size() << " left to run";
+    }
+    if (m_queue.isEmpty()) {
+        finish();
+        return;
+    }
+
+    // Workers take jobs as soon as they've greeted us, and whenever they
+    // finish one; jobs they lose are queued again
+    for (RemoteWorker* worker : m_workers) {
+        connect(
+            worker,
+            &RemoteWorker::ready,
+            this,
+            &TournamentRunner::dispatch
+        );
+        connect(
+            worker,
+            &RemoteWorker::jobFinished,
+            this,
+            [=](int id, const RunResult& result){
+                onJobFinished(id, result, true);
+            }
+        );
+        connect(
+            worker,
+            &RemoteWorker::lost,
+            this,
+            &TournamentRunner::onJobsLost
+        );
+        worker->connectToWorker();
+    }
+    dispatch();
+}
+
+QString TournamentRunner::getRules() const {
+    // The transport, and how processes are pinned and niced, only change
+    // how quickly runs go; a batch with the same rules has the same keys
+    return QString("timeout=%1;ticks=%2;continuous=%3;memory=%4")
+        .arg(m_timeLimitSeconds)
+        .arg(m_tickLimit)
+        .arg(m_continuous ? 1 : 0)
+        .arg(m_processLimits.memoryBytes);
+}
+
+void TournamentRunner::dispatch() {
+    while (!m_queue.isEmpty() && m_numRunning < m_numJobs) {
+        startLocalJob(m_queue.takeFirst());
+    }
+    for (RemoteWorker* worker : m_workers) {
+        while (!m_queue.isEmpty() && 0 < worker->getNumFreeSlots()) {
+            int id = m_queue.takeFirst();
+            worker->startJob(id, getRemoteJob(id));
+        }
+    }
+}
+
+void TournamentRunner::startLocalJob(int id) {
+
+    // The maze was valid when the tournament started, and generated mazes
+    // are deterministic
+    const Job& job = m_jobs.at(id);
+    const Entrant& entrant = m_entrants.at(job.entrant);
+    QString path = m_mazePaths.at(job.maze);
+    MazeError error;
+    Maze* maze = MazeGenerator::load(path, &error);
+    ASSERT_FA(maze == nullptr);
+
+    HeadlessRun* run = new HeadlessRun(
+        path,
+        maze,
+        entrant.runArguments,
+        entrant.directory,
+        m_timeLimitSeconds,
+        m_tickLimit,
+        m_useSharedMemory,
+        false,
+        m_continuous,
+        this
+    );
+    int cpu = m_freeCpus.takeFirst();
+    run->setProcessLimits(m_processLimits, cpu);
+    connect(run, &HeadlessRun::finished, this, [=](){
+        run->deleteLater();
+        m_localRuns.remove(id);
+        m_numRunning -= 1;
+        m_freeCpus.append(cpu);
+        onJobFinished(id, run->getResult(), false);
+    });
+    m_localRuns.insert(id, run);
+    m_numRunning += 1;
+    run->start();
+}
+
+QJsonObject TournamentRunner::getRemoteJob(int id) const {
+    const Job& job = m_jobs.at(id);
+    QJsonObject object;
+    object["algo"] = m_entrants.at(job.entrant).name;
+    object["maze"] = m_mazePaths.at(job.maze);
+    if (!m_mazeData.at(job.maze).isEmpty()) {
+        object["mazeData"] =
+            QString::fromLatin1(m_mazeData.at(job.maze).toBase64());
+    }
+    object["timeout"] = m_timeLimitSeconds;
+    object["tickLimit"] = static_cast<double>(m_tickLimit);
+    object["shm"] = m_useSharedMemory;
+    object["continuous"] = m_continuous;
+    return object;
+}
+
+void TournamentRunner::onJobFinished(
+        int id,
+        const RunResult& result,
+        bool isRemote) {
+
+    // Another worker may well have the algorithm that this one couldn't
+    // start; local failures would only fail again
+    Job& job = m_jobs[id];
+    job.attempts += 1;
+    if (
+        isRemote &&
+        result.status == RunStatus::FAILED_TO_START &&
+        job.attempts < MAX_ATTEMPTS
+    ) {
+        qWarning().noquote().nospace()
+            << "Retrying " << m_entrants.at(job.entrant).name << " on "
+            << result.mazePath << ": " << result.error;
+        m_queue.prepend(id);
+        dispatch();
+        return;
+    }
+
+    // A worker runs with its own build of the algorithm, its own version of
+    // the simulator and its own limits, none of which are part of the key,
+    // so its results are stored without one and are never reused
+    m_results[job.entrant][job.maze] = result;
+    if (m_store != nullptr) {
+        m_store->append(ResultStore::toRow(
+            result,
+            m_mazeHashes.at(job.maze),
+            m_entrants.at(job.entrant).name,
+            ResultStore::getVersion(m_entrants.at(job.entrant).name),
+            isRemote ? 0 : job.key
+        ));
+    }
+    m_numFinished += 1;
+    qInfo().noquote().nospace()
+        << "[" << m_numFinished << "/" << m_jobs.size() << "] "
+        << m_entrants.at(job.entrant).name << " "
+        << HeadlessRun::statusToString(result.status) << " "
+        << result.mazePath;
+
+    dispatch();
+    if (m_numFinished == m_jobs.size()) {
+        finish();
+    }
+}
+
+void TournamentRunner::onJobsLost(const QList<int>& jobs) {
+    for (int id : jobs) {
+        Job& job = m_jobs[id];
+        job.attempts += 1;
+        if (job.attempts < MAX_ATTEMPTS) {
+            m_queue.prepend(id);
+            continue;
+        }
+        onJobFinished(id, HeadlessRun::getUnrunResult(
+            m_mazePaths.at(job.maze),
+            RunStatus::FAILED_TO_START,
+            "Lost with its worker, every time"
+        ), false);
+    }
+    dispatch();
+}
+
+void TournamentRunner::finish() {
+    if (m_store != nullptr) {
+        m_store->flush();
+    }
+    printLeaderboard();
+    if (!m_resultsPath.isEmpty() && !writeResults()) {
+        qWarning().noquote().nospace()
+            << "Couldn't write \"" << m_resultsPath << "\"";
+    }
+    emit done();
+}
+
+void TournamentRunner::printLeaderboard() const {
+
+    struct Standing {
+        int entrant;
+        int solved;
+        int wins;
+        double totalEstimatedSeconds;
+        int totalMoves;
+        int timeouts;
+        int exited;
+        double cpuSeconds;
+    };
+
+    // The fastest estimated time on each maze, among those who solved it;
+    // everyone who matched it wins the maze
+    QVector<double> fastest(m_mazePaths.size(), -1.0);
+    for (int i = 0; i < m_entrants.size(); i += 1) {
+        if (!m_entrants.at(i).isQualified) {
+            continue;
+        }
+        for (int j = 0; j < m_mazePaths.size(); j += 1) {
+            const RunResult& result = m_results.at(i).at(j);
+            if (
+                result.status == RunStatus::SOLVED &&
+                (fastest.at(j) < 0.0 ||
+                 result.estimatedSeconds < fastest.at(j))
+            ) {
+                fastest[j] = result.estimatedSeconds;
+            }
+        }
+    }
+
+    QVector<Standing> standings;
+    for (int i = 0; i < m_entrants.size(); i += 1) {
+        if (!m_entrants.at(i).isQualified) {
+            continue;
+        }
+        Standing standing = {i, 0, 0, 0.0, 0, 0, 0, 0.0};
+        for (int j = 0; j < m_mazePaths.size(); j += 1) {
+            const RunResult& result = m_results.at(i).at(j);
+            if (0.0 <= result.stats.cpuSeconds) {
+                standing.cpuSeconds += result.stats.cpuSeconds;
+            }
+            if (result.status == RunStatus::TIMEOUT) {
+                standing.timeouts += 1;
+            }
+            else if (result.status != RunStatus::SOLVED) {
+                standing.exited += 1;
+            }
+            else {
+                standing.solved += 1;
+                standing.totalEstimatedSeconds += result.estimatedSeconds;
+                standing.totalMoves += result.moves;
+                if (result.estimatedSeconds == fastest.at(j)) {
+                    standing.wins += 1;
+                }
+            }
+        }
+        standings.append(standing);
+    }
+
+    // Averages only make sense over the mazes that were actually solved
+    auto getAverage = [](double total, int count) {
+        return count == 0 ? 0.0 : total / count;
+    };
+    auto isAhead = [&](const Standing& a, const Standing& b) {
+        if (a.solved != b.solved) {
+            return b.solved < a.solved;
+        }
+        if (a.wins != b.wins) {
+            return b.wins < a.wins;
+        }
+        return getAverage(a.totalEstimatedSeconds, a.solved) <
+            getAverage(b.totalEstimatedSeconds, b.solved);
+    };
+    std::stable_sort(standings.begin(), standings.end(), isAhead);
+
+    QTextStream out(stdout);
+    int nameWidth = QString("algo").size();
+    for (const Entrant& entrant : m_entrants) {
+        nameWidth = qMax(nameWidth, entrant.name.size());
+    }
+    out << endl
+        << QString("rank").rightJustified(4) << "  "
+        << QString("algo").leftJustified(nameWidth)
+        << QString("solved").rightJustified(8)
+        << QString("wins").rightJustified(6)
+        << QString("avg est s").rightJustified(11)
+        << QString("avg moves").rightJustified(11)
+        << QString("timeouts").rightJustified(10)
+        << QString("exited").rightJustified(8)
+        << QString("cpu").rightJustified(10) << endl;
+
+    // Entrants that are level on everything share a rank
+    int rank = 0;
+    for (int i = 0; i < standings.size(); i += 1) {
+        const Standing& standing = standings.at(i);
+        if (i == 0 || isAhead(standings.at(i - 1), standing)) {
+            rank = i + 1;
+        }
+        double averageSeconds =
+            getAverage(standing.totalEstimatedSeconds, standing.solved);
+        double averageMoves = getAverage(standing.totalMoves, standing.solved);
+        out << QString::number(rank).rightJustified(4) << "  "
+            << m_entrants.at(standing.entrant).name.leftJustified(nameWidth)
+            << QString("%1/%2").arg(standing.solved).arg(m_mazePaths.size())
+                .rightJustified(8)
+            << QString::number(standing.wins).rightJustified(6)
+            << QString::number(averageSeconds, 'f', 3).rightJustified(11)
+            << QString::number(averageMoves, 'f', 1).rightJustified(11)
+            << QString::number(standing.timeouts).rightJustified(10)
+            << QString::number(standing.exited).rightJustified(8)
+            << QString::number(standing.cpuSeconds, 'f', 3).rightJustified(10)
+            << endl;
+    }
+    for (const Entrant& entrant : m_entrants) {
+        if (!entrant.isQualified) {
+            out << QString("-").rightJustified(4) << "  "
+                << entrant.name.leftJustified(nameWidth)
+                << "  disqualified" << endl;
+        }
+    }
+}
+
+bool TournamentRunner::writeResults() const {
+
+    // One JSON object per line, for every run
+    QFile file(m_resultsPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    for (int i = 0; i < m_entrants.size(); i += 1) {
+        if (!m_entrants.at(i).isQualified) {
+            continue;
+        }
+        for (int j = 0; j < m_mazePaths.size(); j += 1) {
+            QJsonObject object =
+                HeadlessRun::resultToJson(m_results.at(i).at(j));
+            object["algo"] = m_entrants.at(i).name;
+            file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            file.write("\n");
+        }
+    }
+    return file.error() == QFile::NoError;
+}
+
+} 
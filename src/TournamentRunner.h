@@ -0,0 +1,192 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "AlgoBuild.h"
+#include "Direction.h"
+#include "HeadlessRun.h"
+#include "ProcessLimits.h"
+#include "RemoteWorker.h"
+#include "ResultStore.h"
+
+namespace mms {
+
+class TournamentRunner : public QObject {
+
+    // Plays every algorithm against every maze, with no window. Each
+    // algorithm is built once, up front (unless nothing changed since its
+    // last successful build), and algorithms that fail to build are
+    // disqualified. Every run of every algorithm then shares a single queue,
+    // so that a fixed number of them are in flight at once, whichever
+    // algorithm they belong to. Once every run has finished, the algorithms
+    // are ranked by the number of mazes solved, then by the number of mazes
+    // on which they were the fastest, then by their average estimated time.
+    // Each run is also appended to a result store as it finishes, if there
+    // is one. Local runs may be isolated from each other by process limits,
+    // with pinned runs each on the CPU of their slot.
+    //
+    // Runs may also be sent to remote workers, which pull from the same
+    // queue as the local slots, as fast as they finish. Runs that are lost
+    // with their worker, or that a worker couldn't start, go back to the
+    // front of the queue, up to MAX_ATTEMPTS times.
+    //
+    // Every run is a job with a key (see ResultStore::getJobKey), of the
+    // version of its algorithm, its maze and the rules of the tournament. If
+    // the tournament is memoized, jobs whose key is already in the store are
+    // given the stored result instead of being run, so that only the runs of
+    // algorithms (or mazes) that changed are run again. Only local runs are
+    // stored with their key, since a worker's build, version and limits
+    // aren't those of the key.
+
+    Q_OBJECT
+
+public:
+
+    // An empty list of algorithm names enters every configured algorithm;
+    // an empty results path writes no results file. The number of local
+    // jobs may be zero if there are workers, which are "host:port" strings.
+    TournamentRunner(
+        const QStringList& algoNames,
+        const QString& mazeDirectory,
+        const QStringList& generatedMazes,
+        int numJobs,
+        const QStringList& workerAddresses,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        bool useSharedMemory,
+        bool continuous,
+        const ProcessLimits& processLimits,
+        const QString& resultsPath,
+        const QString& storePath,
+        QObject* parent = 0);
+    ~TournamentRunner();
+
+    // To be called before start(), with a store; reuses the results that
+    // the store already has for any of the jobs
+    void setMemoized(bool isMemoized);
+
+    // Returns false if the tournament can't be started at all
+    bool start();
+
+    // A local run that's in flight, as it was when it was sampled
+    struct RunSample {
+        int id;
+        int entrant;
+        int maze;
+        QPair<int, int> position;
+        Direction direction;
+    };
+
+    // The pose of the mouse of every local run that's in flight, which is
+    // only a look at each run's engine, on this thread, so that a view can
+    // sample them at a rate of its own without slowing them down; runs on
+    // workers have nothing to sample
+    QVector<RunSample> sampleRuns() const;
+
+    int getNumLocalSlots() const;
+    int getNumRuns() const;
+    int getNumFinished() const;
+    QString getEntrantName(int entrant) const;
+    QString getMazePath(int maze) const;
+
+signals:
+
+    void done();
+
+private:
+
+    static const int MAX_ATTEMPTS;
+
+    struct Entrant {
+        QString name;
+        QStringList runArguments;
+        QString directory;
+        bool isQualified;
+    };
+
+    struct Job {
+        int entrant;
+        int maze;
+        int attempts;
+        quint64 key; // zero if there's no store
+    };
+
+    QStringList m_algoNames;
+    QString m_mazeDirectory;
+    QStringList m_generatedMazes;
+    int m_numJobs;
+    QStringList m_workerAddresses;
+    double m_timeLimitSeconds;
+    qint64 m_tickLimit;
+    bool m_useSharedMemory;
+    bool m_continuous;
+    ProcessLimits m_processLimits;
+    QString m_resultsPath;
+    QString m_storePath;
+    bool m_isMemoized;
+
+    QVector<Entrant> m_entrants;
+    QVector<AlgoBuild*> m_builds;
+    int m_nextBuildIndex;
+    int m_numBuilding;
+
+    // Only the mazes that are valid, and the contents of the ones that are
+    // files, if they're sent to workers
+    QStringList m_mazePaths;
+    QVector<QByteArray> m_mazeData;
+    QVector<quint64> m_mazeHashes;
+
+    // Jobs go maze by maze, so that the runs of every algorithm are spread
+    // over the whole tournament
+    QVector<Job> m_jobs;
+    QList<int> m_queue;
+    QList<RemoteWorker*> m_workers;
+    QMap<int, HeadlessRun*> m_localRuns;
+    int m_numRunning;
+    int m_numFinished;
+
+    // One CPU for each local slot, for pinned runs, of those not in use
+    QList<int> m_freeCpus;
+
+    // The result of every entrant on every maze, which is also appended
+    // to the store, if there is one, as soon as it's known
+    QVector<QVector<RunResult>> m_results;
+    ResultStore* m_store;
+
+    // The result of every job in the store, by its key, if memoized
+    QHash<quint64, RunResult> m_memoized;
+
+    // Rejects the files that aren't valid mazes, reporting why; returns
+    // false if no valid mazes are left
+    bool loadMazePaths();
+
+    void startNextBuild();
+    void onBuildFinished(int index);
+    void onBuildsFinished();
+
+    // Everything about the tournament that could change the result of a
+    // run, as part of the key of every job
+    QString getRules() const;
+
+    // Starts queued jobs in every free slot, local or remote
+    void dispatch();
+    void startLocalJob(int id);
+    QJsonObject getRemoteJob(int id) const;
+    void onJobFinished(int id, const RunResult& result, bool isRemote);
+    void onJobsLost(const QList<int>& jobs);
+    void finish();
+
+    void printLeaderboard() const;
+    bool writeResults() const;
+};
+
+} 
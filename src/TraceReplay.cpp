@@ -0,0 +1,127 @@
+#include "TraceReplay.h"
+
+#include "AssertMacros.h"
+
+namespace mms {
+
+const int TraceReplay::MIN_CHECKPOINT_INTERVAL = 1024;
+const int TraceReplay::MAX_CHECKPOINTS = 256;
+
+TraceReplay::TraceReplay(
+        const Maze* maze,
+        MazeView* view,
+        const TraceRun& run) :
+    m_maze(maze),
+    m_view(view),
+    m_run(run),
+    m_commands(QVector<Command>()),
+    m_engine(maze, view),
+    m_position(0),
+    m_checkpointInterval(MIN_CHECKPOINT_INTERVAL) {
+
+    // Responses go nowhere, and whoever seeks redraws once it's done
+    m_engine.setInstant(true);
+    m_engine.blockSignals(true);
+
+    // Commands in traces are already parsed, so only their specs are needed
+    m_specs.fill(nullptr, NUM_OPCODES);
+    for (const CommandSpec& spec : COMMAND_SPECS()) {
+        m_specs[static_cast<int>(spec.opcode)] = &spec;
+    }
+
+    int length = m_run.numCommands;
+    if (MIN_CHECKPOINT_INTERVAL * MAX_CHECKPOINTS < length) {
+        m_checkpointInterval = (length + MAX_CHECKPOINTS - 1) / MAX_CHECKPOINTS;
+    }
+    m_checkpoints.append(m_engine.getCheckpoint());
+}
+
+TraceReplay::TraceReplay(
+        const Maze* maze,
+        MazeView* view,
+        const QVector<Command>& commands) :
+    TraceReplay(maze, view, TraceRun{QString(), nullptr, 0, commands.size()}) {
+    m_commands = commands;
+}
+
+const Mouse* TraceReplay::getMouse() const {
+    return m_engine.getMouse();
+}
+
+int TraceReplay::getVisitCount(int x, int y) const {
+    return m_engine.getVisitCount(x, y);
+}
+
+const SimulationClock& TraceReplay::getClock() const {
+    return m_engine.getClock();
+}
+
+int TraceReplay::getLength() const {
+    return m_run.numCommands;
+}
+
+int TraceReplay::getPosition() const {
+    return m_position;
+}
+
+Command TraceReplay::getCommand(int position) const {
+    ASSERT_LE(0, position);
+    ASSERT_LT(position, getLength());
+    if (m_run.file == nullptr) {
+        return m_commands.at(position);
+    }
+    return m_run.file->getCommand(m_run.firstCommand + position);
+}
+
+void TraceReplay::seek(int position) {
+    ASSERT_LE(0, position);
+    ASSERT_LE(position, getLength());
+
+    // Start from the nearest checkpoint at or before the position, unless
+    // the current position is already closer
+    int nearest = qMin(
+        position / m_checkpointInterval,
+        m_checkpoints.size() - 1
+    );
+    int nearestPosition = nearest * m_checkpointInterval;
+    if (position < m_position || m_position < nearestPosition) {
+        m_engine.restoreCheckpoint(m_checkpoints.at(nearest));
+        m_position = nearestPosition;
+    }
+    while (m_position < position) {
+        step();
+    }
+}
+
+ReplayFrame TraceReplay::getFrame() const {
+    ReplayFrame frame;
+    frame.position = m_position;
+    frame.location = getMouse()->getCurrentDiscretizedTranslation();
+    frame.direction = getMouse()->getCurrentDiscretizedRotation();
+    int numCells = m_maze->getWidth() * m_maze->getHeight();
+    frame.tiles.reserve(numCells);
+    frame.visitCounts.reserve(numCells);
+    for (int x = 0; x < m_maze->getWidth(); x += 1) {
+        for (int y = 0; y < m_maze->getHeight(); y += 1) {
+            frame.tiles.append(m_view->getMazeGraphic()->getTileState(x, y));
+            frame.visitCounts.append(m_engine.getVisitCount(x, y));
+        }
+    }
+    return frame;
+}
+
+void TraceReplay::step() {
+    Command command = getCommand(m_position);
+    const CommandSpec* spec = m_specs.at(static_cast<int>(command.opcode));
+    ASSERT_FA(spec == nullptr);
+    m_engine.dispatchCommand(command, spec);
+    m_position += 1;
+    if (
+        m_position % m_checkpointInterval == 0 &&
+        m_position / m_checkpointInterval == m_checkpoints.size()
+    ) {
+        m_checkpoints.append(m_engine.getCheckpoint());
+    }
+}
+
+} 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+#include "Command.h"
+#include "CommandTrace.h"
+#include "Direction.h"
+#include "Maze.h"
+#include "MazeView.h"
+#include "Mouse.h"
+#include "SimulationClock.h"
+#include "SimulationEngine.h"
+#include "TileGraphic.h"
+
+namespace mms {
+
+// What a replay shows at a position, without any of the buffers that draw
+// it: the mouse's pose, and the state and visits of every cell, each by its
+// index (x * height + y)
+struct ReplayFrame {
+    int position;
+    QPair<int, int> location;
+    Direction direction;
+    QVector<TileState> tiles;
+    QVector<int> visitCounts;
+};
+
+class TraceReplay {
+
+    // Drives a view and a mouse straight from a recorded run, without the
+    // algorithm that produced it. The commands are fed to an engine whose
+    // movements are instant, so any position in the run can be reached as
+    // fast as the commands can be executed; checkpoints of the engine are
+    // taken while moving forward, so that seeking backward only replays the
+    // commands since the nearest checkpoint rather than the whole run. Each
+    // checkpoint shares the columns of tiles that didn't change since the
+    // one before it (see MazeGraphic::State), so it only costs what changed.
+
+public:
+
+    // No ownership of the maze or the view - only pointers
+    TraceReplay(const Maze* maze, MazeView* view, const TraceRun& run);
+
+    // Replays commands that were never traced, e.g., a reference solver's
+    TraceReplay(
+        const Maze* maze,
+        MazeView* view,
+        const QVector<Command>& commands);
+
+    const Mouse* getMouse() const;
+
+    // How many times the mouse has visited a cell, as of the position
+    int getVisitCount(int x, int y) const;
+
+    // The simulated time of the movements replayed so far
+    const SimulationClock& getClock() const;
+
+    // The number of commands in the run, and the number replayed so far
+    int getLength() const;
+    int getPosition() const;
+    Command getCommand(int position) const;
+
+    // Replays up to the given number of commands from the start of the run
+    void seek(int position);
+
+    // What's shown at the current position, e.g., to compare it with the
+    // same position of another run of the same maze
+    ReplayFrame getFrame() const;
+
+private:
+
+    // Checkpoints are at least MIN_CHECKPOINT_INTERVAL commands apart, and
+    // further apart for long runs, so there are at most MAX_CHECKPOINTS
+    static const int MIN_CHECKPOINT_INTERVAL;
+    static const int MAX_CHECKPOINTS;
+
+    const Maze* m_maze;
+    MazeView* m_view;
+    TraceRun m_run;
+    QVector<Command> m_commands; // only if the run has no file
+    SimulationEngine m_engine;
+    QVector<const CommandSpec*> m_specs;
+    int m_position;
+    int m_checkpointInterval;
+    QVector<EngineCheckpoint> m_checkpoints;
+
+    // Replays the next command, taking a checkpoint afterward if it's due
+    void step();
+
+};
+
+} 
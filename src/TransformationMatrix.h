@@ -1,8 +1,11 @@
 #pragma once
 
-#include <QPair>
 #include <QMatrix4x4>
 
+#include "units/Angle.h"
+#include "units/Coordinate.h"
+#include "units/Distance.h"
+
 namespace mms {
 
 class TransformationMatrix {
@@ -12,26 +15,41 @@ public:
     TransformationMatrix() = delete;
 
     // Get a 4x4 matrix which, when applied to a physical coordinate in the
-    // vertex shader, transforms it into an OpenGL coordinate for the map
+    // vertex shader, transforms it into an OpenGL coordinate for the map. At
+    // a zoom of one the entire maze fits within the map; center is the
+    // physical coordinate that's shown in the middle of the map.
     static QMatrix4x4 get(
         int mazeWidth,
         int mazeHeight,
         int mapWidthPixels,
-        int mapHeightPixels);
+        int mapHeightPixels,
+        double zoom,
+        const Coordinate& center);
+
+    // Get a matrix for a square view that spans the given physical length
+    // on a side, with center in the middle, turned so that the physical
+    // direction at angle up points to the top of the view
+    static QMatrix4x4 getTurned(
+        const Distance& span,
+        const Coordinate& center,
+        const Angle& up);
+
+    // The number of pixels that a physical meter spans at the given zoom
+    static double getPixelsPerMeter(
+        int mazeWidth,
+        int mazeHeight,
+        int mapWidthPixels,
+        int mapHeightPixels,
+        double zoom);
+
+    // The physical coordinate of the center of the maze
+    static Coordinate getMazeCenter(int mazeWidth, int mazeHeight);
 
 private:
 
-    // Translate from a pixel coordinate to an OpenGL coordinate
-    // Pixel coordinate: LL is (0, 0), UR is (width, height)
-    // OpenGL coordinate: LL is (-1, -1), UR is (1, 1)
-    static QPair<double, double> pixelToOpenGl(
-        QPair<double, double> coordinate,
-        QPair<int, int> windowSize);
-
-    // Multiplies two 4x4 matrices together
-    static QVector<double> multiply4x4Matrices(
-        QVector<double> left,
-        QVector<double> right);
+    // The number of pixels between the maze and the edge of the map, when
+    // the entire maze fits within the map
+    static const int MARGIN_PIXELS;
 
 };
 
@@ -1,13 +0,0 @@
-#pragma once
-
-#include "VertexTexture.h"
-
-namespace mms {
-
-struct TriangleTexture {
-    VertexTexture p1;
-    VertexTexture p2;
-    VertexTexture p3;
-};
-
-} 
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+
+namespace mms {
+
+template<class T>
+class TripleBuffer {
+
+    // A lock-free hand-off of values from exactly one producer thread to
+    // exactly one consumer thread. The producer fills the back slot and
+    // publishes it by swapping it with the middle slot; the consumer swaps
+    // the middle slot with the front slot whenever the middle holds a value
+    // that it hasn't seen. Neither side ever waits for the other, and
+    // neither ever sees a slot that the other is using, so the consumer
+    // always reads a whole value, however often the producer publishes.
+
+public:
+
+    TripleBuffer();
+
+    // Producer only; the back slot holds whatever the consumer last gave
+    // up, so it must be filled in completely before it's published
+    T* back();
+
+    // Producer only; returns whether the consumer took the previously
+    // published value, as opposed to it being replaced before it was seen
+    bool publish();
+
+    // Consumer only; returns whether the front slot now holds a value that
+    // was published since the last call
+    bool consume();
+    const T& front() const;
+
+private:
+
+    // The middle slot's index, along with whether it's been published
+    // since the consumer last took it
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int FRESH = 4;
+
+    T m_slots[3];
+    unsigned int m_back;
+    std::atomic<unsigned int> m_middle;
+    unsigned int m_front;
+
+};
+
+template<class T>
+TripleBuffer<T>::TripleBuffer() :
+    m_slots(),
+    m_back(0),
+    m_middle(1),
+    m_front(2) {
+}
+
+template<class T>
+T* TripleBuffer<T>::back() {
+    return &m_slots[m_back];
+}
+
+template<class T>
+bool TripleBuffer<T>::publish() {
+    unsigned int middle = m_middle.exchange(
+        m_back | FRESH,
+        std::memory_order_acq_rel
+    );
+    m_back = middle & INDEX_MASK;
+    return (middle & FRESH) == 0;
+}
+
+template<class T>
+bool TripleBuffer<T>::consume() {
+    if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+        return false;
+    }
+    unsigned int middle = m_middle.exchange(
+        m_front,
+        std::memory_order_acq_rel
+    );
+    m_front = middle & INDEX_MASK;
+    return true;
+}
+
+template<class T>
+const T& TripleBuffer<T>::front() const {
+    return m_slots[m_front];
+}
+
+} 
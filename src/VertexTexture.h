@@ -1,12 +0,0 @@
-#pragma once
-
-namespace mms {
-
-struct VertexTexture {
-    float x; // x position
-    float y; // y position
-    float u; // u position (x position in the texture)
-    float v; // v position (y position in the texture)
-};
-
-} 
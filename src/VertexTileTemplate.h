@@ -0,0 +1,18 @@
+#pragma once
+
+namespace mms {
+
+// A vertex of the mesh that's drawn once for every tile. Positions are
+// relative to the lower left corner of the tile; vertices are pushed outward
+// by half a wall width, times their outward components, when that edge of
+// the tile is also the edge of the maze, so that the outermost walls are
+// fully visible.
+struct VertexTileTemplate {
+    float x; // x position
+    float y; // y position
+    float outwardX; // negative (left edge), 0 (interior) or positive (right)
+    float outwardY; // negative (bottom edge), 0 (interior) or positive (top)
+    float part; // 0 (base), 1 + DIRECTION_INDEX(wall) or 5 (corner)
+};
+
+}
@@ -0,0 +1,243 @@
+#include "VideoExport.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QScopedPointer>
+#include <QVector>
+
+#include "AssertMacros.h"
+#include "MazeError.h"
+#include "MazeGenerator.h"
+#include "MazeView.h"
+#include "MouseGraphic.h"
+#include "SimulationClock.h"
+#include "TraceReplay.h"
+
+namespace mms {
+
+const qint64 VideoExport::MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+bool VideoExport::run(
+        const QString& tracePath,
+        int run,
+        const QString& outputPath,
+        const QString& encoder,
+        int width,
+        int height,
+        int framesPerSecond,
+        double speed,
+        RenderBackend backend) {
+
+    ASSERT_LT(0, width);
+    ASSERT_LT(0, height);
+    ASSERT_LT(0, framesPerSecond);
+    ASSERT_LT(0.0, speed);
+
+    // Map the trace, just like a replay
+    QVector<TraceRun> runs;
+    if (!CommandTrace::read(tracePath, &runs)) {
+        qWarning() << "Unable to read command trace file:" << tracePath;
+        return false;
+    }
+    if (run < 0 || runs.size() < run || runs.isEmpty()) {
+        qWarning()
+            << "No run" << run
+            << "in command trace file:" << tracePath;
+        return false;
+    }
+    const TraceRun& exported = runs.at(run == 0 ? runs.size() - 1 : run - 1);
+    MazeError error;
+    Maze* maze = MazeGenerator::load(exported.mazeSource, &error);
+    if (maze == nullptr) {
+        qWarning()
+            << "Unable to load the maze of the exported run:"
+            << exported.mazeSource
+            << Maze::errorToString(error);
+        return false;
+    }
+
+    // Either the encoder reads the frames from its standard input, or they
+    // go straight to the file
+    QProcess process;
+    QFile file(outputPath);
+    QIODevice* output = &file;
+    bool ok = true;
+    if (encoder.isEmpty()) {
+        ok = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    else {
+        process.setProcessChannelMode(QProcess::ForwardedChannels);
+        process.start(encoder, {
+            "-y",
+            "-loglevel", "error",
+            "-f", "rawvideo",
+            "-pix_fmt", "rgb24",
+            "-s", QString("%1x%2").arg(width).arg(height),
+            "-r", QString::number(framesPerSecond),
+            "-i", "-",
+            outputPath,
+        });
+        ok = process.waitForStarted(-1);
+        output = &process;
+    }
+    if (!ok) {
+        qWarning() << "Unable to write the video:" << output->errorString();
+        delete maze;
+        return false;
+    }
+
+    ok = render(
+        maze,
+        exported,
+        output,
+        width,
+        height,
+        framesPerSecond,
+        speed,
+        backend
+    );
+    delete maze;
+    if (encoder.isEmpty()) {
+        file.close();
+        return ok;
+    }
+    process.closeWriteChannel();
+    process.waitForFinished(-1);
+    if (
+        process.exitStatus() != QProcess::NormalExit ||
+        process.exitCode() != 0
+    ) {
+        qWarning() << "The encoder failed with exit code" << process.exitCode();
+        return false;
+    }
+    return ok;
+}
+
+bool VideoExport::render(
+        const Maze* maze,
+        const TraceRun& run,
+        QIODevice* output,
+        int width,
+        int height,
+        int framesPerSecond,
+        double speed,
+        RenderBackend backend) {
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The same view and mouse as a replay in the window, but drawn by a
+    // renderer, which shows the whole maze
+    MazeView view(maze);
+    TraceReplay replay(maze, &view, run);
+    MouseGraphic mouseGraphic(replay.getMouse());
+    QScopedPointer<MapRenderer> renderer(
+        MapRenderer::create(backend, width, height)
+    );
+    if (renderer.isNull()) {
+        return false;
+    }
+    renderer->setMaze(maze);
+    renderer->setView(&view);
+    renderer->setMouseGraphic(&mouseGraphic);
+
+    // The frame that's written is always the most recent one rendered
+    QByteArray frame;
+    int numFrames = 0;
+    int numRendered = 0;
+    auto renderFrame = [&]() {
+        view.publishSnapshot();
+        frame = toBytes(renderer->render());
+        numRendered += 1;
+    };
+
+    // Writes the frame for every frame time before the given ticks
+    double ticksPerFrame =
+        speed * SimulationClock::TICKS_PER_SECOND / framesPerSecond;
+    auto writeFrames = [&](qint64 ticks) {
+        while (qRound64(numFrames * ticksPerFrame) < ticks) {
+            if (output->write(frame) != frame.size()) {
+                return false;
+            }
+            numFrames += 1;
+            if (MAX_PENDING_BYTES < output->bytesToWrite()) {
+                output->waitForBytesWritten(-1);
+            }
+        }
+        return true;
+    };
+
+    // A movement completes as soon as it's replayed, so the frames from the
+    // start of the movement until the clock's new time show the state from
+    // before it, which has to be rendered first
+    renderFrame();
+    bool isStale = false;
+    for (int i = 0; i < replay.getLength(); i += 1) {
+        if (isStale && isMovement(replay.getCommand(i).opcode)) {
+            renderFrame();
+            isStale = false;
+        }
+        replay.seek(i + 1);
+        if (!writeFrames(replay.getClock().getTicks())) {
+            qWarning() << "Unable to write the video:" << output->errorString();
+            return false;
+        }
+        isStale = true;
+    }
+
+    // Hold the final state for a second
+    if (isStale) {
+        renderFrame();
+    }
+    qint64 end = qRound64((numFrames + framesPerSecond) * ticksPerFrame);
+    if (!writeFrames(end)) {
+        qWarning() << "Unable to write the video:" << output->errorString();
+        return false;
+    }
+    output->waitForBytesWritten(-1);
+
+    double videoSeconds = static_cast<double>(numFrames) / framesPerSecond;
+    qInfo().noquote().nospace()
+        << "Exported " << numFrames << " frames ("
+        << QString::number(videoSeconds, 'f', 1)
+        << " seconds of video), of which " << numRendered
+        << " were rendered, in "
+        << QString::number(timer.nsecsElapsed() / 1e9, 'f', 1) << " seconds";
+    return true;
+}
+
+bool VideoExport::isMovement(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::MOVE_FORWARD:
+        case Opcode::TURN_RIGHT:
+        case Opcode::TURN_LEFT:
+        case Opcode::CURVE_RIGHT:
+        case Opcode::CURVE_LEFT:
+        case Opcode::CURVE_RIGHT_180:
+        case Opcode::CURVE_LEFT_180:
+        case Opcode::DIAGONAL_RIGHT:
+        case Opcode::DIAGONAL_LEFT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+QByteArray VideoExport::toBytes(const QImage& image) {
+    // Rows of the image may be padded, but rows of raw video aren't
+    QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    int rowBytes = 3 * rgb.width();
+    QByteArray bytes;
+    bytes.reserve(rowBytes * rgb.height());
+    for (int y = 0; y < rgb.height(); y += 1) {
+        bytes.append(
+            reinterpret_cast<const char*>(rgb.constScanLine(y)),
+            rowBytes
+        );
+    }
+    return bytes;
+}
+
+} 
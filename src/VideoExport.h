@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QIODevice>
+#include <QString>
+
+#include "Command.h"
+#include "CommandTrace.h"
+#include "MapRenderer.h"
+#include "Maze.h"
+
+namespace mms {
+
+class VideoExport {
+
+    // Renders a run from a command trace without showing any window, with a
+    // map renderer (see MapRenderer), and streams the frames as
+    // raw RGB bytes to the standard input of an encoder (or straight to a
+    // file). Frames are spaced evenly in the simulated time of the run, as
+    // kept by the engine's clock, rather than in wall-clock time, so that the
+    // video plays the run at its simulated pace (times the speed), however
+    // fast it's exported. Movements are instant, so only the state before
+    // each movement is ever rendered, and frames that show nothing new are
+    // written again without being rendered.
+
+public:
+
+    VideoExport() = delete;
+
+    // Exports the given run of the trace (counting from one, or zero for the
+    // last) to the output path; the encoder is the program that encodes the
+    // frames, with ffmpeg's arguments, or empty to write the raw frames to
+    // the output path instead, and the backend draws the frames. Returns
+    // false, having logged why, if anything couldn't be read, created or
+    // written.
+    static bool run(
+        const QString& tracePath,
+        int run,
+        const QString& outputPath,
+        const QString& encoder,
+        int width,
+        int height,
+        int framesPerSecond,
+        double speed,
+        RenderBackend backend);
+
+private:
+
+    // Once more than this many bytes are waiting for the encoder, rendering
+    // waits for it to catch up
+    static const qint64 MAX_PENDING_BYTES;
+
+    static bool render(
+        const Maze* maze,
+        const TraceRun& run,
+        QIODevice* output,
+        int width,
+        int height,
+        int framesPerSecond,
+        double speed,
+        RenderBackend backend);
+
+    // Whether a command advances the simulated time
+    static bool isMovement(Opcode opcode);
+
+    // The pixels of an image as rgb24, row by row from the top
+    static QByteArray toBytes(const QImage& image);
+
+};
+
+} 
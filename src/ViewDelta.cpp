@@ -0,0 +1,291 @@
+#include "ViewDelta.h"
+
+#include "AssertMacros.h"
+#include "FontImage.h"
+
+namespace mms {
+
+const quint8 ViewDelta::VERSION = 1;
+
+ViewDelta::ViewDelta() :
+    m_bytes(QByteArray()),
+    m_end(0),
+    m_open(NUM_FIELDS, {WALLS, 0, 0, 0, QString()}) {
+}
+
+void ViewDelta::setWalls(int tile, unsigned char walls) {
+    add({WALLS, tile, 1, walls, QString()});
+}
+
+void ViewDelta::setColor(int tile, Color color) {
+    add({COLOR, tile, 1, static_cast<int>(color), QString()});
+}
+
+void ViewDelta::setHeat(int tile, int heat) {
+    add({HEAT, tile, 1, heat, QString()});
+}
+
+void ViewDelta::setText(int tile, const QString& text) {
+    add({TEXT, tile, 1, 0, text});
+}
+
+void ViewDelta::setDifference(
+        int tile,
+        const TileState& before,
+        const TileState& after) {
+    if (before.declaredWalls != after.declaredWalls) {
+        setWalls(tile, after.declaredWalls);
+    }
+    if (before.color != after.color) {
+        setColor(tile, after.color);
+    }
+    if (before.heat != after.heat) {
+        setHeat(tile, after.heat);
+    }
+    if (before.text != after.text) {
+        setText(tile, after.text);
+    }
+}
+
+bool ViewDelta::isEmpty() const {
+    if (!m_bytes.isEmpty()) {
+        return false;
+    }
+    for (const Batch& batch : m_open) {
+        if (0 < batch.count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray ViewDelta::encode() const {
+    QByteArray bytes(1, static_cast<char>(VERSION));
+    bytes += m_bytes;
+    int end = m_end;
+    for (const Batch& batch : m_open) {
+        if (0 < batch.count) {
+            append(&bytes, &end, batch);
+        }
+    }
+    return bytes;
+}
+
+bool ViewDelta::apply(const QByteArray& bytes, QVector<TileState>* tiles) {
+    QVector<Batch> batches;
+    if (!decode(bytes, tiles->size(), &batches)) {
+        return false;
+    }
+    for (const Batch& batch : batches) {
+        for (int i = batch.first; i < batch.first + batch.count; i += 1) {
+            TileState& tile = (*tiles)[i];
+            if (batch.field == WALLS) {
+                tile.declaredWalls = static_cast<unsigned char>(batch.value);
+            }
+            else if (batch.field == COLOR) {
+                tile.color = static_cast<Color>(batch.value);
+            }
+            else if (batch.field == HEAT) {
+                tile.heat = batch.value;
+            }
+            else {
+                tile.text = batch.text;
+            }
+        }
+    }
+    return true;
+}
+
+bool ViewDelta::apply(
+        const QByteArray& bytes,
+        int width,
+        int height,
+        MazeGraphic* graphic) {
+    ASSERT_LT(0, height);
+    QVector<Batch> batches;
+    if (!decode(bytes, width * height, &batches)) {
+        return false;
+    }
+    for (Batch& batch : batches) {
+        for (int i = 0; i < batch.text.size(); i += 1) {
+            if (!FontImage::isValid(batch.text.at(i))) {
+                batch.text[i] = '?';
+            }
+        }
+        for (int i = batch.first; i < batch.first + batch.count; i += 1) {
+            int x = i / height;
+            int y = i % height;
+            if (batch.field == WALLS) {
+                graphic->setWalls(
+                    x, y, static_cast<unsigned char>(batch.value));
+            }
+            else if (batch.field == COLOR) {
+                graphic->setColor(x, y, static_cast<Color>(batch.value));
+            }
+            else if (batch.field == HEAT && batch.value == -1) {
+                graphic->clearHeat(x, y);
+            }
+            else if (batch.field == HEAT) {
+                graphic->setHeat(x, y, batch.value);
+            }
+            else {
+                graphic->setText(x, y, batch.text);
+            }
+        }
+    }
+    return true;
+}
+
+void ViewDelta::add(const Batch& change) {
+    Batch& open = m_open[change.field];
+    if (
+        0 < open.count &&
+        change.first == open.first + open.count &&
+        change.value == open.value &&
+        change.text == open.text
+    ) {
+        open.count += 1;
+        return;
+    }
+    if (0 < open.count) {
+        append(&m_bytes, &m_end, open);
+    }
+    open = change;
+}
+
+void ViewDelta::append(QByteArray* bytes, int* end, const Batch& batch) {
+    bytes->append(static_cast<char>(batch.field));
+    appendVarint(bytes, toZigzag(static_cast<qint64>(batch.first) - *end));
+    appendVarint(bytes, static_cast<quint64>(batch.count));
+    if (batch.field == WALLS || batch.field == COLOR) {
+        bytes->append(static_cast<char>(batch.value));
+    }
+    else if (batch.field == HEAT) {
+        appendVarint(bytes, toZigzag(batch.value));
+    }
+    else {
+        QByteArray text = batch.text.toUtf8();
+        appendVarint(bytes, static_cast<quint64>(text.size()));
+        bytes->append(text);
+    }
+    *end = batch.first + batch.count;
+}
+
+bool ViewDelta::decode(
+        const QByteArray& bytes,
+        int numTiles,
+        QVector<Batch>* batches) {
+    if (bytes.isEmpty() || static_cast<quint8>(bytes.at(0)) != VERSION) {
+        return false;
+    }
+    int position = 1;
+    qint64 end = 0;
+    while (position < bytes.size()) {
+        Batch batch = {WALLS, 0, 0, 0, QString()};
+        int field = static_cast<uchar>(bytes.at(position));
+        position += 1;
+        if (NUM_FIELDS <= field) {
+            return false;
+        }
+        batch.field = static_cast<Field>(field);
+
+        // The run has to be within the tiles, checked in 64 bits so that
+        // huge numbers can't overflow
+        quint64 difference = 0;
+        quint64 count = 0;
+        if (
+            !readVarint(bytes, &position, &difference) ||
+            !readVarint(bytes, &position, &count)
+        ) {
+            return false;
+        }
+        qint64 first = end + fromZigzag(difference);
+        if (
+            first < 0 || count < 1 ||
+            static_cast<quint64>(numTiles) < count ||
+            numTiles - static_cast<qint64>(count) < first
+        ) {
+            return false;
+        }
+        batch.first = static_cast<int>(first);
+        batch.count = static_cast<int>(count);
+        end = first + static_cast<qint64>(count);
+
+        quint64 value = 0;
+        if (batch.field == WALLS || batch.field == COLOR) {
+            if (bytes.size() <= position) {
+                return false;
+            }
+            batch.value = static_cast<uchar>(bytes.at(position));
+            position += 1;
+            int limit = batch.field == WALLS ? 0xf : NUM_COLORS - 1;
+            if (limit < batch.value) {
+                return false;
+            }
+        }
+        else if (batch.field == HEAT) {
+            if (!readVarint(bytes, &position, &value)) {
+                return false;
+            }
+            qint64 heat = fromZigzag(value);
+            if (heat < -1 || 255 < heat) {
+                return false;
+            }
+            batch.value = static_cast<int>(heat);
+        }
+        else {
+            if (
+                !readVarint(bytes, &position, &value) ||
+                static_cast<quint64>(bytes.size() - position) < value
+            ) {
+                return false;
+            }
+            batch.text = QString::fromUtf8(
+                bytes.constData() + position,
+                static_cast<int>(value)
+            );
+            position += static_cast<int>(value);
+        }
+        batches->append(batch);
+    }
+    return true;
+}
+
+void ViewDelta::appendVarint(QByteArray* bytes, quint64 value) {
+    while (0x80 <= value) {
+        bytes->append(static_cast<char>(0x80 | (value & 0x7f)));
+        value >>= 7;
+    }
+    bytes->append(static_cast<char>(value));
+}
+
+bool ViewDelta::readVarint(
+        const QByteArray& bytes,
+        int* position,
+        quint64* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (bytes.size() <= *position) {
+            return false;
+        }
+        quint64 byte = static_cast<uchar>(bytes.at(*position));
+        *position += 1;
+        *value |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint64 ViewDelta::toZigzag(qint64 value) {
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(
+        value < 0 ? -1 : 0
+    );
+}
+
+qint64 ViewDelta::fromZigzag(quint64 value) {
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+} 
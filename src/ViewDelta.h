@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "Color.h"
+#include "MazeGraphic.h"
+#include "TileGraphic.h"
+
+namespace mms {
+
+class ViewDelta {
+
+    // A compact, versioned description of changes to the tiles of a view
+    // (see TileState), for whatever has to send or store them, e.g., the
+    // spectator stream. Tiles are numbered by column, x * height + y, as
+    // everywhere else. A delta is its version, followed by batches, each of
+    // which sets one field of a run of consecutive tiles to one value: the
+    // field, the first tile of the run (a zigzag varint, relative to the end
+    // of the previous batch), the length of the run (a varint), and the
+    // value, i.e., the declared walls or the color in a byte, the heat as a
+    // zigzag varint (-1 for none), or the text as a varint length and UTF-8.
+    // Every field has a batch of its own open while changes are added, which
+    // grows for as long as they're to the next tile, with the same value, so
+    // a column of tiles set to the same color costs a single batch, however
+    // the changes to other fields are interleaved. Deltas are applied straight
+    // to the tile states, or to a maze graphic, without going through the
+    // engine (or its command parser).
+
+public:
+
+    ViewDelta();
+
+    static const quint8 VERSION;
+
+    void setWalls(int tile, unsigned char walls);
+    void setColor(int tile, Color color);
+    void setHeat(int tile, int heat);
+    void setText(int tile, const QString& text);
+
+    // Every field that differs between the two states of the tile
+    void setDifference(
+        int tile,
+        const TileState& before,
+        const TileState& after);
+
+    bool isEmpty() const;
+    QByteArray encode() const;
+
+    // Each applies every batch in order, and returns false without having
+    // applied any of them if the delta isn't valid, or sets a tile past the
+    // last one; text that isn't in the font image is applied as '?'
+    static bool apply(const QByteArray& bytes, QVector<TileState>* tiles);
+    static bool apply(
+        const QByteArray& bytes,
+        int width,
+        int height,
+        MazeGraphic* graphic);
+
+private:
+
+    enum Field {
+        WALLS,
+        COLOR,
+        HEAT,
+        TEXT,
+        NUM_FIELDS,
+    };
+
+    struct Batch {
+        Field field;
+        int first;
+        int count; // zero for an open batch with nothing in it yet
+        int value; // of every field but the text
+        QString text;
+    };
+
+    // The batches that were closed, encoded in order, and the end of the
+    // last one, which the next is encoded relative to
+    QByteArray m_bytes;
+    int m_end;
+    QVector<Batch> m_open;
+
+    void add(const Batch& change);
+    static void append(QByteArray* bytes, int* end, const Batch& batch);
+    static bool decode(
+        const QByteArray& bytes,
+        int numTiles,
+        QVector<Batch>* batches);
+
+    static void appendVarint(QByteArray* bytes, quint64 value);
+    static bool readVarint(
+        const QByteArray& bytes,
+        int* position,
+        quint64* value);
+    static quint64 toZigzag(qint64 value);
+    static qint64 fromZigzag(quint64 value);
+
+};
+
+} 
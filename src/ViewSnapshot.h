@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QVector>
+
+#include "DirtyRange.h"
+#include "GlyphInstance.h"
+#include "TileInstance.h"
+
+namespace mms {
+
+// Everything that the map needs to draw a view, as of the last time the view
+// was published. The instance buffers are implicitly shared with the view,
+// so publishing them only copies a buffer once the view next changes it.
+// The dirty ranges are those that changed since the snapshot that the map
+// last took, so that only they need to be uploaded; tiles whose heat (and
+// nothing else) changed are in ranges of their own.
+struct ViewSnapshot {
+    QVector<TileInstance> tileInstances;
+    QVector<GlyphInstance> glyphInstances;
+    QVector<DirtyRange> tileDirtyRanges;
+    QVector<DirtyRange> tileHeatDirtyRanges;
+    QVector<DirtyRange> glyphDirtyRanges;
+    int textureLayoutVersion;
+};
+
+} 
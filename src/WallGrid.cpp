@@ -0,0 +1,153 @@
+#include "WallGrid.h"
+
+#include <cstring>
+
+#include <QHash>
+
+namespace mms {
+
+WallGrid::WallGrid() :
+    m_width(0),
+    m_height(0) {
+}
+
+WallGrid::WallGrid(int width, int height) :
+    m_width(width),
+    m_height(height) {
+    ASSERT_LE(0, width);
+    ASSERT_LE(0, height);
+
+    // Every chunk starts out as the same chunk, without walls
+    int numChunks = (width * height + CHUNK_CELLS - 1) >> CHUNK_SHIFT;
+    if (0 < numChunks) {
+        m_copies.fill(0, CHUNK_BYTES);
+        m_offsets.fill(0, numChunks);
+        m_numUsers.append(numChunks);
+    }
+}
+
+WallGrid::WallGrid(int width, int height, const unsigned char* bytes) :
+    WallGrid(width, height) {
+
+    // Each chunk gets a copy of its own, and then those that are alike are
+    // merged back together
+    int numBytes = getNumBytes(width, height);
+    int numChunks = m_offsets.size();
+    m_copies.fill(0, numChunks * CHUNK_BYTES);
+    m_numUsers.fill(1, numChunks);
+    for (int i = 0; i < numChunks; i += 1) {
+        m_offsets[i] = i * CHUNK_BYTES;
+    }
+    std::memcpy(m_copies.data(), bytes, numBytes);
+    compact();
+}
+
+int WallGrid::getNumBytes(int width, int height) {
+    return (width * height + 1) / 2;
+}
+
+QByteArray WallGrid::toBytes() const {
+    int numBytes = getNumBytes(m_width, m_height);
+    QByteArray bytes(numBytes, '\0');
+    for (int i = 0; i < m_offsets.size(); i += 1) {
+        int begin = i * CHUNK_BYTES;
+        int end = qMin(numBytes, begin + CHUNK_BYTES);
+        std::memcpy(
+            bytes.data() + begin,
+            m_copies.constData() + m_offsets.at(i),
+            end - begin
+        );
+    }
+    return bytes;
+}
+
+int WallGrid::getWidth() const {
+    return m_width;
+}
+
+int WallGrid::getHeight() const {
+    return m_height;
+}
+
+void WallGrid::setWall(int x, int y, Direction direction, bool isWall) {
+    int cell = getIndex(x, y);
+    unsigned char& bits =
+        getOwnCopy(cell >> CHUNK_SHIFT)[(cell & (CHUNK_CELLS - 1)) / 2];
+    unsigned char mask = 1 << (4 * (cell % 2) + DIRECTION_INDEX(direction));
+    if (isWall) {
+        bits |= mask;
+    }
+    else {
+        bits &= ~mask;
+    }
+}
+
+int WallGrid::getNumChunks() const {
+    return m_offsets.size();
+}
+
+int WallGrid::getChunkId(int chunk) const {
+    return m_offsets.at(chunk) / CHUNK_BYTES;
+}
+
+int WallGrid::getNumChunkIds() const {
+    return m_numUsers.size();
+}
+
+void WallGrid::compact() {
+
+    // The first chunk with each set of walls keeps its id, in the order of
+    // the chunks, so that compacting a compact grid changes nothing
+    QVector<unsigned char> copies;
+    QVector<int> numUsers;
+    QHash<QByteArray, int> ids;
+    for (int i = 0; i < m_offsets.size(); i += 1) {
+        QByteArray walls = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(m_copies.constData()) +
+                m_offsets.at(i),
+            CHUNK_BYTES
+        );
+        int id = ids.value(walls, -1);
+        if (id < 0) {
+            id = numUsers.size();
+            ids.insert(walls, id);
+            numUsers.append(0);
+            copies.resize(copies.size() + CHUNK_BYTES);
+            std::memcpy(
+                copies.data() + id * CHUNK_BYTES,
+                walls.constData(),
+                CHUNK_BYTES
+            );
+        }
+        numUsers[id] += 1;
+        m_offsets[i] = id * CHUNK_BYTES;
+    }
+    m_copies.swap(copies);
+    m_numUsers.swap(numUsers);
+}
+
+qint64 WallGrid::getMemoryBytes() const {
+    return
+        m_copies.size() +
+        static_cast<qint64>(sizeof(int)) *
+            (m_offsets.size() + m_numUsers.size());
+}
+
+unsigned char* WallGrid::getOwnCopy(int chunk) {
+    int id = getChunkId(chunk);
+    if (1 < m_numUsers.at(id)) {
+        int ownId = m_numUsers.size();
+        m_copies.resize(m_copies.size() + CHUNK_BYTES);
+        m_numUsers.append(1);
+        std::memcpy(
+            m_copies.data() + ownId * CHUNK_BYTES,
+            m_copies.constData() + id * CHUNK_BYTES,
+            CHUNK_BYTES
+        );
+        m_numUsers[id] -= 1;
+        m_offsets[chunk] = ownId * CHUNK_BYTES;
+    }
+    return m_copies.data() + m_offsets.at(chunk);
+}
+
+} 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+
+#include "AssertMacros.h"
+#include "Direction.h"
+
+namespace mms {
+
+class WallGrid {
+
+    // The walls of every cell of a maze, four bits per cell (one for each
+    // direction, by the value of the Direction), two cells per byte, by the
+    // index of the cell (x * height + y), i.e., column by column. Each wall
+    // is stored by both of the cells that it separates, so that every lookup
+    // is a single read (of the cell's chunk, and then of its byte). The
+    // lookups are defined in this header, so that they inline into the
+    // searches and the engine's wall queries.
+    //
+    // The cells are stored in chunks of CHUNK_CELLS consecutive cells, and
+    // chunks with the same walls share a single copy of them, which is only
+    // copied (for the chunk alone) once a wall of the chunk is set; huge,
+    // mostly open mazes, most of whose chunks are alike, take little more
+    // than a copy of each chunk that has walls of its own. Whatever shares a
+    // copy has the same id, so that traversals can do their work once for
+    // each of them (see FloodFill); since walls can be set one by one, two
+    // chunks with different ids may still have the same walls, until the
+    // grid is compacted.
+
+public:
+
+    static const int CHUNK_SHIFT = 9;
+    static const int CHUNK_CELLS = 1 << CHUNK_SHIFT;
+    static const int CHUNK_BYTES = CHUNK_CELLS / 2;
+
+    WallGrid();
+    WallGrid(int width, int height);
+
+    // The packed representation, as written to binary maze files, which is
+    // the chunks one after another, without the rest of the last one
+    WallGrid(int width, int height, const unsigned char* bytes);
+    static int getNumBytes(int width, int height);
+    QByteArray toBytes() const;
+
+    int getWidth() const;
+    int getHeight() const;
+
+    bool isWall(int x, int y, Direction direction) const;
+
+    // All four walls of the cell at index x * height + y, one bit for each
+    // direction, by the value of the Direction
+    int getWallBits(int cell) const;
+    void setWall(int x, int y, Direction direction, bool isWall);
+
+    // The chunk of the cell at index i is i >> CHUNK_SHIFT, and the cells
+    // past the end of the last one have no walls; ids are below the number
+    // of ids
+    int getNumChunks() const;
+    int getChunkId(int chunk) const;
+    int getNumChunkIds() const;
+
+    // Shares a single copy of the walls of every set of chunks that have
+    // the same walls
+    void compact();
+
+    // What the walls take, in bytes (of the copies and the chunks' ids)
+    qint64 getMemoryBytes() const;
+
+private:
+
+    int m_width;
+    int m_height;
+
+    // The copies of the chunks, each CHUNK_BYTES long, the id of each chunk
+    // (the index of its copy) times CHUNK_BYTES, and the number of chunks
+    // that use each copy, which is never zero
+    QVector<unsigned char> m_copies;
+    QVector<int> m_offsets;
+    QVector<int> m_numUsers;
+
+    int getIndex(int x, int y) const;
+
+    // The copy of the walls of the chunk that only the chunk uses, which it
+    // gets a copy of its own of first, if it has to
+    unsigned char* getOwnCopy(int chunk);
+
+};
+
+inline bool WallGrid::isWall(int x, int y, Direction direction) const {
+    return (getWallBits(getIndex(x, y)) >> DIRECTION_INDEX(direction)) & 1;
+}
+
+inline int WallGrid::getWallBits(int cell) const {
+    int offset = m_offsets.at(cell >> CHUNK_SHIFT);
+    int byte = m_copies.at(offset + (cell & (CHUNK_CELLS - 1)) / 2);
+    return (byte >> (4 * (cell % 2))) & 0xf;
+}
+
+inline int WallGrid::getIndex(int x, int y) const {
+    ASSERT_LE(0, x);
+    ASSERT_LE(0, y);
+    ASSERT_LT(x, m_width);
+    ASSERT_LT(y, m_height);
+    return m_height * x + y;
+}
+
+} 
@@ -1,6 +1,7 @@
 #include "Window.h"
 
 #include <QAction>
+#include <QDateTime>
 #include <QDebug>
 #include <QDoubleSpinBox>
 #include <QFileDialog>
@@ -8,25 +9,33 @@
 #include <QFrame>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QInputDialog>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLinkedList>
+#include <QLoggingCategory>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QPixmap>
+#include <QScrollBar>
+#include <QProgressBar>
+#include <QSet>
 #include <QShortcut>
+#include <QSignalBlocker>
 #include <QSplitter>
 #include <QTabWidget>
-#include <QTimer>
 #include <QVBoxLayout>
 #include <QtMath>
 
+#include "AllocationCounter.h"
 #include "AssertMacros.h"
-#include "Color.h"
-#include "ColorManager.h"
 #include "ConfigDialog.h"
-#include "Dimensions.h"
-#include "FontImage.h"
+#include "MazeGenerator.h"
 #include "ProcessUtilities.h"
+#include "Profiler.h"
+#include "ReferenceSolvers.h"
 #include "SettingsMazeFiles.h"
 #include "SettingsMouseAlgos.h"
 #include "SettingsMisc.h"
@@ -45,17 +54,19 @@ const QString Window::FAILED_STYLE_SHEET =
 const QString Window::ERROR_STYLE_SHEET =
     "QLabel { background: rgb(230, 150, 230); }";
 
-const QString Window::ACK = "ack";
-const QString Window::CRASH = "crash";
-const QString Window::INVALID = "invalid";
-
 const int Window::SPEED_SLIDER_MAX = 99;
 const int Window::SPEED_SLIDER_DEFAULT = 33;
-const double Window::PROGRESS_REQUIRED_FOR_MOVE = 100.0;
-const double Window::PROGRESS_REQUIRED_FOR_TURN = 33.33;
-const double Window::MIN_PROGRESS_PER_SECOND = 10.0;
-const double Window::MAX_PROGRESS_PER_SECOND = 5000.0;
-const double Window::MAX_SLEEP_SECONDS = 0.008;
+const int Window::RUN_OUTPUT_FLUSH_MS = 250;
+const int Window::DEFAULT_RUN_OUTPUT_MAX_LINES = 10000;
+const int Window::DEFAULT_QUEUE_LIMIT = 1024;
+const int Window::REPLAY_TICK_MS = 16;
+const int Window::LATENCY_REFRESH_MS = 500;
+const int Window::STATS_REFRESH_MS = 250;
+const int Window::WATCH_MS = 1000;
+
+const QString Window::BLANK_MAZE_FILE = ":/resources/mazes/blank.num";
+
+Q_LOGGING_CATEGORY(STARTUP_LOG, "mms.startup")
 
 Window::Window(QWidget *parent) :
     QMainWindow(parent),
@@ -65,11 +76,36 @@ Window::Window(QWidget *parent) :
     m_maze(nullptr),
     m_truth(nullptr),
     m_currentMazeFile(QString()),
-    m_mazeFileComboBox(new QComboBox()),
+    m_mazeFileComboBox(new SearchableComboBox()),
+    m_mazeEditButton(new QToolButton()),
+    m_mazeEditMenu(new QMenu(this)),
+    m_editedMaze(nullptr),
+    m_editedTruth(nullptr),
+    m_loadThread(new QThread(this)),
+    m_mazeLoader(new MazeLoader()),
+    m_loadNumber(0),
+    m_isLoadingNewPath(false),
+    m_startupMazeFile(QString()),
+    m_startupLoadNumber(-1),
+    m_startupTimer(QElapsedTimer()),
+    m_isFirstFrameLogged(false),
+    m_isStartupMazeShown(false),
+    m_loadProgressBar(new QProgressBar()),
+    m_thumbnailThread(new QThread(this)),
+    m_mazeThumbnailer(new MazeThumbnailer()),
+    m_mazeListModel(new MazeListModel(m_mazeThumbnailer, this)),
+    m_libraryThread(new QThread(this)),
+    m_mazeLibrary(new MazeLibrary()),
+    m_mazeLibraryMenu(new QMenu(this)),
+    m_libraryEntries(QMap<QString, QVector<MazeLibraryEntry>>()),
 
     // Algo config
-    m_mouseAlgoComboBox(new QComboBox()),
+    m_mouseAlgoComboBox(new SearchableComboBox()),
     m_mouseAlgoEditButton(new QToolButton()),
+    m_rivalsButton(new QToolButton()),
+    m_rivalsMenu(new QMenu(this)),
+    m_ghostsButton(new QToolButton()),
+    m_ghostsMenu(new QMenu(this)),
 
     // Algo output
     m_mouseAlgoOutputTabWidget(new QTabWidget()),
@@ -81,37 +117,138 @@ Window::Window(QWidget *parent) :
     m_buildProcess(nullptr),
     m_buildStatus(new QLabel()),
 
+    // Algo watch
+    m_watchCheckBox(new QCheckBox("Watch")),
+    m_fastForwardCheckBox(new QCheckBox("Fast-forward")),
+    m_watchTimer(new QTimer(this)),
+    m_watchName(),
+    m_watchFingerprint(),
+    m_isWatchChangePending(false),
+    m_isReloading(false),
+    m_previousTrail(QVector<QPair<int, int>>()),
+    m_previousTrailMaze(),
+
     // Algo run
     m_runButton(new QPushButton("Run")),
-    m_runProcess(nullptr),
     m_runStatus(new QLabel()),
-    m_mouse(nullptr),
+    m_ioThread(new QThread(this)),
+    m_runWorker(nullptr),
+    m_runNumber(0),
+    m_queueLimit(DEFAULT_QUEUE_LIMIT),
+    m_contestRules(ContestScorer::DEFAULT_RULES()),
+    m_runOutputTimer(new QTimer(this)),
+    m_runLog(nullptr),
+    m_commandTrace(nullptr),
+    m_commandTracePath(QString()),
+    m_spectatorServer(nullptr),
+    m_runMeter(new RunMeter(this)),
+    m_commandLatency(CommandLatency()),
+    m_latencyOutput(new QPlainTextEdit()),
+    m_latencyTimer(new QTimer(this)),
+    m_latencyLog(nullptr),
+    m_runSummaryLog(nullptr),
+    m_cellProfileLog(nullptr),
+    m_profilePath(),
+    m_statsPanel(new StatsPanel()),
+    m_statsTimer(new QTimer(this)),
+    m_engine(nullptr),
     m_view(nullptr),
     m_mouseGraphic(nullptr),
+    m_spareView(nullptr),
+
+    // Replay
+    m_replay(nullptr),
+    m_replayControls(new QWidget()),
+    m_replayPlayButton(new QPushButton("Play")),
+    m_replayEndButton(new QPushButton("End")),
+    m_replaySlider(new QSlider(Qt::Horizontal)),
+    m_replayPosition(new QLabel()),
+    m_replayTimer(new QTimer(this)),
+    m_replayCommandsOwed(0.0),
+    m_comparedMap(new Map()),
+    m_comparedReplay(nullptr),
+    m_comparedView(nullptr),
+    m_comparedMouseGraphic(nullptr),
+    m_replayDivergenceButton(new QPushButton()),
+    m_replayDivergence(-1),
 
     // Pause/reset
     m_isPaused(false),
-    m_wasReset(false),
     m_pauseButton(new QPushButton("Pause")),
     m_resetButton(new QPushButton("Reset")),
 
-    // Communication
-    m_logBuffer(QStringList()),
-    m_commandBuffer(QStringList()),
-    m_commandQueue(QQueue<QString>()),
-    m_commandQueueTimer(new QTimer()),
-
     // Movement
-    m_startingLocation({0, 0}),
-    m_startingDirection(Direction::NORTH),
-    m_movement(Movement::NONE),
-    m_movementProgress(0.0),
-    m_movementStepSize(0.0),
     m_speedSlider(new QSlider(Qt::Horizontal)),
+    m_instantCheckBox(new QCheckBox("Instant")),
+    m_continuousCheckBox(new QCheckBox("Continuous")),
+    m_fogCheckBox(new QCheckBox("Fog")),
+    m_distancesCheckBox(new QCheckBox("Distances")),
+    m_profileComboBox(new QComboBox()) {
+    PROFILE_ZONE("Window::Window");
+
+    // Algorithm output is read and parsed off of the GUI thread; the
+    // algorithm's think times go on a profiler track next to it
+    m_ioThread->setObjectName("io");
+    m_ioThread->start();
+    m_runMeter->setThinkTrack("algorithm");
+
+    // So are mazes, and their truth views
+    m_mazeLoader->moveToThread(m_loadThread);
+    connect(
+        m_loadThread,
+        &QThread::finished,
+        m_mazeLoader,
+        &QObject::deleteLater
+    );
+    connect(
+        m_mazeLoader,
+        &MazeLoader::progress,
+        this,
+        [=](int loadNumber, int percent){
+            if (loadNumber == m_loadNumber) {
+                m_loadProgressBar->setValue(percent);
+            }
+        }
+    );
+    connect(
+        m_mazeLoader,
+        &MazeLoader::loaded,
+        this,
+        &Window::onMazeLoaded
+    );
+    m_loadThread->start();
+
+    // And so are the thumbnails of the mazes in the combo box
+    m_mazeThumbnailer->moveToThread(m_thumbnailThread);
+    connect(
+        m_thumbnailThread,
+        &QThread::finished,
+        m_mazeThumbnailer,
+        &QObject::deleteLater
+    );
+    connect(
+        m_mazeThumbnailer,
+        &MazeThumbnailer::rendered,
+        this,
+        &Window::onMazeThumbnailRendered
+    );
+    m_thumbnailThread->start();
 
-    // Helpers
-    m_tilesWithColor(QSet<QPair<int, int>>()),
-    m_tilesWithText(QSet<QPair<int, int>>()) {
+    // And so is the index of the maze library
+    m_mazeLibrary->moveToThread(m_libraryThread);
+    connect(
+        m_libraryThread,
+        &QThread::finished,
+        m_mazeLibrary,
+        &QObject::deleteLater
+    );
+    connect(
+        m_mazeLibrary,
+        &MazeLibrary::indexed,
+        this,
+        &Window::onMazeLibraryIndexed
+    );
+    m_libraryThread->start();
 
     // Keyboard shortcuts for closing the window
     QShortcut* ctrl_q = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_Q), this);
@@ -119,6 +256,24 @@ Window::Window(QWidget *parent) :
     connect(ctrl_q, &QShortcut::activated, this, &QMainWindow::close);
     connect(ctrl_w, &QShortcut::activated, this, &QMainWindow::close);
 
+    // Keyboard shortcut for toggling the frame statistics overlay
+    QShortcut* f3 = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    connect(f3, &QShortcut::activated, this, [=](){
+        m_map->setStatsOverlayVisible(!m_map->isStatsOverlayVisible());
+    });
+
+    // Keyboard shortcut for writing the profile so far, if it's being kept
+    QShortcut* f4 = new QShortcut(QKeySequence(Qt::Key_F4), this);
+    connect(f4, &QShortcut::activated, this, [=](){
+        if (m_profilePath.isEmpty()) {
+            return;
+        }
+        QString message = Profiler::write(m_profilePath)
+            ? "Wrote the profile to "
+            : "Unable to write the profile to ";
+        appendRunOutput({message + m_profilePath});
+    });
+
     // Add the map and panel to the window
     QVBoxLayout* panelLayout = new QVBoxLayout();
     panelLayout->setContentsMargins(0, 6, 6, 6);
@@ -127,8 +282,10 @@ Window::Window(QWidget *parent) :
     QSplitter* splitter = new QSplitter();
     splitter->setHandleWidth(9);
     splitter->addWidget(m_map);
+    splitter->addWidget(m_comparedMap);
     splitter->addWidget(panel);
     setCentralWidget(splitter);
+    m_comparedMap->hide();
 
     // Add the upper parts of the panel
     QGroupBox* configGroupBox = new QGroupBox("Config");
@@ -140,8 +297,19 @@ Window::Window(QWidget *parent) :
     QHBoxLayout* upperLayout = new QHBoxLayout();
     upperLayout->addWidget(controlsGroupBox);
     upperLayout->addWidget(configGroupBox);
+    upperLayout->addWidget(m_statsPanel);
     panelLayout->addLayout(upperLayout);
 
+    // The stats are cheap to sample, so they're always live
+    m_statsTimer->setInterval(STATS_REFRESH_MS);
+    connect(
+        m_statsTimer,
+        &QTimer::timeout,
+        this,
+        &Window::refreshStatsPanel
+    );
+    m_statsTimer->start();
+
     // Add the mouse algo build and run buttons
     controlsLayout->addWidget(m_buildButton, 0, 0);
     controlsLayout->addWidget(m_runButton, 1, 0);
@@ -157,6 +325,23 @@ Window::Window(QWidget *parent) :
         label->setMinimumWidth(90);
     }
 
+    // Add the mouse algo watch, which rebuilds and reruns it on changes
+    controlsLayout->addWidget(m_watchCheckBox, 2, 0);
+    controlsLayout->addWidget(m_fastForwardCheckBox, 2, 1);
+    m_watchCheckBox->setToolTip(
+        "Rebuild and rerun the algorithm whenever its directory changes");
+    m_fastForwardCheckBox->setToolTip(
+        "Skip each rerun ahead to where the previous run was, then pause");
+    m_fastForwardCheckBox->setChecked(true);
+    m_watchTimer->setInterval(WATCH_MS);
+    connect(
+        m_watchCheckBox,
+        &QCheckBox::toggled,
+        this,
+        &Window::onWatchCheckBoxToggled
+    );
+    connect(m_watchTimer, &QTimer::timeout, this, &Window::onWatchTimeout);
+
     // Add mouse algo pause and reset buttons
     m_pauseButton->setEnabled(false);
     m_resetButton->setEnabled(false);
@@ -184,9 +369,108 @@ Window::Window(QWidget *parent) :
     speedLayout->addWidget(turtle);
     speedLayout->addWidget(m_speedSlider);
     speedLayout->addWidget(rabbit);
+    speedLayout->addWidget(m_instantCheckBox);
+    speedLayout->addWidget(m_continuousCheckBox);
+    speedLayout->addWidget(m_fogCheckBox);
+    speedLayout->addWidget(m_distancesCheckBox);
+    speedLayout->addWidget(m_profileComboBox);
     controlsLayout->addLayout(speedLayout, 1, 2, 1, 2);
     m_speedSlider->setRange(0, SPEED_SLIDER_MAX);
     m_speedSlider->setValue(SPEED_SLIDER_DEFAULT);
+    connect(
+        m_speedSlider,
+        &QSlider::valueChanged,
+        this,
+        &Window::onSpeedSliderChanged
+    );
+    m_instantCheckBox->setToolTip("Skip movement animations");
+    connect(
+        m_instantCheckBox,
+        &QCheckBox::toggled,
+        this,
+        &Window::onInstantCheckBoxToggled
+    );
+    m_continuousCheckBox->setToolTip(
+        "Move like a real mouse, at real speed (ignoring the speed slider)");
+    connect(
+        m_continuousCheckBox,
+        &QCheckBox::toggled,
+        this,
+        &Window::onContinuousCheckBoxToggled
+    );
+    m_fogCheckBox->setToolTip("Hide the cells that the mouse hasn't visited");
+    connect(
+        m_fogCheckBox,
+        &QCheckBox::toggled,
+        this,
+        &Window::onFogCheckBoxToggled
+    );
+    m_distancesCheckBox->setToolTip(
+        "Show each cell's distance to the center, through the declared walls");
+    connect(
+        m_distancesCheckBox,
+        &QCheckBox::toggled,
+        this,
+        &Window::onDistancesCheckBoxToggled
+    );
+    m_profileComboBox->addItem(
+        "No profile", static_cast<int>(ProfileMetric::NONE));
+    m_profileComboBox->addItem(
+        "Time", static_cast<int>(ProfileMetric::WALL_TIME));
+    m_profileComboBox->addItem(
+        "Mouse time", static_cast<int>(ProfileMetric::SIMULATED_TIME));
+    m_profileComboBox->addItem(
+        "Commands", static_cast<int>(ProfileMetric::COMMANDS));
+    m_profileComboBox->addItem(
+        "Revisits", static_cast<int>(ProfileMetric::REVISITS));
+    m_profileComboBox->setToolTip(
+        "Show where the run spent its time, its commands or its revisits");
+    connect(
+        m_profileComboBox,
+        static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+        this,
+        &Window::onProfileComboBoxChanged
+    );
+
+    // Add the replay controls, only shown while replaying a trace
+    QHBoxLayout* replayLayout = new QHBoxLayout();
+    replayLayout->setContentsMargins(0, 0, 0, 0);
+    replayLayout->addWidget(m_replayPlayButton);
+    replayLayout->addWidget(m_replaySlider);
+    replayLayout->addWidget(m_replayPosition);
+    replayLayout->addWidget(m_replayEndButton);
+    replayLayout->addWidget(m_replayDivergenceButton);
+    m_replayControls->setLayout(replayLayout);
+    m_replayControls->hide();
+    m_replayDivergenceButton->hide();
+    controlsLayout->addWidget(m_replayControls, 2, 0, 1, 4);
+    m_replayPosition->setMinimumWidth(90);
+    m_replayPosition->setAlignment(Qt::AlignCenter);
+    connect(
+        m_replayPlayButton,
+        &QPushButton::clicked,
+        this,
+        &Window::onReplayPlayButtonPressed
+    );
+    connect(m_replayEndButton, &QPushButton::clicked, this, [=](){
+        seekReplay(getReplayLength());
+    });
+    connect(m_replayDivergenceButton, &QPushButton::clicked, this, [=](){
+        seekReplay(m_replayDivergence);
+    });
+    connect(
+        m_replaySlider,
+        &QSlider::valueChanged,
+        this,
+        &Window::seekReplay
+    );
+    m_replayTimer->setInterval(REPLAY_TICK_MS);
+    connect(
+        m_replayTimer,
+        &QTimer::timeout,
+        this,
+        &Window::onReplayTick
+    );
 
     // Add config box labels
     QLabel* mazeLabel = new QLabel("Maze");
@@ -197,8 +481,13 @@ Window::Window(QWidget *parent) :
     mazeLabel->setSizePolicy(policy);
     mouseLabel->setSizePolicy(policy);
 
-    // Add maze file combo box
+    // Add maze file combo box, whose rows are only described once they're
+    // shown, so that it stays fast however many mazes it lists
+    m_mazeFileComboBox->setModel(m_mazeListModel);
     m_mazeFileComboBox->setMinimumContentsLength(1);
+    m_mazeFileComboBox->setIconSize(
+        QSize(MazeThumbnailer::SIZE / 2, MazeThumbnailer::SIZE / 2)
+    );
     configLayout->addWidget(m_mazeFileComboBox, 0, 1, 1, 2);
     connect(
         m_mazeFileComboBox,
@@ -212,21 +501,76 @@ Window::Window(QWidget *parent) :
     configLayout->addWidget(m_mouseAlgoComboBox, 1, 1, 1, 2);
     connect(
         m_mouseAlgoComboBox,
-        &QComboBox::currentTextChanged,
+        static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
         this,
-        &Window::onMouseAlgoComboBoxChanged
+        [=](int index){
+            onMouseAlgoComboBoxChanged(m_mouseAlgoComboBox->itemText(index));
+        }
     );
 
-    // Add maze file load button
+    // Add maze file load button, with the maze library in its menu
     QToolButton* mazeFileOpenButton = new QToolButton();
     configLayout->addWidget(mazeFileOpenButton, 0, 3, 1, 1);
     mazeFileOpenButton->setIcon(QIcon(":/resources/icons/open.png"));
+    mazeFileOpenButton->setMenu(m_mazeLibraryMenu);
+    mazeFileOpenButton->setPopupMode(QToolButton::MenuButtonPopup);
     connect(
         mazeFileOpenButton,
         &QToolButton::clicked,
         this, 
         &Window::onMazeFileButtonPressed
     );
+    connect(
+        m_mazeLibraryMenu->addAction("Add Library Directory..."),
+        &QAction::triggered,
+        this,
+        &Window::onAddLibraryActionTriggered
+    );
+    connect(
+        m_mazeLibraryMenu->addAction("Remove Library Directory..."),
+        &QAction::triggered,
+        this,
+        &Window::onRemoveLibraryActionTriggered
+    );
+
+    // Add maze load progress bar, only shown while a maze is loading
+    configLayout->addWidget(m_loadProgressBar, 2, 0, 1, 7);
+    m_loadProgressBar->setRange(0, 100);
+    m_loadProgressBar->setFormat("Loading maze... %p%");
+    m_loadProgressBar->hide();
+
+    // Add maze generate button
+    QToolButton* mazeGenerateButton = new QToolButton();
+    configLayout->addWidget(mazeGenerateButton, 0, 4, 1, 1);
+    mazeGenerateButton->setText("Gen");
+    mazeGenerateButton->setToolTip("Generate a random maze");
+    connect(
+        mazeGenerateButton,
+        &QToolButton::clicked,
+        this,
+        &Window::onMazeGenerateButtonPressed
+    );
+
+    // Add maze edit button, with saving in its menu
+    configLayout->addWidget(m_mazeEditButton, 0, 5, 1, 1);
+    m_mazeEditButton->setText("Edit");
+    m_mazeEditButton->setToolTip("Click the map to add or remove walls");
+    m_mazeEditButton->setCheckable(true);
+    m_mazeEditButton->setMenu(m_mazeEditMenu);
+    m_mazeEditButton->setPopupMode(QToolButton::MenuButtonPopup);
+    connect(
+        m_mazeEditMenu->addAction("Save As..."),
+        &QAction::triggered,
+        this,
+        &Window::onMazeSaveActionTriggered
+    );
+    connect(
+        m_mazeEditButton,
+        &QToolButton::toggled,
+        this,
+        &Window::onMazeEditButtonToggled
+    );
+    connect(m_map, &Map::wallClicked, this, &Window::onWallClicked);
 
     // Add mouse algo edit button
     configLayout->addWidget(m_mouseAlgoEditButton, 1, 3, 1, 1);
@@ -249,11 +593,42 @@ Window::Window(QWidget *parent) :
         &Window::onMouseAlgoImportButtonPressed
     );
 
+    // Add mouse algo rivals button
+    configLayout->addWidget(m_rivalsButton, 1, 5, 1, 1);
+    m_rivalsButton->setText("Vs");
+    m_rivalsButton->setToolTip("Run other algorithms in the same maze");
+    m_rivalsButton->setMenu(m_rivalsMenu);
+    m_rivalsButton->setPopupMode(QToolButton::InstantPopup);
+
+    // Add ghosts button
+    configLayout->addWidget(m_ghostsButton, 1, 6, 1, 1);
+    m_ghostsButton->setText("Ghosts");
+    m_ghostsButton->setToolTip("Replay previous runs alongside the run");
+    m_ghostsButton->setMenu(m_ghostsMenu);
+    m_ghostsButton->setPopupMode(QToolButton::InstantPopup);
+    for (const QString& kind : GHOST_KINDS()) {
+        QString label = "Reference: " + kind;
+        if (kind == "best") {
+            label = "Best run";
+        }
+        else if (kind == "last") {
+            label = "Last run";
+        }
+        QAction* action = m_ghostsMenu->addAction(label);
+        action->setData(kind);
+        action->setCheckable(true);
+    }
+
     // Add the build and run outputs to the panel
     panelLayout->addWidget(m_mouseAlgoOutputTabWidget);
     m_mouseAlgoOutputTabWidget->addTab(m_buildOutput, "Build Output");
     m_mouseAlgoOutputTabWidget->addTab(m_runOutput, "Run Output");
-    for (QPlainTextEdit* output : {m_buildOutput, m_runOutput}) {
+    m_mouseAlgoOutputTabWidget->addTab(m_latencyOutput, "Latency");
+    for (QPlainTextEdit* output : {
+        m_buildOutput,
+        m_runOutput,
+        m_latencyOutput
+    }) {
         output->setReadOnly(true);
         output->setLineWrapMode(QPlainTextEdit::NoWrap);
         QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
@@ -261,58 +636,89 @@ Window::Window(QWidget *parent) :
         output->document()->setDefaultFont(font);
     }
 
+    // Latency is only shown while it's being looked at
+    m_latencyTimer->setInterval(LATENCY_REFRESH_MS);
+    connect(m_latencyTimer, &QTimer::timeout, this, [=](){
+        if (m_latencyOutput->isVisible()) {
+            refreshLatencyOutput();
+        }
+    });
+    connect(
+        m_mouseAlgoOutputTabWidget,
+        &QTabWidget::currentChanged,
+        this,
+        [=](int index){
+            Q_UNUSED(index);
+            refreshLatencyOutput();
+        }
+    );
+
+    // Run output is coalesced, and bounded
+    m_runOutput->setMaximumBlockCount(DEFAULT_RUN_OUTPUT_MAX_LINES);
+    m_runOutputTimer->setSingleShot(true);
+    m_runOutputTimer->setInterval(RUN_OUTPUT_FLUSH_MS);
+    connect(
+        m_runOutputTimer,
+        &QTimer::timeout,
+        this,
+        &Window::flushRunOutput
+    );
+
     // Resize the window and make the map square
     int windowWidth = SettingsMisc::getRecentWindowWidth();
     int windowHeight = SettingsMisc::getRecentWindowHeight();
     resize(windowWidth, windowHeight);
     splitter->setSizes({windowHeight, windowWidth - windowHeight});
 
-    // Remove maze files that no longer exist
+    // Remove maze files that no longer exist; generated mazes always do
     for (const auto& path : SettingsMazeFiles::getAllPaths()) {
+        if (MazeGenerator::isSpec(path)) {
+            continue;
+        }
         if (path.isEmpty() || !QFileInfo::exists(path)) {
             SettingsMazeFiles::removePath(path);
         }
     }
 
-    // Load the recently used maze
+    // Library directories are indexed in the background, and their mazes
+    // are added to the combo box as their indexes arrive
+    updateLibraryDirectories();
+
+    // Show the blank maze, which is tiny, right away, and only load the
+    // recently used maze (which may be huge) once the window is up, so that
+    // it's shown, and responsive, as soon as possible
+    MazeLoadResult result = MazeLoader::loadNow(m_loadNumber, BLANK_MAZE_FILE);
+    ASSERT_FA(result.maze == nullptr);
+    m_mazeCache.insert(
+        BLANK_MAZE_FILE,
+        result.lastModified,
+        result.maze,
+        result.truth
+    );
     QString path = SettingsMisc::getRecentMazeFile();
-    Maze* maze = Maze::fromFile(path);
-    if (maze == nullptr) {
-        path = ":/resources/mazes/blank.num";
-        maze = Maze::fromFile(path);
+    if (path.isEmpty() || path == BLANK_MAZE_FILE) {
+        refreshMazeFileComboBox(BLANK_MAZE_FILE);
+        updateMazeAndPath(result.maze, result.truth, BLANK_MAZE_FILE);
+        m_isStartupMazeShown = true;
+    }
+    else {
+        // Until the recently used maze replaces it, the blank maze isn't
+        // remembered as the recently used one
+        refreshMazeFileComboBox(path);
+        updateMaze(result.maze, result.truth);
+        m_currentMazeFile = BLANK_MAZE_FILE;
+        m_startupMazeFile = path;
+        QTimer::singleShot(0, this, &Window::loadStartupMaze);
     }
-    refreshMazeFileComboBox(path);
-    updateMazeAndPath(maze, path);
-
-    // Add the mouse algos
-    refreshMouseAlgoComboBox(SettingsMisc::getRecentMouseAlgo());
-
-    // Configure command queue timer
-    m_commandQueueTimer->setSingleShot(true);
     connect(
-        m_commandQueueTimer,
-        &QTimer::timeout,
+        m_map,
+        &QOpenGLWidget::frameSwapped,
         this,
-        &Window::processQueuedCommands
+        &Window::onMapFrameSwapped
     );
 
-    // Start the graphics loop
-    double secondsPerFrame = 1.0 / 60;
-    QTimer* mapTimer = new QTimer();
-    connect(
-        mapTimer, &QTimer::timeout,
-        this, [=](){
-            // Hack to prevent file dialog from locking up...
-            static double then = SimUtilities::getHighResTimestamp();
-            double now = SimUtilities::getHighResTimestamp();
-            if (now - then < secondsPerFrame) {
-                return;
-            }
-            m_map->update();
-            then = now;
-        }
-    );
-    mapTimer->start(secondsPerFrame * 1000);
+    // Add the mouse algos
+    refreshMouseAlgoComboBox(SettingsMisc::getRecentMouseAlgo());
 }
 
 void Window::resizeEvent(QResizeEvent* event) {
@@ -320,155 +726,762 @@ void Window::resizeEvent(QResizeEvent* event) {
     SettingsMisc::setRecentWindowHeight(event->size().height());
 }
 
-void Window::closeEvent(QCloseEvent *event) {
+Window::~Window() {
     cancelAllProcesses();
-    m_map->shutdown();
-    QMainWindow::closeEvent(event);
+    delete m_spareView;
+    delete m_editedTruth;
+    delete m_editedMaze;
+    delete m_runLog;
+    delete m_latencyLog;
+    delete m_runSummaryLog;
+    delete m_cellProfileLog;
+    delete m_commandTrace;
+    for (GhostRun* ghost : m_ghostRuns) {
+        delete ghost;
+    }
+    m_ioThread->quit();
+    m_ioThread->wait();
+    m_loadThread->quit();
+    m_loadThread->wait();
+    m_thumbnailThread->quit();
+    m_thumbnailThread->wait();
+    m_libraryThread->quit();
+    m_libraryThread->wait();
 }
 
-void Window::onMazeFileButtonPressed() {
-    QString path = QFileDialog::getOpenFileName(this, tr("Load Maze"));
-    if (path.isNull()) {
-        return;
-    }
-    Maze* maze = Maze::fromFile(path);
-    if (maze == nullptr) {
-        showInvalidMazeFileWarning(path);
-        return;
-    }
-    SettingsMazeFiles::addPath(path);
-    refreshMazeFileComboBox(path);
-    updateMazeAndPath(maze, path);
+bool Window::setFrameLogPath(const QString& path) {
+    return m_map->setFrameLogPath(path);
 }
 
-void Window::onMazeFileComboBoxChanged(QString path) {
-    Maze* maze = Maze::fromFile(path);
-    if (maze == nullptr) {
-        refreshMazeFileComboBox(m_currentMazeFile);
-        showInvalidMazeFileWarning(path);
-        return;
+void Window::setUploadBudget(qint64 bytes) {
+    m_map->setUploadBudget(bytes);
+}
+
+void Window::setRunOutputMaxLines(int lines) {
+    m_runOutput->setMaximumBlockCount(lines);
+}
+
+void Window::setQueueLimit(int limit) {
+    m_queueLimit = limit;
+}
+
+void Window::setContestRules(const ContestRules& rules) {
+    m_contestRules = rules;
+}
+
+bool Window::setCommandTracePath(const QString& path) {
+    delete m_commandTrace;
+    m_commandTrace = nullptr;
+    m_commandTracePath = path;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_commandTrace = CommandTrace::open(path);
+    if (m_commandTrace == nullptr) {
+        qWarning()
+            << "Unable to open command trace file:"
+            << path;
+        return false;
     }
-    updateMazeAndPath(maze, path);
+    return true;
 }
 
-void Window::showInvalidMazeFileWarning(QString path) {
-    QMessageBox::warning(
-        this,
-        "Invalid Maze File",
-        "The following is not a valid maze file:\n\n" + path + "\n\n "
-        "The maze must be nonempty, rectangular, enclosed, and consistent."
-    );
+void Window::setGhostTracePath(const QString& path) {
+    m_ghostTracePath = path;
 }
 
-void Window::refreshMazeFileComboBox(QString selected) {
-    m_mazeFileComboBox->clear();
-    for (const auto& info : QDir(":/resources/mazes/").entryInfoList()) {
-        m_mazeFileComboBox->addItem(info.absoluteFilePath());
+bool Window::setGhosts(const QStringList& kinds) {
+    for (const QString& kind : kinds) {
+        if (!GHOST_KINDS().contains(kind)) {
+            qWarning() << "Unknown ghost:" << kind;
+            return false;
+        }
     }
-    for (const auto& path : SettingsMazeFiles::getAllPaths()) {
-        m_mazeFileComboBox->addItem(path);
+    for (QAction* action : m_ghostsMenu->actions()) {
+        action->setChecked(kinds.contains(action->data().toString()));
     }
-    m_mazeFileComboBox->setCurrentText(selected);
+    return true;
 }
 
-void Window::updateMazeAndPath(Maze* maze, QString path) {
-    updateMaze(maze);
-    m_currentMazeFile = path;
-    SettingsMisc::setRecentMazeFile(path);
+bool Window::setSpectatorPort(quint16 port) {
+    delete m_spectatorServer;
+    m_spectatorServer = new SpectatorServer(this);
+    return m_spectatorServer->listen(port);
 }
 
-void Window::updateMaze(Maze* maze) {
+bool Window::startReplay(const QString& path, int run) {
 
-    // Stop running maze/mouse algos
-    cancelAllProcesses();
-
-    // Next, update the maze and truth
-    Maze* oldMaze = m_maze;
-    MazeView* oldTruth = m_truth;
-    m_maze = maze;
-    m_truth = new MazeView(m_maze);
+    // Map the trace; its commands are decoded as they're replayed
+    TraceRun replayed;
+    if (!readTraceRun(path, run, &replayed)) {
+        return false;
+    }
 
-    // The truth has walls declared and distance as text
-    MazeGraphic* mazeGraphic = m_truth->getMazeGraphic();
-    for (int x = 0; x < m_maze->getWidth(); x += 1) {
-        for (int y = 0; y < m_maze->getHeight(); y += 1) {
-            const Tile* tile = m_maze->getTile(x, y);
-            for (Direction d : DIRECTIONS()) {
-                if (tile->isWall(d)) {
-                    mazeGraphic->setWall(x, y, d);
-                }
-            }
-            int distance = tile->getDistance();
-            QString text = 0 <= distance ? QString::number(distance) : "inf";
-            mazeGraphic->setText(x, y, text);
+    // Show the maze that was run against, loading it right away if needed,
+    // instead of the recently used maze
+    m_startupMazeFile.clear();
+    Maze* maze = nullptr;
+    MazeView* truth = nullptr;
+    if (!m_mazeCache.get(replayed.mazeSource, &maze, &truth)) {
+        m_loadNumber += 1;
+        // The replay hides the truth, so it's only built once it's shown
+        MazeLoadResult result = MazeLoader::loadNow(
+            m_loadNumber,
+            replayed.mazeSource,
+            nullptr,
+            false);
+        if (result.maze == nullptr) {
+            qWarning()
+                << "Unable to load the maze of the replayed run:"
+                << replayed.mazeSource
+                << Maze::errorToString(result.error);
+            return false;
         }
+        m_mazeCache.insert(
+            result.source,
+            result.lastModified,
+            result.maze,
+            result.truth
+        );
+        maze = result.maze;
+        truth = result.truth;
     }
+    m_loadProgressBar->hide();
+    showMaze(replayed.mazeSource, maze, truth, false);
 
-    // Update pointers held by other objects
-    m_map->setMaze(m_maze);
-    m_map->setView(m_truth);
-
-    // Delete the old objects
-    delete oldMaze;
-    delete oldTruth;
+    // Replace the truth with the replayed view and mouse
+    m_view = new MazeView(m_maze);
+    m_replay = new TraceReplay(m_maze, m_view, replayed);
+    m_mouseGraphic = new MouseGraphic(m_replay->getMouse());
+    m_map->setView(m_view);
+    m_map->setMouseGraphic(m_mouseGraphic);
+    m_replayCommandsOwed = 0.0;
+    {
+        QSignalBlocker blocker(m_replaySlider);
+        m_replaySlider->setRange(0, m_replay->getLength());
+    }
+    seekReplay(0);
+    m_replayPlayButton->setText("Play");
+    m_replayControls->show();
+    m_runStatus->setText("REPLAY");
+    m_runStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
+    return true;
 }
 
-void Window::onMouseAlgoComboBoxChanged(QString name) {
-    cancelAllProcesses();
-    m_buildStatus->setText("");
-    m_buildStatus->setStyleSheet("");
-    m_buildOutput->clear();
-    m_runStatus->setText("");
-    m_runStatus->setStyleSheet("");
-    m_runOutput->clear();
-    SettingsMisc::setRecentMouseAlgo(name);
+bool Window::startComparedReplay(const QString& path, int run) {
+    ASSERT_FA(m_replay == nullptr);
+    ASSERT_TR(m_comparedReplay == nullptr);
+    TraceRun compared;
+    if (!readTraceRun(path, run, &compared)) {
+        return false;
+    }
+    if (compared.mazeSource != m_currentMazeFile) {
+        qWarning()
+            << "The compared run is of another maze:"
+            << compared.mazeSource;
+        return false;
+    }
+
+    // Replay the run in a map of its own, against the same maze
+    m_comparedView = new MazeView(m_maze);
+    m_comparedReplay = new TraceReplay(m_maze, m_comparedView, compared);
+    m_comparedMouseGraphic = new MouseGraphic(m_comparedReplay->getMouse());
+    m_comparedMap->setMaze(m_maze);
+    m_comparedMap->setView(m_comparedView);
+    m_comparedMap->setMouseGraphic(m_comparedMouseGraphic);
+    m_comparedMap->show();
+
+    // Find the first command after which the mice are in different places
+    m_replayDivergence = -1;
+    const Mouse* mouse = m_replay->getMouse();
+    const Mouse* comparedMouse = m_comparedReplay->getMouse();
+    for (int i = 0; i <= getReplayLength(); i += 1) {
+        m_replay->seek(qMin(i, m_replay->getLength()));
+        m_comparedReplay->seek(qMin(i, m_comparedReplay->getLength()));
+        if (
+            mouse->getCurrentDiscretizedTranslation() !=
+                comparedMouse->getCurrentDiscretizedTranslation() ||
+            mouse->getCurrentDiscretizedRotation() !=
+                comparedMouse->getCurrentDiscretizedRotation()
+        ) {
+            m_replayDivergence = i;
+            break;
+        }
+    }
+    m_replayDivergenceButton->setText(
+        m_replayDivergence == -1
+        ? "Same path"
+        : QString("Diverges at %1").arg(m_replayDivergence));
+    m_replayDivergenceButton->setEnabled(m_replayDivergence != -1);
+    m_replayDivergenceButton->show();
+    {
+        QSignalBlocker blocker(m_replaySlider);
+        m_replaySlider->setRange(0, getReplayLength());
+    }
+    seekReplay(0);
+    return true;
 }
 
-void Window::onMouseAlgoEditButtonPressed() {
+bool Window::readTraceRun(const QString& path, int run, TraceRun* traced) {
+    QVector<TraceRun> runs;
+    if (!CommandTrace::read(path, &runs)) {
+        qWarning() << "Unable to read command trace file:" << path;
+        return false;
+    }
+    if (run < 0 || runs.size() < run || runs.isEmpty()) {
+        qWarning()
+            << "No run" << run
+            << "in command trace file:" << path;
+        return false;
+    }
+    *traced = runs.at(run == 0 ? runs.size() - 1 : run - 1);
+    return true;
+}
 
-    // Create the dialog with initial values
-    QString name = m_mouseAlgoComboBox->currentText();
-    ConfigDialog dialog(
-        name,
-        SettingsMouseAlgos::getDirectory(name),
-        SettingsMouseAlgos::getBuildCommand(name),
-        SettingsMouseAlgos::getRunCommand(name)
-    );
+bool Window::setLatencyLogPath(const QString& path) {
+    delete m_latencyLog;
+    m_latencyLog = nullptr;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_latencyLog = new QFile(path);
+    if (!m_latencyLog->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning()
+            << "Unable to open latency log file:"
+            << path;
+        delete m_latencyLog;
+        m_latencyLog = nullptr;
+        return false;
+    }
+    return true;
+}
 
-    // Cancel was pressed
-    if (dialog.exec() == QDialog::Rejected) {
-        return;
+bool Window::setCellProfileLogPath(const QString& path) {
+    delete m_cellProfileLog;
+    m_cellProfileLog = nullptr;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_cellProfileLog = new QFile(path);
+    if (!m_cellProfileLog->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning()
+            << "Unable to open cell profile log file:"
+            << path;
+        delete m_cellProfileLog;
+        m_cellProfileLog = nullptr;
+        return false;
     }
+    return true;
+}
 
-    // Remove was pressed
-    if (dialog.removeButtonPressed()) {
-        SettingsMouseAlgos::remove(name);
-        refreshMouseAlgoComboBox("");
-        return;
+bool Window::setRunSummaryLogPath(const QString& path) {
+    delete m_runSummaryLog;
+    m_runSummaryLog = nullptr;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_runSummaryLog = new QFile(path);
+    if (!m_runSummaryLog->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning()
+            << "Unable to open run summary log file:"
+            << path;
+        delete m_runSummaryLog;
+        m_runSummaryLog = nullptr;
+        return false;
     }
+    return true;
+}
 
-    // OK was pressed
-    QString newName = dialog.getName();
-    SettingsMouseAlgos::update(
-        name,
-        newName,
-        dialog.getDirectory(),
-        dialog.getBuildCommand(),
-        dialog.getRunCommand()
-    );
+void Window::setStartupTimer(const QElapsedTimer& timer) {
+    m_startupTimer = timer;
+    logStartup("Window constructed");
+}
 
-    // Update the mouse algos
-    refreshMouseAlgoComboBox(newName);
+void Window::onMapFrameSwapped() {
+    if (!m_startupTimer.isValid()) {
+        return;
+    }
+    if (!m_isFirstFrameLogged) {
+        logStartup("First frame drawn");
+        m_isFirstFrameLogged = true;
+    }
+    if (m_isStartupMazeShown) {
+        logStartup("Recently used maze drawn");
+        m_startupTimer.invalidate();
+    }
 }
 
-void Window::onMouseAlgoImportButtonPressed() {
+void Window::logStartup(const QString& milestone) {
+    qCInfo(STARTUP_LOG).noquote().nospace()
+        << milestone << " after " << m_startupTimer.elapsed() << " ms";
+}
 
-    // Create an empty dialog
-    ConfigDialog dialog("", "", "", "");
+void Window::setProfilePath(const QString& path) {
+    m_profilePath = path;
+}
 
-    // Cancel was pressed
-    if (dialog.exec() == QDialog::Rejected) {
-        return;
+bool Window::setRunLogPath(const QString& path) {
+    delete m_runLog;
+    m_runLog = nullptr;
+    if (path.isEmpty()) {
+        return true;
+    }
+    m_runLog = new QFile(path);
+    if (!m_runLog->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning()
+            << "Unable to open run log file:"
+            << path;
+        delete m_runLog;
+        m_runLog = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Window::closeEvent(QCloseEvent *event) {
+    cancelAllProcesses();
+    m_map->shutdown();
+    m_comparedMap->shutdown();
+    QMainWindow::closeEvent(event);
+}
+
+void Window::onMazeFileButtonPressed() {
+    QString path = QFileDialog::getOpenFileName(this, tr("Load Maze"));
+    if (path.isNull()) {
+        return;
+    }
+    loadMaze(path, true);
+}
+
+void Window::onMazeGenerateButtonPressed() {
+    // Suggest a fresh seed each time; the spec is remembered like a path, so
+    // the same maze can be recreated later
+    quint32 seed = static_cast<quint32>(QDateTime::currentMSecsSinceEpoch());
+    bool ok = false;
+    QString spec = QInputDialog::getText(
+        this,
+        tr("Generate Maze"),
+        "Algorithm (dfs, prim or classic), size and seed:",
+        QLineEdit::Normal,
+        MazeGenerator::toSpec(MazeAlgorithm::CLASSIC, 16, 16, seed),
+        &ok
+    ).trimmed();
+    if (!ok) {
+        return;
+    }
+    if (!MazeGenerator::isSpec(spec)) {
+        QMessageBox::warning(
+            this,
+            "Invalid Maze Spec",
+            "Mazes are specified as <algorithm>:<width>x<height>:<seed>, "
+            "e.g. " + MazeGenerator::toSpec(MazeAlgorithm::DFS, 16, 16, 42) +
+            ".\n\nThe algorithm is one of " +
+            QStringList(MazeGenerator::STRING_TO_MAZE_ALGORITHM().keys())
+                .join(", ") +
+            ", and classic mazes must be at least 4x4."
+        );
+        return;
+    }
+    loadMaze(spec, true);
+}
+
+void Window::onMazeFileComboBoxChanged(QString path) {
+    loadMaze(path, false);
+}
+
+void Window::loadMaze(const QString& source, bool isNewPath) {
+
+    // Any load that's still in progress is superseded, as is the load of the
+    // recently used maze, if it hasn't started yet
+    m_loadNumber += 1;
+    m_startupMazeFile.clear();
+
+    // Cached mazes are shown right away
+    Maze* maze = nullptr;
+    MazeView* truth = nullptr;
+    if (m_mazeCache.get(source, &maze, &truth)) {
+        if (truth == nullptr) {
+            truth = m_mazeCache.getTruth(maze);
+        }
+        m_loadProgressBar->hide();
+        showMaze(source, maze, truth, isNewPath);
+        return;
+    }
+
+    // Everything else is loaded on the load thread; the current maze stays
+    // up (and usable) until the new one is ready
+    m_isLoadingNewPath = isNewPath;
+    m_loadProgressBar->setValue(0);
+    m_loadProgressBar->show();
+    QMetaObject::invokeMethod(
+        m_mazeLoader,
+        "load",
+        Qt::QueuedConnection,
+        Q_ARG(int, m_loadNumber),
+        Q_ARG(QString, source)
+    );
+}
+
+void Window::loadStartupMaze() {
+    if (m_startupMazeFile.isEmpty()) {
+        return;
+    }
+    // Copied, since loading any maze clears it
+    QString path = m_startupMazeFile;
+    loadMaze(path, false);
+    m_startupLoadNumber = m_loadNumber;
+}
+
+void Window::onMazeLoaded(MazeLoadResult result) {
+
+    // Superseded loads are still worth keeping, if they succeeded
+    if (result.maze != nullptr) {
+        m_mazeCache.insert(
+            result.source,
+            result.lastModified,
+            result.maze,
+            result.truth
+        );
+    }
+    if (result.requestNumber != m_loadNumber) {
+        return;
+    }
+    m_loadProgressBar->hide();
+    bool isStartupLoad = result.requestNumber == m_startupLoadNumber;
+    if (result.maze == nullptr && isStartupLoad) {
+        // The recently used maze is gone, so the blank maze replaces it
+        qWarning().noquote().nospace()
+            << "Unable to load the recently used maze \"" << result.source
+            << "\": " << Maze::errorToString(result.error);
+        SettingsMisc::setRecentMazeFile(m_currentMazeFile);
+        refreshMazeFileComboBox(m_currentMazeFile);
+        m_isStartupMazeShown = true;
+        return;
+    }
+    if (result.maze == nullptr) {
+        refreshMazeFileComboBox(m_currentMazeFile);
+        showInvalidMazeFileWarning(result.source, result.error);
+        return;
+    }
+    showMaze(result.source, result.maze, result.truth, m_isLoadingNewPath);
+    m_isStartupMazeShown = m_isStartupMazeShown || isStartupLoad;
+}
+
+void Window::showMaze(
+        const QString& source,
+        Maze* maze,
+        MazeView* truth,
+        bool isNewPath) {
+    if (isNewPath) {
+        SettingsMazeFiles::addPath(source);
+    }
+    refreshMazeFileComboBox(source);
+    updateMazeAndPath(maze, truth, source);
+}
+
+void Window::showInvalidMazeFileWarning(QString path, const MazeError& error) {
+    QMessageBox::warning(
+        this,
+        "Invalid Maze File",
+        "The following is not a valid maze file:\n\n" + path + "\n\n" +
+        "Reason: " + Maze::errorToString(error) + ".\n\n"
+        "The maze must be nonempty, rectangular, enclosed, and consistent."
+    );
+}
+
+void Window::refreshMazeFileComboBox(QString selected) {
+    QStringList paths;
+    for (const auto& info : QDir(":/resources/mazes/").entryInfoList()) {
+        paths.append(info.absoluteFilePath());
+    }
+    paths.append(SettingsMazeFiles::getAllPaths());
+    QSet<QString> listed = paths.toSet();
+
+    // Library mazes that are also recently used are only listed once, and
+    // invalid ones aren't listed at all; every library maze is described
+    // from its index, rather than read again
+    QHash<QString, MazeLibraryEntry> entries;
+    for (const QVector<MazeLibraryEntry>& directory : m_libraryEntries) {
+        for (const MazeLibraryEntry& entry : directory) {
+            if (!entry.features.isValid) {
+                continue;
+            }
+            if (!entries.contains(entry.features.source)) {
+                entries.insert(entry.features.source, entry);
+                if (!listed.contains(entry.features.source)) {
+                    paths.append(entry.features.source);
+                    listed.insert(entry.features.source);
+                }
+            }
+        }
+    }
+    m_mazeListModel->setSources(paths, entries);
+    m_mazeFileComboBox->select(selected);
+}
+
+void Window::onMazeLibraryIndexed(
+        const QString& directory,
+        const QVector<MazeLibraryEntry>& entries) {
+    if (entries.isEmpty()) {
+        m_libraryEntries.remove(directory);
+    }
+    else {
+        m_libraryEntries.insert(directory, entries);
+    }
+    refreshMazeFileComboBox(m_mazeFileComboBox->getSelectedText());
+}
+
+void Window::onAddLibraryActionTriggered() {
+    QString directory = QFileDialog::getExistingDirectory(
+        this,
+        tr("Add Maze Library Directory")
+    );
+    if (directory.isNull()) {
+        return;
+    }
+    SettingsMazeFiles::addLibraryDirectory(directory);
+    updateLibraryDirectories();
+}
+
+void Window::onRemoveLibraryActionTriggered() {
+    QStringList directories = SettingsMazeFiles::getLibraryDirectories();
+    if (directories.isEmpty()) {
+        QMessageBox::information(
+            this,
+            "No Maze Library Directories",
+            "No maze library directories have been added."
+        );
+        return;
+    }
+    bool ok = false;
+    QString directory = QInputDialog::getItem(
+        this,
+        tr("Remove Maze Library Directory"),
+        "Directory:",
+        directories,
+        0,
+        false,
+        &ok
+    );
+    if (!ok) {
+        return;
+    }
+    SettingsMazeFiles::removeLibraryDirectory(directory);
+    updateLibraryDirectories();
+}
+
+void Window::updateLibraryDirectories() {
+    QMetaObject::invokeMethod(
+        m_mazeLibrary,
+        "setDirectories",
+        Qt::QueuedConnection,
+        Q_ARG(QStringList, SettingsMazeFiles::getLibraryDirectories())
+    );
+}
+
+void Window::onMazeThumbnailRendered(
+        const QString& source,
+        const QImage& thumbnail) {
+    m_mazeListModel->setThumbnail(source, thumbnail);
+}
+
+void Window::updateMazeAndPath(Maze* maze, MazeView* truth, QString path) {
+    updateMaze(maze, truth);
+    m_currentMazeFile = path;
+    SettingsMisc::setRecentMazeFile(path);
+}
+
+void Window::updateMaze(Maze* maze, MazeView* truth) {
+
+    // Stop running maze/mouse algos
+    cancelAllProcesses();
+
+    // Next, update the maze and truth; the spare view only fits the old maze
+    if (maze != m_maze) {
+        delete m_spareView;
+        m_spareView = nullptr;
+    }
+    m_maze = maze;
+    m_truth = truth;
+
+    // Update pointers held by other objects; both are swapped before the
+    // map can paint again, so it never sees a maze with another's truth. A
+    // maze loaded for a replay may not have its truth yet, in which case the
+    // map shows nothing until the replayed view replaces it.
+    m_map->setMaze(m_maze);
+    m_map->setView(m_truth);
+
+    // The old maze and truth are no longer in use, so they may be evicted,
+    // or freed, if they were edited
+    m_mazeCache.trim(m_maze);
+    if (maze != m_editedMaze) {
+        m_mazeEditButton->setChecked(false);
+        delete m_editedTruth;
+        delete m_editedMaze;
+        m_editedTruth = nullptr;
+        m_editedMaze = nullptr;
+    }
+}
+
+void Window::onMazeEditButtonToggled(bool checked) {
+    if (checked && m_maze != nullptr && m_maze != m_editedMaze) {
+
+        // Everything that holds on to the maze is stopped, and the copy then
+        // replaces it; an edited maze is only ever the current one, so
+        // there's no other copy to free
+        cancelAllProcesses();
+        removeMouseFromMaze();
+        ASSERT_TR(m_editedMaze == nullptr);
+        m_editedMaze = Maze::fromWalls(m_maze->getWalls());
+        ASSERT_FA(m_editedMaze == nullptr);
+        m_editedTruth = MazeLoader::createTruth(m_editedMaze);
+        updateMaze(m_editedMaze, m_editedTruth);
+    }
+    m_map->setEditing(checked && m_maze != nullptr);
+}
+
+void Window::onMazeSaveActionTriggered() {
+    if (m_maze == nullptr) {
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(this, tr("Save Maze"));
+    if (path.isNull()) {
+        return;
+    }
+    if (!m_maze->toBinaryFile(path, true)) {
+        QMessageBox::warning(
+            this,
+            "Unable to Save Maze",
+            "The maze couldn't be written to:\n\n" + path
+        );
+        return;
+    }
+
+    // Runs from now on are recorded against the saved file
+    SettingsMazeFiles::addPath(path);
+    refreshMazeFileComboBox(path);
+    m_currentMazeFile = path;
+    SettingsMisc::setRecentMazeFile(path);
+}
+
+void Window::onWallClicked(int x, int y, Direction direction) {
+    ASSERT_TR(m_maze == m_editedMaze);
+    ASSERT_FA(m_editedMaze == nullptr);
+
+    // Only the two tiles on either side of the wall, and those whose
+    // distances changed, are redrawn
+    bool isWall = !m_editedMaze->isWall(x, y, direction);
+    QVector<QPair<int, int>> changed;
+    if (!m_editedMaze->setWall(x, y, direction, isWall, &changed)) {
+        return;
+    }
+    MazeGraphic* mazeGraphic = m_editedTruth->getMazeGraphic();
+    QPair<int, int> sides[] = {
+        {x, y},
+        {x + DIRECTION_DX(direction), y + DIRECTION_DY(direction)},
+    };
+    Direction directions[] = {direction, DIRECTION_OPPOSITE(direction)};
+    for (int i = 0; i < 2; i += 1) {
+        mazeGraphic->refreshTrueWalls(sides[i].first, sides[i].second);
+        if (isWall) {
+            mazeGraphic->setWall(
+                sides[i].first, sides[i].second, directions[i]);
+        }
+        else {
+            mazeGraphic->clearWall(
+                sides[i].first, sides[i].second, directions[i]);
+        }
+    }
+    for (const QPair<int, int>& position : changed) {
+        int distance = m_editedMaze->getDistance(
+            position.first, position.second);
+        mazeGraphic->setText(
+            position.first,
+            position.second,
+            0 <= distance ? QString::number(distance) : "inf"
+        );
+    }
+    m_editedTruth->publishSnapshot();
+    m_map->update();
+
+    // The spare view was built with the old walls
+    delete m_spareView;
+    m_spareView = nullptr;
+}
+
+MazeView* Window::getTruth() {
+    if (m_truth == nullptr) {
+        m_truth = m_mazeCache.getTruth(m_maze);
+    }
+    return m_truth;
+}
+
+void Window::onMouseAlgoComboBoxChanged(QString name) {
+    cancelAllProcesses();
+    m_buildStatus->setText("");
+    m_buildStatus->setStyleSheet("");
+    m_buildOutput->clear();
+    m_runStatus->setText("");
+    m_runStatus->setStyleSheet("");
+    clearRunOutput();
+    SettingsMisc::setRecentMouseAlgo(name);
+
+    // The watch follows the selected algorithm, whose runs are all new
+    m_previousTrail.clear();
+    if (m_watchCheckBox->isChecked()) {
+        onWatchCheckBoxToggled(true);
+    }
+}
+
+void Window::onMouseAlgoEditButtonPressed() {
+
+    // Create the dialog with initial values
+    QString name = m_mouseAlgoComboBox->getSelectedText();
+    ConfigDialog dialog(
+        name,
+        SettingsMouseAlgos::getDirectory(name),
+        SettingsMouseAlgos::getBuildCommand(name),
+        SettingsMouseAlgos::getRunCommand(name),
+        SettingsMouseAlgos::isPlugin(name),
+        SettingsMouseAlgos::getListenPort(name)
+    );
+
+    // Cancel was pressed
+    if (dialog.exec() == QDialog::Rejected) {
+        return;
+    }
+
+    // Remove was pressed
+    if (dialog.removeButtonPressed()) {
+        SettingsMouseAlgos::remove(name);
+        refreshMouseAlgoComboBox("");
+        return;
+    }
+
+    // OK was pressed
+    QString newName = dialog.getName();
+    SettingsMouseAlgos::update(
+        name,
+        newName,
+        dialog.getDirectory(),
+        dialog.getBuildCommand(),
+        dialog.getRunCommand(),
+        dialog.isPlugin(),
+        dialog.getListenPort()
+    );
+
+    // Update the mouse algos
+    refreshMouseAlgoComboBox(newName);
+}
+
+void Window::onMouseAlgoImportButtonPressed() {
+
+    // Create an empty dialog
+    ConfigDialog dialog("", "", "", "", false, 0);
+
+    // Cancel was pressed
+    if (dialog.exec() == QDialog::Rejected) {
+        return;
     }
 
     // Ok was pressed
@@ -477,7 +1490,9 @@ void Window::onMouseAlgoImportButtonPressed() {
         newName,
         dialog.getDirectory(),
         dialog.getBuildCommand(),
-        dialog.getRunCommand()
+        dialog.getRunCommand(),
+        dialog.isPlugin(),
+        dialog.getListenPort()
     );
 
     // Update the mouse algos
@@ -489,10 +1504,23 @@ void Window::refreshMouseAlgoComboBox(QString selected) {
     for (const auto& name : SettingsMouseAlgos::names()) {
         m_mouseAlgoComboBox->addItem(name);
     }
-    m_mouseAlgoComboBox->setCurrentText(selected);
+    m_mouseAlgoComboBox->select(selected);
+    QStringList rivals;
+    for (QAction* action : m_rivalsMenu->actions()) {
+        if (action->isChecked()) {
+            rivals.append(action->text());
+        }
+    }
+    m_rivalsMenu->clear();
+    for (const auto& name : SettingsMouseAlgos::names()) {
+        QAction* action = m_rivalsMenu->addAction(name);
+        action->setCheckable(true);
+        action->setChecked(rivals.contains(name));
+    }
     bool isNonempty = m_mouseAlgoComboBox->count();
     m_mouseAlgoComboBox->setEnabled(isNonempty);
     m_mouseAlgoEditButton->setEnabled(isNonempty);
+    m_rivalsButton->setEnabled(isNonempty);
     m_buildButton->setEnabled(isNonempty);
     m_runButton->setEnabled(isNonempty);
 }
@@ -518,9 +1546,10 @@ void Window::startBuild() {
     ASSERT_TR(m_buildProcess == nullptr);
 
     // Extract the relevant config
-    QString name = m_mouseAlgoComboBox->currentText();
+    QString name = m_mouseAlgoComboBox->getSelectedText();
     QString directory = SettingsMouseAlgos::getDirectory(name);
     QString buildCommand = SettingsMouseAlgos::getBuildCommand(name);
+    QStringList buildArguments = SettingsMouseAlgos::getBuildArguments(name);
 
     // Validation
     if (directory.isEmpty()) {
@@ -528,22 +1557,36 @@ void Window::startBuild() {
             this,
             QString("Empty Directory"),
             QString("Directory for \"%1\" is empty.").arg(
-                m_mouseAlgoComboBox->currentText()
+                m_mouseAlgoComboBox->getSelectedText()
             )
         );
         return;
     }
-    if (buildCommand.isEmpty()) {
+    if (buildArguments.isEmpty()) {
         QMessageBox::warning(
             this,
             QString("Empty Build Command"),
             QString("Build command for \"%1\" is empty.").arg(
-                m_mouseAlgoComboBox->currentText()
+                m_mouseAlgoComboBox->getSelectedText()
             )
         );
         return;
     }
 
+    // Skip the build if nothing changed since the last successful one
+    QString fingerprint =
+        ProcessUtilities::getBuildFingerprint(buildCommand, directory);
+    if (fingerprint == SettingsMouseAlgos::getBuildFingerprint(name)) {
+        m_buildOutput->clear();
+        m_buildOutput->appendPlainText(
+            "Nothing changed since the last successful build"
+        );
+        m_mouseAlgoOutputTabWidget->setCurrentWidget(m_buildOutput);
+        m_buildStatus->setText("UP TO DATE");
+        m_buildStatus->setStyleSheet(COMPLETE_STYLE_SHEET);
+        return;
+    }
+
     // Instantiate a new process
     QProcess* process = new QProcess(this);
 
@@ -572,43 +1615,57 @@ void Window::startBuild() {
         this,
         &Window::onBuildExit
     );
+    connect(process, &QProcess::started, this, [=](){
+        m_buildStatus->setText("BUILDING");
+        m_buildStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
+    });
+
+    // Clean up the failed process, which won't ever exit
+    connect(
+        process,
+        &QProcess::errorOccurred,
+        this,
+        [=](QProcess::ProcessError error){
+            if (error != QProcess::FailedToStart) {
+                return;
+            }
+            m_buildOutput->appendPlainText(process->errorString());
+            onBuildExit(-1, QProcess::CrashExit);
+            m_buildStatus->setText("ERROR");
+            m_buildStatus->setStyleSheet(ERROR_STYLE_SHEET);
+        }
+    );
 
     // Clear the ouput and bring it to the front
     m_buildOutput->clear();
     m_mouseAlgoOutputTabWidget->setCurrentWidget(m_buildOutput);
 
-    // Start the build process
-    if (ProcessUtilities::start(buildCommand, directory, process)) {
+    // Save a pointer to the process, and what's being built
+    m_buildProcess = process;
+    m_buildName = name;
 
-        // Save a pointer to the process
-        m_buildProcess = process;
+    // Update the build button; a build that's still starting can be canceled
+    disconnect(
+        m_buildButton,
+        &QPushButton::clicked,
+        this,
+        &Window::startBuild
+    );
+    connect(
+        m_buildButton,
+        &QPushButton::clicked,
+        this,
+        &Window::cancelBuild
+    );
+    m_buildButton->setText("Cancel");
 
-        // Update the build button
-        disconnect(
-            m_buildButton,
-            &QPushButton::clicked,
-            this,
-            &Window::startBuild
-        );
-        connect(
-            m_buildButton,
-            &QPushButton::clicked,
-            this,
-            &Window::cancelBuild
-        );
-        m_buildButton->setText("Cancel");
+    // Update the build status
+    m_buildStatus->setText("STARTING");
+    m_buildStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
 
-        // Update the build status
-        m_buildStatus->setText("BUILDING");
-        m_buildStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
-    }
-    else {
-        // Clean up the failed process
-        m_buildOutput->appendPlainText(process->errorString());
-        m_buildStatus->setText("ERROR");
-        m_buildStatus->setStyleSheet(ERROR_STYLE_SHEET);
-        delete process;
-    }
+    // Start the build process, without waiting for it to start; it may fail
+    // to start right away, in which case it's already been cleaned up
+    ProcessUtilities::start(buildArguments, directory, process);
 }
 
 void Window::cancelBuild() {
@@ -636,29 +1693,224 @@ void Window::onBuildExit(int exitCode, QProcess::ExitStatus exitStatus) {
     if (exitStatus == QProcess::NormalExit && exitCode == 0) {
         m_buildStatus->setText("COMPLETE");
         m_buildStatus->setStyleSheet(COMPLETE_STYLE_SHEET);
+        // The build's own outputs are part of the fingerprint, so it's only
+        // taken once the build has succeeded
+        QString directory = SettingsMouseAlgos::getDirectory(m_buildName);
+        QString command = SettingsMouseAlgos::getBuildCommand(m_buildName);
+        if (!directory.isEmpty()) {
+            SettingsMouseAlgos::setBuildFingerprint(
+                m_buildName,
+                ProcessUtilities::getBuildFingerprint(command, directory)
+            );
+        }
     }
     else {
         m_buildStatus->setText("FAILED");
         m_buildStatus->setStyleSheet(FAILED_STYLE_SHEET);
     }
 
-    // Clean up
-    delete m_buildProcess;
+    // Clean up, later, since this may be called from one of its signals
+    m_buildProcess->deleteLater();
     m_buildProcess = nullptr;
+    if (m_isReloading) {
+        finishReload(exitStatus == QProcess::NormalExit && exitCode == 0);
+    }
+}
+
+void Window::onWatchCheckBoxToggled(bool checked) {
+    m_watchTimer->stop();
+    m_isWatchChangePending = false;
+    if (!checked) {
+        return;
+    }
+    m_watchName = m_mouseAlgoComboBox->getSelectedText();
+    m_watchFingerprint = getWatchFingerprint();
+    m_watchTimer->start();
+}
+
+void Window::onWatchTimeout() {
+
+    // Builds change the directory too, so it's left alone until they're done
+    if (m_buildProcess != nullptr || m_isReloading) {
+        return;
+    }
+
+    // Editors save in bursts, so the directory must stop changing first
+    QString fingerprint = getWatchFingerprint();
+    if (fingerprint != m_watchFingerprint) {
+        m_watchFingerprint = fingerprint;
+        m_isWatchChangePending = true;
+        return;
+    }
+    if (m_isWatchChangePending) {
+        m_isWatchChangePending = false;
+        reloadAlgo();
+    }
+}
+
+QString Window::getWatchFingerprint() const {
+    QString directory = SettingsMouseAlgos::getDirectory(m_watchName);
+    if (directory.isEmpty()) {
+        return QString();
+    }
+    return ProcessUtilities::getBuildFingerprint(
+        SettingsMouseAlgos::getBuildCommand(m_watchName),
+        directory
+    );
+}
+
+void Window::reloadAlgo() {
+
+    // The run is canceled before the build, which may replace its program
+    cancelRun();
+    m_isReloading = true;
+    if (SettingsMouseAlgos::getBuildArguments(m_watchName).isEmpty()) {
+        finishReload(true);
+        return;
+    }
+    startBuild();
+
+    // A build that was skipped, or that never started, is already done
+    if (m_isReloading && m_buildProcess == nullptr) {
+        finishReload(
+            getWatchFingerprint() ==
+            SettingsMouseAlgos::getBuildFingerprint(m_watchName)
+        );
+    }
+}
+
+void Window::finishReload(bool isBuilt) {
+
+    // Whatever the build did to the directory isn't a change to reload on
+    m_isReloading = false;
+    m_watchFingerprint = getWatchFingerprint();
+    m_isWatchChangePending = false;
+    if (!isBuilt || m_maze == nullptr) {
+        return;
+    }
+    startRun();
+    bool isFastForwarding = (
+        m_engine != nullptr &&
+        m_fastForwardCheckBox->isChecked() &&
+        !m_previousTrail.isEmpty() &&
+        m_previousTrailMaze == m_currentMazeFile
+    );
+    if (isFastForwarding) {
+        m_engine->setFastForward(m_previousTrail);
+        appendRunOutput({QString(
+            "Fast-forwarding through the %1 moves of the previous run"
+        ).arg(m_previousTrail.size())});
+    }
+}
+
+void Window::onFastForwardEnded(int numCells, bool hasDiverged) {
+    if (hasDiverged) {
+        appendRunOutput({QString(
+            "Diverged from the previous run after %1 moves"
+        ).arg(numCells)});
+    }
+    else {
+        appendRunOutput({QString(
+            "Fast-forwarded through the %1 moves of the previous run"
+        ).arg(numCells)});
+    }
+    if (!m_isPaused) {
+        onPauseButtonPressed();
+    }
+}
+
+void Window::appendRunOutput(const QStringList& lines) {
+    if (m_runLog != nullptr) {
+        for (const QString& line : lines) {
+            m_runLog->write(line.toUtf8());
+            m_runLog->write("\n");
+        }
+    }
+    m_runOutputBuffer.append(lines);
+    if (!m_runOutputTimer->isActive()) {
+        m_runOutputTimer->start();
+    }
+}
+
+void Window::flushRunOutput() {
+    m_runOutputTimer->stop();
+    if (m_runLog != nullptr) {
+        m_runLog->flush();
+    }
+    if (m_runOutputBuffer.isEmpty()) {
+        return;
+    }
+    // Only the lines that the run output would keep are worth laying out
+    int maxLines = m_runOutput->maximumBlockCount();
+    if (0 < maxLines && maxLines < m_runOutputBuffer.size()) {
+        m_runOutputBuffer.erase(
+            m_runOutputBuffer.begin(),
+            m_runOutputBuffer.end() - maxLines
+        );
+    }
+    m_runOutput->appendPlainText(m_runOutputBuffer.join("\n"));
+    m_runOutputBuffer.clear();
+}
+
+void Window::clearRunOutput() {
+    m_runOutputTimer->stop();
+    m_runOutputBuffer.clear();
+    m_runOutput->clear();
+}
+
+void Window::refreshStatsPanel() {
+    StatsSample sample = StatsSample();
+    sample.timestamp = SimUtilities::getHighResTimestamp();
+    sample.frame = m_map->getFrameStats().frame;
+    sample.paintSeconds = m_map->getFrameStats().paintSeconds;
+    sample.frameAllocations = m_map->getFrameStats().allocations;
+    sample.frameAllocatedBytes = m_map->getFrameStats().allocatedBytes;
+    sample.isCountingAllocations = AllocationCounter::isEnabled();
+    sample.isRunning = m_runWorker != nullptr && m_engine != nullptr;
+    if (sample.isRunning) {
+        // Bytes are otherwise only taken along with commands
+        m_runMeter->recordInput(m_runWorker->takeNumBytesRead());
+        RunStats stats = m_runMeter->getStats();
+        sample.commands = stats.commands;
+        sample.cpuSeconds = stats.cpuSeconds;
+        sample.bytes = stats.bytesIn + stats.bytesOut;
+        sample.queuedCommands = m_engine->getNumQueuedCommands();
+        sample.maxQueuedCommands = m_engine->getMaxQueuedCommands();
+        sample.moves = m_engine->getNumMoves();
+        sample.turns = m_engine->getNumTurns();
+        sample.knownWalls = m_engine->getKnownWallStats();
+        sample.contest = m_engine->getContestScore();
+        for (const AllocationCounts& counts :
+                m_engine->getCommandAllocations()) {
+            sample.commandAllocations += counts.allocations;
+            sample.commandsCounted += counts.samples;
+        }
+    }
+    m_statsPanel->addSample(sample);
+
+    // The profile changes with every command, and with time, so the overlay
+    // follows it at the rate of the stats rather than of the display
+    if (m_engine != nullptr) {
+        m_engine->refreshProfileOverlay();
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->refreshProfileOverlay();
+    }
 }
 
 void Window::startRun() {
 
     // Only one algo running at a time
-    ASSERT_TR(m_runProcess == nullptr);
+    ASSERT_TR(m_runWorker == nullptr);
 
     // Extract the relevant config
-    QString name = m_mouseAlgoComboBox->currentText();
+    QString name = m_mouseAlgoComboBox->getSelectedText();
     QString directory = SettingsMouseAlgos::getDirectory(name);
-    QString runCommand = SettingsMouseAlgos::getRunCommand(name);
+    QStringList runArguments = SettingsMouseAlgos::getRunArguments(name);
+    int listenPort = SettingsMouseAlgos::getListenPort(name);
 
-    // Validation
-    if (directory.isEmpty()) {
+    // Validation; remote algorithms aren't run, so they need neither
+    if (listenPort == 0 && directory.isEmpty()) {
         QMessageBox::warning(
             this,
             "Empty Directory",
@@ -668,7 +1920,7 @@ void Window::startRun() {
         );
         return;
     }
-    if (runCommand.isEmpty()) {
+    if (listenPort == 0 && runArguments.isEmpty()) {
         QMessageBox::warning(
             this,
             "Empty Run Command",
@@ -678,97 +1930,310 @@ void Window::startRun() {
         );
         return;
     }
+    if (SettingsMouseAlgos::isPlugin(name)) {
+        QMessageBox::warning(
+            this,
+            "Plugin",
+            QString("\"%1\" is a plugin, which only runs in batches.").arg(
+                name
+            )
+        );
+        return;
+    }
     ASSERT_FA(m_maze == nullptr);
 
-    // Remove the old mouse, add a new mouse
+    // The maze stays as it was edited, but can't be edited while it's run
+    m_mazeEditButton->setChecked(false);
+
+    // Remove the old mouse, add a new mouse; the old mouse's view is reset
+    // rather than built again, since it's of the same maze
     removeMouseFromMaze();
-    m_mouse = new Mouse();
-    m_view = new MazeView(m_maze);
-    m_mouseGraphic = new MouseGraphic(m_mouse);
+    if (m_spareView != nullptr) {
+        m_view = m_spareView;
+        m_spareView = nullptr;
+        m_view->reset();
+    }
+    else {
+        m_view = new MazeView(m_maze);
+    }
+    m_engine = new SimulationEngine(m_maze, m_view);
+    m_engine->setProgressPerSecond(progressPerSecond());
+    m_engine->setInstant(m_instantCheckBox->isChecked());
+    m_engine->setContinuous(m_continuousCheckBox->isChecked());
+    m_engine->setFogEnabled(m_fogCheckBox->isChecked());
+    m_engine->setDistanceOverlayEnabled(m_distancesCheckBox->isChecked());
+    m_engine->setProfileOverlay(getProfileMetric());
+    m_engine->setQueueLimit(m_queueLimit);
+    m_engine->setContestRules(m_contestRules);
+    m_engine->setTrailEnabled(true);
+    m_commandLatency.clear();
+    m_engine->setLatency(&m_commandLatency);
+    m_mouseGraphic = new MouseGraphic(m_engine->getMouse());
     m_map->setView(m_view);
     m_map->setMouseGraphic(m_mouseGraphic);
 
-    // Instantiate a new process
-    QProcess* process = new QProcess();
+    // The ghosts are read before this run is recorded, so that the last run
+    // is the one before it
+    startGhostRuns();
+    if (m_commandTrace != nullptr) {
+        m_commandTrace->recordRun(m_currentMazeFile);
+        m_engine->setTrace(m_commandTrace);
+    }
+    if (m_spectatorServer != nullptr) {
+        m_spectatorServer->setRun(m_maze, m_view, m_engine->getMouse());
+    }
+    connect(
+        m_engine,
+        &SimulationEngine::responsesReady,
+        this,
+        &Window::writeResponses
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::resetAcknowledged,
+        this,
+        &Window::onResetAcknowledged
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::fastForwardEnded,
+        this,
+        &Window::onFastForwardEnded
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::contestOver,
+        this,
+        [=](){
+            appendRunOutput({"Contest over: " + ContestScorer::scoreToString(
+                m_engine->getContestScore()
+            )});
+        }
+    );
+    connect(
+        m_engine,
+        &SimulationEngine::displayChanged,
+        this,
+        [=](){
+            syncGhostRuns();
+            if (m_spectatorServer != nullptr) {
+                m_spectatorServer->update();
+            }
+            m_map->update();
+        }
+    );
+
+    // Instantiate a new worker for the process, on the I/O thread
+    ProcessWorker* worker = new ProcessWorker();
+    worker->moveToThread(m_ioThread);
+    m_runNumber += 1;
+    int runNumber = m_runNumber;
 
     // Print stderr
-    connect(process, &QProcess::readyReadStandardError, this, [=](){
-        QString output = process->readAllStandardError();
-        QStringList logs = processText(output, &m_logBuffer);
-        for (QString log : logs) {
-            m_runOutput->appendPlainText(log);
+    connect(worker, &ProcessWorker::logsReady, this, [=](QStringList logs){
+        if (runNumber != m_runNumber) {
+            return;
         }
+        appendRunOutput(logs);
     });
 
-    // Process commands from stdout
-    connect(process, &QProcess::readyReadStandardOutput, this, [=](){
-        QString output = process->readAllStandardOutput();
-        QStringList commands = processText(output, &m_commandBuffer);
-        for (QString command : commands) {
-            dispatchCommand(command);
+    // Process commands from stdout, and pick up where we left off whenever
+    // the engine makes room (but not from within the engine)
+    connect(worker, &ProcessWorker::commandsAvailable, this, [=](){
+        if (runNumber != m_runNumber) {
+            return;
         }
+        onRunCommandsAvailable();
     });
+    connect(
+        m_engine,
+        &SimulationEngine::queueReady,
+        this,
+        [=](){
+            if (runNumber != m_runNumber) {
+                return;
+            }
+            onRunCommandsAvailable();
+        },
+        Qt::QueuedConnection
+    );
 
     // Clean up on exit
     connect(
-        process,
-        static_cast<void(QProcess::*)(int, QProcess::ExitStatus)>(
-            &QProcess::finished
-        ),
+        worker,
+        &ProcessWorker::finished,
         this,
-        &Window::onRunExit
+        [=](int exitCode, QProcess::ExitStatus exitStatus){
+            if (runNumber != m_runNumber) {
+                return;
+            }
+            onRunExit(exitCode, exitStatus);
+        }
     );
 
-    // Clear the ouput and bring it to the front
-    m_runOutput->clear();
-    m_mouseAlgoOutputTabWidget->setCurrentWidget(m_runOutput);
-
-    // Start the run process
-    if (ProcessUtilities::start(runCommand, directory, process)) {
-
-        // Save a pointer to the process
-        m_runProcess = process;
-
-        // Update the run button
-        disconnect(
-            m_runButton,
-            &QPushButton::clicked,
-            this,
-            &Window::startRun
-        );
-        connect(
-            m_runButton,
-            &QPushButton::clicked,
-            this,
-            &Window::cancelRun
-        );
-        m_runButton->setText("Cancel");
-
-        // Update the run status
+    // Only enabled while mouse is running
+    connect(worker, &ProcessWorker::started, this, [=](qint64 processId){
+        if (runNumber != m_runNumber) {
+            return;
+        }
+        m_runMeter->setProcessId(processId);
         m_runStatus->setText("RUNNING");
         m_runStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
-
-        // Only enabled while mouse is running
         m_pauseButton->setEnabled(true);
         m_resetButton->setEnabled(true);
-    } 
-    else {
-        // Clean up the failed process
-        m_runOutput->appendPlainText(process->errorString());
+    });
+
+    // Clean up the failed process, which won't ever exit
+    connect(worker, &ProcessWorker::failedToStart, this, [=](QString error){
+        if (runNumber != m_runNumber) {
+            return;
+        }
+        appendRunOutput({error});
+        onRunExit(-1, QProcess::CrashExit);
         m_runStatus->setText("ERROR");
         m_runStatus->setStyleSheet(ERROR_STYLE_SHEET);
         removeMouseFromMaze();
-        delete process;
+    });
+
+    // Clear the ouput and bring it to the front
+    clearRunOutput();
+    m_mouseAlgoOutputTabWidget->setCurrentWidget(m_runOutput);
+
+    // Save a pointer to the worker
+    m_runWorker = worker;
+
+    // Update the run button; a run that's still starting can be canceled
+    disconnect(
+        m_runButton,
+        &QPushButton::clicked,
+        this,
+        &Window::startRun
+    );
+    connect(
+        m_runButton,
+        &QPushButton::clicked,
+        this,
+        &Window::cancelRun
+    );
+    m_runButton->setText("Cancel");
+
+    // Update the run status
+    m_runStatus->setText("STARTING");
+    m_runStatus->setStyleSheet(IN_PROGRESS_STYLE_SHEET);
+
+    // Start the rivals first, so that none of them gets a head start on it
+    startRivalRuns();
+
+    // Start the run process, or wait for the algorithm to connect, without
+    // waiting for either
+    m_runMeter->start();
+    m_latencyTimer->start();
+    refreshLatencyOutput();
+    if (listenPort != 0) {
+        appendRunOutput({QString(
+            "Waiting for the algorithm to connect to port %1"
+        ).arg(listenPort)});
+        QMetaObject::invokeMethod(
+            worker,
+            "listen",
+            Qt::QueuedConnection,
+            Q_ARG(int, listenPort)
+        );
+        return;
     }
+    QMetaObject::invokeMethod(
+        worker,
+        "start",
+        Qt::QueuedConnection,
+        Q_ARG(QStringList, runArguments),
+        Q_ARG(QString, directory)
+    );
 }
 
 void Window::cancelRun() {
-    cancelProcess(m_runProcess, m_runStatus);
+    if (m_runWorker != nullptr) {
+        // The process can't be sampled once it's been killed
+        m_runMeter->stop();
+        QMetaObject::invokeMethod(
+            m_runWorker,
+            "kill",
+            Qt::BlockingQueuedConnection
+        );
+        // The exit notification is queued behind us; clean up right away
+        onRunExit(-1, QProcess::CrashExit);
+        m_runStatus->setText("CANCELED");
+        m_runStatus->setStyleSheet(CANCELED_STYLE_SHEET);
+    }
     removeMouseFromMaze();
 }
 
 void Window::onRunExit(int exitCode, QProcess::ExitStatus exitStatus) {
 
+    // Show whatever the run logged last, followed by what it used
+    m_runMeter->recordInput(m_runWorker->takeNumBytesRead());
+    m_runMeter->stop();
+    RunStats stats = m_runMeter->getStats();
+    appendRunOutput({"Run stats: " + RunMeter::format(stats)});
+    if (m_engine->isContinuous()) {
+        appendRunOutput({QString("Simulated mouse time: %1 s").arg(
+            QString::number(m_engine->getSimulatedSeconds(), 'f', 3)
+        )});
+    }
+    appendRunOutput({"Coverage: " + SimulationEngine::coverageToString(
+        m_engine->getCoverage()
+    )});
+    appendRunOutput({"Walls: " + SimulationEngine::knownWallsToString(
+        m_engine->getKnownWallStats()
+    )});
+    appendRunOutput({"Contest: " + ContestScorer::scoreToString(
+        m_engine->getContestScore()
+    )});
+    // The first few wrong walls are enough to find the misread sensor
+    QVector<Wall> wrongWalls = m_engine->getWrongWalls();
+    for (int i = 0; i < wrongWalls.size() && i < 10; i += 1) {
+        appendRunOutput({QString("Declared wrong: %1 %2 %3").arg(
+            QString::number(wrongWalls.at(i).x),
+            QString::number(wrongWalls.at(i).y),
+            QString(DIRECTION_TO_CHAR(wrongWalls.at(i).d))
+        )});
+    }
+    if (10 < wrongWalls.size()) {
+        appendRunOutput({QString("... and %1 more declared wrong").arg(
+            wrongWalls.size() - 10
+        )});
+    }
+    appendRunOutput({QString("Peak queued commands: %1 (limit: %2)").arg(
+        QString::number(m_engine->getMaxQueuedCommands()),
+        0 < m_queueLimit ? QString::number(m_queueLimit) : "none"
+    )});
+    appendRunOutput({QString("Simulation clock: %1 ticks (%2 s)").arg(
+        QString::number(m_engine->getClock().getTicks()),
+        QString::number(m_engine->getClock().getSeconds(), 'f', 3)
+    )});
+    QStringList trialSeconds;
+    for (double seconds : m_engine->getEstimatedTrialSeconds()) {
+        trialSeconds.append(QString::number(seconds, 'f', 3) + " s");
+    }
+    appendRunOutput({QString("Estimated run time of each trial: %1").arg(
+        trialSeconds.join(", ")
+    )});
+    RunSummary summary = m_engine->getSummary();
+    appendRunOutput({"Summary: " + SimulationEngine::summaryToString(summary)});
+    if (AllocationCounter::isEnabled()) {
+        appendRunOutput({
+            "Allocations per command: " +
+            SimulationEngine::commandAllocationsToString(
+                m_engine->getCommandAllocations()
+            )
+        });
+    }
+    flushRunOutput();
+    logRunSummary(summary, stats);
+    logCellProfile();
+    m_latencyTimer->stop();
+    refreshLatencyOutput();
+    logLatency();
+
     // Always unpause on exit
     if (m_isPaused) {
         onPauseButtonPressed();
@@ -778,7 +2243,6 @@ void Window::onRunExit(int exitCode, QProcess::ExitStatus exitStatus) {
     m_pauseButton->setEnabled(false);
     m_resetButton->setEnabled(false);
     m_resetButton->setText("Reset");
-    m_wasReset = false;
 
     // Update the run button
     disconnect(
@@ -805,612 +2269,563 @@ void Window::onRunExit(int exitCode, QProcess::ExitStatus exitStatus) {
         m_runStatus->setStyleSheet(FAILED_STYLE_SHEET);
     }
 
-    // Clean up (stop producing commands)
-    delete m_runProcess;
-    m_runProcess = nullptr;
+    // Clean up (stop producing commands); anything the worker sent before it
+    // goes away belongs to this run and is ignored from now on
+    m_runWorker->deleteLater();
+    m_runWorker = nullptr;
+    m_runNumber += 1;
 
     // Stop consuming queued commands
-    m_commandQueueTimer->stop();
-    m_commandQueue.clear();
+    m_engine->stop();
 }
 
-void Window::removeMouseFromMaze() {
-
-    // No-op if no mouse
-    if (m_mouse == nullptr) {
-        return;
+void Window::startRivalRuns() {
+    ASSERT_TR(m_rivalRuns.isEmpty());
+    QVector<const MouseGraphic*> graphics;
+    for (QAction* action : m_rivalsMenu->actions()) {
+        if (!action->isChecked()) {
+            continue;
+        }
+        QString name = action->text();
+        QString directory = SettingsMouseAlgos::getDirectory(name);
+        QStringList runArguments = SettingsMouseAlgos::getRunArguments(name);
+        if (directory.isEmpty() || runArguments.isEmpty()) {
+            appendRunOutput({QString(
+                "Skipped rival \"%1\", whose directory or run command is empty"
+            ).arg(name)});
+            continue;
+        }
+        if (SettingsMouseAlgos::isPlugin(name)) {
+            appendRunOutput({QString(
+                "Skipped rival \"%1\", which is a plugin"
+            ).arg(name)});
+            continue;
+        }
+        if (SettingsMouseAlgos::getListenPort(name) != 0) {
+            appendRunOutput({QString(
+                "Skipped rival \"%1\", which connects over TCP"
+            ).arg(name)});
+            continue;
+        }
+        RivalRun* rival = new RivalRun(name, m_maze, m_ioThread);
+        rival->getEngine()->setPaused(m_isPaused);
+        rival->getEngine()->setProgressPerSecond(progressPerSecond());
+        rival->getEngine()->setInstant(m_instantCheckBox->isChecked());
+        rival->getEngine()->setContinuous(m_continuousCheckBox->isChecked());
+        rival->getEngine()->setFogEnabled(m_fogCheckBox->isChecked());
+        rival->getEngine()->setDistanceOverlayEnabled(
+            m_distancesCheckBox->isChecked());
+        rival->getEngine()->setProfileOverlay(getProfileMetric());
+        connect(
+            rival->getEngine(),
+            &SimulationEngine::displayChanged,
+            this,
+            [=](){
+                m_map->update();
+            }
+        );
+        connect(
+            rival,
+            &RivalRun::logsReady,
+            this,
+            &Window::appendRunOutput
+        );
+        m_rivalRuns.append(rival);
+        graphics.append(rival->getMouseGraphic());
+        rival->start(runArguments, directory);
     }
-
-    // Update some objects
-    m_map->setView(m_truth);
-    m_map->setMouseGraphic(nullptr);
-
-    // Delete some objects
-    ASSERT_FA(m_view == nullptr);
-    ASSERT_FA(m_mouseGraphic == nullptr);
-    delete m_mouse;
-    m_mouse = nullptr;
-    delete m_view;
-    m_view = nullptr;
-    delete m_mouseGraphic;
-    m_mouseGraphic = nullptr;
-
-    // Reset communication state
-    m_logBuffer.clear();
-    m_commandBuffer.clear();
-
-    // Reset movement state
-    m_startingLocation = {0, 0};
-    m_startingDirection = Direction::NORTH;
-    m_movement = Movement::NONE;
-    m_movementProgress = 0.0;
-    m_movementStepSize = 0.0;
-
-    // Reset other mouse state
-    m_tilesWithColor.clear();
-    m_tilesWithText.clear();
+    m_map->setRivalMouseGraphics(graphics);
 }
 
-void Window::onPauseButtonPressed() {
-    m_isPaused = !m_isPaused;
-    if (m_isPaused) {
-        m_pauseButton->setText("Resume");
-        m_runStatus->setText("PAUSED");
-    }
-    else {
-        m_pauseButton->setText("Pause");
-        m_runStatus->setText("RUNNING");
-        processQueuedCommands();
+void Window::removeRivalsFromMaze() {
+    m_map->setRivalMouseGraphics({});
+    for (RivalRun* rival : m_rivalRuns) {
+        delete rival;
     }
+    m_rivalRuns.clear();
 }
 
-void Window::onResetButtonPressed() {
-    m_resetButton->setEnabled(false);
-    m_resetButton->setText("Waiting");
-    m_wasReset = true;
-}
-
-QStringList Window::processText(QString text, QStringList* buffer) {
-
-    QStringList lines;
-
-    // Separate the text by line
-    text.replace("\r", "");  // Windows compatibility
-    QStringList parts = text.split("\n");
-
-    // If the text has at least one newline character, we definitely have a
-    // complete line; combine it with the contents of the buffer and append
-    // it to the list of lines to be returned
-    if (1 < parts.size()) {
-        lines.append(buffer->join("") + parts.at(0));
-        buffer->clear();
-    }
-
-    // All newline-separated parts in the text are lines
-    for (int i = 1; i < parts.size() - 1; i += 1) {
-        lines.append(parts.at(i));
-    }
-
-    // Store the last part of the text (empty string if the text ended
-    // with newline) in the buffer, to be combined with future input
-    buffer->append(parts.at(parts.size() - 1));
-
-    return lines;
+const QStringList& Window::GHOST_KINDS() {
+    static const QStringList kinds = QStringList({"best", "last"}) +
+        ReferenceSolvers::names();
+    return kinds;
 }
 
-void Window::dispatchCommand(QString command) {
-
-    // For performance reasons, handle no-response commands inline (don't queue
-    // them with the commands that elicit a response, just perform the action)
-    if (
-        command.startsWith("setWall") ||
-        command.startsWith("clearWall")
-    ) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 4) {
-            return;
-        }
-        if (!(tokens.at(0) == "setWall" || tokens.at(0) == "clearWall")) {
-            return;
-        }
-        bool ok = true;
-        int x = tokens.at(1).toInt(&ok);
-        int y = tokens.at(2).toInt(&ok);
-        if (!ok) {
-            return;
-        }
-        if (tokens.at(3).size() != 1) {
-            return;
-        }
-        QChar direction = tokens.at(3).at(0);
-        if (!CHAR_TO_DIRECTION().contains(direction)) {
-            return;
-        }
-        if (command.startsWith("setWall")) {
-            setWall(x, y, direction);
-        }
-        else if (command.startsWith("clearWall")) {
-            clearWall(x, y, direction);
-        }
-        else {
-            ASSERT_NEVER_RUNS();
+void Window::startGhostRuns() {
+    ASSERT_TR(m_ghostRuns.isEmpty());
+    QStringList kinds;
+    for (QAction* action : m_ghostsMenu->actions()) {
+        if (action->isChecked()) {
+            kinds.append(action->data().toString());
         }
     }
-    else if (command.startsWith("setColor")) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 4) {
-            return;
-        }
-        if (tokens.at(0) != "setColor") {
-            return;
-        }
-        bool ok = true;
-        int x = tokens.at(1).toInt(&ok);
-        int y = tokens.at(2).toInt(&ok);
-        if (!ok) {
-            return;
-        }
-        if (tokens.at(3).size() != 1) {
-            return;
+
+    // Only runs of the same maze file are replayed, and runs that never
+    // sent a command aren't runs at all
+    QVector<TraceRun> runs;
+    if (kinds.contains("best") || kinds.contains("last")) {
+        QString path = m_ghostTracePath;
+        if (path.isEmpty()) {
+            path = m_commandTracePath;
         }
-        QChar color = tokens.at(3).at(0);
-        if (!CHAR_TO_COLOR().contains(color)) {
-            return;
+        if (m_commandTrace != nullptr && path == m_commandTracePath) {
+            m_commandTrace->flush();
         }
-        setColor(x, y, color);
-    }
-    else if (command.startsWith("clearColor")) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 3) {
-            return;
+        QVector<TraceRun> traced;
+        if (path.isEmpty()) {
+            appendRunOutput({"Skipped ghosts of previous runs, with no trace"});
         }
-        if (tokens.at(0) != "clearColor") {
-            return;
+        else if (!CommandTrace::read(path, &traced)) {
+            appendRunOutput({QString(
+                "Skipped ghosts of previous runs, unable to read \"%1\""
+            ).arg(path)});
         }
-        bool ok = true;
-        int x = tokens.at(1).toInt(&ok);
-        int y = tokens.at(2).toInt(&ok);
-        if (!ok) {
-            return;
+        for (const TraceRun& run : traced) {
+            if (run.mazeSource == m_currentMazeFile && 0 < run.numCommands) {
+                runs.append(run);
+            }
         }
-        clearColor(x, y);
     }
-    else if (command.startsWith("clearAllColor")) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 1) {
-            return;
-        }
-        if (tokens.at(0) != "clearAllColor") {
-            return;
+    if (kinds.contains("best")) {
+
+        // Every run is replayed to find its time, one at a time
+        GhostRun* best = nullptr;
+        for (const TraceRun& run : runs) {
+            GhostRun* ghost = new GhostRun("best", m_maze, run);
+            qint64 ticks = ghost->getSolveTicks();
+            if (ticks != -1 && (
+                best == nullptr || ticks < best->getSolveTicks()
+            )) {
+                delete best;
+                best = ghost;
+            }
+            else {
+                delete ghost;
+            }
         }
-        clearAllColor();
-    }
-    else if (command.startsWith("setText")) {
-        // Special parsing to allow space characters in the text
-        int firstSpace = command.indexOf(" ");
-        int secondSpace = command.indexOf(" ", firstSpace + 1);
-        int thirdSpace = command.indexOf(" ", secondSpace + 1);
-        QString function = command.left(firstSpace);
-        if (function != "setText") {
-            return;
+        if (best == nullptr) {
+            appendRunOutput({"Skipped best ghost, with no run that solved"});
         }
-        QString xString = command.mid(firstSpace + 1, secondSpace - firstSpace);
-        QString yString = command.mid(secondSpace + 1, thirdSpace - secondSpace);
-        bool ok = true;
-        int x = xString.toInt(&ok);
-        int y = yString.toInt(&ok);
-        if (!ok) {
-            return;
+        else {
+            m_ghostRuns.append(best);
         }
-        QString text = command.mid(thirdSpace + 1);
-        setText(x, y, text);
     }
-    else if (command.startsWith("clearText")) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 3) {
-            return;
-        }
-        if (tokens.at(0) != "clearText") {
-            return;
+    if (kinds.contains("last")) {
+        if (runs.isEmpty()) {
+            appendRunOutput({"Skipped last ghost, with no previous run"});
         }
-        bool ok = true;
-        int x = tokens.at(1).toInt(&ok);
-        int y = tokens.at(2).toInt(&ok);
-        if (!ok) {
-            return;
+        else {
+            m_ghostRuns.append(new GhostRun("last", m_maze, runs.last()));
         }
-        clearText(x, y);
     }
-    else if (command.startsWith("clearAllText")) {
-        QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-        if (tokens.size() != 1) {
-            return;
-        }
-        if (tokens.at(0) != "clearAllText") {
-            return;
+    for (const QString& name : ReferenceSolvers::names()) {
+        if (kinds.contains(name)) {
+            m_ghostRuns.append(new GhostRun(
+                name,
+                m_maze,
+                ReferenceSolvers::getCommands(name, m_maze)
+            ));
         }
-        clearAllText();
     }
-    else {
-        // Enqueue the serial command, process it if
-        // future processing is not already scheduled
-        m_commandQueue.enqueue(command);
-        if (!m_commandQueueTimer->isActive()) {
-            processQueuedCommands();
-        }
+
+    QVector<const MouseGraphic*> graphics;
+    for (GhostRun* ghost : m_ghostRuns) {
+        graphics.append(ghost->getMouseGraphic());
     }
+    m_map->setGhostMouseGraphics(graphics);
 }
 
-QString Window::executeCommand(QString command) {
-    QStringList tokens = command.split(" ", QString::SkipEmptyParts);
-    if (tokens.size() != 1) {
-        return INVALID;
-    }
-    QString function = tokens.at(0);
-    if (function == "mazeWidth") {
-        return QString::number(mazeWidth());
-    }
-    else if (function == "mazeHeight") {
-        return QString::number(mazeHeight());
-    }
-    else if (function == "wallFront") {
-        return boolToString(wallFront());
-    }
-    else if (function == "wallRight") {
-        return boolToString(wallRight());
-    }
-    else if (function == "wallLeft") {
-        return boolToString(wallLeft());
-    }
-    else if (function == "moveForward") {
-        bool success = moveForward();
-        return success ? "" : CRASH;
-    }
-    else if (function == "turnRight") {
-        turnRight();
-        return "";
-    }
-    else if (function == "turnLeft") {
-        turnLeft();
-        return "";
-    }
-    else if (function == "wasReset") {
-        return boolToString(wasReset());
-    }
-    else if (function == "ackReset") {
-        ackReset();
-        return ACK;
+void Window::syncGhostRuns() {
+    if (m_engine == nullptr) {
+        return;
     }
-    else {
-        return INVALID;
+    qint64 ticks = m_engine->getClock().getTicks();
+    for (GhostRun* ghost : m_ghostRuns) {
+        ghost->syncTo(ticks);
     }
 }
 
-void Window::processQueuedCommands() {
-    while (!m_commandQueue.isEmpty() && !m_isPaused) {
-        QString response = "";
-        if (isMoving()) {
-            updateMouseProgress(m_movementStepSize);
-            if (!isMoving()) {
-                response = ACK;
-            }
-        }
-        else {
-            response = executeCommand(m_commandQueue.head());
-        }
-        if (!response.isEmpty()) {
-            // Drop all invalid commands on the floor
-            if (response != INVALID) {
-                m_runProcess->write((response + "\n").toStdString().c_str());
-            }
-            m_commandQueue.dequeue();
-        }
-        else {
-            scheduleMouseProgressUpdate();
-            break;
-        }
+void Window::removeGhostsFromMaze() {
+    m_map->setGhostMouseGraphics({});
+    for (GhostRun* ghost : m_ghostRuns) {
+        delete ghost;
     }
+    m_ghostRuns.clear();
 }
 
-double Window::progressRequired(Movement movement) {
-    switch (movement) {
-        case Movement::MOVE_FORWARD:
-            return PROGRESS_REQUIRED_FOR_MOVE;
-        case Movement::TURN_RIGHT:
-        case Movement::TURN_LEFT:
-            return PROGRESS_REQUIRED_FOR_TURN;
-        default:
-            ASSERT_NEVER_RUNS();
-    }
-}
+void Window::removeMouseFromMaze() {
 
-void Window::updateMouseProgress(double progress) {
+    // A replayed mouse goes away too, as do the rivals and ghosts
+    stopReplay();
+    removeRivalsFromMaze();
+    removeGhostsFromMaze();
 
-    // Determine the destination of the mouse.
-    QPair<int, int> destinationLocation = m_startingLocation;
-    Angle destinationRotation =
-        DIRECTION_TO_ANGLE().value(m_startingDirection);
-    if (m_movement == Movement::MOVE_FORWARD) {
-        if (m_startingDirection == Direction::NORTH) {
-            destinationLocation.second += 1;
-        }
-        else if (m_startingDirection == Direction::EAST) {
-            destinationLocation.first += 1;
-        }
-        else if (m_startingDirection == Direction::SOUTH) {
-            destinationLocation.second -= 1;
-        }
-        else if (m_startingDirection == Direction::WEST) {
-            destinationLocation.first -= 1;
-        }
-        else {
-            ASSERT_NEVER_RUNS();
-        }
-    }
-    // Explicity add or subtract 90 degrees so that the mouse is guaranteed to
-    // only rotate 90 degrees (using DIRECTION_ROTATE can cause the mouse to
-    // rotate 270 degrees in the opposite direction in some cases)
-    else if (m_movement == Movement::TURN_RIGHT) {
-        destinationRotation -= Angle::Degrees(90);
-    }
-    else if (m_movement == Movement::TURN_LEFT) {
-        destinationRotation += Angle::Degrees(90);
+    // No-op if no mouse
+    if (m_engine == nullptr) {
+        return;
     }
-    else {
-        ASSERT_NEVER_RUNS();
-    }
-
-    // Increment the movement progress, calculate fraction complete
-    m_movementProgress += progress;
-    double required = progressRequired(m_movement);
-    double remaining = required - m_movementProgress;
-    if (remaining < 0) {
-        remaining = 0;
-    }
-    double fraction = 1.0 - (remaining / required);
-
-    // Calculate the current translation and rotation
-    Coordinate startingTranslation =
-        getCenterOfTile(m_startingLocation.first, m_startingLocation.second);
-    Coordinate destinationTranslation =
-        getCenterOfTile(destinationLocation.first, destinationLocation.second);
-    Angle startingRotation =
-        DIRECTION_TO_ANGLE().value(m_startingDirection);
-    Coordinate currentTranslation =
-        startingTranslation * (1.0 - fraction) +
-        destinationTranslation * fraction;
-    Angle currentRotation =
-        startingRotation * (1.0 - fraction) +
-        destinationRotation * fraction;
-
-    // Teleport the mouse, reset movement state if done
-    m_mouse->teleport(currentTranslation, currentRotation);
-    if (remaining == 0.0) {
-        m_startingLocation = m_mouse->getCurrentDiscretizedTranslation();
-        m_startingDirection = m_mouse->getCurrentDiscretizedRotation();
-        m_movement = Movement::NONE;
-        m_movementProgress = 0.0;
-        m_movementStepSize = 0.0;
-    }
-}
-
-void Window::scheduleMouseProgressUpdate() {
-    
-    // Calculate progressRemaining, should be nonzero
-    double required = progressRequired(m_movement);
-    double progressRemaining = required - m_movementProgress;
-    ASSERT_LT(0.0, progressRemaining);
 
-    // Calculate progressPerSecond for non-linear slider
-    double value = static_cast<double>(m_speedSlider->value());
-    double fraction = value / SPEED_SLIDER_MAX;
-    double rangeMin = qPow(MIN_PROGRESS_PER_SECOND, .25);
-    double rangeMax = qPow(MAX_PROGRESS_PER_SECOND, .25);
-    double rangeValue = (1.0 - fraction) * rangeMin + fraction * rangeMax;
-    double progressPerSecond = qPow(rangeValue, 4);
+    // The next run may fast-forward through this one
+    m_previousTrail = m_engine->getTrail();
+    m_previousTrailMaze = m_currentMazeFile;
 
-    // Determine seconds remaing
-    double secondsRemaining = progressRemaining / progressPerSecond;
-    if (secondsRemaining > MAX_SLEEP_SECONDS) {
-        secondsRemaining = MAX_SLEEP_SECONDS;
-        progressRemaining = secondsRemaining * progressPerSecond;
+    // Update some objects
+    if (m_spectatorServer != nullptr) {
+        m_spectatorServer->setRun(nullptr, nullptr, nullptr);
     }
+    m_map->setView(getTruth());
+    m_map->setMouseGraphic(nullptr);
 
-    // Update step size, set the timer
-    m_movementStepSize = progressRemaining;
-    m_commandQueueTimer->start(secondsRemaining * 1000);
+    // Delete some objects
+    ASSERT_FA(m_view == nullptr);
+    ASSERT_FA(m_mouseGraphic == nullptr);
+    delete m_engine;
+    m_engine = nullptr;
+    delete m_spareView;
+    m_spareView = m_view;
+    m_view = nullptr;
+    delete m_mouseGraphic;
+    m_mouseGraphic = nullptr;
 }
 
-bool Window::isMoving() {
-    return m_movement != Movement::NONE;
+void Window::onReplayPlayButtonPressed() {
+    if (m_replayTimer->isActive()) {
+        m_replayTimer->stop();
+        m_replayPlayButton->setText("Play");
+        return;
+    }
+    // Playing from the end starts over
+    if (m_replaySlider->value() == getReplayLength()) {
+        seekReplay(0);
+    }
+    m_replayCommandsOwed = 0.0;
+    m_replayTimer->start();
+    m_replayPlayButton->setText("Pause");
 }
 
-int Window::mazeWidth() {
-    return m_maze->getWidth();
+void Window::onReplayTick() {
+    int position = getReplayLength();
+    if (!m_instantCheckBox->isChecked()) {
+        m_replayCommandsOwed += progressPerSecond() * REPLAY_TICK_MS / 1000.0;
+        int count = static_cast<int>(m_replayCommandsOwed);
+        m_replayCommandsOwed -= count;
+        position = qMin(m_replaySlider->value() + count, position);
+    }
+    seekReplay(position);
+    if (position == getReplayLength()) {
+        m_replayTimer->stop();
+        m_replayPlayButton->setText("Play");
+    }
 }
 
-int Window::mazeHeight() {
-    return m_maze->getHeight();
+void Window::seekReplay(int position) {
+    m_replay->seek(qMin(position, m_replay->getLength()));
+    if (m_comparedReplay != nullptr) {
+        m_comparedReplay->seek(
+            qMin(position, m_comparedReplay->getLength()));
+        updateComparedFog();
+    }
+    {
+        QSignalBlocker blocker(m_replaySlider);
+        m_replaySlider->setValue(position);
+    }
+    m_replayPosition->setText(QString("%1 / %2").arg(
+        QString::number(position),
+        QString::number(getReplayLength())
+    ));
+    // The seek is shown right away, rather than once the replayed engine
+    // gets around to publishing it
+    m_view->publishSnapshot();
+    m_map->update();
+    if (m_comparedReplay != nullptr) {
+        m_comparedView->publishSnapshot();
+        m_comparedMap->update();
+    }
 }
 
-bool Window::wallFront() {
-    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
-    Direction direction = m_mouse->getCurrentDiscretizedRotation();
-    return isWall({position.first, position.second, direction});
+int Window::getReplayLength() const {
+    if (m_comparedReplay == nullptr) {
+        return m_replay->getLength();
+    }
+    return qMax(m_replay->getLength(), m_comparedReplay->getLength());
 }
 
-bool Window::wallRight() {
-    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
-    Direction direction =
-        DIRECTION_ROTATE_RIGHT().value(m_mouse->getCurrentDiscretizedRotation());
-    return isWall({position.first, position.second, direction});
+void Window::updateComparedFog() {
+    MazeGraphic* graphic = m_view->getMazeGraphic();
+    MazeGraphic* comparedGraphic = m_comparedView->getMazeGraphic();
+    for (int x = 0; x < m_maze->getWidth(); x += 1) {
+        for (int y = 0; y < m_maze->getHeight(); y += 1) {
+            bool visited = 0 < m_replay->getVisitCount(x, y);
+            bool comparedVisited = 0 < m_comparedReplay->getVisitCount(x, y);
+            graphic->setFog(x, y, comparedVisited && !visited);
+            comparedGraphic->setFog(x, y, visited && !comparedVisited);
+        }
+    }
 }
 
-bool Window::wallLeft() {
-    QPair<int, int> position = m_mouse->getCurrentDiscretizedTranslation();
-    Direction direction =
-        DIRECTION_ROTATE_LEFT().value(m_mouse->getCurrentDiscretizedRotation());
-    return isWall({position.first, position.second, direction});
-}
+void Window::stopReplay() {
 
-bool Window::moveForward() {
-    if (wallFront()) {
-        return false;
+    // No-op if not replaying
+    if (m_replay == nullptr) {
+        return;
     }
-    m_movement = Movement::MOVE_FORWARD;
-    return true;
-}
-
-void Window::turnRight() {
-    m_movement = Movement::TURN_RIGHT;
-}
+    m_replayTimer->stop();
+    m_replayControls->hide();
+    m_runStatus->setText("");
+    m_runStatus->setStyleSheet("");
 
-void Window::turnLeft() {
-    m_movement = Movement::TURN_LEFT;
+    // Take down the compared replay, if any
+    if (m_comparedReplay != nullptr) {
+        m_comparedMap->setMouseGraphic(nullptr);
+        m_comparedMap->setView(nullptr);
+        m_comparedMap->setMaze(nullptr);
+        m_comparedMap->hide();
+        m_replayDivergenceButton->hide();
+        delete m_comparedReplay;
+        m_comparedReplay = nullptr;
+        delete m_comparedView;
+        m_comparedView = nullptr;
+        delete m_comparedMouseGraphic;
+        m_comparedMouseGraphic = nullptr;
+    }
+
+    // Restore the truth, and delete the replayed view and mouse
+    m_map->setView(getTruth());
+    m_map->setMouseGraphic(nullptr);
+    delete m_replay;
+    m_replay = nullptr;
+    delete m_view;
+    m_view = nullptr;
+    delete m_mouseGraphic;
+    m_mouseGraphic = nullptr;
 }
 
-void Window::setWall(int x, int y, QChar direction) {
-    if (!isWithinMaze(x, y)) {
-        return;
+void Window::onPauseButtonPressed() {
+    m_isPaused = !m_isPaused;
+    if (m_isPaused) {
+        m_pauseButton->setText("Resume");
+        m_runStatus->setText("PAUSED");
     }
-    if (!CHAR_TO_DIRECTION().contains(direction)) {
-        return;
+    else {
+        m_pauseButton->setText("Pause");
+        m_runStatus->setText("RUNNING");
     }
-    Direction d = CHAR_TO_DIRECTION().value(direction);
-    m_view->getMazeGraphic()->setWall(x, y, d);
-    Wall opposingWall = getOpposingWall({x, y, d});
-    if (isWithinMaze(opposingWall.x, opposingWall.y)) {
-        m_view->getMazeGraphic()->setWall(
-            opposingWall.x,
-            opposingWall.y,
-            opposingWall.d
-        ); 
+    m_engine->setPaused(m_isPaused);
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setPaused(m_isPaused);
     }
 }
 
-void Window::clearWall(int x, int y, QChar direction) {
-    if (!isWithinMaze(x, y)) {
-        return;
-    }
-    if (!CHAR_TO_DIRECTION().contains(direction)) {
-        return;
-    }
-    Direction d = CHAR_TO_DIRECTION().value(direction);
-    m_view->getMazeGraphic()->clearWall(x, y, d);
-    Wall opposingWall = getOpposingWall({x, y, d});
-    if (isWithinMaze(opposingWall.x, opposingWall.y)) {
-        m_view->getMazeGraphic()->clearWall(
-            opposingWall.x,
-            opposingWall.y,
-            opposingWall.d
-        ); 
+void Window::onResetButtonPressed() {
+    m_resetButton->setEnabled(false);
+    m_resetButton->setText("Waiting");
+    m_engine->requestReset();
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->requestReset();
     }
 }
 
-void Window::setColor(int x, int y, QChar color) {
-    if (!isWithinMaze(x, y)) {
-        return;
+void Window::onResetAcknowledged() {
+    m_resetButton->setEnabled(true);
+    m_resetButton->setText("Reset");
+}
+
+void Window::onRunCommandsAvailable() {
+    m_runMeter->recordInput(m_runWorker->takeNumBytesRead());
+    double deadline =
+        SimUtilities::getHighResTimestamp() +
+        ProcessWorker::CONSUMER_SLICE_SECONDS;
+    ParsedCommand parsed;
+    m_engine->beginResponseBatch();
+    while (!m_engine->isQueueFull() && m_runWorker->takeCommand(&parsed)) {
+        m_runMeter->beginCommand(parsed.spec->hasResponse);
+        m_engine->dispatchCommand(
+            parsed.command,
+            parsed.spec,
+            parsed.receivedTimestamp
+        );
+        m_runMeter->endCommand();
+
+        // Yield, and pick up where we left off as soon as the events that
+        // arrived in the meantime have been handled
+        if (deadline < SimUtilities::getHighResTimestamp()) {
+            int runNumber = m_runNumber;
+            QTimer::singleShot(0, this, [=](){
+                if (runNumber == m_runNumber) {
+                    onRunCommandsAvailable();
+                }
+            });
+            break;
+        }
     }
-    if (!CHAR_TO_COLOR().contains(color)) {
+    m_engine->endResponseBatch();
+}
+
+void Window::refreshLatencyOutput() {
+    // Keep the scroll position, since the whole table is replaced
+    int position = m_latencyOutput->verticalScrollBar()->value();
+    m_latencyOutput->setPlainText(m_commandLatency.toTable());
+    m_latencyOutput->verticalScrollBar()->setValue(position);
+}
+
+void Window::logLatency() {
+    if (m_latencyLog == nullptr) {
         return;
     }
-    m_view->getMazeGraphic()->setColor(x, y, CHAR_TO_COLOR().value(color));
-    m_tilesWithColor.insert({x, y});
+    QJsonObject object;
+    object["maze"] = m_currentMazeFile;
+    object["algo"] = m_mouseAlgoComboBox->getSelectedText();
+    object["commands"] = m_commandLatency.toJson();
+    m_latencyLog->write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_latencyLog->write("\n");
+    m_latencyLog->flush();
 }
 
-void Window::clearColor(int x, int y) {
-    if (!isWithinMaze(x, y)) {
+void Window::logRunSummary(const RunSummary& summary, const RunStats& stats) {
+    if (m_runSummaryLog == nullptr) {
         return;
     }
-    m_view->getMazeGraphic()->clearColor(x, y);
-    m_tilesWithColor -= {x, y};
+    QJsonObject object;
+    object["maze"] = m_currentMazeFile;
+    object["algo"] = m_mouseAlgoComboBox->getSelectedText();
+    object["moves"] = summary.moves;
+    object["turns"] = summary.turns;
+    object["crashes"] = summary.crashes;
+    object["resets"] = summary.resets;
+    object["cellsExplored"] = summary.cellsExplored;
+    object["numCells"] = summary.numCells;
+    object["firstCenterTicks"] = static_cast<double>(summary.firstCenterTicks);
+    object["firstCenterSeconds"] = summary.firstCenterSeconds;
+    object["firstCenterMoves"] = summary.firstCenterMoves;
+    object["bestTrial"] = summary.bestTrial;
+    object["bestTrialSeconds"] = summary.bestTrialSeconds;
+    object["estimatedSeconds"] = summary.estimatedSeconds;
+    object["wallSeconds"] = stats.wallSeconds;
+    object["cpuSeconds"] = stats.cpuSeconds;
+    object["thinks"] = stats.thinks;
+    object["thinkP50Seconds"] = stats.thinkP50Seconds;
+    object["thinkP99Seconds"] = stats.thinkP99Seconds;
+    object["thinkMaxSeconds"] = stats.thinkMaxSeconds;
+    m_runSummaryLog->write(
+        QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_runSummaryLog->write("\n");
+    m_runSummaryLog->flush();
 }
 
-void Window::clearAllColor() {
-    for (QPair<int, int> position : m_tilesWithColor) {
-        m_view->getMazeGraphic()->clearColor(position.first, position.second);
+void Window::logCellProfile() {
+    if (m_cellProfileLog == nullptr) {
+        return;
     }
-    m_tilesWithColor.clear();
+    QJsonArray wallSeconds;
+    QJsonArray ticks;
+    QJsonArray commands;
+    QJsonArray visits;
+    for (const CellProfile& cell : m_engine->getCellProfile()) {
+        wallSeconds.append(cell.wallSeconds);
+        ticks.append(static_cast<double>(cell.ticks));
+        commands.append(static_cast<double>(cell.commands));
+        visits.append(cell.visits);
+    }
+    QJsonObject object;
+    object["maze"] = m_currentMazeFile;
+    object["algo"] = m_mouseAlgoComboBox->getSelectedText();
+    object["width"] = m_maze->getWidth();
+    object["height"] = m_maze->getHeight();
+    object["wallSeconds"] = wallSeconds;
+    object["ticks"] = ticks;
+    object["commands"] = commands;
+    object["visits"] = visits;
+    m_cellProfileLog->write(
+        QJsonDocument(object).toJson(QJsonDocument::Compact));
+    m_cellProfileLog->write("\n");
+    m_cellProfileLog->flush();
 }
 
-void Window::setText(int x, int y, QString text) {
-    if (!isWithinMaze(x, y)) {
+void Window::writeResponses(const QByteArray& bytes, int numResponses) {
+    if (m_runWorker == nullptr) {
         return;
     }
-    static QRegExp regex = QRegExp(
-        QString("[^") + FontImage::characters() + QString("]")
+    // The bytes are handed to the I/O thread, so they're the one allocation
+    // of a batch of responses
+    m_runMeter->recordResponse(bytes.size(), numResponses);
+    QMetaObject::invokeMethod(
+        m_runWorker,
+        "write",
+        Qt::QueuedConnection,
+        Q_ARG(QByteArray, bytes)
     );
-    text.replace(regex, "?");
-    m_view->getMazeGraphic()->setText(x, y, text);
-    m_tilesWithText.insert({x, y});
 }
 
-void Window::clearText(int x, int y) {
-    if (!isWithinMaze(x, y)) {
-        return;
-    }
-    m_view->getMazeGraphic()->clearText(x, y);
-    m_tilesWithText -= {x, y};
+double Window::progressPerSecond() const {
+    // Calculate progressPerSecond for non-linear slider
+    double value = static_cast<double>(m_speedSlider->value());
+    double fraction = value / SPEED_SLIDER_MAX;
+    double rangeMin = qPow(SimulationEngine::MIN_PROGRESS_PER_SECOND, .25);
+    double rangeMax = qPow(SimulationEngine::MAX_PROGRESS_PER_SECOND, .25);
+    double rangeValue = (1.0 - fraction) * rangeMin + fraction * rangeMax;
+    return qPow(rangeValue, 4);
 }
 
-void Window::clearAllText() {
-    for (QPair<int, int> position : m_tilesWithText) {
-        m_view->getMazeGraphic()->clearText(position.first, position.second);
+void Window::onSpeedSliderChanged(int value) {
+    Q_UNUSED(value);
+    if (m_engine != nullptr) {
+        m_engine->setProgressPerSecond(progressPerSecond());
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setProgressPerSecond(progressPerSecond());
     }
-    m_tilesWithText.clear();
 }
 
-bool Window::wasReset() {
-    return m_wasReset;
+void Window::onInstantCheckBoxToggled(bool checked) {
+    // The speed is meaningless when movements aren't animated
+    m_speedSlider->setEnabled(!checked);
+    if (m_engine != nullptr) {
+        m_engine->setInstant(checked);
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setInstant(checked);
+    }
 }
 
-void Window::ackReset() {
-    m_mouse->reset();
-    m_startingLocation = {0, 0};
-    m_startingDirection = Direction::NORTH;
-    m_movement = Movement::NONE;
-    m_movementProgress = 0.0;
-    m_movementStepSize = 0.0;
-    m_resetButton->setEnabled(true);
-    m_resetButton->setText("Reset");
-    m_wasReset = false;
+void Window::onContinuousCheckBoxToggled(bool checked) {
+    if (m_engine != nullptr) {
+        m_engine->setContinuous(checked);
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setContinuous(checked);
+    }
 }
 
-QString Window::boolToString(bool value) const {
-    return value ? "true" : "false";
+void Window::onFogCheckBoxToggled(bool checked) {
+    if (m_engine != nullptr) {
+        m_engine->setFogEnabled(checked);
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setFogEnabled(checked);
+    }
 }
 
-bool Window::isWall(Wall wall) const {
-    return m_maze->getTile(wall.x, wall.y)->isWall(wall.d);
+void Window::onDistancesCheckBoxToggled(bool checked) {
+    if (m_engine != nullptr) {
+        m_engine->setDistanceOverlayEnabled(checked);
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setDistanceOverlayEnabled(checked);
+    }
 }
 
-bool Window::isWithinMaze(int x, int y) const {
-    return (
-        0 <= x && x < m_maze->getWidth() &&
-        0 <= y && y < m_maze->getHeight()
-    );
+ProfileMetric Window::getProfileMetric() const {
+    return static_cast<ProfileMetric>(
+        m_profileComboBox->currentData().toInt());
 }
 
-Wall Window::getOpposingWall(Wall wall) const {
-    switch (wall.d) {
-        case Direction::NORTH:
-            return {wall.x, wall.y + 1, Direction::SOUTH};
-        case Direction::EAST:
-            return {wall.x + 1, wall.y, Direction::WEST};
-        case Direction::SOUTH:
-            return {wall.x, wall.y - 1, Direction::NORTH};
-        case Direction::WEST:
-            return {wall.x - 1, wall.y, Direction::EAST};
+void Window::onProfileComboBoxChanged() {
+    if (m_engine != nullptr) {
+        m_engine->setProfileOverlay(getProfileMetric());
+    }
+    for (RivalRun* rival : m_rivalRuns) {
+        rival->getEngine()->setProfileOverlay(getProfileMetric());
     }
-}
-
-Coordinate Window::getCenterOfTile(int x, int y) const {
-    ASSERT_TR(isWithinMaze(x, y));
-    Coordinate centerOfTile = Coordinate::Cartesian(
-        Dimensions::tileLength() * (static_cast<double>(x) + 0.5),
-        Dimensions::tileLength() * (static_cast<double>(y) + 0.5)
-    );
-    return centerOfTile;
 }
 
 } 
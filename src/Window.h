@@ -1,40 +1,52 @@
 #pragma once
 
-#include <QChar>
+#include <QByteArray>
+#include <QCheckBox>
 #include <QCloseEvent>
 #include <QComboBox>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
 #include <QLabel>
 #include <QMainWindow>
-#include <QPair>
+#include <QMap>
+#include <QMenu>
 #include <QPlainTextEdit>
+#include <QProgressBar>
 #include <QProcess>
 #include <QPushButton>
-#include <QQueue>
-#include <QSet>
+#include <QThread>
 #include <QTimer>
 #include <QToolButton>
+#include <QVector>
 
+#include "CommandLatency.h"
+#include "CommandTrace.h"
+#include "ContestScorer.h"
+#include "GhostRun.h"
 #include "Map.h"
 #include "Maze.h"
+#include "MazeCache.h"
+#include "MazeLibrary.h"
+#include "MazeListModel.h"
+#include "MazeLoader.h"
+#include "MazeThumbnailer.h"
 #include "MazeView.h"
 #include "Mouse.h"
 #include "MouseGraphic.h"
+#include "ProcessWorker.h"
+#include "RivalRun.h"
+#include "RunMeter.h"
+#include "SearchableComboBox.h"
+#include "SimulationEngine.h"
+#include "SpectatorServer.h"
+#include "StatsPanel.h"
+#include "TraceReplay.h"
 
 namespace mms {
 
-enum class Movement {
-    MOVE_FORWARD,
-    TURN_RIGHT,
-    TURN_LEFT,
-    NONE,
-};
-
-struct Wall {
-    int x;
-    int y;
-    Direction d;
-};
-
 class Window : public QMainWindow {
 
     Q_OBJECT
@@ -42,9 +54,69 @@ class Window : public QMainWindow {
 public:
 
     Window(QWidget* parent = 0);
+    ~Window();
     void closeEvent(QCloseEvent* event);
     void resizeEvent(QResizeEvent* event);
 
+    // Writes the statistics of every frame of the map to the given file
+    bool setFrameLogPath(const QString& path);
+
+    // Limits the bytes that the map uploads per frame, see Map
+    void setUploadBudget(qint64 bytes);
+
+    // Keeps at most the given number of lines in the run output, where zero
+    // means no limit, and also writes every line to the given file
+    void setRunOutputMaxLines(int lines);
+    bool setRunLogPath(const QString& path);
+
+    // Stops taking commands from the algorithm while the given number of
+    // them are queued, where zero means no limit, see setQueueLimit
+    void setQueueLimit(int limit);
+
+    // Scores every run as a contest with the given rules, instead of the
+    // default rules (see ContestScorer); runs go on once a contest is over
+    void setContestRules(const ContestRules& rules);
+
+    // Appends every command and response of every run to the given trace
+    bool setCommandTracePath(const QString& path);
+
+    // Ghosts are read from the given trace, instead of the command trace,
+    // and the given kinds of ghost (see GHOST_KINDS) are checked; returns
+    // false if any kind is unknown
+    void setGhostTracePath(const QString& path);
+    bool setGhosts(const QStringList& kinds);
+
+    // Streams every run to spectators (see SpectatorServer) on the given
+    // port; returns false if it can't be listened on
+    bool setSpectatorPort(quint16 port);
+
+    // Appends the command latency of every run to the given file
+    bool setLatencyLogPath(const QString& path);
+
+    // Appends the summary of every run (see RunSummary) to the given file
+    bool setRunSummaryLogPath(const QString& path);
+
+    // Appends the cell profile of every run (see CellProfile) to the given
+    // file
+    bool setCellProfileLogPath(const QString& path);
+
+    // Writes the profile (see Profiler) to the given file whenever F4 is
+    // pressed
+    void setProfilePath(const QString& path);
+
+    // Replays a run from a trace, against the maze it was recorded against;
+    // runs are numbered from one, and zero is the last run in the trace
+    bool startReplay(const QString& path, int run);
+
+    // Replays another run of the same maze next to the replay, in sync with
+    // it; returns false if the run can't be read, or is of another maze
+    bool startComparedReplay(const QString& path, int run);
+
+    // Logs how long startup took, as of the given timer (started as the
+    // process did), once the window is constructed, once the map has drawn
+    // its first frame, and once the recently used maze is first drawn
+    void setStartupTimer(const QElapsedTimer& timer);
+
 private:
 
     // ----- Graphics -----
@@ -54,23 +126,105 @@ private:
 
     // ----- Maze -----
 
+    // The maze and truth are owned by the cache; the truth is only built
+    // once it's shown, since e.g. a replay hides it right away
+    MazeCache m_mazeCache;
     Maze* m_maze;
     MazeView* m_truth;
+    MazeView* getTruth();
     QString m_currentMazeFile;
-    QComboBox* m_mazeFileComboBox;
+    SearchableComboBox* m_mazeFileComboBox;
+
+    // While the edit button is checked, clicking the map toggles walls; the
+    // cached mazes are shared, so the edits are made to a copy of the maze,
+    // with a truth of its own, which are owned here, and freed once another
+    // maze replaces them. Saving writes the shown maze in the binary format.
+    QToolButton* m_mazeEditButton;
+    QMenu* m_mazeEditMenu;
+    Maze* m_editedMaze;
+    MazeView* m_editedTruth;
+    void onMazeEditButtonToggled(bool checked);
+    void onMazeSaveActionTriggered();
+    void onWallClicked(int x, int y, Direction direction);
+
+    // Mazes that aren't cached are loaded on the load thread; the load
+    // number tells results of a superseded load apart
+    QThread* m_loadThread;
+    MazeLoader* m_mazeLoader;
+    int m_loadNumber;
+    bool m_isLoadingNewPath;
+    QProgressBar* m_loadProgressBar;
+
+    // The blank maze is shown while the recently used maze is loaded, on
+    // the load thread, once the window is up; the load is abandoned if any
+    // other maze is shown first, and if it fails, the blank maze stays
+    static const QString BLANK_MAZE_FILE;
+    QString m_startupMazeFile;
+    int m_startupLoadNumber;
+    void loadStartupMaze();
+
+    // Milestones of startup, which are only logged once
+    QElapsedTimer m_startupTimer;
+    bool m_isFirstFrameLogged;
+    bool m_isStartupMazeShown;
+    void onMapFrameSwapped();
+    void logStartup(const QString& milestone);
+
+    // Thumbnails of the mazes in the combo box are rendered (or read from
+    // the disk cache) on a thread of their own, as their rows are shown, and
+    // kept by the combo box's model once they arrive
+    QThread* m_thumbnailThread;
+    MazeThumbnailer* m_mazeThumbnailer;
+    MazeListModel* m_mazeListModel;
+    void onMazeThumbnailRendered(
+        const QString& source,
+        const QImage& thumbnail);
+
+    // The mazes in the library directories are indexed on a thread of their
+    // own, and listed in the combo box after the recently used ones; the
+    // index of each directory is kept as it arrives, and replaced whenever
+    // its files change
+    QThread* m_libraryThread;
+    MazeLibrary* m_mazeLibrary;
+    QMenu* m_mazeLibraryMenu;
+    QMap<QString, QVector<MazeLibraryEntry>> m_libraryEntries;
+    void onMazeLibraryIndexed(
+        const QString& directory,
+        const QVector<MazeLibraryEntry>& entries);
+    void onAddLibraryActionTriggered();
+    void onRemoveLibraryActionTriggered();
+    void updateLibraryDirectories();
 
     void onMazeFileButtonPressed();
+    void onMazeGenerateButtonPressed();
     void onMazeFileComboBoxChanged(QString path);
-    void showInvalidMazeFileWarning(QString path);
+    void loadMaze(const QString& source, bool isNewPath);
+    void onMazeLoaded(MazeLoadResult result);
+    void showMaze(
+        const QString& source,
+        Maze* maze,
+        MazeView* truth,
+        bool isNewPath);
+    void showInvalidMazeFileWarning(QString path, const MazeError& error);
     void refreshMazeFileComboBox(QString selected);
-    void updateMazeAndPath(Maze* maze, QString path);
-    void updateMaze(Maze* maze);
+    void updateMazeAndPath(Maze* maze, MazeView* truth, QString path);
+    void updateMaze(Maze* maze, MazeView* truth);
 
     // ----- Algo config -----
 
-    QComboBox* m_mouseAlgoComboBox;
+    SearchableComboBox* m_mouseAlgoComboBox;
     QToolButton* m_mouseAlgoEditButton;
 
+    // Other algorithms to run against the selected one, in the same maze;
+    // which of them are checked is kept when the algos are refreshed
+    QToolButton* m_rivalsButton;
+    QMenu* m_rivalsMenu;
+
+    // Previous runs of the same maze to replay as ghosts; the best run is
+    // the one that reached the center soonest
+    QToolButton* m_ghostsButton;
+    QMenu* m_ghostsMenu;
+
     void onMouseAlgoComboBoxChanged(QString name);
     void onMouseAlgoEditButtonPressed();
     void onMouseAlgoImportButtonPressed();
@@ -97,117 +251,222 @@ private:
     QProcess* m_buildProcess;
     QLabel* m_buildStatus;
 
+    // The algorithm being built; builds are skipped while the algorithm's
+    // fingerprint matches that of its last successful build
+    QString m_buildName;
+
     void startBuild();
     void cancelBuild();
     void onBuildExit(int exitCode, QProcess::ExitStatus exitStatus);
 
+    // ----- Algo watch -----
+
+    // While the algorithm is watched, its directory is polled every WATCH_MS
+    // for changes (by the fingerprint of its build), and once it has stopped
+    // changing, the run is canceled, the algorithm is rebuilt (unless the
+    // build is up to date) and run again. If fast-forwarding, the new run
+    // fast-forwards through the cells of the previous run of the same maze
+    // for as long as it follows them, and then pauses, so that it picks up
+    // where the previous run was, or where the two of them diverged.
+    static const int WATCH_MS;
+    QCheckBox* m_watchCheckBox;
+    QCheckBox* m_fastForwardCheckBox;
+    QTimer* m_watchTimer;
+    QString m_watchName;
+    QString m_watchFingerprint;
+    bool m_isWatchChangePending;
+    bool m_isReloading;
+    QVector<QPair<int, int>> m_previousTrail;
+    QString m_previousTrailMaze;
+
+    void onWatchCheckBoxToggled(bool checked);
+    void onWatchTimeout();
+    QString getWatchFingerprint() const;
+    void reloadAlgo();
+    void finishReload(bool isBuilt);
+    void onFastForwardEnded(int numCells, bool hasDiverged);
+
     // ----- Algo run -----
 
     QPushButton* m_runButton;
-    QProcess* m_runProcess;
     QLabel* m_runStatus;
 
+    // All communication with the run process happens on the I/O thread; the
+    // run number tells notifications from a previous (canceled) run apart
+    QThread* m_ioThread;
+    ProcessWorker* m_runWorker;
+    int m_runNumber;
+
+    // While the engine's queue is full, commands are left with the worker,
+    // which stops reading once its own queue fills up too, so that the
+    // algorithm blocks on its writes rather than the simulator's memory
+    // growing without bound
+    static const int DEFAULT_QUEUE_LIMIT;
+    int m_queueLimit;
+    ContestRules m_contestRules;
+
+    // Lines logged by the run are buffered, and appended to the run output
+    // all at once, at most every RUN_OUTPUT_FLUSH_MS; the run output only
+    // keeps the most recent lines, but a log file gets all of them
+    static const int RUN_OUTPUT_FLUSH_MS;
+    static const int DEFAULT_RUN_OUTPUT_MAX_LINES;
+    QStringList m_runOutputBuffer;
+    QTimer* m_runOutputTimer;
+    QFile* m_runLog;
+    void appendRunOutput(const QStringList& lines);
+    void flushRunOutput();
+    void clearRunOutput();
+
+    // Every command that the run sends, and every response, is appended to
+    // the command trace, if there is one, on a thread of its own
+    CommandTrace* m_commandTrace;
+    QString m_commandTracePath;
+
+    // Spectators are streamed the run, if there's a port for them
+    SpectatorServer* m_spectatorServer;
+
+    // Accounts for the resources used by the run, which are shown once the
+    // run is over
+    RunMeter* m_runMeter;
+
+    // The latency of every kind of command; shown in the latency output, and
+    // refreshed every LATENCY_REFRESH_MS while it's visible, and appended to
+    // the latency log, if there is one, as one JSON object per run
+    static const int LATENCY_REFRESH_MS;
+    CommandLatency m_commandLatency;
+    QPlainTextEdit* m_latencyOutput;
+    QTimer* m_latencyTimer;
+    QFile* m_latencyLog;
+    QString m_profilePath;
+    void refreshLatencyOutput();
+    void logLatency();
+
+    // The summary of each run, and how long it took, as one JSON object per
+    // run, as of the run's exit
+    QFile* m_runSummaryLog;
+    void logRunSummary(const RunSummary& summary, const RunStats& stats);
+
+    // Likewise, the cell profile of each run, with an array for each of its
+    // fields, by cell index
+    QFile* m_cellProfileLog;
+    void logCellProfile();
+
+    // Live statistics of the map and of the run, next to the controls,
+    // sampled every STATS_REFRESH_MS from counters that are kept anyway
+    static const int STATS_REFRESH_MS;
+    StatsPanel* m_statsPanel;
+    QTimer* m_statsTimer;
+    void refreshStatsPanel();
+
     void startRun();
     void cancelRun();
     void onRunExit(int exitCode, QProcess::ExitStatus exitStatus);
+    void onRunCommandsAvailable();
 
-    Mouse* m_mouse;
+    SimulationEngine* m_engine;
     MazeView* m_view;
     MouseGraphic* m_mouseGraphic;
 
+    // The view of the last run, which is reset and reused by the next run
+    // of the same maze, rather than built again; it's dropped whenever the
+    // maze changes
+    MazeView* m_spareView;
+
+    // Each checked rival is started along with the run, with the same
+    // settings as the run's engine, and goes away along with its mouse
+    QVector<RivalRun*> m_rivalRuns;
+    void startRivalRuns();
+    void removeRivalsFromMaze();
+
+    // Each checked ghost is replayed along with the run, from the ghost
+    // trace (or else the command trace), as of the run's simulated time;
+    // the best and last runs are the ones in the trace before the run
+    // started, and reference solvers' runs are made up for the maze
+    static const QStringList& GHOST_KINDS();
+    QString m_ghostTracePath;
+    QVector<GhostRun*> m_ghostRuns;
+    void startGhostRuns();
+    void syncGhostRuns();
+    void removeGhostsFromMaze();
+
     void removeMouseFromMaze();
 
+    // ----- Replay -----
+
+    // A replay shows a recorded run in place of a running algorithm; while
+    // playing, it advances every REPLAY_TICK_MS, at the speed of the slider
+    // (in commands per second), or straight to the end if instant
+    static const int REPLAY_TICK_MS;
+    TraceReplay* m_replay;
+    QWidget* m_replayControls;
+    QPushButton* m_replayPlayButton;
+    QPushButton* m_replayEndButton;
+    QSlider* m_replaySlider;
+    QLabel* m_replayPosition;
+    QTimer* m_replayTimer;
+    double m_replayCommandsOwed;
+
+    void onReplayPlayButtonPressed();
+    void onReplayTick();
+    void seekReplay(int position);
+    void stopReplay();
+
+    // Reads a run from a trace, logging why if it can't
+    static bool readTraceRun(const QString& path, int run, TraceRun* traced);
+
+    // The compared replay is shown in a map of its own, next to the first,
+    // which shares the first map's programs, meshes and textures; both
+    // replays are at the same command at all times (or at the end, if it
+    // comes first). The mice diverge after the first command at which
+    // they're in different places, and each map fogs the cells that only
+    // the other mouse has explored so far.
+    Map* m_comparedMap;
+    TraceReplay* m_comparedReplay;
+    MazeView* m_comparedView;
+    MouseGraphic* m_comparedMouseGraphic;
+    QPushButton* m_replayDivergenceButton;
+    int m_replayDivergence; // -1 if the mice never diverge
+    int getReplayLength() const;
+    void updateComparedFog();
+
     // ----- Pause/reset ----
 
     bool m_isPaused;
-    bool m_wasReset;
     QPushButton* m_pauseButton;
     QPushButton* m_resetButton;
 
     void onPauseButtonPressed();
     void onResetButtonPressed();
+    void onResetAcknowledged();
 
     // ----- Communication -----
 
-    static const QString ACK;
-    static const QString CRASH;
-    static const QString INVALID;
-
-    // Buffers to hold incomplete output, only
-    // process once terminated with a newline
-    QStringList m_logBuffer;
-    QStringList m_commandBuffer;
-    QStringList processText(QString text, QStringList* buffer);
-
-    QQueue<QString> m_commandQueue;
-    QTimer* m_commandQueueTimer;
-
-    void dispatchCommand(QString command);
-    QString executeCommand(QString command);
-    void processQueuedCommands();
+    void writeResponses(const QByteArray& bytes, int numResponses);
 
     // ----- Movement -----
 
     static const int SPEED_SLIDER_MAX;
     static const int SPEED_SLIDER_DEFAULT;
-    static const double PROGRESS_REQUIRED_FOR_MOVE;
-    static const double PROGRESS_REQUIRED_FOR_TURN;
-    static const double MIN_PROGRESS_PER_SECOND;
-    static const double MAX_PROGRESS_PER_SECOND;
-    static const double MAX_SLEEP_SECONDS;
-
-    // TODO: upforgrabs
-    // Encapsulate this state in the mouse class
-
-    QPair<int, int> m_startingLocation;
-    Direction m_startingDirection;
-    Movement m_movement;
-    double m_movementProgress;
-    double m_movementStepSize;
-    QSlider* m_speedSlider;
-
-    double progressRequired(Movement movement);
-    void updateMouseProgress(double progress);
-    void scheduleMouseProgressUpdate();
-    bool isMoving();
-
-    // ----- API -----
 
-    int mazeWidth();
-    int mazeHeight();
-
-    bool wallFront();
-    bool wallRight();
-    bool wallLeft();
-
-    bool moveForward();
-    void turnRight();
-    void turnLeft();
-
-    void setWall(int x, int y, QChar direction);
-    void clearWall(int x, int y, QChar direction);
-
-    void setColor(int x, int y, QChar color);
-    void clearColor(int x, int y);
-    void clearAllColor();
-
-    void setText(int x, int y, QString text);
-    void clearText(int x, int y);
-    void clearAllText();
-
-    bool wasReset();
-    void ackReset();
-
-    // ----- Helpers -----
-
-    QSet<QPair<int, int>> m_tilesWithColor;
-    QSet<QPair<int, int>> m_tilesWithText;
-
-    QString boolToString(bool value) const;
-    bool isWall(Wall wall) const;
-    bool isWithinMaze(int x, int y) const;
-    Wall getOpposingWall(Wall wall) const;
-    Coordinate getCenterOfTile(int x, int y) const;
+    QSlider* m_speedSlider;
+    QCheckBox* m_instantCheckBox;
+    QCheckBox* m_continuousCheckBox;
+
+    // Hides the tiles that the mouse hasn't visited yet
+    QCheckBox* m_fogCheckBox;
+    QCheckBox* m_distancesCheckBox;
+
+    // Which metric of the cell profile to show as heat, if any
+    QComboBox* m_profileComboBox;
+
+    double progressPerSecond() const;
+    void onSpeedSliderChanged(int value);
+    void onInstantCheckBoxToggled(bool checked);
+    void onContinuousCheckBoxToggled(bool checked);
+    void onFogCheckBoxToggled(bool checked);
+    void onDistancesCheckBoxToggled(bool checked);
+    ProfileMetric getProfileMetric() const;
+    void onProfileComboBoxChanged();
 };
 
 } 
@@ -0,0 +1,252 @@
+#include "WorkerServer.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QHostAddress>
+#include <QJsonDocument>
+
+#include "AssertMacros.h"
+#include "Maze.h"
+#include "MazeGenerator.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+WorkerServer::WorkerServer(int numJobs, QObject* parent) :
+    QObject(parent),
+    m_numJobs(numJobs),
+    m_server(new QTcpServer(this)),
+    m_metrics(nullptr) {
+    ASSERT_LT(0, m_numJobs);
+    connect(
+        m_server,
+        &QTcpServer::newConnection,
+        this,
+        &WorkerServer::onNewConnection
+    );
+}
+
+bool WorkerServer::listen(const QHostAddress& address, quint16 port) {
+    if (!m_server->listen(address, port)) {
+        qWarning().noquote().nospace()
+            << "Unable to listen on " << address.toString() << " port "
+            << port << ": " << m_server->errorString();
+        return false;
+    }
+    qInfo().noquote().nospace()
+        << "Listening on " << address.toString() << " port "
+        << m_server->serverPort() << ", with " << m_numJobs << " slots";
+    return true;
+}
+
+void WorkerServer::setMetrics(MetricsEndpoint* metrics) {
+    m_metrics = metrics;
+}
+
+void WorkerServer::onNewConnection() {
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* socket = m_server->nextPendingConnection();
+        m_framers.insert(socket, LineFramer());
+        connect(socket, &QTcpSocket::readyRead, this, [=](){
+            onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [=](){
+            onDisconnected(socket);
+        });
+        qInfo().noquote().nospace()
+            << "Coordinator connected from "
+            << socket->peerAddress().toString();
+
+        // Every coordinator is offered every slot, since it can't know what
+        // the others have in flight; what they send beyond the free slots
+        // waits here, and their runs' time limits only start with the runs
+        QJsonObject hello;
+        hello["type"] = "hello";
+        hello["slots"] = m_numJobs;
+        sendMessage(socket, hello);
+    }
+}
+
+void WorkerServer::onReadyRead(QTcpSocket* socket) {
+    LineFramer& framer = m_framers[socket];
+    framer.append(socket->readAll());
+    QString line;
+    while (framer.nextLine(&line)) {
+        QJsonObject message = QJsonDocument::fromJson(line.toUtf8()).object();
+        if (message["type"].toString() != "run") {
+            qWarning().noquote().nospace()
+                << "Unexpected message from coordinator: " << line;
+            continue;
+        }
+
+        int id = message["id"].toInt();
+        QString algoName = message["algo"].toString();
+        if (!SettingsMouseAlgos::names().contains(algoName)) {
+            sendResult(socket, id, HeadlessRun::getUnrunResult(
+                message["maze"].toString(),
+                RunStatus::FAILED_TO_START,
+                "No mouse algorithm named \"" + algoName + "\" on this worker"
+            ));
+            continue;
+        }
+
+        // Every job waits for a build of its algorithm; one that's already
+        // going on started late enough, but a finished one may be stale
+        AlgoBuild* build = m_builds.value(algoName);
+        if (build == nullptr || build->isFinished()) {
+            if (build != nullptr) {
+                build->deleteLater();
+            }
+            build = new AlgoBuild(algoName, this);
+            connect(build, &AlgoBuild::finished, this, [=](){
+                onBuildFinished(algoName);
+            });
+            m_builds.insert(algoName, build);
+            build->start();
+        }
+        m_pendingJobs.append({socket, message});
+    }
+}
+
+void WorkerServer::onDisconnected(QTcpSocket* socket) {
+
+    // Nobody's waiting for the results anymore
+    for (HeadlessRun* run : m_runs.values(socket)) {
+        run->disconnect(this);
+        delete run;
+    }
+    m_runs.remove(socket);
+    if (m_metrics != nullptr) {
+        m_metrics->setNumInFlight(m_runs.size());
+    }
+    for (int i = m_pendingJobs.size() - 1; 0 <= i; i -= 1) {
+        if (m_pendingJobs.at(i).socket == socket) {
+            m_pendingJobs.removeAt(i);
+        }
+    }
+    for (int i = m_queuedJobs.size() - 1; 0 <= i; i -= 1) {
+        if (m_queuedJobs.at(i).socket == socket) {
+            m_queuedJobs.removeAt(i);
+        }
+    }
+    m_framers.remove(socket);
+    socket->deleteLater();
+    qInfo() << "Coordinator disconnected";
+
+    // The slots of its runs are free for the others
+    startJobs();
+}
+
+void WorkerServer::onBuildFinished(const QString& algoName) {
+    AlgoBuild* build = m_builds.value(algoName);
+    if (!build->isSuccessful()) {
+        qWarning().noquote().nospace()
+            << "Build of \"" << algoName << "\" failed\n"
+            << build->getOutput();
+    }
+    QList<PendingJob> pendingJobs = m_pendingJobs;
+    m_pendingJobs.clear();
+    for (const PendingJob& job : pendingJobs) {
+        if (job.message["algo"].toString() != algoName) {
+            m_pendingJobs.append(job);
+        }
+        else if (build->isSuccessful()) {
+            m_queuedJobs.append(job);
+        }
+        else {
+            int id = job.message["id"].toInt();
+            sendResult(job.socket, id, HeadlessRun::getUnrunResult(
+                job.message["maze"].toString(),
+                RunStatus::FAILED_TO_START,
+                "The build failed on this worker"
+            ));
+        }
+    }
+    startJobs();
+}
+
+void WorkerServer::startJobs() {
+    while (!m_queuedJobs.isEmpty() && m_runs.size() < m_numJobs) {
+        PendingJob job = m_queuedJobs.takeFirst();
+        startJob(job.socket, job.message);
+    }
+}
+
+void WorkerServer::startJob(QTcpSocket* socket, const QJsonObject& message) {
+
+    int id = message["id"].toInt();
+    QString algoName = message["algo"].toString();
+    QString mazePath = message["maze"].toString();
+
+    // Generated mazes are generated again here, and files are sent whole
+    MazeError error;
+    Maze* maze = nullptr;
+    if (MazeGenerator::isSpec(mazePath)) {
+        maze = MazeGenerator::load(mazePath, &error);
+    }
+    else {
+        maze = Maze::fromData(
+            QByteArray::fromBase64(message["mazeData"].toString().toLatin1()),
+            &error
+        );
+    }
+    if (maze == nullptr) {
+        sendResult(socket, id, HeadlessRun::getUnrunResult(
+            mazePath,
+            RunStatus::INVALID_MAZE,
+            Maze::errorToString(error)
+        ));
+        return;
+    }
+
+    HeadlessRun* run = new HeadlessRun(
+        mazePath,
+        maze,
+        SettingsMouseAlgos::getRunArguments(algoName),
+        SettingsMouseAlgos::getDirectory(algoName),
+        message["timeout"].toDouble(),
+        static_cast<qint64>(message["tickLimit"].toDouble(-1.0)),
+        message["shm"].toBool(),
+        false,
+        message["continuous"].toBool(),
+        this
+    );
+    if (m_metrics != nullptr) {
+        run->setLatency(m_metrics->getLatency());
+    }
+    connect(run, &HeadlessRun::finished, this, [=](){
+        m_runs.remove(socket, run);
+        run->deleteLater();
+        sendResult(socket, id, run->getResult());
+        startJobs();
+    });
+    m_runs.insert(socket, run);
+    if (m_metrics != nullptr) {
+        m_metrics->setNumInFlight(m_runs.size());
+    }
+    run->start();
+}
+
+void WorkerServer::sendResult(
+        QTcpSocket* socket,
+        int id,
+        const RunResult& result) {
+    if (m_metrics != nullptr) {
+        m_metrics->recordResult(result);
+        m_metrics->setNumInFlight(m_runs.size());
+    }
+    QJsonObject message;
+    message["type"] = "result";
+    message["id"] = id;
+    message["result"] = HeadlessRun::resultToJson(result);
+    sendMessage(socket, message);
+}
+
+void WorkerServer::sendMessage(
+        QTcpSocket* socket,
+        const QJsonObject& message) {
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+}
+
+} 
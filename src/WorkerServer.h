@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QMultiHash>
+#include <QObject>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "AlgoBuild.h"
+#include "HeadlessRun.h"
+#include "LineFramer.h"
+#include "MetricsEndpoint.h"
+
+namespace mms {
+
+class WorkerServer : public QObject {
+
+    // The worker's end of a distributed tournament (see RemoteWorker): runs
+    // the jobs that coordinators send it as headless runs, and sends back
+    // their results. Algorithms are looked up by name in this machine's
+    // settings, and each job waits for a build of its algorithm that started
+    // no earlier than the job's arrival, if one isn't already going on, so
+    // that jobs run what's checked out now (builds are skipped if nothing
+    // changed, see AlgoBuild); mazes come with the jobs. The slots are shared
+    // by every coordinator, and jobs wait for a free one in the order that
+    // they were built. Runs whose coordinator goes away are stopped.
+
+    Q_OBJECT
+
+public:
+
+    WorkerServer(int numJobs, QObject* parent = 0);
+
+    // Returns false if the port can't be listened on at the address
+    bool listen(const QHostAddress& address, quint16 port);
+
+    // Every job is reported to the endpoint as it starts and finishes
+    void setMetrics(MetricsEndpoint* metrics);
+
+private:
+
+    // A job that's waiting for its algorithm to be built, or for a slot
+    struct PendingJob {
+        QTcpSocket* socket;
+        QJsonObject message;
+    };
+
+    int m_numJobs;
+    QTcpServer* m_server;
+    QHash<QTcpSocket*, LineFramer> m_framers;
+    QMultiHash<QTcpSocket*, HeadlessRun*> m_runs;
+    QHash<QString, AlgoBuild*> m_builds;
+    QList<PendingJob> m_pendingJobs;
+    QList<PendingJob> m_queuedJobs;
+    MetricsEndpoint* m_metrics;
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket* socket);
+    void onDisconnected(QTcpSocket* socket);
+    void onBuildFinished(const QString& algoName);
+
+    // Starts queued jobs for as long as there are free slots
+    void startJobs();
+    void startJob(QTcpSocket* socket, const QJsonObject& message);
+    void sendResult(QTcpSocket* socket, int id, const RunResult& result);
+    static void sendMessage(QTcpSocket* socket, const QJsonObject& message);
+};
+
+} 
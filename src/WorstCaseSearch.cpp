@@ -0,0 +1,413 @@
+#include "WorstCaseSearch.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QDir>
+#include <QTextStream>
+
+#include "AssertMacros.h"
+#include "MazeGenerator.h"
+#include "PluginRun.h"
+#include "SettingsMouseAlgos.h"
+
+namespace mms {
+
+const int WorstCaseSearch::MAX_MUTATION_ATTEMPTS = 100;
+
+WorstCaseSearch::WorstCaseSearch(
+        const QString& algoName,
+        const QStringList& seedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool continuous,
+        SearchObjective objective,
+        int numGenerations,
+        int numChildren,
+        int numFlips,
+        quint32 seed,
+        const QString& outputDirectory,
+        QObject* parent) :
+    QObject(parent),
+    m_algoName(algoName),
+    m_seedMazes(seedMazes),
+    m_numJobs(numJobs),
+    m_timeLimitSeconds(timeLimitSeconds),
+    m_tickLimit(tickLimit),
+    m_commandLimit(commandLimit),
+    m_moveLimit(moveLimit),
+    m_continuous(continuous),
+    m_objective(objective),
+    m_numGenerations(numGenerations),
+    m_numChildren(numChildren),
+    m_numFlips(numFlips),
+    m_rng(seed),
+    m_outputDirectory(outputDirectory),
+    m_isPlugin(false),
+    m_populationSize(0),
+    m_generation(0),
+    m_nextCandidate(0),
+    m_numRunning(0) {
+    ASSERT_LT(0, m_numJobs);
+    ASSERT_LE(0, m_numGenerations);
+    ASSERT_LT(0, m_numChildren);
+    ASSERT_LT(0, m_numFlips);
+}
+
+bool WorstCaseSearch::start() {
+
+    if (!SettingsMouseAlgos::names().contains(m_algoName)) {
+        qWarning().noquote().nospace()
+            << "No mouse algorithm named \"" << m_algoName << "\"";
+        return false;
+    }
+    m_runArguments = SettingsMouseAlgos::getRunArguments(m_algoName);
+    m_directory = SettingsMouseAlgos::getDirectory(m_algoName);
+    if (SettingsMouseAlgos::getListenPort(m_algoName) != 0) {
+        qWarning().noquote().nospace()
+            << "The mouse algorithm \"" << m_algoName
+            << "\" connects over TCP, so it only runs in the window";
+        return false;
+    }
+    m_isPlugin = SettingsMouseAlgos::isPlugin(m_algoName);
+    if (m_isPlugin) {
+        if (m_continuous) {
+            qWarning().noquote().nospace()
+                << "The plugin \"" << m_algoName
+                << "\" can't be run with continuous movements";
+            return false;
+        }
+        m_libraryPath = QDir(m_directory).absoluteFilePath(
+            SettingsMouseAlgos::getRunCommand(m_algoName).trimmed()
+        );
+    }
+
+    // The seeds are the first generation, and every maze of the search is
+    // descended from one of them
+    for (const QString& source : m_seedMazes) {
+        MazeError error;
+        Maze* maze = MazeGenerator::load(source, &error);
+        if (maze == nullptr) {
+            qWarning().noquote().nospace()
+                << "Invalid maze file \"" << source << "\": "
+                << Maze::errorToString(error);
+            return false;
+        }
+        if (maze->getDistance(0, 0) == -1) {
+            qWarning().noquote().nospace()
+                << "The center of \"" << source << "\" can't be reached";
+            delete maze;
+            return false;
+        }
+        m_candidates.append({source, maze->getWalls(), RunResult(), 0.0});
+        delete maze;
+    }
+    m_populationSize = m_candidates.size();
+    if (m_populationSize == 0) {
+        qWarning().noquote() << "No mazes to start the search from";
+        return false;
+    }
+    if (!m_outputDirectory.isEmpty() && !QDir().mkpath(m_outputDirectory)) {
+        qWarning().noquote().nospace()
+            << "Unable to create \"" << m_outputDirectory << "\"";
+        return false;
+    }
+    startGeneration();
+    return true;
+}
+
+const QMap<QString, SearchObjective>& WorstCaseSearch::STRING_TO_OBJECTIVE() {
+    static const QMap<QString, SearchObjective> map = {
+        {"moves", SearchObjective::MOVES},
+        {"time", SearchObjective::TIME},
+    };
+    return map;
+}
+
+void WorstCaseSearch::startGeneration() {
+
+    // The seeds were already set up by start; every later generation is the
+    // children of the population
+    if (0 < m_generation) {
+        m_candidates.clear();
+        for (const Candidate& parent : m_population) {
+            for (int i = 0; i < m_numChildren; i += 1) {
+                WallGrid walls;
+                if (!mutate(parent.walls, &walls)) {
+                    continue;
+                }
+                QString name = parent.name + "/" + QString::number(i);
+                m_candidates.append({name, walls, RunResult(), 0.0});
+            }
+        }
+    }
+    m_nextCandidate = 0;
+
+    // Fill every slot; each finished run starts the next one
+    for (int i = 0; i < m_numJobs; i += 1) {
+        startNextRun();
+    }
+    if (m_numRunning == 0) {
+        endGeneration();
+    }
+}
+
+void WorstCaseSearch::endGeneration() {
+
+    // Candidates that weren't solved are reported, but never bred from
+    for (const Candidate& candidate : m_candidates) {
+        if (candidate.result.status == RunStatus::SOLVED) {
+            m_population.append(candidate);
+        }
+        else {
+            m_failures.append(candidate);
+        }
+    }
+    m_candidates.clear();
+    std::stable_sort(
+        m_population.begin(),
+        m_population.end(),
+        [](const Candidate& a, const Candidate& b) {
+            return b.score < a.score;
+        }
+    );
+    if (m_populationSize < m_population.size()) {
+        m_population.resize(m_populationSize);
+    }
+    if (m_population.isEmpty()) {
+        qInfo().noquote().nospace()
+            << "Generation " << m_generation << ": no solved mazes left";
+    }
+    else {
+        const Candidate& worst = m_population.first();
+        qInfo().noquote().nospace()
+            << "Generation " << m_generation << ": worst is \"" << worst.name
+            << "\", with " << worst.result.moves << " moves and "
+            << QString::number(worst.result.estimatedSeconds, 'f', 3)
+            << " estimated seconds";
+    }
+
+    if (m_generation < m_numGenerations && !m_population.isEmpty()) {
+        m_generation += 1;
+        startGeneration();
+        return;
+    }
+    printResults();
+    writeMazes();
+    emit done();
+}
+
+void WorstCaseSearch::startNextRun() {
+
+    if (m_candidates.size() <= m_nextCandidate) {
+        return;
+    }
+    int index = m_nextCandidate;
+    m_nextCandidate += 1;
+    const Candidate& candidate = m_candidates.at(index);
+    Maze* maze = Maze::fromWalls(candidate.walls);
+    ASSERT_FA(maze == nullptr);
+
+    if (m_isPlugin) {
+        PluginRun* pluginRun = new PluginRun(
+            candidate.name,
+            maze,
+            m_libraryPath,
+            m_timeLimitSeconds,
+            m_tickLimit,
+            this
+        );
+        pluginRun->setStepLimits(m_commandLimit, m_moveLimit);
+        connect(pluginRun, &PluginRun::mazeFinished, this, [=](){
+            recordResult(index, pluginRun->getResult());
+        });
+        connect(pluginRun, &PluginRun::finished, this, [=](){
+            onRunFinished(pluginRun);
+        });
+        m_numRunning += 1;
+        pluginRun->start();
+        return;
+    }
+    HeadlessRun* headlessRun = new HeadlessRun(
+        candidate.name,
+        maze,
+        m_runArguments,
+        m_directory,
+        m_timeLimitSeconds,
+        m_tickLimit,
+        false,
+        false,
+        m_continuous,
+        this
+    );
+    headlessRun->setStepLimits(m_commandLimit, m_moveLimit);
+    connect(headlessRun, &HeadlessRun::mazeFinished, this, [=](){
+        recordResult(index, headlessRun->getResult());
+    });
+    connect(headlessRun, &HeadlessRun::finished, this, [=](){
+        onRunFinished(headlessRun);
+    });
+    m_numRunning += 1;
+    headlessRun->start();
+}
+
+void WorstCaseSearch::onRunFinished(QObject* run) {
+    run->deleteLater();
+    m_numRunning -= 1;
+    startNextRun();
+    if (m_numRunning == 0) {
+        endGeneration();
+    }
+}
+
+void WorstCaseSearch::recordResult(int index, const RunResult& result) {
+    Candidate& candidate = m_candidates[index];
+    candidate.result = result;
+    candidate.score = getScore(result);
+    if (result.status != RunStatus::SOLVED) {
+        qInfo().noquote().nospace()
+            << "\"" << candidate.name << "\" wasn't solved: "
+            << HeadlessRun::statusToString(result.status)
+            << (result.error.isEmpty() ? QString() : ", " + result.error);
+    }
+}
+
+bool WorstCaseSearch::mutate(const WallGrid& parent, WallGrid* walls) {
+
+    // Every wall between two cells of the maze, i.e., the east walls of all
+    // but the last column, then the north walls of all but the last row
+    int width = parent.getWidth();
+    int height = parent.getHeight();
+    int numEastWalls = (width - 1) * height;
+    int numWalls = numEastWalls + width * (height - 1);
+    if (numWalls == 0) {
+        return false;
+    }
+
+    // The parent is a valid maze, and flipping walls between cells keeps it
+    // enclosed and consistent, so only the distances have to be checked;
+    // they're kept up to date as walls are flipped, and flipped back for the
+    // next attempt, rather than searched again for every child
+    DynamicDistances distances(
+        parent,
+        Maze::getCenterPositions(width, height)
+    );
+    for (int attempt = 0; attempt < MAX_MUTATION_ATTEMPTS; attempt += 1) {
+        QVector<QPair<QPair<int, int>, Direction>> flips;
+        for (int i = 0; i < m_numFlips; i += 1) {
+            int wall = static_cast<int>(m_rng() % numWalls);
+            if (wall < numEastWalls) {
+                flips.append({{wall / height, wall % height}, Direction::EAST});
+            }
+            else {
+                wall -= numEastWalls;
+                flips.append({
+                    {wall / (height - 1), wall % (height - 1)},
+                    Direction::NORTH
+                });
+            }
+            flipWall(&distances, flips.last().first, flips.last().second);
+        }
+        if (distances.getDistance(0, 0) != -1) {
+            *walls = distances.getWalls();
+            return true;
+        }
+        for (int i = flips.size() - 1; i >= 0; i -= 1) {
+            flipWall(&distances, flips.at(i).first, flips.at(i).second);
+        }
+    }
+    return false;
+}
+
+void WorstCaseSearch::flipWall(
+        DynamicDistances* distances,
+        QPair<int, int> position,
+        Direction direction) {
+    int x = position.first;
+    int y = position.second;
+    distances->setWall(x, y, direction, !distances->isWall(x, y, direction));
+}
+
+double WorstCaseSearch::getScore(const RunResult& result) const {
+    switch (m_objective) {
+        case SearchObjective::MOVES:
+            return result.moves;
+        case SearchObjective::TIME:
+            return result.estimatedSeconds;
+        default:
+            ASSERT_NEVER_RUNS();
+    }
+}
+
+void WorstCaseSearch::printResults() const {
+
+    QTextStream out(stdout);
+
+    int nameWidth = QString("maze").size();
+    for (const Candidate& candidate : m_population + m_failures) {
+        nameWidth = qMax(nameWidth, candidate.name.size());
+    }
+    out << QString("rank").rightJustified(4) << "  "
+        << QString("maze").leftJustified(nameWidth) << "  "
+        << QString("status").leftJustified(12)
+        << QString("moves").rightJustified(8)
+        << QString("turns").rightJustified(8)
+        << QString("est s").rightJustified(10) << endl;
+    for (int i = 0; i < m_population.size(); i += 1) {
+        const RunResult& result = m_population.at(i).result;
+        out << QString::number(i + 1).rightJustified(4) << "  "
+            << m_population.at(i).name.leftJustified(nameWidth) << "  "
+            << HeadlessRun::statusToString(result.status).leftJustified(12)
+            << QString::number(result.moves).rightJustified(8)
+            << QString::number(result.turns).rightJustified(8)
+            << QString::number(result.estimatedSeconds, 'f', 3)
+                .rightJustified(10) << endl;
+    }
+
+    // The mazes that weren't solved at all are the worst cases of all
+    for (const Candidate& candidate : m_failures) {
+        const RunResult& result = candidate.result;
+        out << QString("-").rightJustified(4) << "  "
+            << candidate.name.leftJustified(nameWidth) << "  "
+            << HeadlessRun::statusToString(result.status).leftJustified(12)
+            << QString::number(result.moves).rightJustified(8)
+            << QString::number(result.turns).rightJustified(8)
+            << QString::number(result.estimatedSeconds, 'f', 3)
+                .rightJustified(10);
+        if (!result.error.isEmpty()) {
+            out << "  " << result.error;
+        }
+        out << endl;
+    }
+    out << endl << "generations: " << m_generation
+        << ", unsolved: " << m_failures.size() << endl;
+}
+
+void WorstCaseSearch::writeMazes() const {
+
+    if (m_outputDirectory.isEmpty()) {
+        return;
+    }
+    QDir dir(m_outputDirectory);
+    auto write = [&](const Candidate& candidate, const QString& name) {
+        Maze* maze = Maze::fromWalls(candidate.walls);
+        ASSERT_FA(maze == nullptr);
+        QString path = dir.filePath(name);
+        if (!maze->toBinaryFile(path, true)) {
+            qWarning().noquote().nospace()
+                << "Couldn't write \"" << path << "\"";
+        }
+        delete maze;
+    };
+    for (int i = 0; i < m_population.size(); i += 1) {
+        write(m_population.at(i), QString("worst-%1.maze").arg(i + 1));
+    }
+    for (int i = 0; i < m_failures.size(); i += 1) {
+        write(m_failures.at(i), QString("unsolved-%1.maze").arg(i + 1));
+    }
+}
+
+} 
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <random>
+
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "DynamicDistances.h"
+#include "HeadlessRun.h"
+#include "Maze.h"
+#include "WallGrid.h"
+
+namespace mms {
+
+enum class SearchObjective {
+    MOVES, // the number of moves of the run
+    TIME, // the estimated time of the run, by the run time model
+};
+
+class WorstCaseSearch : public QObject {
+
+    // Searches for the mazes on which an algorithm does worst, by evolving a
+    // population of mazes: the population starts out as the seed mazes, and
+    // each generation, every member of the population has a number of
+    // children, each of which is its parent with a few walls flipped. Only
+    // children that are valid mazes (see Maze::fromWalls) whose center can
+    // still be reached from the start are kept. Every child is run headlessly,
+    // with a fixed number of runs in flight at once, as in a batch, and the
+    // population of the next generation is the members and children that
+    // scored highest on the objective. Runs that don't solve their maze are
+    // the worst case of all, so they're reported as they happen, and once the
+    // search is done, but not bred from. Mutations are seeded, so a search
+    // is reproducible for a deterministic algorithm.
+
+    Q_OBJECT
+
+public:
+
+    WorstCaseSearch(
+        const QString& algoName,
+        const QStringList& seedMazes,
+        int numJobs,
+        double timeLimitSeconds,
+        qint64 tickLimit,
+        qint64 commandLimit,
+        int moveLimit,
+        bool continuous,
+        SearchObjective objective,
+        int numGenerations,
+        int numChildren,
+        int numFlips,
+        quint32 seed,
+        const QString& outputDirectory,
+        QObject* parent = 0);
+
+    // Returns false if the search can't be started at all
+    bool start();
+
+    static const QMap<QString, SearchObjective>& STRING_TO_OBJECTIVE();
+
+signals:
+
+    void done();
+
+private:
+
+    // How many times a mutation is retried before a child is given up on
+    static const int MAX_MUTATION_ATTEMPTS;
+
+    struct Candidate {
+        QString name;
+        WallGrid walls;
+        RunResult result;
+        double score;
+    };
+
+    QString m_algoName;
+    QStringList m_seedMazes;
+    int m_numJobs;
+    double m_timeLimitSeconds;
+    qint64 m_tickLimit;
+    qint64 m_commandLimit;
+    int m_moveLimit;
+    bool m_continuous;
+    SearchObjective m_objective;
+    int m_numGenerations;
+    int m_numChildren;
+    int m_numFlips;
+    std::mt19937 m_rng;
+    QString m_outputDirectory;
+
+    QStringList m_runArguments;
+    QString m_directory;
+    bool m_isPlugin;
+    QString m_libraryPath;
+
+    // The population is sorted by score, worst case first; the candidates of
+    // the current generation are run in order, and scored as they finish
+    int m_populationSize;
+    QVector<Candidate> m_population;
+    QVector<Candidate> m_candidates;
+    QVector<Candidate> m_failures;
+    int m_generation;
+    int m_nextCandidate;
+    int m_numRunning;
+
+    void startGeneration();
+    void endGeneration();
+    void startNextRun();
+    void onRunFinished(QObject* run);
+    void recordResult(int index, const RunResult& result);
+
+    // Flips walls of the parent until it's a valid maze whose center can be
+    // reached, or returns false if it never is
+    bool mutate(const WallGrid& parent, WallGrid* walls);
+    static void flipWall(
+        DynamicDistances* distances,
+        QPair<int, int> position,
+        Direction direction);
+    double getScore(const RunResult& result) const;
+
+    void printResults() const;
+    void writeMazes() const;
+};
+
+} 
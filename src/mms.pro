@@ -1,5 +1,6 @@
 QT += core
 QT += gui
+QT += network
 QT += xml
 QT += widgets
 
@@ -10,6 +11,13 @@ CONFIG += debug
 CONFIG += object_parallel_to_source
 CONFIG += qt
 
+# Replaces the allocation functions, so that the benchmarks and
+# --count-allocations can count heap allocations (see AllocationCounter);
+# off unless given, e.g., qmake CONFIG+=count_allocations
+count_allocations {
+    DEFINES += MMS_COUNT_ALLOCATIONS
+}
+
 SOURCES += $$files(*.cpp, true)
 HEADERS += $$files(*.h, true)
 RESOURCES = resources.qrc
@@ -1,26 +1,35 @@
 #pragma once
 
+#include <QtMath>
+
+#include "../AssertMacros.h"
+
 namespace mms {
 
 class Angle {
 
+    // A value type, defined entirely in this header, like Distance; the
+    // bounded getters and the trigonometry aren't constexpr, since the
+    // standard math functions aren't
+
 public:
 
-    Angle();
-    static Angle Radians(double radians);
-    static Angle Degrees(double degrees);
+    constexpr Angle();
+    static constexpr Angle Radians(double radians);
+    static constexpr Angle Degrees(double degrees);
 
     double getRadiansZeroTo2pi() const;
     double getDegreesZeroTo360() const;
-    double getRadiansUnbounded() const;
-    double getDegreesUnbounded() const;
+    constexpr double getRadiansUnbounded() const;
+    constexpr double getDegreesUnbounded() const;
     double getSin() const;
     double getCos() const;
+    void getSinCos(double* sin, double* cos) const;
 
-    Angle operator*(double factor) const;
+    constexpr Angle operator*(double factor) const;
     Angle operator/(double factor) const;
-    Angle operator+(const Angle& other) const;
-    Angle operator-(const Angle& other) const;
+    constexpr Angle operator+(const Angle& other) const;
+    constexpr Angle operator-(const Angle& other) const;
     void operator+=(const Angle& other);
     void operator-=(const Angle& other);
     bool operator<(const Angle& other) const;
@@ -28,10 +37,92 @@ public:
 private:
 
     double m_radians;
-    Angle(double radians);
-    double getRadians(bool zeroTo2pi) const;
-    double getDegrees(bool zeroTo360) const;
+    constexpr Angle(double radians);
 
 };
 
+constexpr Angle::Angle() : m_radians(0.0) {
+}
+
+constexpr Angle Angle::Radians(double radians) {
+    return Angle(radians);
+}
+
+constexpr Angle Angle::Degrees(double degrees) {
+    return Angle(2 * M_PI / 360.0 * degrees);
+}
+
+inline double Angle::getRadiansZeroTo2pi() const {
+    double radians = std::fmod(m_radians, 2 * M_PI);
+    if (radians < 0) {
+       radians += 2 * M_PI;
+    }
+    if (2 * M_PI <= radians) {
+        radians -= 2 * M_PI;
+    }
+    ASSERT_LE(0, radians);
+    ASSERT_LT(radians, 2 * M_PI);
+    return radians;
+}
+
+inline double Angle::getDegreesZeroTo360() const {
+    return 360.0 / (2 * M_PI) * getRadiansZeroTo2pi();
+}
+
+constexpr double Angle::getRadiansUnbounded() const {
+    return m_radians;
+}
+
+constexpr double Angle::getDegreesUnbounded() const {
+    return 360.0 / (2 * M_PI) * m_radians;
+}
+
+inline double Angle::getSin() const {
+    return std::sin(getRadiansZeroTo2pi());
+}
+
+inline double Angle::getCos() const {
+    return std::cos(getRadiansZeroTo2pi());
+}
+
+inline void Angle::getSinCos(double* sin, double* cos) const {
+    // Reduce once, and compute both from the same argument, which compilers
+    // fuse into a single sincos evaluation
+    double radians = getRadiansZeroTo2pi();
+    *sin = std::sin(radians);
+    *cos = std::cos(radians);
+}
+
+constexpr Angle Angle::operator*(double factor) const {
+    return Angle(m_radians * factor);
+}
+
+inline Angle Angle::operator/(double factor) const {
+    ASSERT_NE(factor, 0.0);
+    return Angle(m_radians / factor);
+}
+
+constexpr Angle Angle::operator+(const Angle& other) const {
+    return Angle(m_radians + other.m_radians);
+}
+
+constexpr Angle Angle::operator-(const Angle& other) const {
+    return Angle(m_radians - other.m_radians);
+}
+
+inline void Angle::operator+=(const Angle& other) {
+    m_radians += other.m_radians;
+}
+
+inline void Angle::operator-=(const Angle& other) {
+    m_radians -= other.m_radians;
+}
+
+inline bool Angle::operator<(const Angle& other) const {
+    return getRadiansZeroTo2pi() < other.getRadiansZeroTo2pi();
+}
+
+constexpr Angle::Angle(double radians) : m_radians(radians) {
+}
+
 } 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cmath>
+
+#include "../AssertMacros.h"
+#include "Angle.h"
+#include "Distance.h"
+
+namespace mms {
+
+template <int LENGTH, int ANGLE, int TIME>
+class Quantity {
+
+    // A physical quantity whose dimensions, the powers of length, angle and
+    // time, are part of its type, so that adding a speed to an acceleration,
+    // or passing one for the other, doesn't compile, while multiplying and
+    // dividing quantities yields the right dimensions. Like Distance and
+    // Angle, it's a value type, defined entirely in this header, that holds
+    // a single double in SI units (meters, radians and seconds), so that
+    // arithmetic on quantities compiles down to arithmetic on doubles.
+
+public:
+
+    constexpr Quantity();
+    static constexpr Quantity SI(double value);
+
+    constexpr double getSI() const;
+
+    constexpr Quantity operator*(double factor) const;
+    Quantity operator/(double factor) const;
+    constexpr Quantity operator+(const Quantity& other) const;
+    constexpr Quantity operator-(const Quantity& other) const;
+    constexpr Quantity operator-() const;
+    constexpr bool operator==(const Quantity& other) const;
+    constexpr bool operator!=(const Quantity& other) const;
+    constexpr bool operator<(const Quantity& other) const;
+    constexpr bool operator<=(const Quantity& other) const;
+    void operator+=(const Quantity& other);
+    void operator-=(const Quantity& other);
+
+    template <int L, int A, int T>
+    constexpr Quantity<LENGTH + L, ANGLE + A, TIME + T> operator*(
+        const Quantity<L, A, T>& other) const;
+    template <int L, int A, int T>
+    Quantity<LENGTH - L, ANGLE - A, TIME - T> operator/(
+        const Quantity<L, A, T>& other) const;
+
+private:
+
+    template <int L, int A, int T>
+    friend class Quantity;
+
+    double m_value;
+    constexpr Quantity(double value);
+
+};
+
+using Scalar = Quantity<0, 0, 0>;
+using Length = Quantity<1, 0, 0>;
+using Duration = Quantity<0, 0, 1>;
+using Speed = Quantity<1, 0, -1>;
+using Acceleration = Quantity<1, 0, -2>;
+using AngularDistance = Quantity<0, 1, 0>;
+using AngularSpeed = Quantity<0, 1, -1>;
+using AngularAcceleration = Quantity<0, 1, -2>;
+
+constexpr Length Meters(double meters) {
+    return Length::SI(meters);
+}
+
+constexpr Duration Seconds(double seconds) {
+    return Duration::SI(seconds);
+}
+
+constexpr Speed MetersPerSecond(double metersPerSecond) {
+    return Speed::SI(metersPerSecond);
+}
+
+constexpr Acceleration MetersPerSecondSquared(double metersPerSecondSquared) {
+    return Acceleration::SI(metersPerSecondSquared);
+}
+
+constexpr AngularSpeed RadiansPerSecond(double radiansPerSecond) {
+    return AngularSpeed::SI(radiansPerSecond);
+}
+
+constexpr AngularAcceleration RadiansPerSecondSquared(
+        double radiansPerSecondSquared) {
+    return AngularAcceleration::SI(radiansPerSecondSquared);
+}
+
+// To and from the units that the geometry is in; angles are unbounded, so
+// that rates of turn can go past a full turn
+constexpr Length toLength(const Distance& distance) {
+    return Length::SI(distance.getMeters());
+}
+
+constexpr Distance toDistance(const Length& length) {
+    return Distance::Meters(length.getSI());
+}
+
+constexpr AngularDistance toAngularDistance(const Angle& angle) {
+    return AngularDistance::SI(angle.getRadiansUnbounded());
+}
+
+constexpr Angle toAngle(const AngularDistance& angle) {
+    return Angle::Radians(angle.getSI());
+}
+
+// Only defined for even dimensions, e.g., a speed from its square
+template <int LENGTH, int ANGLE, int TIME>
+inline Quantity<LENGTH / 2, ANGLE / 2, TIME / 2> squareRoot(
+        const Quantity<LENGTH, ANGLE, TIME>& quantity) {
+    static_assert(
+        LENGTH % 2 == 0 && ANGLE % 2 == 0 && TIME % 2 == 0,
+        "the square root of a quantity must have whole dimensions");
+    ASSERT_LE(0.0, quantity.getSI());
+    return Quantity<LENGTH / 2, ANGLE / 2, TIME / 2>::SI(
+        std::sqrt(quantity.getSI()));
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>::Quantity() : m_value(0.0) {
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME> Quantity<LENGTH, ANGLE, TIME>::SI(
+        double value) {
+    return Quantity(value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr double Quantity<LENGTH, ANGLE, TIME>::getSI() const {
+    return m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>
+Quantity<LENGTH, ANGLE, TIME>::operator*(double factor) const {
+    return Quantity(m_value * factor);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+inline Quantity<LENGTH, ANGLE, TIME>
+Quantity<LENGTH, ANGLE, TIME>::operator/(double factor) const {
+    ASSERT_NE(factor, 0.0);
+    return Quantity(m_value / factor);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>
+Quantity<LENGTH, ANGLE, TIME>::operator+(const Quantity& other) const {
+    return Quantity(m_value + other.m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>
+Quantity<LENGTH, ANGLE, TIME>::operator-(const Quantity& other) const {
+    return Quantity(m_value - other.m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>
+Quantity<LENGTH, ANGLE, TIME>::operator-() const {
+    return Quantity(-m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr bool Quantity<LENGTH, ANGLE, TIME>::operator==(
+        const Quantity& other) const {
+    return m_value == other.m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr bool Quantity<LENGTH, ANGLE, TIME>::operator!=(
+        const Quantity& other) const {
+    return !(m_value == other.m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr bool Quantity<LENGTH, ANGLE, TIME>::operator<(
+        const Quantity& other) const {
+    return m_value < other.m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr bool Quantity<LENGTH, ANGLE, TIME>::operator<=(
+        const Quantity& other) const {
+    return m_value <= other.m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+inline void Quantity<LENGTH, ANGLE, TIME>::operator+=(const Quantity& other) {
+    m_value += other.m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+inline void Quantity<LENGTH, ANGLE, TIME>::operator-=(const Quantity& other) {
+    m_value -= other.m_value;
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+template <int L, int A, int T>
+constexpr Quantity<LENGTH + L, ANGLE + A, TIME + T>
+Quantity<LENGTH, ANGLE, TIME>::operator*(
+        const Quantity<L, A, T>& other) const {
+    return Quantity<LENGTH + L, ANGLE + A, TIME + T>(m_value * other.m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+template <int L, int A, int T>
+inline Quantity<LENGTH - L, ANGLE - A, TIME - T>
+Quantity<LENGTH, ANGLE, TIME>::operator/(
+        const Quantity<L, A, T>& other) const {
+    ASSERT_NE(other.m_value, 0.0);
+    return Quantity<LENGTH - L, ANGLE - A, TIME - T>(m_value / other.m_value);
+}
+
+template <int LENGTH, int ANGLE, int TIME>
+constexpr Quantity<LENGTH, ANGLE, TIME>::Quantity(double value) :
+    m_value(value) {
+}
+
+} 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Angle.h"
+#include "Coordinate.h"
+
+namespace mms {
+
+class Rotation {
+
+    // A rotation by a fixed angle, whose sine and cosine are computed once
+    // upon construction, so that rotating many coordinates by the same angle
+    // costs a single trigonometric evaluation
+
+public:
+
+    explicit Rotation(const Angle& angle);
+
+    double getSin() const;
+    double getCos() const;
+
+    // Rotates counterclockwise around the origin, or around the given point
+    Coordinate rotate(const Coordinate& vertex) const;
+    Coordinate rotateAroundPoint(
+        const Coordinate& vertex,
+        const Coordinate& point) const;
+
+private:
+
+    double m_sin;
+    double m_cos;
+
+};
+
+inline Rotation::Rotation(const Angle& angle) {
+    angle.getSinCos(&m_sin, &m_cos);
+}
+
+inline double Rotation::getSin() const {
+    return m_sin;
+}
+
+inline double Rotation::getCos() const {
+    return m_cos;
+}
+
+inline Coordinate Rotation::rotate(const Coordinate& vertex) const {
+    double x = vertex.getX().getMeters();
+    double y = vertex.getY().getMeters();
+    return Coordinate::Cartesian(
+        Distance::Meters(x * m_cos - y * m_sin),
+        Distance::Meters(x * m_sin + y * m_cos));
+}
+
+inline Coordinate Rotation::rotateAroundPoint(
+        const Coordinate& vertex,
+        const Coordinate& point) const {
+    return rotate(vertex - point) + point;
+}
+
+} 
@@ -1,6 +1,14 @@
+import math
 import os
+import struct
 import sys
 import string
+import zlib
+
+# Must match FontImage::DISTANCE_FIELD_RADIUS and FontImage::FIELD_MAGIC
+DISTANCE_FIELD_RADIUS = 4
+FIELD_MAGIC = b'MMSF'
+FIELD_VERSION = 1
 
 def end_of_path_index(full_path):
     return full_path.rfind('/') + 1
@@ -32,14 +40,125 @@ def ttf2png(chars_path, font_path, dest_path):
 
     os.system(command)
 
+def read_png(png_path):
+    # Returns the width, the height, and the rows of RGBA pixels of an 8-bit,
+    # non-interlaced gray, gray and alpha, RGB or RGBA image (like the ones
+    # that convert writes), using only the standard library
+    data = open(png_path, 'rb').read()
+    assert data[:8] == b'\x89PNG\r\n\x1a\n', 'not a PNG file'
+    offset = 8
+    idat = b''
+    while offset < len(data):
+        (length, kind) = struct.unpack('>I4s', data[offset:offset + 8])
+        body = data[offset + 8:offset + 8 + length]
+        if kind == b'IHDR':
+            (width, height, depth, color_type, _, _, interlace) = \
+                struct.unpack('>IIBBBBB', body)
+            assert depth == 8 and interlace == 0, 'unsupported PNG file'
+        elif kind == b'IDAT':
+            idat += body
+        offset += 12 + length
+    channels = {0: 1, 2: 3, 4: 2, 6: 4}[color_type]
+    raw = zlib.decompress(idat)
+    stride = width * channels
+    rows = []
+    previous = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        row = bytearray(raw[start + 1:start + 1 + stride])
+        for i in range(stride):
+            a = row[i - channels] if channels <= i else 0
+            b = previous[i]
+            c = previous[i - channels] if channels <= i else 0
+            if kind == 1:
+                row[i] = (row[i] + a) & 0xff
+            elif kind == 2:
+                row[i] = (row[i] + b) & 0xff
+            elif kind == 3:
+                row[i] = (row[i] + (a + b) // 2) & 0xff
+            elif kind == 4:
+                p = a + b - c
+                (pa, pb, pc) = (abs(p - a), abs(p - b), abs(p - c))
+                predictor = a if pa <= pb and pa <= pc else b if pb <= pc else c
+                row[i] = (row[i] + predictor) & 0xff
+        previous = row
+        pixels = []
+        for x in range(width):
+            pixel = row[x * channels:(x + 1) * channels]
+            if channels <= 2:
+                pixel = bytes([pixel[0]] * 3) + pixel[1:]
+            if channels % 2 == 1:
+                pixel = bytes(pixel) + b'\xff'
+            pixels.append(tuple(pixel))
+        rows.append(pixels)
+    return (width, height, rows)
+
+def png2field(chars_path, png_path, dest_path):
+    # Writes the distance field of a font image, exactly as the simulator
+    # would build it (see FontImage::distanceField), but already flipped for
+    # OpenGL (bottom row first) and as RGBA bytes, so that the simulator can
+    # upload it as it is. The file is FIELD_MAGIC, then a 16-bit version,
+    # width and height, little-endian, then the pixels.
+    (width, height, rows) = read_png(png_path)
+    cell_width = width // len(open(chars_path).read().rstrip('\n'))
+    radius = DISTANCE_FIELD_RADIUS
+
+    # Classify each pixel, and find the color of the glyphs
+    inside = [[128 <= pixel[3] for pixel in row] for row in rows]
+    color = (255, 255, 255)
+    max_alpha = 0
+    for row in rows:
+        for pixel in row:
+            if max_alpha < pixel[3]:
+                max_alpha = pixel[3]
+                color = pixel[:3]
+
+    # For each pixel, search for the nearest pixel on the other side of an
+    # edge, without looking past the cell of the pixel's character
+    field = bytearray()
+    for y in reversed(range(height)):
+        for x in range(width):
+            cell_start = (x // cell_width) * cell_width
+            is_inside = inside[y][x]
+            nearest = float(radius)
+            for j in range(max(0, y - radius), min(height - 1, y + radius) + 1):
+                for i in range(
+                    max(cell_start, x - radius),
+                    min(cell_start + cell_width - 1, x + radius) + 1
+                ):
+                    if inside[j][i] != is_inside:
+                        nearest = min(nearest, math.sqrt(
+                            (i - x) * (i - x) + (j - y) * (j - y)))
+            # The edge lies halfway between the two pixels
+            distance = (1 if is_inside else -1) * (nearest - 0.5)
+            value = 255 * (0.5 + distance / (2 * radius))
+            alpha = max(0, min(int(math.floor(value + 0.5)), 255))
+            field += bytes(color) + bytes([alpha])
+
+    with open(dest_path, 'wb') as dest:
+        dest.write(FIELD_MAGIC)
+        dest.write(struct.pack('<HHH', FIELD_VERSION, width, height))
+        dest.write(field)
+
 if __name__ == '__main__':
 
     if (len(sys.argv) < 2):
         print('Usage: python ttf2png.py <TTF-FILE>')
+        print('       python ttf2png.py --field <PNG-FILE>...')
         sys.exit(1)
 
     chars_path = get_path(sys.argv[0]) + 'chars.txt'
+
+    # Only precompute the distance fields of existing font images
+    if sys.argv[1] == '--field':
+        for png_path in sys.argv[2:]:
+            png2field(chars_path, png_path, png_path.replace('.png', '.field'))
+        sys.exit(0)
+
     font_path = sys.argv[1]
     font_name = get_name(font_path)
+    png_path = font_name.replace('.ttf', '.png')
 
-    ttf2png(chars_path, font_path, font_name.replace('.ttf', '.png'))
+    ttf2png(chars_path, font_path, png_path)
+    png2field(chars_path, png_path, png_path.replace('.png', '.field'))